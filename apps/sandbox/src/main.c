@@ -16,6 +16,8 @@ int main(int argc, char **argv) {
   void *layer_ptr = NULL;
   Candid_Renderer *renderer = NULL;
   Candid_Mesh *cube_mesh = NULL;
+  Candid_TransformStore *transforms = NULL;
+  Candid_TransformHandle cube_node = CANDID_TRANSFORM_INVALID;
 
   (void)argc;
   (void)argv;
@@ -56,7 +58,7 @@ int main(int argc, char **argv) {
       .native_surface = layer_ptr,
       .width = (uint32_t)w,
       .height = (uint32_t)h,
-      .vsync = true,
+      .present_mode = CANDID_PRESENT_MODE_FIFO,
       .debug_mode = false,
       .max_frames_in_flight = 2,
       .app_name = "Candid Sandbox",
@@ -99,10 +101,27 @@ int main(int argc, char **argv) {
   // Free CPU-side mesh data (GPU has its own copy)
   candid_mesh_data_free(&cube_data);
 
+  Candid_TransformStoreDesc transform_desc = {.single_threaded = true};
+  candid_result = candid_transform_store_create(&transform_desc, &transforms);
+  if (candid_result == CANDID_SUCCESS) {
+    Candid_Transform local = candid_transform_identity();
+    local.position.z = -3.0f; // translate back
+    candid_result = candid_transform_create(
+        transforms, CANDID_TRANSFORM_INVALID, &local, &cube_node);
+  }
+  if (candid_result != CANDID_SUCCESS) {
+    SDL_Log("Failed to create cube transform: %d", candid_result);
+    result = 1;
+    goto cleanup;
+  }
+
   int running = 1;
   float t = 0.0f;
 
   while (running) {
+    // Pace the frame before sampling input, so it renders the latest events
+    candid_renderer_wait_frame(renderer);
+
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
       if (e.type == SDL_EVENT_QUIT) {
@@ -116,32 +135,25 @@ int main(int argc, char **argv) {
 
     t += 0.01f;
 
-    // Build model transform (rotation)
-    float rot_y = t * 0.8f;
-    float rot_x = t * 0.4f;
-    float cos_y = cosf(rot_y);
-    float sin_y = sinf(rot_y);
-    float cos_x = cosf(rot_x);
-    float sin_x = sinf(rot_x);
-
-    Candid_Mat4 transform = {0};
-    transform.m[0] = cos_y;
-    transform.m[2] = sin_y;
-    transform.m[5] = cos_x;
-    transform.m[6] = -sin_x;
-    transform.m[8] = -sin_y;
-    transform.m[9] = sin_x * cos_y;
-    transform.m[10] = cos_x * cos_y;
-    transform.m[14] = -3.0f; // translate back
-    transform.m[15] = 1.0f;
+    // Update model transform (rotation)
+    Candid_Quat spin_y =
+        candid_quat_from_axis_angle((Candid_Vec3){0.0f, 1.0f, 0.0f}, t * 0.8f);
+    Candid_Quat spin_x =
+        candid_quat_from_axis_angle((Candid_Vec3){1.0f, 0.0f, 0.0f}, t * 0.4f);
+    candid_transform_set_rotation(transforms, cube_node,
+                                  candid_quat_multiply(spin_y, spin_x));
+    candid_transform_store_update(transforms);
 
     // Render frame
     candid_renderer_begin_frame(renderer);
-    candid_renderer_draw_mesh(renderer, cube_mesh, NULL, &transform);
+    candid_renderer_draw_mesh(
+        renderer, cube_mesh, NULL,
+        candid_transform_get_world(transforms, cube_node));
     candid_renderer_end_frame(renderer);
   }
 
 cleanup:
+  candid_transform_store_destroy(transforms);
   candid_renderer_destroy_mesh(renderer, cube_mesh);
   candid_renderer_destroy(renderer);
   SDL_Metal_DestroyView(view);
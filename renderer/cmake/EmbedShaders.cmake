@@ -0,0 +1,92 @@
+# Embed compiled built-in shaders as C arrays
+# Usage: cmake -DMANIFEST=<manifest.cmake> -DOUTPUT=<file.c> -P EmbedShaders.cmake
+#
+# The manifest (written by renderer/CMakeLists.txt) lists the shaders in
+# EMBED_SHADERS and, for each shader NAME and stage (VERTEX, FRAGMENT):
+#   EMBED_<NAME>_<STAGE>_ENTRY  entry point
+#   EMBED_<NAME>_<STAGE>_SPIRV  compiled SPIR-V
+#   EMBED_<NAME>_<STAGE>_MSL    SPIRV-Cross output (optional)
+# and the compute kernels in EMBED_KERNELS, with EMBED_<NAME>_COMPUTE_ENTRY
+# and EMBED_<NAME>_COMPUTE_SPIRV. The output defines
+# candid_builtin_shader_code and candid_builtin_kernel_code
+# (src/builtin_shaders.h).
+
+include(${MANIFEST})
+
+# Break a list of "item, " into lines of `count` items (CMake regexes have
+# no {n} repetition)
+function(wrap_items items count out)
+  string(REPEAT "[^ ]+ " ${count} pattern)
+  string(REGEX REPLACE "(${pattern})" "\\1\n    " wrapped "${items}")
+  string(REGEX REPLACE " +\n" "\n" wrapped "${wrapped}")
+  string(STRIP "${wrapped}" wrapped)
+  set(${out} "${wrapped}" PARENT_SCOPE)
+endfunction()
+
+# SPIR-V as little-endian 32-bit words, 6 per line
+function(embed_words path var out)
+  file(READ ${path} hex HEX)
+  string(REGEX REPLACE
+    "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+    "0x\\4\\3\\2\\1u, " words "${hex}")
+  wrap_items("${words}" 6 words)
+  set(${out} "static const uint32_t ${var}[] = {\n    ${words}\n};\n\n" PARENT_SCOPE)
+endfunction()
+
+# Text as bytes with a terminating zero, 12 per line
+function(embed_text path var out)
+  file(READ ${path} hex HEX)
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1, " bytes "${hex}")
+  wrap_items("${bytes}0x00" 12 bytes)
+  set(${out} "static const char ${var}[] = {\n    ${bytes}\n};\n\n" PARENT_SCOPE)
+endfunction()
+
+set(arrays "")
+set(table "")
+foreach(name IN LISTS EMBED_SHADERS)
+  string(TOLOWER ${name} lower)
+  string(APPEND table "    [CANDID_SHADER_${name}] = {\n")
+  foreach(stage IN ITEMS VERTEX FRAGMENT)
+    string(TOLOWER ${stage} member)
+    set(var ${lower}_${member})
+    embed_words(${EMBED_${name}_${stage}_SPIRV} ${var}_spirv code)
+    string(APPEND arrays "${code}")
+    set(msl "NULL, 0")
+    if(EMBED_${name}_${stage}_MSL)
+      embed_text(${EMBED_${name}_${stage}_MSL} ${var}_msl code)
+      string(APPEND arrays "${code}")
+      set(msl "${var}_msl, sizeof(${var}_msl) - 1")
+    endif()
+    string(APPEND table
+      "        .${member} = {\"${EMBED_${name}_${stage}_ENTRY}\",\n"
+      "            ${var}_spirv, sizeof(${var}_spirv),\n"
+      "            ${msl}},\n")
+  endforeach()
+  string(APPEND table "    },\n")
+endforeach()
+
+set(kernels "")
+foreach(name IN LISTS EMBED_KERNELS)
+  string(TOLOWER ${name} lower)
+  embed_words(${EMBED_${name}_COMPUTE_SPIRV} ${lower}_compute_spirv code)
+  string(APPEND arrays "${code}")
+  string(APPEND kernels
+    "    [CANDID_COMPUTE_KERNEL_${name}] = {\"${EMBED_${name}_COMPUTE_ENTRY}\",\n"
+    "        ${lower}_compute_spirv, sizeof(${lower}_compute_spirv),\n"
+    "        NULL, 0},\n")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+  "/* Generated by renderer/cmake/EmbedShaders.cmake - do not edit */\n\n"
+  "#include \"builtin_shaders.h\"\n\n"
+  "#include <stddef.h>\n\n"
+  "${arrays}"
+  "const Candid_BuiltinShaderCode\n"
+  "    candid_builtin_shader_code[CANDID_SHADER_COUNT] = {\n"
+  "${table}"
+  "};\n\n"
+  "const Candid_BuiltinStage\n"
+  "    candid_builtin_kernel_code[CANDID_COMPUTE_KERNEL_COUNT] = {\n"
+  "${kernels}"
+  "};\n")
+file(RENAME ${OUTPUT}.tmp ${OUTPUT})
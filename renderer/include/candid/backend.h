@@ -13,6 +13,7 @@
 extern "C" {
 #endif
 
+#include <candid/instance.h>
 #include <candid/material.h>
 #include <candid/mesh.h>
 #include <candid/shader.h>
@@ -25,16 +26,44 @@ extern "C" {
 typedef struct Candid_Device Candid_Device;
 typedef struct Candid_Swapchain Candid_Swapchain;
 typedef struct Candid_CommandBuffer Candid_CommandBuffer;
+typedef struct Candid_TextureTable Candid_TextureTable;
+typedef struct Candid_PipelineList Candid_PipelineList;
+typedef struct Candid_Heap Candid_Heap;
+
+/** Upper bound on secondary command buffers recorded concurrently */
+#define CANDID_MAX_SECONDARY_COMMAND_BUFFERS 16
+
+/** How finished frames replace each other on screen. Modes the surface does
+ * not support fall back to the nearest one that never tears, then FIFO. */
+typedef enum Candid_PresentMode {
+  CANDID_PRESENT_MODE_FIFO,         /**< Shown at vblank, queued (vsync) */
+  CANDID_PRESENT_MODE_FIFO_RELAXED, /**< FIFO, late frames show at once */
+  CANDID_PRESENT_MODE_MAILBOX,   /**< Newest frame shown at vblank, no wait */
+  CANDID_PRESENT_MODE_IMMEDIATE, /**< Shown at once, may tear */
+} Candid_PresentMode;
 
 typedef struct Candid_DeviceDesc {
   Candid_Backend preferred_backend;
-  void *native_window;  /**< Platform window handle */
+  void *native_window;  /**< SDL_Window (SDL_WINDOW_VULKAN) for Vulkan */
   void *native_surface; /**< Platform surface (e.g., CAMetalLayer) */
   uint32_t width;
   uint32_t height;
-  bool vsync;
+  Candid_PresentMode present_mode;
+  /** Swapchain images (0 = backend default), clamped to what the surface
+   * allows */
+  uint32_t swapchain_image_count;
   bool debug_mode; /**< Enable validation layers */
+  /** Frames the CPU may record while the GPU works on earlier ones; the
+   * frame reusing a slot waits for the one that used it (0 = 2, at most 3) */
+  uint32_t max_frames_in_flight;
   const char *app_name;
+  /** Keep the depth buffer readable after the frame pass (depth pyramid) */
+  bool sampled_depth;
+  /** Pipeline states to record as draws first use them, with the vertex
+   * layouts drawn, and pre-warm as their programs are created (optional,
+   * owned by the caller). Backends whose pipelines do not depend on render
+   * state ignore it. */
+  Candid_PipelineList *pipeline_list;
 } Candid_DeviceDesc;
 
 typedef struct Candid_DeviceLimits {
@@ -52,8 +81,176 @@ typedef struct Candid_DeviceLimits {
   bool supports_tessellation;
   bool supports_compute;
   bool supports_ray_tracing;
+  /** CANDID_QUEUE_COMPUTE runs alongside graphics work instead of on the
+   * graphics queue */
+  bool supports_async_compute;
+  /** Indirect draws (cmd_draw_mesh_indirect, cmd_draw_indexed_indirect*)
+   * honor a record's first_instance; the renderer skips them otherwise */
+  bool supports_indirect_draw;
 } Candid_DeviceLimits;
 
+/*******************************************************************************
+ * Indirect Drawing
+ ******************************************************************************/
+
+/**
+ * One indexed draw whose parameters are read by the GPU. Layout matches
+ * VkDrawIndexedIndirectCommand and MTLDrawIndexedPrimitivesIndirectArguments,
+ * so records can be written by the CPU or by a compute pass.
+ */
+typedef struct Candid_DrawIndexedIndirectCommand {
+  uint32_t index_count;
+  uint32_t instance_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  uint32_t first_instance;
+} Candid_DrawIndexedIndirectCommand;
+
+/**
+ * Multi-draw of one geometry with one material. Each record draws with the
+ * mesh's vertex and index buffers; instance i of a record decodes instance
+ * record (first_instance + i) of `instances`.
+ *
+ * Backends without GPU-sourced draw counts issue all max_draw_count records,
+ * so producers writing `count` must also set instance_count = 0 in the
+ * records past it.
+ */
+typedef struct Candid_IndirectDraw {
+  Candid_Buffer *args; /**< Candid_DrawIndexedIndirectCommand records */
+  size_t args_offset;
+  uint32_t max_draw_count;
+  Candid_Buffer *count; /**< Optional uint32_t draw count (NULL = max) */
+  size_t count_offset;
+  Candid_InstanceFormat format;
+  Candid_Buffer *instances;
+  size_t instance_offset;
+  const Candid_InstanceQuantization *quantization;
+} Candid_IndirectDraw;
+
+/**
+ * Where a mesh's geometry lives, for batching draws into multi-draws
+ */
+typedef struct Candid_MeshDrawInfo {
+  const void *geometry; /**< Meshes with equal values share index/vertex data */
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+} Candid_MeshDrawInfo;
+
+/**
+ * Storage of a mesh inside vertex and index buffers it does not own, with
+ * its data already in place (shared geometry)
+ */
+typedef struct Candid_MeshPlacement {
+  Candid_Buffer *vertex_buffer;
+  Candid_Buffer *index_buffer;
+  int32_t vertex_offset; /**< First vertex, in vertices */
+  uint32_t first_index;  /**< First index, in indices */
+} Candid_MeshPlacement;
+
+/*******************************************************************************
+ * Compute Kernels
+ ******************************************************************************/
+
+/**
+ * Compute kernels shipped with the engine. Each backend builds its own
+ * version on first use; see the matching file in renderer/shaders.
+ */
+typedef enum Candid_ComputeKernel {
+  CANDID_COMPUTE_KERNEL_CULL_INSTANCES,  /**< culling.hlsl */
+  CANDID_COMPUTE_KERNEL_DOWNSAMPLE_DEPTH, /**< hiz.hlsl */
+  CANDID_COMPUTE_KERNEL_COUNT
+} Candid_ComputeKernel;
+
+/*******************************************************************************
+ * Resource States
+ ******************************************************************************/
+
+/**
+ * How a command reads or writes a texture or buffer, for explicit
+ * transitions between uses (see cmd_barrier)
+ */
+typedef enum Candid_ResourceState {
+  CANDID_RESOURCE_STATE_UNDEFINED,      /**< Contents may be discarded */
+  CANDID_RESOURCE_STATE_COLOR_TARGET,   /**< Render pass color attachment */
+  CANDID_RESOURCE_STATE_DEPTH_TARGET,   /**< Depth attachment, written */
+  CANDID_RESOURCE_STATE_DEPTH_READ,     /**< Depth test only, or sampled */
+  CANDID_RESOURCE_STATE_SHADER_READ,    /**< Sampled or storage-read */
+  CANDID_RESOURCE_STATE_STORAGE,        /**< Storage read and write */
+  CANDID_RESOURCE_STATE_UNIFORM,        /**< Uniform buffer */
+  CANDID_RESOURCE_STATE_VERTEX,         /**< Vertex buffer */
+  CANDID_RESOURCE_STATE_INDEX,          /**< Index buffer */
+  CANDID_RESOURCE_STATE_INDIRECT,       /**< Indirect arguments and counts */
+  CANDID_RESOURCE_STATE_COPY_SOURCE,
+  CANDID_RESOURCE_STATE_COPY_DEST,
+  CANDID_RESOURCE_STATE_PRESENT,
+  CANDID_RESOURCE_STATE_COUNT
+} Candid_ResourceState;
+
+/**
+ * Transition of one resource. Work after the barrier using it in `after`
+ * waits for work before it using it in `before`; writes in `before` become
+ * visible. From UNDEFINED the contents are discarded, as when a texture
+ * takes over aliased memory, and the barrier waits for the earlier uses in
+ * `aliased_states`, or for all earlier work when it is 0.
+ */
+typedef struct Candid_ResourceBarrier {
+  Candid_Texture *texture; /**< Exactly one of texture and buffer */
+  Candid_Buffer *buffer;
+  Candid_ResourceState before;
+  Candid_ResourceState after;
+  /** From UNDEFINED: states the memory was last used in by its previous
+   * occupants, one bit (1u << state) each */
+  uint32_t aliased_states;
+} Candid_ResourceBarrier;
+
+/*******************************************************************************
+ * Render Targets
+ ******************************************************************************/
+
+/** What a render pass does with an attachment's previous contents */
+typedef enum Candid_LoadAction {
+  CANDID_LOAD_ACTION_CLEAR,
+  CANDID_LOAD_ACTION_LOAD,
+  CANDID_LOAD_ACTION_DONT_CARE, /**< Every pixel is drawn over */
+} Candid_LoadAction;
+
+/**
+ * Render pass into textures instead of the swapchain, e.g. post-processing
+ * or shadow maps. Level 0 and layer 0 are drawn into; both attachments must
+ * have the same size.
+ */
+typedef struct Candid_RenderPassDesc {
+  Candid_Texture *color; /**< RENDER_TARGET texture, NULL for depth only */
+  Candid_Texture *depth; /**< DEPTH_STENCIL texture, or NULL */
+  Candid_LoadAction color_load;
+  Candid_LoadAction depth_load;
+  Candid_Color clear_color;
+  float clear_depth;
+  uint8_t clear_stencil;
+  bool discard_depth; /**< Depth is not needed after the pass */
+} Candid_RenderPassDesc;
+
+/*******************************************************************************
+ * Queues
+ ******************************************************************************/
+
+typedef enum Candid_Queue {
+  CANDID_QUEUE_GRAPHICS,
+  CANDID_QUEUE_COMPUTE, /**< Async compute, see cmd_begin_compute */
+  CANDID_QUEUE_COUNT,
+} Candid_Queue;
+
+/**
+ * Point in a queue's timeline, reached once the GPU has completed the
+ * submission that returned it and every earlier one on that queue. Values
+ * grow with each submission; 0 is reached from the start.
+ */
+typedef struct Candid_SyncPoint {
+  Candid_Queue queue;
+  uint64_t value;
+} Candid_SyncPoint;
+
 /*******************************************************************************
  * Backend Interface (Virtual Table)
  *
@@ -76,6 +273,12 @@ typedef struct Candid_BackendInterface {
   Candid_Result (*swapchain_resize)(Candid_Device *device, uint32_t width,
                                     uint32_t height);
   Candid_Result (*swapchain_present)(Candid_Device *device);
+  /* Block until cmd_begin can start the next frame without waiting for the
+   * GPU (optional, NULL if unsupported) */
+  Candid_Result (*frame_wait)(Candid_Device *device);
+  /* Depth buffer of the frame pass, sampled after the pass ends. Owned by
+   * the device and replaced on resize; NULL without sampled_depth. */
+  Candid_Texture *(*swapchain_get_depth_texture)(Candid_Device *device);
 
   /* Buffer operations */
   Candid_Result (*buffer_create)(Candid_Device *device,
@@ -97,6 +300,23 @@ typedef struct Candid_BackendInterface {
                                   uint32_t array_layer, const void *data,
                                   size_t size);
 
+  /* Placed textures (optional, NULL if unsupported). A heap is a block of
+   * device memory; textures placed in it at overlapping ranges alias, and
+   * only the one written last has defined contents. texture_destroy leaves
+   * the heap's memory alone; destroy a heap after its textures. */
+  Candid_Result (*heap_create)(Candid_Device *device, size_t size,
+                               Candid_Heap **out);
+  void (*heap_destroy)(Candid_Device *device, Candid_Heap *heap);
+  /* Bytes and alignment a texture takes in a heap */
+  void (*texture_get_placement)(Candid_Device *device,
+                                const Candid_TextureDesc *desc, size_t *size,
+                                size_t *alignment);
+  /* Fails when the texture cannot live in the heap's memory */
+  Candid_Result (*texture_create_placed)(Candid_Device *device,
+                                         const Candid_TextureDesc *desc,
+                                         Candid_Heap *heap, size_t offset,
+                                         Candid_Texture **out);
+
   /* Sampler operations */
   Candid_Result (*sampler_create)(Candid_Device *device,
                                   const Candid_SamplerDesc *desc,
@@ -114,17 +334,40 @@ typedef struct Candid_BackendInterface {
                                          Candid_ShaderProgram **out);
   void (*shader_program_destroy)(Candid_Device *device,
                                  Candid_ShaderProgram *program);
+  /* Owned by the device; NULL if the kernel is unavailable */
+  Candid_ShaderProgram *(*get_compute_kernel)(Candid_Device *device,
+                                              Candid_ComputeKernel kernel);
 
   /* Mesh operations */
   Candid_Result (*mesh_create)(Candid_Device *device,
                                const Candid_MeshDesc *desc, Candid_Mesh **out);
+  /* Mesh over buffers it does not own (optional, NULL if unsupported);
+   * mesh_destroy leaves the buffers alive. geometry in its draw info is the
+   * vertex buffer, shared by every mesh placed in it. */
+  Candid_Result (*mesh_create_placed)(Candid_Device *device,
+                                      const Candid_MeshDesc *desc,
+                                      const Candid_MeshPlacement *placement,
+                                      Candid_Mesh **out);
+  /* Move a placed mesh, e.g. after copying its data; call only where its
+   * draws are recorded */
+  void (*mesh_set_placement)(Candid_Mesh *mesh,
+                             const Candid_MeshPlacement *placement);
   void (*mesh_destroy)(Candid_Device *device, Candid_Mesh *mesh);
+  void (*mesh_get_draw_info)(Candid_Mesh *mesh, Candid_MeshDrawInfo *out);
 
   /* Material operations */
   Candid_Result (*material_create)(Candid_Device *device,
                                    const Candid_MaterialDesc *desc,
                                    Candid_Material **out);
   void (*material_destroy)(Candid_Device *device, Candid_Material *material);
+  /* Material instances (optional, NULL if unsupported). An instance shares
+   * its base's program, pipeline state and descriptor layout and set; the
+   * base must not itself be an instance and must outlive it. */
+  Candid_Result (*material_create_instance)(Candid_Device *device,
+                                            Candid_Material *base,
+                                            Candid_Material **out);
+  /* The material an instance was created from, or `material` itself */
+  Candid_Material *(*material_get_base)(Candid_Material *material);
 
   /* Command buffer */
   Candid_Result (*cmd_begin)(Candid_Device *device, Candid_CommandBuffer **out);
@@ -136,6 +379,12 @@ typedef struct Candid_BackendInterface {
                                          const Candid_Color *clear_color,
                                          float clear_depth,
                                          uint8_t clear_stencil);
+  /* Render pass into textures (optional, NULL if unsupported), ended by
+   * cmd_end_render_pass. Attachments are in COLOR_TARGET and DEPTH_TARGET
+   * state (see cmd_barrier) and stay in it; pipelines bound in the pass
+   * are built for its formats. */
+  Candid_Result (*cmd_begin_render_pass_targets)(
+      Candid_CommandBuffer *cmd, const Candid_RenderPassDesc *desc);
   void (*cmd_end_render_pass)(Candid_CommandBuffer *cmd);
   void (*cmd_set_viewport)(Candid_CommandBuffer *cmd, float x, float y,
                            float width, float height, float min_depth,
@@ -171,10 +420,107 @@ typedef struct Candid_BackendInterface {
   void (*cmd_draw_mesh)(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
                         Candid_Material *material,
                         const Candid_Mat4 *transform);
+  void (*cmd_draw_mesh_instanced)(
+      Candid_CommandBuffer *cmd, Candid_Mesh *mesh, Candid_Material *material,
+      Candid_InstanceFormat format, Candid_Buffer *instances, size_t offset,
+      uint32_t instance_count,
+      const Candid_InstanceQuantization *quantization);
 
-  /* Compute commands */
+  /* Indirect draw commands. Use the bound index buffer and pipeline; stride
+   * is the byte distance between Candid_DrawIndexedIndirectCommand records.
+   * Without a GPU draw count, backends issue max_draw_count draws. */
+  void (*cmd_draw_indexed_indirect)(Candid_CommandBuffer *cmd,
+                                    Candid_Buffer *buffer, size_t offset,
+                                    uint32_t draw_count, uint32_t stride);
+  void (*cmd_draw_indexed_indirect_count)(
+      Candid_CommandBuffer *cmd, Candid_Buffer *buffer, size_t offset,
+      Candid_Buffer *count_buffer, size_t count_offset,
+      uint32_t max_draw_count, uint32_t stride);
+  void (*cmd_draw_mesh_indirect)(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
+                                 Candid_Material *material,
+                                 const Candid_IndirectDraw *draw);
+
+  /* Compute commands, recorded outside render passes. While no pass is
+   * active, cmd_bind_uniform_buffer and cmd_bind_texture bind to the compute
+   * program. Writes are visible to later dispatches and to the next render
+   * pass (indirect arguments, vertex, index and fragment reads). */
+  void (*cmd_bind_compute_program)(Candid_CommandBuffer *cmd,
+                                   Candid_ShaderProgram *program);
+  void (*cmd_bind_storage_buffer)(Candid_CommandBuffer *cmd, uint32_t slot,
+                                  Candid_Buffer *buffer, size_t offset,
+                                  size_t size);
+  /* Every mip level of a STORAGE texture, indexed by level in the shader */
+  void (*cmd_bind_storage_texture)(Candid_CommandBuffer *cmd, uint32_t slot,
+                                   Candid_Texture *texture);
+  void (*cmd_clear_buffer)(Candid_CommandBuffer *cmd, Candid_Buffer *buffer,
+                           size_t offset, size_t size);
+  /* Ranges must not overlap; src and dst may be the same buffer. Ordered
+   * after earlier transfers, dispatches and draws, including those of
+   * frames still in flight. */
+  void (*cmd_copy_buffer)(Candid_CommandBuffer *cmd, Candid_Buffer *src,
+                          size_t src_offset, Candid_Buffer *dst,
+                          size_t dst_offset, size_t size);
   void (*cmd_dispatch)(Candid_CommandBuffer *cmd, uint32_t x, uint32_t y,
                        uint32_t z);
+  /* Explicit transitions, recorded outside render passes (optional, NULL
+   * when the backend tracks hazards between commands itself) */
+  void (*cmd_barrier)(Candid_CommandBuffer *cmd,
+                      const Candid_ResourceBarrier *barriers, uint32_t count);
+
+  /* Secondary command buffers (optional, NULL if unsupported). A secondary
+   * continues the primary's frame pass and may be recorded on another
+   * thread; each thread_index (< CANDID_MAX_SECONDARY_COMMAND_BUFFERS) must
+   * be used by one thread at a time. A secondary starts with the primary's
+   * pipeline, viewport and scissor, and the primary keeps them after
+   * cmd_execute_secondary, which takes ownership. */
+  Candid_Result (*cmd_begin_secondary)(Candid_CommandBuffer *primary,
+                                       uint32_t thread_index,
+                                       Candid_CommandBuffer **out);
+  void (*cmd_end_secondary)(Candid_CommandBuffer *secondary);
+  void (*cmd_execute_secondary)(Candid_CommandBuffer *primary,
+                                Candid_CommandBuffer *const *secondaries,
+                                uint32_t count);
+
+  /* Async compute (optional, NULL if unsupported). A compute command buffer
+   * takes compute, copy and barrier commands and runs on CANDID_QUEUE_COMPUTE:
+   * a queue of its own when the device has one (supports_async_compute),
+   * the graphics queue otherwise. Resources are shared between queues as
+   * they are; work on one queue sees another's writes, and may overwrite
+   * what it reads, only after waiting for its sync point. Call these on the
+   * thread submitting the frames. */
+  Candid_Result (*cmd_begin_compute)(Candid_Device *device,
+                                     Candid_CommandBuffer **out);
+  /* Submits and frees an ended compute command buffer */
+  Candid_Result (*cmd_submit_compute)(Candid_Device *device,
+                                      Candid_CommandBuffer *cmd,
+                                      Candid_SyncPoint *out_signal);
+  /* Point of the queue's last submission (cmd_submit for graphics) */
+  Candid_SyncPoint (*queue_get_sync_point)(Candid_Device *device,
+                                           Candid_Queue queue);
+  /* Commands recorded after this, outside render passes, wait for `point`
+   * (Vulkan waits at the start of the submission). Points of the command
+   * buffer's own queue are ignored. */
+  void (*cmd_wait)(Candid_CommandBuffer *cmd, const Candid_SyncPoint *point);
+
+  /* Bindless resources (optional, NULL if unsupported). A texture table is
+   * an array of sampled textures indexed by shaders (BindlessTextures in
+   * shaders/materials.hlsl); only entries no frame in flight reads may be
+   * set, and NULL clears one. cmd_bind_bindless binds a table and a storage
+   * buffer of Candid_MaterialRecord for the rest of the render pass,
+   * secondaries included; each draw then passes its material's table index
+   * to the shaders. */
+  Candid_Result (*texture_table_create)(Candid_Device *device,
+                                        uint32_t capacity,
+                                        Candid_TextureTable **out);
+  void (*texture_table_destroy)(Candid_Device *device,
+                                Candid_TextureTable *table);
+  void (*texture_table_set)(Candid_Device *device, Candid_TextureTable *table,
+                            uint32_t index, Candid_Texture *texture);
+  void (*cmd_bind_bindless)(Candid_CommandBuffer *cmd,
+                            Candid_TextureTable *table,
+                            Candid_Buffer *materials);
+  /* Call before the material's first draw */
+  void (*material_set_table_index)(Candid_Material *material, uint32_t index);
 } Candid_BackendInterface;
 
 /*******************************************************************************
@@ -0,0 +1,75 @@
+/**
+ * @file culling.h
+ * @brief GPU frustum and occlusion culling into indirect draw arguments
+ *
+ * A culling pass tests one bounding sphere per object on the GPU and appends
+ * a Candid_DrawIndexedIndirectCommand for every survivor, so the CPU submits
+ * one multi-draw regardless of scene size. Object i is drawn as instance i of
+ * the instance buffer (first_instance = i), which also supplies the
+ * transform the sphere is tested with.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <candid/backend.h>
+#include <candid/instance.h>
+#include <candid/mesh.h>
+#include <candid/types.h>
+
+/** Upper bound on objects per culling pass (65535 workgroups of 64) */
+#define CANDID_CULL_MAX_OBJECTS (65535u * 64u)
+
+/**
+ * Per-object culling record, read from a storage buffer. The draw fields are
+ * copied into the object's indirect record when it survives (see
+ * Candid_MeshDrawInfo).
+ */
+typedef struct Candid_CullObject {
+  Candid_BoundingSphere bounds; /**< In the object's local space */
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  uint32_t padding;
+} Candid_CullObject;
+
+typedef struct Candid_CullDesc {
+  Candid_Buffer *objects; /**< object_count Candid_CullObject records */
+  size_t objects_offset;
+  uint32_t object_count;
+
+  /* Instance records of `format`, one per object */
+  Candid_InstanceFormat format;
+  Candid_Buffer *instances;
+  size_t instance_offset;
+  const Candid_InstanceQuantization *quantization;
+
+  /* Output: object_count records, compacted, and a uint32_t draw count */
+  Candid_Buffer *args;
+  size_t args_offset;
+  Candid_Buffer *count;
+  size_t count_offset;
+
+  /**
+   * Optional max-depth pyramid of the previous frame, usually
+   * candid_renderer_get_depth_pyramid. Objects whose bounds lie behind it
+   * under the previous frame's view-projection are culled; NULL tests the
+   * frustum only.
+   */
+  Candid_Texture *depth_pyramid;
+} Candid_CullDesc;
+
+/**
+ * Extract normalized frustum planes (left, right, bottom, top, near, far)
+ * from a column-major view-projection matrix. A point p is inside when
+ * dot(plane.xyz, p) + plane.w >= 0 for every plane.
+ */
+void candid_frustum_planes(const Candid_Mat4 *view_projection,
+                           Candid_Vec4 out[6]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file draw_list.h
+ * @brief Draw lists recorded concurrently and merged at end of frame
+ *
+ * A draw list is owned by one thread at a time. Worker threads record into
+ * their own lists (each with private memory, so recording takes no locks),
+ * then submit them with candid_renderer_submit_draw_list. At
+ * candid_renderer_end_frame every submitted list is merged, sorted by
+ * (layer, material, mesh) to minimize state changes, material instances next
+ * to their base, and recorded after the frame's immediate draws; backends
+ * with secondary command buffers record the merged draws on several threads.
+ *
+ * Consecutive single draws sharing layer, material and geometry become one
+ * indirect multi-draw whose transforms are read as MAT4 instance records, so
+ * custom material programs must handle instance data (see instancing.hlsl).
+ *
+ * Lists are created with candid_renderer_create_draw_list.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <candid/backend.h>
+#include <candid/instance.h>
+#include <candid/types.h>
+
+typedef struct Candid_DrawList Candid_DrawList;
+
+/**
+ * Start recording a new frame's draws (discards unsubmitted draws)
+ */
+void candid_draw_list_begin(Candid_DrawList *list);
+
+/**
+ * Set the layer of subsequent draws. Lower layers are drawn first; order is
+ * preserved within a layer only for draws sharing material and mesh.
+ */
+void candid_draw_list_set_layer(Candid_DrawList *list, uint8_t layer);
+
+/**
+ * Record a mesh draw
+ * @param transform Model matrix (copied, NULL = identity)
+ */
+void candid_draw_list_draw_mesh(Candid_DrawList *list, Candid_Mesh *mesh,
+                                Candid_Material *material,
+                                const Candid_Mat4 *transform);
+
+/**
+ * Record an instanced draw; the instance records are copied
+ */
+void candid_draw_list_draw_mesh_instanced_compact(
+    Candid_DrawList *list, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, const void *instances,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization);
+
+/**
+ * Record an instanced draw reading records from a resident GPU buffer
+ */
+void candid_draw_list_draw_mesh_instanced_buffer(
+    Candid_DrawList *list, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, Candid_Buffer *buffer, size_t offset,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization);
+
+/**
+ * Record a multi-draw whose arguments are read from GPU memory (e.g. written
+ * by a culling pass). The buffers must stay alive until the frame completes.
+ * Ignored unless the device reports supports_indirect_draw.
+ */
+void candid_draw_list_draw_mesh_indirect(Candid_DrawList *list,
+                                         Candid_Mesh *mesh,
+                                         Candid_Material *material,
+                                         const Candid_IndirectDraw *draw);
+
+/**
+ * Number of draws recorded since the last begin
+ */
+uint32_t candid_draw_list_get_count(const Candid_DrawList *list);
+
+#ifdef __cplusplus
+}
+#endif
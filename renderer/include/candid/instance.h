@@ -0,0 +1,100 @@
+/**
+ * @file instance.h
+ * @brief Per-instance data formats for instanced drawing
+ *
+ * Instanced draws read one record per instance from a buffer and decode it in
+ * the vertex shader (see shaders/instancing.hlsl). The compact formats trade
+ * generality for bandwidth: a full matrix is 64 bytes, the quantized format is
+ * 16 bytes.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <candid/types.h>
+
+/*******************************************************************************
+ * Instance Formats
+ ******************************************************************************/
+
+typedef enum Candid_InstanceFormat {
+  CANDID_INSTANCE_FORMAT_MAT4,      /**< Candid_Mat4, 64 bytes */
+  CANDID_INSTANCE_FORMAT_AFFINE,    /**< Candid_InstanceAffine, 48 bytes */
+  CANDID_INSTANCE_FORMAT_QUAT_TRS,  /**< Candid_InstanceQuatTRS, 32 bytes */
+  CANDID_INSTANCE_FORMAT_QUANTIZED, /**< Candid_InstanceQuantized, 16 bytes */
+  CANDID_INSTANCE_FORMAT_COUNT
+} Candid_InstanceFormat;
+
+/**
+ * 3x4 affine matrix: the first three rows of the model matrix, translation
+ * in the w component of each row.
+ */
+typedef struct Candid_InstanceAffine {
+  float rows[3][4];
+} Candid_InstanceAffine;
+
+/**
+ * Rotation, translation and uniform scale
+ */
+typedef struct Candid_InstanceQuatTRS {
+  Candid_Quat rotation;
+  Candid_Vec3 position;
+  float scale;
+} Candid_InstanceQuatTRS;
+
+/**
+ * Quantized instance. Position is unorm16 inside the draw's quantization box,
+ * scale is unorm16 in [0, max_scale], rotation is a snorm16 quaternion.
+ */
+typedef struct Candid_InstanceQuantized {
+  uint16_t position[3];
+  uint16_t scale;
+  int16_t rotation[4];
+} Candid_InstanceQuantized;
+
+/**
+ * Decode parameters for CANDID_INSTANCE_FORMAT_QUANTIZED
+ */
+typedef struct Candid_InstanceQuantization {
+  Candid_Vec3 origin; /**< Minimum corner of the position box */
+  float max_scale;    /**< Scale that unorm 1.0 maps to */
+  Candid_Vec3 extent; /**< Size of the position box */
+  float padding;
+} Candid_InstanceQuantization;
+
+/*******************************************************************************
+ * Packing Helpers
+ ******************************************************************************/
+
+/**
+ * Size in bytes of one instance record
+ */
+size_t candid_instance_format_size(Candid_InstanceFormat format);
+
+/**
+ * Pack an affine model matrix (the projective row is dropped)
+ */
+void candid_instance_pack_affine(const Candid_Mat4 *model,
+                                 Candid_InstanceAffine *out);
+
+/**
+ * Pack rotation, position and uniform scale
+ */
+void candid_instance_pack_quat_trs(Candid_Vec3 position, Candid_Quat rotation,
+                                   float scale, Candid_InstanceQuatTRS *out);
+
+/**
+ * Quantize rotation, position and uniform scale. Positions outside the box
+ * and scales above max_scale are clamped.
+ */
+void candid_instance_pack_quantized(
+    Candid_Vec3 position, Candid_Quat rotation, float scale,
+    const Candid_InstanceQuantization *quantization,
+    Candid_InstanceQuantized *out);
+
+#ifdef __cplusplus
+}
+#endif
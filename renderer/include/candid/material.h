@@ -88,6 +88,72 @@ typedef struct Candid_MaterialDesc {
 
 typedef struct Candid_Material Candid_Material;
 
+/*******************************************************************************
+ * Material Instances
+ ******************************************************************************/
+
+typedef enum Candid_MaterialOverrideFlags {
+  CANDID_MATERIAL_OVERRIDE_BASE_COLOR = 1 << 0,
+  CANDID_MATERIAL_OVERRIDE_EMISSIVE = 1 << 1,
+  CANDID_MATERIAL_OVERRIDE_METALLIC = 1 << 2,  /**< Metallic-roughness only */
+  CANDID_MATERIAL_OVERRIDE_ROUGHNESS = 1 << 3, /**< Metallic-roughness only */
+  CANDID_MATERIAL_OVERRIDE_ALPHA_CUTOFF = 1 << 4,
+  CANDID_MATERIAL_OVERRIDE_BASE_COLOR_TEXTURE = 1 << 5,
+  CANDID_MATERIAL_OVERRIDE_NORMAL_TEXTURE = 1 << 6,
+  CANDID_MATERIAL_OVERRIDE_EMISSIVE_TEXTURE = 1 << 7,
+} Candid_MaterialOverrideFlags;
+
+/**
+ * Parameters a material instance replaces; fields whose flag is not set in
+ * `mask` are ignored and follow the base material
+ */
+typedef struct Candid_MaterialOverrides {
+  uint32_t mask; /**< Candid_MaterialOverrideFlags */
+  Candid_Color base_color_factor; /**< Diffuse for specular-glossiness */
+  Candid_Vec3 emissive_factor;
+  float metallic_factor;
+  float roughness_factor;
+  float alpha_cutoff;
+  Candid_Texture *base_color_texture; /**< NULL = no texture */
+  Candid_Texture *normal_texture;
+  Candid_Texture *emissive_texture;
+} Candid_MaterialOverrides;
+
+/*******************************************************************************
+ * Bindless Material Records
+ ******************************************************************************/
+
+/** Texture index of a record slot without a texture */
+#define CANDID_MATERIAL_NO_TEXTURE 0xFFFFu
+
+typedef enum Candid_MaterialRecordFlags {
+  CANDID_MATERIAL_FLAG_ALPHA_MASK = 1 << 0,
+  CANDID_MATERIAL_FLAG_ALPHA_BLEND = 1 << 1,
+  CANDID_MATERIAL_FLAG_DOUBLE_SIDED = 1 << 2,
+  CANDID_MATERIAL_FLAG_UNLIT = 1 << 3,
+  CANDID_MATERIAL_FLAG_SPECULAR_GLOSSINESS = 1 << 4,
+} Candid_MaterialRecordFlags;
+
+/**
+ * GPU-visible part of a Candid_MaterialDesc, as stored in the bindless
+ * material table (MaterialRecord in shaders/materials.hlsl). Textures are
+ * 16-bit indices into the bindless texture table, two per word, low half
+ * first; CANDID_MATERIAL_NO_TEXTURE marks an empty slot.
+ */
+typedef struct Candid_MaterialRecord {
+  float base_color[4]; /**< Diffuse factor for specular-glossiness */
+  float emissive[3];
+  float alpha_cutoff;
+  /** (metallic, roughness, 0, 0), or (specular.rgb, glossiness) */
+  float pbr[4];
+  /** normal_scale | occlusion_strength << 16, as half floats */
+  uint32_t scales;
+  /** base color (diffuse) | metallic-roughness (specular-glossiness) << 16 */
+  uint32_t pbr_textures;
+  uint32_t normal_occlusion_textures; /**< normal | occlusion << 16 */
+  uint32_t emissive_texture_flags; /**< emissive | flags << 16 */
+} Candid_MaterialRecord;
+
 /*******************************************************************************
  * Render State
  ******************************************************************************/
@@ -148,11 +148,46 @@ typedef struct Candid_Submesh {
 
 #define CANDID_MAX_SUBMESHES 64
 
+/**
+ * Where a mesh's vertex and index data is stored on the GPU
+ */
+typedef enum Candid_MeshStorage {
+  CANDID_MESH_STORAGE_DEDICATED, /**< Own vertex and index buffers */
+  /** Ranges of large buffers shared by meshes with the same vertex layout and
+   * index format, so their draws need no rebinding and merge into
+   * multi-draws. Requires indices. */
+  CANDID_MESH_STORAGE_SHARED,
+  /** Shared ranges read by vertex-pulling shaders (vertex_pulling.hlsl)
+   * instead of fixed-function vertex input: meshes of every layout share
+   * one storage buffer per index format, so they draw in one multi-draw
+   * with one pipeline. Requires indices, a single vertex buffer and 4-byte
+   * aligned strides and attribute offsets. */
+  CANDID_MESH_STORAGE_PULLED,
+} Candid_MeshStorage;
+
+/**
+ * Layout record stored right before the first vertex of a pulled mesh
+ * (CANDID_MESH_STORAGE_PULLED). Draws point baseVertex at the first vertex
+ * in 4-byte words, so a shader finds the record at (base vertex - 12) words
+ * and the vertex at base * 4 + (vertex id - base) * stride bytes.
+ */
+typedef struct Candid_VertexPullHeader {
+  uint32_t stride;
+  /** Per semantic up to CANDID_SEMANTIC_WEIGHTS: byte offset in the low 16
+   * bits, Candid_VertexFormat in the next 8; CANDID_VERTEX_PULL_ABSENT if
+   * the layout has no such attribute */
+  uint32_t attributes[CANDID_SEMANTIC_CUSTOM];
+  uint32_t reserved;
+} Candid_VertexPullHeader;
+
+#define CANDID_VERTEX_PULL_ABSENT 0xFFFFFFFFu
+
 typedef struct Candid_MeshDesc {
   Candid_MeshData data;
   Candid_Submesh submeshes[CANDID_MAX_SUBMESHES];
   uint32_t submesh_count;
   Candid_AABB bounds;
+  Candid_MeshStorage storage;
   const char *label;
 } Candid_MeshDesc;
 
@@ -0,0 +1,178 @@
+/**
+ * @file render_graph.h
+ * @brief Frame graph of passes declaring the resources they use
+ *
+ * Every frame, passes are declared in order with the textures and buffers
+ * they read and write. Executing the graph compiles it: passes whose
+ * results nothing uses are culled, the transitions between uses are
+ * recorded as barriers (on backends that need them), and transient textures
+ * are created in shared memory, those whose lifetimes do not overlap
+ * aliasing each other. A graph declared like the previous one reuses its
+ * compiled form and transient textures.
+ *
+ * Results are used when they reach the backbuffer, an imported resource or
+ * a pass flagged CANDID_RENDER_GRAPH_PASS_NEVER_CULL. Passes touching the
+ * backbuffer run inside the frame's render pass, after every other pass and
+ * before the frame's own draws; inside it they only read other resources,
+ * and read imported ones in the state they were imported in. Other passes
+ * writing a texture as COLOR_TARGET or DEPTH_TARGET (at most one of each)
+ * run inside a render pass over them, which clears targets the pass does
+ * not also read.
+ *
+ * Graphs are created with candid_renderer_create_render_graph and executed
+ * with candid_renderer_execute_render_graph.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <candid/backend.h>
+#include <candid/types.h>
+
+typedef struct Candid_RenderGraph Candid_RenderGraph;
+
+/** Resource of the graph being declared; 0 is never a valid resource */
+typedef uint32_t Candid_RenderGraphResource;
+
+/** Upper bounds per frame */
+#define CANDID_RENDER_GRAPH_MAX_PASSES 256
+#define CANDID_RENDER_GRAPH_MAX_RESOURCES 256
+
+typedef enum Candid_RenderGraphPassFlags {
+  /** Keep the pass even when nothing reads its results (readbacks, queries
+   * or other effects the graph cannot see) */
+  CANDID_RENDER_GRAPH_PASS_NEVER_CULL = 1 << 0,
+} Candid_RenderGraphPassFlags;
+
+/**
+ * What a pass records with, valid during its callback
+ */
+typedef struct Candid_RenderGraphContext {
+  const Candid_BackendInterface *backend;
+  Candid_Device *device;
+  Candid_CommandBuffer *cmd;
+  const void *resources; /**< Read by get_texture and get_buffer */
+} Candid_RenderGraphContext;
+
+/**
+ * Record a pass. Runs where the frame's command buffer lives (the render
+ * thread when threaded), so user data must stay valid until the frame
+ * completes.
+ */
+typedef void (*Candid_RenderGraphExecuteFn)(
+    const Candid_RenderGraphContext *context, void *user_data);
+
+typedef struct Candid_RenderGraphStats {
+  uint32_t pass_count;    /**< Declared in the last executed graph */
+  uint32_t culled_passes; /**< Of those, not executed */
+  uint32_t barrier_count; /**< Transitions recorded per execution */
+  uint32_t transient_textures;
+  size_t transient_size; /**< Bytes the transient textures would take apart */
+  size_t heap_size;      /**< Bytes they take aliased */
+  uint64_t compile_count; /**< Executions that did not reuse the last plan */
+} Candid_RenderGraphStats;
+
+/*******************************************************************************
+ * Declaration
+ ******************************************************************************/
+
+/**
+ * Start declaring a new frame's graph. Resources and passes of the previous
+ * declaration become invalid.
+ */
+void candid_render_graph_begin(Candid_RenderGraph *graph);
+
+/**
+ * Declare a texture that only lives during the graph. Its contents are
+ * undefined at its first use.
+ * @return The resource (0 on failure, which also fails the execution)
+ */
+Candid_RenderGraphResource
+candid_render_graph_create_texture(Candid_RenderGraph *graph,
+                                   const Candid_TextureDesc *desc);
+
+/**
+ * Use a texture created outside the graph
+ * @param state State it is in before the graph, and is returned to after
+ */
+Candid_RenderGraphResource
+candid_render_graph_import_texture(Candid_RenderGraph *graph,
+                                   Candid_Texture *texture,
+                                   Candid_ResourceState state);
+
+/**
+ * Use a buffer created outside the graph
+ * @param state State it is in before the graph, and is returned to after
+ */
+Candid_RenderGraphResource
+candid_render_graph_import_buffer(Candid_RenderGraph *graph,
+                                  Candid_Buffer *buffer,
+                                  Candid_ResourceState state);
+
+/**
+ * The swapchain image of the frame, written as COLOR_TARGET by passes
+ * drawing into the frame's render pass. Each such pass draws over the ones
+ * before it.
+ */
+Candid_RenderGraphResource
+candid_render_graph_get_backbuffer(Candid_RenderGraph *graph);
+
+/**
+ * Declare a pass, executed after the passes declared before it that it
+ * depends on
+ * @param name Debug name (not copied)
+ * @param flags Candid_RenderGraphPassFlags
+ * @return Pass index, for candid_render_graph_read/write
+ */
+uint32_t candid_render_graph_add_pass(Candid_RenderGraph *graph,
+                                      const char *name, uint32_t flags,
+                                      Candid_RenderGraphExecuteFn execute,
+                                      void *user_data);
+
+/**
+ * Declare that a pass reads a resource in `state`
+ */
+void candid_render_graph_read(Candid_RenderGraph *graph, uint32_t pass,
+                              Candid_RenderGraphResource resource,
+                              Candid_ResourceState state);
+
+/**
+ * Declare that a pass writes a resource in `state`. Without a read of the
+ * same resource, the pass overwrites it and the passes writing it before
+ * are not needed for it.
+ */
+void candid_render_graph_write(Candid_RenderGraph *graph, uint32_t pass,
+                               Candid_RenderGraphResource resource,
+                               Candid_ResourceState state);
+
+/*******************************************************************************
+ * Execution
+ ******************************************************************************/
+
+/**
+ * The texture of a resource, inside a pass callback (NULL for the
+ * backbuffer)
+ */
+Candid_Texture *
+candid_render_graph_get_texture(const Candid_RenderGraphContext *context,
+                                Candid_RenderGraphResource resource);
+
+/**
+ * The buffer of a resource, inside a pass callback
+ */
+Candid_Buffer *
+candid_render_graph_get_buffer(const Candid_RenderGraphContext *context,
+                               Candid_RenderGraphResource resource);
+
+/**
+ * Statistics of the last executed graph
+ */
+void candid_render_graph_get_stats(const Candid_RenderGraph *graph,
+                                   Candid_RenderGraphStats *out);
+
+#ifdef __cplusplus
+}
+#endif
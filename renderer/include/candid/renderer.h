@@ -13,9 +13,15 @@ extern "C" {
 #endif
 
 #include <candid/backend.h>
+#include <candid/culling.h>
+#include <candid/draw_list.h>
+#include <candid/instance.h>
 #include <candid/material.h>
 #include <candid/mesh.h>
+#include <candid/render_graph.h>
 #include <candid/shader.h>
+#include <candid/shader_permutation.h>
+#include <candid/transform.h>
 #include <candid/types.h>
 
 /*******************************************************************************
@@ -24,14 +30,49 @@ extern "C" {
 
 typedef struct Candid_RendererConfig {
   Candid_Backend backend; /**< Backend to use (AUTO for best) */
-  void *native_window;    /**< Platform window handle */
+  void *native_window;    /**< SDL_Window (SDL_WINDOW_VULKAN) for Vulkan */
   void *native_surface;   /**< Platform surface (CAMetalLayer, etc.) */
   uint32_t width;
   uint32_t height;
-  bool vsync;
-  bool debug_mode;               /**< Enable validation/debug layers */
-  uint32_t max_frames_in_flight; /**< 2 or 3 recommended */
+  /** FIFO (vsync) by default; MAILBOX or IMMEDIATE cut input latency */
+  Candid_PresentMode present_mode;
+  /** Swapchain images (0 = backend default); fewer queue fewer frames
+   * ahead of the display */
+  uint32_t swapchain_image_count;
+  /** Frames per second the renderer paces frame starts to (0 = unlimited),
+   * see candid_renderer_wait_frame */
+  float frame_rate_limit;
+  /** candid_renderer_wait_frame also waits until the GPU has released the
+   * frame the next one reuses, so input sampled after it is as fresh as
+   * possible. Recording no longer overlaps the GPU's previous frames. */
+  bool just_in_time;
+  bool debug_mode; /**< Enable validation/debug layers */
+  /** Frames recorded while the GPU renders earlier ones (0 = 2, at most 3);
+   * more hides GPU stalls at the cost of latency */
+  uint32_t max_frames_in_flight;
   const char *app_name;
+  bool threaded;              /**< Submit from a dedicated render thread */
+  uint32_t command_ring_size; /**< Threaded command memory (0 = 8 MiB) */
+  bool depth_pyramid; /**< Build a max-depth pyramid after every frame */
+  /** Vertex bytes per shared geometry block (0 = 64 MiB), see
+   * CANDID_MESH_STORAGE_SHARED */
+  size_t geometry_block_size;
+  /** Shared geometry bytes compacted per frame (0 = never). The meshes
+   * moved are listed by candid_renderer_get_geometry_moves. */
+  size_t geometry_defrag_budget;
+  /** Keep every sampled texture in one bindless table and every material in
+   * a table of Candid_MaterialRecord, bound once per pass; draws select
+   * their record by index (see shaders/materials.hlsl). Material changes
+   * upload only the records that changed. Ignored when the backend has no
+   * texture tables or they cannot be created. */
+  bool bindless;
+  uint32_t bindless_textures;  /**< Texture table size (0 = 16384) */
+  uint32_t bindless_materials; /**< Material table size (0 = 65536) */
+  /** File listing every pipeline state bound, saved when the renderer is
+   * destroyed. On the next run, the pipelines recorded for each program are
+   * compiled on background threads as soon as the program is created (see
+   * candid_renderer_get_pending_pipelines). NULL disables the list. */
+  const char *pipeline_list_path;
 } Candid_RendererConfig;
 
 /*******************************************************************************
@@ -40,6 +81,39 @@ typedef struct Candid_RendererConfig {
 
 typedef struct Candid_Renderer Candid_Renderer;
 
+/**
+ * Position in the renderer's command stream. In threaded mode a fence is
+ * reached once the render thread has executed (submitted) every command
+ * recorded before it; it says nothing about GPU completion.
+ */
+typedef uint64_t Candid_Fence;
+
+/**
+ * Shared geometry storage (CANDID_MESH_STORAGE_SHARED and _PULLED), in
+ * bytes over the vertex and index buffers of every block
+ */
+typedef struct Candid_GeometryStats {
+  uint32_t block_count;
+  uint32_t mesh_count;
+  size_t capacity;
+  size_t used;         /**< Including ranges waiting on frames in flight */
+  size_t largest_free; /**< Largest contiguous free range */
+  uint32_t free_ranges;
+  /** Share of free space outside each buffer's largest free range: 0 when
+   * compact, near 1 when scattered in small holes */
+  float fragmentation;
+  size_t bytes_moved;    /**< By the defragmenter this frame */
+  uint32_t meshes_moved; /**< See candid_renderer_get_geometry_moves */
+} Candid_GeometryStats;
+
+/**
+ * A shared mesh moved by the defragmenter and where it now lives
+ */
+typedef struct Candid_MeshMove {
+  Candid_Mesh *mesh;
+  Candid_MeshDrawInfo draw_info;
+} Candid_MeshMove;
+
 /*******************************************************************************
  * Renderer Lifecycle
  ******************************************************************************/
@@ -60,7 +134,10 @@ Candid_Result candid_renderer_create(const Candid_RendererConfig *config,
 void candid_renderer_destroy(Candid_Renderer *renderer);
 
 /**
- * Resize the renderer surface
+ * Resize the renderer surface without waiting for the GPU. The swapchain is
+ * replaced once, when the next frame begins drawing to it, however many
+ * resizes came before; the old one is destroyed after the frames in flight
+ * that use it.
  * @param renderer Renderer instance
  * @param width New width
  * @param height New height
@@ -102,6 +179,27 @@ Candid_Result candid_renderer_create_buffer(Candid_Renderer *renderer,
 void candid_renderer_destroy_buffer(Candid_Renderer *renderer,
                                     Candid_Buffer *buffer);
 
+/**
+ * Copy data into a CPU-visible buffer
+ */
+Candid_Result candid_renderer_update_buffer(Candid_Renderer *renderer,
+                                            Candid_Buffer *buffer,
+                                            size_t offset, const void *data,
+                                            size_t size);
+
+/**
+ * Map a CPU-visible buffer for direct writes
+ * @return Pointer to the buffer contents, or NULL for GPU-only memory
+ */
+void *candid_renderer_map_buffer(Candid_Renderer *renderer,
+                                 Candid_Buffer *buffer);
+
+/**
+ * Unmap a buffer previously mapped with candid_renderer_map_buffer
+ */
+void candid_renderer_unmap_buffer(Candid_Renderer *renderer,
+                                  Candid_Buffer *buffer);
+
 /**
  * Create a texture
  */
@@ -115,6 +213,24 @@ Candid_Result candid_renderer_create_texture(Candid_Renderer *renderer,
 void candid_renderer_destroy_texture(Candid_Renderer *renderer,
                                      Candid_Texture *texture);
 
+/**
+ * Get a render target from the renderer's pool, created on a miss. Targets
+ * released in an earlier frame with the same size, format and usage are
+ * handed back instead of allocating, so per-frame chains such as
+ * post-processing cost nothing after the first frames. Contents are
+ * undefined.
+ */
+Candid_Result candid_renderer_acquire_render_target(
+    Candid_Renderer *renderer, const Candid_TextureDesc *desc,
+    Candid_Texture **out);
+
+/**
+ * Return a render target to the pool. Commands recorded with it this frame
+ * stay valid; targets left unused for a few frames are destroyed.
+ */
+void candid_renderer_release_render_target(Candid_Renderer *renderer,
+                                           Candid_Texture *texture);
+
 /**
  * Create a sampler
  */
@@ -157,14 +273,45 @@ void candid_renderer_destroy_shader_program(Candid_Renderer *renderer,
                                             Candid_ShaderProgram *program);
 
 /**
- * Get a built-in shader program
+ * Create a set of shader permutations compiled on background threads (see
+ * shader_permutation.h). Only the fallback variant is compiled here.
+ * @return CANDID_ERROR_SHADER_COMPILATION when the fallback does not compile,
+ *         CANDID_ERROR_BACKEND_NOT_SUPPORTED without runtime compilation
+ */
+Candid_Result candid_renderer_create_shader_permutations(
+    Candid_Renderer *renderer, const Candid_ShaderPermutationDesc *desc,
+    Candid_ShaderPermutations **out);
+
+/**
+ * Destroy a permutation set, waiting for compilations in progress. Its
+ * programs are released once frames in flight are done with them.
+ */
+void candid_renderer_destroy_shader_permutations(
+    Candid_Renderer *renderer, Candid_ShaderPermutations *permutations);
+
+/**
+ * Get a built-in shader program. The built-in shaders are compiled when the
+ * engine is built; each program is created on its first request and owned
+ * by the renderer.
+ * @return CANDID_ERROR_BACKEND_NOT_SUPPORTED when the shader was not built
+ *         (no DXC at build time, or SKYBOX and PBR_SPECULAR, which have no
+ *         built-in implementation yet)
  */
 Candid_Result candid_renderer_get_builtin_shader(Candid_Renderer *renderer,
                                                  Candid_BuiltinShader shader,
                                                  Candid_ShaderProgram **out);
 
+/**
+ * Get the number of recorded pipelines still compiling in the background
+ * (see pipeline_list_path), e.g. to hold a loading screen until it reaches
+ * zero. Pipelines not compiled yet are still created when first bound.
+ */
+uint32_t candid_renderer_get_pending_pipelines(Candid_Renderer *renderer);
+
 /**
  * Create a mesh from mesh data
+ * @return CANDID_ERROR_BACKEND_NOT_SUPPORTED for shared or pulled storage
+ *         on a backend without placed meshes
  */
 Candid_Result candid_renderer_create_mesh(Candid_Renderer *renderer,
                                           const Candid_MeshDesc *desc,
@@ -175,6 +322,31 @@ Candid_Result candid_renderer_create_mesh(Candid_Renderer *renderer,
  */
 void candid_renderer_destroy_mesh(Candid_Renderer *renderer, Candid_Mesh *mesh);
 
+/**
+ * Get where a mesh's geometry lives, e.g. to fill Candid_CullObject records
+ * or indirect draw records for it. With geometry_defrag_budget, shared meshes
+ * may move at begin_frame; see candid_renderer_get_geometry_moves.
+ */
+void candid_renderer_get_mesh_draw_info(Candid_Renderer *renderer,
+                                        Candid_Mesh *mesh,
+                                        Candid_MeshDrawInfo *out);
+
+/**
+ * List the meshes moved by the defragmenter at the last begin_frame, each
+ * once with its new draw info, so records built from
+ * candid_renderer_get_mesh_draw_info can be patched rather than rebuilt.
+ * The list is valid until the next begin_frame.
+ * @return Number of moved meshes
+ */
+uint32_t candid_renderer_get_geometry_moves(Candid_Renderer *renderer,
+                                            const Candid_MeshMove **out);
+
+/**
+ * Get shared geometry usage and fragmentation
+ */
+void candid_renderer_get_geometry_stats(Candid_Renderer *renderer,
+                                        Candid_GeometryStats *out);
+
 /**
  * Create a material
  */
@@ -182,16 +354,72 @@ Candid_Result candid_renderer_create_material(Candid_Renderer *renderer,
                                               const Candid_MaterialDesc *desc,
                                               Candid_Material **out);
 
+/**
+ * Create a variant of `base` sharing its shader program, pipeline state and
+ * descriptor layout. Only `overrides` is stored: with a bindless renderer
+ * the instance gets its own material record, rebuilt whenever the base is
+ * updated; instances without overrides share the base's record. Draw lists
+ * sort instances next to their base.
+ * @param base A material that is not itself an instance, destroyed only
+ *        after its instances (with candid_renderer_destroy_material)
+ * @param overrides Parameters replacing the base's (NULL = none)
+ * @return CANDID_ERROR_BACKEND_NOT_SUPPORTED without backend support
+ */
+Candid_Result candid_renderer_create_material_instance(
+    Candid_Renderer *renderer, Candid_Material *base,
+    const Candid_MaterialOverrides *overrides, Candid_Material **out);
+
+/**
+ * Change a material's parameters: factors, alpha cutoff, flags and textures.
+ * Only its record is repacked, and uploaded if it changed; the shader stays
+ * the one it was created with. Changes made after the frame's first draw
+ * show from the next frame. Instances follow their base, except for their
+ * overrides, and cannot be updated themselves.
+ * @return CANDID_ERROR_BACKEND_NOT_SUPPORTED if the renderer is not bindless
+ */
+Candid_Result candid_renderer_update_material(Candid_Renderer *renderer,
+                                              Candid_Material *material,
+                                              const Candid_MaterialDesc *desc);
+
 /**
  * Destroy a material
  */
 void candid_renderer_destroy_material(Candid_Renderer *renderer,
                                       Candid_Material *material);
 
+/** Index of resources outside the bindless tables */
+#define CANDID_BINDLESS_INVALID_INDEX UINT32_MAX
+
+/**
+ * Get a texture's slot in the bindless texture table
+ * @return The index, or CANDID_BINDLESS_INVALID_INDEX if the renderer is not
+ * bindless, the table is full or the texture is not SAMPLED
+ */
+uint32_t candid_renderer_get_texture_index(Candid_Renderer *renderer,
+                                           Candid_Texture *texture);
+
+/**
+ * Get a material's record in the bindless material table
+ * @return The index, or CANDID_BINDLESS_INVALID_INDEX if the renderer is not
+ * bindless or the table is full
+ */
+uint32_t candid_renderer_get_material_index(Candid_Renderer *renderer,
+                                            Candid_Material *material);
+
 /*******************************************************************************
  * Frame Rendering
  ******************************************************************************/
 
+/**
+ * Wait until the next frame should start: the frame rate limit's deadline
+ * and, with just_in_time, the GPU releasing the frame the next one reuses
+ * (in threaded mode, the render thread submitting the previous frame too).
+ * Sample input after it and then begin the frame, so the frame renders the
+ * freshest input. begin_frame waits itself when this was not called.
+ * Updates the frame time and delta time.
+ */
+Candid_Result candid_renderer_wait_frame(Candid_Renderer *renderer);
+
 /**
  * Begin a new frame
  * @param renderer Renderer instance
@@ -201,11 +429,37 @@ Candid_Result candid_renderer_begin_frame(Candid_Renderer *renderer);
 
 /**
  * End the current frame and present
+ *
+ * In threaded mode the frame is handed to the render thread and this returns
+ * once the previous frame has been submitted, so at most one frame is queued.
+ * Submission errors are then reported by the following end_frame.
  * @param renderer Renderer instance
  * @return CANDID_SUCCESS on success
  */
 Candid_Result candid_renderer_end_frame(Candid_Renderer *renderer);
 
+/**
+ * Insert a fence after every command recorded so far
+ */
+Candid_Fence candid_renderer_insert_fence(Candid_Renderer *renderer);
+
+/**
+ * Block until a fence has been reached (immediate without a render thread)
+ */
+void candid_renderer_wait_fence(Candid_Renderer *renderer, Candid_Fence fence);
+
+/**
+ * Whether a fence has been reached
+ */
+bool candid_renderer_is_fence_complete(Candid_Renderer *renderer,
+                                       Candid_Fence fence);
+
+/**
+ * Wait until the render thread has executed every recorded command, e.g.
+ * before writing to a buffer the queued frame still reads
+ */
+void candid_renderer_flush(Candid_Renderer *renderer);
+
 /**
  * Set clear color for the next render pass
  */
@@ -261,6 +515,171 @@ void candid_renderer_draw_mesh_instanced(Candid_Renderer *renderer,
                                          const Candid_Mat4 *transforms,
                                          uint32_t instance_count);
 
+/**
+ * Draw instanced meshes from compact per-instance records
+ * @param renderer Renderer instance
+ * @param mesh Mesh to draw
+ * @param material Material to use
+ * @param format Layout of the records in `instances`
+ * @param instances Array of instance_count records (copied for this frame)
+ * @param instance_count Number of instances
+ * @param quantization Decode box (CANDID_INSTANCE_FORMAT_QUANTIZED only)
+ */
+void candid_renderer_draw_mesh_instanced_compact(
+    Candid_Renderer *renderer, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, const void *instances,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization);
+
+/**
+ * Draw instanced meshes from records already resident in a GPU buffer, so
+ * static instance sets are not re-uploaded every frame
+ * @param buffer Buffer holding instance_count records of `format`
+ * @param offset Byte offset of the first record
+ */
+void candid_renderer_draw_mesh_instanced_buffer(
+    Candid_Renderer *renderer, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, Candid_Buffer *buffer, size_t offset,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization);
+
+/**
+ * Issue every indirect record of `draw` with one multi-draw call. Records
+ * select index ranges of the mesh's geometry and their instance data through
+ * first_instance. Ignored unless the device reports supports_indirect_draw.
+ * @param draw Argument, count and instance buffers (the struct is copied)
+ */
+void candid_renderer_draw_mesh_indirect(Candid_Renderer *renderer,
+                                        Candid_Mesh *mesh,
+                                        Candid_Material *material,
+                                        const Candid_IndirectDraw *draw);
+
+/**
+ * Cull objects on the GPU against the current camera frustum (and the
+ * previous frame's depth pyramid), writing surviving draws to desc->args and
+ * their number to desc->count for a later candid_renderer_draw_mesh_indirect.
+ * Culling runs ahead of the frame's render pass, so it must be called after
+ * begin_frame and before any draw or viewport change of that frame.
+ * @param desc Culling inputs and outputs (the struct is copied)
+ * @return CANDID_SUCCESS if the pass was queued,
+ *         CANDID_ERROR_BACKEND_NOT_SUPPORTED without a culling kernel
+ */
+Candid_Result candid_renderer_cull(Candid_Renderer *renderer,
+                                   const Candid_CullDesc *desc);
+
+/**
+ * Max-depth pyramid of the last completed frame, for occlusion culling
+ * (Candid_CullDesc::depth_pyramid) and screen-space effects. Level 0 is the
+ * largest power-of-two size not exceeding the window; every texel holds the
+ * farthest depth beneath it. Built in a single compute dispatch after each
+ * frame's pass when Candid_RendererConfig::depth_pyramid is set.
+ * @return R32_FLOAT sampled texture owned by the renderer (replaced on
+ *         resize), or NULL if no pyramid has been built yet
+ */
+Candid_Texture *candid_renderer_get_depth_pyramid(Candid_Renderer *renderer);
+
+/*******************************************************************************
+ * Draw Lists
+ ******************************************************************************/
+
+/**
+ * Create a draw list for recording on any thread (see draw_list.h)
+ * @param renderer Renderer instance
+ * @param out Output draw list
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result candid_renderer_create_draw_list(Candid_Renderer *renderer,
+                                               Candid_DrawList **out);
+
+/**
+ * Destroy a draw list. It must not have been submitted to the frame that is
+ * currently being recorded.
+ */
+void candid_renderer_destroy_draw_list(Candid_Renderer *renderer,
+                                       Candid_DrawList *list);
+
+/**
+ * Hand a recorded draw list to the current frame. Thread-safe; must be called
+ * before candid_renderer_end_frame. The list is merged into the frame at
+ * end_frame and may be recorded again after candid_draw_list_begin.
+ */
+void candid_renderer_submit_draw_list(Candid_Renderer *renderer,
+                                      Candid_DrawList *list);
+
+/*******************************************************************************
+ * Render Graphs
+ ******************************************************************************/
+
+/**
+ * Create a render graph (see render_graph.h)
+ * @param renderer Renderer instance
+ * @param out Output graph
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result candid_renderer_create_render_graph(Candid_Renderer *renderer,
+                                                  Candid_RenderGraph **out);
+
+/**
+ * Destroy a render graph and its transient textures, once the frames
+ * executing it are done
+ */
+void candid_renderer_destroy_render_graph(Candid_Renderer *renderer,
+                                          Candid_RenderGraph *graph);
+
+/**
+ * Compile the declared graph and record its passes into the current frame.
+ * Like candid_renderer_cull, call it before the frame's first draw; passes
+ * drawing into the backbuffer begin the frame's render pass. The graph may
+ * be declared again as soon as this returns.
+ * @return CANDID_SUCCESS, or the declaration or compilation error (nothing
+ *         is recorded then)
+ */
+Candid_Result candid_renderer_execute_render_graph(Candid_Renderer *renderer,
+                                                   Candid_RenderGraph *graph);
+
+/*******************************************************************************
+ * Async Compute
+ ******************************************************************************/
+
+/**
+ * What async compute work records with, valid during its callback
+ */
+typedef struct Candid_ComputeContext {
+  const Candid_BackendInterface *backend;
+  Candid_Device *device;
+  Candid_CommandBuffer *cmd; /**< Compute, copy and barrier commands only */
+} Candid_ComputeContext;
+
+/**
+ * Record async compute work. Runs where the frame's command buffer lives
+ * (the render thread when threaded), so user data must stay valid until the
+ * frame completes.
+ */
+typedef void (*Candid_ComputeRecordFn)(const Candid_ComputeContext *context,
+                                       void *user_data);
+
+typedef enum Candid_AsyncComputeFlags {
+  /** Start once the previous frame's graphics work has completed, e.g. to
+   * read its depth pyramid or overwrite buffers it reads */
+  CANDID_ASYNC_COMPUTE_AFTER_GRAPHICS = 1 << 0,
+} Candid_AsyncComputeFlags;
+
+/**
+ * Submit compute work such as culling, particle simulation or light binning
+ * to the async compute queue, where it overlaps graphics work. The frame
+ * only sees its results after candid_renderer_wait_async_compute. Backends
+ * without async compute record it into the frame instead, in order. Like
+ * candid_renderer_cull, call it before the frame's first draw.
+ * @param flags Candid_AsyncComputeFlags
+ */
+Candid_Result candid_renderer_submit_async_compute(
+    Candid_Renderer *renderer, Candid_ComputeRecordFn record, void *user_data,
+    uint32_t flags);
+
+/**
+ * Make the frame's work recorded from now on wait for the async compute
+ * submitted so far. Call it before the frame's first draw.
+ */
+Candid_Result candid_renderer_wait_async_compute(Candid_Renderer *renderer);
+
 /*******************************************************************************
  * Camera / View Setup
  ******************************************************************************/
@@ -57,14 +57,40 @@ typedef struct Candid_ShaderCompileOptions {
   uint32_t define_count;
   const char **include_paths; /**< Include search paths */
   uint32_t include_path_count;
+  /** SPIRV, MSL (cross-compiled from SPIR-V) or DXIL (zero = SPIRV) */
+  Candid_ShaderSourceType target;
 } Candid_ShaderCompileOptions;
 
+/**
+ * On-disk cache of compiled shaders. Entries are keyed by a hash of the
+ * source, the files it includes, the compile options and the compiler
+ * version, so an unchanged shader is never compiled twice.
+ */
+typedef struct Candid_ShaderCacheDesc {
+  /** NULL = $CANDID_SHADER_CACHE_DIR, else candid_shader_cache in the
+   * temporary directory */
+  const char *directory;
+  uint64_t max_size; /**< Bytes kept before evicting the LRU (0 = 256 MiB) */
+  bool disabled;
+} Candid_ShaderCacheDesc;
+
 typedef struct Candid_ShaderBytecode {
   const void *data;
   size_t size;
   Candid_ShaderSourceType type;
 } Candid_ShaderBytecode;
 
+/**
+ * One compilation of candid_shader_compile_hlsl_batch
+ */
+typedef struct Candid_ShaderCompileJob {
+  const char *source;
+  size_t source_size; /**< 0 = null-terminated */
+  const Candid_ShaderCompileOptions *options;
+  Candid_ShaderBytecode bytecode; /**< Output, freed by the caller */
+  Candid_Result result;           /**< Output */
+} Candid_ShaderCompileJob;
+
 /*******************************************************************************
  * Shader Module (single stage)
  ******************************************************************************/
@@ -90,6 +116,8 @@ typedef struct Candid_ShaderProgramDesc {
   Candid_ShaderModule *vertex;
   Candid_ShaderModule *fragment;
   Candid_ShaderModule *compute;
+  /** Compute [numthreads], needed by Metal at dispatch (zero = 64x1x1) */
+  uint32_t workgroup_size[3];
   const char *label;
 } Candid_ShaderProgramDesc;
 
@@ -112,7 +140,10 @@ typedef enum Candid_UniformType {
   CANDID_UNIFORM_MAT4,
   CANDID_UNIFORM_SAMPLER,
   CANDID_UNIFORM_TEXTURE,
-  CANDID_UNIFORM_BUFFER,
+  CANDID_UNIFORM_BUFFER,         /**< Uniform (constant) buffer */
+  CANDID_UNIFORM_STORAGE_BUFFER, /**< Read-only or read-write buffer */
+  CANDID_UNIFORM_STORAGE_TEXTURE,
+  CANDID_UNIFORM_TEXTURE_SAMPLER, /**< Texture and sampler in one binding */
 } Candid_UniformType;
 
 typedef struct Candid_UniformDesc {
@@ -122,7 +153,7 @@ typedef struct Candid_UniformDesc {
   uint32_t set;              /**< Descriptor set (Vulkan) / space (DX12) */
   Candid_ShaderStage stages; /**< Which stages use this uniform */
   size_t size;               /**< Size in bytes (for buffers) */
-  uint32_t array_count;      /**< 1 for non-arrays */
+  uint32_t array_count;      /**< 1 for non-arrays, 0 for unbounded ones */
 } Candid_UniformDesc;
 
 /*******************************************************************************
@@ -133,10 +164,21 @@ typedef struct Candid_UniformDesc {
 #define CANDID_MAX_VERTEX_INPUTS 16
 #define CANDID_MAX_RENDER_TARGETS 8
 
+/**
+ * Interface of one compiled stage. Names point into the bytecode, so they
+ * are valid only as long as it is.
+ */
 typedef struct Candid_ShaderReflection {
+  Candid_ShaderStage stage;
+  uint32_t workgroup_size[3]; /**< Compute [numthreads] */
+
   Candid_UniformDesc uniforms[CANDID_MAX_UNIFORMS];
   uint32_t uniform_count;
 
+  /** Bytes [push_constant_offset, push_constant_offset + size) */
+  uint32_t push_constant_offset;
+  uint32_t push_constant_size; /**< 0 without push constants */
+
   struct {
     const char *name;
     Candid_VertexSemantic semantic;
@@ -146,6 +188,7 @@ typedef struct Candid_ShaderReflection {
   uint32_t vertex_input_count;
 
   struct {
+    /** Closest format to the output type; the attachment may differ */
     Candid_TextureFormat format;
     uint32_t location;
   } render_targets[CANDID_MAX_RENDER_TARGETS];
@@ -180,7 +223,9 @@ typedef enum Candid_BuiltinShader {
  ******************************************************************************/
 
 /**
- * Compile HLSL source to the target backend format
+ * Compile HLSL source to the target backend format. Results are kept in the
+ * shader cache (see candid_shader_cache_configure), and hits are mapped
+ * from disk without running the compiler.
  * @param source HLSL source code
  * @param source_size Length of source (0 = null-terminated)
  * @param options Compilation options
@@ -193,16 +238,40 @@ candid_shader_compile_hlsl(const char *source, size_t source_size,
                            const Candid_ShaderCompileOptions *options,
                            Candid_ShaderBytecode *out_bytecode);
 
+/**
+ * Compile many shaders concurrently. DXC runs in-process when its library
+ * is found, with one compiler per thread; the calling thread compiles too.
+ * @param jobs Sources and options in, bytecode and result out for each job
+ * @param thread_count Threads compiling, the caller's included (0 = one
+ *        per core)
+ * @return CANDID_SUCCESS if every job succeeded, else the first failing
+ *         job's result
+ */
+Candid_Result candid_shader_compile_hlsl_batch(Candid_ShaderCompileJob *jobs,
+                                               uint32_t job_count,
+                                               uint32_t thread_count);
+
+/**
+ * Configure the compiled shader cache used by candid_shader_compile_hlsl.
+ * Call before compiling; the cache is on with defaults otherwise.
+ * @return CANDID_SUCCESS, or CANDID_ERROR_RESOURCE_CREATION when the
+ *         directory cannot be created (the cache is then disabled)
+ */
+Candid_Result candid_shader_cache_configure(const Candid_ShaderCacheDesc *desc);
+
 /**
  * Free bytecode allocated by shader compilation
  */
 void candid_shader_free_bytecode(Candid_ShaderBytecode *bytecode);
 
 /**
- * Get reflection data from compiled shader
- * @param bytecode Compiled shader bytecode
+ * Get reflection data from compiled shader. SPIR-V is parsed directly, with
+ * no external library.
+ * @param bytecode Compiled shader bytecode (SPIRV)
  * @param out_reflection Output reflection data
- * @return CANDID_SUCCESS on success
+ * @return CANDID_SUCCESS, CANDID_ERROR_BACKEND_NOT_SUPPORTED for other
+ *         bytecode types, or CANDID_ERROR_INVALID_ARGUMENT for malformed
+ *         SPIR-V or interfaces over the CANDID_MAX_* limits
  */
 Candid_Result candid_shader_reflect(const Candid_ShaderBytecode *bytecode,
                                     Candid_ShaderReflection *out_reflection);
@@ -0,0 +1,91 @@
+/**
+ * @file shader_permutation.h
+ * @brief Shader permutations compiled lazily on background threads
+ *
+ * A permutation set holds the variants of one vertex/fragment program pair,
+ * keyed by a bitmask of features each variant is compiled with. Every
+ * feature is passed to the compiler as a 0/1 define, so the shader selects
+ * code with `#if` (see the feature block of shaders/standard.hlsl).
+ *
+ * Only the fallback variant is compiled when the set is created. Any other
+ * variant is queued for the set's worker threads the first time it is asked
+ * for, and the fallback is drawn with until it is ready, so new variants
+ * neither stall frames nor have to be compiled up front. A variant that
+ * fails to compile keeps resolving to the fallback.
+ *
+ * Sets are created with candid_renderer_create_shader_permutations, and
+ * need runtime shader compilation (CANDID_SHADER_COMPILATION).
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <candid/shader.h>
+#include <candid/types.h>
+
+/** Features of shaders/standard.hlsl, in mask order */
+typedef enum Candid_ShaderFeature {
+  CANDID_SHADER_FEATURE_ALPHA_MASK = 1 << 0,   /**< CANDID_ALPHA_MASK */
+  CANDID_SHADER_FEATURE_NORMAL_MAP = 1 << 1,   /**< CANDID_NORMAL_MAP */
+  CANDID_SHADER_FEATURE_SKINNING = 1 << 2,     /**< CANDID_SKINNING */
+  CANDID_SHADER_FEATURE_VERTEX_COLOR = 1 << 3, /**< CANDID_VERTEX_COLOR */
+  CANDID_SHADER_FEATURE_EMISSIVE = 1 << 4,     /**< CANDID_EMISSIVE */
+} Candid_ShaderFeature;
+
+#define CANDID_SHADER_FEATURE_COUNT 5
+
+/** Features per set; a set addresses 1 << feature_count variants */
+#define CANDID_MAX_SHADER_FEATURES 8
+
+typedef struct Candid_ShaderPermutationDesc {
+  const char *source; /**< HLSL source of both stages */
+  size_t source_size; /**< Length of source (0 = null-terminated) */
+  const char *vertex_entry;
+  const char *fragment_entry;
+  const char *vertex_profile;   /**< NULL = "vs_6_0" */
+  const char *fragment_profile; /**< NULL = "ps_6_0" */
+  const char **include_paths;   /**< Where the source's #includes live */
+  uint32_t include_path_count;
+  /** Define of each feature bit (NULL = the standard.hlsl names) */
+  const char *const *feature_defines;
+  uint32_t feature_count; /**< 0 = CANDID_SHADER_FEATURE_COUNT */
+  uint32_t fallback_features; /**< Variant compiled up front */
+  uint32_t worker_count;      /**< 0 = half the cores; at most 4 */
+  const char *label;
+} Candid_ShaderPermutationDesc;
+
+typedef struct Candid_ShaderPermutations Candid_ShaderPermutations;
+
+/**
+ * Get the program of a variant, queueing its compilation on first use
+ * @param features Feature bits (bits past the set's features are ignored)
+ * @return The variant's program once compiled, the fallback until then
+ */
+Candid_ShaderProgram *
+candid_shader_permutations_get(Candid_ShaderPermutations *permutations,
+                               uint32_t features);
+
+/**
+ * Queue a variant without waiting for it, e.g. for materials about to load
+ */
+void candid_shader_permutations_request(
+    Candid_ShaderPermutations *permutations, uint32_t features);
+
+/**
+ * Whether a variant is compiled (false when queued, compiling or failed)
+ */
+bool candid_shader_permutations_is_ready(
+    const Candid_ShaderPermutations *permutations, uint32_t features);
+
+/**
+ * Number of variants queued or compiling
+ */
+uint32_t candid_shader_permutations_get_pending(
+    const Candid_ShaderPermutations *permutations);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,210 @@
+/**
+ * @file transform.h
+ * @brief Transform hierarchy store (local TRS -> world matrices)
+ *
+ * Transforms live in structure-of-arrays storage kept sorted by hierarchy
+ * depth, so world matrices can be propagated level by level: every node of a
+ * level only depends on the level above it, and each level is split across
+ * worker threads. Only nodes whose local transform (or an ancestor's) changed
+ * since the last update are recomputed.
+ *
+ * Handles are stable for the lifetime of a node. Their low bits are a dense
+ * index that doubles as an instance index: when an output array is bound
+ * (typically mapped GPU memory feeding an instance or uniform buffer), the
+ * world matrix of node `h` is written directly to
+ * `output[CANDID_TRANSFORM_INDEX(h)]` during the update. The high bits are a
+ * generation, so a handle kept after its node was destroyed is ignored
+ * instead of reaching the node that reuses its index.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <candid/types.h>
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+typedef struct Candid_Transform {
+  Candid_Vec3 position;
+  Candid_Quat rotation; /**< Unit quaternion */
+  Candid_Vec3 scale;
+} Candid_Transform;
+
+typedef uint32_t Candid_TransformHandle;
+
+#define CANDID_TRANSFORM_INVALID UINT32_MAX
+#define CANDID_TRANSFORM_INDEX_BITS 24
+#define CANDID_TRANSFORM_INDEX_MASK ((1u << CANDID_TRANSFORM_INDEX_BITS) - 1)
+/** Dense index of a handle, its position in bound output arrays */
+#define CANDID_TRANSFORM_INDEX(handle)                                         \
+  ((handle) & CANDID_TRANSFORM_INDEX_MASK)
+
+typedef struct Candid_TransformStoreDesc {
+  uint32_t initial_capacity; /**< Number of nodes to reserve (0 = default) */
+  uint32_t worker_count;     /**< Worker threads (0 = one per extra core) */
+  bool single_threaded;      /**< Update on the calling thread only */
+} Candid_TransformStoreDesc;
+
+typedef struct Candid_TransformStore Candid_TransformStore;
+
+/*******************************************************************************
+ * Store Lifecycle
+ ******************************************************************************/
+
+/**
+ * Create a transform store
+ * @param desc Store description (NULL = defaults)
+ * @param out Output store handle
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result
+candid_transform_store_create(const Candid_TransformStoreDesc *desc,
+                              Candid_TransformStore **out);
+
+/**
+ * Destroy a transform store and all of its nodes
+ */
+void candid_transform_store_destroy(Candid_TransformStore *store);
+
+/**
+ * Number of live nodes
+ */
+uint32_t candid_transform_store_get_count(const Candid_TransformStore *store);
+
+/**
+ * Upper bound (exclusive) of the handle indices currently in use. Output
+ * arrays must hold at least this many matrices.
+ */
+uint32_t
+candid_transform_store_get_handle_range(const Candid_TransformStore *store);
+
+/*******************************************************************************
+ * Nodes
+ ******************************************************************************/
+
+/**
+ * Create a node
+ * @param store Transform store
+ * @param parent Parent node (CANDID_TRANSFORM_INVALID = root)
+ * @param local Local transform (NULL = identity)
+ * @param out Output node handle
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result candid_transform_create(Candid_TransformStore *store,
+                                      Candid_TransformHandle parent,
+                                      const Candid_Transform *local,
+                                      Candid_TransformHandle *out);
+
+/**
+ * Destroy a node. Its children are re-attached to its parent. Costs the
+ * number of children; destroyed slots are compacted by a later update.
+ */
+void candid_transform_destroy(Candid_TransformStore *store,
+                              Candid_TransformHandle handle);
+
+/**
+ * Change the parent of a node (CANDID_TRANSFORM_INVALID = make it a root)
+ * @return CANDID_ERROR_INVALID_ARGUMENT if it would create a cycle
+ */
+Candid_Result candid_transform_set_parent(Candid_TransformStore *store,
+                                          Candid_TransformHandle handle,
+                                          Candid_TransformHandle parent);
+
+/**
+ * Get the parent of a node (CANDID_TRANSFORM_INVALID for roots)
+ */
+Candid_TransformHandle
+candid_transform_get_parent(const Candid_TransformStore *store,
+                            Candid_TransformHandle handle);
+
+/**
+ * Set the whole local transform of a node
+ */
+void candid_transform_set_local(Candid_TransformStore *store,
+                                Candid_TransformHandle handle,
+                                const Candid_Transform *local);
+
+/**
+ * Get the local transform of a node
+ */
+Candid_Transform candid_transform_get_local(const Candid_TransformStore *store,
+                                            Candid_TransformHandle handle);
+
+void candid_transform_set_position(Candid_TransformStore *store,
+                                   Candid_TransformHandle handle,
+                                   Candid_Vec3 position);
+
+void candid_transform_set_rotation(Candid_TransformStore *store,
+                                   Candid_TransformHandle handle,
+                                   Candid_Quat rotation);
+
+void candid_transform_set_scale(Candid_TransformStore *store,
+                                Candid_TransformHandle handle,
+                                Candid_Vec3 scale);
+
+/**
+ * Get the world matrix computed by the last candid_transform_store_update.
+ * The pointer is only valid until the next candid_transform_create,
+ * candid_transform_set_parent, candid_transform_destroy or
+ * candid_transform_store_update, which may grow or re-sort the storage.
+ */
+const Candid_Mat4 *
+candid_transform_get_world(const Candid_TransformStore *store,
+                           Candid_TransformHandle handle);
+
+/*******************************************************************************
+ * Update
+ ******************************************************************************/
+
+/**
+ * Bind an array that receives world matrices, indexed by the
+ * CANDID_TRANSFORM_INDEX of each handle. Every live node is written on the
+ * next update, then only the nodes that changed.
+ * @param store Transform store
+ * @param output Destination (e.g. mapped instance buffer), NULL to unbind
+ * @param capacity Number of matrices the destination can hold
+ */
+void candid_transform_store_bind_output(Candid_TransformStore *store,
+                                        Candid_Mat4 *output,
+                                        uint32_t capacity);
+
+/**
+ * Propagate dirty local transforms to world matrices
+ * @param store Transform store
+ * @return Number of world matrices recomputed
+ */
+uint32_t candid_transform_store_update(Candid_TransformStore *store);
+
+/*******************************************************************************
+ * Math Helpers
+ ******************************************************************************/
+
+/**
+ * Identity transform (zero translation, identity rotation, unit scale)
+ */
+Candid_Transform candid_transform_identity(void);
+
+/**
+ * Quaternion from a normalized axis and an angle in radians
+ */
+Candid_Quat candid_quat_from_axis_angle(Candid_Vec3 axis, float angle);
+
+/**
+ * Quaternion product a * b (applies b first, then a)
+ */
+Candid_Quat candid_quat_multiply(Candid_Quat a, Candid_Quat b);
+
+/**
+ * Compose translation * rotation * scale into a column-major matrix
+ */
+void candid_transform_to_mat4(const Candid_Transform *transform,
+                              Candid_Mat4 *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -57,6 +57,10 @@ typedef struct Candid_Vec4 {
   float x, y, z, w;
 } Candid_Vec4;
 
+typedef struct Candid_Quat {
+  float x, y, z, w; /**< Unit quaternion, w = scalar part */
+} Candid_Quat;
+
 typedef struct Candid_Mat4 {
   float m[16]; /**< Column-major order */
 } Candid_Mat4;
@@ -76,6 +80,7 @@ typedef enum Candid_BufferUsage {
   CANDID_BUFFER_USAGE_STORAGE = 1 << 3,
   CANDID_BUFFER_USAGE_TRANSFER_SRC = 1 << 4,
   CANDID_BUFFER_USAGE_TRANSFER_DST = 1 << 5,
+  CANDID_BUFFER_USAGE_INDIRECT = 1 << 6, /**< Indirect draw arguments */
 } Candid_BufferUsage;
 
 typedef enum Candid_BufferMemory {
@@ -107,6 +112,7 @@ typedef enum Candid_TextureFormat {
   CANDID_TEXTURE_FORMAT_RGBA32_FLOAT,
   CANDID_TEXTURE_FORMAT_DEPTH32_FLOAT,
   CANDID_TEXTURE_FORMAT_DEPTH24_STENCIL8,
+  CANDID_TEXTURE_FORMAT_R32_FLOAT,
 } Candid_TextureFormat;
 
 typedef enum Candid_TextureUsage {
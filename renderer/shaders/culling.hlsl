@@ -0,0 +1,146 @@
+/**
+ * @file culling.hlsl
+ * @brief GPU frustum and occlusion culling for Candid Engine
+ *
+ * One thread per object: the object's local bounding sphere is transformed by
+ * its instance record, tested against the frustum planes and, optionally,
+ * against the previous frame's max-depth pyramid. Survivors are appended to
+ * an indirect argument buffer (Candid_DrawIndexedIndirectCommand) and counted
+ * in DrawCount. See candid/culling.h.
+ *
+ * Bindings match the slots used by candid_renderer_cull (and the Metal
+ * kernel built into the Metal backend):
+ *   0 CullParams, 1 Objects, 2 Args, 3 InstanceParams, 4 DrawCount,
+ *   5 DepthPyramid, 8 Instances
+ *
+ * Compilation example:
+ *   dxc -T cs_6_0 -E CSCullInstances -Fo culling.spv -spirv culling.hlsl
+ */
+
+#include "instancing.hlsl"
+
+//=============================================================================
+// Resources
+//=============================================================================
+
+[[vk::binding(0)]]
+cbuffer CullParams : register(b0) {
+    float4 Planes[6];
+    float4x4 OcclusionViewProjection; // Previous frame
+    uint ObjectCount;
+    uint InstanceFormat;
+    uint Occlusion;
+    uint CullPadding;
+};
+
+struct CullObject {
+    float4 Sphere; // Local center, radius
+    uint IndexCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint Padding;
+};
+
+[[vk::binding(1)]] StructuredBuffer<CullObject> Objects : register(t0);
+[[vk::binding(2)]] RWByteAddressBuffer Args : register(u0);
+[[vk::binding(4)]] RWByteAddressBuffer DrawCount : register(u1);
+[[vk::binding(5)]] Texture2D<float> DepthPyramid : register(t1);
+
+#define CULL_GROUP_SIZE 64
+#define DRAW_ARGS_SIZE 20
+
+//=============================================================================
+// Helpers
+//=============================================================================
+
+float4x4 LoadInstance(uint index) {
+    switch (InstanceFormat) {
+    case CANDID_INSTANCE_FORMAT_AFFINE:
+        return DecodeInstanceAffine(index);
+    case CANDID_INSTANCE_FORMAT_QUAT_TRS:
+        return DecodeInstanceQuatTRS(index);
+    case CANDID_INSTANCE_FORMAT_QUANTIZED:
+        return DecodeInstanceQuantized(index);
+    default:
+        return DecodeInstanceMat4(index);
+    }
+}
+
+// Project the sphere's bounding box and compare its nearest depth with the
+// farthest depth stored in the pyramid texels covering it. The mip is chosen
+// so the box spans at most 2x2 texels.
+bool IsOccluded(float3 center, float radius) {
+    float2 uvMin = 1.0;
+    float2 uvMax = 0.0;
+    float nearest = 1.0;
+
+    [unroll]
+    for (uint i = 0; i < 8; ++i) {
+        float3 corner = center + radius * float3((i & 1) ? 1.0 : -1.0,
+                                                 (i & 2) ? 1.0 : -1.0,
+                                                 (i & 4) ? 1.0 : -1.0);
+        float4 clip = mul(OcclusionViewProjection, float4(corner, 1.0));
+        if (clip.w <= 0.0)
+            return false; // Crosses the camera plane
+        float3 ndc = clip.xyz / clip.w;
+        float2 uv = float2(ndc.x * 0.5 + 0.5, 0.5 - ndc.y * 0.5);
+        uvMin = min(uvMin, uv);
+        uvMax = max(uvMax, uv);
+        nearest = min(nearest, ndc.z);
+    }
+    uvMin = saturate(uvMin);
+    uvMax = saturate(uvMax);
+
+    uint width, height, levels;
+    DepthPyramid.GetDimensions(0, width, height, levels);
+    float2 extent = (uvMax - uvMin) * float2(width, height);
+    uint level = (uint)ceil(log2(max(max(extent.x, extent.y), 1.0)));
+    level = min(level, levels - 1);
+
+    uint2 size = max(uint2(width, height) >> level, 1u);
+    uint2 a = min(uint2(uvMin * float2(size)), size - 1);
+    uint2 b = min(uint2(uvMax * float2(size)), size - 1);
+    float depth = max(
+        max(DepthPyramid.Load(int3(a, level)),
+            DepthPyramid.Load(int3(b.x, a.y, level))),
+        max(DepthPyramid.Load(int3(a.x, b.y, level)),
+            DepthPyramid.Load(int3(b, level))));
+
+    return nearest > depth;
+}
+
+//=============================================================================
+// Kernel
+//=============================================================================
+
+[numthreads(CULL_GROUP_SIZE, 1, 1)]
+void CSCullInstances(uint3 id : SV_DispatchThreadID) {
+    uint index = id.x;
+    if (index >= ObjectCount)
+        return;
+
+    CullObject object = Objects[index];
+    float4x4 model = LoadInstance(index);
+
+    float3 center = mul(model, float4(object.Sphere.xyz, 1.0)).xyz;
+    float scale = max(length(model._m00_m10_m20),
+                      max(length(model._m01_m11_m21),
+                          length(model._m02_m12_m22)));
+    float radius = object.Sphere.w * scale;
+
+    [unroll]
+    for (uint i = 0; i < 6; ++i) {
+        if (dot(Planes[i].xyz, center) + Planes[i].w < -radius)
+            return;
+    }
+
+    if (Occlusion != 0 && IsOccluded(center, radius))
+        return;
+
+    uint slot;
+    DrawCount.InterlockedAdd(0, 1, slot);
+    Args.Store4(slot * DRAW_ARGS_SIZE,
+                uint4(object.IndexCount, 1, object.FirstIndex,
+                      asuint(object.VertexOffset)));
+    Args.Store(slot * DRAW_ARGS_SIZE + 16, index);
+}
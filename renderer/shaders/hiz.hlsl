@@ -0,0 +1,161 @@
+/**
+ * @file hiz.hlsl
+ * @brief Single-pass hierarchical-Z (max depth) pyramid for Candid Engine
+ *
+ * Builds every mip of the depth pyramid in one dispatch. Pyramid level 0 has
+ * the power-of-two size at or below the depth buffer, so each of its texels
+ * covers up to 3x3 depth texels; every further level keeps the maximum of the
+ * 2x2 texels below it. Greater depth is farther, so a pyramid texel is the
+ * farthest depth anything under it may have.
+ *
+ * Each 16x16 workgroup reduces a 32x32 tile of level 0 down to level 5 in
+ * registers and groupshared memory and stores its level 5 texel in Scratch.
+ * The last workgroup to finish (counted in the first Scratch word, cleared
+ * before the dispatch) reduces the remaining levels from Scratch.
+ *
+ * Bindings match the renderer's depth pyramid pass (and the Metal kernel
+ * built into the Metal backend):
+ *   0 DepthBuffer, 1 Pyramid (one image per level), 2 Scratch
+ *
+ * Compilation example:
+ *   dxc -T cs_6_0 -E CSDownsampleDepth -Fo hiz.spv -spirv hiz.hlsl
+ */
+
+//=============================================================================
+// Resources
+//=============================================================================
+
+#define HIZ_MAX_LEVELS 16
+#define HIZ_GROUP_SIZE 16
+#define HIZ_TILE 32         // Level 0 texels per workgroup side
+#define HIZ_GROUP_LEVELS 6  // Levels 0-5 are reduced within a workgroup
+
+[[vk::binding(0)]] Texture2D<float> DepthBuffer : register(t0);
+[[vk::binding(1)]] RWTexture2D<float> Pyramid[HIZ_MAX_LEVELS] : register(u0);
+[[vk::binding(2)]] globallycoherent RWByteAddressBuffer Scratch
+    : register(u16);
+
+groupshared float Tile[HIZ_GROUP_SIZE][HIZ_GROUP_SIZE];
+groupshared uint IsLastGroup;
+
+//=============================================================================
+// Helpers
+//=============================================================================
+
+uint2 LevelSize(uint2 baseSize, uint level) {
+    return max(baseSize >> level, 1u);
+}
+
+// Farthest depth under a level 0 texel
+float LoadDepthMax(uint2 texel, uint2 depthSize, uint2 baseSize) {
+    uint2 first = texel * depthSize / baseSize;
+    uint2 last = min(((texel + 1) * depthSize + baseSize - 1) / baseSize,
+                     depthSize) - 1;
+    float depth = 0.0;
+    for (uint y = first.y; y <= last.y; ++y) {
+        for (uint x = first.x; x <= last.x; ++x) {
+            depth = max(depth, DepthBuffer.Load(int3(x, y, 0)));
+        }
+    }
+    return depth;
+}
+
+float LoadScratch(uint offset, uint2 size, uint2 texel) {
+    return asfloat(Scratch.Load(offset + 4 * (texel.y * size.x + texel.x)));
+}
+
+//=============================================================================
+// Kernel
+//=============================================================================
+
+[numthreads(HIZ_GROUP_SIZE, HIZ_GROUP_SIZE, 1)]
+void CSDownsampleDepth(uint3 groupId : SV_GroupID,
+                       uint3 localId : SV_GroupThreadID,
+                       uint localIndex : SV_GroupIndex) {
+    uint2 depthSize;
+    DepthBuffer.GetDimensions(depthSize.x, depthSize.y);
+    uint2 baseSize;
+    Pyramid[0].GetDimensions(baseSize.x, baseSize.y);
+    uint levels = min(firstbithigh(max(baseSize.x, baseSize.y)) + 1,
+                      HIZ_MAX_LEVELS);
+    uint2 groups = (baseSize + HIZ_TILE - 1) / HIZ_TILE;
+
+    // Levels 0 and 1: each thread owns a 2x2 block of level 0
+    uint2 texel1 = groupId.xy * (HIZ_TILE / 2) + localId.xy;
+    float depth = 0.0;
+    [unroll]
+    for (uint i = 0; i < 4; ++i) {
+        uint2 texel0 = texel1 * 2 + uint2(i & 1, i >> 1);
+        if (all(texel0 < baseSize)) {
+            float d = LoadDepthMax(texel0, depthSize, baseSize);
+            Pyramid[0][texel0] = d;
+            depth = max(depth, d);
+        }
+    }
+    if (levels > 1 && all(texel1 < LevelSize(baseSize, 1)))
+        Pyramid[1][texel1] = depth;
+    Tile[localId.y][localId.x] = depth;
+
+    // Levels 2-5 from groupshared memory
+    uint size = HIZ_GROUP_SIZE;
+    [unroll]
+    for (uint level = 2; level < HIZ_GROUP_LEVELS; ++level) {
+        GroupMemoryBarrierWithGroupSync();
+        size /= 2;
+        bool active = all(localId.xy < size);
+        if (active) {
+            uint2 s = localId.xy * 2;
+            depth = max(max(Tile[s.y][s.x], Tile[s.y][s.x + 1]),
+                        max(Tile[s.y + 1][s.x], Tile[s.y + 1][s.x + 1]));
+        }
+        GroupMemoryBarrierWithGroupSync();
+        if (active) {
+            Tile[localId.y][localId.x] = depth;
+            uint2 texel = groupId.xy * size + localId.xy;
+            if (level < levels && all(texel < LevelSize(baseSize, level)))
+                Pyramid[level][texel] = depth;
+        }
+    }
+
+    if (levels <= HIZ_GROUP_LEVELS)
+        return;
+
+    // Publish this group's level 5 texel, then let the last group finish
+    uint2 srcSize = LevelSize(baseSize, HIZ_GROUP_LEVELS - 1);
+    uint srcOffset = 4;
+    if (localIndex == 0) {
+        Scratch.Store(srcOffset + 4 * (groupId.y * srcSize.x + groupId.x),
+                      asuint(depth));
+        DeviceMemoryBarrier();
+        uint done;
+        Scratch.InterlockedAdd(0, 1, done);
+        IsLastGroup = done == groups.x * groups.y - 1 ? 1 : 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    if (IsLastGroup == 0)
+        return;
+    DeviceMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint level = HIZ_GROUP_LEVELS; level < HIZ_MAX_LEVELS; ++level) {
+        if (level >= levels)
+            break;
+        uint2 dstSize = LevelSize(baseSize, level);
+        uint dstOffset = srcOffset + 4 * srcSize.x * srcSize.y;
+        for (uint i = localIndex; i < dstSize.x * dstSize.y;
+             i += HIZ_GROUP_SIZE * HIZ_GROUP_SIZE) {
+            uint2 texel = uint2(i % dstSize.x, i / dstSize.x);
+            uint2 a = min(texel * 2, srcSize - 1);
+            uint2 b = min(texel * 2 + 1, srcSize - 1);
+            float d = max(max(LoadScratch(srcOffset, srcSize, a),
+                              LoadScratch(srcOffset, srcSize, uint2(b.x, a.y))),
+                          max(LoadScratch(srcOffset, srcSize, uint2(a.x, b.y)),
+                              LoadScratch(srcOffset, srcSize, b)));
+            Pyramid[level][texel] = d;
+            Scratch.Store(dstOffset + 4 * i, asuint(d));
+        }
+        DeviceMemoryBarrierWithGroupSync();
+        srcOffset = dstOffset;
+        srcSize = dstSize;
+    }
+}
@@ -0,0 +1,112 @@
+/**
+ * @file instancing.hlsl
+ * @brief Instance record decoding for Candid Engine
+ *
+ * Mirrors the formats declared in candid/instance.h. Instance data is bound
+ * as a raw buffer and addressed with SV_InstanceID, so one shader can read any
+ * format; define CANDID_INSTANCE_FORMAT to a constant to compile a variant
+ * with a single decode path:
+ *   0 = float4x4 (64 bytes)
+ *   1 = 3x4 affine rows (48 bytes)
+ *   2 = quaternion + translation + uniform scale (32 bytes)
+ *   3 = quantized (16 bytes)
+ *
+ * Compilation example:
+ *   dxc -T vs_6_0 -E VSMainInstanced -D CANDID_INSTANCE_FORMAT=3 -spirv ...
+ */
+
+#ifndef CANDID_INSTANCING_HLSL
+#define CANDID_INSTANCING_HLSL
+
+#ifndef CANDID_INSTANCE_FORMAT
+#define CANDID_INSTANCE_FORMAT 0
+#endif
+
+#define CANDID_INSTANCE_FORMAT_MAT4      0
+#define CANDID_INSTANCE_FORMAT_AFFINE    1
+#define CANDID_INSTANCE_FORMAT_QUAT_TRS  2
+#define CANDID_INSTANCE_FORMAT_QUANTIZED 3
+
+//=============================================================================
+// Resources
+//=============================================================================
+
+ByteAddressBuffer Instances : register(t8);
+
+// Only read by the quantized format (Candid_InstanceQuantization)
+cbuffer InstanceParams : register(b3) {
+    float3 InstanceOrigin;
+    float InstanceMaxScale;
+    float3 InstanceExtent;
+    float InstancePadding;
+};
+
+//=============================================================================
+// Decoding
+//=============================================================================
+
+// Build translation * rotation * uniform scale (column vectors, as mul(M, v))
+float4x4 ComposeTRS(float4 q, float3 t, float s) {
+    float3 q2 = q.xyz * 2.0;
+    float xx = q.x * q2.x, yy = q.y * q2.y, zz = q.z * q2.z;
+    float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+    float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+
+    return float4x4(
+        (1.0 - yy - zz) * s, (xy - wz) * s,       (xz + wy) * s,       t.x,
+        (xy + wz) * s,       (1.0 - xx - zz) * s, (yz - wx) * s,       t.y,
+        (xz - wy) * s,       (yz + wx) * s,       (1.0 - xx - yy) * s, t.z,
+        0.0,                 0.0,                 0.0,                 1.0);
+}
+
+// Candid_Mat4 is column-major: each 16-byte load is one column
+float4x4 DecodeInstanceMat4(uint index) {
+    uint address = index * 64;
+    float4 c0 = asfloat(Instances.Load4(address));
+    float4 c1 = asfloat(Instances.Load4(address + 16));
+    float4 c2 = asfloat(Instances.Load4(address + 32));
+    float4 c3 = asfloat(Instances.Load4(address + 48));
+    return transpose(float4x4(c0, c1, c2, c3));
+}
+
+float4x4 DecodeInstanceAffine(uint index) {
+    uint address = index * 48;
+    float4 r0 = asfloat(Instances.Load4(address));
+    float4 r1 = asfloat(Instances.Load4(address + 16));
+    float4 r2 = asfloat(Instances.Load4(address + 32));
+    return float4x4(r0, r1, r2, float4(0.0, 0.0, 0.0, 1.0));
+}
+
+float4x4 DecodeInstanceQuatTRS(uint index) {
+    uint address = index * 32;
+    float4 rotation = asfloat(Instances.Load4(address));
+    float4 position_scale = asfloat(Instances.Load4(address + 16));
+    return ComposeTRS(rotation, position_scale.xyz, position_scale.w);
+}
+
+float4x4 DecodeInstanceQuantized(uint index) {
+    uint4 raw = Instances.Load4(index * 16);
+
+    // position.xy | position.z, scale | rotation.xy | rotation.zw
+    float4 unorm = float4(raw.x & 0xFFFF, raw.x >> 16,
+                          raw.y & 0xFFFF, raw.y >> 16) / 65535.0;
+    int4 snorm = asint(uint4(raw.z << 16, raw.z, raw.w << 16, raw.w)) >> 16;
+    float4 q = normalize(max(float4(snorm) / 32767.0, -1.0));
+
+    float3 position = InstanceOrigin + unorm.xyz * InstanceExtent;
+    return ComposeTRS(q, position, unorm.w * InstanceMaxScale);
+}
+
+float4x4 DecodeInstance(uint index) {
+#if CANDID_INSTANCE_FORMAT == CANDID_INSTANCE_FORMAT_AFFINE
+    return DecodeInstanceAffine(index);
+#elif CANDID_INSTANCE_FORMAT == CANDID_INSTANCE_FORMAT_QUAT_TRS
+    return DecodeInstanceQuatTRS(index);
+#elif CANDID_INSTANCE_FORMAT == CANDID_INSTANCE_FORMAT_QUANTIZED
+    return DecodeInstanceQuantized(index);
+#else
+    return DecodeInstanceMat4(index);
+#endif
+}
+
+#endif // CANDID_INSTANCING_HLSL
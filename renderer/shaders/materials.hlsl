@@ -0,0 +1,106 @@
+/**
+ * @file materials.hlsl
+ * @brief Bindless texture and material tables for Candid Engine
+ *
+ * Mirrors Candid_MaterialRecord in candid/material.h. In bindless mode
+ * (Candid_RendererConfig::bindless) every sampled texture lives in one
+ * descriptor array and every material in one 64-byte record of a storage
+ * buffer; both are bound once per render pass. A draw only selects its
+ * record with MaterialIndex, whose texture indices point into the array.
+ *
+ * Bindings:
+ *   Vulkan  set 1: 0 = textures, 1 = sampler, 2 = records,
+ *           MaterialIndex in a 4-byte fragment push constant
+ *   Metal   fragment slots 15 = sampler, 16 = textures (MTLResourceID
+ *           array), 17 = records, 18 = MaterialIndex
+ *
+ * Compilation example:
+ *   dxc -T ps_6_6 -E PSMainBindless -Fo standard_bindless_ps.spv -spirv ...
+ */
+
+#ifndef CANDID_MATERIALS_HLSL
+#define CANDID_MATERIALS_HLSL
+
+#define CANDID_MATERIAL_RECORD_SIZE 64
+#define CANDID_MATERIAL_NO_TEXTURE 0xFFFF
+
+#define CANDID_MATERIAL_FLAG_ALPHA_MASK          0x01
+#define CANDID_MATERIAL_FLAG_ALPHA_BLEND         0x02
+#define CANDID_MATERIAL_FLAG_DOUBLE_SIDED        0x04
+#define CANDID_MATERIAL_FLAG_UNLIT               0x08
+#define CANDID_MATERIAL_FLAG_SPECULAR_GLOSSINESS 0x10
+
+//=============================================================================
+// Resources
+//=============================================================================
+
+Texture2D BindlessTextures[] : register(t0, space1);
+SamplerState BindlessSampler : register(s1, space1);
+ByteAddressBuffer MaterialRecords : register(t2, space1);
+
+#ifdef __spirv__
+struct MaterialConstants {
+    uint Index;
+};
+[[vk::push_constant]] MaterialConstants MaterialConstant;
+#define MaterialIndex MaterialConstant.Index
+#else
+cbuffer PerDraw : register(b4) {
+    uint MaterialIndex;
+};
+#endif
+
+//=============================================================================
+// Records
+//=============================================================================
+
+struct MaterialRecord {
+    float4 BaseColor;        // Diffuse factor for specular-glossiness
+    float3 Emissive;
+    float AlphaCutoff;
+    float4 Pbr;              // (metallic, roughness) or (specular, glossiness)
+    float NormalScale;
+    float OcclusionStrength;
+    uint BaseColorTexture;   // Diffuse texture for specular-glossiness
+    uint PbrTexture;         // Metallic-roughness or specular-glossiness
+    uint NormalTexture;
+    uint OcclusionTexture;
+    uint EmissiveTexture;
+    uint Flags;
+};
+
+MaterialRecord LoadMaterial(uint index) {
+    uint address = index * CANDID_MATERIAL_RECORD_SIZE;
+    uint4 words = MaterialRecords.Load4(address + 48);
+
+    MaterialRecord m;
+    m.BaseColor = asfloat(MaterialRecords.Load4(address));
+    float4 emissive = asfloat(MaterialRecords.Load4(address + 16));
+    m.Emissive = emissive.xyz;
+    m.AlphaCutoff = emissive.w;
+    m.Pbr = asfloat(MaterialRecords.Load4(address + 32));
+    m.NormalScale = f16tof32(words.x);
+    m.OcclusionStrength = f16tof32(words.x >> 16);
+    m.BaseColorTexture = words.y & 0xFFFF;
+    m.PbrTexture = words.y >> 16;
+    m.NormalTexture = words.z & 0xFFFF;
+    m.OcclusionTexture = words.z >> 16;
+    m.EmissiveTexture = words.w & 0xFFFF;
+    m.Flags = words.w >> 16;
+    return m;
+}
+
+bool HasMaterialFlag(MaterialRecord m, uint flag) {
+    return (m.Flags & flag) != 0;
+}
+
+// `fallback` is returned for CANDID_MATERIAL_NO_TEXTURE. Indices may differ
+// between pixels of a wave once draws are merged, hence NonUniformResourceIndex.
+float4 SampleBindless(uint texture, float2 uv, float4 fallback) {
+    if (texture == CANDID_MATERIAL_NO_TEXTURE)
+        return fallback;
+    return BindlessTextures[NonUniformResourceIndex(texture)]
+        .Sample(BindlessSampler, uv);
+}
+
+#endif // CANDID_MATERIALS_HLSL
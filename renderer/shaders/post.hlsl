@@ -0,0 +1,114 @@
+/**
+ * @file post.hlsl
+ * @brief Full-screen post-processing passes for Candid Engine
+ *
+ * Every pass draws one triangle covering the screen (3 vertices, no vertex
+ * buffer) and reads the previous pass's output from SourceTexture.
+ *
+ * Compilation examples:
+ *   dxc -T vs_6_0 -E VSFullscreen -Fo post_vs.spv -spirv post.hlsl
+ *   dxc -T ps_6_0 -E PSTonemap -Fo tonemap_ps.spv -spirv post.hlsl
+ *   dxc -T ps_6_0 -E PSFxaa -Fo fxaa_ps.spv -spirv post.hlsl
+ */
+
+#ifndef CANDID_POST_HLSL
+#define CANDID_POST_HLSL
+
+//=============================================================================
+// Resources
+//=============================================================================
+
+cbuffer PostParams : register(b3) {
+    float2 InvResolution;  // 1 / source size in pixels
+    float Exposure;        // Tone mapping only
+    float PostPadding;
+};
+
+Texture2D<float4> SourceTexture : register(t0);
+SamplerState LinearClampSampler : register(s1);
+
+//=============================================================================
+// Vertex Shader
+//=============================================================================
+
+struct FullscreenOutput {
+    float4 Position : SV_Position;
+    float2 TexCoord : TEXCOORD0;
+};
+
+FullscreenOutput VSFullscreen(uint vertexID : SV_VertexID) {
+    FullscreenOutput output;
+    float2 uv = float2((vertexID << 1) & 2, vertexID & 2);
+    output.Position = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+    output.TexCoord = uv;
+    return output;
+}
+
+//=============================================================================
+// Tone Mapping
+//=============================================================================
+
+// ACES filmic fit (Narkowicz 2015)
+float3 TonemapACES(float3 x) {
+    return saturate((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14));
+}
+
+// HDR to display: exposure, filmic curve, gamma. Luma goes to alpha for FXAA.
+float4 PSTonemap(FullscreenOutput input) : SV_Target {
+    float3 hdr = SourceTexture.Sample(LinearClampSampler, input.TexCoord).rgb;
+    float3 color = pow(TonemapACES(hdr * Exposure), 1.0 / 2.2);
+    return float4(color, dot(color, float3(0.299, 0.587, 0.114)));
+}
+
+//=============================================================================
+// FXAA
+//=============================================================================
+
+static const float FXAA_EDGE_THRESHOLD = 0.125;
+static const float FXAA_EDGE_THRESHOLD_MIN = 0.0312;
+static const float FXAA_SPAN_MAX = 8.0;
+static const float FXAA_REDUCE_MUL = 1.0 / 8.0;
+static const float FXAA_REDUCE_MIN = 1.0 / 128.0;
+
+float Luma(float3 color) {
+    return dot(color, float3(0.299, 0.587, 0.114));
+}
+
+// FXAA in its compact form: blur along the edge direction estimated from
+// the luma of the four diagonal neighbours, skipping low-contrast pixels.
+// Expects a gamma-space (tone mapped) source.
+float4 PSFxaa(FullscreenOutput input) : SV_Target {
+    float2 uv = input.TexCoord;
+    float4 center = SourceTexture.Sample(LinearClampSampler, uv);
+
+    float lumaM = Luma(center.rgb);
+    float lumaNW = Luma(SourceTexture.Sample(LinearClampSampler, uv + float2(-1.0, -1.0) * InvResolution).rgb);
+    float lumaNE = Luma(SourceTexture.Sample(LinearClampSampler, uv + float2(1.0, -1.0) * InvResolution).rgb);
+    float lumaSW = Luma(SourceTexture.Sample(LinearClampSampler, uv + float2(-1.0, 1.0) * InvResolution).rgb);
+    float lumaSE = Luma(SourceTexture.Sample(LinearClampSampler, uv + float2(1.0, 1.0) * InvResolution).rgb);
+
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(FXAA_EDGE_THRESHOLD_MIN, lumaMax * FXAA_EDGE_THRESHOLD))
+        return center;
+
+    float2 dir;
+    dir.x = -((lumaNW + lumaNE) - (lumaSW + lumaSE));
+    dir.y = ((lumaNW + lumaSW) - (lumaNE + lumaSE));
+
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * FXAA_REDUCE_MUL,
+                          FXAA_REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, -FXAA_SPAN_MAX, FXAA_SPAN_MAX) * InvResolution;
+
+    float3 rgbA = 0.5 * (SourceTexture.Sample(LinearClampSampler, uv + dir * (1.0 / 3.0 - 0.5)).rgb +
+                         SourceTexture.Sample(LinearClampSampler, uv + dir * (2.0 / 3.0 - 0.5)).rgb);
+    float3 rgbB = rgbA * 0.5 + 0.25 * (SourceTexture.Sample(LinearClampSampler, uv - dir * 0.5).rgb +
+                                       SourceTexture.Sample(LinearClampSampler, uv + dir * 0.5).rgb);
+
+    float lumaB = Luma(rgbB);
+    float3 color = (lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB;
+    return float4(color, center.a);
+}
+
+#endif // CANDID_POST_HLSL
@@ -11,9 +11,28 @@
  * Compilation examples:
  *   dxc -T vs_6_0 -E VSMain -Fo standard_vs.spv -spirv standard.hlsl
  *   dxc -T ps_6_0 -E PSMain -Fo standard_ps.spv -spirv standard.hlsl
+ *   dxc -T vs_6_0 -E VSMainInstanced -D CANDID_INSTANCE_FORMAT=2 -spirv ...
+ *   dxc -T vs_6_0 -E VSMainPulledInstanced -spirv ...
+ *   dxc -T ps_6_6 -E PSMainBindless -spirv ...
+ *   dxc -T ps_6_0 -E PSMain -D CANDID_PERMUTATION=1 -D CANDID_ALPHA_MASK=1 ...
  *   spirv-cross standard_vs.spv --msl --output standard_vs.metal
  */
 
+//=============================================================================
+// Features
+//=============================================================================
+
+// Each feature is a permutation bit (Candid_ShaderFeature in
+// candid/shader_permutation.h), defined to 0 or 1 by the permutation
+// system. Compiled on its own, the shader gets the defaults below.
+#ifndef CANDID_PERMUTATION
+#define CANDID_ALPHA_MASK 0
+#define CANDID_NORMAL_MAP 1
+#define CANDID_SKINNING 0
+#define CANDID_VERTEX_COLOR 1
+#define CANDID_EMISSIVE 1
+#endif
+
 //=============================================================================
 // Constant Buffers
 //=============================================================================
@@ -56,6 +75,10 @@ Texture2D<float3> EmissiveTexture : register(t4);
 SamplerState LinearWrapSampler : register(s0);
 SamplerState LinearClampSampler : register(s1);
 
+#include "instancing.hlsl"
+#include "vertex_pulling.hlsl"
+#include "materials.hlsl"
+
 //=============================================================================
 // Vertex Shader
 //=============================================================================
@@ -67,6 +90,10 @@ struct VSInput {
     float2 TexCoord0 : TEXCOORD0;
     float2 TexCoord1 : TEXCOORD1;
     float4 Color    : COLOR0;
+#if CANDID_SKINNING
+    uint4 Joints    : BLENDINDICES;
+    float4 Weights  : BLENDWEIGHT;
+#endif
 };
 
 struct VSOutput {
@@ -80,8 +107,28 @@ struct VSOutput {
     float4 Color : COLOR0;
 };
 
+#if CANDID_SKINNING
+// Joint matrices of the draw, mapping bind pose to model space
+StructuredBuffer<float4x4> JointMatrices : register(t10);
+
+// Linear blend skinning of up to four joints
+VSInput SkinVertex(VSInput input) {
+    float4x4 skin = JointMatrices[input.Joints.x] * input.Weights.x +
+                    JointMatrices[input.Joints.y] * input.Weights.y +
+                    JointMatrices[input.Joints.z] * input.Weights.z +
+                    JointMatrices[input.Joints.w] * input.Weights.w;
+    input.Position = mul(skin, float4(input.Position, 1.0)).xyz;
+    input.Normal = mul((float3x3)skin, input.Normal);
+    input.Tangent.xyz = mul((float3x3)skin, input.Tangent.xyz);
+    return input;
+}
+#endif
+
 VSOutput VSMain(VSInput input) {
     VSOutput output;
+#if CANDID_SKINNING
+    input = SkinVertex(input);
+#endif
 
     // Transform position
     float4 worldPosition = mul(Model, float4(input.Position, 1.0));
@@ -103,6 +150,59 @@ VSOutput VSMain(VSInput input) {
     return output;
 }
 
+// Instanced variant: the model matrix comes from the instance buffer. The
+// normal matrix is approximated by the model's upper 3x3, which is exact for
+// the rotation + uniform scale formats.
+VSOutput VSMainInstanced(VSInput input, uint instanceID : SV_InstanceID) {
+    VSOutput output;
+#if CANDID_SKINNING
+    input = SkinVertex(input);
+#endif
+
+    float4x4 model = DecodeInstance(instanceID);
+    float4 worldPosition = mul(model, float4(input.Position, 1.0));
+    output.Position = mul(ViewProjection, worldPosition);
+    output.WorldPosition = worldPosition.xyz;
+
+    output.WorldNormal = normalize(mul((float3x3)model, input.Normal));
+    output.WorldTangent = normalize(mul((float3x3)model, input.Tangent.xyz));
+    output.WorldBitangent = cross(output.WorldNormal, output.WorldTangent) * input.Tangent.w;
+
+    output.TexCoord0 = input.TexCoord0;
+    output.TexCoord1 = input.TexCoord1;
+    output.Color = input.Color;
+
+    return output;
+}
+
+// Vertex-pulled variants: no vertex input, so one pipeline draws pulled
+// meshes of any layout (see vertex_pulling.hlsl). Pulled vertices carry no
+// joints, so these are left out of skinned permutations.
+#if !CANDID_SKINNING
+VSInput PullVSInput(uint vertexID, uint baseVertex) {
+    PulledVertex v = PullVertex(vertexID, baseVertex);
+
+    VSInput input;
+    input.Position = v.Position;
+    input.Normal = v.Normal;
+    input.Tangent = v.Tangent;
+    input.TexCoord0 = v.TexCoord0;
+    input.TexCoord1 = v.TexCoord1;
+    input.Color = v.Color;
+    return input;
+}
+
+VSOutput VSMainPulled(uint vertexID : SV_VertexID, CANDID_BASE_VERTEX_PARAM) {
+    return VSMain(PullVSInput(vertexID, baseVertex));
+}
+
+VSOutput VSMainPulledInstanced(uint vertexID : SV_VertexID,
+                               uint instanceID : SV_InstanceID,
+                               CANDID_BASE_VERTEX_PARAM) {
+    return VSMainInstanced(PullVSInput(vertexID, baseVertex), instanceID);
+}
+#endif
+
 //=============================================================================
 // PBR Functions
 //=============================================================================
@@ -150,20 +250,11 @@ float GeometrySmith(float NdotV, float NdotL, float roughness) {
 // Pixel Shader
 //=============================================================================
 
-float4 PSMain(VSOutput input) : SV_Target {
-    // Sample textures
-    float4 baseColor = BaseColorTexture.Sample(LinearWrapSampler, input.TexCoord0) * BaseColorFactor * input.Color;
-    float2 metallicRoughness = MetallicRoughnessTexture.Sample(LinearWrapSampler, input.TexCoord0);
-    float metallic = metallicRoughness.b * MetallicFactor;
-    float roughness = metallicRoughness.g * RoughnessFactor;
-    float ao = OcclusionTexture.Sample(LinearWrapSampler, input.TexCoord0) * OcclusionStrength;
-    float3 emissive = EmissiveTexture.Sample(LinearWrapSampler, input.TexCoord0) * EmissiveFactor;
-
-    // Normal mapping
-    float3 normalSample = NormalTexture.Sample(LinearWrapSampler, input.TexCoord0);
-    normalSample = normalSample * 2.0 - 1.0;
-    normalSample.xy *= NormalScale;
-
+// Directional light plus ambient, tone mapped and gamma corrected.
+// `normalSample` is the tangent-space normal, already scaled.
+float3 ShadeSurface(VSOutput input, float3 normalSample, float3 baseColor,
+                    float metallic, float roughness, float ao,
+                    float3 emissive) {
     float3x3 TBN = float3x3(
         normalize(input.WorldTangent),
         normalize(input.WorldBitangent),
@@ -185,7 +276,7 @@ float4 PSMain(VSOutput input) : SV_Target {
     float HdotV = max(dot(H, V), 0.0);
 
     // F0 - reflectance at normal incidence
-    float3 F0 = lerp(float3(0.04, 0.04, 0.04), baseColor.rgb, metallic);
+    float3 F0 = lerp(float3(0.04, 0.04, 0.04), baseColor, metallic);
 
     // Cook-Torrance BRDF
     float NDF = DistributionGGX(NdotH, roughness);
@@ -202,13 +293,13 @@ float4 PSMain(VSOutput input) : SV_Target {
     float3 kD = (1.0 - kS) * (1.0 - metallic);
 
     // Diffuse term (Lambertian)
-    float3 diffuse = kD * baseColor.rgb / PI;
+    float3 diffuse = kD * baseColor / PI;
 
     // Final radiance
     float3 Lo = (diffuse + specular) * LightColor.rgb * LightIntensity * NdotL;
 
     // Ambient term (simplified IBL approximation)
-    float3 ambient = AmbientColor.rgb * baseColor.rgb * ao;
+    float3 ambient = AmbientColor.rgb * baseColor * ao;
 
     // Final color
     float3 color = ambient + Lo + emissive;
@@ -217,8 +308,82 @@ float4 PSMain(VSOutput input) : SV_Target {
     color = color / (color + 1.0);
 
     // Gamma correction
-    color = pow(color, 1.0 / 2.2);
+    return pow(color, 1.0 / 2.2);
+}
 
+float4 PSMain(VSOutput input) : SV_Target {
+    // Sample textures
+    float4 baseColor = BaseColorTexture.Sample(LinearWrapSampler, input.TexCoord0) * BaseColorFactor;
+#if CANDID_VERTEX_COLOR
+    baseColor *= input.Color;
+#endif
+#if CANDID_ALPHA_MASK
+    clip(baseColor.a - AlphaCutoff);
+#endif
+    float2 metallicRoughness = MetallicRoughnessTexture.Sample(LinearWrapSampler, input.TexCoord0);
+    float metallic = metallicRoughness.b * MetallicFactor;
+    float roughness = metallicRoughness.g * RoughnessFactor;
+    float ao = OcclusionTexture.Sample(LinearWrapSampler, input.TexCoord0) * OcclusionStrength;
+#if CANDID_EMISSIVE
+    float3 emissive = EmissiveTexture.Sample(LinearWrapSampler, input.TexCoord0) * EmissiveFactor;
+#else
+    float3 emissive = 0.0;
+#endif
+
+    // Normal mapping
+#if CANDID_NORMAL_MAP
+    float3 normalSample = NormalTexture.Sample(LinearWrapSampler, input.TexCoord0);
+    normalSample = normalSample * 2.0 - 1.0;
+    normalSample.xy *= NormalScale;
+#else
+    float3 normalSample = float3(0.0, 0.0, 1.0);
+#endif
+
+    float3 color = ShadeSurface(input, normalSample, baseColor.rgb, metallic,
+                                roughness, ao, emissive);
+    return float4(color, baseColor.a);
+}
+
+//=============================================================================
+// Bindless Pixel Shader
+//=============================================================================
+
+// All factors and textures come from the draw's material record, so draws
+// with different materials need no rebinding. Specular-glossiness records
+// are approximated as dielectrics with roughness = 1 - glossiness.
+float4 PSMainBindless(VSOutput input) : SV_Target {
+    MaterialRecord m = LoadMaterial(MaterialIndex);
+    float2 uv = input.TexCoord0;
+
+    float4 baseColor = SampleBindless(m.BaseColorTexture, uv, 1.0) *
+                       m.BaseColor * input.Color;
+    if (HasMaterialFlag(m, CANDID_MATERIAL_FLAG_ALPHA_MASK))
+        clip(baseColor.a - m.AlphaCutoff);
+    if (HasMaterialFlag(m, CANDID_MATERIAL_FLAG_UNLIT))
+        return baseColor;
+
+    float4 pbrSample = SampleBindless(m.PbrTexture, uv, 1.0);
+    float metallic, roughness;
+    if (HasMaterialFlag(m, CANDID_MATERIAL_FLAG_SPECULAR_GLOSSINESS)) {
+        metallic = 0.0;
+        roughness = 1.0 - pbrSample.a * m.Pbr.w;
+    } else {
+        metallic = pbrSample.b * m.Pbr.x;
+        roughness = pbrSample.g * m.Pbr.y;
+    }
+
+    float occlusion = SampleBindless(m.OcclusionTexture, uv, 1.0).r;
+    float ao = lerp(1.0, occlusion, m.OcclusionStrength);
+    float3 emissive = SampleBindless(m.EmissiveTexture, uv, 1.0).rgb *
+                      m.Emissive;
+
+    float3 normalSample = SampleBindless(m.NormalTexture, uv,
+                                         float4(0.5, 0.5, 1.0, 1.0)).rgb;
+    normalSample = normalSample * 2.0 - 1.0;
+    normalSample.xy *= m.NormalScale;
+
+    float3 color = ShadeSurface(input, normalSample, baseColor.rgb, metallic,
+                                roughness, ao, emissive);
     return float4(color, baseColor.a);
 }
 
@@ -231,6 +396,44 @@ float4 PSUnlit(VSOutput input) : SV_Target {
     return color;
 }
 
+//=============================================================================
+// Blinn-Phong Shader Variant
+//=============================================================================
+
+// Classic lighting from the same material constants: the specular exponent
+// is derived from RoughnessFactor.
+float4 PSBlinnPhong(VSOutput input) : SV_Target {
+    float4 baseColor = BaseColorTexture.Sample(LinearWrapSampler, input.TexCoord0) * BaseColorFactor * input.Color;
+
+    float3 N = normalize(input.WorldNormal);
+    float3 V = normalize(CameraPosition - input.WorldPosition);
+    float3 L = normalize(-LightDirection);
+    float3 H = normalize(V + L);
+
+    float shininess = exp2(10.0 * (1.0 - RoughnessFactor) + 1.0);
+    float NdotL = saturate(dot(N, L));
+    float specular = NdotL > 0.0 ? pow(saturate(dot(N, H)), shininess) : 0.0;
+
+    float3 light = LightColor.rgb * LightIntensity;
+    float3 color = AmbientColor.rgb * baseColor.rgb +
+                   (baseColor.rgb * NdotL + specular) * light + EmissiveFactor;
+
+    color = color / (color + 1.0);
+    return float4(pow(color, 1.0 / 2.2), baseColor.a);
+}
+
+//=============================================================================
+// Debug Visualization
+//=============================================================================
+
+float4 PSDebugNormals(VSOutput input) : SV_Target {
+    return float4(normalize(input.WorldNormal) * 0.5 + 0.5, 1.0);
+}
+
+float4 PSDebugUV(VSOutput input) : SV_Target {
+    return float4(frac(input.TexCoord0), 0.0, 1.0);
+}
+
 //=============================================================================
 // Shadow Pass
 //=============================================================================
@@ -0,0 +1,243 @@
+/**
+ * @file vertex_pulling.hlsl
+ * @brief Programmable vertex fetch for Candid Engine
+ *
+ * Mirrors Candid_VertexPullHeader and Candid_VertexFormat in candid/mesh.h.
+ * Pulled meshes (CANDID_MESH_STORAGE_PULLED) of every vertex layout share one
+ * raw buffer per index format, so a single pipeline without vertex input can
+ * draw all of them in one multi-draw. Each mesh's vertices are preceded by
+ * its layout record; draws set baseVertex to the first vertex in 4-byte
+ * words, which is all the shader needs to find both:
+ *
+ *   record = base * 4 - 48
+ *   vertex = base * 4 + (SV_VertexID - base) * stride
+ *
+ * Entry points take the base vertex with CANDID_BASE_VERTEX_PARAM
+ * (BaseVertex on Vulkan, SV_StartVertexLocation on D3D12 with SM 6.8):
+ *
+ *   VSOutput VSMainPulled(uint vertexID : SV_VertexID,
+ *                         CANDID_BASE_VERTEX_PARAM) {
+ *       PulledVertex v = PullVertex(vertexID, baseVertex);
+ *       ...
+ *   }
+ *
+ * Compilation example:
+ *   dxc -T vs_6_0 -E VSMainPulled -Fo standard_pulled_vs.spv -spirv ...
+ */
+
+#ifndef CANDID_VERTEX_PULLING_HLSL
+#define CANDID_VERTEX_PULLING_HLSL
+
+#ifdef __spirv__
+#define CANDID_BASE_VERTEX_PARAM \
+    [[vk::builtin("BaseVertex")]] uint baseVertex : BASEVERTEX
+#else
+#define CANDID_BASE_VERTEX_PARAM uint baseVertex : SV_StartVertexLocation
+#endif
+
+#define CANDID_VERTEX_FORMAT_FLOAT        0
+#define CANDID_VERTEX_FORMAT_FLOAT2       1
+#define CANDID_VERTEX_FORMAT_FLOAT3       2
+#define CANDID_VERTEX_FORMAT_FLOAT4       3
+#define CANDID_VERTEX_FORMAT_INT          4
+#define CANDID_VERTEX_FORMAT_INT2         5
+#define CANDID_VERTEX_FORMAT_INT3         6
+#define CANDID_VERTEX_FORMAT_INT4         7
+#define CANDID_VERTEX_FORMAT_UINT         8
+#define CANDID_VERTEX_FORMAT_UINT2        9
+#define CANDID_VERTEX_FORMAT_UINT3        10
+#define CANDID_VERTEX_FORMAT_UINT4        11
+#define CANDID_VERTEX_FORMAT_BYTE4_NORM   12
+#define CANDID_VERTEX_FORMAT_BYTE4_SNORM  13
+#define CANDID_VERTEX_FORMAT_SHORT2       14
+#define CANDID_VERTEX_FORMAT_SHORT4       15
+#define CANDID_VERTEX_FORMAT_SHORT2_NORM  16
+#define CANDID_VERTEX_FORMAT_SHORT4_NORM  17
+
+// Candid_VertexSemantic values with a slot in the layout record
+#define CANDID_SEMANTIC_POSITION  0
+#define CANDID_SEMANTIC_NORMAL    1
+#define CANDID_SEMANTIC_TANGENT   2
+#define CANDID_SEMANTIC_BITANGENT 3
+#define CANDID_SEMANTIC_TEXCOORD0 4
+#define CANDID_SEMANTIC_TEXCOORD1 5
+#define CANDID_SEMANTIC_COLOR0    6
+#define CANDID_SEMANTIC_COLOR1    7
+#define CANDID_SEMANTIC_JOINTS    8
+#define CANDID_SEMANTIC_WEIGHTS   9
+
+#define CANDID_VERTEX_PULL_HEADER_SIZE 48
+#define CANDID_VERTEX_PULL_ABSENT 0xFFFFFFFF
+
+//=============================================================================
+// Resources
+//=============================================================================
+
+ByteAddressBuffer PulledVertices : register(t9);
+
+//=============================================================================
+// Format Decoding
+//=============================================================================
+
+// Sign-extend the low and high 16 bits of a word
+int2 UnpackShort2(uint raw) {
+    return int2(asint(raw << 16) >> 16, asint(raw) >> 16);
+}
+
+int4 UnpackByte4(uint raw) {
+    return asint(uint4(raw << 24, raw << 16, raw << 8, raw)) >> 24;
+}
+
+// Components missing from the format read as (0, 0, 0, 1), as with
+// fixed-function vertex input. Integer formats convert to float.
+float4 LoadVertexAttribute(uint address, uint format) {
+    switch (format) {
+    case CANDID_VERTEX_FORMAT_FLOAT:
+        return float4(asfloat(PulledVertices.Load(address)), 0.0, 0.0, 1.0);
+    case CANDID_VERTEX_FORMAT_FLOAT2:
+        return float4(asfloat(PulledVertices.Load2(address)), 0.0, 1.0);
+    case CANDID_VERTEX_FORMAT_FLOAT3:
+        return float4(asfloat(PulledVertices.Load3(address)), 1.0);
+    case CANDID_VERTEX_FORMAT_FLOAT4:
+        return asfloat(PulledVertices.Load4(address));
+    case CANDID_VERTEX_FORMAT_INT:
+        return float4(asint(PulledVertices.Load(address)), 0.0, 0.0, 1.0);
+    case CANDID_VERTEX_FORMAT_INT2:
+        return float4(asint(PulledVertices.Load2(address)), 0.0, 1.0);
+    case CANDID_VERTEX_FORMAT_INT3:
+        return float4(asint(PulledVertices.Load3(address)), 1.0);
+    case CANDID_VERTEX_FORMAT_INT4:
+        return float4(asint(PulledVertices.Load4(address)));
+    case CANDID_VERTEX_FORMAT_UINT:
+        return float4(PulledVertices.Load(address), 0.0, 0.0, 1.0);
+    case CANDID_VERTEX_FORMAT_UINT2:
+        return float4(PulledVertices.Load2(address), 0.0, 1.0);
+    case CANDID_VERTEX_FORMAT_UINT3:
+        return float4(PulledVertices.Load3(address), 1.0);
+    case CANDID_VERTEX_FORMAT_UINT4:
+        return float4(PulledVertices.Load4(address));
+    case CANDID_VERTEX_FORMAT_BYTE4_NORM: {
+        uint raw = PulledVertices.Load(address);
+        return float4(raw & 0xFF, (raw >> 8) & 0xFF,
+                      (raw >> 16) & 0xFF, raw >> 24) / 255.0;
+    }
+    case CANDID_VERTEX_FORMAT_BYTE4_SNORM: {
+        float4 snorm = float4(UnpackByte4(PulledVertices.Load(address)));
+        return max(snorm / 127.0, -1.0);
+    }
+    case CANDID_VERTEX_FORMAT_SHORT2:
+        return float4(UnpackShort2(PulledVertices.Load(address)), 0.0, 1.0);
+    case CANDID_VERTEX_FORMAT_SHORT4: {
+        uint2 raw = PulledVertices.Load2(address);
+        return float4(UnpackShort2(raw.x), UnpackShort2(raw.y));
+    }
+    case CANDID_VERTEX_FORMAT_SHORT2_NORM: {
+        float2 snorm = float2(UnpackShort2(PulledVertices.Load(address)));
+        return float4(max(snorm / 32767.0, -1.0), 0.0, 1.0);
+    }
+    case CANDID_VERTEX_FORMAT_SHORT4_NORM: {
+        uint2 raw = PulledVertices.Load2(address);
+        float4 snorm = float4(UnpackShort2(raw.x), UnpackShort2(raw.y));
+        return max(snorm / 32767.0, -1.0);
+    }
+    default:
+        return float4(0.0, 0.0, 0.0, 1.0);
+    }
+}
+
+// Integer attributes (joint indices) without the float conversion
+uint4 LoadVertexAttributeUint(uint address, uint format) {
+    switch (format) {
+    case CANDID_VERTEX_FORMAT_INT:
+    case CANDID_VERTEX_FORMAT_UINT:
+        return uint4(PulledVertices.Load(address), 0, 0, 1);
+    case CANDID_VERTEX_FORMAT_INT2:
+    case CANDID_VERTEX_FORMAT_UINT2:
+        return uint4(PulledVertices.Load2(address), 0, 1);
+    case CANDID_VERTEX_FORMAT_INT3:
+    case CANDID_VERTEX_FORMAT_UINT3:
+        return uint4(PulledVertices.Load3(address), 1);
+    case CANDID_VERTEX_FORMAT_INT4:
+    case CANDID_VERTEX_FORMAT_UINT4:
+        return PulledVertices.Load4(address);
+    case CANDID_VERTEX_FORMAT_BYTE4_NORM: {
+        uint raw = PulledVertices.Load(address);
+        return uint4(raw & 0xFF, (raw >> 8) & 0xFF, (raw >> 16) & 0xFF,
+                     raw >> 24);
+    }
+    case CANDID_VERTEX_FORMAT_SHORT4: {
+        uint2 raw = PulledVertices.Load2(address);
+        return uint4(raw.x & 0xFFFF, raw.x >> 16, raw.y & 0xFFFF, raw.y >> 16);
+    }
+    default:
+        return uint4(0, 0, 0, 1);
+    }
+}
+
+//=============================================================================
+// Vertex Fetch
+//=============================================================================
+
+struct PulledVertex {
+    float3 Position;
+    float3 Normal;
+    float4 Tangent;   // w = handedness
+    float2 TexCoord0;
+    float2 TexCoord1;
+    float4 Color;
+};
+
+struct PulledVertexLocation {
+    uint Header;      // Byte address of the layout record
+    uint Vertex;      // Byte address of the vertex being fetched
+};
+
+PulledVertexLocation LocateVertex(uint vertexID, uint baseVertex) {
+    PulledVertexLocation location;
+    location.Header = baseVertex * 4 - CANDID_VERTEX_PULL_HEADER_SIZE;
+    uint stride = PulledVertices.Load(location.Header);
+    location.Vertex = baseVertex * 4 + (vertexID - baseVertex) * stride;
+    return location;
+}
+
+bool HasAttribute(PulledVertexLocation location, uint semantic) {
+    uint attribute = PulledVertices.Load(location.Header + 4 + semantic * 4);
+    return attribute != CANDID_VERTEX_PULL_ABSENT;
+}
+
+// `fallback` is returned when the mesh's layout lacks the semantic
+float4 PullAttribute(PulledVertexLocation location, uint semantic,
+                     float4 fallback) {
+    uint attribute = PulledVertices.Load(location.Header + 4 + semantic * 4);
+    if (attribute == CANDID_VERTEX_PULL_ABSENT)
+        return fallback;
+    return LoadVertexAttribute(location.Vertex + (attribute & 0xFFFF),
+                               (attribute >> 16) & 0xFF);
+}
+
+uint4 PullAttributeUint(PulledVertexLocation location, uint semantic) {
+    uint attribute = PulledVertices.Load(location.Header + 4 + semantic * 4);
+    if (attribute == CANDID_VERTEX_PULL_ABSENT)
+        return uint4(0, 0, 0, 0);
+    return LoadVertexAttributeUint(location.Vertex + (attribute & 0xFFFF),
+                                   (attribute >> 16) & 0xFF);
+}
+
+// The attributes of standard.hlsl's VSInput. Missing normals face +Z,
+// missing tangents +X and missing colors are white.
+PulledVertex PullVertex(uint vertexID, uint baseVertex) {
+    PulledVertexLocation location = LocateVertex(vertexID, baseVertex);
+
+    PulledVertex v;
+    v.Position = PullAttribute(location, CANDID_SEMANTIC_POSITION, 0.0).xyz;
+    v.Normal = PullAttribute(location, CANDID_SEMANTIC_NORMAL,
+                             float4(0.0, 0.0, 1.0, 0.0)).xyz;
+    v.Tangent = PullAttribute(location, CANDID_SEMANTIC_TANGENT,
+                              float4(1.0, 0.0, 0.0, 1.0));
+    v.TexCoord0 = PullAttribute(location, CANDID_SEMANTIC_TEXCOORD0, 0.0).xy;
+    v.TexCoord1 = PullAttribute(location, CANDID_SEMANTIC_TEXCOORD1, 0.0).xy;
+    v.Color = PullAttribute(location, CANDID_SEMANTIC_COLOR0, 1.0);
+    return v;
+}
+
+#endif // CANDID_VERTEX_PULLING_HLSL
@@ -17,6 +17,14 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+/* Fragment bindings of the bindless tables (see shaders/materials.hlsl) */
+enum {
+  METAL_BINDLESS_SAMPLER_SLOT = 15,
+  METAL_BINDLESS_TEXTURES_SLOT = 16, /**< MTLResourceID per table entry */
+  METAL_BINDLESS_MATERIALS_SLOT = 17,
+  METAL_BINDLESS_MATERIAL_INDEX_SLOT = 18,
+};
+
 /*******************************************************************************
  * Internal Structures
  ******************************************************************************/
@@ -24,15 +32,42 @@
 struct Candid_Device {
   id<MTLDevice> mtl_device;
   id<MTLCommandQueue> command_queue;
+  /* Async compute: a queue of its own, and an event per Candid_Queue set to
+   * each submission's sync point */
+  id<MTLCommandQueue> compute_queue;
+  id<MTLEvent> queue_events[CANDID_QUEUE_COUNT];
+  uint64_t queue_values[CANDID_QUEUE_COUNT];
+  /* Frame slots not in flight: taken by cmd_begin, given back when the
+   * frame's command buffer completes */
+  dispatch_semaphore_t frame_semaphore;
+  uint32_t max_frames_in_flight;
   CAMetalLayer *layer;
   uint32_t width;
   uint32_t height;
   id<MTLTexture> depth_texture;
   id<MTLDepthStencilState> default_depth_state;
+  bool sampled_depth;
+  Candid_Texture *depth_target; /**< Wraps depth_texture when sampled_depth */
 
   /* Built-in resources */
   id<MTLLibrary> default_library;
   id<MTLRenderPipelineState> default_pipeline;
+  id<MTLRenderPipelineState> instanced_pipelines[CANDID_INSTANCE_FORMAT_COUNT];
+  /* Vertex pulling twins of the above, without a vertex descriptor */
+  id<MTLRenderPipelineState> pulled_pipeline;
+  id<MTLRenderPipelineState>
+      pulled_instanced_pipelines[CANDID_INSTANCE_FORMAT_COUNT];
+  id<MTLLibrary> compute_library;
+  Candid_ShaderProgram *kernels[CANDID_COMPUTE_KERNEL_COUNT]; /**< Lazy */
+
+  /* How each render pipeline above and of the graphics programs was built,
+   * and its variants for the formats of offscreen passes, by pipeline */
+  NSMutableDictionary<NSValue *, MTLRenderPipelineDescriptor *>
+      *pipeline_descriptors;
+  NSMutableDictionary<NSValue *,
+                      NSMutableDictionary<NSNumber *,
+                                          id<MTLRenderPipelineState>> *>
+      *target_pipelines;
 };
 
 struct Candid_Buffer {
@@ -46,6 +81,10 @@ struct Candid_Texture {
   Candid_TextureDesc desc;
 };
 
+struct Candid_Heap {
+  id<MTLHeap> mtl_heap; /**< Placement heap, hazards tracked by Metal */
+};
+
 struct Candid_Sampler {
   id<MTLSamplerState> mtl_sampler;
 };
@@ -57,6 +96,8 @@ struct Candid_ShaderModule {
 
 struct Candid_ShaderProgram {
   id<MTLRenderPipelineState> pipeline_state;
+  id<MTLComputePipelineState> compute_state;
+  MTLSize workgroup_size; /**< Threads per threadgroup at dispatch */
   Candid_ShaderModule *vertex;
   Candid_ShaderModule *fragment;
 };
@@ -64,6 +105,10 @@ struct Candid_ShaderProgram {
 struct Candid_Mesh {
   Candid_Buffer *vertex_buffer;
   Candid_Buffer *index_buffer;
+  bool placed;           /**< Buffers are shared and not owned */
+  bool pulled;           /**< Read by vertex-pulling shaders, in words */
+  int32_t vertex_offset; /**< First vertex in vertex_buffer */
+  uint32_t first_index;  /**< First index in index_buffer */
   uint32_t vertex_count;
   uint32_t index_count;
   Candid_IndexFormat index_format;
@@ -71,19 +116,56 @@ struct Candid_Mesh {
   Candid_AABB bounds;
 };
 
+/* Parameters live in the renderer's material table; only what selects the
+ * pipeline and the record is kept here */
 struct Candid_Material {
   Candid_ShaderProgram *shader;
-  Candid_MaterialDesc desc;
-  id<MTLBuffer> uniform_buffer;
+  Candid_Material *base; /**< NULL unless an instance */
+  uint32_t table_index;  /**< Bindless material record */
+};
+
+/* Textures reached through the argument buffer are not retained by command
+ * buffers, nor made resident: passes declare `resident` with useResources
+ * and keep it alive until they complete. */
+struct Candid_TextureTable {
+  id<MTLBuffer> ids; /**< MTLResourceID per entry, zero when empty */
+  Candid_Texture **entries;
+  uint32_t capacity;
+  bool dirty; /**< `resident` misses the latest entry changes */
+  NSArray<id<MTLTexture>> *resident;
+  __unsafe_unretained id<MTLResource> *resident_list; /**< Same, as C array */
+  id<MTLSamplerState> sampler;
 };
 
 struct Candid_CommandBuffer {
   id<MTLCommandBuffer> mtl_command_buffer;
   id<MTLRenderCommandEncoder> render_encoder;
+  id<MTLComputeCommandEncoder> compute_encoder; /**< Outside render passes */
+  Candid_ShaderProgram *compute_program;
+  Candid_Queue queue;
   id<CAMetalDrawable> drawable;
+  id<MTLRenderPipelineState> bound_pipeline;
+  Candid_Buffer *bound_geometry; /**< Mesh vertex buffer at slot 0 */
+  Candid_Buffer *index_buffer;   /**< From cmd_bind_index_buffer */
+  size_t index_offset;
+  Candid_IndexFormat index_format;
+  bool bindless;                /**< Tables bound by cmd_bind_bindless */
+  uint32_t bound_material_index; /**< Last index given to the fragment stage */
+  /* Attachment formats of a cmd_begin_render_pass_targets pass */
+  bool target_pass;
+  MTLPixelFormat color_format;
+  MTLPixelFormat depth_format; /**< MTLPixelFormatInvalid without depth */
   Candid_Device *device;
 };
 
+/* Matches the Uniforms struct of the built-in shaders */
+typedef struct Candid_MetalDrawUniforms {
+  float model[16];
+  float view_projection[16];
+  float time;
+  float padding[3];
+} Candid_MetalDrawUniforms;
+
 /*******************************************************************************
  * Helper Functions
  ******************************************************************************/
@@ -110,6 +192,8 @@ static MTLPixelFormat texture_format_to_mtl(Candid_TextureFormat format) {
     return MTLPixelFormatDepth32Float;
   case CANDID_TEXTURE_FORMAT_DEPTH24_STENCIL8:
     return MTLPixelFormatDepth24Unorm_Stencil8;
+  case CANDID_TEXTURE_FORMAT_R32_FLOAT:
+    return MTLPixelFormatR32Float;
   default:
     return MTLPixelFormatInvalid;
   }
@@ -177,9 +261,152 @@ static void create_depth_texture(Candid_Device *device) {
                                     height:device->height
                                  mipmapped:NO];
     desc.usage = MTLTextureUsageRenderTarget;
+    if (device->sampled_depth)
+      desc.usage |= MTLTextureUsageShaderRead;
     desc.storageMode = MTLStorageModePrivate;
     device->depth_texture = [device->mtl_device newTextureWithDescriptor:desc];
   }
+
+  if (device->depth_target) {
+    device->depth_target->mtl_texture = device->depth_texture;
+    device->depth_target->desc = (Candid_TextureDesc){
+        .width = device->width,
+        .height = device->height,
+        .depth = 1,
+        .mip_levels = 1,
+        .array_layers = 1,
+        .format = CANDID_TEXTURE_FORMAT_DEPTH32_FLOAT,
+        .usage = CANDID_TEXTURE_USAGE_DEPTH_STENCIL |
+                 CANDID_TEXTURE_USAGE_SAMPLED,
+    };
+  }
+}
+
+/* Instance decoding, see candid/instance.h and instancing.hlsl. Shared by the
+ * instanced vertex shader (format fixed by a function constant) and the
+ * culling kernel (format read at run time). */
+#define METAL_INSTANCE_DECODE_SOURCE                                           \
+  "struct InstanceParams {\n"                                                  \
+  "    float4 origin_max_scale;\n"                                             \
+  "    float4 extent;\n"                                                       \
+  "};\n"                                                                       \
+  "\n"                                                                         \
+  "float4x4 compose_trs(float4 q, float3 t, float s) {\n"                      \
+  "    float3 q2 = q.xyz * 2.0;\n"                                             \
+  "    float xx = q.x * q2.x, yy = q.y * q2.y, zz = q.z * q2.z;\n"             \
+  "    float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;\n"             \
+  "    float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;\n"             \
+  "    return float4x4(\n"                                                     \
+  "        float4(float3(1.0 - yy - zz, xy + wz, xz - wy) * s, 0.0),\n"        \
+  "        float4(float3(xy - wz, 1.0 - xx - zz, yz + wx) * s, 0.0),\n"        \
+  "        float4(float3(xz + wy, yz - wx, 1.0 - xx - yy) * s, 0.0),\n"        \
+  "        float4(t, 1.0));\n"                                                 \
+  "}\n"                                                                        \
+  "\n"                                                                         \
+  "float4x4 decode_instance_format(device const uchar *data, uint id,\n"       \
+  "                                constant InstanceParams &params,\n"         \
+  "                                uint format) {\n"                           \
+  "    if (format == 0) {\n"                                                   \
+  "        return ((device const float4x4 *)data)[id];\n"                      \
+  "    } else if (format == 1) {\n"                                            \
+  "        device const float4 *r = (device const float4 *)data + id * 3;\n"   \
+  "        return transpose(float4x4(r[0], r[1], r[2],\n"                      \
+  "                                  float4(0.0, 0.0, 0.0, 1.0)));\n"          \
+  "    } else if (format == 2) {\n"                                            \
+  "        device const float4 *v = (device const float4 *)data + id * 2;\n"   \
+  "        return compose_trs(v[0], v[1].xyz, v[1].w);\n"                      \
+  "    }\n"                                                                    \
+  "    device const ushort4 *v = (device const ushort4 *)data + id * 2;\n"     \
+  "    float4 unorm = float4(v[0]) / 65535.0;\n"                               \
+  "    float4 q = max(float4(as_type<short4>(v[1])) / 32767.0, -1.0);\n"       \
+  "    float3 t = params.origin_max_scale.xyz + unorm.xyz * params.extent.xyz;\n" \
+  "    return compose_trs(normalize(q), t, unorm.w * params.origin_max_scale.w);\n" \
+  "}\n"
+
+/* Vertex fetch for pulled meshes, see Candid_VertexPullHeader and
+ * vertex_pulling.hlsl. The block's words are bound at buffer 0; base_vertex
+ * is the mesh's first vertex word, right after its layout record. */
+#define METAL_VERTEX_PULL_SOURCE                                               \
+  "struct PulledVertex {\n"                                                    \
+  "    float3 position;\n"                                                     \
+  "    float3 normal;\n"                                                       \
+  "    float4 tangent;\n"                                                      \
+  "    float2 texcoord0;\n"                                                    \
+  "    float2 texcoord1;\n"                                                    \
+  "    float4 color;\n"                                                        \
+  "};\n"                                                                       \
+  "\n"                                                                         \
+  "float4 load_vertex_attribute(device const uint *w, uint format) {\n"        \
+  "    device const float *f = (device const float *)w;\n"                     \
+  "    device const int *i = (device const int *)w;\n"                         \
+  "    switch (format) {\n"                                                    \
+  "    case 0: return float4(f[0], 0.0, 0.0, 1.0);\n"                          \
+  "    case 1: return float4(f[0], f[1], 0.0, 1.0);\n"                         \
+  "    case 2: return float4(f[0], f[1], f[2], 1.0);\n"                        \
+  "    case 3: return float4(f[0], f[1], f[2], f[3]);\n"                       \
+  "    case 4: return float4(i[0], 0.0, 0.0, 1.0);\n"                          \
+  "    case 5: return float4(i[0], i[1], 0.0, 1.0);\n"                         \
+  "    case 6: return float4(i[0], i[1], i[2], 1.0);\n"                        \
+  "    case 7: return float4(i[0], i[1], i[2], i[3]);\n"                       \
+  "    case 8: return float4(w[0], 0.0, 0.0, 1.0);\n"                          \
+  "    case 9: return float4(w[0], w[1], 0.0, 1.0);\n"                         \
+  "    case 10: return float4(w[0], w[1], w[2], 1.0);\n"                       \
+  "    case 11: return float4(w[0], w[1], w[2], w[3]);\n"                      \
+  "    case 12: return unpack_unorm4x8_to_float(w[0]);\n"                      \
+  "    case 13: return unpack_snorm4x8_to_float(w[0]);\n"                      \
+  "    case 14: return float4(float2(as_type<short2>(w[0])), 0.0, 1.0);\n"     \
+  "    case 15: return float4(float2(as_type<short2>(w[0])),\n"                \
+  "                           float2(as_type<short2>(w[1])));\n"               \
+  "    case 16: return float4(unpack_snorm2x16_to_float(w[0]), 0.0, 1.0);\n"   \
+  "    case 17: return float4(unpack_snorm2x16_to_float(w[0]),\n"              \
+  "                           unpack_snorm2x16_to_float(w[1]));\n"             \
+  "    }\n"                                                                    \
+  "    return float4(0.0, 0.0, 0.0, 1.0);\n"                                   \
+  "}\n"                                                                        \
+  "\n"                                                                         \
+  "float4 pull_attribute(device const uint *words, uint header, uint vertex,\n" \
+  "                      uint semantic, float4 fallback) {\n"                  \
+  "    uint attribute = words[header + 1 + semantic];\n"                       \
+  "    if (attribute == 0xFFFFFFFF)\n"                                         \
+  "        return fallback;\n"                                                 \
+  "    return load_vertex_attribute(words + vertex + (attribute & 0xFFFF) / 4,\n" \
+  "                                 (attribute >> 16) & 0xFF);\n"              \
+  "}\n"                                                                        \
+  "\n"                                                                         \
+  "PulledVertex pull_vertex(device const uint *words, uint vertex_id,\n"       \
+  "                         uint base_vertex) {\n"                             \
+  "    uint header = base_vertex - 12;\n"                                      \
+  "    uint vertex = base_vertex + (vertex_id - base_vertex) * (words[header] / 4);\n" \
+  "    PulledVertex v;\n"                                                      \
+  "    v.position = pull_attribute(words, header, vertex, 0, float4(0.0)).xyz;\n" \
+  "    v.normal = pull_attribute(words, header, vertex, 1,\n"                  \
+  "                              float4(0.0, 0.0, 1.0, 0.0)).xyz;\n"           \
+  "    v.tangent = pull_attribute(words, header, vertex, 2,\n"                 \
+  "                               float4(1.0, 0.0, 0.0, 1.0));\n"              \
+  "    v.texcoord0 = pull_attribute(words, header, vertex, 4, float4(0.0)).xy;\n" \
+  "    v.texcoord1 = pull_attribute(words, header, vertex, 5, float4(0.0)).xy;\n" \
+  "    v.color = pull_attribute(words, header, vertex, 6, float4(1.0));\n"     \
+  "    return v;\n"                                                            \
+  "}\n"
+
+static NSValue *pipeline_key(id<MTLRenderPipelineState> pipeline) {
+  return [NSValue valueWithNonretainedObject:pipeline];
+}
+
+/* Kept to rebuild the pipeline for the formats of offscreen passes */
+static void keep_pipeline_descriptor(Candid_Device *device,
+                                     id<MTLRenderPipelineState> pipeline,
+                                     MTLRenderPipelineDescriptor *desc) {
+  if (pipeline)
+    device->pipeline_descriptors[pipeline_key(pipeline)] = [desc copy];
+}
+
+static void forget_pipeline(Candid_Device *device,
+                            id<MTLRenderPipelineState> pipeline) {
+  if (!pipeline)
+    return;
+  [device->pipeline_descriptors removeObjectForKey:pipeline_key(pipeline)];
+  [device->target_pipelines removeObjectForKey:pipeline_key(pipeline)];
 }
 
 static void create_default_pipeline(Candid_Device *device) {
@@ -223,6 +450,65 @@ static void create_default_pipeline(Candid_Device *device) {
       "    return out;\n"
       "}\n"
       "\n"
+      "constant uint instance_format [[function_constant(0)]];\n"
+      "\n"
+      METAL_INSTANCE_DECODE_SOURCE
+      "\n"
+      "float4x4 decode_instance(device const uchar *data, uint id,\n"
+      "                         constant InstanceParams &params) {\n"
+      "    return decode_instance_format(data, id, params, instance_format);\n"
+      "}\n"
+      "\n"
+      "vertex VertexOut vertex_instanced(Vertex in [[stage_in]],\n"
+      "                                  constant Uniforms &uniforms [[buffer(1)]],\n"
+      "                                  device const uchar *instances [[buffer(2)]],\n"
+      "                                  constant InstanceParams &params [[buffer(3)]],\n"
+      "                                  uint instance_id [[instance_id]]) {\n"
+      "    float4x4 model = decode_instance(instances, instance_id, params);\n"
+      "    VertexOut out;\n"
+      "    float4 world_pos = model * float4(in.position, 1.0);\n"
+      "    out.position = uniforms.view_projection * world_pos;\n"
+      "    out.world_pos = world_pos.xyz;\n"
+      "    out.normal = (model * float4(in.normal, 0.0)).xyz;\n"
+      "    out.texcoord = in.texcoord0;\n"
+      "    out.color = in.color;\n"
+      "    return out;\n"
+      "}\n"
+      "\n"
+      METAL_VERTEX_PULL_SOURCE
+      "\n"
+      "VertexOut transform_pulled(PulledVertex in, float4x4 model,\n"
+      "                           constant Uniforms &uniforms) {\n"
+      "    VertexOut out;\n"
+      "    float4 world_pos = model * float4(in.position, 1.0);\n"
+      "    out.position = uniforms.view_projection * world_pos;\n"
+      "    out.world_pos = world_pos.xyz;\n"
+      "    out.normal = (model * float4(in.normal, 0.0)).xyz;\n"
+      "    out.texcoord = in.texcoord0;\n"
+      "    out.color = in.color;\n"
+      "    return out;\n"
+      "}\n"
+      "\n"
+      "vertex VertexOut vertex_pulled(device const uint *vertices [[buffer(0)]],\n"
+      "                               constant Uniforms &uniforms [[buffer(1)]],\n"
+      "                               uint vertex_id [[vertex_id]],\n"
+      "                               uint base_vertex [[base_vertex]]) {\n"
+      "    PulledVertex in = pull_vertex(vertices, vertex_id, base_vertex);\n"
+      "    return transform_pulled(in, uniforms.model, uniforms);\n"
+      "}\n"
+      "\n"
+      "vertex VertexOut vertex_pulled_instanced(\n"
+      "        device const uint *vertices [[buffer(0)]],\n"
+      "        constant Uniforms &uniforms [[buffer(1)]],\n"
+      "        device const uchar *instances [[buffer(2)]],\n"
+      "        constant InstanceParams &params [[buffer(3)]],\n"
+      "        uint vertex_id [[vertex_id]], uint base_vertex [[base_vertex]],\n"
+      "        uint instance_id [[instance_id]]) {\n"
+      "    PulledVertex in = pull_vertex(vertices, vertex_id, base_vertex);\n"
+      "    float4x4 model = decode_instance(instances, instance_id, params);\n"
+      "    return transform_pulled(in, model, uniforms);\n"
+      "}\n"
+      "\n"
       "fragment float4 fragment_main(VertexOut in [[stage_in]]) {\n"
       "    float3 N = normalize(in.normal);\n"
       "    float3 L = normalize(float3(1.0, 1.0, 0.5));\n"
@@ -302,6 +588,69 @@ static void create_default_pipeline(Candid_Device *device) {
   if (!device->default_pipeline) {
     NSLog(@"Failed to create default pipeline: %@", error);
   }
+  keep_pipeline_descriptor(device, device->default_pipeline, desc);
+
+  /* One specialization of vertex_instanced per instance format */
+  for (uint32_t format = 0; format < CANDID_INSTANCE_FORMAT_COUNT; ++format) {
+    MTLFunctionConstantValues *values = [[MTLFunctionConstantValues alloc] init];
+    [values setConstantValue:&format type:MTLDataTypeUInt atIndex:0];
+
+    id<MTLFunction> instanced_vert =
+        [device->default_library newFunctionWithName:@"vertex_instanced"
+                                      constantValues:values
+                                               error:&error];
+    if (!instanced_vert) {
+      NSLog(@"Failed to specialize instanced vertex shader: %@", error);
+      continue;
+    }
+
+    desc.vertexFunction = instanced_vert;
+    device->instanced_pipelines[format] = [device->mtl_device
+        newRenderPipelineStateWithDescriptor:desc
+                                       error:&error];
+    if (!device->instanced_pipelines[format]) {
+      NSLog(@"Failed to create instanced pipeline: %@", error);
+    }
+    keep_pipeline_descriptor(device, device->instanced_pipelines[format], desc);
+  }
+
+  /* Pulled meshes read any layout from buffer 0, so one pipeline (per
+   * instance format) serves every vertex layout */
+  desc.vertexDescriptor = nil;
+  desc.vertexFunction =
+      [device->default_library newFunctionWithName:@"vertex_pulled"];
+  if (desc.vertexFunction) {
+    device->pulled_pipeline = [device->mtl_device
+        newRenderPipelineStateWithDescriptor:desc
+                                       error:&error];
+  }
+  if (!device->pulled_pipeline) {
+    NSLog(@"Failed to create pulled pipeline: %@", error);
+  }
+  keep_pipeline_descriptor(device, device->pulled_pipeline, desc);
+
+  for (uint32_t format = 0; format < CANDID_INSTANCE_FORMAT_COUNT; ++format) {
+    MTLFunctionConstantValues *values = [[MTLFunctionConstantValues alloc] init];
+    [values setConstantValue:&format type:MTLDataTypeUInt atIndex:0];
+
+    desc.vertexFunction =
+        [device->default_library newFunctionWithName:@"vertex_pulled_instanced"
+                                      constantValues:values
+                                               error:&error];
+    if (!desc.vertexFunction) {
+      NSLog(@"Failed to specialize pulled vertex shader: %@", error);
+      continue;
+    }
+
+    device->pulled_instanced_pipelines[format] = [device->mtl_device
+        newRenderPipelineStateWithDescriptor:desc
+                                       error:&error];
+    if (!device->pulled_instanced_pipelines[format]) {
+      NSLog(@"Failed to create pulled instanced pipeline: %@", error);
+    }
+    keep_pipeline_descriptor(device, device->pulled_instanced_pipelines[format],
+                             desc);
+  }
 
   /* Default depth state */
   MTLDepthStencilDescriptor *depth_desc = [[MTLDepthStencilDescriptor alloc] init];
@@ -311,6 +660,272 @@ static void create_default_pipeline(Candid_Device *device) {
       newDepthStencilStateWithDescriptor:depth_desc];
 }
 
+/*******************************************************************************
+ * Compute Kernels
+ ******************************************************************************/
+
+/* MSL ports of renderer/shaders, compiled on first use. Buffer and texture
+ * indices match the HLSL bindings. */
+static const char *compute_kernel_source =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "\n"
+    METAL_INSTANCE_DECODE_SOURCE
+    "\n"
+    "/* culling.hlsl */\n"
+    "struct CullParams {\n"
+    "    float4 planes[6];\n"
+    "    float4x4 occlusion_view_projection;\n"
+    "    uint object_count;\n"
+    "    uint instance_format;\n"
+    "    uint occlusion;\n"
+    "    uint padding;\n"
+    "};\n"
+    "\n"
+    "struct CullObject {\n"
+    "    float4 sphere;\n"
+    "    uint index_count;\n"
+    "    uint first_index;\n"
+    "    int vertex_offset;\n"
+    "    uint padding;\n"
+    "};\n"
+    "\n"
+    "struct DrawArgs {\n"
+    "    uint index_count;\n"
+    "    uint instance_count;\n"
+    "    uint first_index;\n"
+    "    int vertex_offset;\n"
+    "    uint first_instance;\n"
+    "};\n"
+    "\n"
+    "bool is_occluded(float3 center, float radius, float4x4 view_projection,\n"
+    "                 texture2d<float> pyramid) {\n"
+    "    float2 uv_min = 1.0, uv_max = 0.0;\n"
+    "    float nearest = 1.0;\n"
+    "    for (uint i = 0; i < 8; ++i) {\n"
+    "        float3 corner = center + radius * float3((i & 1) ? 1.0 : -1.0,\n"
+    "                                                 (i & 2) ? 1.0 : -1.0,\n"
+    "                                                 (i & 4) ? 1.0 : -1.0);\n"
+    "        float4 clip = view_projection * float4(corner, 1.0);\n"
+    "        if (clip.w <= 0.0)\n"
+    "            return false;\n"
+    "        float3 ndc = clip.xyz / clip.w;\n"
+    "        float2 uv = float2(ndc.x * 0.5 + 0.5, 0.5 - ndc.y * 0.5);\n"
+    "        uv_min = min(uv_min, uv);\n"
+    "        uv_max = max(uv_max, uv);\n"
+    "        nearest = min(nearest, ndc.z);\n"
+    "    }\n"
+    "    uv_min = saturate(uv_min);\n"
+    "    uv_max = saturate(uv_max);\n"
+    "\n"
+    "    uint2 base = uint2(pyramid.get_width(), pyramid.get_height());\n"
+    "    float2 extent = (uv_max - uv_min) * float2(base);\n"
+    "    uint level = uint(ceil(log2(max(max(extent.x, extent.y), 1.0))));\n"
+    "    level = min(level, pyramid.get_num_mip_levels() - 1);\n"
+    "    uint2 size = max(base >> level, uint2(1));\n"
+    "    uint2 a = min(uint2(uv_min * float2(size)), size - 1);\n"
+    "    uint2 b = min(uint2(uv_max * float2(size)), size - 1);\n"
+    "    float depth = max(max(pyramid.read(a, level).r,\n"
+    "                          pyramid.read(uint2(b.x, a.y), level).r),\n"
+    "                      max(pyramid.read(uint2(a.x, b.y), level).r,\n"
+    "                          pyramid.read(b, level).r));\n"
+    "    return nearest > depth;\n"
+    "}\n"
+    "\n"
+    "kernel void cull_instances(\n"
+    "    constant CullParams &params [[buffer(0)]],\n"
+    "    device const CullObject *objects [[buffer(1)]],\n"
+    "    device DrawArgs *args [[buffer(2)]],\n"
+    "    constant InstanceParams &instance_params [[buffer(3)]],\n"
+    "    device atomic_uint *draw_count [[buffer(4)]],\n"
+    "    device const uchar *instances [[buffer(8)]],\n"
+    "    texture2d<float> pyramid [[texture(5)]],\n"
+    "    uint id [[thread_position_in_grid]]) {\n"
+    "    if (id >= params.object_count)\n"
+    "        return;\n"
+    "\n"
+    "    CullObject object = objects[id];\n"
+    "    float4x4 model = decode_instance_format(instances, id, instance_params,\n"
+    "                                            params.instance_format);\n"
+    "    float3 center = (model * float4(object.sphere.xyz, 1.0)).xyz;\n"
+    "    float scale = max(length(model[0].xyz),\n"
+    "                      max(length(model[1].xyz), length(model[2].xyz)));\n"
+    "    float radius = object.sphere.w * scale;\n"
+    "\n"
+    "    for (uint i = 0; i < 6; ++i) {\n"
+    "        if (dot(params.planes[i].xyz, center) + params.planes[i].w < -radius)\n"
+    "            return;\n"
+    "    }\n"
+    "    if (params.occlusion != 0 &&\n"
+    "        is_occluded(center, radius, params.occlusion_view_projection,\n"
+    "                    pyramid))\n"
+    "        return;\n"
+    "\n"
+    "    uint slot = atomic_fetch_add_explicit(draw_count, 1,\n"
+    "                                          memory_order_relaxed);\n"
+    "    args[slot] = DrawArgs{object.index_count, 1, object.first_index,\n"
+    "                          object.vertex_offset, id};\n"
+    "}\n"
+    "\n"
+    "/* hiz.hlsl */\n"
+    "constant uint HIZ_MAX_LEVELS = 16;\n"
+    "constant uint HIZ_GROUP_SIZE = 16;\n"
+    "constant uint HIZ_TILE = 32;\n"
+    "constant uint HIZ_GROUP_LEVELS = 6;\n"
+    "\n"
+    "uint2 level_size(uint2 base, uint level) {\n"
+    "    return max(base >> level, uint2(1));\n"
+    "}\n"
+    "\n"
+    "float load_depth_max(depth2d<float, access::read> depth, uint2 texel,\n"
+    "                     uint2 depth_size, uint2 base_size) {\n"
+    "    uint2 first = texel * depth_size / base_size;\n"
+    "    uint2 last = min(((texel + 1) * depth_size + base_size - 1) / base_size,\n"
+    "                     depth_size) - 1;\n"
+    "    float d = 0.0;\n"
+    "    for (uint y = first.y; y <= last.y; ++y)\n"
+    "        for (uint x = first.x; x <= last.x; ++x)\n"
+    "            d = max(d, depth.read(uint2(x, y)));\n"
+    "    return d;\n"
+    "}\n"
+    "\n"
+    "float load_scratch(device const uint *scratch, uint offset, uint2 size,\n"
+    "                   uint2 texel) {\n"
+    "    return as_type<float>(scratch[offset + texel.y * size.x + texel.x]);\n"
+    "}\n"
+    "\n"
+    "kernel void downsample_depth(\n"
+    "    depth2d<float, access::read> depth [[texture(0)]],\n"
+    "    texture2d<float, access::write> pyramid [[texture(1)]],\n"
+    "    device uint *scratch [[buffer(2)]],\n"
+    "    uint2 group_id [[threadgroup_position_in_grid]],\n"
+    "    uint2 local_id [[thread_position_in_threadgroup]],\n"
+    "    uint local_index [[thread_index_in_threadgroup]],\n"
+    "    uint2 groups [[threadgroups_per_grid]]) {\n"
+    "    threadgroup float tile[16][16];\n"
+    "    threadgroup bool is_last_group;\n"
+    "\n"
+    "    uint2 depth_size = uint2(depth.get_width(), depth.get_height());\n"
+    "    uint2 base_size = uint2(pyramid.get_width(), pyramid.get_height());\n"
+    "    uint levels = min(32 - clz(max(base_size.x, base_size.y)),\n"
+    "                      HIZ_MAX_LEVELS);\n"
+    "\n"
+    "    uint2 texel1 = group_id * (HIZ_TILE / 2) + local_id;\n"
+    "    float d = 0.0;\n"
+    "    for (uint i = 0; i < 4; ++i) {\n"
+    "        uint2 texel0 = texel1 * 2 + uint2(i & 1, i >> 1);\n"
+    "        if (all(texel0 < base_size)) {\n"
+    "            float v = load_depth_max(depth, texel0, depth_size, base_size);\n"
+    "            pyramid.write(float4(v), texel0, 0);\n"
+    "            d = max(d, v);\n"
+    "        }\n"
+    "    }\n"
+    "    if (levels > 1 && all(texel1 < level_size(base_size, 1)))\n"
+    "        pyramid.write(float4(d), texel1, 1);\n"
+    "    tile[local_id.y][local_id.x] = d;\n"
+    "\n"
+    "    uint size = HIZ_GROUP_SIZE;\n"
+    "    for (uint level = 2; level < HIZ_GROUP_LEVELS; ++level) {\n"
+    "        threadgroup_barrier(mem_flags::mem_threadgroup);\n"
+    "        size /= 2;\n"
+    "        bool active = all(local_id < size);\n"
+    "        if (active) {\n"
+    "            uint2 s = local_id * 2;\n"
+    "            d = max(max(tile[s.y][s.x], tile[s.y][s.x + 1]),\n"
+    "                    max(tile[s.y + 1][s.x], tile[s.y + 1][s.x + 1]));\n"
+    "        }\n"
+    "        threadgroup_barrier(mem_flags::mem_threadgroup);\n"
+    "        if (active) {\n"
+    "            tile[local_id.y][local_id.x] = d;\n"
+    "            uint2 texel = group_id * size + local_id;\n"
+    "            if (level < levels && all(texel < level_size(base_size, level)))\n"
+    "                pyramid.write(float4(d), texel, level);\n"
+    "        }\n"
+    "    }\n"
+    "    if (levels <= HIZ_GROUP_LEVELS)\n"
+    "        return;\n"
+    "\n"
+    "    uint2 src_size = level_size(base_size, HIZ_GROUP_LEVELS - 1);\n"
+    "    uint src_offset = 1;\n"
+    "    if (local_index == 0) {\n"
+    "        scratch[src_offset + group_id.y * src_size.x + group_id.x] =\n"
+    "            as_type<uint>(d);\n"
+    "        atomic_thread_fence(mem_flags::mem_device, memory_order_seq_cst);\n"
+    "        uint done = atomic_fetch_add_explicit(\n"
+    "            (device atomic_uint *)scratch, 1, memory_order_relaxed);\n"
+    "        is_last_group = done == groups.x * groups.y - 1;\n"
+    "    }\n"
+    "    threadgroup_barrier(mem_flags::mem_threadgroup);\n"
+    "    if (!is_last_group)\n"
+    "        return;\n"
+    "    threadgroup_barrier(mem_flags::mem_device);\n"
+    "\n"
+    "    for (uint level = HIZ_GROUP_LEVELS; level < levels; ++level) {\n"
+    "        uint2 dst_size = level_size(base_size, level);\n"
+    "        uint dst_offset = src_offset + src_size.x * src_size.y;\n"
+    "        for (uint i = local_index; i < dst_size.x * dst_size.y;\n"
+    "             i += HIZ_GROUP_SIZE * HIZ_GROUP_SIZE) {\n"
+    "            uint2 texel = uint2(i % dst_size.x, i / dst_size.x);\n"
+    "            uint2 a = min(texel * 2, src_size - 1);\n"
+    "            uint2 b = min(texel * 2 + 1, src_size - 1);\n"
+    "            float v = max(\n"
+    "                max(load_scratch(scratch, src_offset, src_size, a),\n"
+    "                    load_scratch(scratch, src_offset, src_size, uint2(b.x, a.y))),\n"
+    "                max(load_scratch(scratch, src_offset, src_size, uint2(a.x, b.y)),\n"
+    "                    load_scratch(scratch, src_offset, src_size, b)));\n"
+    "            pyramid.write(float4(v), texel, level);\n"
+    "            scratch[dst_offset + i] = as_type<uint>(v);\n"
+    "        }\n"
+    "        threadgroup_barrier(mem_flags::mem_device);\n"
+    "        src_offset = dst_offset;\n"
+    "        src_size = dst_size;\n"
+    "    }\n"
+    "}\n";
+
+static const struct {
+  const char *function;
+  uint32_t workgroup_size[3];
+} compute_kernels[CANDID_COMPUTE_KERNEL_COUNT] = {
+    [CANDID_COMPUTE_KERNEL_CULL_INSTANCES] = {"cull_instances", {64, 1, 1}},
+    [CANDID_COMPUTE_KERNEL_DOWNSAMPLE_DEPTH] = {"downsample_depth", {16, 16, 1}},
+};
+
+static void create_compute_kernel(Candid_Device *device,
+                                  Candid_ComputeKernel kernel) {
+  NSError *error = nil;
+  if (!device->compute_library) {
+    device->compute_library = [device->mtl_device
+        newLibraryWithSource:[NSString stringWithUTF8String:compute_kernel_source]
+                     options:nil
+                       error:&error];
+    if (!device->compute_library) {
+      NSLog(@"Failed to create compute library: %@", error);
+      return;
+    }
+  }
+
+  id<MTLFunction> function = [device->compute_library
+      newFunctionWithName:[NSString stringWithUTF8String:compute_kernels[kernel].function]];
+  if (!function)
+    return;
+
+  Candid_ShaderProgram *program = calloc(1, sizeof(Candid_ShaderProgram));
+  if (!program)
+    return;
+
+  program->compute_state =
+      [device->mtl_device newComputePipelineStateWithFunction:function
+                                                        error:&error];
+  if (!program->compute_state) {
+    NSLog(@"Failed to create compute kernel: %@", error);
+    free(program);
+    return;
+  }
+  const uint32_t *size = compute_kernels[kernel].workgroup_size;
+  program->workgroup_size = MTLSizeMake(size[0], size[1], size[2]);
+  device->kernels[kernel] = program;
+}
+
 /*******************************************************************************
  * Device Functions
  ******************************************************************************/
@@ -334,6 +949,16 @@ static Candid_Result metal_device_create(const Candid_DeviceDesc *desc,
 
   device->layer.device = device->mtl_device;
   device->layer.pixelFormat = MTLPixelFormatBGRA8Unorm;
+  /* Core Animation has no mailbox or relaxed FIFO: the tear-free modes wait
+   * for vblank, IMMEDIATE does not */
+#if TARGET_OS_OSX
+  device->layer.displaySyncEnabled =
+      desc->present_mode != CANDID_PRESENT_MODE_IMMEDIATE;
+#endif
+  /* The layer only takes 2 or 3 drawables */
+  if (desc->swapchain_image_count > 0)
+    device->layer.maximumDrawableCount =
+        desc->swapchain_image_count < 3 ? 2 : 3;
 
   device->command_queue = [device->mtl_device newCommandQueue];
   if (!device->command_queue) {
@@ -341,14 +966,38 @@ static Candid_Result metal_device_create(const Candid_DeviceDesc *desc,
     return CANDID_ERROR_RESOURCE_CREATION;
   }
 
+  device->max_frames_in_flight = desc->max_frames_in_flight;
+  if (device->max_frames_in_flight == 0)
+    device->max_frames_in_flight = 2;
+  if (device->max_frames_in_flight > 3)
+    device->max_frames_in_flight = 3;
+  device->frame_semaphore =
+      dispatch_semaphore_create(device->max_frames_in_flight);
+
+  /* Without these, only async compute is unavailable */
+  device->compute_queue = [device->mtl_device newCommandQueue];
+  for (uint32_t i = 0; i < CANDID_QUEUE_COUNT; ++i)
+    device->queue_events[i] = [device->mtl_device newEvent];
+
   device->width = desc->width;
   device->height = desc->height;
 
+  device->sampled_depth = desc->sampled_depth;
+  if (device->sampled_depth) {
+    device->depth_target = calloc(1, sizeof(Candid_Texture));
+    if (!device->depth_target) {
+      free(device);
+      return CANDID_ERROR_OUT_OF_MEMORY;
+    }
+  }
+
   if (device->width > 0 && device->height > 0) {
     device->layer.drawableSize = CGSizeMake(device->width, device->height);
     create_depth_texture(device);
   }
 
+  device->pipeline_descriptors = [NSMutableDictionary dictionary];
+  device->target_pipelines = [NSMutableDictionary dictionary];
   create_default_pipeline(device);
 
   *out = device;
@@ -360,10 +1009,38 @@ static void metal_device_destroy(Candid_Device *device) {
     return;
 
   device->default_pipeline = nil;
+  device->pulled_pipeline = nil;
+  for (uint32_t i = 0; i < CANDID_INSTANCE_FORMAT_COUNT; ++i) {
+    device->instanced_pipelines[i] = nil;
+    device->pulled_instanced_pipelines[i] = nil;
+  }
+  for (uint32_t i = 0; i < CANDID_COMPUTE_KERNEL_COUNT; ++i) {
+    if (device->kernels[i]) {
+      device->kernels[i]->compute_state = nil;
+      free(device->kernels[i]);
+    }
+  }
+  device->pipeline_descriptors = nil;
+  device->target_pipelines = nil;
+  device->compute_library = nil;
   device->default_library = nil;
   device->default_depth_state = nil;
+  if (device->depth_target) {
+    device->depth_target->mtl_texture = nil;
+    free(device->depth_target);
+  }
   device->depth_texture = nil;
+  for (uint32_t i = 0; i < CANDID_QUEUE_COUNT; ++i)
+    device->queue_events[i] = nil;
+  device->compute_queue = nil;
   device->command_queue = nil;
+  /* libdispatch refuses to free a semaphore below its initial count, so
+   * wait for the frames still in flight */
+  for (uint32_t i = 0; i < device->max_frames_in_flight; ++i)
+    dispatch_semaphore_wait(device->frame_semaphore, DISPATCH_TIME_FOREVER);
+  for (uint32_t i = 0; i < device->max_frames_in_flight; ++i)
+    dispatch_semaphore_signal(device->frame_semaphore);
+  device->frame_semaphore = nil;
   device->mtl_device = nil;
   device->layer = nil;
 
@@ -396,6 +1073,8 @@ static Candid_Result metal_device_get_limits(Candid_Device *device,
   out->supports_tessellation = YES;
   out->supports_compute = YES;
   out->supports_ray_tracing = device->mtl_device.supportsRaytracing;
+  out->supports_async_compute = device->compute_queue != nil;
+  out->supports_indirect_draw = YES;
 
   return CANDID_SUCCESS;
 }
@@ -417,12 +1096,28 @@ static Candid_Result metal_swapchain_resize(Candid_Device *device, uint32_t widt
   return CANDID_SUCCESS;
 }
 
+static Candid_Texture *metal_swapchain_get_depth_texture(Candid_Device *device) {
+  if (!device || !device->depth_target || !device->depth_texture)
+    return NULL;
+  return device->depth_target;
+}
+
 static Candid_Result metal_swapchain_present(Candid_Device *device) {
   (void)device;
   /* Presentation is handled in cmd_submit */
   return CANDID_SUCCESS;
 }
 
+static Candid_Result metal_frame_wait(Candid_Device *device) {
+  if (!device)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  /* Hand the slot straight back: cmd_begin takes it without waiting */
+  dispatch_semaphore_wait(device->frame_semaphore, DISPATCH_TIME_FOREVER);
+  dispatch_semaphore_signal(device->frame_semaphore);
+  return CANDID_SUCCESS;
+}
+
 /*******************************************************************************
  * Buffer Functions
  ******************************************************************************/
@@ -507,16 +1202,8 @@ static void metal_buffer_unmap(Candid_Device *device, Candid_Buffer *buffer) {
  * Texture Functions
  ******************************************************************************/
 
-static Candid_Result metal_texture_create(Candid_Device *device,
-                                          const Candid_TextureDesc *desc,
-                                          Candid_Texture **out) {
-  if (!device || !desc || !out)
-    return CANDID_ERROR_INVALID_ARGUMENT;
-
-  Candid_Texture *texture = calloc(1, sizeof(Candid_Texture));
-  if (!texture)
-    return CANDID_ERROR_OUT_OF_MEMORY;
-
+static MTLTextureDescriptor *
+texture_descriptor(const Candid_TextureDesc *desc) {
   MTLTextureDescriptor *mtl_desc = [[MTLTextureDescriptor alloc] init];
   mtl_desc.width = desc->width;
   mtl_desc.height = desc->height;
@@ -535,8 +1222,21 @@ static Candid_Result metal_texture_create(Candid_Device *device,
   if (desc->usage & CANDID_TEXTURE_USAGE_DEPTH_STENCIL)
     usage |= MTLTextureUsageRenderTarget;
   mtl_desc.usage = usage;
+  return mtl_desc;
+}
+
+static Candid_Result metal_texture_create(Candid_Device *device,
+                                          const Candid_TextureDesc *desc,
+                                          Candid_Texture **out) {
+  if (!device || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
 
-  texture->mtl_texture = [device->mtl_device newTextureWithDescriptor:mtl_desc];
+  Candid_Texture *texture = calloc(1, sizeof(Candid_Texture));
+  if (!texture)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  texture->mtl_texture =
+      [device->mtl_device newTextureWithDescriptor:texture_descriptor(desc)];
   if (!texture->mtl_texture) {
     free(texture);
     return CANDID_ERROR_RESOURCE_CREATION;
@@ -560,6 +1260,80 @@ static void metal_texture_destroy(Candid_Device *device, Candid_Texture *texture
   free(texture);
 }
 
+static Candid_Result metal_heap_create(Candid_Device *device, size_t size,
+                                       Candid_Heap **out) {
+  if (!device || size == 0 || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Heap *heap = calloc(1, sizeof(Candid_Heap));
+  if (!heap)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  /* Tracked, so textures aliasing each other are ordered without explicit
+   * fences */
+  MTLHeapDescriptor *heap_desc = [[MTLHeapDescriptor alloc] init];
+  heap_desc.type = MTLHeapTypePlacement;
+  heap_desc.storageMode = MTLStorageModePrivate;
+  heap_desc.hazardTrackingMode = MTLHazardTrackingModeTracked;
+  heap_desc.size = size;
+
+  heap->mtl_heap = [device->mtl_device newHeapWithDescriptor:heap_desc];
+  if (!heap->mtl_heap) {
+    free(heap);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = heap;
+  return CANDID_SUCCESS;
+}
+
+static void metal_heap_destroy(Candid_Device *device, Candid_Heap *heap) {
+  (void)device;
+  if (!heap)
+    return;
+  heap->mtl_heap = nil;
+  free(heap);
+}
+
+static void metal_texture_get_placement(Candid_Device *device,
+                                        const Candid_TextureDesc *desc,
+                                        size_t *size, size_t *alignment) {
+  MTLTextureDescriptor *mtl_desc = texture_descriptor(desc);
+  mtl_desc.storageMode = MTLStorageModePrivate;
+  MTLSizeAndAlign placement =
+      [device->mtl_device heapTextureSizeAndAlignWithDescriptor:mtl_desc];
+  *size = placement.size;
+  *alignment = placement.align;
+}
+
+static Candid_Result metal_texture_create_placed(
+    Candid_Device *device, const Candid_TextureDesc *desc, Candid_Heap *heap,
+    size_t offset, Candid_Texture **out) {
+  if (!device || !desc || !heap || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Texture *texture = calloc(1, sizeof(Candid_Texture));
+  if (!texture)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  MTLTextureDescriptor *mtl_desc = texture_descriptor(desc);
+  mtl_desc.storageMode = MTLStorageModePrivate;
+  texture->mtl_texture = [heap->mtl_heap newTextureWithDescriptor:mtl_desc
+                                                           offset:offset];
+  if (!texture->mtl_texture) {
+    free(texture);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  texture->desc = *desc;
+  if (desc->label) {
+    texture->mtl_texture.label = [NSString stringWithUTF8String:desc->label];
+  }
+
+  *out = texture;
+  return CANDID_SUCCESS;
+}
+
 static Candid_Result metal_texture_upload(Candid_Device *device,
                                           Candid_Texture *texture,
                                           uint32_t mip_level,
@@ -693,12 +1467,45 @@ static void metal_shader_module_destroy(Candid_Device *device,
   free(module);
 }
 
+static Candid_Result create_compute_program(Candid_Device *device,
+                                            const Candid_ShaderProgramDesc *desc,
+                                            Candid_ShaderProgram **out) {
+  if (desc->compute->stage != CANDID_SHADER_STAGE_COMPUTE)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_ShaderProgram *program = calloc(1, sizeof(Candid_ShaderProgram));
+  if (!program)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  NSError *error = nil;
+  program->compute_state = [device->mtl_device
+      newComputePipelineStateWithFunction:desc->compute->mtl_function
+                                    error:&error];
+  if (!program->compute_state) {
+    NSLog(@"Compute pipeline creation failed: %@", error);
+    free(program);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  /* Metal takes the threadgroup size at dispatch rather than from the shader */
+  const uint32_t *size = desc->workgroup_size;
+  program->workgroup_size = MTLSizeMake(size[0] ? size[0] : 64,
+                                        size[1] ? size[1] : 1,
+                                        size[2] ? size[2] : 1);
+
+  *out = program;
+  return CANDID_SUCCESS;
+}
+
 static Candid_Result metal_shader_program_create(Candid_Device *device,
                                                  const Candid_ShaderProgramDesc *desc,
                                                  Candid_ShaderProgram **out) {
   if (!device || !desc || !out)
     return CANDID_ERROR_INVALID_ARGUMENT;
 
+  if (desc->compute)
+    return create_compute_program(device, desc, out);
+
   if (!desc->vertex || !desc->fragment)
     return CANDID_ERROR_INVALID_ARGUMENT;
 
@@ -723,6 +1530,7 @@ static Candid_Result metal_shader_program_create(Candid_Device *device,
     free(program);
     return CANDID_ERROR_RESOURCE_CREATION;
   }
+  keep_pipeline_descriptor(device, program->pipeline_state, pipeline_desc);
 
   program->vertex = desc->vertex;
   program->fragment = desc->fragment;
@@ -733,13 +1541,24 @@ static Candid_Result metal_shader_program_create(Candid_Device *device,
 
 static void metal_shader_program_destroy(Candid_Device *device,
                                          Candid_ShaderProgram *program) {
-  (void)device;
   if (!program)
     return;
+  if (device)
+    forget_pipeline(device, program->pipeline_state);
   program->pipeline_state = nil;
+  program->compute_state = nil;
   free(program);
 }
 
+static Candid_ShaderProgram *metal_get_compute_kernel(Candid_Device *device,
+                                                      Candid_ComputeKernel kernel) {
+  if (!device || kernel >= CANDID_COMPUTE_KERNEL_COUNT)
+    return NULL;
+  if (!device->kernels[kernel])
+    create_compute_kernel(device, kernel);
+  return device->kernels[kernel];
+}
+
 /*******************************************************************************
  * Mesh Functions
  ******************************************************************************/
@@ -798,14 +1617,64 @@ static Candid_Result metal_mesh_create(Candid_Device *device,
   return CANDID_SUCCESS;
 }
 
+static Candid_Result
+metal_mesh_create_placed(Candid_Device *device, const Candid_MeshDesc *desc,
+                         const Candid_MeshPlacement *placement,
+                         Candid_Mesh **out) {
+  if (!device || !desc || !placement || !placement->vertex_buffer ||
+      !placement->index_buffer || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Mesh *mesh = calloc(1, sizeof(Candid_Mesh));
+  if (!mesh)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  mesh->vertex_buffer = placement->vertex_buffer;
+  mesh->index_buffer = placement->index_buffer;
+  mesh->placed = true;
+  mesh->pulled = desc->storage == CANDID_MESH_STORAGE_PULLED;
+  mesh->vertex_offset = placement->vertex_offset;
+  mesh->first_index = placement->first_index;
+  mesh->vertex_count = (uint32_t)desc->data.vertex_count;
+  mesh->index_count = (uint32_t)desc->data.index_count;
+  mesh->index_format = desc->data.index_format;
+  mesh->layout = desc->data.layout;
+  mesh->bounds = desc->bounds;
+
+  *out = mesh;
+  return CANDID_SUCCESS;
+}
+
+static void metal_mesh_set_placement(Candid_Mesh *mesh,
+                                     const Candid_MeshPlacement *placement) {
+  if (!mesh || !mesh->placed || !placement)
+    return;
+  mesh->vertex_buffer = placement->vertex_buffer;
+  mesh->index_buffer = placement->index_buffer;
+  mesh->vertex_offset = placement->vertex_offset;
+  mesh->first_index = placement->first_index;
+}
+
 static void metal_mesh_destroy(Candid_Device *device, Candid_Mesh *mesh) {
   if (!mesh)
     return;
-  metal_buffer_destroy(device, mesh->vertex_buffer);
-  metal_buffer_destroy(device, mesh->index_buffer);
+  if (!mesh->placed) {
+    metal_buffer_destroy(device, mesh->vertex_buffer);
+    metal_buffer_destroy(device, mesh->index_buffer);
+  }
   free(mesh);
 }
 
+static void metal_mesh_get_draw_info(Candid_Mesh *mesh,
+                                     Candid_MeshDrawInfo *out) {
+  if (!mesh || !out)
+    return;
+  out->geometry = mesh->placed ? (const void *)mesh->vertex_buffer : mesh;
+  out->index_count = mesh->index_count;
+  out->first_index = mesh->first_index;
+  out->vertex_offset = mesh->vertex_offset;
+}
+
 /*******************************************************************************
  * Material Functions
  ******************************************************************************/
@@ -820,22 +1689,197 @@ static Candid_Result metal_material_create(Candid_Device *device,
   if (!material)
     return CANDID_ERROR_OUT_OF_MEMORY;
 
-  material->desc = *desc;
   material->shader = desc->shader;
 
   *out = material;
   return CANDID_SUCCESS;
 }
 
+static Candid_Result metal_material_create_instance(Candid_Device *device,
+                                                    Candid_Material *base,
+                                                    Candid_Material **out) {
+  if (!device || !base || base->base || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Material *material = calloc(1, sizeof(Candid_Material));
+  if (!material)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  material->shader = base->shader;
+  material->base = base;
+  material->table_index = base->table_index;
+
+  *out = material;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Material *metal_material_get_base(Candid_Material *material) {
+  return material && material->base ? material->base : material;
+}
+
 static void metal_material_destroy(Candid_Device *device,
                                    Candid_Material *material) {
   (void)device;
   if (!material)
     return;
-  material->uniform_buffer = nil;
   free(material);
 }
 
+/*******************************************************************************
+ * Bindless Functions
+ ******************************************************************************/
+
+static Candid_Result metal_texture_table_create(Candid_Device *device,
+                                                uint32_t capacity,
+                                                Candid_TextureTable **out) {
+  if (!device || !out || capacity == 0)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  /* Resource IDs in plain buffers need Metal 3 */
+  if (![device->mtl_device supportsFamily:MTLGPUFamilyMetal3])
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  Candid_TextureTable *table = calloc(1, sizeof(Candid_TextureTable));
+  if (!table)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  table->entries = calloc(capacity, sizeof(Candid_Texture *));
+  if (!table->entries) {
+    free(table);
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  }
+  table->capacity = capacity;
+
+  /* Shared storage starts zeroed */
+  table->ids = [device->mtl_device newBufferWithLength:capacity * sizeof(MTLResourceID)
+                                               options:MTLResourceStorageModeShared];
+  MTLSamplerDescriptor *sampler_desc = [[MTLSamplerDescriptor alloc] init];
+  sampler_desc.minFilter = MTLSamplerMinMagFilterLinear;
+  sampler_desc.magFilter = MTLSamplerMinMagFilterLinear;
+  sampler_desc.mipFilter = MTLSamplerMipFilterLinear;
+  sampler_desc.sAddressMode = MTLSamplerAddressModeRepeat;
+  sampler_desc.tAddressMode = MTLSamplerAddressModeRepeat;
+  sampler_desc.maxAnisotropy = 8;
+  table->sampler = [device->mtl_device newSamplerStateWithDescriptor:sampler_desc];
+  if (!table->ids || !table->sampler) {
+    table->ids = nil;
+    table->sampler = nil;
+    free(table->entries);
+    free(table);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+  table->ids.label = @"Candid Texture Table";
+  table->resident = @[];
+
+  *out = table;
+  return CANDID_SUCCESS;
+}
+
+static void metal_texture_table_destroy(Candid_Device *device,
+                                        Candid_TextureTable *table) {
+  (void)device;
+  if (!table)
+    return;
+  table->ids = nil;
+  table->resident = nil;
+  table->sampler = nil;
+  free(table->resident_list);
+  free(table->entries);
+  free(table);
+}
+
+static void metal_texture_table_set(Candid_Device *device,
+                                    Candid_TextureTable *table, uint32_t index,
+                                    Candid_Texture *texture) {
+  (void)device;
+  if (!table || index >= table->capacity)
+    return;
+
+  /* A cleared entry keeps its stale ID: no live material points at it, and
+   * frames in flight still holding one keep the texture resident */
+  if (texture) {
+    MTLResourceID resource_id = texture->mtl_texture.gpuResourceID;
+    memcpy((uint8_t *)table->ids.contents + index * sizeof(MTLResourceID),
+           &resource_id, sizeof(resource_id));
+  }
+  table->entries[index] = texture;
+  table->dirty = true;
+}
+
+static void update_residency(Candid_TextureTable *table) {
+  NSMutableArray<id<MTLTexture>> *resident = [NSMutableArray array];
+  for (uint32_t i = 0; i < table->capacity; ++i) {
+    if (table->entries[i])
+      [resident addObject:table->entries[i]->mtl_texture];
+  }
+
+  __unsafe_unretained id<MTLResource> *list =
+      malloc((resident.count ? resident.count : 1) * sizeof(id<MTLResource>));
+  if (!list)
+    return; /* Retried at the next bind */
+  for (NSUInteger i = 0; i < resident.count; ++i) {
+    list[i] = resident[i];
+  }
+
+  free(table->resident_list);
+  table->resident_list = list;
+  table->resident = resident;
+  table->dirty = false;
+}
+
+static void metal_cmd_bind_bindless(Candid_CommandBuffer *cmd,
+                                    Candid_TextureTable *table,
+                                    Candid_Buffer *materials) {
+  if (!cmd || !cmd->render_encoder || !table)
+    return;
+  if (table->dirty)
+    update_residency(table);
+
+  id<MTLRenderCommandEncoder> encoder = cmd->render_encoder;
+  [encoder setFragmentBuffer:table->ids offset:0 atIndex:METAL_BINDLESS_TEXTURES_SLOT];
+  [encoder setFragmentSamplerState:table->sampler atIndex:METAL_BINDLESS_SAMPLER_SLOT];
+  if (materials) {
+    [encoder setFragmentBuffer:materials->mtl_buffer
+                        offset:0
+                       atIndex:METAL_BINDLESS_MATERIALS_SLOT];
+  }
+  if (table->resident.count > 0) {
+    [encoder useResources:table->resident_list
+                    count:table->resident.count
+                    usage:MTLResourceUsageRead
+                   stages:MTLRenderStageFragment];
+  }
+
+  /* Textures cleared from the table while this frame is in flight stay
+   * alive until it completes */
+  NSArray<id<MTLTexture>> *resident = table->resident;
+  [cmd->mtl_command_buffer addCompletedHandler:^(id<MTLCommandBuffer> buffer) {
+    (void)buffer;
+    (void)resident;
+  }];
+
+  cmd->bindless = true;
+  cmd->bound_material_index = UINT32_MAX;
+}
+
+static void metal_material_set_table_index(Candid_Material *material,
+                                           uint32_t index) {
+  if (material)
+    material->table_index = index;
+}
+
+/* Select the draw's record in the bound material table */
+static void bind_material_index(Candid_CommandBuffer *cmd,
+                                const Candid_Material *material) {
+  if (!cmd->bindless)
+    return;
+  uint32_t index = material ? material->table_index : 0;
+  if (index == cmd->bound_material_index)
+    return;
+  [cmd->render_encoder setFragmentBytes:&index
+                                 length:sizeof(index)
+                                atIndex:METAL_BINDLESS_MATERIAL_INDEX_SLOT];
+  cmd->bound_material_index = index;
+}
+
 /*******************************************************************************
  * Command Buffer Functions
  ******************************************************************************/
@@ -849,10 +1893,14 @@ static Candid_Result metal_cmd_begin(Candid_Device *device,
   if (!cmd)
     return CANDID_ERROR_OUT_OF_MEMORY;
 
+  /* The only wait on the GPU: for the frame that last used this slot */
+  dispatch_semaphore_wait(device->frame_semaphore, DISPATCH_TIME_FOREVER);
+
   cmd->device = device;
   cmd->mtl_command_buffer = [device->command_queue commandBuffer];
 
   if (!cmd->mtl_command_buffer) {
+    dispatch_semaphore_signal(device->frame_semaphore);
     free(cmd);
     return CANDID_ERROR_RESOURCE_CREATION;
   }
@@ -861,12 +1909,33 @@ static Candid_Result metal_cmd_begin(Candid_Device *device,
   return CANDID_SUCCESS;
 }
 
+/* Compute work outside render passes shares one encoder until the next pass */
+static id<MTLComputeCommandEncoder> compute_encoder(Candid_CommandBuffer *cmd) {
+  if (cmd->render_encoder)
+    return nil;
+  if (!cmd->compute_encoder) {
+    cmd->compute_encoder = [cmd->mtl_command_buffer computeCommandEncoder];
+    if (cmd->compute_encoder && cmd->compute_program)
+      [cmd->compute_encoder
+          setComputePipelineState:cmd->compute_program->compute_state];
+  }
+  return cmd->compute_encoder;
+}
+
+static void end_compute_encoding(Candid_CommandBuffer *cmd) {
+  if (!cmd->compute_encoder)
+    return;
+  [cmd->compute_encoder endEncoding];
+  cmd->compute_encoder = nil;
+}
+
 static Candid_Result metal_cmd_end(Candid_Device *device,
                                    Candid_CommandBuffer *cmd) {
   (void)device;
   if (!cmd)
     return CANDID_ERROR_INVALID_ARGUMENT;
 
+  end_compute_encoding(cmd);
   if (cmd->render_encoder) {
     [cmd->render_encoder endEncoding];
     cmd->render_encoder = nil;
@@ -877,19 +1946,31 @@ static Candid_Result metal_cmd_end(Candid_Device *device,
 
 static Candid_Result metal_cmd_submit(Candid_Device *device,
                                       Candid_CommandBuffer *cmd) {
-  (void)device;
-  if (!cmd)
+  if (!device || !cmd)
     return CANDID_ERROR_INVALID_ARGUMENT;
 
   if (cmd->drawable) {
     [cmd->mtl_command_buffer presentDrawable:cmd->drawable];
   }
 
+  dispatch_semaphore_t frames = device->frame_semaphore;
+  [cmd->mtl_command_buffer addCompletedHandler:^(id<MTLCommandBuffer> buffer) {
+    (void)buffer;
+    dispatch_semaphore_signal(frames);
+  }];
+
+  id<MTLEvent> event = device->queue_events[CANDID_QUEUE_GRAPHICS];
+  if (event)
+    [cmd->mtl_command_buffer
+        encodeSignalEvent:event
+                    value:++device->queue_values[CANDID_QUEUE_GRAPHICS]];
+
   [cmd->mtl_command_buffer commit];
 
   /* Clean up */
   cmd->mtl_command_buffer = nil;
   cmd->drawable = nil;
+  cmd->bound_pipeline = nil;
   free(cmd);
 
   return CANDID_SUCCESS;
@@ -903,6 +1984,8 @@ static Candid_Result metal_cmd_begin_render_pass(Candid_CommandBuffer *cmd,
   if (!cmd || !cmd->device)
     return CANDID_ERROR_INVALID_ARGUMENT;
 
+  end_compute_encoding(cmd);
+
   @autoreleasepool {
     cmd->drawable = [cmd->device->layer nextDrawable];
     if (!cmd->drawable)
@@ -924,23 +2007,147 @@ static Candid_Result metal_cmd_begin_render_pass(Candid_CommandBuffer *cmd,
     if (cmd->device->depth_texture) {
       pass_desc.depthAttachment.texture = cmd->device->depth_texture;
       pass_desc.depthAttachment.loadAction = MTLLoadActionClear;
-      pass_desc.depthAttachment.storeAction = MTLStoreActionDontCare;
+      pass_desc.depthAttachment.storeAction = cmd->device->sampled_depth
+                                                  ? MTLStoreActionStore
+                                                  : MTLStoreActionDontCare;
       pass_desc.depthAttachment.clearDepth = (double)clear_depth;
     }    cmd->render_encoder =
         [cmd->mtl_command_buffer renderCommandEncoderWithDescriptor:pass_desc];
 
     if (!cmd->render_encoder)
       return CANDID_ERROR_RESOURCE_CREATION;
+    cmd->bound_geometry = NULL;
+    cmd->target_pass = false;
   }
 
   return CANDID_SUCCESS;
 }
 
+static MTLLoadAction load_action_to_mtl(Candid_LoadAction action) {
+  switch (action) {
+  case CANDID_LOAD_ACTION_LOAD:
+    return MTLLoadActionLoad;
+  case CANDID_LOAD_ACTION_DONT_CARE:
+    return MTLLoadActionDontCare;
+  default:
+    return MTLLoadActionClear;
+  }
+}
+
+static Candid_Result
+metal_cmd_begin_render_pass_targets(Candid_CommandBuffer *cmd,
+                                    const Candid_RenderPassDesc *desc) {
+  if (!cmd || !desc || (!desc->color && !desc->depth) || cmd->render_encoder)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  end_compute_encoding(cmd);
+
+  MTLRenderPassDescriptor *pass_desc = [MTLRenderPassDescriptor renderPassDescriptor];
+  cmd->color_format = MTLPixelFormatInvalid;
+  cmd->depth_format = MTLPixelFormatInvalid;
+
+  if (desc->color) {
+    const Candid_Color *clear = &desc->clear_color;
+    pass_desc.colorAttachments[0].texture = desc->color->mtl_texture;
+    pass_desc.colorAttachments[0].loadAction = load_action_to_mtl(desc->color_load);
+    pass_desc.colorAttachments[0].storeAction = MTLStoreActionStore;
+    pass_desc.colorAttachments[0].clearColor = MTLClearColorMake(
+        (double)clear->r, (double)clear->g, (double)clear->b, (double)clear->a);
+    cmd->color_format = desc->color->mtl_texture.pixelFormat;
+  }
+
+  if (desc->depth) {
+    id<MTLTexture> depth = desc->depth->mtl_texture;
+    MTLLoadAction load = load_action_to_mtl(desc->depth_load);
+    MTLStoreAction store =
+        desc->discard_depth ? MTLStoreActionDontCare : MTLStoreActionStore;
+    pass_desc.depthAttachment.texture = depth;
+    pass_desc.depthAttachment.loadAction = load;
+    pass_desc.depthAttachment.storeAction = store;
+    pass_desc.depthAttachment.clearDepth = (double)desc->clear_depth;
+    if (depth.pixelFormat == MTLPixelFormatDepth24Unorm_Stencil8) {
+      pass_desc.stencilAttachment.texture = depth;
+      pass_desc.stencilAttachment.loadAction = load;
+      pass_desc.stencilAttachment.storeAction = store;
+      pass_desc.stencilAttachment.clearStencil = desc->clear_stencil;
+    }
+    cmd->depth_format = depth.pixelFormat;
+  }
+
+  cmd->render_encoder =
+      [cmd->mtl_command_buffer renderCommandEncoderWithDescriptor:pass_desc];
+  if (!cmd->render_encoder)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  /* Pipelines are rebuilt for these formats on bind */
+  cmd->target_pass = true;
+  cmd->bound_pipeline = nil;
+  cmd->bound_geometry = NULL;
+  return CANDID_SUCCESS;
+}
+
 static void metal_cmd_end_render_pass(Candid_CommandBuffer *cmd) {
   if (!cmd || !cmd->render_encoder)
     return;
   [cmd->render_encoder endEncoding];
   cmd->render_encoder = nil;
+  cmd->target_pass = false;
+  cmd->bindless = false; /* Bound to the encoder */
+}
+
+/**
+ * The variant of a pipeline for the attachment formats of the active pass:
+ * the pipeline itself in the frame pass, nil if it cannot be built
+ */
+static id<MTLRenderPipelineState>
+pass_pipeline(Candid_CommandBuffer *cmd, id<MTLRenderPipelineState> pipeline) {
+  Candid_Device *device = cmd->device;
+  if (!pipeline || !cmd->target_pass ||
+      (cmd->color_format == device->layer.pixelFormat &&
+       cmd->depth_format == MTLPixelFormatDepth32Float))
+    return pipeline;
+
+  NSValue *key = pipeline_key(pipeline);
+  NSNumber *formats =
+      @(((uint64_t)cmd->color_format << 32) | (uint64_t)cmd->depth_format);
+  NSMutableDictionary<NSNumber *, id<MTLRenderPipelineState>> *variants =
+      device->target_pipelines[key];
+  id<MTLRenderPipelineState> variant = variants[formats];
+  if (variant)
+    return variant;
+
+  MTLRenderPipelineDescriptor *desc = [device->pipeline_descriptors[key] copy];
+  if (!desc)
+    return nil;
+  desc.colorAttachments[0].pixelFormat = cmd->color_format;
+  desc.depthAttachmentPixelFormat = cmd->depth_format;
+  desc.stencilAttachmentPixelFormat =
+      cmd->depth_format == MTLPixelFormatDepth24Unorm_Stencil8
+          ? cmd->depth_format
+          : MTLPixelFormatInvalid;
+
+  NSError *error = nil;
+  variant = [device->mtl_device newRenderPipelineStateWithDescriptor:desc
+                                                               error:&error];
+  if (!variant) {
+    NSLog(@"Failed to create pipeline for render targets: %@", error);
+    return nil;
+  }
+  if (!variants) {
+    variants = [NSMutableDictionary dictionary];
+    device->target_pipelines[key] = variants;
+  }
+  variants[formats] = variant;
+  return variant;
+}
+
+static bool set_pipeline(Candid_CommandBuffer *cmd,
+                         id<MTLRenderPipelineState> pipeline) {
+  id<MTLRenderPipelineState> state = pass_pipeline(cmd, pipeline);
+  if (!state)
+    return false;
+  [cmd->render_encoder setRenderPipelineState:state];
+  return true;
 }
 
 static void metal_cmd_set_viewport(Candid_CommandBuffer *cmd, float x, float y,
@@ -970,12 +2177,15 @@ static void metal_cmd_bind_pipeline(Candid_CommandBuffer *cmd,
     return;
 
   if (program && program->pipeline_state) {
-    [cmd->render_encoder setRenderPipelineState:program->pipeline_state];
-  } else if (cmd->device->default_pipeline) {
-    [cmd->render_encoder setRenderPipelineState:cmd->device->default_pipeline];
+    cmd->bound_pipeline = program->pipeline_state;
+  } else {
+    cmd->bound_pipeline = cmd->device->default_pipeline;
   }
+  if (cmd->bound_pipeline && !set_pipeline(cmd, cmd->bound_pipeline))
+    cmd->bound_pipeline = nil;
 
-  if (cmd->device->default_depth_state) {
+  if (cmd->device->default_depth_state &&
+      (!cmd->target_pass || cmd->depth_format != MTLPixelFormatInvalid)) {
     [cmd->render_encoder setDepthStencilState:cmd->device->default_depth_state];
   }
 
@@ -1019,24 +2229,31 @@ static void metal_cmd_bind_vertex_buffer(Candid_CommandBuffer *cmd, uint32_t slo
   [cmd->render_encoder setVertexBuffer:buffer->mtl_buffer
                                 offset:offset
                                atIndex:slot];
+  if (slot == 0)
+    cmd->bound_geometry = NULL;
 }
 
 static void metal_cmd_bind_index_buffer(Candid_CommandBuffer *cmd,
                                         Candid_Buffer *buffer, size_t offset,
                                         Candid_IndexFormat format) {
-  (void)cmd;
-  (void)buffer;
-  (void)offset;
-  (void)format;
+  if (!cmd)
+    return;
   /* Index buffer is bound at draw time in Metal */
+  cmd->index_buffer = buffer;
+  cmd->index_offset = offset;
+  cmd->index_format = format;
 }
 
 static void metal_cmd_bind_uniform_buffer(Candid_CommandBuffer *cmd,
                                           uint32_t slot, Candid_Buffer *buffer,
                                           size_t offset, size_t size) {
   (void)size;
-  if (!cmd || !cmd->render_encoder || !buffer)
+  if (!cmd || !buffer)
+    return;
+  if (!cmd->render_encoder) {
+    [compute_encoder(cmd) setBuffer:buffer->mtl_buffer offset:offset atIndex:slot];
     return;
+  }
   [cmd->render_encoder setVertexBuffer:buffer->mtl_buffer offset:offset atIndex:slot];
   [cmd->render_encoder setFragmentBuffer:buffer->mtl_buffer offset:offset atIndex:slot];
 }
@@ -1044,8 +2261,17 @@ static void metal_cmd_bind_uniform_buffer(Candid_CommandBuffer *cmd,
 static void metal_cmd_bind_texture(Candid_CommandBuffer *cmd, uint32_t slot,
                                    Candid_Texture *texture,
                                    Candid_Sampler *sampler) {
-  if (!cmd || !cmd->render_encoder)
+  if (!cmd)
+    return;
+
+  if (!cmd->render_encoder) {
+    id<MTLComputeCommandEncoder> encoder = compute_encoder(cmd);
+    if (texture)
+      [encoder setTexture:texture->mtl_texture atIndex:slot];
+    if (sampler)
+      [encoder setSamplerState:sampler->mtl_sampler atIndex:slot];
     return;
+  }
 
   if (texture) {
     [cmd->render_encoder setFragmentTexture:texture->mtl_texture atIndex:slot];
@@ -1083,68 +2309,139 @@ static void metal_cmd_draw(Candid_CommandBuffer *cmd, uint32_t vertex_count,
                          baseInstance:first_instance];
 }
 
+static MTLIndexType index_format_to_mtl(Candid_IndexFormat format) {
+  return format == CANDID_INDEX_FORMAT_UINT16 ? MTLIndexTypeUInt16
+                                              : MTLIndexTypeUInt32;
+}
+
 static void metal_cmd_draw_indexed(Candid_CommandBuffer *cmd, uint32_t index_count,
                                    uint32_t instance_count, uint32_t first_index,
                                    int32_t vertex_offset,
                                    uint32_t first_instance) {
-  (void)cmd;
-  (void)index_count;
-  (void)instance_count;
-  (void)first_index;
-  (void)vertex_offset;
-  (void)first_instance;
-  /* Requires bound index buffer - see draw_mesh for complete implementation */
+  if (!cmd || !cmd->render_encoder || !cmd->index_buffer)
+    return;
+
+  size_t index_size = cmd->index_format == CANDID_INDEX_FORMAT_UINT16 ? 2 : 4;
+  [cmd->render_encoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
+                                  indexCount:index_count
+                                   indexType:index_format_to_mtl(cmd->index_format)
+                                 indexBuffer:cmd->index_buffer->mtl_buffer
+                           indexBufferOffset:cmd->index_offset + first_index * index_size
+                               instanceCount:instance_count
+                                  baseVertex:vertex_offset
+                                baseInstance:first_instance];
 }
 
-static void metal_cmd_draw_mesh(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
-                                Candid_Material *material,
-                                const Candid_Mat4 *transform) {
-  if (!cmd || !cmd->render_encoder || !mesh)
+static void metal_cmd_draw_indexed_indirect(Candid_CommandBuffer *cmd,
+                                            Candid_Buffer *buffer, size_t offset,
+                                            uint32_t draw_count, uint32_t stride) {
+  if (!cmd || !cmd->render_encoder || !cmd->index_buffer || !buffer)
     return;
 
-  /* Bind vertex buffer */
-  [cmd->render_encoder setVertexBuffer:mesh->vertex_buffer->mtl_buffer
-                                offset:0
-                               atIndex:0];
+  /* One call per record: Metal has no multi-draw outside indirect command
+   * buffers, but the arguments never round-trip through the CPU. */
+  for (uint32_t i = 0; i < draw_count; ++i) {
+    [cmd->render_encoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
+                                     indexType:index_format_to_mtl(cmd->index_format)
+                                   indexBuffer:cmd->index_buffer->mtl_buffer
+                             indexBufferOffset:cmd->index_offset
+                                indirectBuffer:buffer->mtl_buffer
+                          indirectBufferOffset:offset + (size_t)i * stride];
+  }
+}
 
-  /* Bind uniforms with transform */
-  struct {
-    float model[16];
-    float view_projection[16];
-    float time;
-    float padding[3];
-  } uniforms;
+static void metal_cmd_draw_indexed_indirect_count(
+    Candid_CommandBuffer *cmd, Candid_Buffer *buffer, size_t offset,
+    Candid_Buffer *count_buffer, size_t count_offset, uint32_t max_draw_count,
+    uint32_t stride) {
+  /* The count cannot be read on the GPU timeline; records past it carry
+   * instance_count 0 and draw nothing. */
+  (void)count_buffer;
+  (void)count_offset;
+  metal_cmd_draw_indexed_indirect(cmd, buffer, offset, max_draw_count, stride);
+}
 
+static void fill_draw_uniforms(const Candid_Device *device,
+                               const Candid_Mat4 *transform,
+                               Candid_MetalDrawUniforms *uniforms) {
   if (transform) {
-    memcpy(uniforms.model, transform->m, sizeof(uniforms.model));
+    memcpy(uniforms->model, transform->m, sizeof(uniforms->model));
   } else {
     /* Identity matrix */
-    memset(uniforms.model, 0, sizeof(uniforms.model));
-    uniforms.model[0] = uniforms.model[5] = uniforms.model[10] = uniforms.model[15] = 1.0f;
+    memset(uniforms->model, 0, sizeof(uniforms->model));
+    uniforms->model[0] = uniforms->model[5] = uniforms->model[10] = uniforms->model[15] = 1.0f;
   }
 
   /* Simple view-projection (this should come from camera in real usage) */
-  memset(uniforms.view_projection, 0, sizeof(uniforms.view_projection));
-  float aspect = (cmd->device->width > 0 && cmd->device->height > 0)
-                     ? (float)cmd->device->width / (float)cmd->device->height
+  memset(uniforms->view_projection, 0, sizeof(uniforms->view_projection));
+  float aspect = (device->width > 0 && device->height > 0)
+                     ? (float)device->width / (float)device->height
                      : 1.0f;
   float fov = 65.0f * (float)M_PI / 180.0f;
   float near = 0.1f;
   float far = 100.0f;
   float f = 1.0f / tanf(fov * 0.5f);
 
-  uniforms.view_projection[0] = f / aspect;
-  uniforms.view_projection[5] = f;
-  uniforms.view_projection[10] = (far + near) / (near - far);
-  uniforms.view_projection[11] = -1.0f;
-  uniforms.view_projection[14] = (2.0f * far * near) / (near - far);
+  uniforms->view_projection[0] = f / aspect;
+  uniforms->view_projection[5] = f;
+  uniforms->view_projection[10] = (far + near) / (near - far);
+  uniforms->view_projection[11] = -1.0f;
+  uniforms->view_projection[14] = (2.0f * far * near) / (near - far);
 
-  uniforms.time = 0.0f;
+  uniforms->time = 0.0f;
+  memset(uniforms->padding, 0, sizeof(uniforms->padding));
+}
 
+/* Meshes sharing geometry keep it bound; draws select their range with
+ * baseVertex and the index buffer offset */
+static void bind_mesh_vertices(Candid_CommandBuffer *cmd, Candid_Mesh *mesh) {
+  if (cmd->bound_geometry == mesh->vertex_buffer)
+    return;
+  [cmd->render_encoder setVertexBuffer:mesh->vertex_buffer->mtl_buffer
+                                offset:0
+                               atIndex:0];
+  cmd->bound_geometry = mesh->vertex_buffer;
+}
+
+static NSUInteger mesh_index_offset(const Candid_Mesh *mesh) {
+  size_t index_size = (mesh->index_format == CANDID_INDEX_FORMAT_UINT16)
+                          ? sizeof(uint16_t)
+                          : sizeof(uint32_t);
+  return (NSUInteger)mesh->first_index * index_size;
+}
+
+/* Leave the encoder in the state the caller last bound */
+static void restore_pipeline(Candid_CommandBuffer *cmd,
+                             id<MTLRenderPipelineState> pipeline) {
+  if (cmd->bound_pipeline && pipeline != cmd->bound_pipeline)
+    set_pipeline(cmd, cmd->bound_pipeline);
+}
+
+static void metal_cmd_draw_mesh(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
+                                Candid_Material *material,
+                                const Candid_Mat4 *transform) {
+  if (!cmd || !cmd->render_encoder || !cmd->bound_pipeline || !mesh)
+    return;
+
+  /* The built-in pipeline has fixed vertex input; pulled meshes use its
+   * vertex-pulling twin. Custom programs must match the mesh's storage. */
+  id<MTLRenderPipelineState> pipeline = cmd->bound_pipeline;
+  if (mesh->pulled && pipeline == cmd->device->default_pipeline) {
+    pipeline = cmd->device->pulled_pipeline;
+    if (!pipeline || !set_pipeline(cmd, pipeline))
+      return;
+  }
+
+  /* Bind vertex buffer */
+  bind_mesh_vertices(cmd, mesh);
+
+  /* Bind uniforms with transform */
+  Candid_MetalDrawUniforms uniforms;
+  fill_draw_uniforms(cmd->device, transform, &uniforms);
   [cmd->render_encoder setVertexBytes:&uniforms length:sizeof(uniforms) atIndex:1];
 
   /* Apply material settings */
-  (void)material;
+  bind_material_index(cmd, material);
 
   /* Draw indexed */
   MTLIndexType index_type = (mesh->index_format == CANDID_INDEX_FORMAT_UINT16)
@@ -1155,16 +2452,244 @@ static void metal_cmd_draw_mesh(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
                                   indexCount:mesh->index_count
                                    indexType:index_type
                                  indexBuffer:mesh->index_buffer->mtl_buffer
-                           indexBufferOffset:0];
+                           indexBufferOffset:mesh_index_offset(mesh)
+                               instanceCount:1
+                                  baseVertex:mesh->vertex_offset
+                                baseInstance:0];
+
+  restore_pipeline(cmd, pipeline);
+}
+
+/**
+ * Bind the pipeline, geometry and instance data of an instanced draw
+ * @return The pipeline now bound, or nil if the draw must be skipped
+ */
+static id<MTLRenderPipelineState>
+bind_instanced_draw(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
+                    Candid_Material *material, Candid_InstanceFormat format,
+                    Candid_Buffer *instances, size_t offset,
+                    const Candid_InstanceQuantization *quantization) {
+  /* Custom programs decode instances themselves; otherwise use the built-in
+   * specialization for this format. */
+  id<MTLRenderPipelineState> pipeline =
+      mesh->pulled ? cmd->device->pulled_instanced_pipelines[format]
+                   : cmd->device->instanced_pipelines[format];
+  if (material && material->shader && material->shader->pipeline_state)
+    pipeline = material->shader->pipeline_state;
+  if (!pipeline)
+    return nil;
+  if (pipeline != cmd->bound_pipeline && !set_pipeline(cmd, pipeline))
+    return nil;
+
+  bind_mesh_vertices(cmd, mesh);
+  bind_material_index(cmd, material);
+
+  Candid_MetalDrawUniforms uniforms;
+  fill_draw_uniforms(cmd->device, NULL, &uniforms);
+  [cmd->render_encoder setVertexBytes:&uniforms length:sizeof(uniforms) atIndex:1];
+
+  [cmd->render_encoder setVertexBuffer:instances->mtl_buffer
+                                offset:offset
+                               atIndex:2];
+
+  Candid_InstanceQuantization params = {0};
+  if (quantization)
+    params = *quantization;
+  [cmd->render_encoder setVertexBytes:&params length:sizeof(params) atIndex:3];
+
+  return pipeline;
+}
+
+static void metal_cmd_draw_mesh_instanced(
+    Candid_CommandBuffer *cmd, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, Candid_Buffer *instances, size_t offset,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization) {
+  if (!cmd || !cmd->render_encoder || !mesh || !instances ||
+      format >= CANDID_INSTANCE_FORMAT_COUNT || instance_count == 0)
+    return;
+
+  id<MTLRenderPipelineState> pipeline = bind_instanced_draw(
+      cmd, mesh, material, format, instances, offset, quantization);
+  if (!pipeline)
+    return;
+
+  [cmd->render_encoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
+                                  indexCount:mesh->index_count
+                                   indexType:index_format_to_mtl(mesh->index_format)
+                                 indexBuffer:mesh->index_buffer->mtl_buffer
+                           indexBufferOffset:mesh_index_offset(mesh)
+                               instanceCount:instance_count
+                                  baseVertex:mesh->vertex_offset
+                                baseInstance:0];
+
+  restore_pipeline(cmd, pipeline);
+}
+
+static void metal_cmd_draw_mesh_indirect(Candid_CommandBuffer *cmd,
+                                         Candid_Mesh *mesh,
+                                         Candid_Material *material,
+                                         const Candid_IndirectDraw *draw) {
+  if (!cmd || !cmd->render_encoder || !mesh || !draw || !draw->args ||
+      !draw->instances || draw->format >= CANDID_INSTANCE_FORMAT_COUNT)
+    return;
+
+  id<MTLRenderPipelineState> pipeline =
+      bind_instanced_draw(cmd, mesh, material, draw->format, draw->instances,
+                          draw->instance_offset, draw->quantization);
+  if (!pipeline)
+    return;
+
+  /* instance_id includes the record's base instance, which selects its
+   * instance data. Records carry the mesh's first_index and vertex_offset
+   * (see Candid_MeshDrawInfo). Without a GPU count every record is issued. */
+  for (uint32_t i = 0; i < draw->max_draw_count; ++i) {
+    [cmd->render_encoder
+        drawIndexedPrimitives:MTLPrimitiveTypeTriangle
+                    indexType:index_format_to_mtl(mesh->index_format)
+                  indexBuffer:mesh->index_buffer->mtl_buffer
+            indexBufferOffset:0
+               indirectBuffer:draw->args->mtl_buffer
+         indirectBufferOffset:draw->args_offset +
+                              i * sizeof(Candid_DrawIndexedIndirectCommand)];
+  }
+
+  restore_pipeline(cmd, pipeline);
+}
+
+static void metal_cmd_bind_compute_program(Candid_CommandBuffer *cmd,
+                                           Candid_ShaderProgram *program) {
+  if (!cmd || !program || !program->compute_state)
+    return;
+  cmd->compute_program = program;
+  [compute_encoder(cmd) setComputePipelineState:program->compute_state];
+}
+
+static void metal_cmd_bind_storage_buffer(Candid_CommandBuffer *cmd,
+                                          uint32_t slot, Candid_Buffer *buffer,
+                                          size_t offset, size_t size) {
+  /* Metal buffers are untyped: storage binds like uniform data */
+  metal_cmd_bind_uniform_buffer(cmd, slot, buffer, offset, size);
+}
+
+static void metal_cmd_bind_storage_texture(Candid_CommandBuffer *cmd,
+                                           uint32_t slot,
+                                           Candid_Texture *texture) {
+  if (!cmd || !texture)
+    return;
+  /* Kernels write any level of the bound texture directly */
+  if (cmd->render_encoder)
+    [cmd->render_encoder setFragmentTexture:texture->mtl_texture atIndex:slot];
+  else
+    [compute_encoder(cmd) setTexture:texture->mtl_texture atIndex:slot];
+}
+
+static void metal_cmd_clear_buffer(Candid_CommandBuffer *cmd,
+                                   Candid_Buffer *buffer, size_t offset,
+                                   size_t size) {
+  if (!cmd || cmd->render_encoder || !buffer || size == 0)
+    return;
+
+  /* Blits need their own encoder; compute bindings do not survive it */
+  end_compute_encoding(cmd);
+  id<MTLBlitCommandEncoder> blit = [cmd->mtl_command_buffer blitCommandEncoder];
+  [blit fillBuffer:buffer->mtl_buffer range:NSMakeRange(offset, size) value:0];
+  [blit endEncoding];
+}
+
+static void metal_cmd_copy_buffer(Candid_CommandBuffer *cmd, Candid_Buffer *src,
+                                  size_t src_offset, Candid_Buffer *dst,
+                                  size_t dst_offset, size_t size) {
+  if (!cmd || cmd->render_encoder || !src || !dst || size == 0)
+    return;
+
+  end_compute_encoding(cmd);
+  id<MTLBlitCommandEncoder> blit = [cmd->mtl_command_buffer blitCommandEncoder];
+  [blit copyFromBuffer:src->mtl_buffer
+          sourceOffset:src_offset
+              toBuffer:dst->mtl_buffer
+     destinationOffset:dst_offset
+                  size:size];
+  [blit endEncoding];
 }
 
 static void metal_cmd_dispatch(Candid_CommandBuffer *cmd, uint32_t x, uint32_t y,
                                uint32_t z) {
-  (void)cmd;
-  (void)x;
-  (void)y;
-  (void)z;
-  /* Compute shader dispatch - to be implemented */
+  if (!cmd || !cmd->compute_program)
+    return;
+
+  id<MTLComputeCommandEncoder> encoder = compute_encoder(cmd);
+  [encoder dispatchThreadgroups:MTLSizeMake(x, y, z)
+          threadsPerThreadgroup:cmd->compute_program->workgroup_size];
+}
+
+/*******************************************************************************
+ * Async Compute
+ ******************************************************************************/
+
+static Candid_Result metal_cmd_begin_compute(Candid_Device *device,
+                                             Candid_CommandBuffer **out) {
+  if (!device || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!device->compute_queue || !device->queue_events[CANDID_QUEUE_COMPUTE])
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  Candid_CommandBuffer *cmd = calloc(1, sizeof(Candid_CommandBuffer));
+  if (!cmd)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  cmd->device = device;
+  cmd->queue = CANDID_QUEUE_COMPUTE;
+  cmd->mtl_command_buffer = [device->compute_queue commandBuffer];
+  if (!cmd->mtl_command_buffer) {
+    free(cmd);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = cmd;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Result metal_cmd_submit_compute(Candid_Device *device,
+                                              Candid_CommandBuffer *cmd,
+                                              Candid_SyncPoint *out_signal) {
+  if (!device || !cmd || cmd->queue != CANDID_QUEUE_COMPUTE)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  uint64_t value = ++device->queue_values[CANDID_QUEUE_COMPUTE];
+  [cmd->mtl_command_buffer
+      encodeSignalEvent:device->queue_events[CANDID_QUEUE_COMPUTE]
+                  value:value];
+  [cmd->mtl_command_buffer commit];
+
+  cmd->mtl_command_buffer = nil;
+  free(cmd);
+
+  if (out_signal)
+    *out_signal = (Candid_SyncPoint){.queue = CANDID_QUEUE_COMPUTE,
+                                     .value = value};
+  return CANDID_SUCCESS;
+}
+
+static Candid_SyncPoint metal_queue_get_sync_point(Candid_Device *device,
+                                                   Candid_Queue queue) {
+  Candid_SyncPoint point = {.queue = queue};
+  if (device && queue < CANDID_QUEUE_COUNT)
+    point.value = device->queue_values[queue];
+  return point;
+}
+
+/* Waits apply to the encoders that follow, so the open one is closed */
+static void metal_cmd_wait(Candid_CommandBuffer *cmd,
+                           const Candid_SyncPoint *point) {
+  if (!cmd || !point || cmd->render_encoder || point->value == 0 ||
+      point->queue >= CANDID_QUEUE_COUNT || point->queue == cmd->queue)
+    return;
+  id<MTLEvent> event = cmd->device->queue_events[point->queue];
+  if (!event)
+    return;
+
+  end_compute_encoding(cmd);
+  [cmd->mtl_command_buffer encodeWaitForEvent:event value:point->value];
 }
 
 /*******************************************************************************
@@ -1183,6 +2708,8 @@ const Candid_BackendInterface candid_metal_backend = {
     /* Swapchain */
     .swapchain_resize = metal_swapchain_resize,
     .swapchain_present = metal_swapchain_present,
+    .frame_wait = metal_frame_wait,
+    .swapchain_get_depth_texture = metal_swapchain_get_depth_texture,
 
     /* Buffer */
     .buffer_create = metal_buffer_create,
@@ -1195,6 +2722,10 @@ const Candid_BackendInterface candid_metal_backend = {
     .texture_create = metal_texture_create,
     .texture_destroy = metal_texture_destroy,
     .texture_upload = metal_texture_upload,
+    .heap_create = metal_heap_create,
+    .heap_destroy = metal_heap_destroy,
+    .texture_get_placement = metal_texture_get_placement,
+    .texture_create_placed = metal_texture_create_placed,
 
     /* Sampler */
     .sampler_create = metal_sampler_create,
@@ -1205,14 +2736,20 @@ const Candid_BackendInterface candid_metal_backend = {
     .shader_module_destroy = metal_shader_module_destroy,
     .shader_program_create = metal_shader_program_create,
     .shader_program_destroy = metal_shader_program_destroy,
+    .get_compute_kernel = metal_get_compute_kernel,
 
     /* Mesh */
     .mesh_create = metal_mesh_create,
+    .mesh_create_placed = metal_mesh_create_placed,
+    .mesh_set_placement = metal_mesh_set_placement,
     .mesh_destroy = metal_mesh_destroy,
+    .mesh_get_draw_info = metal_mesh_get_draw_info,
 
     /* Material */
     .material_create = metal_material_create,
     .material_destroy = metal_material_destroy,
+    .material_create_instance = metal_material_create_instance,
+    .material_get_base = metal_material_get_base,
 
     /* Command buffer */
     .cmd_begin = metal_cmd_begin,
@@ -1221,6 +2758,7 @@ const Candid_BackendInterface candid_metal_backend = {
 
     /* Render pass */
     .cmd_begin_render_pass = metal_cmd_begin_render_pass,
+    .cmd_begin_render_pass_targets = metal_cmd_begin_render_pass_targets,
     .cmd_end_render_pass = metal_cmd_end_render_pass,
     .cmd_set_viewport = metal_cmd_set_viewport,
     .cmd_set_scissor = metal_cmd_set_scissor,
@@ -1235,7 +2773,29 @@ const Candid_BackendInterface candid_metal_backend = {
     .cmd_draw = metal_cmd_draw,
     .cmd_draw_indexed = metal_cmd_draw_indexed,
     .cmd_draw_mesh = metal_cmd_draw_mesh,
+    .cmd_draw_mesh_instanced = metal_cmd_draw_mesh_instanced,
+    .cmd_draw_indexed_indirect = metal_cmd_draw_indexed_indirect,
+    .cmd_draw_indexed_indirect_count = metal_cmd_draw_indexed_indirect_count,
+    .cmd_draw_mesh_indirect = metal_cmd_draw_mesh_indirect,
 
     /* Compute */
+    .cmd_bind_compute_program = metal_cmd_bind_compute_program,
+    .cmd_bind_storage_buffer = metal_cmd_bind_storage_buffer,
+    .cmd_bind_storage_texture = metal_cmd_bind_storage_texture,
+    .cmd_clear_buffer = metal_cmd_clear_buffer,
+    .cmd_copy_buffer = metal_cmd_copy_buffer,
     .cmd_dispatch = metal_cmd_dispatch,
+
+    /* Async compute */
+    .cmd_begin_compute = metal_cmd_begin_compute,
+    .cmd_submit_compute = metal_cmd_submit_compute,
+    .queue_get_sync_point = metal_queue_get_sync_point,
+    .cmd_wait = metal_cmd_wait,
+
+    /* Bindless */
+    .texture_table_create = metal_texture_table_create,
+    .texture_table_destroy = metal_texture_table_destroy,
+    .texture_table_set = metal_texture_table_set,
+    .cmd_bind_bindless = metal_cmd_bind_bindless,
+    .material_set_table_index = metal_material_set_table_index,
 };
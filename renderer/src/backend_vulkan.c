@@ -6,7 +6,14 @@
  * Vulkan support requires the volk library for dynamic loading.
  */
 
+#include "builtin_shaders.h"
+#include "pipeline_list.h"
+#include "shader_layout.h"
+
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_mutex.h>
 #include <candid/backend.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -15,16 +22,97 @@
 #define VOLK_IMPLEMENTATION
 #include <volk.h>
 
+#include <SDL3/SDL_vulkan.h>
+
+#define VULKAN_MAX_FRAMES_IN_FLIGHT 3
+/* Image array size of storage texture bindings (HIZ_MAX_LEVELS in hiz.hlsl) */
+#define VULKAN_MAX_STORAGE_LEVELS 16
+/* Descriptor set of the bindless tables (space1 in shaders/materials.hlsl) */
+#define VULKAN_BINDLESS_SET 1
+#define VULKAN_DEPTH_FORMAT VK_FORMAT_D32_SFLOAT
+/* Render passes and framebuffers kept for cmd_begin_render_pass_targets */
+#define VULKAN_MAX_TARGET_PASSES 32
+#define VULKAN_MAX_TARGET_FRAMEBUFFERS 64
+/* Presents after which a framebuffer size nothing renders to is dropped */
+#define VULKAN_TARGET_FRAMEBUFFER_IDLE_FRAMES 120
+/* Uniform data of draws per frame slot (instance quantization), in blocks
+ * aligned for any minUniformBufferOffsetAlignment */
+#define VULKAN_DRAW_PARAMS_SIZE (64 * 1024)
+#define VULKAN_DRAW_PARAMS_ALIGNMENT 256
+
 /*******************************************************************************
  * Internal Structures
  ******************************************************************************/
 
+/* Offscreen render pass by formats and load and store operations.
+ * VK_FORMAT_UNDEFINED stands for a missing attachment. */
+typedef struct VulkanTargetPass {
+  VkFormat color_format;
+  VkFormat depth_format;
+  Candid_LoadAction color_load;
+  Candid_LoadAction depth_load;
+  bool discard_depth;
+  VkRenderPass render_pass;
+} VulkanTargetPass;
+
+/* Imageless framebuffer: views are given when the pass begins, so one
+ * serves every texture of the same size and usage */
+typedef struct VulkanTargetFramebuffer {
+  VkRenderPass render_pass;
+  uint32_t width;
+  uint32_t height;
+  VkImageUsageFlags color_usage;
+  VkImageUsageFlags depth_usage;
+  VkFramebuffer framebuffer;
+  uint64_t last_used; /**< frame_number of the last pass begun with it */
+} VulkanTargetFramebuffer;
+
+/* Handle destroyed once the frames that may use it have completed */
+typedef struct VulkanGarbage {
+  VkObjectType type;
+  uint64_t handle;
+} VulkanGarbage;
+
+/* Handle a queued presentation may still use. No fence covers a present,
+ * so it is retired only once later presents have been queued. */
+typedef struct VulkanPresentGarbage {
+  VulkanGarbage garbage;
+  uint64_t frame_number; /**< Presents when it was replaced */
+} VulkanPresentGarbage;
+
+/* What one frame in flight records with, reused once its fence signals */
+typedef struct VulkanFrame {
+  VkCommandPool command_pool;
+  VkCommandBuffer command_buffer;
+  VkSemaphore image_available; /**< Signaled by the image acquisition */
+  VkFence in_flight;
+  bool submitted; /**< in_flight will signal */
+  /* Per recording thread */
+  VkCommandPool secondary_pools[CANDID_MAX_SECONDARY_COMMAND_BUFFERS];
+  VkCommandPool compute_pool;
+  /* Compute point reached once the slot's compute buffers have completed;
+   * async work is not covered by in_flight */
+  uint64_t compute_value;
+  /* Host-visible, written by the recording threads; rewound when the slot
+   * is reclaimed */
+  VkBuffer draw_params;
+  VkDeviceMemory draw_params_memory;
+  uint8_t *draw_params_data;
+  SDL_AtomicInt draw_params_used;
+  /* The first `collectable` were retired before the last submission */
+  VulkanGarbage *garbage;
+  uint32_t garbage_count;
+  uint32_t garbage_capacity;
+  uint32_t collectable;
+} VulkanFrame;
+
 struct Candid_Device {
   VkInstance instance;
   VkPhysicalDevice physical_device;
   VkDevice device;
   VkQueue graphics_queue;
   VkQueue present_queue;
+  VkQueue compute_queue; /**< graphics_queue without a compute-only family */
   VkSurfaceKHR surface;
   VkSwapchainKHR swapchain;
   VkFormat swapchain_format;
@@ -32,24 +120,72 @@ struct Candid_Device {
   VkImage *swapchain_images;
   VkImageView *swapchain_image_views;
   uint32_t swapchain_image_count;
+  Candid_PresentMode present_mode;
+  uint32_t requested_image_count; /**< 0 = minImageCount + 1 */
   VkRenderPass render_pass;
-  VkFramebuffer *framebuffers;
-  VkCommandPool command_pool;
-  VkCommandBuffer *command_buffers;
-  VkSemaphore *image_available_semaphores;
-  VkSemaphore *render_finished_semaphores;
-  VkFence *in_flight_fences;
+  VkRenderPass render_pass_load; /**< Same attachments, LOAD_OP_LOAD */
+  VkFramebuffer *framebuffers; /**< Per image, created on first use */
+  bool swapchain_dirty; /**< Recreated before the next acquisition */
+  /* Frames in flight, recorded into in turn; the CPU only waits for the
+   * one it is about to reuse */
+  VulkanFrame frames[VULKAN_MAX_FRAMES_IN_FLIGHT];
   uint32_t current_frame;
+  uint64_t frame_number; /**< Presents so far */
+  /* Resources are destroyed from any thread: guards the frames' garbage
+   * lists and current_frame against the recording thread */
+  SDL_Mutex *garbage_lock;
   uint32_t max_frames_in_flight;
+  /* Per swapchain image: the presentation may still hold the semaphore of
+   * an image when the frame slot comes around again */
+  VkSemaphore *render_finished_semaphores;
+  /* Old swapchains and their semaphores, render thread only */
+  VulkanPresentGarbage *present_garbage;
+  uint32_t present_garbage_count;
+  uint32_t present_garbage_capacity;
+  bool present_pending; /**< The last submission acquired present_image */
+  uint32_t present_image;
+  /* Timeline semaphore per Candid_Queue, signaled with each submission's
+   * sync point */
+  VkSemaphore queue_timelines[CANDID_QUEUE_COUNT];
+  uint64_t queue_values[CANDID_QUEUE_COUNT];
   VkImage depth_image;
   VkDeviceMemory depth_image_memory;
   VkImageView depth_image_view;
+  bool sampled_depth;
+  Candid_Texture *depth_target; /**< Wraps depth_image when sampled_depth */
   VkDebugUtilsMessengerEXT debug_messenger;
   bool validation_enabled;
   uint32_t width;
   uint32_t height;
   uint32_t graphics_family;
   uint32_t present_family;
+  uint32_t compute_family;
+  bool multi_draw_indirect; /**< VkPhysicalDeviceFeatures::multiDrawIndirect */
+  /* VkPhysicalDeviceFeatures::drawIndirectFirstInstance: instance data of
+   * indirect records is selected through first_instance */
+  bool draw_indirect_first_instance;
+  bool draw_indirect_count; /**< Vulkan 1.2 drawIndirectCount feature */
+  bool push_descriptor;     /**< VK_KHR_push_descriptor, for compute binds */
+  bool descriptor_indexing; /**< Vulkan 1.2 features for bindless tables */
+  bool imageless_framebuffer; /**< Vulkan 1.2 imagelessFramebuffer */
+  bool sampler_anisotropy;    /**< VkPhysicalDeviceFeatures */
+  float max_anisotropy;       /**< maxSamplerAnisotropy */
+  /* Set VULKAN_BINDLESS_SET of graphics programs, with the first table */
+  VkDescriptorSetLayout bindless_layout;
+  uint32_t bindless_capacity;
+  VkSampler bindless_sampler;
+  /* Graphics pipeline states bound, pre-warmed at program creation */
+  Candid_PipelineList *pipeline_list;
+  /* Offscreen passes, also looked up by pre-warm workers building
+   * pipelines; framebuffers are only used by the recording thread */
+  SDL_Mutex *target_lock;
+  VulkanTargetPass target_passes[VULKAN_MAX_TARGET_PASSES];
+  uint32_t target_pass_count;
+  VulkanTargetFramebuffer target_framebuffers[VULKAN_MAX_TARGET_FRAMEBUFFERS];
+  uint32_t target_framebuffer_count;
+  /* Built-in kernels and their modules, created on first use */
+  Candid_ShaderProgram *kernels[CANDID_COMPUTE_KERNEL_COUNT];
+  Candid_ShaderModule *kernel_modules[CANDID_COMPUTE_KERNEL_COUNT];
 };
 
 struct Candid_Buffer {
@@ -62,11 +198,20 @@ struct Candid_Buffer {
 
 struct Candid_Texture {
   VkImage image;
-  VkDeviceMemory memory;
+  VkDeviceMemory memory; /**< VK_NULL_HANDLE when placed in a heap */
   VkImageView view;
+  VkImageView *mip_views; /**< One per level, STORAGE textures only */
+  /* Level 0 and layer 0 with every aspect, attachment textures only */
+  VkImageView target_view;
   Candid_TextureDesc desc;
 };
 
+struct Candid_Heap {
+  VkDeviceMemory memory;
+  VkDeviceSize size;
+  uint32_t memory_type; /**< Placed images must accept it */
+};
+
 struct Candid_Sampler {
   VkSampler sampler;
 };
@@ -74,19 +219,37 @@ struct Candid_Sampler {
 struct Candid_ShaderModule {
   VkShaderModule module;
   Candid_ShaderStage stage;
+  char entry_point[64];
+  uint64_t hash[2]; /**< Of the code and entry point, for pipeline keys */
+  /** Names are cleared, as they point into the caller's bytecode */
+  Candid_ShaderReflection reflection;
 };
 
 struct Candid_ShaderProgram {
-  VkPipeline pipeline;
+  Candid_Device *device;
+  VkPipeline pipeline; /**< Compute programs; graphics ones use variants */
   VkPipelineLayout layout;
-  VkDescriptorSetLayout descriptor_set_layout;
+  /** Set 0 takes push descriptors; VULKAN_BINDLESS_SET is the device's */
+  VkDescriptorSetLayout descriptor_set_layouts[CANDID_SHADER_MAX_SETS];
+  uint32_t descriptor_set_count;
+  VkShaderStageFlags push_constant_stages;
+  Candid_ShaderLayout bindings; /**< Resolves the slots of cmd_bind_* */
   Candid_ShaderModule *vertex;
   Candid_ShaderModule *fragment;
+  /** Graphics pipelines by Candid_PipelineKey, created on first bind or
+   * pre-warmed from the device's pipeline list (VkPipeline handles are
+   * pointers on 64-bit targets) */
+  Candid_PipelineVariants *variants;
+  uint64_t hash[2];
 };
 
 struct Candid_Mesh {
   Candid_Buffer *vertex_buffer;
   Candid_Buffer *index_buffer;
+  bool placed;           /**< Buffers are shared and not owned */
+  bool pulled;           /**< Read by vertex-pulling shaders, in words */
+  int32_t vertex_offset; /**< First vertex in vertex_buffer */
+  uint32_t first_index;  /**< First index in index_buffer */
   uint32_t vertex_count;
   uint32_t index_count;
   Candid_IndexFormat index_format;
@@ -96,8 +259,18 @@ struct Candid_Mesh {
 
 struct Candid_Material {
   Candid_ShaderProgram *shader;
-  Candid_MaterialDesc desc;
-  VkDescriptorSet descriptor_set;
+  VkDescriptorSet descriptor_set; /**< The base's, for instances */
+  Candid_Material *base;          /**< NULL unless an instance */
+  uint32_t table_index;           /**< Bindless material record */
+};
+
+/* One update-after-bind set: sampled images, their sampler and the material
+ * records. Entries no frame in flight reads may change while it is bound. */
+struct Candid_TextureTable {
+  VkDescriptorPool pool;
+  VkDescriptorSet set;
+  uint32_t capacity;
+  Candid_Buffer *materials; /**< Buffer currently written to the set */
 };
 
 struct Candid_CommandBuffer {
@@ -105,6 +278,28 @@ struct Candid_CommandBuffer {
   Candid_Device *device;
   uint32_t image_index;
   bool in_render_pass;
+  bool is_secondary;
+  bool image_acquired; /**< The frame pass acquired image_index */
+  Candid_Queue queue;
+  /* Highest point of each other queue the submission waits for */
+  uint64_t wait_values[CANDID_QUEUE_COUNT];
+  Candid_ShaderProgram *compute_program;
+  bool compute_writes; /**< Fill or dispatch not yet behind a barrier */
+  Candid_ShaderProgram *graphics_program;
+  /* graphics_program's state, with the vertex layout of the variant bound
+   * as graphics_pipeline (chosen at the first draw after a bind) */
+  Candid_PipelineKey pipeline_key;
+  VkPipeline graphics_pipeline;
+  Candid_TextureTable *bindless_table;
+  uint32_t bound_material_index; /**< Last pushed to the fragment stage */
+  /* Dynamic in every pipeline; kept to set again where a pass split or a
+   * secondary starts without them */
+  VkViewport viewport;
+  VkRect2D scissor;
+  /* Attachment formats of a cmd_begin_render_pass_targets pass */
+  bool target_pass;
+  VkFormat color_format;
+  VkFormat depth_format;
 };
 
 /*******************************************************************************
@@ -169,11 +364,142 @@ static VkFormat texture_format_to_vk(Candid_TextureFormat format) {
     return VK_FORMAT_D32_SFLOAT;
   case CANDID_TEXTURE_FORMAT_DEPTH24_STENCIL8:
     return VK_FORMAT_D24_UNORM_S8_UINT;
+  case CANDID_TEXTURE_FORMAT_R32_FLOAT:
+    return VK_FORMAT_R32_SFLOAT;
   default:
     return VK_FORMAT_UNDEFINED;
   }
 }
 
+static bool texture_format_has_depth(Candid_TextureFormat format) {
+  return format == CANDID_TEXTURE_FORMAT_DEPTH32_FLOAT ||
+         format == CANDID_TEXTURE_FORMAT_DEPTH24_STENCIL8;
+}
+
+static VkImageAspectFlags texture_aspect_to_vk(Candid_TextureFormat format) {
+  switch (format) {
+  case CANDID_TEXTURE_FORMAT_DEPTH32_FLOAT:
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+  case CANDID_TEXTURE_FORMAT_DEPTH24_STENCIL8:
+    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+  default:
+    return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+static VkImageUsageFlags texture_usage_to_vk(uint32_t usage) {
+  VkImageUsageFlags flags = 0;
+  if (usage & CANDID_TEXTURE_USAGE_SAMPLED)
+    flags |= VK_IMAGE_USAGE_SAMPLED_BIT;
+  if (usage & CANDID_TEXTURE_USAGE_STORAGE)
+    flags |= VK_IMAGE_USAGE_STORAGE_BIT;
+  if (usage & CANDID_TEXTURE_USAGE_RENDER_TARGET)
+    flags |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  if (usage & CANDID_TEXTURE_USAGE_DEPTH_STENCIL)
+    flags |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  if (usage & CANDID_TEXTURE_USAGE_TRANSFER_SRC)
+    flags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  if (usage & CANDID_TEXTURE_USAGE_TRANSFER_DST)
+    flags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  return flags;
+}
+
+/* Copies and clears (cmd_copy_buffer, cmd_clear_buffer, defragmentation)
+ * reach any buffer */
+static VkBufferUsageFlags buffer_usage_to_vk(uint32_t usage) {
+  VkBufferUsageFlags flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                             VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  if (usage & CANDID_BUFFER_USAGE_VERTEX)
+    flags |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+  if (usage & CANDID_BUFFER_USAGE_INDEX)
+    flags |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+  if (usage & CANDID_BUFFER_USAGE_UNIFORM)
+    flags |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+  if (usage & CANDID_BUFFER_USAGE_STORAGE)
+    flags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  if (usage & CANDID_BUFFER_USAGE_INDIRECT)
+    flags |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+  return flags;
+}
+
+/* Stages, accesses and image layout of a use, as either side of a
+ * barrier */
+typedef struct VulkanResourceAccess {
+  VkPipelineStageFlags stages;
+  VkAccessFlags access;
+  VkImageLayout layout;
+} VulkanResourceAccess;
+
+static VulkanResourceAccess resource_state_to_vk(Candid_ResourceState state,
+                                                 bool depth) {
+  const VkPipelineStageFlags shaders = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  const VkPipelineStageFlags depth_tests =
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+  switch (state) {
+  case CANDID_RESOURCE_STATE_COLOR_TARGET:
+    return (VulkanResourceAccess){
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  case CANDID_RESOURCE_STATE_DEPTH_TARGET:
+    return (VulkanResourceAccess){
+        depth_tests,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+  case CANDID_RESOURCE_STATE_DEPTH_READ:
+    return (VulkanResourceAccess){
+        depth_tests | shaders,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+            VK_ACCESS_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+  case CANDID_RESOURCE_STATE_SHADER_READ:
+    return (VulkanResourceAccess){
+        shaders, VK_ACCESS_SHADER_READ_BIT,
+        depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+              : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+  case CANDID_RESOURCE_STATE_STORAGE:
+    return (VulkanResourceAccess){
+        shaders, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL};
+  case CANDID_RESOURCE_STATE_UNIFORM:
+    return (VulkanResourceAccess){shaders, VK_ACCESS_UNIFORM_READ_BIT,
+                                  VK_IMAGE_LAYOUT_UNDEFINED};
+  case CANDID_RESOURCE_STATE_VERTEX:
+    return (VulkanResourceAccess){VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                  VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                                  VK_IMAGE_LAYOUT_UNDEFINED};
+  case CANDID_RESOURCE_STATE_INDEX:
+    return (VulkanResourceAccess){VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                  VK_ACCESS_INDEX_READ_BIT,
+                                  VK_IMAGE_LAYOUT_UNDEFINED};
+  case CANDID_RESOURCE_STATE_INDIRECT:
+    return (VulkanResourceAccess){VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                  VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                                  VK_IMAGE_LAYOUT_UNDEFINED};
+  case CANDID_RESOURCE_STATE_COPY_SOURCE:
+    return (VulkanResourceAccess){VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                  VK_ACCESS_TRANSFER_READ_BIT,
+                                  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+  case CANDID_RESOURCE_STATE_COPY_DEST:
+    return (VulkanResourceAccess){VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                  VK_ACCESS_TRANSFER_WRITE_BIT,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+  case CANDID_RESOURCE_STATE_PRESENT:
+    return (VulkanResourceAccess){VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                  VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+  default:
+    /* Waits for all earlier work, e.g. on memory an aliased image used */
+    return (VulkanResourceAccess){VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                                  VK_IMAGE_LAYOUT_UNDEFINED};
+  }
+}
+
 static VkCompareOp compare_func_to_vk(Candid_CompareFunc func) {
   switch (func) {
   case CANDID_COMPARE_NEVER:
@@ -197,6 +523,91 @@ static VkCompareOp compare_func_to_vk(Candid_CompareFunc func) {
   }
 }
 
+static VkBlendFactor blend_factor_to_vk(Candid_BlendFactor factor) {
+  switch (factor) {
+  case CANDID_BLEND_ZERO:
+    return VK_BLEND_FACTOR_ZERO;
+  case CANDID_BLEND_ONE:
+    return VK_BLEND_FACTOR_ONE;
+  case CANDID_BLEND_SRC_COLOR:
+    return VK_BLEND_FACTOR_SRC_COLOR;
+  case CANDID_BLEND_ONE_MINUS_SRC_COLOR:
+    return VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+  case CANDID_BLEND_DST_COLOR:
+    return VK_BLEND_FACTOR_DST_COLOR;
+  case CANDID_BLEND_ONE_MINUS_DST_COLOR:
+    return VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR;
+  case CANDID_BLEND_SRC_ALPHA:
+    return VK_BLEND_FACTOR_SRC_ALPHA;
+  case CANDID_BLEND_ONE_MINUS_SRC_ALPHA:
+    return VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  case CANDID_BLEND_DST_ALPHA:
+    return VK_BLEND_FACTOR_DST_ALPHA;
+  case CANDID_BLEND_ONE_MINUS_DST_ALPHA:
+    return VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+  default:
+    return VK_BLEND_FACTOR_ONE;
+  }
+}
+
+static VkBlendOp blend_op_to_vk(Candid_BlendOp op) {
+  switch (op) {
+  case CANDID_BLEND_OP_SUBTRACT:
+    return VK_BLEND_OP_SUBTRACT;
+  case CANDID_BLEND_OP_REVERSE_SUBTRACT:
+    return VK_BLEND_OP_REVERSE_SUBTRACT;
+  case CANDID_BLEND_OP_MIN:
+    return VK_BLEND_OP_MIN;
+  case CANDID_BLEND_OP_MAX:
+    return VK_BLEND_OP_MAX;
+  default:
+    return VK_BLEND_OP_ADD;
+  }
+}
+
+static VkFormat vertex_format_to_vk(Candid_VertexFormat format) {
+  switch (format) {
+  case CANDID_VERTEX_FORMAT_FLOAT:
+    return VK_FORMAT_R32_SFLOAT;
+  case CANDID_VERTEX_FORMAT_FLOAT2:
+    return VK_FORMAT_R32G32_SFLOAT;
+  case CANDID_VERTEX_FORMAT_FLOAT3:
+    return VK_FORMAT_R32G32B32_SFLOAT;
+  case CANDID_VERTEX_FORMAT_FLOAT4:
+    return VK_FORMAT_R32G32B32A32_SFLOAT;
+  case CANDID_VERTEX_FORMAT_INT:
+    return VK_FORMAT_R32_SINT;
+  case CANDID_VERTEX_FORMAT_INT2:
+    return VK_FORMAT_R32G32_SINT;
+  case CANDID_VERTEX_FORMAT_INT3:
+    return VK_FORMAT_R32G32B32_SINT;
+  case CANDID_VERTEX_FORMAT_INT4:
+    return VK_FORMAT_R32G32B32A32_SINT;
+  case CANDID_VERTEX_FORMAT_UINT:
+    return VK_FORMAT_R32_UINT;
+  case CANDID_VERTEX_FORMAT_UINT2:
+    return VK_FORMAT_R32G32_UINT;
+  case CANDID_VERTEX_FORMAT_UINT3:
+    return VK_FORMAT_R32G32B32_UINT;
+  case CANDID_VERTEX_FORMAT_UINT4:
+    return VK_FORMAT_R32G32B32A32_UINT;
+  case CANDID_VERTEX_FORMAT_BYTE4_NORM:
+    return VK_FORMAT_R8G8B8A8_UNORM;
+  case CANDID_VERTEX_FORMAT_BYTE4_SNORM:
+    return VK_FORMAT_R8G8B8A8_SNORM;
+  case CANDID_VERTEX_FORMAT_SHORT2:
+    return VK_FORMAT_R16G16_SINT;
+  case CANDID_VERTEX_FORMAT_SHORT4:
+    return VK_FORMAT_R16G16B16A16_SINT;
+  case CANDID_VERTEX_FORMAT_SHORT2_NORM:
+    return VK_FORMAT_R16G16_SNORM;
+  case CANDID_VERTEX_FORMAT_SHORT4_NORM:
+    return VK_FORMAT_R16G16B16A16_SNORM;
+  default:
+    return VK_FORMAT_UNDEFINED;
+  }
+}
+
 static VkFilter sampler_filter_to_vk(Candid_SamplerFilter filter) {
   switch (filter) {
   case CANDID_SAMPLER_FILTER_NEAREST:
@@ -208,6 +619,26 @@ static VkFilter sampler_filter_to_vk(Candid_SamplerFilter filter) {
   }
 }
 
+/* Requested mode first, then the fallbacks that do not tear, then FIFO,
+ * which every surface supports */
+static uint32_t present_mode_preference(Candid_PresentMode mode,
+                                        VkPresentModeKHR out[3]) {
+  switch (mode) {
+  case CANDID_PRESENT_MODE_FIFO_RELAXED:
+    out[0] = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    return 1;
+  case CANDID_PRESENT_MODE_MAILBOX:
+    out[0] = VK_PRESENT_MODE_MAILBOX_KHR;
+    return 1;
+  case CANDID_PRESENT_MODE_IMMEDIATE:
+    out[0] = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    out[1] = VK_PRESENT_MODE_MAILBOX_KHR;
+    return 2;
+  default:
+    return 0;
+  }
+}
+
 static VkSamplerAddressMode
 sampler_address_to_vk(Candid_SamplerAddressMode mode) {
   switch (mode) {
@@ -225,384 +656,2951 @@ sampler_address_to_vk(Candid_SamplerAddressMode mode) {
 }
 
 /*******************************************************************************
- * Device Functions (Stubs - to be implemented)
+ * Frames
  ******************************************************************************/
 
-static Candid_Result vulkan_device_create(const Candid_DeviceDesc *desc,
-                                          Candid_Device **out) {
-  if (!desc || !out)
-    return CANDID_ERROR_INVALID_ARGUMENT;
+static void destroy_handle(Candid_Device *device, const VulkanGarbage *item) {
+  switch (item->type) {
+  case VK_OBJECT_TYPE_IMAGE:
+    vkDestroyImage(device->device, (VkImage)item->handle, NULL);
+    break;
+  case VK_OBJECT_TYPE_IMAGE_VIEW:
+    vkDestroyImageView(device->device, (VkImageView)item->handle, NULL);
+    break;
+  case VK_OBJECT_TYPE_BUFFER:
+    vkDestroyBuffer(device->device, (VkBuffer)item->handle, NULL);
+    break;
+  case VK_OBJECT_TYPE_DEVICE_MEMORY:
+    vkFreeMemory(device->device, (VkDeviceMemory)item->handle, NULL);
+    break;
+  case VK_OBJECT_TYPE_FRAMEBUFFER:
+    vkDestroyFramebuffer(device->device, (VkFramebuffer)item->handle, NULL);
+    break;
+  case VK_OBJECT_TYPE_SEMAPHORE:
+    vkDestroySemaphore(device->device, (VkSemaphore)item->handle, NULL);
+    break;
+  case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+    vkDestroySwapchainKHR(device->device, (VkSwapchainKHR)item->handle, NULL);
+    break;
+  case VK_OBJECT_TYPE_SAMPLER:
+    vkDestroySampler(device->device, (VkSampler)item->handle, NULL);
+    break;
+  default:
+    break;
+  }
+}
 
-  /* Initialize Volk */
-  VkResult result = volkInitialize();
-  if (result != VK_SUCCESS) {
-    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+/**
+ * Destroy a handle once every frame submitted so far has completed. It
+ * joins the current slot, collected after the slot's next submission.
+ * Safe from any thread.
+ */
+static void retire_handle(Candid_Device *device, VkObjectType type,
+                          uint64_t handle) {
+  if (!handle)
+    return;
+  SDL_LockMutex(device->garbage_lock);
+  VulkanFrame *frame = &device->frames[device->current_frame];
+  if (frame->garbage_count == frame->garbage_capacity) {
+    uint32_t capacity =
+        frame->garbage_capacity ? frame->garbage_capacity * 2 : 64;
+    VulkanGarbage *garbage =
+        realloc(frame->garbage, capacity * sizeof(VulkanGarbage));
+    if (!garbage) {
+      /* Leaked: waiting for the device here would stall a thread that may
+       * be recording, and other threads may be submitting */
+      SDL_UnlockMutex(device->garbage_lock);
+      return;
+    }
+    frame->garbage = garbage;
+    frame->garbage_capacity = capacity;
   }
+  frame->garbage[frame->garbage_count++] =
+      (VulkanGarbage){.type = type, .handle = handle};
+  SDL_UnlockMutex(device->garbage_lock);
+}
 
-  Candid_Device *device = calloc(1, sizeof(Candid_Device));
-  if (!device)
-    return CANDID_ERROR_OUT_OF_MEMORY;
+/* Destroy the first `count` handles retired into a slot */
+static void collect_garbage(Candid_Device *device, VulkanFrame *frame,
+                            uint32_t count) {
+  SDL_LockMutex(device->garbage_lock);
+  frame->collectable = 0;
+  for (uint32_t i = 0; i < count; ++i)
+    destroy_handle(device, &frame->garbage[i]);
+  frame->garbage_count -= count;
+  memmove(frame->garbage, frame->garbage + count,
+          frame->garbage_count * sizeof(VulkanGarbage));
+  SDL_UnlockMutex(device->garbage_lock);
+}
 
-  device->width = desc->width;
-  device->height = desc->height;
-  device->validation_enabled = desc->debug_mode;
-  device->max_frames_in_flight = 2;
+/**
+ * Retire a handle a queued presentation may still use, once
+ * max_frames_in_flight more frames have been presented: by then the frames
+ * that waited for those presentations' images through acquisition have
+ * started, and the retired handle waits for them to complete.
+ */
+static void retire_present_handle(Candid_Device *device, VkObjectType type,
+                                  uint64_t handle) {
+  if (!handle)
+    return;
+  if (device->present_garbage_count == device->present_garbage_capacity) {
+    uint32_t capacity = device->present_garbage_capacity
+                            ? device->present_garbage_capacity * 2
+                            : 16;
+    VulkanPresentGarbage *garbage = realloc(
+        device->present_garbage, capacity * sizeof(VulkanPresentGarbage));
+    if (!garbage) {
+      /* Better a late destruction than a leak of the swapchain */
+      retire_handle(device, type, handle);
+      return;
+    }
+    device->present_garbage = garbage;
+    device->present_garbage_capacity = capacity;
+  }
+  device->present_garbage[device->present_garbage_count++] =
+      (VulkanPresentGarbage){
+          .garbage = {.type = type, .handle = handle},
+          .frame_number = device->frame_number,
+      };
+}
 
-  /* Create Vulkan instance */
-  VkApplicationInfo app_info = {
-      .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
-      .pApplicationName = desc->app_name ? desc->app_name : "Candid Engine",
-      .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
-      .pEngineName = "Candid Engine",
-      .engineVersion = VK_MAKE_VERSION(0, 1, 0),
-      .apiVersion = VK_API_VERSION_1_2,
-  };
+/* Pass on the present garbage old enough, or all of it */
+static void age_present_garbage(Candid_Device *device, bool all) {
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < device->present_garbage_count; ++i) {
+    const VulkanPresentGarbage *item = &device->present_garbage[i];
+    if (all || device->frame_number - item->frame_number >
+                   device->max_frames_in_flight)
+      retire_handle(device, item->garbage.type, item->garbage.handle);
+    else
+      device->present_garbage[kept++] = *item;
+  }
+  device->present_garbage_count = kept;
+}
 
-  const char *extensions[] = {
-      VK_KHR_SURFACE_EXTENSION_NAME,
-#if defined(_WIN32)
-      VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
-#elif defined(__linux__)
-      VK_KHR_XCB_SURFACE_EXTENSION_NAME,
-#elif defined(__APPLE__)
-      VK_EXT_METAL_SURFACE_EXTENSION_NAME,
-      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
-#endif
-      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+static Candid_Result create_draw_params(Candid_Device *device,
+                                       VulkanFrame *frame) {
+  VkBufferCreateInfo buffer_info = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .size = VULKAN_DRAW_PARAMS_SIZE,
+      .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
   };
+  if (vkCreateBuffer(device->device, &buffer_info, NULL,
+                     &frame->draw_params) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
 
-  const char *validation_layers[] = {"VK_LAYER_KHRONOS_validation"};
-
-  VkInstanceCreateInfo create_info = {
-      .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-      .pApplicationInfo = &app_info,
-      .enabledExtensionCount = sizeof(extensions) / sizeof(extensions[0]),
-      .ppEnabledExtensionNames = extensions,
-#if defined(__APPLE__)
-      .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
-#endif
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(device->device, frame->draw_params,
+                                &requirements);
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = requirements.size,
+      .memoryTypeIndex = find_memory_type(
+          device->physical_device, requirements.memoryTypeBits,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
   };
-
-  if (desc->debug_mode) {
-    create_info.enabledLayerCount = 1;
-    create_info.ppEnabledLayerNames = validation_layers;
-  }
-
-  result = vkCreateInstance(&create_info, NULL, &device->instance);
-  if (result != VK_SUCCESS) {
-    free(device);
+  void *data = NULL;
+  if (alloc_info.memoryTypeIndex == UINT32_MAX ||
+      vkAllocateMemory(device->device, &alloc_info, NULL,
+                       &frame->draw_params_memory) != VK_SUCCESS ||
+      vkBindBufferMemory(device->device, frame->draw_params,
+                         frame->draw_params_memory, 0) != VK_SUCCESS ||
+      vkMapMemory(device->device, frame->draw_params_memory, 0,
+                  VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
     return CANDID_ERROR_RESOURCE_CREATION;
-  }
+  frame->draw_params_data = data;
+  return CANDID_SUCCESS;
+}
 
-  volkLoadInstance(device->instance);
+static Candid_Result create_frames(Candid_Device *device) {
+  for (uint32_t f = 0; f < device->max_frames_in_flight; ++f) {
+    VulkanFrame *frame = &device->frames[f];
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = device->graphics_family,
+    };
+    if (vkCreateCommandPool(device->device, &pool_info, NULL,
+                            &frame->command_pool) != VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
 
-  /* Setup debug messenger if validation enabled */
-  if (desc->debug_mode) {
-    VkDebugUtilsMessengerCreateInfoEXT debug_info = {
-        .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
-        .messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-                           VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-                           VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
-        .messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
-                       VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-                       VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
-        .pfnUserCallback = debug_callback,
+    VkCommandBufferAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = frame->command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
     };
-    vkCreateDebugUtilsMessengerEXT(device->instance, &debug_info, NULL,
-                                   &device->debug_messenger);
+    VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+    VkFenceCreateInfo fence_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+    };
+    if (vkAllocateCommandBuffers(device->device, &alloc_info,
+                                 &frame->command_buffer) != VK_SUCCESS ||
+        vkCreateSemaphore(device->device, &semaphore_info, NULL,
+                          &frame->image_available) != VK_SUCCESS ||
+        vkCreateFence(device->device, &fence_info, NULL,
+                      &frame->in_flight) != VK_SUCCESS ||
+        create_draw_params(device, frame) != CANDID_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
   }
-
-  /* TODO: Complete Vulkan initialization:
-   * 1. Create surface from native_surface
-   * 2. Pick physical device
-   * 3. Create logical device with queues
-   * 4. Create swapchain
-   * 5. Create render pass
-   * 6. Create framebuffers
-   * 7. Create command pool and buffers
-   * 8. Create synchronization objects
-   */
-
-  *out = device;
   return CANDID_SUCCESS;
 }
 
-static void vulkan_device_destroy(Candid_Device *device) {
-  if (!device)
-    return;
-
-  if (device->device) {
-    vkDeviceWaitIdle(device->device);
+/* Once the device is idle */
+static void destroy_frames(Candid_Device *device) {
+  for (uint32_t f = 0; f < VULKAN_MAX_FRAMES_IN_FLIGHT; ++f) {
+    VulkanFrame *frame = &device->frames[f];
+    collect_garbage(device, frame, frame->garbage_count);
+    free(frame->garbage);
+    for (uint32_t t = 0; t < CANDID_MAX_SECONDARY_COMMAND_BUFFERS; ++t) {
+      if (frame->secondary_pools[t])
+        vkDestroyCommandPool(device->device, frame->secondary_pools[t], NULL);
+    }
+    if (frame->compute_pool)
+      vkDestroyCommandPool(device->device, frame->compute_pool, NULL);
+    if (frame->command_pool)
+      vkDestroyCommandPool(device->device, frame->command_pool, NULL);
+    if (frame->image_available)
+      vkDestroySemaphore(device->device, frame->image_available, NULL);
+    if (frame->in_flight)
+      vkDestroyFence(device->device, frame->in_flight, NULL);
+    if (frame->draw_params)
+      vkDestroyBuffer(device->device, frame->draw_params, NULL);
+    if (frame->draw_params_memory)
+      vkFreeMemory(device->device, frame->draw_params_memory, NULL);
+    *frame = (VulkanFrame){0};
   }
+}
 
-  /* Cleanup resources in reverse order */
-  /* TODO: Destroy all Vulkan resources */
-
-  if (device->debug_messenger) {
-    vkDestroyDebugUtilsMessengerEXT(device->instance, device->debug_messenger,
-                                    NULL);
+/* Wait for the GPU to finish the frame that last used a slot */
+static void wait_frame(Candid_Device *device, VulkanFrame *frame) {
+  if (frame->submitted) {
+    vkWaitForFences(device->device, 1, &frame->in_flight, VK_TRUE,
+                    UINT64_MAX);
+    frame->submitted = false;
   }
-
-  if (device->instance) {
-    vkDestroyInstance(device->instance, NULL);
+  if (frame->compute_value > 0) {
+    VkSemaphoreWaitInfo wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &device->queue_timelines[CANDID_QUEUE_COMPUTE],
+        .pValues = &frame->compute_value,
+    };
+    vkWaitSemaphores(device->device, &wait_info, UINT64_MAX);
+    frame->compute_value = 0;
   }
-
-  free(device);
 }
 
-static Candid_Result vulkan_device_get_limits(Candid_Device *device,
-                                              Candid_DeviceLimits *out) {
-  if (!device || !out)
-    return CANDID_ERROR_INVALID_ARGUMENT;
-
-  memset(out, 0, sizeof(*out));
+/**
+ * Make the current slot reusable: wait for the GPU to finish the frame that
+ * last used it (the only point where the CPU waits for the GPU), then
+ * recycle its command buffers and destroy what was retired before it
+ */
+static void reclaim_frame(Candid_Device *device) {
+  VulkanFrame *frame = &device->frames[device->current_frame];
+  wait_frame(device, frame);
+  collect_garbage(device, frame, frame->collectable);
 
-  if (device->physical_device) {
-    VkPhysicalDeviceProperties props;
-    vkGetPhysicalDeviceProperties(device->physical_device, &props);
+  vkResetCommandPool(device->device, frame->command_pool, 0);
+  for (uint32_t t = 0; t < CANDID_MAX_SECONDARY_COMMAND_BUFFERS; ++t) {
+    if (frame->secondary_pools[t])
+      vkResetCommandPool(device->device, frame->secondary_pools[t], 0);
+  }
+  if (frame->compute_pool)
+    vkResetCommandPool(device->device, frame->compute_pool, 0);
+  SDL_SetAtomicInt(&frame->draw_params_used, 0);
+}
 
-    out->max_texture_size = props.limits.maxImageDimension2D;
-    out->max_cube_map_size = props.limits.maxImageDimensionCube;
-    out->max_texture_array_layers = props.limits.maxImageArrayLayers;
-    out->max_vertex_attributes = props.limits.maxVertexInputAttributes;
-    out->max_vertex_buffers = props.limits.maxVertexInputBindings;
-    out->max_uniform_buffer_size = props.limits.maxUniformBufferRange;
-    out->max_storage_buffer_size = props.limits.maxStorageBufferRange;
-    out->max_compute_workgroup_size[0] =
-        props.limits.maxComputeWorkGroupSize[0];
-    out->max_compute_workgroup_size[1] =
-        props.limits.maxComputeWorkGroupSize[1];
-    out->max_compute_workgroup_size[2] =
-        props.limits.maxComputeWorkGroupSize[2];
-    out->max_compute_workgroups[0] = props.limits.maxComputeWorkGroupCount[0];
-    out->max_compute_workgroups[1] = props.limits.maxComputeWorkGroupCount[1];
-    out->max_compute_workgroups[2] = props.limits.maxComputeWorkGroupCount[2];
-    out->max_anisotropy = props.limits.maxSamplerAnisotropy;
+/**
+ * Submit an ended command buffer to `queue` after the points it waits for
+ * (and `acquired`, before writing color), signaling the next point of its
+ * own queue's timeline (and `rendered`)
+ */
+static VkResult submit_timeline(Candid_Device *device,
+                                Candid_CommandBuffer *cmd, VkQueue queue,
+                                VkSemaphore acquired, VkSemaphore rendered,
+                                VkFence fence) {
+  VkSemaphore waits[CANDID_QUEUE_COUNT + 1];
+  uint64_t wait_values[CANDID_QUEUE_COUNT + 1];
+  VkPipelineStageFlags wait_stages[CANDID_QUEUE_COUNT + 1];
+  uint32_t wait_count = 0;
+  if (acquired) {
+    waits[wait_count] = acquired;
+    wait_values[wait_count] = 0;
+    wait_stages[wait_count] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    wait_count++;
+  }
+  for (uint32_t q = 0; q < CANDID_QUEUE_COUNT; ++q) {
+    if (cmd->wait_values[q] == 0)
+      continue;
+    waits[wait_count] = device->queue_timelines[q];
+    wait_values[wait_count] = cmd->wait_values[q];
+    wait_stages[wait_count] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    wait_count++;
+  }
 
-    VkPhysicalDeviceFeatures features;
-    vkGetPhysicalDeviceFeatures(device->physical_device, &features);
-    out->supports_geometry_shader = features.geometryShader;
-    out->supports_tessellation = features.tessellationShader;
-    out->supports_compute = true;
+  VkSemaphore signals[2];
+  uint64_t signal_values[2];
+  uint32_t signal_count = 0;
+  uint64_t signal_value = device->queue_values[cmd->queue] + 1;
+  if (device->queue_timelines[cmd->queue]) {
+    signals[signal_count] = device->queue_timelines[cmd->queue];
+    signal_values[signal_count++] = signal_value;
+  }
+  if (rendered) {
+    signals[signal_count] = rendered;
+    signal_values[signal_count++] = 0;
   }
 
-  return CANDID_SUCCESS;
+  VkTimelineSemaphoreSubmitInfo timeline_info = {
+      .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+      .waitSemaphoreValueCount = wait_count,
+      .pWaitSemaphoreValues = wait_values,
+      .signalSemaphoreValueCount = signal_count,
+      .pSignalSemaphoreValues = signal_values,
+  };
+  VkSubmitInfo submit_info = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = &timeline_info,
+      .waitSemaphoreCount = wait_count,
+      .pWaitSemaphores = waits,
+      .pWaitDstStageMask = wait_stages,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &cmd->vk_command_buffer,
+      .signalSemaphoreCount = signal_count,
+      .pSignalSemaphores = signals,
+  };
+  VkResult result = vkQueueSubmit(queue, 1, &submit_info, fence);
+  if (result == VK_SUCCESS && device->queue_timelines[cmd->queue])
+    device->queue_values[cmd->queue] = signal_value;
+  return result;
 }
 
 /*******************************************************************************
- * Stub implementations for remaining functions
+ * Swapchain
  ******************************************************************************/
 
-static Candid_Result vulkan_swapchain_resize(Candid_Device *device,
-                                             uint32_t width, uint32_t height) {
-  if (!device)
-    return CANDID_ERROR_INVALID_ARGUMENT;
-  device->width = width;
-  device->height = height;
-  /* TODO: Recreate swapchain */
-  return CANDID_SUCCESS;
-}
+static VkPresentModeKHR choose_present_mode(Candid_Device *device) {
+  VkPresentModeKHR preferred[3];
+  uint32_t preferred_count =
+      present_mode_preference(device->present_mode, preferred);
 
-static Candid_Result vulkan_swapchain_present(Candid_Device *device) {
-  (void)device;
-  return CANDID_SUCCESS;
+  VkPresentModeKHR modes[16];
+  uint32_t mode_count = 16;
+  vkGetPhysicalDeviceSurfacePresentModesKHR(
+      device->physical_device, device->surface, &mode_count, modes);
+  for (uint32_t p = 0; p < preferred_count; ++p) {
+    for (uint32_t i = 0; i < mode_count; ++i) {
+      if (modes[i] == preferred[p])
+        return modes[i];
+    }
+  }
+  return VK_PRESENT_MODE_FIFO_KHR;
 }
 
-static Candid_Result vulkan_buffer_create(Candid_Device *device,
-                                          const Candid_BufferDesc *desc,
-                                          Candid_Buffer **out) {
-  (void)device;
-  (void)desc;
-  (void)out;
-  return CANDID_ERROR_RESOURCE_CREATION;
+/* Fewer images queue fewer frames ahead of the display; MAILBOX needs one
+ * more than FIFO to always have an image to render into */
+static uint32_t choose_image_count(Candid_Device *device,
+                                   const VkSurfaceCapabilitiesKHR *caps) {
+  uint32_t count = device->requested_image_count;
+  if (count == 0)
+    count = caps->minImageCount + 1;
+  if (count < caps->minImageCount)
+    count = caps->minImageCount;
+  if (caps->maxImageCount > 0 && count > caps->maxImageCount)
+    count = caps->maxImageCount;
+  return count;
 }
 
-static void vulkan_buffer_destroy(Candid_Device *device,
-                                  Candid_Buffer *buffer) {
-  (void)device;
-  (void)buffer;
+static VkSurfaceFormatKHR choose_surface_format(Candid_Device *device) {
+  VkSurfaceFormatKHR formats[32];
+  uint32_t format_count = 32;
+  vkGetPhysicalDeviceSurfaceFormatsKHR(device->physical_device,
+                                       device->surface, &format_count,
+                                       formats);
+  for (uint32_t i = 0; i < format_count; ++i) {
+    if (formats[i].format == VK_FORMAT_B8G8R8A8_UNORM &&
+        formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+      return formats[i];
+  }
+  return format_count > 0
+             ? formats[0]
+             : (VkSurfaceFormatKHR){VK_FORMAT_B8G8R8A8_UNORM,
+                                    VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
 }
 
-static Candid_Result vulkan_buffer_update(Candid_Device *device,
-                                          Candid_Buffer *buffer, size_t offset,
-                                          const void *data, size_t size) {
-  (void)device;
-  (void)buffer;
-  (void)offset;
-  (void)data;
-  (void)size;
-  return CANDID_ERROR_RESOURCE_CREATION;
+/* One semaphore per swapchain image, signaled by the frame drawing it */
+static Candid_Result create_render_finished(Candid_Device *device) {
+  device->render_finished_semaphores =
+      calloc(device->swapchain_image_count, sizeof(VkSemaphore));
+  if (!device->render_finished_semaphores)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  VkSemaphoreCreateInfo semaphore_info = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+  };
+  for (uint32_t i = 0; i < device->swapchain_image_count; ++i) {
+    if (vkCreateSemaphore(device->device, &semaphore_info, NULL,
+                          &device->render_finished_semaphores[i]) !=
+        VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
+  }
+  return CANDID_SUCCESS;
 }
 
-static void *vulkan_buffer_map(Candid_Device *device, Candid_Buffer *buffer) {
-  (void)device;
-  (void)buffer;
-  return NULL;
-}
+/**
+ * Swapchain, image views and render-finished semaphores for the surface at
+ * width x height. Images still presented from `old` stay valid until it is
+ * destroyed.
+ */
+static Candid_Result create_swapchain(Candid_Device *device,
+                                      VkSwapchainKHR old) {
+  VkSurfaceCapabilitiesKHR caps;
+  if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+          device->physical_device, device->surface, &caps) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
 
-static void vulkan_buffer_unmap(Candid_Device *device, Candid_Buffer *buffer) {
-  (void)device;
-  (void)buffer;
-}
+  VkExtent2D extent = caps.currentExtent;
+  if (extent.width == UINT32_MAX) {
+    extent.width = SDL_clamp(device->width, caps.minImageExtent.width,
+                             caps.maxImageExtent.width);
+    extent.height = SDL_clamp(device->height, caps.minImageExtent.height,
+                              caps.maxImageExtent.height);
+  }
+  if (extent.width == 0 || extent.height == 0)
+    return CANDID_ERROR_RESOURCE_CREATION; /* Minimized */
 
-static Candid_Result vulkan_texture_create(Candid_Device *device,
+  VkSurfaceFormatKHR format = choose_surface_format(device);
+  uint32_t families[] = {device->graphics_family, device->present_family};
+  bool shared = device->graphics_family != device->present_family;
+  VkSwapchainCreateInfoKHR create_info = {
+      .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+      .surface = device->surface,
+      .minImageCount = choose_image_count(device, &caps),
+      .imageFormat = format.format,
+      .imageColorSpace = format.colorSpace,
+      .imageExtent = extent,
+      .imageArrayLayers = 1,
+      .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+      .imageSharingMode =
+          shared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = shared ? 2 : 0,
+      .pQueueFamilyIndices = shared ? families : NULL,
+      .preTransform = caps.currentTransform,
+      .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+      .presentMode = choose_present_mode(device),
+      .clipped = VK_TRUE,
+      .oldSwapchain = old,
+  };
+  if (vkCreateSwapchainKHR(device->device, &create_info, NULL,
+                           &device->swapchain) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+  device->swapchain_format = format.format;
+  device->swapchain_extent = extent;
+
+  /* The driver may create more images than requested */
+  uint32_t count = 0;
+  vkGetSwapchainImagesKHR(device->device, device->swapchain, &count, NULL);
+  device->swapchain_images = calloc(count, sizeof(VkImage));
+  device->swapchain_image_views = calloc(count, sizeof(VkImageView));
+  device->framebuffers = calloc(count, sizeof(VkFramebuffer));
+  if (!device->swapchain_images || !device->swapchain_image_views ||
+      !device->framebuffers)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  vkGetSwapchainImagesKHR(device->device, device->swapchain, &count,
+                          device->swapchain_images);
+  device->swapchain_image_count = count;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = device->swapchain_images[i],
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format.format,
+        .subresourceRange =
+            {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .levelCount = 1,
+                .layerCount = 1,
+            },
+    };
+    if (vkCreateImageView(device->device, &view_info, NULL,
+                          &device->swapchain_image_views[i]) != VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
+  }
+  return create_render_finished(device);
+}
+
+/* Depth attachment of the frame pass, at the swapchain extent */
+static Candid_Result create_depth_buffer(Candid_Device *device) {
+  VkExtent2D extent = device->swapchain_extent;
+  VkImageCreateInfo image_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = VULKAN_DEPTH_FORMAT,
+      .extent = {extent.width, extent.height, 1},
+      .mipLevels = 1,
+      .arrayLayers = 1,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+               (device->sampled_depth ? VK_IMAGE_USAGE_SAMPLED_BIT : 0),
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+  if (vkCreateImage(device->device, &image_info, NULL,
+                    &device->depth_image) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(device->device, device->depth_image,
+                               &requirements);
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = requirements.size,
+      .memoryTypeIndex =
+          find_memory_type(device->physical_device,
+                           requirements.memoryTypeBits,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+  };
+  if (alloc_info.memoryTypeIndex == UINT32_MAX ||
+      vkAllocateMemory(device->device, &alloc_info, NULL,
+                       &device->depth_image_memory) != VK_SUCCESS ||
+      vkBindImageMemory(device->device, device->depth_image,
+                        device->depth_image_memory, 0) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  VkImageViewCreateInfo view_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = device->depth_image,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D,
+      .format = VULKAN_DEPTH_FORMAT,
+      .subresourceRange =
+          {
+              .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+              .levelCount = 1,
+              .layerCount = 1,
+          },
+  };
+  if (vkCreateImageView(device->device, &view_info, NULL,
+                        &device->depth_image_view) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  /* The same Candid_Texture across resizes, like the Metal backend's */
+  if (!device->sampled_depth)
+    return CANDID_SUCCESS;
+  if (!device->depth_target) {
+    device->depth_target = calloc(1, sizeof(Candid_Texture));
+    if (!device->depth_target)
+      return CANDID_ERROR_OUT_OF_MEMORY;
+  }
+  *device->depth_target = (Candid_Texture){
+      .image = device->depth_image,
+      .view = device->depth_image_view,
+      .desc =
+          {
+              .width = extent.width,
+              .height = extent.height,
+              .depth = 1,
+              .mip_levels = 1,
+              .array_layers = 1,
+              .format = CANDID_TEXTURE_FORMAT_DEPTH32_FLOAT,
+              .usage = CANDID_TEXTURE_USAGE_DEPTH_STENCIL |
+                       CANDID_TEXTURE_USAGE_SAMPLED,
+          },
+  };
+  return CANDID_SUCCESS;
+}
+
+/* The frame pass framebuffer of a swapchain image, created on first use */
+static VkFramebuffer get_framebuffer(Candid_Device *device,
+                                     uint32_t image_index) {
+  if (device->framebuffers[image_index])
+    return device->framebuffers[image_index];
+
+  VkImageView attachments[] = {device->swapchain_image_views[image_index],
+                               device->depth_image_view};
+  VkFramebufferCreateInfo framebuffer_info = {
+      .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+      .renderPass = device->render_pass,
+      .attachmentCount = 2,
+      .pAttachments = attachments,
+      .width = device->swapchain_extent.width,
+      .height = device->swapchain_extent.height,
+      .layers = 1,
+  };
+  vkCreateFramebuffer(device->device, &framebuffer_info, NULL,
+                      &device->framebuffers[image_index]);
+  return device->framebuffers[image_index];
+}
+
+/* Hand what belongs to the current swapchain images to the frames that may
+ * still use them; the swapchain itself is left to the caller */
+static void retire_swapchain_images(Candid_Device *device) {
+  for (uint32_t i = 0; i < device->swapchain_image_count; ++i) {
+    if (device->framebuffers)
+      retire_handle(device, VK_OBJECT_TYPE_FRAMEBUFFER,
+                    (uint64_t)device->framebuffers[i]);
+    if (device->swapchain_image_views)
+      retire_handle(device, VK_OBJECT_TYPE_IMAGE_VIEW,
+                    (uint64_t)device->swapchain_image_views[i]);
+    /* A queued presentation may still wait on it */
+    if (device->render_finished_semaphores)
+      retire_present_handle(device, VK_OBJECT_TYPE_SEMAPHORE,
+                            (uint64_t)device->render_finished_semaphores[i]);
+  }
+  free(device->framebuffers);
+  free(device->swapchain_image_views);
+  free(device->swapchain_images);
+  free(device->render_finished_semaphores);
+  device->framebuffers = NULL;
+  device->swapchain_image_views = NULL;
+  device->swapchain_images = NULL;
+  device->render_finished_semaphores = NULL;
+  device->swapchain_image_count = 0;
+
+  retire_handle(device, VK_OBJECT_TYPE_IMAGE_VIEW,
+                (uint64_t)device->depth_image_view);
+  retire_handle(device, VK_OBJECT_TYPE_IMAGE, (uint64_t)device->depth_image);
+  retire_handle(device, VK_OBJECT_TYPE_DEVICE_MEMORY,
+                (uint64_t)device->depth_image_memory);
+  device->depth_image_view = VK_NULL_HANDLE;
+  device->depth_image = VK_NULL_HANDLE;
+  device->depth_image_memory = VK_NULL_HANDLE;
+  /* Hidden until a new depth buffer fills it */
+  if (device->depth_target)
+    *device->depth_target = (Candid_Texture){0};
+}
+
+/**
+ * Replace the swapchain after a resize or an out-of-date acquire or
+ * present, without idling the device. The old swapchain is passed on as
+ * oldSwapchain and retired with its views, framebuffers and depth buffer,
+ * destroyed once the frames in flight that use them have completed; it and
+ * its semaphores also wait for its queued presentations (see
+ * retire_present_handle). Framebuffers of the new images are created as
+ * they are first drawn to.
+ */
+static Candid_Result recreate_swapchain(Candid_Device *device) {
+  /* Minimized: keep the old swapchain until there is something to show */
+  if (device->width == 0 || device->height == 0)
+    return CANDID_SUCCESS;
+
+  VkSwapchainKHR old = device->swapchain;
+  retire_swapchain_images(device);
+  device->swapchain = VK_NULL_HANDLE;
+  Candid_Result result = create_swapchain(device, old);
+  /* Retired by the creation, even a failed one */
+  retire_present_handle(device, VK_OBJECT_TYPE_SWAPCHAIN_KHR, (uint64_t)old);
+  if (result == CANDID_SUCCESS)
+    result = create_depth_buffer(device);
+  /* Tried again at the next acquisition */
+  device->swapchain_dirty = result != CANDID_SUCCESS;
+  return result;
+}
+
+/*******************************************************************************
+ * Device Creation
+ ******************************************************************************/
+
+static bool has_device_extension(VkPhysicalDevice physical_device,
+                                 const char *name) {
+  uint32_t count = 0;
+  vkEnumerateDeviceExtensionProperties(physical_device, NULL, &count, NULL);
+  VkExtensionProperties *extensions =
+      malloc(count * sizeof(VkExtensionProperties));
+  if (!extensions)
+    return false;
+  vkEnumerateDeviceExtensionProperties(physical_device, NULL, &count,
+                                       extensions);
+  bool found = false;
+  for (uint32_t i = 0; i < count && !found; ++i)
+    found = strcmp(extensions[i].extensionName, name) == 0;
+  free(extensions);
+  return found;
+}
+
+/**
+ * Queue families of a physical device for the surface: graphics and present
+ * from one family when possible, compute from a family without GRAPHICS,
+ * or graphics_family when there is none.
+ * @return false without a graphics or present family
+ */
+static bool find_queue_families(Candid_Device *device,
+                                VkPhysicalDevice physical_device) {
+  VkQueueFamilyProperties families[16];
+  uint32_t count = 16;
+  vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count,
+                                           families);
+  device->graphics_family = UINT32_MAX;
+  device->present_family = UINT32_MAX;
+  device->compute_family = UINT32_MAX;
+  for (uint32_t i = 0; i < count; ++i) {
+    VkBool32 present = VK_FALSE;
+    vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, device->surface,
+                                         &present);
+    bool graphics = families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT;
+    bool shared = device->graphics_family != UINT32_MAX &&
+                  device->graphics_family == device->present_family;
+    if (graphics && present && !shared) {
+      device->graphics_family = i;
+      device->present_family = i;
+    }
+    if (graphics && device->graphics_family == UINT32_MAX)
+      device->graphics_family = i;
+    if (present && device->present_family == UINT32_MAX)
+      device->present_family = i;
+    if (!graphics && (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+        device->compute_family == UINT32_MAX)
+      device->compute_family = i;
+  }
+  if (device->compute_family == UINT32_MAX)
+    device->compute_family = device->graphics_family;
+  return device->graphics_family != UINT32_MAX &&
+         device->present_family != UINT32_MAX;
+}
+
+/* A Vulkan 1.2 device that presents to the surface, discrete first */
+static Candid_Result pick_physical_device(Candid_Device *device) {
+  VkPhysicalDevice physical_devices[16];
+  uint32_t count = 16;
+  vkEnumeratePhysicalDevices(device->instance, &count, physical_devices);
+  int best_score = -1;
+  for (uint32_t i = 0; i < count; ++i) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physical_devices[i], &props);
+    if (props.apiVersion < VK_API_VERSION_1_2 ||
+        !has_device_extension(physical_devices[i],
+                              VK_KHR_SWAPCHAIN_EXTENSION_NAME) ||
+        !find_queue_families(device, physical_devices[i]))
+      continue;
+    int score = props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 2
+                : props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU
+                    ? 1
+                    : 0;
+    if (score > best_score) {
+      best_score = score;
+      device->physical_device = physical_devices[i];
+    }
+  }
+  if (!device->physical_device)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+  find_queue_families(device, device->physical_device);
+  return CANDID_SUCCESS;
+}
+
+/* Timeline semaphore per Candid_Queue, at 0 */
+static Candid_Result create_queue_timelines(Candid_Device *device) {
+  VkSemaphoreTypeCreateInfo type_info = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+      .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+      .initialValue = 0,
+  };
+  VkSemaphoreCreateInfo semaphore_info = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+      .pNext = &type_info,
+  };
+  for (uint32_t q = 0; q < CANDID_QUEUE_COUNT; ++q) {
+    if (vkCreateSemaphore(device->device, &semaphore_info, NULL,
+                          &device->queue_timelines[q]) != VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
+  }
+  return CANDID_SUCCESS;
+}
+
+/**
+ * Logical device with one queue per family, enabling the optional features
+ * the backend uses when supported and recording them in the capability
+ * flags; the draw and bind paths fall back without them.
+ */
+static Candid_Result create_logical_device(Candid_Device *device) {
+  VkPhysicalDeviceVulkan12Features supported12 = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+  };
+  VkPhysicalDeviceVulkan11Features supported11 = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+      .pNext = &supported12,
+  };
+  VkPhysicalDeviceFeatures2 supported = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+      .pNext = &supported11,
+  };
+  vkGetPhysicalDeviceFeatures2(device->physical_device, &supported);
+
+  /* Bindless tables need all of them */
+  bool indexing = supported12.runtimeDescriptorArray &&
+                  supported12.descriptorBindingPartiallyBound &&
+                  supported12.shaderSampledImageArrayNonUniformIndexing &&
+                  supported12.descriptorBindingSampledImageUpdateAfterBind &&
+                  supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+                  supported12.descriptorBindingUpdateUnusedWhilePending;
+  VkPhysicalDeviceVulkan12Features features12 = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+      .drawIndirectCount = supported12.drawIndirectCount,
+      .runtimeDescriptorArray = indexing,
+      .descriptorBindingPartiallyBound = indexing,
+      .shaderSampledImageArrayNonUniformIndexing = indexing,
+      .descriptorBindingSampledImageUpdateAfterBind = indexing,
+      .descriptorBindingStorageBufferUpdateAfterBind = indexing,
+      .descriptorBindingUpdateUnusedWhilePending = indexing,
+      .imagelessFramebuffer = supported12.imagelessFramebuffer,
+      .timelineSemaphore = supported12.timelineSemaphore,
+  };
+  /* BaseVertex in vertex_pulling.hlsl */
+  VkPhysicalDeviceVulkan11Features features11 = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+      .pNext = &features12,
+      .shaderDrawParameters = supported11.shaderDrawParameters,
+  };
+  VkPhysicalDeviceFeatures2 features = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+      .pNext = &features11,
+      .features =
+          {
+              .multiDrawIndirect = supported.features.multiDrawIndirect,
+              .drawIndirectFirstInstance =
+                  supported.features.drawIndirectFirstInstance,
+              .samplerAnisotropy = supported.features.samplerAnisotropy,
+          },
+  };
+
+  const char *extensions[3] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  uint32_t extension_count = 1;
+  bool push_descriptor = has_device_extension(
+      device->physical_device, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+  if (push_descriptor)
+    extensions[extension_count++] = VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME;
+#if defined(__APPLE__)
+  /* Required when the implementation exposes it (MoltenVK) */
+  if (has_device_extension(device->physical_device,
+                           "VK_KHR_portability_subset"))
+    extensions[extension_count++] = "VK_KHR_portability_subset";
+#endif
+
+  float priority = 1.0f;
+  uint32_t families[] = {device->graphics_family, device->present_family,
+                         device->compute_family};
+  VkDeviceQueueCreateInfo queue_infos[3];
+  uint32_t queue_info_count = 0;
+  for (uint32_t i = 0; i < 3; ++i) {
+    bool seen = false;
+    for (uint32_t j = 0; j < queue_info_count; ++j)
+      seen |= queue_infos[j].queueFamilyIndex == families[i];
+    if (seen)
+      continue;
+    queue_infos[queue_info_count++] = (VkDeviceQueueCreateInfo){
+        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .queueFamilyIndex = families[i],
+        .queueCount = 1,
+        .pQueuePriorities = &priority,
+    };
+  }
+
+  VkDeviceCreateInfo device_info = {
+      .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+      .pNext = &features,
+      .queueCreateInfoCount = queue_info_count,
+      .pQueueCreateInfos = queue_infos,
+      .enabledExtensionCount = extension_count,
+      .ppEnabledExtensionNames = extensions,
+  };
+  if (vkCreateDevice(device->physical_device, &device_info, NULL,
+                     &device->device) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+  volkLoadDevice(device->device);
+
+  vkGetDeviceQueue(device->device, device->graphics_family, 0,
+                   &device->graphics_queue);
+  vkGetDeviceQueue(device->device, device->present_family, 0,
+                   &device->present_queue);
+  vkGetDeviceQueue(device->device, device->compute_family, 0,
+                   &device->compute_queue);
+
+  device->multi_draw_indirect = features.features.multiDrawIndirect;
+  device->draw_indirect_first_instance =
+      features.features.drawIndirectFirstInstance;
+  device->draw_indirect_count = features12.drawIndirectCount;
+  device->push_descriptor = push_descriptor;
+  device->descriptor_indexing = indexing;
+  device->imageless_framebuffer = features12.imagelessFramebuffer;
+  device->sampler_anisotropy = features.features.samplerAnisotropy;
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(device->physical_device, &props);
+  device->max_anisotropy = props.limits.maxSamplerAnisotropy;
+  /* Without timelines, queue sync points are not tracked */
+  if (features12.timelineSemaphore)
+    return create_queue_timelines(device);
+  return CANDID_SUCCESS;
+}
+
+/**
+ * The frame pass over a swapchain image and depth_image, and its
+ * LOAD_OP_LOAD variant resuming it around secondaries. Depth is stored for
+ * that resumption; with sampled_depth it ends read-only for the depth
+ * pyramid.
+ */
+static Candid_Result create_frame_passes(Candid_Device *device) {
+  VkImageLayout depth_layout =
+      device->sampled_depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                            : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  VkAttachmentDescription attachments[2] = {
+      {
+          .format = device->swapchain_format,
+          .samples = VK_SAMPLE_COUNT_1_BIT,
+          .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+          .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+          .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+          .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+          .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+          .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+      },
+      {
+          .format = VULKAN_DEPTH_FORMAT,
+          .samples = VK_SAMPLE_COUNT_1_BIT,
+          .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+          .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+          .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+          .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+          .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+          .finalLayout = depth_layout,
+      },
+  };
+  VkAttachmentReference color_ref = {
+      .attachment = 0,
+      .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+  };
+  VkAttachmentReference depth_ref = {
+      .attachment = 1,
+      .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+  };
+  VkSubpassDescription subpass = {
+      .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+      .colorAttachmentCount = 1,
+      .pColorAttachments = &color_ref,
+      .pDepthStencilAttachment = &depth_ref,
+  };
+  /* Color waits for the acquisition (submit_timeline waits at color
+   * output); depth for the previous frame's pass and readers */
+  VkSubpassDependency dependency = {
+      .srcSubpass = VK_SUBPASS_EXTERNAL,
+      .dstSubpass = 0,
+      .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+      .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                       VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                       VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+  };
+  VkRenderPassCreateInfo pass_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+      .attachmentCount = 2,
+      .pAttachments = attachments,
+      .subpassCount = 1,
+      .pSubpasses = &subpass,
+      .dependencyCount = 1,
+      .pDependencies = &dependency,
+  };
+  if (vkCreateRenderPass(device->device, &pass_info, NULL,
+                         &device->render_pass) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[0].initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[1].initialLayout = depth_layout;
+  if (vkCreateRenderPass(device->device, &pass_info, NULL,
+                         &device->render_pass_load) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+  return CANDID_SUCCESS;
+}
+
+/*******************************************************************************
+ * Device Functions
+ ******************************************************************************/
+
+static void vulkan_device_destroy(Candid_Device *device);
+static void destroy_compute_kernels(Candid_Device *device);
+
+static Candid_Result vulkan_device_create(const Candid_DeviceDesc *desc,
+                                          Candid_Device **out) {
+  /* The surface is created from an SDL_Window with SDL_WINDOW_VULKAN */
+  if (!desc || !out || !desc->native_window)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  /* Initialize Volk */
+  VkResult result = volkInitialize();
+  if (result != VK_SUCCESS) {
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+  }
+
+  Candid_Device *device = calloc(1, sizeof(Candid_Device));
+  if (!device)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  device->width = desc->width;
+  device->height = desc->height;
+  device->validation_enabled = desc->debug_mode;
+  device->sampled_depth = desc->sampled_depth;
+  device->pipeline_list = desc->pipeline_list;
+  device->present_mode = desc->present_mode;
+  device->requested_image_count = desc->swapchain_image_count;
+  device->max_frames_in_flight = desc->max_frames_in_flight;
+  if (device->max_frames_in_flight == 0)
+    device->max_frames_in_flight = 2;
+  if (device->max_frames_in_flight > VULKAN_MAX_FRAMES_IN_FLIGHT)
+    device->max_frames_in_flight = VULKAN_MAX_FRAMES_IN_FLIGHT;
+  device->target_lock = SDL_CreateMutex();
+  device->garbage_lock = SDL_CreateMutex();
+  if (!device->target_lock || !device->garbage_lock) {
+    vulkan_device_destroy(device);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  /* Create Vulkan instance */
+  VkApplicationInfo app_info = {
+      .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+      .pApplicationName = desc->app_name ? desc->app_name : "Candid Engine",
+      .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+      .pEngineName = "Candid Engine",
+      .engineVersion = VK_MAKE_VERSION(0, 1, 0),
+      .apiVersion = VK_API_VERSION_1_2,
+  };
+
+  /* The window system's surface extensions, as SDL needs them */
+  Uint32 surface_extension_count = 0;
+  const char *const *surface_extensions =
+      SDL_Vulkan_GetInstanceExtensions(&surface_extension_count);
+  const char *extensions[16];
+  uint32_t extension_count = 0;
+  if (!surface_extensions || surface_extension_count > 14) {
+    vulkan_device_destroy(device);
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+  }
+  for (Uint32 i = 0; i < surface_extension_count; ++i)
+    extensions[extension_count++] = surface_extensions[i];
+#if defined(__APPLE__)
+  extensions[extension_count++] =
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME;
+#endif
+  if (desc->debug_mode)
+    extensions[extension_count++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+
+  const char *validation_layers[] = {"VK_LAYER_KHRONOS_validation"};
+
+  VkInstanceCreateInfo create_info = {
+      .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+      .pApplicationInfo = &app_info,
+      .enabledExtensionCount = extension_count,
+      .ppEnabledExtensionNames = extensions,
+#if defined(__APPLE__)
+      .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+  };
+
+  if (desc->debug_mode) {
+    create_info.enabledLayerCount = 1;
+    create_info.ppEnabledLayerNames = validation_layers;
+  }
+
+  result = vkCreateInstance(&create_info, NULL, &device->instance);
+  if (result != VK_SUCCESS) {
+    vulkan_device_destroy(device);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  volkLoadInstance(device->instance);
+
+  /* Setup debug messenger if validation enabled */
+  if (desc->debug_mode) {
+    VkDebugUtilsMessengerCreateInfoEXT debug_info = {
+        .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
+        .messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+                           VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+                           VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+        .messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+                       VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                       VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+        .pfnUserCallback = debug_callback,
+    };
+    vkCreateDebugUtilsMessengerEXT(device->instance, &debug_info, NULL,
+                                   &device->debug_messenger);
+  }
+
+  if (!SDL_Vulkan_CreateSurface((SDL_Window *)desc->native_window,
+                                device->instance, NULL, &device->surface)) {
+    vulkan_device_destroy(device);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  Candid_Result device_result = pick_physical_device(device);
+  if (device_result == CANDID_SUCCESS)
+    device_result = create_logical_device(device);
+  if (device_result != CANDID_SUCCESS) {
+    vulkan_device_destroy(device);
+    return device_result;
+  }
+
+  /* Framebuffers of the swapchain images are created on first use
+   * (get_framebuffer); the passes take the swapchain's format */
+  if (create_swapchain(device, VK_NULL_HANDLE) != CANDID_SUCCESS ||
+      create_frame_passes(device) != CANDID_SUCCESS ||
+      create_depth_buffer(device) != CANDID_SUCCESS ||
+      create_frames(device) != CANDID_SUCCESS) {
+    vulkan_device_destroy(device);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = device;
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_device_destroy(Candid_Device *device) {
+  if (!device)
+    return;
+
+  /* Cleanup resources in reverse order */
+  if (device->device) {
+    vkDeviceWaitIdle(device->device);
+    destroy_compute_kernels(device);
+    if (device->bindless_layout)
+      vkDestroyDescriptorSetLayout(device->device, device->bindless_layout,
+                                   NULL);
+    if (device->bindless_sampler)
+      vkDestroySampler(device->device, device->bindless_sampler, NULL);
+    for (uint32_t i = 0; i < device->target_framebuffer_count; ++i)
+      vkDestroyFramebuffer(device->device,
+                           device->target_framebuffers[i].framebuffer, NULL);
+    for (uint32_t i = 0; i < device->target_pass_count; ++i)
+      vkDestroyRenderPass(device->device,
+                          device->target_passes[i].render_pass, NULL);
+    /* Collected with the rest of the frames' garbage */
+    retire_swapchain_images(device);
+    retire_handle(device, VK_OBJECT_TYPE_SWAPCHAIN_KHR,
+                  (uint64_t)device->swapchain);
+    age_present_garbage(device, true);
+    destroy_frames(device);
+    if (device->render_pass)
+      vkDestroyRenderPass(device->device, device->render_pass, NULL);
+    if (device->render_pass_load)
+      vkDestroyRenderPass(device->device, device->render_pass_load, NULL);
+    for (uint32_t i = 0; i < CANDID_QUEUE_COUNT; ++i) {
+      if (device->queue_timelines[i])
+        vkDestroySemaphore(device->device, device->queue_timelines[i], NULL);
+    }
+    vkDestroyDevice(device->device, NULL);
+  }
+  SDL_DestroyMutex(device->target_lock);
+  SDL_DestroyMutex(device->garbage_lock);
+  free(device->present_garbage);
+  free(device->depth_target);
+
+  if (device->surface) {
+    vkDestroySurfaceKHR(device->instance, device->surface, NULL);
+  }
+
+  if (device->debug_messenger) {
+    vkDestroyDebugUtilsMessengerEXT(device->instance, device->debug_messenger,
+                                    NULL);
+  }
+
+  if (device->instance) {
+    vkDestroyInstance(device->instance, NULL);
+  }
+
+  free(device);
+}
+
+static Candid_Result vulkan_device_get_limits(Candid_Device *device,
+                                              Candid_DeviceLimits *out) {
+  if (!device || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  memset(out, 0, sizeof(*out));
+
+  if (device->physical_device) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(device->physical_device, &props);
+
+    out->max_texture_size = props.limits.maxImageDimension2D;
+    out->max_cube_map_size = props.limits.maxImageDimensionCube;
+    out->max_texture_array_layers = props.limits.maxImageArrayLayers;
+    out->max_vertex_attributes = props.limits.maxVertexInputAttributes;
+    out->max_vertex_buffers = props.limits.maxVertexInputBindings;
+    out->max_uniform_buffer_size = props.limits.maxUniformBufferRange;
+    out->max_storage_buffer_size = props.limits.maxStorageBufferRange;
+    out->max_compute_workgroup_size[0] =
+        props.limits.maxComputeWorkGroupSize[0];
+    out->max_compute_workgroup_size[1] =
+        props.limits.maxComputeWorkGroupSize[1];
+    out->max_compute_workgroup_size[2] =
+        props.limits.maxComputeWorkGroupSize[2];
+    out->max_compute_workgroups[0] = props.limits.maxComputeWorkGroupCount[0];
+    out->max_compute_workgroups[1] = props.limits.maxComputeWorkGroupCount[1];
+    out->max_compute_workgroups[2] = props.limits.maxComputeWorkGroupCount[2];
+    out->max_anisotropy = props.limits.maxSamplerAnisotropy;
+
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(device->physical_device, &features);
+    out->supports_geometry_shader = features.geometryShader;
+    out->supports_tessellation = features.tessellationShader;
+    out->supports_compute = true;
+    out->supports_async_compute =
+        device->compute_queue &&
+        device->compute_queue != device->graphics_queue &&
+        device->queue_timelines[CANDID_QUEUE_COMPUTE];
+    out->supports_indirect_draw = device->draw_indirect_first_instance;
+  }
+
+  return CANDID_SUCCESS;
+}
+
+/*******************************************************************************
+ * Stub implementations for remaining functions
+ ******************************************************************************/
+
+static Candid_Result vulkan_swapchain_resize(Candid_Device *device,
+                                             uint32_t width, uint32_t height) {
+  if (!device)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  device->width = width;
+  device->height = height;
+  /* Replaced at the next acquisition, so a window drag recreates it once
+   * per frame at most and never waits for the GPU */
+  device->swapchain_dirty = true;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Texture *
+vulkan_swapchain_get_depth_texture(Candid_Device *device) {
+  /* Empty while the swapchain could not be recreated */
+  if (!device || !device->sampled_depth || !device->depth_target ||
+      !device->depth_target->image)
+    return NULL;
+  return device->depth_target;
+}
+
+static void evict_target_framebuffers(Candid_Device *device);
+
+static Candid_Result vulkan_swapchain_present(Candid_Device *device) {
+  if (!device)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Result status = CANDID_SUCCESS;
+  if (device->present_pending) {
+    device->present_pending = false;
+    VkPresentInfoKHR present_info = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores =
+            &device->render_finished_semaphores[device->present_image],
+        .swapchainCount = 1,
+        .pSwapchains = &device->swapchain,
+        .pImageIndices = &device->present_image,
+    };
+    VkResult result = vkQueuePresentKHR(device->present_queue, &present_info);
+    if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
+      device->swapchain_dirty = true;
+    else if (result != VK_SUCCESS)
+      status = CANDID_ERROR_DEVICE_LOST;
+  }
+
+  /* The next frame records into the next slot, waiting only for the frame
+   * that used it max_frames_in_flight frames ago */
+  SDL_LockMutex(device->garbage_lock);
+  device->current_frame =
+      (device->current_frame + 1) % device->max_frames_in_flight;
+  SDL_UnlockMutex(device->garbage_lock);
+  device->frame_number++;
+  age_present_garbage(device, false);
+  evict_target_framebuffers(device);
+  return status;
+}
+
+static Candid_Result vulkan_frame_wait(Candid_Device *device) {
+  if (!device)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (device->device)
+    wait_frame(device, &device->frames[device->current_frame]);
+  return CANDID_SUCCESS;
+}
+
+/**
+ * Memory type for a buffer: GPU_ONLY is device-local, the other kinds are
+ * host-visible and coherent, cached for readback when possible. GPU_ONLY
+ * buffers created with data take device-local memory the host can write
+ * (integrated GPUs, resizable BAR) or host memory, so creation needs no
+ * copy on a queue other threads submit to.
+ */
+static uint32_t buffer_memory_type(Candid_Device *device,
+                                   const Candid_BufferDesc *desc,
+                                   uint32_t type_filter) {
+  const VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  VkMemoryPropertyFlags preferred = host;
+  if (desc->memory == CANDID_BUFFER_MEMORY_GPU_TO_CPU)
+    preferred = host | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+  else if (desc->memory == CANDID_BUFFER_MEMORY_GPU_ONLY)
+    preferred = desc->initial_data
+                    ? host | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                    : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+  uint32_t type = find_memory_type(device->physical_device, type_filter,
+                                   preferred);
+  if (type == UINT32_MAX && preferred != host &&
+      (desc->memory != CANDID_BUFFER_MEMORY_GPU_ONLY || desc->initial_data))
+    type = find_memory_type(device->physical_device, type_filter, host);
+  return type;
+}
+
+static Candid_Result vulkan_buffer_create(Candid_Device *device,
+                                          const Candid_BufferDesc *desc,
+                                          Candid_Buffer **out) {
+  if (!device || !desc || desc->size == 0 || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!device->device)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  Candid_Buffer *buffer = calloc(1, sizeof(Candid_Buffer));
+  if (!buffer)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  buffer->size = desc->size;
+  buffer->memory_type = desc->memory;
+
+  /* Shared with the async compute queue without ownership transfers, like
+   * images */
+  uint32_t families[] = {device->graphics_family, device->compute_family};
+  bool concurrent = device->compute_queue &&
+                    device->compute_family != device->graphics_family;
+  VkBufferCreateInfo buffer_info = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .size = desc->size,
+      .usage = buffer_usage_to_vk(desc->usage),
+      .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT
+                                : VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = concurrent ? 2 : 0,
+      .pQueueFamilyIndices = families,
+  };
+  if (vkCreateBuffer(device->device, &buffer_info, NULL, &buffer->buffer) !=
+      VK_SUCCESS) {
+    free(buffer);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(device->device, buffer->buffer,
+                                &requirements);
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = requirements.size,
+      .memoryTypeIndex =
+          buffer_memory_type(device, desc, requirements.memoryTypeBits),
+  };
+  bool host_visible = desc->memory != CANDID_BUFFER_MEMORY_GPU_ONLY ||
+                      desc->initial_data;
+  if (alloc_info.memoryTypeIndex == UINT32_MAX ||
+      vkAllocateMemory(device->device, &alloc_info, NULL, &buffer->memory) !=
+          VK_SUCCESS ||
+      vkBindBufferMemory(device->device, buffer->buffer, buffer->memory, 0) !=
+          VK_SUCCESS ||
+      (host_visible && vkMapMemory(device->device, buffer->memory, 0,
+                                   VK_WHOLE_SIZE, 0,
+                                   &buffer->mapped) != VK_SUCCESS)) {
+    vkDestroyBuffer(device->device, buffer->buffer, NULL);
+    if (buffer->memory)
+      vkFreeMemory(device->device, buffer->memory, NULL);
+    free(buffer);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  if (desc->initial_data)
+    memcpy(buffer->mapped, desc->initial_data, desc->size);
+  /* GPU-only buffers are not mapped past their initial data */
+  if (desc->memory == CANDID_BUFFER_MEMORY_GPU_ONLY && buffer->mapped) {
+    vkUnmapMemory(device->device, buffer->memory);
+    buffer->mapped = NULL;
+  }
+
+  *out = buffer;
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_buffer_destroy(Candid_Device *device,
+                                  Candid_Buffer *buffer) {
+  if (!device || !buffer)
+    return;
+  /* Frames in flight may still read it */
+  retire_handle(device, VK_OBJECT_TYPE_BUFFER, (uint64_t)buffer->buffer);
+  retire_handle(device, VK_OBJECT_TYPE_DEVICE_MEMORY,
+                (uint64_t)buffer->memory);
+  free(buffer);
+}
+
+/* Host-visible buffers stay mapped and coherent: writes need no flush */
+static Candid_Result vulkan_buffer_update(Candid_Device *device,
+                                          Candid_Buffer *buffer, size_t offset,
+                                          const void *data, size_t size) {
+  (void)device;
+  if (!buffer || !data || offset + size > buffer->size)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!buffer->mapped)
+    return CANDID_ERROR_INVALID_ARGUMENT; /* GPU_ONLY: copy from staging */
+
+  memcpy((uint8_t *)buffer->mapped + offset, data, size);
+  return CANDID_SUCCESS;
+}
+
+static void *vulkan_buffer_map(Candid_Device *device, Candid_Buffer *buffer) {
+  (void)device;
+  return buffer ? buffer->mapped : NULL;
+}
+
+static void vulkan_buffer_unmap(Candid_Device *device, Candid_Buffer *buffer) {
+  (void)device;
+  (void)buffer;
+  /* Persistently mapped */
+}
+
+/* An image without memory; placed and dedicated textures bind it */
+static Candid_Result create_image(Candid_Device *device,
+                                  const Candid_TextureDesc *desc,
+                                  Candid_Texture **out) {
+  if (!device || !device->device || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Texture *texture = calloc(1, sizeof(Candid_Texture));
+  if (!texture)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  texture->desc = *desc;
+  texture->desc.label = NULL; /* Owned by the caller */
+
+  /* Shared with the async compute queue without ownership transfers */
+  uint32_t families[] = {device->graphics_family, device->compute_family};
+  bool concurrent = device->compute_queue &&
+                    device->compute_family != device->graphics_family;
+
+  uint32_t depth = desc->depth > 0 ? desc->depth : 1;
+  VkImageCreateInfo image_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .imageType = depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D,
+      .format = texture_format_to_vk(desc->format),
+      .extent = {desc->width, desc->height, depth},
+      .mipLevels = desc->mip_levels > 0 ? desc->mip_levels : 1,
+      .arrayLayers = desc->array_layers > 0 ? desc->array_layers : 1,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = texture_usage_to_vk(desc->usage),
+      .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT
+                                : VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = concurrent ? 2 : 0,
+      .pQueueFamilyIndices = families,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+  if (vkCreateImage(device->device, &image_info, NULL, &texture->image) !=
+      VK_SUCCESS) {
+    free(texture);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = texture;
+  return CANDID_SUCCESS;
+}
+
+/* The view of every level, and one per level for STORAGE textures */
+static Candid_Result create_texture_views(Candid_Device *device,
+                                          Candid_Texture *texture) {
+  const Candid_TextureDesc *desc = &texture->desc;
+  uint32_t levels = desc->mip_levels > 0 ? desc->mip_levels : 1;
+  uint32_t layers = desc->array_layers > 0 ? desc->array_layers : 1;
+  VkImageViewCreateInfo view_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = texture->image,
+      .viewType = desc->depth > 1 ? VK_IMAGE_VIEW_TYPE_3D
+                  : layers > 1    ? VK_IMAGE_VIEW_TYPE_2D_ARRAY
+                                  : VK_IMAGE_VIEW_TYPE_2D,
+      .format = texture_format_to_vk(desc->format),
+      .subresourceRange =
+          {
+              /* Sampled through the depth aspect alone */
+              .aspectMask = texture_format_has_depth(desc->format)
+                                ? VK_IMAGE_ASPECT_DEPTH_BIT
+                                : VK_IMAGE_ASPECT_COLOR_BIT,
+              .levelCount = levels,
+              .layerCount = layers,
+          },
+  };
+  if (vkCreateImageView(device->device, &view_info, NULL, &texture->view) !=
+      VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  if (desc->usage & (CANDID_TEXTURE_USAGE_RENDER_TARGET |
+                     CANDID_TEXTURE_USAGE_DEPTH_STENCIL)) {
+    VkImageViewCreateInfo target_info = view_info;
+    target_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    target_info.subresourceRange = (VkImageSubresourceRange){
+        .aspectMask = texture_aspect_to_vk(desc->format),
+        .levelCount = 1,
+        .layerCount = 1,
+    };
+    if (vkCreateImageView(device->device, &target_info, NULL,
+                          &texture->target_view) != VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  if (!(desc->usage & CANDID_TEXTURE_USAGE_STORAGE))
+    return CANDID_SUCCESS;
+  texture->mip_views = calloc(levels, sizeof(VkImageView));
+  if (!texture->mip_views)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  for (uint32_t i = 0; i < levels; ++i) {
+    view_info.subresourceRange.baseMipLevel = i;
+    view_info.subresourceRange.levelCount = 1;
+    if (vkCreateImageView(device->device, &view_info, NULL,
+                          &texture->mip_views[i]) != VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
+  }
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_texture_destroy(Candid_Device *device,
+                                   Candid_Texture *texture) {
+  if (!device || !texture)
+    return;
+  if (texture->mip_views) {
+    uint32_t levels =
+        texture->desc.mip_levels > 0 ? texture->desc.mip_levels : 1;
+    for (uint32_t i = 0; i < levels; ++i)
+      retire_handle(device, VK_OBJECT_TYPE_IMAGE_VIEW,
+                    (uint64_t)texture->mip_views[i]);
+    free(texture->mip_views);
+  }
+  /* Frames in flight may still sample or draw into it */
+  retire_handle(device, VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t)texture->view);
+  retire_handle(device, VK_OBJECT_TYPE_IMAGE_VIEW,
+                (uint64_t)texture->target_view);
+  retire_handle(device, VK_OBJECT_TYPE_IMAGE, (uint64_t)texture->image);
+  retire_handle(device, VK_OBJECT_TYPE_DEVICE_MEMORY,
+                (uint64_t)texture->memory);
+  free(texture);
+}
+
+static Candid_Result vulkan_texture_create(Candid_Device *device,
                                            const Candid_TextureDesc *desc,
                                            Candid_Texture **out) {
+  Candid_Texture *texture = NULL;
+  Candid_Result result = create_image(device, desc, &texture);
+  if (result != CANDID_SUCCESS)
+    return result;
+
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(device->device, texture->image, &requirements);
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = requirements.size,
+      .memoryTypeIndex =
+          find_memory_type(device->physical_device,
+                           requirements.memoryTypeBits,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+  };
+  result = CANDID_ERROR_RESOURCE_CREATION;
+  if (alloc_info.memoryTypeIndex != UINT32_MAX &&
+      vkAllocateMemory(device->device, &alloc_info, NULL, &texture->memory) ==
+          VK_SUCCESS &&
+      vkBindImageMemory(device->device, texture->image, texture->memory, 0) ==
+          VK_SUCCESS)
+    result = create_texture_views(device, texture);
+  if (result != CANDID_SUCCESS) {
+    vulkan_texture_destroy(device, texture);
+    return result;
+  }
+
+  *out = texture;
+  return CANDID_SUCCESS;
+}
+
+/* Heaps take any device-local type; images that cannot use it get their
+ * own memory from the caller instead */
+static Candid_Result vulkan_heap_create(Candid_Device *device, size_t size,
+                                        Candid_Heap **out) {
+  if (!device || !device->device || size == 0 || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Heap *heap = calloc(1, sizeof(Candid_Heap));
+  if (!heap)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  heap->size = size;
+  heap->memory_type = find_memory_type(device->physical_device, UINT32_MAX,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = size,
+      .memoryTypeIndex = heap->memory_type,
+  };
+  if (heap->memory_type == UINT32_MAX ||
+      vkAllocateMemory(device->device, &alloc_info, NULL, &heap->memory) !=
+          VK_SUCCESS) {
+    free(heap);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = heap;
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_heap_destroy(Candid_Device *device, Candid_Heap *heap) {
+  if (!device || !heap)
+    return;
+  retire_handle(device, VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t)heap->memory);
+  free(heap);
+}
+
+/* Requirements depend on the driver, so they are read from a throwaway
+ * image (vkGetDeviceImageMemoryRequirements needs Vulkan 1.3) */
+static void vulkan_texture_get_placement(Candid_Device *device,
+                                         const Candid_TextureDesc *desc,
+                                         size_t *size, size_t *alignment) {
+  *size = 0;
+  *alignment = 1;
+  Candid_Texture *texture = NULL;
+  if (create_image(device, desc, &texture) != CANDID_SUCCESS)
+    return;
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(device->device, texture->image, &requirements);
+  *size = (size_t)requirements.size;
+  *alignment = (size_t)requirements.alignment;
+  vulkan_texture_destroy(device, texture);
+}
+
+static Candid_Result vulkan_texture_create_placed(
+    Candid_Device *device, const Candid_TextureDesc *desc, Candid_Heap *heap,
+    size_t offset, Candid_Texture **out) {
+  if (!heap)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  Candid_Texture *texture = NULL;
+  Candid_Result result = create_image(device, desc, &texture);
+  if (result != CANDID_SUCCESS)
+    return result;
+
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(device->device, texture->image, &requirements);
+  result = CANDID_ERROR_RESOURCE_CREATION;
+  if ((requirements.memoryTypeBits & (1u << heap->memory_type)) &&
+      offset % requirements.alignment == 0 &&
+      offset + requirements.size <= heap->size &&
+      vkBindImageMemory(device->device, texture->image, heap->memory,
+                        offset) == VK_SUCCESS)
+    result = create_texture_views(device, texture);
+  if (result != CANDID_SUCCESS) {
+    vulkan_texture_destroy(device, texture);
+    return result;
+  }
+
+  *out = texture;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Result vulkan_texture_upload(Candid_Device *device,
+                                           Candid_Texture *texture,
+                                           uint32_t mip_level,
+                                           uint32_t array_layer,
+                                           const void *data, size_t size) {
   (void)device;
-  (void)desc;
-  (void)out;
+  (void)texture;
+  (void)mip_level;
+  (void)array_layer;
+  (void)data;
+  (void)size;
   return CANDID_ERROR_RESOURCE_CREATION;
 }
 
-static void vulkan_texture_destroy(Candid_Device *device,
-                                   Candid_Texture *texture) {
-  (void)device;
-  (void)texture;
+/* Vulkan only has fixed border colors: the closest of them */
+static VkBorderColor border_color_to_vk(const Candid_Color *color) {
+  if (color->a < 0.5f)
+    return VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+  if (color->r + color->g + color->b >= 1.5f)
+    return VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+  return VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+}
+
+static Candid_Result vulkan_sampler_create(Candid_Device *device,
+                                           const Candid_SamplerDesc *desc,
+                                           Candid_Sampler **out) {
+  if (!device || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!device->device)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  Candid_Sampler *sampler = calloc(1, sizeof(Candid_Sampler));
+  if (!sampler)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  /* Anisotropy is only enabled when the device enabled the feature */
+  float anisotropy = SDL_min(desc->max_anisotropy, device->max_anisotropy);
+  VkSamplerCreateInfo sampler_info = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = sampler_filter_to_vk(desc->mag_filter),
+      .minFilter = sampler_filter_to_vk(desc->min_filter),
+      .mipmapMode = desc->mip_filter == CANDID_SAMPLER_FILTER_NEAREST
+                        ? VK_SAMPLER_MIPMAP_MODE_NEAREST
+                        : VK_SAMPLER_MIPMAP_MODE_LINEAR,
+      .addressModeU = sampler_address_to_vk(desc->address_u),
+      .addressModeV = sampler_address_to_vk(desc->address_v),
+      .addressModeW = sampler_address_to_vk(desc->address_w),
+      .anisotropyEnable = device->sampler_anisotropy && anisotropy > 1.0f,
+      .maxAnisotropy = anisotropy > 1.0f ? anisotropy : 1.0f,
+      .maxLod = VK_LOD_CLAMP_NONE,
+      .borderColor = border_color_to_vk(&desc->border_color),
+  };
+  if (vkCreateSampler(device->device, &sampler_info, NULL,
+                      &sampler->sampler) != VK_SUCCESS) {
+    free(sampler);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = sampler;
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_sampler_destroy(Candid_Device *device,
+                                   Candid_Sampler *sampler) {
+  if (!device || !sampler)
+    return;
+  /* Frames in flight may still sample with it */
+  retire_handle(device, VK_OBJECT_TYPE_SAMPLER, (uint64_t)sampler->sampler);
+  free(sampler);
+}
+
+static Candid_Result
+vulkan_shader_module_create(Candid_Device *device,
+                            const Candid_ShaderModuleDesc *desc,
+                            Candid_ShaderModule **out) {
+  if (!device || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (desc->source_type != CANDID_SHADER_SOURCE_SPIRV || !desc->bytecode)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  Candid_ShaderModule *module = calloc(1, sizeof(Candid_ShaderModule));
+  if (!module)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  /* The layout of programs is built from the reflection of their stages */
+  Candid_ShaderBytecode bytecode = {
+      .data = desc->bytecode,
+      .size = desc->bytecode_size,
+      .type = CANDID_SHADER_SOURCE_SPIRV,
+  };
+  Candid_Result result = candid_shader_reflect(&bytecode, &module->reflection);
+  if (result != CANDID_SUCCESS) {
+    free(module);
+    return result;
+  }
+  for (uint32_t i = 0; i < module->reflection.uniform_count; ++i)
+    module->reflection.uniforms[i].name = NULL;
+  for (uint32_t i = 0; i < module->reflection.vertex_input_count; ++i)
+    module->reflection.vertex_inputs[i].name = NULL;
+
+  VkShaderModuleCreateInfo create_info = {
+      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+      .codeSize = desc->bytecode_size,
+      .pCode = desc->bytecode,
+  };
+  if (vkCreateShaderModule(device->device, &create_info, NULL,
+                           &module->module) != VK_SUCCESS) {
+    free(module);
+    return CANDID_ERROR_SHADER_COMPILATION;
+  }
+  module->stage = desc->stage;
+  snprintf(module->entry_point, sizeof(module->entry_point), "%s",
+           desc->entry_point ? desc->entry_point : "main");
+  candid_pipeline_program_hash(module->hash, desc->bytecode,
+                               desc->bytecode_size, module->entry_point);
+
+  *out = module;
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_shader_module_destroy(Candid_Device *device,
+                                         Candid_ShaderModule *module) {
+  if (!device || !module)
+    return;
+  vkDestroyShaderModule(device->device, module->module, NULL);
+  free(module);
+}
+
+static VkShaderStageFlags shader_stages_to_vk(Candid_ShaderStage stages) {
+  VkShaderStageFlags flags = 0;
+  if (stages & CANDID_SHADER_STAGE_VERTEX)
+    flags |= VK_SHADER_STAGE_VERTEX_BIT;
+  if (stages & CANDID_SHADER_STAGE_FRAGMENT)
+    flags |= VK_SHADER_STAGE_FRAGMENT_BIT;
+  if (stages & CANDID_SHADER_STAGE_COMPUTE)
+    flags |= VK_SHADER_STAGE_COMPUTE_BIT;
+  if (stages & CANDID_SHADER_STAGE_GEOMETRY)
+    flags |= VK_SHADER_STAGE_GEOMETRY_BIT;
+  if (stages & CANDID_SHADER_STAGE_TESSELLATION)
+    flags |= VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT |
+             VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+  return flags;
+}
+
+static VkDescriptorType descriptor_type_to_vk(Candid_UniformType type) {
+  switch (type) {
+  case CANDID_UNIFORM_SAMPLER:
+    return VK_DESCRIPTOR_TYPE_SAMPLER;
+  case CANDID_UNIFORM_TEXTURE:
+    return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  case CANDID_UNIFORM_TEXTURE_SAMPLER:
+    return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  case CANDID_UNIFORM_STORAGE_BUFFER:
+    return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  case CANDID_UNIFORM_STORAGE_TEXTURE:
+    return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  default:
+    return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  }
+}
+
+/* One set of a program's layout, from its reflected bindings. Sets the
+ * program skips get an empty layout. */
+static Candid_Result create_set_layout(Candid_Device *device,
+                                       const Candid_ShaderLayout *layout,
+                                       uint32_t set,
+                                       VkDescriptorSetLayout *out) {
+  VkDescriptorSetLayoutBinding bindings[CANDID_MAX_UNIFORMS];
+  uint32_t count = layout->set_binding_count[set];
+  for (uint32_t i = 0; i < count; ++i) {
+    const Candid_ShaderBinding *binding =
+        &layout->bindings[layout->set_first[set] + i];
+    /* Unbounded arrays only exist in the bindless set */
+    if (binding->array_count == 0)
+      return CANDID_ERROR_INVALID_ARGUMENT;
+    bindings[i] = (VkDescriptorSetLayoutBinding){
+        .binding = binding->binding,
+        .descriptorType = descriptor_type_to_vk(binding->type),
+        .descriptorCount = binding->array_count,
+        .stageFlags = shader_stages_to_vk(binding->stages),
+    };
+  }
+
+  VkDescriptorSetLayoutCreateInfo create_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = count,
+      .pBindings = bindings,
+  };
+  if (set == 0 && device->push_descriptor)
+    create_info.flags =
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+  return vkCreateDescriptorSetLayout(device->device, &create_info, NULL,
+                                     out) == VK_SUCCESS
+             ? CANDID_SUCCESS
+             : CANDID_ERROR_RESOURCE_CREATION;
+}
+
+/*******************************************************************************
+ * Render Targets
+ ******************************************************************************/
+
+static VkAttachmentLoadOp load_action_to_vk(Candid_LoadAction action) {
+  switch (action) {
+  case CANDID_LOAD_ACTION_LOAD:
+    return VK_ATTACHMENT_LOAD_OP_LOAD;
+  case CANDID_LOAD_ACTION_DONT_CARE:
+    return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  default:
+    return VK_ATTACHMENT_LOAD_OP_CLEAR;
+  }
+}
+
+/* Attachments stay in their attachment layouts: the caller transitions
+ * them with cmd_barrier */
+static VkRenderPass create_target_pass(Candid_Device *device,
+                                       const VulkanTargetPass *key) {
+  VkAttachmentDescription attachments[2];
+  uint32_t count = 0;
+  VkAttachmentReference color_ref = {
+      .attachment = 0,
+      .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+  };
+  VkAttachmentReference depth_ref = {
+      .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+  };
+
+  if (key->color_format != VK_FORMAT_UNDEFINED) {
+    attachments[count++] = (VkAttachmentDescription){
+        .format = key->color_format,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = load_action_to_vk(key->color_load),
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = color_ref.layout,
+        .finalLayout = color_ref.layout,
+    };
+  }
+  if (key->depth_format != VK_FORMAT_UNDEFINED) {
+    VkAttachmentStoreOp store = key->discard_depth
+                                    ? VK_ATTACHMENT_STORE_OP_DONT_CARE
+                                    : VK_ATTACHMENT_STORE_OP_STORE;
+    depth_ref.attachment = count;
+    attachments[count++] = (VkAttachmentDescription){
+        .format = key->depth_format,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = load_action_to_vk(key->depth_load),
+        .storeOp = store,
+        .stencilLoadOp = load_action_to_vk(key->depth_load),
+        .stencilStoreOp = store,
+        .initialLayout = depth_ref.layout,
+        .finalLayout = depth_ref.layout,
+    };
+  }
+
+  VkSubpassDescription subpass = {
+      .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+      .colorAttachmentCount =
+          key->color_format != VK_FORMAT_UNDEFINED ? 1 : 0,
+      .pColorAttachments = &color_ref,
+      .pDepthStencilAttachment =
+          key->depth_format != VK_FORMAT_UNDEFINED ? &depth_ref : NULL,
+  };
+  VkRenderPassCreateInfo pass_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+      .attachmentCount = count,
+      .pAttachments = attachments,
+      .subpassCount = 1,
+      .pSubpasses = &subpass,
+  };
+  VkRenderPass render_pass = VK_NULL_HANDLE;
+  vkCreateRenderPass(device->device, &pass_info, NULL, &render_pass);
+  return render_pass;
+}
+
+/**
+ * The offscreen render pass of a key, created on first use. Passes with the
+ * same formats are compatible, so pipelines are built against any of them.
+ * @return VK_NULL_HANDLE on failure or when too many passes exist
+ */
+static VkRenderPass get_target_pass(Candid_Device *device,
+                                    const VulkanTargetPass *key) {
+  VkRenderPass render_pass = VK_NULL_HANDLE;
+  SDL_LockMutex(device->target_lock);
+  for (uint32_t i = 0; i < device->target_pass_count; ++i) {
+    const VulkanTargetPass *pass = &device->target_passes[i];
+    if (pass->color_format == key->color_format &&
+        pass->depth_format == key->depth_format &&
+        pass->color_load == key->color_load &&
+        pass->depth_load == key->depth_load &&
+        pass->discard_depth == key->discard_depth) {
+      render_pass = pass->render_pass;
+      break;
+    }
+  }
+  if (!render_pass && device->target_pass_count < VULKAN_MAX_TARGET_PASSES) {
+    render_pass = create_target_pass(device, key);
+    if (render_pass) {
+      VulkanTargetPass *pass =
+          &device->target_passes[device->target_pass_count++];
+      *pass = *key;
+      pass->render_pass = render_pass;
+    }
+  }
+  SDL_UnlockMutex(device->target_lock);
+  return render_pass;
 }
 
-static Candid_Result vulkan_texture_upload(Candid_Device *device,
-                                           Candid_Texture *texture,
-                                           uint32_t mip_level,
-                                           uint32_t array_layer,
-                                           const void *data, size_t size) {
-  (void)device;
-  (void)texture;
-  (void)mip_level;
-  (void)array_layer;
-  (void)data;
-  (void)size;
-  return CANDID_ERROR_RESOURCE_CREATION;
+static VkFramebufferAttachmentImageInfo
+attachment_image_info(const Candid_Texture *texture, const VkFormat *format) {
+  return (VkFramebufferAttachmentImageInfo){
+      .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENT_IMAGE_INFO,
+      .usage = texture_usage_to_vk(texture->desc.usage),
+      .width = texture->desc.width,
+      .height = texture->desc.height,
+      .layerCount = 1,
+      .viewFormatCount = 1,
+      .pViewFormats = format,
+  };
 }
 
-static Candid_Result vulkan_sampler_create(Candid_Device *device,
-                                           const Candid_SamplerDesc *desc,
-                                           Candid_Sampler **out) {
-  (void)device;
-  (void)desc;
-  (void)out;
-  return CANDID_ERROR_RESOURCE_CREATION;
+/**
+ * The imageless framebuffer of a pass over textures of this size and
+ * usage, created on first use (recording thread only)
+ */
+/* Frames recorded so far may still use it: retired, not destroyed */
+static void remove_target_framebuffer(Candid_Device *device, uint32_t index) {
+  retire_handle(device, VK_OBJECT_TYPE_FRAMEBUFFER,
+                (uint64_t)device->target_framebuffers[index].framebuffer);
+  device->target_framebuffers[index] =
+      device->target_framebuffers[--device->target_framebuffer_count];
 }
 
-static void vulkan_sampler_destroy(Candid_Device *device,
-                                   Candid_Sampler *sampler) {
-  (void)device;
-  (void)sampler;
+static VkFramebuffer get_target_framebuffer(Candid_Device *device,
+                                            const VulkanTargetPass *pass,
+                                            VkRenderPass render_pass,
+                                            const Candid_Texture *color,
+                                            const Candid_Texture *depth) {
+  const Candid_TextureDesc *size = color ? &color->desc : &depth->desc;
+  VkImageUsageFlags color_usage =
+      color ? texture_usage_to_vk(color->desc.usage) : 0;
+  VkImageUsageFlags depth_usage =
+      depth ? texture_usage_to_vk(depth->desc.usage) : 0;
+  for (uint32_t i = 0; i < device->target_framebuffer_count; ++i) {
+    VulkanTargetFramebuffer *entry = &device->target_framebuffers[i];
+    if (entry->render_pass == render_pass && entry->width == size->width &&
+        entry->height == size->height && entry->color_usage == color_usage &&
+        entry->depth_usage == depth_usage) {
+      entry->last_used = device->frame_number;
+      return entry->framebuffer;
+    }
+  }
+  if (device->target_framebuffer_count == VULKAN_MAX_TARGET_FRAMEBUFFERS) {
+    uint32_t oldest = 0;
+    for (uint32_t i = 1; i < device->target_framebuffer_count; ++i) {
+      if (device->target_framebuffers[i].last_used <
+          device->target_framebuffers[oldest].last_used)
+        oldest = i;
+    }
+    remove_target_framebuffer(device, oldest);
+  }
+
+  VkFramebufferAttachmentImageInfo images[2];
+  uint32_t count = 0;
+  if (color)
+    images[count++] = attachment_image_info(color, &pass->color_format);
+  if (depth)
+    images[count++] = attachment_image_info(depth, &pass->depth_format);
+  VkFramebufferAttachmentsCreateInfo attachments = {
+      .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENTS_CREATE_INFO,
+      .attachmentImageInfoCount = count,
+      .pAttachmentImageInfos = images,
+  };
+  VkFramebufferCreateInfo framebuffer_info = {
+      .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+      .pNext = &attachments,
+      .flags = VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT,
+      .renderPass = render_pass,
+      .attachmentCount = count,
+      .width = size->width,
+      .height = size->height,
+      .layers = 1,
+  };
+  VkFramebuffer framebuffer = VK_NULL_HANDLE;
+  if (vkCreateFramebuffer(device->device, &framebuffer_info, NULL,
+                          &framebuffer) != VK_SUCCESS)
+    return VK_NULL_HANDLE;
+
+  device->target_framebuffers[device->target_framebuffer_count++] =
+      (VulkanTargetFramebuffer){
+          .render_pass = render_pass,
+          .width = size->width,
+          .height = size->height,
+          .color_usage = color_usage,
+          .depth_usage = depth_usage,
+          .framebuffer = framebuffer,
+          .last_used = device->frame_number,
+      };
+  return framebuffer;
 }
 
-static Candid_Result
-vulkan_shader_module_create(Candid_Device *device,
-                            const Candid_ShaderModuleDesc *desc,
-                            Candid_ShaderModule **out) {
-  (void)device;
-  (void)desc;
-  (void)out;
-  return CANDID_ERROR_RESOURCE_CREATION;
+/* Sizes go unused as render targets are resized or released */
+static void evict_target_framebuffers(Candid_Device *device) {
+  for (uint32_t i = device->target_framebuffer_count; i-- > 0;) {
+    if (device->frame_number - device->target_framebuffers[i].last_used >
+        VULKAN_TARGET_FRAMEBUFFER_IDLE_FRAMES)
+      remove_target_framebuffer(device, i);
+  }
 }
 
-static void vulkan_shader_module_destroy(Candid_Device *device,
-                                         Candid_ShaderModule *module) {
-  (void)device;
-  (void)module;
+/*******************************************************************************
+ * Graphics Pipelines
+ ******************************************************************************/
+
+/* Vertex input pairs each input the vertex stage reads with the layout's
+ * attribute of the same semantic */
+static Candid_Result create_graphics_pipeline(Candid_Device *device,
+                                              Candid_ShaderProgram *program,
+                                              const Candid_PipelineKey *key,
+                                              VkPipeline *out) {
+  const Candid_ShaderReflection *vertex = &program->vertex->reflection;
+  Candid_VertexLayout layout;
+  candid_pipeline_key_get_layout(key, &layout);
+
+  VkVertexInputAttributeDescription attributes[CANDID_MAX_VERTEX_INPUTS];
+  VkVertexInputBindingDescription bindings[CANDID_MAX_VERTEX_BUFFERS];
+  uint32_t buffers_used = 0;
+  for (uint32_t i = 0; i < vertex->vertex_input_count; ++i) {
+    uint32_t a = 0;
+    while (a < layout.attribute_count &&
+           layout.attributes[a].semantic != vertex->vertex_inputs[i].semantic)
+      a++;
+    if (a == layout.attribute_count ||
+        layout.attributes[a].buffer_index >= layout.buffer_count)
+      return CANDID_ERROR_INVALID_ARGUMENT;
+    attributes[i] = (VkVertexInputAttributeDescription){
+        .location = vertex->vertex_inputs[i].location,
+        .binding = layout.attributes[a].buffer_index,
+        .format = vertex_format_to_vk(layout.attributes[a].format),
+        .offset = layout.attributes[a].offset,
+    };
+    buffers_used |= 1u << layout.attributes[a].buffer_index;
+  }
+  uint32_t binding_count = 0;
+  for (uint32_t b = 0; b < layout.buffer_count; ++b) {
+    if (!(buffers_used & (1u << b)))
+      continue;
+    bindings[binding_count++] = (VkVertexInputBindingDescription){
+        .binding = b,
+        .stride = layout.strides[b],
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+  }
+
+  VkPipelineShaderStageCreateInfo stages[2] = {
+      {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_VERTEX_BIT,
+          .module = program->vertex->module,
+          .pName = program->vertex->entry_point,
+      },
+      {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+          .module = program->fragment->module,
+          .pName = program->fragment->entry_point,
+      },
+  };
+  VkPipelineVertexInputStateCreateInfo vertex_input = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+      .vertexBindingDescriptionCount = binding_count,
+      .pVertexBindingDescriptions = bindings,
+      .vertexAttributeDescriptionCount = vertex->vertex_input_count,
+      .pVertexAttributeDescriptions = attributes,
+  };
+  VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+      .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+  };
+  VkPipelineViewportStateCreateInfo viewport = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+      .viewportCount = 1,
+      .scissorCount = 1,
+  };
+  VkPipelineRasterizationStateCreateInfo rasterization = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+      .depthClampEnable = !key->depth_clip_enabled,
+      .polygonMode =
+          key->wireframe ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL,
+      .cullMode = key->cull_mode == CANDID_CULL_FRONT  ? VK_CULL_MODE_FRONT_BIT
+                  : key->cull_mode == CANDID_CULL_BACK ? VK_CULL_MODE_BACK_BIT
+                                                       : VK_CULL_MODE_NONE,
+      .frontFace = key->front_face == CANDID_FRONT_FACE_CW
+                       ? VK_FRONT_FACE_CLOCKWISE
+                       : VK_FRONT_FACE_COUNTER_CLOCKWISE,
+      .depthBiasEnable =
+          key->depth_bias != 0.0f || key->depth_bias_slope_scale != 0.0f,
+      .depthBiasConstantFactor = key->depth_bias,
+      .depthBiasSlopeFactor = key->depth_bias_slope_scale,
+      .lineWidth = 1.0f,
+  };
+  VkPipelineMultisampleStateCreateInfo multisample = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+      .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+  };
+  VkPipelineDepthStencilStateCreateInfo depth_stencil = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+      .depthTestEnable = key->depth_test_enabled,
+      .depthWriteEnable = key->depth_write_enabled,
+      .depthCompareOp = compare_func_to_vk(key->depth_compare),
+      .stencilTestEnable = key->stencil_enabled,
+  };
+  VkPipelineColorBlendAttachmentState blend_attachment = {
+      .blendEnable = key->blend_enabled,
+      .srcColorBlendFactor = blend_factor_to_vk(key->src_color),
+      .dstColorBlendFactor = blend_factor_to_vk(key->dst_color),
+      .colorBlendOp = blend_op_to_vk(key->color_op),
+      .srcAlphaBlendFactor = blend_factor_to_vk(key->src_alpha),
+      .dstAlphaBlendFactor = blend_factor_to_vk(key->dst_alpha),
+      .alphaBlendOp = blend_op_to_vk(key->alpha_op),
+      .colorWriteMask = key->write_mask & 0xF,
+  };
+  VkPipelineColorBlendStateCreateInfo color_blend = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+      .attachmentCount = key->color_format != VK_FORMAT_UNDEFINED ? 1 : 0,
+      .pAttachments = &blend_attachment,
+  };
+  /* Viewport and scissor follow cmd_set_viewport and cmd_set_scissor */
+  VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT,
+                                     VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamic = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+      .dynamicStateCount = 2,
+      .pDynamicStates = dynamic_states,
+  };
+
+  /* The frame pass's render pass, or an offscreen one with the formats of
+   * the key: formats alone decide compatibility */
+  VkRenderPass render_pass = device->render_pass;
+  if (key->color_format != (uint32_t)device->swapchain_format ||
+      key->depth_format != (uint32_t)VULKAN_DEPTH_FORMAT) {
+    VulkanTargetPass target = {
+        .color_format = (VkFormat)key->color_format,
+        .depth_format = (VkFormat)key->depth_format,
+        .color_load = CANDID_LOAD_ACTION_CLEAR,
+        .depth_load = CANDID_LOAD_ACTION_CLEAR,
+    };
+    render_pass = get_target_pass(device, &target);
+    if (!render_pass)
+      return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  VkGraphicsPipelineCreateInfo pipeline_info = {
+      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+      .stageCount = 2,
+      .pStages = stages,
+      .pVertexInputState = &vertex_input,
+      .pInputAssemblyState = &input_assembly,
+      .pViewportState = &viewport,
+      .pRasterizationState = &rasterization,
+      .pMultisampleState = &multisample,
+      .pDepthStencilState = &depth_stencil,
+      .pColorBlendState = &color_blend,
+      .pDynamicState = &dynamic,
+      .layout = program->layout,
+      .renderPass = render_pass,
+  };
+  return vkCreateGraphicsPipelines(device->device, VK_NULL_HANDLE, 1,
+                                   &pipeline_info, NULL, out) == VK_SUCCESS
+             ? CANDID_SUCCESS
+             : CANDID_ERROR_RESOURCE_CREATION;
+}
+
+/** The pipeline of a key, created if the program has none yet */
+static VkPipeline get_graphics_pipeline(Candid_ShaderProgram *program,
+                                        const Candid_PipelineKey *key) {
+  VkPipeline pipeline = candid_pipeline_variants_find(program->variants, key);
+  if (pipeline)
+    return pipeline;
+
+  Candid_Device *device = program->device;
+  if (create_graphics_pipeline(device, program, key, &pipeline) !=
+      CANDID_SUCCESS)
+    return VK_NULL_HANDLE;
+  /* A pre-warm worker and a bind may race on a key: keep the first */
+  VkPipeline kept =
+      candid_pipeline_variants_add(program->variants, key, pipeline);
+  if (kept != pipeline)
+    vkDestroyPipeline(device->device, pipeline, NULL);
+  return kept;
+}
+
+static void prewarm_pipeline(void *context, const Candid_PipelineKey *key) {
+  get_graphics_pipeline(context, key);
 }
 
+static void release_pipeline(void *context, void *pipeline) {
+  Candid_Device *device = context;
+  vkDestroyPipeline(device->device, pipeline, NULL);
+}
+
+/*******************************************************************************
+ * Shader Programs
+ ******************************************************************************/
+
+static void vulkan_shader_program_destroy(Candid_Device *device,
+                                          Candid_ShaderProgram *program);
+
 static Candid_Result
 vulkan_shader_program_create(Candid_Device *device,
                              const Candid_ShaderProgramDesc *desc,
                              Candid_ShaderProgram **out) {
-  (void)device;
-  (void)desc;
-  (void)out;
-  return CANDID_ERROR_RESOURCE_CREATION;
+  if (!device || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!desc->compute && (!desc->vertex || !desc->fragment))
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_ShaderProgram *program = calloc(1, sizeof(Candid_ShaderProgram));
+  if (!program)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  program->device = device;
+  program->vertex = desc->vertex;
+  program->fragment = desc->fragment;
+
+  const Candid_ShaderReflection *stages[2];
+  uint32_t stage_count = 0;
+  if (desc->compute) {
+    stages[stage_count++] = &desc->compute->reflection;
+  } else {
+    stages[stage_count++] = &desc->vertex->reflection;
+    stages[stage_count++] = &desc->fragment->reflection;
+  }
+  Candid_Result result =
+      candid_shader_layout_build(stages, stage_count, &program->bindings);
+  if (result != CANDID_SUCCESS) {
+    free(program);
+    return result;
+  }
+
+  /* Programs reading the bindless tables share the device's layout, so
+   * they can only be created once the first table exists */
+  const Candid_ShaderLayout *layout = &program->bindings;
+  program->descriptor_set_count = layout->set_count;
+  for (uint32_t set = 0; set < layout->set_count; ++set) {
+    if (set == VULKAN_BINDLESS_SET && !desc->compute &&
+        layout->set_binding_count[set] > 0) {
+      if (!device->bindless_layout) {
+        result = CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+        break;
+      }
+      continue;
+    }
+    result = create_set_layout(device, layout, set,
+                               &program->descriptor_set_layouts[set]);
+    if (result != CANDID_SUCCESS)
+      break;
+  }
+  if (result != CANDID_SUCCESS) {
+    vulkan_shader_program_destroy(device, program);
+    return result;
+  }
+
+  VkDescriptorSetLayout set_layouts[CANDID_SHADER_MAX_SETS];
+  for (uint32_t set = 0; set < layout->set_count; ++set) {
+    set_layouts[set] = program->descriptor_set_layouts[set]
+                           ? program->descriptor_set_layouts[set]
+                           : device->bindless_layout;
+  }
+  program->push_constant_stages =
+      shader_stages_to_vk(layout->push_constant_stages);
+  VkPushConstantRange push_range = {
+      .stageFlags = program->push_constant_stages,
+      .offset = 0,
+      .size = layout->push_constant_size,
+  };
+  VkPipelineLayoutCreateInfo layout_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = layout->set_count,
+      .pSetLayouts = set_layouts,
+      .pushConstantRangeCount = layout->push_constant_size ? 1 : 0,
+      .pPushConstantRanges = &push_range,
+  };
+  if (vkCreatePipelineLayout(device->device, &layout_info, NULL,
+                             &program->layout) != VK_SUCCESS) {
+    vulkan_shader_program_destroy(device, program);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  /* Graphics pipelines depend on the state bound with them, so they are
+   * created per key: those recorded in earlier runs on worker threads now,
+   * the others on first bind */
+  if (!desc->compute) {
+    result = candid_pipeline_variants_create(&program->variants);
+    if (result != CANDID_SUCCESS) {
+      vulkan_shader_program_destroy(device, program);
+      return result;
+    }
+    candid_pipeline_program_hash(program->hash, desc->vertex->hash,
+                                 sizeof(desc->vertex->hash), NULL);
+    candid_pipeline_program_hash(program->hash, desc->fragment->hash,
+                                 sizeof(desc->fragment->hash), NULL);
+    candid_pipeline_list_prewarm(device->pipeline_list, program->hash,
+                                 prewarm_pipeline, program);
+  } else {
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = desc->compute->module,
+                .pName = desc->compute->entry_point,
+            },
+        .layout = program->layout,
+    };
+    if (vkCreateComputePipelines(device->device, VK_NULL_HANDLE, 1,
+                                 &pipeline_info, NULL,
+                                 &program->pipeline) != VK_SUCCESS) {
+      vulkan_shader_program_destroy(device, program);
+      return CANDID_ERROR_RESOURCE_CREATION;
+    }
+  }
+
+  *out = program;
+  return CANDID_SUCCESS;
 }
 
 static void vulkan_shader_program_destroy(Candid_Device *device,
                                           Candid_ShaderProgram *program) {
-  (void)device;
-  (void)program;
+  if (!device || !program)
+    return;
+  candid_pipeline_list_cancel(device->pipeline_list, program);
+  candid_pipeline_variants_destroy(program->variants, release_pipeline,
+                                   device);
+  if (program->pipeline)
+    vkDestroyPipeline(device->device, program->pipeline, NULL);
+  if (program->layout)
+    vkDestroyPipelineLayout(device->device, program->layout, NULL);
+  for (uint32_t set = 0; set < program->descriptor_set_count; ++set) {
+    if (program->descriptor_set_layouts[set])
+      vkDestroyDescriptorSetLayout(device->device,
+                                   program->descriptor_set_layouts[set], NULL);
+  }
+  free(program);
+}
+
+static Candid_ShaderProgram *
+vulkan_get_compute_kernel(Candid_Device *device, Candid_ComputeKernel kernel) {
+  if (!device || !device->device || kernel >= CANDID_COMPUTE_KERNEL_COUNT)
+    return NULL;
+#ifdef CANDID_BUILTIN_SHADERS
+  const Candid_BuiltinStage *code = &candid_builtin_kernel_code[kernel];
+  if (device->kernels[kernel] || !code->spirv)
+    return device->kernels[kernel];
+
+  Candid_ShaderModuleDesc module_desc = {
+      .stage = CANDID_SHADER_STAGE_COMPUTE,
+      .source_type = CANDID_SHADER_SOURCE_SPIRV,
+      .bytecode = code->spirv,
+      .bytecode_size = code->spirv_size,
+      .entry_point = code->entry_point,
+      .label = code->entry_point,
+  };
+  Candid_ShaderModule *module = NULL;
+  if (vulkan_shader_module_create(device, &module_desc, &module) !=
+      CANDID_SUCCESS)
+    return NULL;
+  Candid_ShaderProgramDesc program_desc = {
+      .compute = module,
+      .label = code->entry_point,
+  };
+  if (vulkan_shader_program_create(device, &program_desc,
+                                   &device->kernels[kernel]) !=
+      CANDID_SUCCESS) {
+    vulkan_shader_module_destroy(device, module);
+    return NULL;
+  }
+  device->kernel_modules[kernel] = module;
+  return device->kernels[kernel];
+#else
+  /* Kernels are only compiled with the built-in shader library */
+  return NULL;
+#endif
+}
+
+static void destroy_compute_kernels(Candid_Device *device) {
+  for (uint32_t i = 0; i < CANDID_COMPUTE_KERNEL_COUNT; ++i) {
+    vulkan_shader_program_destroy(device, device->kernels[i]);
+    vulkan_shader_module_destroy(device, device->kernel_modules[i]);
+    device->kernels[i] = NULL;
+    device->kernel_modules[i] = NULL;
+  }
 }
 
 static Candid_Result vulkan_mesh_create(Candid_Device *device,
                                         const Candid_MeshDesc *desc,
                                         Candid_Mesh **out) {
-  (void)device;
-  (void)desc;
-  (void)out;
-  return CANDID_ERROR_RESOURCE_CREATION;
+  if (!device || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Mesh *mesh = calloc(1, sizeof(Candid_Mesh));
+  if (!mesh)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  /* Create vertex buffer */
+  Candid_BufferDesc vb_desc = {
+      .size = desc->data.vertex_count * desc->data.vertex_stride,
+      .usage = CANDID_BUFFER_USAGE_VERTEX,
+      .memory = CANDID_BUFFER_MEMORY_CPU_TO_GPU,
+      .initial_data = desc->data.vertices,
+      .label = desc->label,
+  };
+  Candid_Result result =
+      vulkan_buffer_create(device, &vb_desc, &mesh->vertex_buffer);
+  if (result != CANDID_SUCCESS) {
+    free(mesh);
+    return result;
+  }
+
+  /* Create index buffer */
+  size_t index_size = (desc->data.index_format == CANDID_INDEX_FORMAT_UINT16)
+                          ? sizeof(uint16_t)
+                          : sizeof(uint32_t);
+  Candid_BufferDesc ib_desc = {
+      .size = desc->data.index_count * index_size,
+      .usage = CANDID_BUFFER_USAGE_INDEX,
+      .memory = CANDID_BUFFER_MEMORY_CPU_TO_GPU,
+      .initial_data = desc->data.indices,
+      .label = desc->label,
+  };
+  result = vulkan_buffer_create(device, &ib_desc, &mesh->index_buffer);
+  if (result != CANDID_SUCCESS) {
+    vulkan_buffer_destroy(device, mesh->vertex_buffer);
+    free(mesh);
+    return result;
+  }
+
+  mesh->vertex_count = (uint32_t)desc->data.vertex_count;
+  mesh->index_count = (uint32_t)desc->data.index_count;
+  mesh->index_format = desc->data.index_format;
+  mesh->layout = desc->data.layout;
+  mesh->bounds = desc->bounds;
+
+  *out = mesh;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Result
+vulkan_mesh_create_placed(Candid_Device *device, const Candid_MeshDesc *desc,
+                          const Candid_MeshPlacement *placement,
+                          Candid_Mesh **out) {
+  if (!device || !desc || !placement || !placement->vertex_buffer ||
+      !placement->index_buffer || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Mesh *mesh = calloc(1, sizeof(Candid_Mesh));
+  if (!mesh)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  mesh->vertex_buffer = placement->vertex_buffer;
+  mesh->index_buffer = placement->index_buffer;
+  mesh->placed = true;
+  mesh->pulled = desc->storage == CANDID_MESH_STORAGE_PULLED;
+  mesh->vertex_offset = placement->vertex_offset;
+  mesh->first_index = placement->first_index;
+  mesh->vertex_count = (uint32_t)desc->data.vertex_count;
+  mesh->index_count = (uint32_t)desc->data.index_count;
+  mesh->index_format = desc->data.index_format;
+  mesh->layout = desc->data.layout;
+  mesh->bounds = desc->bounds;
+
+  *out = mesh;
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_mesh_set_placement(Candid_Mesh *mesh,
+                                      const Candid_MeshPlacement *placement) {
+  if (!mesh || !mesh->placed || !placement)
+    return;
+  mesh->vertex_buffer = placement->vertex_buffer;
+  mesh->index_buffer = placement->index_buffer;
+  mesh->vertex_offset = placement->vertex_offset;
+  mesh->first_index = placement->first_index;
 }
 
 static void vulkan_mesh_destroy(Candid_Device *device, Candid_Mesh *mesh) {
-  (void)device;
-  (void)mesh;
+  if (!mesh)
+    return;
+  if (!mesh->placed) {
+    vulkan_buffer_destroy(device, mesh->vertex_buffer);
+    vulkan_buffer_destroy(device, mesh->index_buffer);
+  }
+  free(mesh);
+}
+
+static void vulkan_mesh_get_draw_info(Candid_Mesh *mesh,
+                                      Candid_MeshDrawInfo *out) {
+  if (!mesh || !out)
+    return;
+  out->geometry = mesh->placed ? (const void *)mesh->vertex_buffer : mesh;
+  out->index_count = mesh->index_count;
+  out->first_index = mesh->first_index;
+  out->vertex_offset = mesh->vertex_offset;
 }
 
 static Candid_Result vulkan_material_create(Candid_Device *device,
                                             const Candid_MaterialDesc *desc,
                                             Candid_Material **out) {
-  (void)device;
-  (void)desc;
-  (void)out;
-  return CANDID_ERROR_RESOURCE_CREATION;
+  if (!device || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Material *material = calloc(1, sizeof(Candid_Material));
+  if (!material)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  material->shader = desc->shader;
+
+  *out = material;
+  return CANDID_SUCCESS;
 }
 
 static void vulkan_material_destroy(Candid_Device *device,
                                     Candid_Material *material) {
   (void)device;
-  (void)material;
+  /* Textures are read through the bindless table (table_index): no
+   * material owns a descriptor set, instances share their base's handle */
+  free(material);
+}
+
+static Candid_Result vulkan_material_create_instance(Candid_Device *device,
+                                                     Candid_Material *base,
+                                                     Candid_Material **out) {
+  if (!device || !base || base->base || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Material *material = calloc(1, sizeof(Candid_Material));
+  if (!material)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  material->shader = base->shader;
+  material->descriptor_set = base->descriptor_set;
+  material->base = base;
+  material->table_index = base->table_index;
+
+  *out = material;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Material *vulkan_material_get_base(Candid_Material *material) {
+  return material && material->base ? material->base : material;
 }
 
 static Candid_Result vulkan_cmd_begin(Candid_Device *device,
                                       Candid_CommandBuffer **out) {
-  (void)device;
-  (void)out;
-  return CANDID_ERROR_RESOURCE_CREATION;
+  if (!device || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  VulkanFrame *frame = &device->frames[device->current_frame];
+  if (!frame->command_buffer)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  Candid_CommandBuffer *cmd = calloc(1, sizeof(Candid_CommandBuffer));
+  if (!cmd)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  reclaim_frame(device);
+  VkCommandBufferBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  if (vkBeginCommandBuffer(frame->command_buffer, &begin_info) !=
+      VK_SUCCESS) {
+    free(cmd);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  cmd->vk_command_buffer = frame->command_buffer;
+  cmd->device = device;
+  cmd->queue = CANDID_QUEUE_GRAPHICS;
+  *out = cmd;
+  return CANDID_SUCCESS;
 }
 
 static Candid_Result vulkan_cmd_end(Candid_Device *device,
                                     Candid_CommandBuffer *cmd) {
   (void)device;
-  (void)cmd;
+  if (!cmd)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  return vkEndCommandBuffer(cmd->vk_command_buffer) == VK_SUCCESS
+             ? CANDID_SUCCESS
+             : CANDID_ERROR_RESOURCE_CREATION;
+}
+
+static Candid_Result vulkan_cmd_submit(Candid_Device *device,
+                                       Candid_CommandBuffer *cmd) {
+  if (!device || !cmd)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  VulkanFrame *frame = &device->frames[device->current_frame];
+  vkResetFences(device->device, 1, &frame->in_flight);
+  VkResult result = submit_timeline(
+      device, cmd, device->graphics_queue,
+      cmd->image_acquired ? frame->image_available : VK_NULL_HANDLE,
+      cmd->image_acquired ? device->render_finished_semaphores[cmd->image_index]
+                          : VK_NULL_HANDLE,
+      frame->in_flight);
+  if (result == VK_SUCCESS) {
+    frame->submitted = true;
+    SDL_LockMutex(device->garbage_lock);
+    frame->collectable = frame->garbage_count;
+    SDL_UnlockMutex(device->garbage_lock);
+    device->present_pending = cmd->image_acquired;
+    device->present_image = cmd->image_index;
+  }
+  /* The VkCommandBuffer stays with its frame slot */
+  free(cmd);
+  return result == VK_SUCCESS ? CANDID_SUCCESS : CANDID_ERROR_DEVICE_LOST;
+}
+
+/* Make fills, copies and dispatches visible to indirect draws, vertex, index
+ * and fragment reads, later dispatches and later transfers */
+static void flush_compute_writes(Candid_CommandBuffer *cmd) {
+  if (!cmd->compute_writes)
+    return;
+  cmd->compute_writes = false;
+
+  VkMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask =
+          VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                       VK_ACCESS_INDEX_READ_BIT |
+                       VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                       VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                       VK_ACCESS_SHADER_WRITE_BIT |
+                       VK_ACCESS_TRANSFER_READ_BIT |
+                       VK_ACCESS_TRANSFER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(
+      cmd->vk_command_buffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+          VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+/* Bind one resource through VK_KHR_push_descriptor, to the graphics
+ * program inside render passes and to the compute program outside. The
+ * program's layout resolves the slot to its binding and descriptor type;
+ * slots it does not use are ignored. */
+static void push_descriptor(Candid_CommandBuffer *cmd,
+                            Candid_BindingClass binding_class, uint32_t slot,
+                            const VkDescriptorBufferInfo *buffer,
+                            const VkDescriptorImageInfo *image,
+                            uint32_t count) {
+  bool graphics = cmd->in_render_pass;
+  Candid_ShaderProgram *program =
+      graphics ? cmd->graphics_program : cmd->compute_program;
+  if (!program || !cmd->device->push_descriptor)
+    return;
+  const Candid_ShaderBinding *binding =
+      candid_shader_layout_slot(&program->bindings, binding_class, slot);
+  if (!binding)
+    return;
+
+  VkWriteDescriptorSet write = {
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstBinding = binding->binding,
+      .descriptorCount =
+          count < binding->array_count ? count : binding->array_count,
+      .descriptorType = descriptor_type_to_vk(binding->type),
+      .pBufferInfo = buffer,
+      .pImageInfo = image,
+  };
+  vkCmdPushDescriptorSetKHR(cmd->vk_command_buffer,
+                            graphics ? VK_PIPELINE_BIND_POINT_GRAPHICS
+                                     : VK_PIPELINE_BIND_POINT_COMPUTE,
+                            program->layout, 0, 1, &write);
+}
+
+static void set_dynamic_state(Candid_CommandBuffer *cmd) {
+  vkCmdSetViewport(cmd->vk_command_buffer, 0, 1, &cmd->viewport);
+  vkCmdSetScissor(cmd->vk_command_buffer, 0, 1, &cmd->scissor);
+}
+
+/* The whole pass, until cmd_set_viewport and cmd_set_scissor */
+static void set_full_viewport(Candid_CommandBuffer *cmd, VkExtent2D extent) {
+  cmd->viewport = (VkViewport){0.0f, 0.0f, (float)extent.width,
+                               (float)extent.height, 0.0f, 1.0f};
+  cmd->scissor = (VkRect2D){{0, 0}, extent};
+  set_dynamic_state(cmd);
+}
+
+/**
+ * Copy uniform data into the current slot's draw parameters. Safe from any
+ * recording thread.
+ * @return false once the slot's buffer is full
+ */
+static bool push_draw_params(Candid_CommandBuffer *cmd, const void *data,
+                             uint32_t size, VkDescriptorBufferInfo *out) {
+  VulkanFrame *frame = &cmd->device->frames[cmd->device->current_frame];
+  uint32_t block = (size + VULKAN_DRAW_PARAMS_ALIGNMENT - 1) &
+                   ~(uint32_t)(VULKAN_DRAW_PARAMS_ALIGNMENT - 1);
+  uint32_t offset =
+      (uint32_t)SDL_AddAtomicInt(&frame->draw_params_used, (int)block);
+  if (!frame->draw_params_data || offset + block > VULKAN_DRAW_PARAMS_SIZE)
+    return false;
+  memcpy(frame->draw_params_data + offset, data, size);
+  *out = (VkDescriptorBufferInfo){frame->draw_params, offset, size};
+  return true;
+}
+
+static Candid_Result
+vulkan_cmd_begin_render_pass(Candid_CommandBuffer *cmd,
+                             const Candid_Color *clear_color, float clear_depth,
+                             uint8_t clear_stencil) {
+  if (!cmd || !clear_color || cmd->in_render_pass || cmd->is_secondary)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  Candid_Device *device = cmd->device;
+  if (!device->render_pass)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  /* Acquired as late as possible; the submission waits for the image only
+   * before writing color */
+  if (!cmd->image_acquired) {
+    VulkanFrame *frame = &device->frames[device->current_frame];
+    VkResult result = VK_ERROR_OUT_OF_DATE_KHR;
+    for (int attempt = 0; attempt < 2 && result == VK_ERROR_OUT_OF_DATE_KHR;
+         ++attempt) {
+      if ((device->swapchain_dirty || attempt > 0) &&
+          recreate_swapchain(device) != CANDID_SUCCESS)
+        return CANDID_ERROR_RESOURCE_CREATION;
+      if (!device->swapchain)
+        return CANDID_ERROR_RESOURCE_CREATION;
+      result = vkAcquireNextImageKHR(device->device, device->swapchain,
+                                     UINT64_MAX, frame->image_available,
+                                     VK_NULL_HANDLE, &cmd->image_index);
+    }
+    /* A suboptimal image is still drawn to, the next frame recreates */
+    if (result == VK_SUBOPTIMAL_KHR)
+      device->swapchain_dirty = true;
+    else if (result != VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
+    cmd->image_acquired = true;
+  }
+  VkFramebuffer framebuffer = get_framebuffer(device, cmd->image_index);
+  if (!framebuffer)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  flush_compute_writes(cmd);
+
+  VkClearValue clear_values[2] = {
+      {.color = {{clear_color->r, clear_color->g, clear_color->b,
+                  clear_color->a}}},
+      {.depthStencil = {clear_depth, clear_stencil}},
+  };
+  VkRenderPassBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .renderPass = device->render_pass,
+      .framebuffer = framebuffer,
+      .renderArea = {.offset = {0, 0}, .extent = device->swapchain_extent},
+      .clearValueCount = 2,
+      .pClearValues = clear_values,
+  };
+  vkCmdBeginRenderPass(cmd->vk_command_buffer, &begin_info,
+                       VK_SUBPASS_CONTENTS_INLINE);
+
+  set_full_viewport(cmd, device->swapchain_extent);
+
+  cmd->in_render_pass = true;
+  cmd->graphics_program = NULL;
+  cmd->graphics_pipeline = VK_NULL_HANDLE;
   return CANDID_SUCCESS;
 }
 
-static Candid_Result vulkan_cmd_submit(Candid_Device *device,
-                                       Candid_CommandBuffer *cmd) {
-  (void)device;
-  (void)cmd;
-  return CANDID_SUCCESS;
-}
+static Candid_Result
+vulkan_cmd_begin_render_pass_targets(Candid_CommandBuffer *cmd,
+                                     const Candid_RenderPassDesc *desc) {
+  if (!cmd || !desc || (!desc->color && !desc->depth) ||
+      cmd->in_render_pass || cmd->is_secondary)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  Candid_Device *device = cmd->device;
+  if (!device->imageless_framebuffer)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  const Candid_Texture *color = desc->color;
+  const Candid_Texture *depth = desc->depth;
+  const Candid_TextureDesc *size = color ? &color->desc : &depth->desc;
+  if ((color && !color->target_view) || (depth && !depth->target_view) ||
+      (color && depth &&
+       (depth->desc.width != size->width ||
+        depth->desc.height != size->height)))
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  VulkanTargetPass key = {
+      .color_format = color ? texture_format_to_vk(color->desc.format)
+                            : VK_FORMAT_UNDEFINED,
+      .depth_format = depth ? texture_format_to_vk(depth->desc.format)
+                            : VK_FORMAT_UNDEFINED,
+      .color_load = desc->color_load,
+      .depth_load = desc->depth_load,
+      .discard_depth = desc->discard_depth,
+  };
+  VkRenderPass render_pass = get_target_pass(device, &key);
+  VkFramebuffer framebuffer =
+      render_pass
+          ? get_target_framebuffer(device, &key, render_pass, color, depth)
+          : VK_NULL_HANDLE;
+  if (!framebuffer)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  flush_compute_writes(cmd);
+
+  VkImageView views[2];
+  VkClearValue clear_values[2];
+  uint32_t count = 0;
+  if (color) {
+    const Candid_Color *clear = &desc->clear_color;
+    views[count] = color->target_view;
+    clear_values[count++].color =
+        (VkClearColorValue){{clear->r, clear->g, clear->b, clear->a}};
+  }
+  if (depth) {
+    views[count] = depth->target_view;
+    clear_values[count++].depthStencil = (VkClearDepthStencilValue){
+        desc->clear_depth, desc->clear_stencil};
+  }
+  VkRenderPassAttachmentBeginInfo attachments = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO,
+      .attachmentCount = count,
+      .pAttachments = views,
+  };
+  VkExtent2D extent = {size->width, size->height};
+  VkRenderPassBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .pNext = &attachments,
+      .renderPass = render_pass,
+      .framebuffer = framebuffer,
+      .renderArea = {.offset = {0, 0}, .extent = extent},
+      .clearValueCount = count,
+      .pClearValues = clear_values,
+  };
+  vkCmdBeginRenderPass(cmd->vk_command_buffer, &begin_info,
+                       VK_SUBPASS_CONTENTS_INLINE);
+
+  set_full_viewport(cmd, extent);
 
-static Candid_Result
-vulkan_cmd_begin_render_pass(Candid_CommandBuffer *cmd,
-                             const Candid_Color *clear_color, float clear_depth,
-                             uint8_t clear_stencil) {
-  (void)cmd;
-  (void)clear_color;
-  (void)clear_depth;
-  (void)clear_stencil;
+  cmd->in_render_pass = true;
+  cmd->target_pass = true;
+  cmd->color_format = key.color_format;
+  cmd->depth_format = key.depth_format;
+  cmd->graphics_program = NULL;
+  cmd->graphics_pipeline = VK_NULL_HANDLE;
   return CANDID_SUCCESS;
 }
 
-static void vulkan_cmd_end_render_pass(Candid_CommandBuffer *cmd) { (void)cmd; }
+static void vulkan_cmd_end_render_pass(Candid_CommandBuffer *cmd) {
+  if (!cmd || !cmd->in_render_pass || cmd->is_secondary)
+    return;
+  vkCmdEndRenderPass(cmd->vk_command_buffer);
+  cmd->in_render_pass = false;
+  cmd->target_pass = false;
+  cmd->graphics_program = NULL;
+  cmd->graphics_pipeline = VK_NULL_HANDLE;
+}
 
 static void vulkan_cmd_set_viewport(Candid_CommandBuffer *cmd, float x, float y,
                                     float width, float height, float min_depth,
                                     float max_depth) {
-  (void)cmd;
-  (void)x;
-  (void)y;
-  (void)width;
-  (void)height;
-  (void)min_depth;
-  (void)max_depth;
+  if (!cmd || !cmd->in_render_pass)
+    return;
+  cmd->viewport = (VkViewport){x, y, width, height, min_depth, max_depth};
+  vkCmdSetViewport(cmd->vk_command_buffer, 0, 1, &cmd->viewport);
 }
 
 static void vulkan_cmd_set_scissor(Candid_CommandBuffer *cmd, int32_t x,
                                    int32_t y, uint32_t width, uint32_t height) {
-  (void)cmd;
-  (void)x;
-  (void)y;
-  (void)width;
-  (void)height;
+  if (!cmd || !cmd->in_render_pass)
+    return;
+  cmd->scissor = (VkRect2D){{x, y}, {width, height}};
+  vkCmdSetScissor(cmd->vk_command_buffer, 0, 1, &cmd->scissor);
+}
+
+/* Pipeline binds with incompatible layouts disturb the set, so it is bound
+ * again after each one */
+static void bind_bindless_set(Candid_CommandBuffer *cmd) {
+  if (!cmd->bindless_table || !cmd->graphics_program ||
+      cmd->graphics_program->descriptor_set_count <= VULKAN_BINDLESS_SET)
+    return;
+  vkCmdBindDescriptorSets(
+      cmd->vk_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+      cmd->graphics_program->layout, VULKAN_BINDLESS_SET, 1,
+      &cmd->bindless_table->set, 0, NULL);
+  cmd->bound_material_index = UINT32_MAX;
 }
 
 static void
@@ -611,59 +3609,154 @@ vulkan_cmd_bind_pipeline(Candid_CommandBuffer *cmd,
                          const Candid_RasterizerState *raster,
                          const Candid_DepthStencilState *depth_stencil,
                          const Candid_BlendState *blend) {
-  (void)cmd;
-  (void)program;
-  (void)raster;
-  (void)depth_stencil;
-  (void)blend;
+  if (!cmd)
+    return;
+  /* There is no built-in pipeline: draws are skipped until a program is
+   * bound */
+  cmd->graphics_program = NULL;
+  cmd->graphics_pipeline = VK_NULL_HANDLE;
+  if (!program || !program->variants)
+    return;
+
+  /* The variant is bound by the draws, which know the vertex layout */
+  Candid_Device *device = cmd->device;
+  VkFormat color_format =
+      cmd->target_pass ? cmd->color_format : device->swapchain_format;
+  VkFormat depth_format =
+      cmd->target_pass ? cmd->depth_format : VULKAN_DEPTH_FORMAT;
+  candid_pipeline_key_init(&cmd->pipeline_key, program->hash, NULL, raster,
+                           depth_stencil, blend, (uint32_t)color_format,
+                           (uint32_t)depth_format);
+  cmd->graphics_program = program;
+  bind_bindless_set(cmd);
+}
+
+/* Vertex layout of a mesh's pipelines: none for pulled meshes, whose vertex
+ * stage reads the block itself, and the standard one for meshes without
+ * attributes */
+static const Candid_VertexLayout *mesh_layout(const Candid_Mesh *mesh) {
+  static const Candid_VertexLayout pulled = {0};
+  if (mesh->pulled)
+    return &pulled;
+  return mesh->layout.attribute_count ? &mesh->layout : NULL;
+}
+
+/* Bind the bound program's variant for a vertex layout (NULL for the
+ * standard one). Variants compiled here, on the recording thread, are
+ * listed with their layout for the next run to pre-warm. */
+static bool bind_draw_pipeline(Candid_CommandBuffer *cmd,
+                               const Candid_VertexLayout *layout) {
+  Candid_ShaderProgram *program = cmd->graphics_program;
+  if (!program)
+    return false;
+  Candid_PipelineKey key = cmd->pipeline_key;
+  candid_pipeline_key_set_layout(&key, layout);
+  if (cmd->graphics_pipeline &&
+      memcmp(&key, &cmd->pipeline_key, sizeof(key)) == 0)
+    return true;
+
+  VkPipeline pipeline = candid_pipeline_variants_find(program->variants, &key);
+  if (!pipeline) {
+    pipeline = get_graphics_pipeline(program, &key);
+    if (pipeline)
+      candid_pipeline_list_record(cmd->device->pipeline_list, &key);
+  }
+  cmd->pipeline_key = key;
+  cmd->graphics_pipeline = pipeline;
+  if (!pipeline)
+    return false;
+  vkCmdBindPipeline(cmd->vk_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipeline);
+  return true;
+}
+
+/* Select the draw's record in the bound material table */
+static void push_material_index(Candid_CommandBuffer *cmd,
+                                const Candid_Material *material) {
+  if (!cmd->bindless_table || !cmd->graphics_program)
+    return;
+  uint32_t index = material ? material->table_index : 0;
+  if (index == cmd->bound_material_index ||
+      cmd->graphics_program->bindings.push_constant_size < sizeof(index))
+    return;
+  vkCmdPushConstants(cmd->vk_command_buffer, cmd->graphics_program->layout,
+                     cmd->graphics_program->push_constant_stages, 0,
+                     sizeof(index), &index);
+  cmd->bound_material_index = index;
 }
 
 static void vulkan_cmd_bind_vertex_buffer(Candid_CommandBuffer *cmd,
                                           uint32_t slot, Candid_Buffer *buffer,
                                           size_t offset) {
-  (void)cmd;
-  (void)slot;
-  (void)buffer;
-  (void)offset;
+  if (!cmd || !buffer)
+    return;
+  VkDeviceSize vk_offset = offset;
+  vkCmdBindVertexBuffers(cmd->vk_command_buffer, slot, 1, &buffer->buffer,
+                         &vk_offset);
 }
 
 static void vulkan_cmd_bind_index_buffer(Candid_CommandBuffer *cmd,
                                          Candid_Buffer *buffer, size_t offset,
                                          Candid_IndexFormat format) {
-  (void)cmd;
-  (void)buffer;
-  (void)offset;
-  (void)format;
+  if (!cmd || !buffer)
+    return;
+  vkCmdBindIndexBuffer(cmd->vk_command_buffer, buffer->buffer, offset,
+                       format == CANDID_INDEX_FORMAT_UINT16
+                           ? VK_INDEX_TYPE_UINT16
+                           : VK_INDEX_TYPE_UINT32);
 }
 
 static void vulkan_cmd_bind_uniform_buffer(Candid_CommandBuffer *cmd,
                                            uint32_t slot, Candid_Buffer *buffer,
                                            size_t offset, size_t size) {
-  (void)cmd;
-  (void)slot;
-  (void)buffer;
-  (void)offset;
-  (void)size;
+  if (!cmd || !buffer)
+    return;
+  VkDescriptorBufferInfo info = {buffer->buffer, offset, size};
+  push_descriptor(cmd, CANDID_BINDING_UNIFORM_BUFFER, slot, &info, NULL, 1);
+}
+
+/* Layout a texture is kept in while shaders may read it */
+static VkImageLayout sampled_layout(const Candid_Texture *texture) {
+  if (texture->desc.usage & CANDID_TEXTURE_USAGE_STORAGE)
+    return VK_IMAGE_LAYOUT_GENERAL;
+  if (texture->desc.usage & CANDID_TEXTURE_USAGE_DEPTH_STENCIL)
+    return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 }
 
 static void vulkan_cmd_bind_texture(Candid_CommandBuffer *cmd, uint32_t slot,
                                     Candid_Texture *texture,
                                     Candid_Sampler *sampler) {
-  (void)cmd;
-  (void)slot;
-  (void)texture;
-  (void)sampler;
+  if (!cmd || !texture)
+    return;
+  VkDescriptorImageInfo info = {
+      .sampler = sampler ? sampler->sampler : VK_NULL_HANDLE,
+      .imageView = texture->view,
+      .imageLayout = sampled_layout(texture),
+  };
+  /* HLSL samplers are separate: the sampler goes to the same s slot */
+  push_descriptor(cmd, CANDID_BINDING_TEXTURE, slot, NULL, &info, 1);
+  if (sampler)
+    push_descriptor(cmd, CANDID_BINDING_SAMPLER, slot, NULL, &info, 1);
 }
 
 static void vulkan_cmd_push_constants(Candid_CommandBuffer *cmd,
                                       Candid_ShaderStage stages,
                                       uint32_t offset, const void *data,
                                       size_t size) {
-  (void)cmd;
+  if (!cmd || !data)
+    return;
+  bool graphics = cmd->in_render_pass;
+  Candid_ShaderProgram *program =
+      graphics ? cmd->graphics_program : cmd->compute_program;
+  if (!program || offset + size > program->bindings.push_constant_size)
+    return;
+  /* The layout has one range for every stage using push constants, and
+   * updates must name all of them */
   (void)stages;
-  (void)offset;
-  (void)data;
-  (void)size;
+  vkCmdPushConstants(cmd->vk_command_buffer, program->layout,
+                     program->push_constant_stages, offset, (uint32_t)size,
+                     data);
 }
 
 static void vulkan_cmd_draw(Candid_CommandBuffer *cmd, uint32_t vertex_count,
@@ -681,12 +3774,63 @@ static void vulkan_cmd_draw_indexed(Candid_CommandBuffer *cmd,
                                     uint32_t instance_count,
                                     uint32_t first_index, int32_t vertex_offset,
                                     uint32_t first_instance) {
-  (void)cmd;
-  (void)index_count;
-  (void)instance_count;
-  (void)first_index;
-  (void)vertex_offset;
-  (void)first_instance;
+  if (!cmd || !bind_draw_pipeline(cmd, NULL))
+    return;
+  vkCmdDrawIndexed(cmd->vk_command_buffer, index_count, instance_count,
+                   first_index, vertex_offset, first_instance);
+}
+
+static void draw_indexed_indirect(Candid_CommandBuffer *cmd,
+                                  Candid_Buffer *buffer, size_t offset,
+                                  uint32_t draw_count, uint32_t stride) {
+  if (cmd->device->multi_draw_indirect) {
+    vkCmdDrawIndexedIndirect(cmd->vk_command_buffer, buffer->buffer, offset,
+                             draw_count, stride);
+    return;
+  }
+
+  /* Without multiDrawIndirect, drawCount must be 0 or 1 */
+  for (uint32_t i = 0; i < draw_count; ++i) {
+    vkCmdDrawIndexedIndirect(cmd->vk_command_buffer, buffer->buffer,
+                             offset + (VkDeviceSize)i * stride, 1, stride);
+  }
+}
+
+static void draw_indexed_indirect_count(Candid_CommandBuffer *cmd,
+                                        Candid_Buffer *buffer, size_t offset,
+                                        Candid_Buffer *count_buffer,
+                                        size_t count_offset,
+                                        uint32_t max_draw_count,
+                                        uint32_t stride) {
+  if (!count_buffer || !cmd->device->draw_indirect_count) {
+    /* Records past the GPU count carry instance_count 0 */
+    draw_indexed_indirect(cmd, buffer, offset, max_draw_count, stride);
+    return;
+  }
+
+  vkCmdDrawIndexedIndirectCount(cmd->vk_command_buffer, buffer->buffer, offset,
+                                count_buffer->buffer, count_offset,
+                                max_draw_count, stride);
+}
+
+static void vulkan_cmd_draw_indexed_indirect(Candid_CommandBuffer *cmd,
+                                             Candid_Buffer *buffer,
+                                             size_t offset, uint32_t draw_count,
+                                             uint32_t stride) {
+  if (!cmd || !buffer || draw_count == 0 || !bind_draw_pipeline(cmd, NULL))
+    return;
+  draw_indexed_indirect(cmd, buffer, offset, draw_count, stride);
+}
+
+static void vulkan_cmd_draw_indexed_indirect_count(
+    Candid_CommandBuffer *cmd, Candid_Buffer *buffer, size_t offset,
+    Candid_Buffer *count_buffer, size_t count_offset, uint32_t max_draw_count,
+    uint32_t stride) {
+  if (!cmd || !buffer || max_draw_count == 0 ||
+      !bind_draw_pipeline(cmd, NULL))
+    return;
+  draw_indexed_indirect_count(cmd, buffer, offset, count_buffer, count_offset,
+                              max_draw_count, stride);
 }
 
 static void vulkan_cmd_draw_mesh(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
@@ -698,12 +3842,651 @@ static void vulkan_cmd_draw_mesh(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
   (void)transform;
 }
 
+/**
+ * Bind the pipeline, geometry and instance data of an instanced draw. The
+ * bound program decodes the instances (see instancing.hlsl): they are bound
+ * as Instances (t8), and a quantization box as InstanceParams (b3). Pulled
+ * meshes are bound as PulledVertices (t9) instead of a vertex buffer.
+ * @return false if the draw must be skipped
+ */
+static bool
+bind_instanced_draw(Candid_CommandBuffer *cmd, Candid_Mesh *mesh,
+                    Candid_Material *material, Candid_Buffer *instances,
+                    size_t offset,
+                    const Candid_InstanceQuantization *quantization) {
+  if (!bind_draw_pipeline(cmd, mesh_layout(mesh)))
+    return false;
+  push_material_index(cmd, material);
+
+  VkDescriptorBufferInfo info = {instances->buffer, offset, VK_WHOLE_SIZE};
+  push_descriptor(cmd, CANDID_BINDING_STORAGE_BUFFER, 8, &info, NULL, 1);
+  if (quantization) {
+    if (!push_draw_params(cmd, quantization, sizeof(*quantization), &info))
+      return false;
+    push_descriptor(cmd, CANDID_BINDING_UNIFORM_BUFFER, 3, &info, NULL, 1);
+  }
+
+  if (mesh->pulled) {
+    info = (VkDescriptorBufferInfo){mesh->vertex_buffer->buffer, 0,
+                                    VK_WHOLE_SIZE};
+    push_descriptor(cmd, CANDID_BINDING_STORAGE_BUFFER, 9, &info, NULL, 1);
+  } else {
+    vulkan_cmd_bind_vertex_buffer(cmd, 0, mesh->vertex_buffer, 0);
+  }
+  vulkan_cmd_bind_index_buffer(cmd, mesh->index_buffer, 0,
+                               mesh->index_format);
+  return true;
+}
+
+static void vulkan_cmd_draw_mesh_instanced(
+    Candid_CommandBuffer *cmd, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, Candid_Buffer *instances, size_t offset,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization) {
+  if (!cmd || !mesh || !instances || format >= CANDID_INSTANCE_FORMAT_COUNT ||
+      instance_count == 0 ||
+      !bind_instanced_draw(cmd, mesh, material, instances, offset,
+                           quantization))
+    return;
+
+  vkCmdDrawIndexed(cmd->vk_command_buffer, mesh->index_count, instance_count,
+                   mesh->first_index, mesh->vertex_offset, 0);
+}
+
+static void vulkan_cmd_draw_mesh_indirect(Candid_CommandBuffer *cmd,
+                                          Candid_Mesh *mesh,
+                                          Candid_Material *material,
+                                          const Candid_IndirectDraw *draw) {
+  if (!cmd || !mesh || !draw || !draw->args || !draw->instances ||
+      draw->format >= CANDID_INSTANCE_FORMAT_COUNT ||
+      !bind_instanced_draw(cmd, mesh, material, draw->instances,
+                           draw->instance_offset, draw->quantization))
+    return;
+
+  /* InstanceIndex includes the record's base instance, which selects its
+   * instance data */
+  draw_indexed_indirect_count(cmd, draw->args, draw->args_offset,
+                              draw->count, draw->count_offset,
+                              draw->max_draw_count,
+                              sizeof(Candid_DrawIndexedIndirectCommand));
+}
+
+static void vulkan_cmd_bind_compute_program(Candid_CommandBuffer *cmd,
+                                            Candid_ShaderProgram *program) {
+  if (!cmd || !program || cmd->in_render_pass)
+    return;
+  cmd->compute_program = program;
+  vkCmdBindPipeline(cmd->vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    program->pipeline);
+}
+
+static void vulkan_cmd_bind_storage_buffer(Candid_CommandBuffer *cmd,
+                                           uint32_t slot, Candid_Buffer *buffer,
+                                           size_t offset, size_t size) {
+  if (!cmd || !buffer || cmd->in_render_pass)
+    return;
+  VkDescriptorBufferInfo info = {buffer->buffer, offset, size};
+  push_descriptor(cmd, CANDID_BINDING_STORAGE_BUFFER, slot, &info, NULL, 1);
+}
+
+static void vulkan_cmd_bind_storage_texture(Candid_CommandBuffer *cmd,
+                                            uint32_t slot,
+                                            Candid_Texture *texture) {
+  if (!cmd || !texture || !texture->mip_views || cmd->in_render_pass)
+    return;
+
+  /* Fill the whole image array; entries past the last level repeat it and
+   * are never written */
+  VkDescriptorImageInfo infos[VULKAN_MAX_STORAGE_LEVELS];
+  uint32_t levels = texture->desc.mip_levels ? texture->desc.mip_levels : 1;
+  for (uint32_t i = 0; i < VULKAN_MAX_STORAGE_LEVELS; ++i) {
+    infos[i] = (VkDescriptorImageInfo){
+        .imageView = texture->mip_views[i < levels ? i : levels - 1],
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+    };
+  }
+
+  push_descriptor(cmd, CANDID_BINDING_STORAGE_TEXTURE, slot, NULL, infos,
+                  VULKAN_MAX_STORAGE_LEVELS);
+}
+
+static void vulkan_cmd_clear_buffer(Candid_CommandBuffer *cmd,
+                                    Candid_Buffer *buffer, size_t offset,
+                                    size_t size) {
+  if (!cmd || !buffer || size == 0 || cmd->in_render_pass)
+    return;
+  /* Orders the fill after earlier writes of the same range */
+  flush_compute_writes(cmd);
+  vkCmdFillBuffer(cmd->vk_command_buffer, buffer->buffer, offset, size, 0);
+  cmd->compute_writes = true;
+}
+
+static void vulkan_cmd_copy_buffer(Candid_CommandBuffer *cmd,
+                                   Candid_Buffer *src, size_t src_offset,
+                                   Candid_Buffer *dst, size_t dst_offset,
+                                   size_t size) {
+  if (!cmd || !src || !dst || size == 0 || cmd->in_render_pass)
+    return;
+  /* Orders the copy after earlier writes of either range, and after draws
+   * (possibly of earlier frames) still reading the destination */
+  flush_compute_writes(cmd);
+  vkCmdPipelineBarrier(cmd->vk_command_buffer,
+                       VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 0,
+                       NULL);
+  VkBufferCopy region = {
+      .srcOffset = src_offset,
+      .dstOffset = dst_offset,
+      .size = size,
+  };
+  vkCmdCopyBuffer(cmd->vk_command_buffer, src->buffer, dst->buffer, 1,
+                  &region);
+  cmd->compute_writes = true;
+}
+
 static void vulkan_cmd_dispatch(Candid_CommandBuffer *cmd, uint32_t x,
                                 uint32_t y, uint32_t z) {
-  (void)cmd;
-  (void)x;
-  (void)y;
-  (void)z;
+  if (!cmd || !cmd->compute_program || cmd->in_render_pass)
+    return;
+  flush_compute_writes(cmd);
+  vkCmdDispatch(cmd->vk_command_buffer, x, y, z);
+  cmd->compute_writes = true;
+}
+
+/* Images and buffers go into one vkCmdPipelineBarrier per batch */
+#define VULKAN_BARRIER_BATCH 32
+
+static void vulkan_cmd_barrier(Candid_CommandBuffer *cmd,
+                               const Candid_ResourceBarrier *barriers,
+                               uint32_t count) {
+  if (!cmd || !barriers || cmd->in_render_pass)
+    return;
+
+  VkImageMemoryBarrier images[VULKAN_BARRIER_BATCH];
+  VkBufferMemoryBarrier buffers[VULKAN_BARRIER_BATCH];
+  uint32_t image_count = 0;
+  uint32_t buffer_count = 0;
+  VkPipelineStageFlags src_stages = 0;
+  VkPipelineStageFlags dst_stages = 0;
+
+  for (uint32_t i = 0; i <= count; ++i) {
+    bool flush = i == count || image_count == VULKAN_BARRIER_BATCH ||
+                 buffer_count == VULKAN_BARRIER_BATCH;
+    if (flush && image_count + buffer_count > 0) {
+      vkCmdPipelineBarrier(cmd->vk_command_buffer, src_stages, dst_stages, 0,
+                           0, NULL, buffer_count, buffers, image_count,
+                           images);
+      image_count = 0;
+      buffer_count = 0;
+      src_stages = 0;
+      dst_stages = 0;
+    }
+    if (i == count)
+      break;
+
+    const Candid_ResourceBarrier *barrier = &barriers[i];
+    /* Images cannot go back to UNDEFINED; their contents may simply be
+     * dropped, which needs no barrier */
+    if (barrier->after == CANDID_RESOURCE_STATE_UNDEFINED)
+      continue;
+    bool depth = barrier->texture &&
+                 texture_format_has_depth(barrier->texture->desc.format);
+    VulkanResourceAccess before = resource_state_to_vk(barrier->before, depth);
+    VulkanResourceAccess after = resource_state_to_vk(barrier->after, depth);
+    if (barrier->before == CANDID_RESOURCE_STATE_UNDEFINED &&
+        barrier->aliased_states) {
+      /* Wait for the previous occupants' last uses, not all earlier work */
+      VulkanResourceAccess last = {0};
+      for (uint32_t s = 1; s < CANDID_RESOURCE_STATE_COUNT; ++s) {
+        if (!(barrier->aliased_states & (1u << s)))
+          continue;
+        VulkanResourceAccess use = resource_state_to_vk(s, depth);
+        last.stages |= use.stages;
+        last.access |= use.access;
+      }
+      if (last.stages) {
+        before.stages = last.stages;
+        before.access = last.access;
+      }
+    }
+    src_stages |= before.stages;
+    dst_stages |= after.stages;
+
+    if (barrier->texture) {
+      images[image_count++] = (VkImageMemoryBarrier){
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = before.access,
+          .dstAccessMask = after.access,
+          .oldLayout = before.layout,
+          .newLayout = after.layout,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = barrier->texture->image,
+          .subresourceRange =
+              {
+                  .aspectMask =
+                      texture_aspect_to_vk(barrier->texture->desc.format),
+                  .levelCount = VK_REMAINING_MIP_LEVELS,
+                  .layerCount = VK_REMAINING_ARRAY_LAYERS,
+              },
+      };
+    } else if (barrier->buffer) {
+      buffers[buffer_count++] = (VkBufferMemoryBarrier){
+          .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+          .srcAccessMask = before.access,
+          .dstAccessMask = after.access,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .buffer = barrier->buffer->buffer,
+          .size = VK_WHOLE_SIZE,
+      };
+    }
+  }
+}
+
+/*******************************************************************************
+ * Bindless Tables
+ ******************************************************************************/
+
+static Candid_Result create_bindless_layout(Candid_Device *device,
+                                            uint32_t capacity) {
+  VkSamplerCreateInfo sampler_info = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = VK_FILTER_LINEAR,
+      .minFilter = VK_FILTER_LINEAR,
+      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+      .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+      .maxLod = VK_LOD_CLAMP_NONE,
+  };
+  if (vkCreateSampler(device->device, &sampler_info, NULL,
+                      &device->bindless_sampler) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  /* Bindings match BindlessTextures, BindlessSampler and Materials */
+  VkDescriptorSetLayoutBinding bindings[3] = {
+      {0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, capacity,
+       VK_SHADER_STAGE_FRAGMENT_BIT, NULL},
+      {1, VK_DESCRIPTOR_TYPE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT,
+       &device->bindless_sampler},
+      {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, NULL},
+  };
+  VkDescriptorBindingFlags flags[3] = {
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+          VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+      0,
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+  };
+  VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info = {
+      .sType =
+          VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+      .bindingCount = 3,
+      .pBindingFlags = flags,
+  };
+  VkDescriptorSetLayoutCreateInfo layout_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .pNext = &flags_info,
+      .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+      .bindingCount = 3,
+      .pBindings = bindings,
+  };
+  if (vkCreateDescriptorSetLayout(device->device, &layout_info, NULL,
+                                  &device->bindless_layout) != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+  device->bindless_capacity = capacity;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Result vulkan_texture_table_create(Candid_Device *device,
+                                                 uint32_t capacity,
+                                                 Candid_TextureTable **out) {
+  if (!device || !out || capacity == 0)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!device->device || !device->descriptor_indexing)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  /* Programs are built against one layout, so every table shares its size */
+  if (!device->bindless_layout) {
+    Candid_Result result = create_bindless_layout(device, capacity);
+    if (result != CANDID_SUCCESS)
+      return result;
+  } else if (capacity != device->bindless_capacity) {
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  }
+
+  Candid_TextureTable *table = calloc(1, sizeof(Candid_TextureTable));
+  if (!table)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  table->capacity = capacity;
+
+  VkDescriptorPoolSize sizes[3] = {
+      {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, capacity},
+      {VK_DESCRIPTOR_TYPE_SAMPLER, 1},
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+  };
+  VkDescriptorPoolCreateInfo pool_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+      .maxSets = 1,
+      .poolSizeCount = 3,
+      .pPoolSizes = sizes,
+  };
+  VkDescriptorSetAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &device->bindless_layout,
+  };
+  if (vkCreateDescriptorPool(device->device, &pool_info, NULL,
+                             &table->pool) != VK_SUCCESS) {
+    free(table);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+  alloc_info.descriptorPool = table->pool;
+  if (vkAllocateDescriptorSets(device->device, &alloc_info, &table->set) !=
+      VK_SUCCESS) {
+    vkDestroyDescriptorPool(device->device, table->pool, NULL);
+    free(table);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = table;
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_texture_table_destroy(Candid_Device *device,
+                                         Candid_TextureTable *table) {
+  if (!device || !table)
+    return;
+  vkDestroyDescriptorPool(device->device, table->pool, NULL);
+  free(table);
+}
+
+static void vulkan_texture_table_set(Candid_Device *device,
+                                     Candid_TextureTable *table,
+                                     uint32_t index, Candid_Texture *texture) {
+  /* Cleared entries keep their stale descriptor; partially bound arrays
+   * only require descriptors that shaders actually read to be valid */
+  if (!device || !table || !texture || index >= table->capacity)
+    return;
+  VkDescriptorImageInfo info = {
+      .imageView = texture->view,
+      .imageLayout = sampled_layout(texture),
+  };
+  VkWriteDescriptorSet write = {
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet = table->set,
+      .dstBinding = 0,
+      .dstArrayElement = index,
+      .descriptorCount = 1,
+      .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+      .pImageInfo = &info,
+  };
+  vkUpdateDescriptorSets(device->device, 1, &write, 0, NULL);
+}
+
+static void vulkan_cmd_bind_bindless(Candid_CommandBuffer *cmd,
+                                     Candid_TextureTable *table,
+                                     Candid_Buffer *materials) {
+  if (!cmd || !table || !cmd->in_render_pass)
+    return;
+
+  if (materials && materials != table->materials) {
+    VkDescriptorBufferInfo info = {materials->buffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = table->set,
+        .dstBinding = 2,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &info,
+    };
+    vkUpdateDescriptorSets(cmd->device->device, 1, &write, 0, NULL);
+    table->materials = materials;
+  }
+
+  cmd->bindless_table = table;
+  bind_bindless_set(cmd);
+}
+
+static void vulkan_material_set_table_index(Candid_Material *material,
+                                            uint32_t index) {
+  if (material)
+    material->table_index = index;
+}
+
+/*******************************************************************************
+ * Secondary Command Buffers
+ ******************************************************************************/
+
+static void begin_load_pass(Candid_CommandBuffer *primary,
+                            VkSubpassContents contents) {
+  Candid_Device *device = primary->device;
+  VkRenderPassBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .renderPass = device->render_pass_load,
+      .framebuffer = device->framebuffers[primary->image_index],
+      .renderArea = {.offset = {0, 0}, .extent = device->swapchain_extent},
+  };
+  vkCmdBeginRenderPass(primary->vk_command_buffer, &begin_info, contents);
+}
+
+static Candid_Result vulkan_cmd_begin_secondary(Candid_CommandBuffer *primary,
+                                                uint32_t thread_index,
+                                                Candid_CommandBuffer **out) {
+  if (!primary || !out || !primary->in_render_pass || primary->target_pass ||
+      thread_index >= CANDID_MAX_SECONDARY_COMMAND_BUFFERS)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Device *device = primary->device;
+  if (!device->device || !device->render_pass_load)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  /* Pools are not thread-safe: one per recording thread and frame slot */
+  VkCommandPool *pool =
+      &device->frames[device->current_frame].secondary_pools[thread_index];
+  if (!*pool) {
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = device->graphics_family,
+    };
+    if (vkCreateCommandPool(device->device, &pool_info, NULL, pool) !=
+        VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  Candid_CommandBuffer *cmd = calloc(1, sizeof(Candid_CommandBuffer));
+  if (!cmd)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  VkCommandBufferAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool = *pool,
+      .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+      .commandBufferCount = 1,
+  };
+  if (vkAllocateCommandBuffers(device->device, &alloc_info,
+                               &cmd->vk_command_buffer) != VK_SUCCESS) {
+    free(cmd);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  /* Clear and load variants of the pass are compatible */
+  VkCommandBufferInheritanceInfo inheritance = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+      .renderPass = device->render_pass,
+      .subpass = 0,
+      .framebuffer = device->framebuffers[primary->image_index],
+  };
+  VkCommandBufferBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+               VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+      .pInheritanceInfo = &inheritance,
+  };
+  vkBeginCommandBuffer(cmd->vk_command_buffer, &begin_info);
+
+  cmd->device = device;
+  cmd->image_index = primary->image_index;
+  cmd->in_render_pass = true;
+  cmd->is_secondary = true;
+  cmd->bindless_table = primary->bindless_table;
+  cmd->bound_material_index = UINT32_MAX;
+
+  /* Secondaries inherit no state: start from the primary's */
+  cmd->viewport = primary->viewport;
+  cmd->scissor = primary->scissor;
+  set_dynamic_state(cmd);
+  cmd->graphics_program = primary->graphics_program;
+  cmd->pipeline_key = primary->pipeline_key;
+  cmd->graphics_pipeline = primary->graphics_pipeline;
+  if (cmd->graphics_pipeline) {
+    vkCmdBindPipeline(cmd->vk_command_buffer,
+                      VK_PIPELINE_BIND_POINT_GRAPHICS, cmd->graphics_pipeline);
+    bind_bindless_set(cmd);
+  }
+
+  *out = cmd;
+  return CANDID_SUCCESS;
+}
+
+static void vulkan_cmd_end_secondary(Candid_CommandBuffer *secondary) {
+  if (!secondary || !secondary->is_secondary)
+    return;
+  vkEndCommandBuffer(secondary->vk_command_buffer);
+}
+
+static void vulkan_cmd_execute_secondary(
+    Candid_CommandBuffer *primary, Candid_CommandBuffer *const *secondaries,
+    uint32_t count) {
+  if (!primary || !secondaries || count == 0 ||
+      count > CANDID_MAX_SECONDARY_COMMAND_BUFFERS)
+    return;
+
+  VkCommandBuffer handles[CANDID_MAX_SECONDARY_COMMAND_BUFFERS];
+  for (uint32_t i = 0; i < count; ++i) {
+    handles[i] = secondaries[i]->vk_command_buffer;
+  }
+
+  /* The primary pass records inline; secondaries need a subpass begun with
+   * SECONDARY_COMMAND_BUFFERS contents, so split the pass around them. */
+  vkCmdEndRenderPass(primary->vk_command_buffer);
+  begin_load_pass(primary, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+  vkCmdExecuteCommands(primary->vk_command_buffer, count, handles);
+  vkCmdEndRenderPass(primary->vk_command_buffer);
+  begin_load_pass(primary, VK_SUBPASS_CONTENTS_INLINE);
+
+  /* Executing secondaries leaves the primary's state undefined. Pushed
+   * descriptors are not tracked and must be bound again. */
+  set_dynamic_state(primary);
+  primary->bound_material_index = UINT32_MAX;
+  if (primary->graphics_pipeline) {
+    vkCmdBindPipeline(primary->vk_command_buffer,
+                      VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      primary->graphics_pipeline);
+    bind_bindless_set(primary);
+  }
+
+  /* The VkCommandBuffers go back to their pool when the frame slot resets */
+  for (uint32_t i = 0; i < count; ++i) {
+    free(secondaries[i]);
+  }
+}
+
+/*******************************************************************************
+ * Async Compute
+ ******************************************************************************/
+
+static Candid_Result vulkan_cmd_begin_compute(Candid_Device *device,
+                                              Candid_CommandBuffer **out) {
+  if (!device || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!device->compute_queue || !device->queue_timelines[CANDID_QUEUE_COMPUTE])
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  /* Buffers go back to the pool when the frame slot resets */
+  VkCommandPool *pool = &device->frames[device->current_frame].compute_pool;
+  if (!*pool) {
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = device->compute_family,
+    };
+    if (vkCreateCommandPool(device->device, &pool_info, NULL, pool) !=
+        VK_SUCCESS)
+      return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  Candid_CommandBuffer *cmd = calloc(1, sizeof(Candid_CommandBuffer));
+  if (!cmd)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  VkCommandBufferAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool = *pool,
+      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = 1,
+  };
+  if (vkAllocateCommandBuffers(device->device, &alloc_info,
+                               &cmd->vk_command_buffer) != VK_SUCCESS) {
+    free(cmd);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  VkCommandBufferBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  vkBeginCommandBuffer(cmd->vk_command_buffer, &begin_info);
+
+  cmd->device = device;
+  cmd->queue = CANDID_QUEUE_COMPUTE;
+  *out = cmd;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Result vulkan_cmd_submit_compute(Candid_Device *device,
+                                               Candid_CommandBuffer *cmd,
+                                               Candid_SyncPoint *out_signal) {
+  if (!device || !cmd || cmd->queue != CANDID_QUEUE_COMPUTE)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  /* The signal makes every write available to the queues waiting for it */
+  VkResult result = submit_timeline(device, cmd, device->compute_queue,
+                                    VK_NULL_HANDLE, VK_NULL_HANDLE,
+                                    VK_NULL_HANDLE);
+  free(cmd);
+  if (result != VK_SUCCESS)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  uint64_t value = device->queue_values[CANDID_QUEUE_COMPUTE];
+  device->frames[device->current_frame].compute_value = value;
+  if (out_signal)
+    *out_signal =
+        (Candid_SyncPoint){.queue = CANDID_QUEUE_COMPUTE, .value = value};
+  return CANDID_SUCCESS;
+}
+
+static Candid_SyncPoint vulkan_queue_get_sync_point(Candid_Device *device,
+                                                    Candid_Queue queue) {
+  Candid_SyncPoint point = {.queue = queue};
+  if (device && queue < CANDID_QUEUE_COUNT)
+    point.value = device->queue_values[queue];
+  return point;
+}
+
+/* Semaphores are only waited at submission, which covers the whole buffer */
+static void vulkan_cmd_wait(Candid_CommandBuffer *cmd,
+                            const Candid_SyncPoint *point) {
+  if (!cmd || !point || cmd->is_secondary ||
+      point->queue >= CANDID_QUEUE_COUNT || point->queue == cmd->queue ||
+      !cmd->device->queue_timelines[point->queue])
+    return;
+  if (point->value > cmd->wait_values[point->queue])
+    cmd->wait_values[point->queue] = point->value;
 }
 
 /*******************************************************************************
@@ -722,6 +4505,8 @@ const Candid_BackendInterface candid_vulkan_backend = {
     /* Swapchain */
     .swapchain_resize = vulkan_swapchain_resize,
     .swapchain_present = vulkan_swapchain_present,
+    .frame_wait = vulkan_frame_wait,
+    .swapchain_get_depth_texture = vulkan_swapchain_get_depth_texture,
 
     /* Buffer */
     .buffer_create = vulkan_buffer_create,
@@ -734,6 +4519,10 @@ const Candid_BackendInterface candid_vulkan_backend = {
     .texture_create = vulkan_texture_create,
     .texture_destroy = vulkan_texture_destroy,
     .texture_upload = vulkan_texture_upload,
+    .heap_create = vulkan_heap_create,
+    .heap_destroy = vulkan_heap_destroy,
+    .texture_get_placement = vulkan_texture_get_placement,
+    .texture_create_placed = vulkan_texture_create_placed,
 
     /* Sampler */
     .sampler_create = vulkan_sampler_create,
@@ -744,14 +4533,20 @@ const Candid_BackendInterface candid_vulkan_backend = {
     .shader_module_destroy = vulkan_shader_module_destroy,
     .shader_program_create = vulkan_shader_program_create,
     .shader_program_destroy = vulkan_shader_program_destroy,
+    .get_compute_kernel = vulkan_get_compute_kernel,
 
     /* Mesh */
     .mesh_create = vulkan_mesh_create,
+    .mesh_create_placed = vulkan_mesh_create_placed,
+    .mesh_set_placement = vulkan_mesh_set_placement,
     .mesh_destroy = vulkan_mesh_destroy,
+    .mesh_get_draw_info = vulkan_mesh_get_draw_info,
 
     /* Material */
     .material_create = vulkan_material_create,
     .material_destroy = vulkan_material_destroy,
+    .material_create_instance = vulkan_material_create_instance,
+    .material_get_base = vulkan_material_get_base,
 
     /* Command buffer */
     .cmd_begin = vulkan_cmd_begin,
@@ -760,6 +4555,7 @@ const Candid_BackendInterface candid_vulkan_backend = {
 
     /* Render pass */
     .cmd_begin_render_pass = vulkan_cmd_begin_render_pass,
+    .cmd_begin_render_pass_targets = vulkan_cmd_begin_render_pass_targets,
     .cmd_end_render_pass = vulkan_cmd_end_render_pass,
     .cmd_set_viewport = vulkan_cmd_set_viewport,
     .cmd_set_scissor = vulkan_cmd_set_scissor,
@@ -774,9 +4570,37 @@ const Candid_BackendInterface candid_vulkan_backend = {
     .cmd_draw = vulkan_cmd_draw,
     .cmd_draw_indexed = vulkan_cmd_draw_indexed,
     .cmd_draw_mesh = vulkan_cmd_draw_mesh,
+    .cmd_draw_mesh_instanced = vulkan_cmd_draw_mesh_instanced,
+    .cmd_draw_indexed_indirect = vulkan_cmd_draw_indexed_indirect,
+    .cmd_draw_indexed_indirect_count = vulkan_cmd_draw_indexed_indirect_count,
+    .cmd_draw_mesh_indirect = vulkan_cmd_draw_mesh_indirect,
 
     /* Compute */
+    .cmd_bind_compute_program = vulkan_cmd_bind_compute_program,
+    .cmd_bind_storage_buffer = vulkan_cmd_bind_storage_buffer,
+    .cmd_bind_storage_texture = vulkan_cmd_bind_storage_texture,
+    .cmd_clear_buffer = vulkan_cmd_clear_buffer,
+    .cmd_copy_buffer = vulkan_cmd_copy_buffer,
     .cmd_dispatch = vulkan_cmd_dispatch,
+    .cmd_barrier = vulkan_cmd_barrier,
+
+    /* Secondary command buffers */
+    .cmd_begin_secondary = vulkan_cmd_begin_secondary,
+    .cmd_end_secondary = vulkan_cmd_end_secondary,
+    .cmd_execute_secondary = vulkan_cmd_execute_secondary,
+
+    /* Async compute */
+    .cmd_begin_compute = vulkan_cmd_begin_compute,
+    .cmd_submit_compute = vulkan_cmd_submit_compute,
+    .queue_get_sync_point = vulkan_queue_get_sync_point,
+    .cmd_wait = vulkan_cmd_wait,
+
+    /* Bindless */
+    .texture_table_create = vulkan_texture_table_create,
+    .texture_table_destroy = vulkan_texture_table_destroy,
+    .texture_table_set = vulkan_texture_table_set,
+    .cmd_bind_bindless = vulkan_cmd_bind_bindless,
+    .material_set_table_index = vulkan_material_set_table_index,
 };
 
 #endif /* CANDID_VULKAN_SUPPORT */
@@ -0,0 +1,654 @@
+/**
+ * @file bindless.c
+ * @brief Internal bindless texture and material tables
+ */
+
+#include "bindless.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Texture indices are packed in 16 bits, 0xFFFF meaning none */
+#define BINDLESS_MAX_TEXTURES CANDID_MATERIAL_NO_TEXTURE
+
+static_assert(sizeof(Candid_MaterialRecord) == 64, "material record size");
+
+/*******************************************************************************
+ * Index Allocator
+ ******************************************************************************/
+
+static bool index_init(Candid_IndexAllocator *allocator, uint32_t capacity,
+                       uint32_t first) {
+  allocator->free_indices = malloc(capacity * sizeof(uint32_t));
+  if (!allocator->free_indices)
+    return false;
+  allocator->capacity = capacity;
+  allocator->next = first;
+  return true;
+}
+
+static uint32_t index_alloc(Candid_IndexAllocator *allocator) {
+  /* Reuse released indices before growing the live part of the tables */
+  if (allocator->free_count > 0)
+    return allocator->free_indices[--allocator->free_count];
+  if (allocator->next < allocator->capacity)
+    return allocator->next++;
+  return CANDID_BINDLESS_INVALID_INDEX;
+}
+
+/* For indices handed out but never used */
+static void index_free(Candid_IndexAllocator *allocator, uint32_t index) {
+  allocator->free_indices[allocator->free_count++] = index;
+}
+
+static void index_retire(Candid_IndexAllocator *allocator, uint32_t slot,
+                         uint32_t index) {
+  if (allocator->retired_count[slot] == allocator->retired_capacity[slot]) {
+    uint32_t capacity = allocator->retired_capacity[slot]
+                            ? allocator->retired_capacity[slot] * 2
+                            : 64;
+    uint32_t *retired =
+        realloc(allocator->retired[slot], capacity * sizeof(uint32_t));
+    if (!retired)
+      return; /* The index stays lost rather than reused too early */
+    allocator->retired[slot] = retired;
+    allocator->retired_capacity[slot] = capacity;
+  }
+  allocator->retired[slot][allocator->retired_count[slot]++] = index;
+}
+
+/* Retired indices number at most capacity, so the free list never overflows */
+static void index_reset(Candid_IndexAllocator *allocator, uint32_t slot) {
+  for (uint32_t i = 0; i < allocator->retired_count[slot]; ++i) {
+    allocator->free_indices[allocator->free_count++] =
+        allocator->retired[slot][i];
+  }
+  allocator->retired_count[slot] = 0;
+}
+
+static void index_destroy(Candid_IndexAllocator *allocator) {
+  free(allocator->free_indices);
+  for (uint32_t i = 0; i < CANDID_MAX_UPLOAD_SLOTS; ++i) {
+    free(allocator->retired[i]);
+  }
+  memset(allocator, 0, sizeof(*allocator));
+}
+
+/*******************************************************************************
+ * Resource Map
+ ******************************************************************************/
+
+static uint32_t map_slot(const Candid_BindlessMap *map, const void *resource) {
+  uint64_t hash = (uint64_t)(uintptr_t)resource * 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(hash >> 32) & (map->capacity - 1);
+}
+
+static uint32_t map_find(const Candid_BindlessMap *map, const void *resource) {
+  if (map->count == 0 || !resource)
+    return UINT32_MAX;
+  uint32_t mask = map->capacity - 1;
+  for (uint32_t i = map_slot(map, resource); map->entries[i].resource;
+       i = (i + 1) & mask) {
+    if (map->entries[i].resource == resource)
+      return i;
+  }
+  return UINT32_MAX;
+}
+
+static void map_place(Candid_BindlessMap *map, Candid_BindlessEntry entry) {
+  uint32_t mask = map->capacity - 1;
+  uint32_t i = map_slot(map, entry.resource);
+  while (map->entries[i].resource)
+    i = (i + 1) & mask;
+  map->entries[i] = entry;
+}
+
+/* Kept at most three quarters full */
+static bool map_insert(Candid_BindlessMap *map, const void *resource,
+                       uint32_t index) {
+  if ((map->count + 1) * 4 > map->capacity * 3) {
+    uint32_t old_capacity = map->capacity;
+    Candid_BindlessEntry *old_entries = map->entries;
+    uint32_t capacity = old_capacity ? old_capacity * 2 : 64;
+    Candid_BindlessEntry *entries =
+        calloc(capacity, sizeof(Candid_BindlessEntry));
+    if (!entries)
+      return false;
+
+    map->entries = entries;
+    map->capacity = capacity;
+    for (uint32_t i = 0; i < old_capacity; ++i) {
+      if (old_entries[i].resource)
+        map_place(map, old_entries[i]);
+    }
+    free(old_entries);
+  }
+
+  map_place(map, (Candid_BindlessEntry){resource, index});
+  map->count++;
+  return true;
+}
+
+/* Backward-shift deletion keeps probe sequences unbroken */
+static void map_remove(Candid_BindlessMap *map, uint32_t slot) {
+  uint32_t mask = map->capacity - 1;
+  uint32_t hole = slot;
+  for (uint32_t i = (slot + 1) & mask; map->entries[i].resource;
+       i = (i + 1) & mask) {
+    uint32_t home = map_slot(map, map->entries[i].resource);
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      map->entries[hole] = map->entries[i];
+      hole = i;
+    }
+  }
+  map->entries[hole] = (Candid_BindlessEntry){0};
+  map->count--;
+}
+
+/* Remove `resource` and return its index */
+static uint32_t map_take(Candid_BindlessMap *map, const void *resource) {
+  uint32_t slot = map_find(map, resource);
+  if (slot == UINT32_MAX)
+    return CANDID_BINDLESS_INVALID_INDEX;
+  uint32_t index = map->entries[slot].index;
+  map_remove(map, slot);
+  return index;
+}
+
+static uint32_t map_lookup(const Candid_BindlessMap *map,
+                           const void *resource) {
+  uint32_t slot = map_find(map, resource);
+  return slot == UINT32_MAX ? CANDID_BINDLESS_INVALID_INDEX
+                            : map->entries[slot].index;
+}
+
+/*******************************************************************************
+ * Material Records
+ ******************************************************************************/
+
+/* IEEE half, rounded to nearest even */
+static uint32_t float_to_half(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  uint32_t mantissa = bits & 0x7FFFFFu;
+  int32_t exponent = (int32_t)((bits >> 23) & 0xFFu);
+
+  if (exponent == 0xFF)
+    return sign | 0x7C00u | (mantissa ? 0x200u : 0u);
+  exponent += 15 - 127;
+  if (exponent >= 31)
+    return sign | 0x7C00u;
+
+  uint32_t shift = 13;
+  if (exponent <= 0) {
+    if (exponent < -10)
+      return sign;
+    mantissa |= 0x800000u;
+    shift = (uint32_t)(14 - exponent);
+    exponent = 0;
+  }
+  uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> shift);
+  uint32_t rest = mantissa & ((1u << shift) - 1);
+  uint32_t halfway = 1u << (shift - 1);
+  /* A carry out of the mantissa correctly bumps the exponent */
+  if (rest > halfway || (rest == halfway && (half & 1)))
+    half++;
+  return sign | half;
+}
+
+static uint32_t texture_index(const Candid_Bindless *bindless,
+                              const Candid_Texture *texture) {
+  uint32_t index = map_lookup(&bindless->texture_map, texture);
+  return index == CANDID_BINDLESS_INVALID_INDEX ? CANDID_MATERIAL_NO_TEXTURE
+                                                : index;
+}
+
+static uint32_t texture_pair(const Candid_Bindless *bindless,
+                             const Candid_Texture *low,
+                             const Candid_Texture *high) {
+  return texture_index(bindless, low) | texture_index(bindless, high) << 16;
+}
+
+void candid_bindless_pack_material(const Candid_Bindless *bindless,
+                                   const Candid_MaterialDesc *desc,
+                                   Candid_MaterialRecord *out) {
+  memset(out, 0, sizeof(*out));
+
+  uint32_t flags = 0;
+  if (desc->use_specular_glossiness) {
+    const Candid_PBRSpecularGlossiness *pbr = &desc->pbr.specular_glossiness;
+    memcpy(out->base_color, &pbr->diffuse_factor, sizeof(out->base_color));
+    out->pbr[0] = pbr->specular_factor.x;
+    out->pbr[1] = pbr->specular_factor.y;
+    out->pbr[2] = pbr->specular_factor.z;
+    out->pbr[3] = pbr->glossiness_factor;
+    out->pbr_textures = texture_pair(bindless, pbr->diffuse_texture,
+                                     pbr->specular_glossiness_texture);
+    flags |= CANDID_MATERIAL_FLAG_SPECULAR_GLOSSINESS;
+  } else {
+    const Candid_PBRMetallicRoughness *pbr = &desc->pbr.metallic_roughness;
+    memcpy(out->base_color, &pbr->base_color_factor, sizeof(out->base_color));
+    out->pbr[0] = pbr->metallic_factor;
+    out->pbr[1] = pbr->roughness_factor;
+    out->pbr_textures = texture_pair(bindless, pbr->base_color_texture,
+                                     pbr->metallic_roughness_texture);
+  }
+
+  out->emissive[0] = desc->emissive_factor.x;
+  out->emissive[1] = desc->emissive_factor.y;
+  out->emissive[2] = desc->emissive_factor.z;
+  out->alpha_cutoff = desc->alpha_cutoff;
+  out->scales = float_to_half(desc->normal_scale) |
+                float_to_half(desc->occlusion_strength) << 16;
+  out->normal_occlusion_textures =
+      texture_pair(bindless, desc->normal_texture, desc->occlusion_texture);
+
+  if (desc->alpha_mode == CANDID_ALPHA_MODE_MASK)
+    flags |= CANDID_MATERIAL_FLAG_ALPHA_MASK;
+  else if (desc->alpha_mode == CANDID_ALPHA_MODE_BLEND)
+    flags |= CANDID_MATERIAL_FLAG_ALPHA_BLEND;
+  if (desc->double_sided)
+    flags |= CANDID_MATERIAL_FLAG_DOUBLE_SIDED;
+  if (desc->unlit)
+    flags |= CANDID_MATERIAL_FLAG_UNLIT;
+  out->emissive_texture_flags =
+      texture_index(bindless, desc->emissive_texture) | flags << 16;
+}
+static void set_record(Candid_Bindless *bindless, uint32_t index,
+                       const Candid_MaterialRecord *record) {
+  bindless->records[index] = *record;
+  bindless->dirty[index / 64] |= 1ull << (index % 64);
+  if (bindless->dirty_first == bindless->dirty_end) {
+    bindless->dirty_first = index;
+    bindless->dirty_end = index + 1;
+  } else if (index < bindless->dirty_first) {
+    bindless->dirty_first = index;
+  } else if (index >= bindless->dirty_end) {
+    bindless->dirty_end = index + 1;
+  }
+}
+
+/* First dirty record in [index, end), or `end` */
+static uint32_t next_dirty(const Candid_Bindless *bindless, uint32_t index,
+                           uint32_t end) {
+  while (index < end) {
+    uint64_t word = bindless->dirty[index / 64] >> (index % 64);
+    if (word == 0) {
+      index = (index / 64 + 1) * 64;
+      continue;
+    }
+    while (!(word & 1)) {
+      word >>= 1;
+      index++;
+    }
+    return index < end ? index : end;
+  }
+  return end;
+}
+
+static uint32_t replace_low(uint32_t pair, uint32_t low) {
+  return (pair & 0xFFFF0000u) | low;
+}
+
+static void apply_overrides(const Candid_Bindless *bindless,
+                            const Candid_MaterialOverrides *overrides,
+                            Candid_MaterialRecord *record) {
+  uint32_t mask = overrides->mask;
+  uint32_t flags = record->emissive_texture_flags >> 16;
+  bool metallic_roughness = !(flags & CANDID_MATERIAL_FLAG_SPECULAR_GLOSSINESS);
+
+  if (mask & CANDID_MATERIAL_OVERRIDE_BASE_COLOR)
+    memcpy(record->base_color, &overrides->base_color_factor,
+           sizeof(record->base_color));
+  if (mask & CANDID_MATERIAL_OVERRIDE_EMISSIVE) {
+    record->emissive[0] = overrides->emissive_factor.x;
+    record->emissive[1] = overrides->emissive_factor.y;
+    record->emissive[2] = overrides->emissive_factor.z;
+  }
+  if ((mask & CANDID_MATERIAL_OVERRIDE_METALLIC) && metallic_roughness)
+    record->pbr[0] = overrides->metallic_factor;
+  if ((mask & CANDID_MATERIAL_OVERRIDE_ROUGHNESS) && metallic_roughness)
+    record->pbr[1] = overrides->roughness_factor;
+  if (mask & CANDID_MATERIAL_OVERRIDE_ALPHA_CUTOFF)
+    record->alpha_cutoff = overrides->alpha_cutoff;
+  if (mask & CANDID_MATERIAL_OVERRIDE_BASE_COLOR_TEXTURE)
+    record->pbr_textures =
+        replace_low(record->pbr_textures,
+                    texture_index(bindless, overrides->base_color_texture));
+  if (mask & CANDID_MATERIAL_OVERRIDE_NORMAL_TEXTURE)
+    record->normal_occlusion_textures =
+        replace_low(record->normal_occlusion_textures,
+                    texture_index(bindless, overrides->normal_texture));
+  if (mask & CANDID_MATERIAL_OVERRIDE_EMISSIVE_TEXTURE)
+    record->emissive_texture_flags =
+        replace_low(record->emissive_texture_flags,
+                    texture_index(bindless, overrides->emissive_texture));
+}
+
+/* Rebuild an instance's record from its base's, marking it if it changed */
+static void pack_instance(Candid_Bindless *bindless,
+                          const Candid_BindlessInstance *instance) {
+  Candid_MaterialRecord record = bindless->records[instance->base];
+  apply_overrides(bindless, &instance->overrides, &record);
+  if (memcmp(&bindless->records[instance->index], &record, sizeof(record)))
+    set_record(bindless, instance->index, &record);
+}
+
+static bool push_copy(Candid_Bindless *bindless, uint32_t count,
+                      Candid_BindlessCopy copy) {
+  if (count == bindless->copy_capacity) {
+    uint32_t capacity = count ? count * 2 : 64;
+    Candid_BindlessCopy *copies =
+        realloc(bindless->copies, capacity * sizeof(Candid_BindlessCopy));
+    if (!copies)
+      return false;
+    bindless->copies = copies;
+    bindless->copy_capacity = capacity;
+  }
+  bindless->copies[count] = copy;
+  return true;
+}
+
+/*******************************************************************************
+ * Tables
+ ******************************************************************************/
+
+Candid_Result candid_bindless_init(Candid_Bindless *bindless,
+                                   const Candid_BackendInterface *backend,
+                                   Candid_Device *device,
+                                   uint32_t texture_capacity,
+                                   uint32_t material_capacity) {
+  if (!bindless || !backend->texture_table_create)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  if (texture_capacity == 0)
+    texture_capacity = CANDID_BINDLESS_DEFAULT_TEXTURES;
+  if (texture_capacity > BINDLESS_MAX_TEXTURES)
+    texture_capacity = BINDLESS_MAX_TEXTURES;
+  if (material_capacity == 0)
+    material_capacity = CANDID_BINDLESS_DEFAULT_MATERIALS;
+
+  Candid_Result result = backend->texture_table_create(
+      device, texture_capacity, &bindless->textures);
+  if (result != CANDID_SUCCESS) {
+    bindless->textures = NULL;
+    return result;
+  }
+
+  /* Records only change through copies, ordered with the frames reading
+   * them, so a single GPU-only table serves every frame in flight */
+  Candid_BufferDesc desc = {
+      .size = (size_t)material_capacity * sizeof(Candid_MaterialRecord),
+      .usage = CANDID_BUFFER_USAGE_STORAGE | CANDID_BUFFER_USAGE_TRANSFER_DST,
+      .memory = CANDID_BUFFER_MEMORY_GPU_ONLY,
+      .label = "Candid Material Table",
+  };
+  result = backend->cmd_copy_buffer
+               ? backend->buffer_create(device, &desc, &bindless->materials)
+               : CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+  if (result == CANDID_SUCCESS) {
+    bindless->records =
+        calloc(material_capacity, sizeof(Candid_MaterialRecord));
+    bindless->dirty = calloc((material_capacity + 63) / 64, sizeof(uint64_t));
+    if (!bindless->records || !bindless->dirty ||
+        !index_init(&bindless->texture_indices, texture_capacity, 0) ||
+        !index_init(&bindless->material_indices, material_capacity,
+                    CANDID_BINDLESS_DEFAULT_MATERIAL + 1))
+      result = CANDID_ERROR_OUT_OF_MEMORY;
+  }
+
+  if (result == CANDID_SUCCESS) {
+    Candid_MaterialDesc defaults = {
+        .pbr.metallic_roughness = {
+            .base_color_factor = {1.0f, 1.0f, 1.0f, 1.0f},
+            .metallic_factor = 1.0f,
+            .roughness_factor = 1.0f,
+        },
+        .normal_scale = 1.0f,
+        .occlusion_strength = 1.0f,
+        .alpha_cutoff = 0.5f,
+    };
+    Candid_MaterialRecord record;
+    candid_bindless_pack_material(bindless, &defaults, &record);
+    set_record(bindless, CANDID_BINDLESS_DEFAULT_MATERIAL, &record);
+  }
+
+  if (result != CANDID_SUCCESS) {
+    candid_bindless_destroy(bindless, backend, device);
+    return result;
+  }
+  return CANDID_SUCCESS;
+}
+
+uint32_t candid_bindless_add_texture(Candid_Bindless *bindless,
+                                     const Candid_Texture *texture) {
+  if (!bindless->textures || !texture)
+    return CANDID_BINDLESS_INVALID_INDEX;
+  uint32_t index = index_alloc(&bindless->texture_indices);
+  if (index == CANDID_BINDLESS_INVALID_INDEX)
+    return index;
+  if (!map_insert(&bindless->texture_map, texture, index)) {
+    index_free(&bindless->texture_indices, index);
+    return CANDID_BINDLESS_INVALID_INDEX;
+  }
+  return index;
+}
+
+uint32_t candid_bindless_remove_texture(Candid_Bindless *bindless,
+                                        const Candid_Texture *texture,
+                                        uint32_t slot) {
+  if (!bindless->textures || slot >= CANDID_MAX_UPLOAD_SLOTS)
+    return CANDID_BINDLESS_INVALID_INDEX;
+  uint32_t index = map_take(&bindless->texture_map, texture);
+  if (index != CANDID_BINDLESS_INVALID_INDEX)
+    index_retire(&bindless->texture_indices, slot, index);
+  return index;
+}
+
+uint32_t candid_bindless_find_texture(const Candid_Bindless *bindless,
+                                      const Candid_Texture *texture) {
+  return map_lookup(&bindless->texture_map, texture);
+}
+
+uint32_t candid_bindless_add_material(Candid_Bindless *bindless,
+                                      const Candid_Material *material,
+                                      const Candid_MaterialDesc *desc) {
+  if (!bindless->materials || !material || !desc)
+    return CANDID_BINDLESS_INVALID_INDEX;
+  uint32_t index = index_alloc(&bindless->material_indices);
+  if (index == CANDID_BINDLESS_INVALID_INDEX)
+    return index;
+  if (!map_insert(&bindless->material_map, material, index)) {
+    index_free(&bindless->material_indices, index);
+    return CANDID_BINDLESS_INVALID_INDEX;
+  }
+
+  Candid_MaterialRecord record;
+  candid_bindless_pack_material(bindless, desc, &record);
+  set_record(bindless, index, &record);
+  return index;
+}
+
+uint32_t
+candid_bindless_add_instance(Candid_Bindless *bindless,
+                             const Candid_Material *instance,
+                             const Candid_Material *base,
+                             const Candid_MaterialOverrides *overrides) {
+  if (!bindless->materials || !instance || !overrides)
+    return CANDID_BINDLESS_INVALID_INDEX;
+  uint32_t base_index = map_lookup(&bindless->material_map, base);
+  if (base_index == CANDID_BINDLESS_INVALID_INDEX)
+    return CANDID_BINDLESS_INVALID_INDEX;
+
+  if (bindless->instance_count == bindless->instance_capacity) {
+    uint32_t capacity =
+        bindless->instance_capacity ? bindless->instance_capacity * 2 : 64;
+    Candid_BindlessInstance *instances = realloc(
+        bindless->instances, capacity * sizeof(Candid_BindlessInstance));
+    if (!instances)
+      return CANDID_BINDLESS_INVALID_INDEX;
+    bindless->instances = instances;
+    bindless->instance_capacity = capacity;
+  }
+
+  uint32_t index = index_alloc(&bindless->material_indices);
+  if (index == CANDID_BINDLESS_INVALID_INDEX)
+    return index;
+  if (!map_insert(&bindless->material_map, instance, index)) {
+    index_free(&bindless->material_indices, index);
+    return CANDID_BINDLESS_INVALID_INDEX;
+  }
+  if (!map_insert(&bindless->instance_map, instance,
+                  bindless->instance_count)) {
+    map_take(&bindless->material_map, instance);
+    index_free(&bindless->material_indices, index);
+    return CANDID_BINDLESS_INVALID_INDEX;
+  }
+
+  Candid_BindlessInstance *entry =
+      &bindless->instances[bindless->instance_count++];
+  *entry = (Candid_BindlessInstance){
+      .material = instance,
+      .index = index,
+      .base = base_index,
+      .overrides = *overrides,
+  };
+  Candid_MaterialRecord record = bindless->records[base_index];
+  apply_overrides(bindless, overrides, &record);
+  set_record(bindless, index, &record);
+  return index;
+}
+
+Candid_Result candid_bindless_update_material(Candid_Bindless *bindless,
+                                              const Candid_Material *material,
+                                              const Candid_MaterialDesc *desc) {
+  if (!desc || map_find(&bindless->instance_map, material) != UINT32_MAX)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  uint32_t index = map_lookup(&bindless->material_map, material);
+  if (index == CANDID_BINDLESS_INVALID_INDEX)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  /* Repacking a material that did not change costs no upload */
+  Candid_MaterialRecord record;
+  candid_bindless_pack_material(bindless, desc, &record);
+  if (memcmp(&bindless->records[index], &record, sizeof(record)) == 0)
+    return CANDID_SUCCESS;
+  set_record(bindless, index, &record);
+
+  /* Base updates are rare next to draws: a scan beats per-base lists */
+  for (uint32_t i = 0; i < bindless->instance_count; ++i) {
+    if (bindless->instances[i].base == index)
+      pack_instance(bindless, &bindless->instances[i]);
+  }
+  return CANDID_SUCCESS;
+}
+
+void candid_bindless_remove_material(Candid_Bindless *bindless,
+                                     const Candid_Material *material,
+                                     uint32_t slot) {
+  if (!bindless->materials || slot >= CANDID_MAX_UPLOAD_SLOTS)
+    return;
+  uint32_t index = map_take(&bindless->material_map, material);
+  if (index == CANDID_BINDLESS_INVALID_INDEX)
+    return;
+  index_retire(&bindless->material_indices, slot, index);
+
+  /* Instances are unordered: the last one fills the hole */
+  uint32_t position = map_take(&bindless->instance_map, material);
+  if (position == CANDID_BINDLESS_INVALID_INDEX)
+    return;
+  uint32_t last = --bindless->instance_count;
+  if (position != last) {
+    bindless->instances[position] = bindless->instances[last];
+    uint32_t moved = map_find(&bindless->instance_map,
+                              bindless->instances[position].material);
+    bindless->instance_map.entries[moved].index = position;
+  }
+}
+
+uint32_t candid_bindless_find_material(const Candid_Bindless *bindless,
+                                       const Candid_Material *material) {
+  return map_lookup(&bindless->material_map, material);
+}
+
+uint32_t candid_bindless_stage_materials(
+    Candid_Bindless *bindless, const Candid_BackendInterface *backend,
+    Candid_Device *device, Candid_FrameUpload *upload,
+    Candid_Buffer **out_staging, const Candid_BindlessCopy **out_copies) {
+  if (!bindless->materials || bindless->dirty_first == bindless->dirty_end)
+    return 0;
+
+  const size_t record_size = sizeof(Candid_MaterialRecord);
+  uint32_t end = bindless->dirty_end;
+  uint32_t count = 0;
+  size_t staged = 0;
+  for (uint32_t first = next_dirty(bindless, bindless->dirty_first, end);
+       first < end;) {
+    uint32_t last = first + 1;
+    for (uint32_t next = next_dirty(bindless, last, end);
+         next < end && next - last <= CANDID_BINDLESS_UPLOAD_GAP;
+         next = next_dirty(bindless, last, end))
+      last = next + 1;
+
+    size_t size = (last - first) * record_size;
+    if (!push_copy(bindless, count,
+                   (Candid_BindlessCopy){staged, first * record_size, size}))
+      return 0;
+    count++;
+    staged += size;
+    first = next_dirty(bindless, last, end);
+  }
+
+  size_t offset;
+  void *data;
+  if (candid_upload_alloc(backend, device, upload, staged, out_staging,
+                          &offset, &data) != CANDID_SUCCESS)
+    return 0;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    Candid_BindlessCopy *copy = &bindless->copies[i];
+    memcpy((uint8_t *)data + copy->source,
+           (const uint8_t *)bindless->records + copy->destination,
+           copy->size);
+    copy->source += offset;
+  }
+
+  /* Every dirty bit lies within the bounds, so whole words can be cleared */
+  uint32_t first_word = bindless->dirty_first / 64;
+  memset(&bindless->dirty[first_word], 0,
+         ((end - 1) / 64 + 1 - first_word) * sizeof(uint64_t));
+  bindless->dirty_first = bindless->dirty_end = 0;
+
+  *out_copies = bindless->copies;
+  return count;
+}
+
+void candid_bindless_reset(Candid_Bindless *bindless, uint32_t slot) {
+  if (!bindless || !bindless->textures || slot >= CANDID_MAX_UPLOAD_SLOTS)
+    return;
+  index_reset(&bindless->texture_indices, slot);
+  index_reset(&bindless->material_indices, slot);
+}
+
+void candid_bindless_destroy(Candid_Bindless *bindless,
+                             const Candid_BackendInterface *backend,
+                             Candid_Device *device) {
+  if (!bindless)
+    return;
+  if (bindless->textures)
+    backend->texture_table_destroy(device, bindless->textures);
+  if (bindless->materials)
+    backend->buffer_destroy(device, bindless->materials);
+  index_destroy(&bindless->texture_indices);
+  index_destroy(&bindless->material_indices);
+  free(bindless->texture_map.entries);
+  free(bindless->material_map.entries);
+  free(bindless->records);
+  free(bindless->dirty);
+  free(bindless->copies);
+  free(bindless->instances);
+  free(bindless->instance_map.entries);
+  memset(bindless, 0, sizeof(*bindless));
+}
@@ -0,0 +1,205 @@
+/**
+ * @file bindless.h
+ * @brief Internal bindless texture and material tables
+ *
+ * Not part of the public API. In bindless mode every sampled texture gets a
+ * slot in one backend texture table and every material a
+ * Candid_MaterialRecord in one storage buffer, both bound once per render
+ * pass. Draws then only select a material record, whose texture indices
+ * point into the texture table, so changing materials changes no bindings.
+ *
+ * Indices are assigned on the caller's thread, when resources are created.
+ * A released index may still be read by frames in flight, so it is retired
+ * to the owner's current frame slot and only reused when that slot comes
+ * around again (as with the geometry heap).
+ *
+ * The material table lives in GPU-only memory, with a CPU copy of every
+ * record. Creating or updating a material only repacks its record into the
+ * copy and marks it dirty; once per frame the dirty records are gathered
+ * into staging memory and copied over in coalesced ranges, ahead of the
+ * frame's render pass.
+ *
+ * A material instance gets its own record: its base's, with the overridden
+ * fields replaced. Only the overrides are kept, so updating the base
+ * repacks its instances too.
+ */
+
+#pragma once
+
+#include "upload.h"
+
+#include <candid/backend.h>
+#include <candid/renderer.h>
+
+#define CANDID_BINDLESS_DEFAULT_TEXTURES 16384
+#define CANDID_BINDLESS_DEFAULT_MATERIALS 65536
+
+/** Record 0 holds default factors, for materials outside the table */
+#define CANDID_BINDLESS_DEFAULT_MATERIAL 0
+
+/** Clean records up to this many between two dirty ones are uploaded with
+ * them rather than splitting the copy */
+#define CANDID_BINDLESS_UPLOAD_GAP 4
+
+/** Dense indices with per-slot retirement */
+typedef struct Candid_IndexAllocator {
+  uint32_t capacity;
+  uint32_t next; /**< Indices from here up have never been handed out */
+  uint32_t *free_indices;
+  uint32_t free_count;
+  uint32_t *retired[CANDID_MAX_UPLOAD_SLOTS];
+  uint32_t retired_count[CANDID_MAX_UPLOAD_SLOTS];
+  uint32_t retired_capacity[CANDID_MAX_UPLOAD_SLOTS];
+} Candid_IndexAllocator;
+
+typedef struct Candid_BindlessEntry {
+  const void *resource; /**< NULL for an empty slot */
+  uint32_t index;
+} Candid_BindlessEntry;
+
+/** Resource -> index, open addressing with linear probing */
+typedef struct Candid_BindlessMap {
+  Candid_BindlessEntry *entries;
+  uint32_t count;
+  uint32_t capacity; /**< Power of two */
+} Candid_BindlessMap;
+
+typedef struct Candid_BindlessInstance {
+  const Candid_Material *material;
+  uint32_t index; /**< Its record */
+  uint32_t base;  /**< The base material's record */
+  Candid_MaterialOverrides overrides;
+} Candid_BindlessInstance;
+
+/** Staging -> material table copy, in bytes */
+typedef struct Candid_BindlessCopy {
+  size_t source;
+  size_t destination;
+  size_t size;
+} Candid_BindlessCopy;
+
+typedef struct Candid_Bindless {
+  Candid_TextureTable *textures; /**< NULL when not bindless */
+  Candid_Buffer *materials;      /**< Candid_MaterialRecord array, GPU only */
+  Candid_IndexAllocator texture_indices;
+  Candid_IndexAllocator material_indices;
+  Candid_BindlessMap texture_map;
+  Candid_BindlessMap material_map;
+
+  /* CPU copy of the material table and the records not uploaded yet */
+  Candid_MaterialRecord *records;
+  uint64_t *dirty;      /**< One bit per record */
+  uint32_t dirty_first; /**< Bounds of the dirty bits, empty when equal */
+  uint32_t dirty_end;
+  Candid_BindlessCopy *copies;
+  uint32_t copy_capacity;
+
+  Candid_BindlessInstance *instances;
+  uint32_t instance_count;
+  uint32_t instance_capacity;
+  Candid_BindlessMap instance_map; /**< Material -> position in instances */
+} Candid_Bindless;
+
+/**
+ * Create the texture table and material buffer
+ * @param texture_capacity Table size (0 = default, at most 65535)
+ * @param material_capacity Record count (0 = default)
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result candid_bindless_init(Candid_Bindless *bindless,
+                                   const Candid_BackendInterface *backend,
+                                   Candid_Device *device,
+                                   uint32_t texture_capacity,
+                                   uint32_t material_capacity);
+
+/**
+ * Assign a texture table slot. The caller writes the table entry where the
+ * command buffer lives.
+ * @return The index, or CANDID_BINDLESS_INVALID_INDEX
+ */
+uint32_t candid_bindless_add_texture(Candid_Bindless *bindless,
+                                     const Candid_Texture *texture);
+
+/**
+ * Retire a texture's slot to frame slot `slot`
+ * @return The released index, or CANDID_BINDLESS_INVALID_INDEX
+ */
+uint32_t candid_bindless_remove_texture(Candid_Bindless *bindless,
+                                        const Candid_Texture *texture,
+                                        uint32_t slot);
+
+uint32_t candid_bindless_find_texture(const Candid_Bindless *bindless,
+                                      const Candid_Texture *texture);
+
+/**
+ * Pack the GPU-visible part of a material, resolving its textures to table
+ * indices (CANDID_MATERIAL_NO_TEXTURE when absent or not in the table)
+ */
+void candid_bindless_pack_material(const Candid_Bindless *bindless,
+                                   const Candid_MaterialDesc *desc,
+                                   Candid_MaterialRecord *out);
+
+/**
+ * Assign a record to a material and pack `desc` into it
+ * @return The index, or CANDID_BINDLESS_INVALID_INDEX
+ */
+uint32_t candid_bindless_add_material(Candid_Bindless *bindless,
+                                      const Candid_Material *material,
+                                      const Candid_MaterialDesc *desc);
+
+/**
+ * Assign a record to a material instance: the base's record with
+ * `overrides` applied
+ * @return The index, or CANDID_BINDLESS_INVALID_INDEX (also when the base
+ *         has no record)
+ */
+uint32_t
+candid_bindless_add_instance(Candid_Bindless *bindless,
+                             const Candid_Material *instance,
+                             const Candid_Material *base,
+                             const Candid_MaterialOverrides *overrides);
+
+/**
+ * Repack a material's record, and those of its instances. Only records
+ * whose contents changed are marked for upload.
+ * @return CANDID_SUCCESS, or CANDID_ERROR_INVALID_ARGUMENT when the material
+ *         has no record or is an instance
+ */
+Candid_Result candid_bindless_update_material(Candid_Bindless *bindless,
+                                              const Candid_Material *material,
+                                              const Candid_MaterialDesc *desc);
+
+/**
+ * Retire a material's (or instance's) record to frame slot `slot`
+ */
+void candid_bindless_remove_material(Candid_Bindless *bindless,
+                                     const Candid_Material *material,
+                                     uint32_t slot);
+
+uint32_t candid_bindless_find_material(const Candid_Bindless *bindless,
+                                       const Candid_Material *material);
+
+/**
+ * Stage the dirty records for upload, coalesced into ranges
+ * @param upload Frame allocator the staging memory is taken from
+ * @param out_staging Buffer the copies read from
+ * @param out_copies Valid until the next call
+ * @return Number of copies to record; 0 when clean or out of staging memory
+ *         (the records then stay dirty)
+ */
+uint32_t candid_bindless_stage_materials(
+    Candid_Bindless *bindless, const Candid_BackendInterface *backend,
+    Candid_Device *device, Candid_FrameUpload *upload,
+    Candid_Buffer **out_staging, const Candid_BindlessCopy **out_copies);
+
+/**
+ * Start a new frame in `slot`: make the indices retired to it reusable
+ */
+void candid_bindless_reset(Candid_Bindless *bindless, uint32_t slot);
+
+/**
+ * Release the tables. Must run once no frame in flight reads them.
+ */
+void candid_bindless_destroy(Candid_Bindless *bindless,
+                             const Candid_BackendInterface *backend,
+                             Candid_Device *device);
@@ -0,0 +1,146 @@
+/**
+ * @file builtin_shaders.c
+ * @brief Built-in shader programs created from embedded code
+ */
+
+#include "builtin_shaders.h"
+
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+
+/*******************************************************************************
+ * Creation
+ ******************************************************************************/
+
+#ifdef CANDID_BUILTIN_SHADERS
+
+static Candid_Result create_module(const Candid_BackendInterface *backend,
+                                   Candid_Device *device,
+                                   Candid_ShaderSourceType target,
+                                   Candid_ShaderStage stage,
+                                   const Candid_BuiltinStage *code,
+                                   Candid_ShaderModule **out) {
+  Candid_ShaderModuleDesc desc = {
+      .stage = stage,
+      .source_type = target,
+      .entry_point = code->entry_point,
+      .label = code->entry_point,
+  };
+  if (target == CANDID_SHADER_SOURCE_MSL) {
+    if (!code->msl)
+      return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+    desc.source = code->msl;
+    desc.source_size = code->msl_size;
+  } else {
+    if (!code->spirv)
+      return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+    desc.bytecode = code->spirv;
+    desc.bytecode_size = code->spirv_size;
+  }
+  return backend->shader_module_create(device, &desc, out);
+}
+
+static void release_program(const Candid_BackendInterface *backend,
+                            Candid_Device *device,
+                            Candid_BuiltinProgram *program) {
+  if (program->program)
+    backend->shader_program_destroy(device, program->program);
+  if (program->fragment)
+    backend->shader_module_destroy(device, program->fragment);
+  if (program->vertex)
+    backend->shader_module_destroy(device, program->vertex);
+  free(program);
+}
+
+static Candid_Result create_program(const Candid_BackendInterface *backend,
+                                    Candid_Device *device,
+                                    Candid_ShaderSourceType target,
+                                    const Candid_BuiltinShaderCode *code,
+                                    Candid_BuiltinProgram **out) {
+  Candid_BuiltinProgram *program = calloc(1, sizeof(Candid_BuiltinProgram));
+  if (!program)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  Candid_Result result =
+      create_module(backend, device, target, CANDID_SHADER_STAGE_VERTEX,
+                    &code->vertex, &program->vertex);
+  if (result == CANDID_SUCCESS)
+    result = create_module(backend, device, target,
+                           CANDID_SHADER_STAGE_FRAGMENT, &code->fragment,
+                           &program->fragment);
+  if (result == CANDID_SUCCESS) {
+    Candid_ShaderProgramDesc desc = {
+        .vertex = program->vertex,
+        .fragment = program->fragment,
+        .label = code->fragment.entry_point,
+    };
+    result = backend->shader_program_create(device, &desc, &program->program);
+  }
+
+  if (result != CANDID_SUCCESS) {
+    release_program(backend, device, program);
+    return result;
+  }
+  *out = program;
+  return CANDID_SUCCESS;
+}
+
+#endif /* CANDID_BUILTIN_SHADERS */
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+Candid_Result candid_builtin_shaders_get(Candid_BuiltinShaders *shaders,
+                                         const Candid_BackendInterface *backend,
+                                         Candid_Device *device,
+                                         Candid_ShaderSourceType target,
+                                         Candid_BuiltinShader shader,
+                                         Candid_ShaderProgram **out) {
+  if (!shaders || !backend || !out || (uint32_t)shader >= CANDID_SHADER_COUNT)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+#ifdef CANDID_BUILTIN_SHADERS
+  Candid_BuiltinProgram *program =
+      SDL_GetAtomicPointer(&shaders->programs[shader]);
+  if (!program) {
+    Candid_Result result =
+        create_program(backend, device, target,
+                       &candid_builtin_shader_code[shader], &program);
+    if (result != CANDID_SUCCESS)
+      return result;
+
+    /* Another thread may have created it meanwhile: keep the first */
+    if (!SDL_CompareAndSwapAtomicPointer(&shaders->programs[shader], NULL,
+                                         program)) {
+      release_program(backend, device, program);
+      program = SDL_GetAtomicPointer(&shaders->programs[shader]);
+    }
+  }
+
+  *out = program->program;
+  return CANDID_SUCCESS;
+#else
+  (void)device;
+  (void)target;
+  return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+#endif
+}
+
+void candid_builtin_shaders_destroy(Candid_BuiltinShaders *shaders,
+                                    const Candid_BackendInterface *backend,
+                                    Candid_Device *device) {
+  if (!shaders || !backend)
+    return;
+
+  for (uint32_t i = 0; i < CANDID_SHADER_COUNT; ++i) {
+    Candid_BuiltinProgram *program = shaders->programs[i];
+    if (!program)
+      continue;
+    backend->shader_program_destroy(device, program->program);
+    backend->shader_module_destroy(device, program->fragment);
+    backend->shader_module_destroy(device, program->vertex);
+    free(program);
+    shaders->programs[i] = NULL;
+  }
+}
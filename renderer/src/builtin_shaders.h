@@ -0,0 +1,74 @@
+/**
+ * @file builtin_shaders.h
+ * @brief Internal built-in shader library
+ *
+ * Not part of the public API. The built-in shaders (Candid_BuiltinShader)
+ * are compiled from renderer/shaders when the library is built and
+ * embedded as constant arrays (cmake/EmbedShaders.cmake), so no shader
+ * compiler ever runs for them at startup. Programs are created from the
+ * embedded code the first time each one is requested.
+ *
+ * The compute kernels (Candid_ComputeKernel) are embedded the same way, as
+ * SPIR-V only, for backends to create in get_compute_kernel.
+ *
+ * Without DXC at build time (CANDID_BUILTIN_SHADERS undefined) the library
+ * is empty and every request fails with CANDID_ERROR_BACKEND_NOT_SUPPORTED.
+ */
+
+#pragma once
+
+#include <candid/backend.h>
+
+typedef struct Candid_BuiltinStage {
+  const char *entry_point;
+  const uint32_t *spirv;
+  size_t spirv_size; /**< Bytes */
+  const char *msl;   /**< NULL when not cross-compiled (non-Apple builds) */
+  size_t msl_size;
+} Candid_BuiltinStage;
+
+typedef struct Candid_BuiltinShaderCode {
+  Candid_BuiltinStage vertex; /**< No code for shaders left out of the build */
+  Candid_BuiltinStage fragment;
+} Candid_BuiltinShaderCode;
+
+#ifdef CANDID_BUILTIN_SHADERS
+/** Generated at build time */
+extern const Candid_BuiltinShaderCode
+    candid_builtin_shader_code[CANDID_SHADER_COUNT];
+extern const Candid_BuiltinStage
+    candid_builtin_kernel_code[CANDID_COMPUTE_KERNEL_COUNT];
+#endif
+
+typedef struct Candid_BuiltinProgram {
+  Candid_ShaderProgram *program;
+  Candid_ShaderModule *vertex;
+  Candid_ShaderModule *fragment;
+} Candid_BuiltinProgram;
+
+typedef struct Candid_BuiltinShaders {
+  /** Candid_BuiltinProgram, published once with an atomic swap */
+  void *programs[CANDID_SHADER_COUNT];
+} Candid_BuiltinShaders;
+
+/**
+ * Get a built-in program, creating it on first use. Safe to call from any
+ * thread; threads racing on the same shader all get the same program.
+ * @param target Code the backend consumes (SPIRV or MSL)
+ * @return CANDID_SUCCESS, or CANDID_ERROR_BACKEND_NOT_SUPPORTED when the
+ *         shader was not built for `target`
+ */
+Candid_Result candid_builtin_shaders_get(Candid_BuiltinShaders *shaders,
+                                         const Candid_BackendInterface *backend,
+                                         Candid_Device *device,
+                                         Candid_ShaderSourceType target,
+                                         Candid_BuiltinShader shader,
+                                         Candid_ShaderProgram **out);
+
+/**
+ * Release the programs created so far. Must run once no frame in flight
+ * uses them.
+ */
+void candid_builtin_shaders_destroy(Candid_BuiltinShaders *shaders,
+                                    const Candid_BackendInterface *backend,
+                                    Candid_Device *device);
@@ -0,0 +1,35 @@
+/**
+ * @file culling.c
+ * @brief Frustum helpers shared by CPU and GPU culling
+ */
+
+#include <candid/culling.h>
+#include <math.h>
+
+void candid_frustum_planes(const Candid_Mat4 *view_projection,
+                           Candid_Vec4 out[6]) {
+  if (!view_projection || !out)
+    return;
+
+  /* Gribb-Hartmann: planes are sums of the matrix rows. Row r is
+   * (m[r], m[4 + r], m[8 + r], m[12 + r]) in column-major storage. The near
+   * plane uses the -w <= z clip range, which is merely conservative for
+   * projections targeting [0, 1] depth. */
+  const float *m = view_projection->m;
+  for (int i = 0; i < 6; ++i) {
+    int row = i / 2;
+    float sign = (i & 1) ? -1.0f : 1.0f;
+    Candid_Vec4 plane = {
+        m[3] + sign * m[row],
+        m[7] + sign * m[4 + row],
+        m[11] + sign * m[8 + row],
+        m[15] + sign * m[12 + row],
+    };
+
+    float length = sqrtf(plane.x * plane.x + plane.y * plane.y +
+                         plane.z * plane.z);
+    float inv = length > 0.0f ? 1.0f / length : 0.0f;
+    out[i] = (Candid_Vec4){plane.x * inv, plane.y * inv, plane.z * inv,
+                           plane.w * inv};
+  }
+}
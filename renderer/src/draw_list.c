@@ -0,0 +1,677 @@
+/**
+ * @file draw_list.c
+ * @brief Draw list recording and end-of-frame merge
+ */
+
+#include "draw_merge.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGNMENT 16u
+#define ARENA_CHUNK_SIZE (64u * 1024u)
+#define PARALLEL_MIN_DRAWS 2048u
+#define PARALLEL_DRAWS_PER_CHUNK 1024u
+#define BATCH_MIN_DRAWS 2u
+
+/*******************************************************************************
+ * Arena
+ ******************************************************************************/
+
+/* Chunks are kept across frames: after warm-up, recording allocates nothing */
+typedef struct Candid_ArenaChunk {
+  struct Candid_ArenaChunk *next;
+  size_t capacity;
+  size_t used;
+} Candid_ArenaChunk;
+
+typedef struct Candid_Arena {
+  Candid_ArenaChunk *first;
+  Candid_ArenaChunk *current;
+} Candid_Arena;
+
+#define ARENA_HEADER_SIZE                                                      \
+  ((sizeof(Candid_ArenaChunk) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+static void *arena_alloc(Candid_Arena *arena, size_t size) {
+  size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+  Candid_ArenaChunk *chunk = arena->current;
+  while (chunk && chunk->used + size > chunk->capacity) {
+    chunk = chunk->next;
+    if (chunk)
+      chunk->used = 0;
+  }
+
+  if (!chunk) {
+    size_t capacity = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    chunk = malloc(ARENA_HEADER_SIZE + capacity);
+    if (!chunk)
+      return NULL;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+
+    /* Insert after the current chunk so later (reset) chunks stay reachable */
+    if (arena->current) {
+      chunk->next = arena->current->next;
+      arena->current->next = chunk;
+    } else {
+      chunk->next = arena->first;
+      arena->first = chunk;
+    }
+  }
+
+  arena->current = chunk;
+  void *ptr = (uint8_t *)chunk + ARENA_HEADER_SIZE + chunk->used;
+  chunk->used += size;
+  return ptr;
+}
+
+static void arena_reset(Candid_Arena *arena) {
+  arena->current = arena->first;
+  if (arena->current)
+    arena->current->used = 0;
+}
+
+static void arena_destroy(Candid_Arena *arena) {
+  Candid_ArenaChunk *chunk = arena->first;
+  while (chunk) {
+    Candid_ArenaChunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  arena->first = arena->current = NULL;
+}
+
+/*******************************************************************************
+ * Draw List
+ ******************************************************************************/
+
+typedef struct Candid_DrawListFrame {
+  Candid_Arena arena;
+  Candid_DrawKey *keys;
+  uint32_t count;
+  uint32_t capacity;
+  Candid_FrameUpload upload;
+} Candid_DrawListFrame;
+
+struct Candid_DrawList {
+  const Candid_BackendInterface *backend;
+  Candid_Device *device;
+  uint32_t slot_count;
+  uint32_t slot; /**< Frame being recorded */
+  bool taken;    /**< Current frame already handed to the renderer */
+  bool indirect; /**< The device reports supports_indirect_draw */
+  uint8_t layer;
+  Candid_DrawListFrame frames[CANDID_MAX_UPLOAD_SLOTS];
+};
+
+static uint64_t hash_pointer(const void *ptr, unsigned bits) {
+  uint64_t value = (uint64_t)(uintptr_t)ptr;
+  return (value * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+/* layer (8) | base material (20) | material (12) | mesh (24): groups draws
+ * by pipeline state, instances of a material next to it */
+static uint64_t make_key(const Candid_DrawList *list,
+                         Candid_Material *material, const Candid_Mesh *mesh) {
+  Candid_Material *base = material && list->backend->material_get_base
+                              ? list->backend->material_get_base(material)
+                              : material;
+  return ((uint64_t)list->layer << 56) | (hash_pointer(base, 20) << 36) |
+         (hash_pointer(material, 12) << 24) | hash_pointer(mesh, 24);
+}
+
+static Candid_DrawItem *push_item(Candid_DrawList *list, Candid_Mesh *mesh,
+                                  Candid_Material *material) {
+  Candid_DrawListFrame *frame = &list->frames[list->slot];
+
+  if (frame->count == frame->capacity) {
+    uint32_t capacity = frame->capacity ? frame->capacity * 2 : 256;
+    Candid_DrawKey *keys =
+        realloc(frame->keys, capacity * sizeof(Candid_DrawKey));
+    if (!keys)
+      return NULL;
+    frame->keys = keys;
+    frame->capacity = capacity;
+  }
+
+  Candid_DrawItem *item = arena_alloc(&frame->arena, sizeof(Candid_DrawItem));
+  if (!item)
+    return NULL;
+
+  memset(item, 0, offsetof(Candid_DrawItem, transform));
+  item->mesh = mesh;
+  item->material = material;
+  frame->keys[frame->count++] =
+      (Candid_DrawKey){make_key(list, material, mesh), item};
+  return item;
+}
+
+Candid_Result candid_draw_list_create(const Candid_BackendInterface *backend,
+                                      Candid_Device *device,
+                                      uint32_t slot_count,
+                                      Candid_DrawList **out) {
+  if (!backend || !out || slot_count == 0 ||
+      slot_count > CANDID_MAX_UPLOAD_SLOTS)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_DrawList *list = calloc(1, sizeof(Candid_DrawList));
+  if (!list)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  list->backend = backend;
+  list->device = device;
+  list->slot_count = slot_count;
+  Candid_DeviceLimits limits = {0};
+  list->indirect = backend->device_get_limits &&
+                   backend->device_get_limits(device, &limits) ==
+                       CANDID_SUCCESS &&
+                   limits.supports_indirect_draw;
+
+  *out = list;
+  return CANDID_SUCCESS;
+}
+
+void candid_draw_list_destroy(Candid_DrawList *list) {
+  if (!list)
+    return;
+
+  for (uint32_t i = 0; i < CANDID_MAX_UPLOAD_SLOTS; ++i) {
+    Candid_DrawListFrame *frame = &list->frames[i];
+    arena_destroy(&frame->arena);
+    free(frame->keys);
+    candid_upload_destroy(list->backend, list->device, &frame->upload);
+  }
+
+  free(list);
+}
+
+bool candid_draw_list_take(Candid_DrawList *list, Candid_DrawListRef *out) {
+  if (!list || list->taken || list->frames[list->slot].count == 0)
+    return false;
+
+  out->list = list;
+  out->slot = list->slot;
+  list->taken = true;
+  list->slot = (list->slot + 1) % list->slot_count;
+  return true;
+}
+
+void candid_draw_list_begin(Candid_DrawList *list) {
+  if (!list)
+    return;
+
+  Candid_DrawListFrame *frame = &list->frames[list->slot];
+  arena_reset(&frame->arena);
+  frame->count = 0;
+  candid_upload_reset(list->backend, list->device, &frame->upload);
+  list->taken = false;
+  list->layer = 0;
+}
+
+void candid_draw_list_set_layer(Candid_DrawList *list, uint8_t layer) {
+  if (!list)
+    return;
+  list->layer = layer;
+}
+
+void candid_draw_list_draw_mesh(Candid_DrawList *list, Candid_Mesh *mesh,
+                                Candid_Material *material,
+                                const Candid_Mat4 *transform) {
+  if (!list || list->taken || !mesh)
+    return;
+
+  Candid_DrawItem *item = push_item(list, mesh, material);
+  if (!item)
+    return;
+  item->has_transform = transform != NULL;
+  if (transform)
+    item->transform = *transform;
+}
+
+void candid_draw_list_draw_mesh_instanced_compact(
+    Candid_DrawList *list, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, const void *instances,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization) {
+  if (!list || list->taken || !mesh || !instances || instance_count == 0)
+    return;
+
+  size_t stride = candid_instance_format_size(format);
+  if (stride == 0 ||
+      (format == CANDID_INSTANCE_FORMAT_QUANTIZED && !quantization))
+    return;
+
+  Candid_Buffer *buffer = NULL;
+  size_t offset = 0;
+  void *data = NULL;
+  size_t size = stride * instance_count;
+  if (candid_upload_alloc(list->backend, list->device,
+                          &list->frames[list->slot].upload, size, &buffer,
+                          &offset, &data) != CANDID_SUCCESS)
+    return;
+  memcpy(data, instances, size);
+
+  candid_draw_list_draw_mesh_instanced_buffer(list, mesh, material, format,
+                                              buffer, offset, instance_count,
+                                              quantization);
+}
+
+void candid_draw_list_draw_mesh_instanced_buffer(
+    Candid_DrawList *list, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, Candid_Buffer *buffer, size_t offset,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization) {
+  if (!list || list->taken || !mesh || !buffer || instance_count == 0)
+    return;
+  if (format >= CANDID_INSTANCE_FORMAT_COUNT ||
+      (format == CANDID_INSTANCE_FORMAT_QUANTIZED && !quantization))
+    return;
+
+  Candid_InstanceQuantization *params = NULL;
+  if (quantization) {
+    params = arena_alloc(&list->frames[list->slot].arena, sizeof(*params));
+    if (!params)
+      return;
+    *params = *quantization;
+  }
+
+  Candid_DrawItem *item = push_item(list, mesh, material);
+  if (!item)
+    return;
+  item->instances = buffer;
+  item->instance_offset = offset;
+  item->instance_count = instance_count;
+  item->format = format;
+  item->quantization = params;
+}
+
+void candid_draw_list_draw_mesh_indirect(Candid_DrawList *list,
+                                         Candid_Mesh *mesh,
+                                         Candid_Material *material,
+                                         const Candid_IndirectDraw *draw) {
+  if (!list || list->taken || !list->indirect || !mesh || !draw ||
+      !draw->args || !draw->instances || draw->max_draw_count == 0)
+    return;
+  if (draw->format >= CANDID_INSTANCE_FORMAT_COUNT ||
+      (draw->format == CANDID_INSTANCE_FORMAT_QUANTIZED &&
+       !draw->quantization))
+    return;
+
+  Candid_InstanceQuantization *params = NULL;
+  if (draw->quantization) {
+    params = arena_alloc(&list->frames[list->slot].arena, sizeof(*params));
+    if (!params)
+      return;
+    *params = *draw->quantization;
+  }
+
+  Candid_DrawItem *item = push_item(list, mesh, material);
+  if (!item)
+    return;
+  item->instances = draw->instances;
+  item->instance_offset = draw->instance_offset;
+  item->format = draw->format;
+  item->quantization = params;
+  item->indirect = draw->args;
+  item->indirect_offset = draw->args_offset;
+  item->draw_count = draw->max_draw_count;
+  item->draw_count_buffer = draw->count;
+  item->draw_count_offset = draw->count_offset;
+}
+
+uint32_t candid_draw_list_get_count(const Candid_DrawList *list) {
+  return list ? list->frames[list->slot].count : 0;
+}
+
+/*******************************************************************************
+ * Merge
+ ******************************************************************************/
+
+/**
+ * Stable LSD radix sort on 8-bit digits; digits shared by every key (e.g.
+ * the layer byte in most frames) are skipped.
+ */
+static Candid_DrawKey *sort_keys(Candid_DrawKey *keys, Candid_DrawKey *scratch,
+                                 uint32_t count) {
+  uint32_t histograms[8][256];
+  memset(histograms, 0, sizeof(histograms));
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t key = keys[i].key;
+    for (unsigned d = 0; d < 8; ++d)
+      histograms[d][(key >> (d * 8)) & 0xFF]++;
+  }
+
+  Candid_DrawKey *src = keys;
+  Candid_DrawKey *dst = scratch;
+  for (unsigned d = 0; d < 8; ++d) {
+    uint32_t *histogram = histograms[d];
+    if (histogram[(src[0].key >> (d * 8)) & 0xFF] == count)
+      continue;
+
+    uint32_t sum = 0;
+    for (unsigned b = 0; b < 256; ++b) {
+      uint32_t n = histogram[b];
+      histogram[b] = sum;
+      sum += n;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+      dst[histogram[(src[i].key >> (d * 8)) & 0xFF]++] = src[i];
+
+    Candid_DrawKey *swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  return src;
+}
+
+static void record_range(const Candid_BackendInterface *backend,
+                         Candid_CommandBuffer *cmd, const Candid_DrawKey *keys,
+                         uint32_t begin, uint32_t end) {
+  for (uint32_t i = begin; i < end; ++i) {
+    const Candid_DrawItem *item = keys[i].item;
+    if (item->indirect) {
+      Candid_IndirectDraw draw = {
+          .args = item->indirect,
+          .args_offset = item->indirect_offset,
+          .max_draw_count = item->draw_count,
+          .count = item->draw_count_buffer,
+          .count_offset = item->draw_count_offset,
+          .format = item->format,
+          .instances = item->instances,
+          .instance_offset = item->instance_offset,
+          .quantization = item->quantization,
+      };
+      backend->cmd_draw_mesh_indirect(cmd, item->mesh, item->material, &draw);
+    } else if (item->instances) {
+      backend->cmd_draw_mesh_instanced(cmd, item->mesh, item->material,
+                                       item->format, item->instances,
+                                       item->instance_offset,
+                                       item->instance_count,
+                                       item->quantization);
+    } else {
+      backend->cmd_draw_mesh(cmd, item->mesh, item->material,
+                             item->has_transform ? &item->transform : NULL);
+    }
+  }
+}
+
+/*******************************************************************************
+ * Batching
+ ******************************************************************************/
+
+static bool is_single_draw(const Candid_DrawItem *item) {
+  return !item->instances && !item->indirect;
+}
+
+/**
+ * Write one multi-draw for keys[0..count): every transform becomes a MAT4
+ * instance record, every run of one mesh an indirect record
+ * @return The batch item, or NULL if upload memory ran out
+ */
+static const Candid_DrawItem *
+emit_batch(Candid_DrawMerge *merge, uint32_t *batch_count,
+           const Candid_BackendInterface *backend, Candid_Device *device,
+           Candid_FrameUpload *upload, const Candid_DrawKey *keys,
+           uint32_t count) {
+  uint32_t record_count = 1;
+  for (uint32_t i = 1; i < count; ++i) {
+    if (keys[i].item->mesh != keys[i - 1].item->mesh)
+      record_count++;
+  }
+
+  Candid_Buffer *instances = NULL;
+  Candid_Buffer *args = NULL;
+  size_t instance_offset = 0;
+  size_t args_offset = 0;
+  void *instance_data = NULL;
+  void *args_data = NULL;
+  if (candid_upload_alloc(backend, device, upload,
+                          count * sizeof(Candid_Mat4), &instances,
+                          &instance_offset, &instance_data) != CANDID_SUCCESS ||
+      candid_upload_alloc(
+          backend, device, upload,
+          record_count * sizeof(Candid_DrawIndexedIndirectCommand), &args,
+          &args_offset, &args_data) != CANDID_SUCCESS)
+    return NULL;
+
+  static const Candid_Mat4 identity = {
+      {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+       0.0f, 0.0f, 0.0f, 1.0f}};
+
+  Candid_Mat4 *transforms = instance_data;
+  Candid_DrawIndexedIndirectCommand *record =
+      (Candid_DrawIndexedIndirectCommand *)args_data - 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    const Candid_DrawItem *item = keys[i].item;
+    if (i == 0 || item->mesh != keys[i - 1].item->mesh) {
+      Candid_MeshDrawInfo info;
+      backend->mesh_get_draw_info(item->mesh, &info);
+      *++record = (Candid_DrawIndexedIndirectCommand){
+          .index_count = info.index_count,
+          .instance_count = 0,
+          .first_index = info.first_index,
+          .vertex_offset = info.vertex_offset,
+          .first_instance = i,
+      };
+    }
+    record->instance_count++;
+    transforms[i] = item->has_transform ? item->transform : identity;
+  }
+
+  Candid_DrawItem *batch = &merge->batches[(*batch_count)++];
+  memset(batch, 0, offsetof(Candid_DrawItem, transform));
+  batch->mesh = keys[0].item->mesh;
+  batch->material = keys[0].item->material;
+  batch->instances = instances;
+  batch->instance_offset = instance_offset;
+  batch->instance_count = count;
+  batch->format = CANDID_INSTANCE_FORMAT_MAT4;
+  batch->indirect = args;
+  batch->indirect_offset = args_offset;
+  batch->draw_count = record_count;
+  return batch;
+}
+
+/**
+ * Replace each run of single draws sharing layer, material and geometry with
+ * one multi-draw, compacting `keys` in place
+ * @return Number of keys left
+ */
+static uint32_t batch_draws(Candid_DrawMerge *merge,
+                            const Candid_BackendInterface *backend,
+                            Candid_Device *device, Candid_FrameUpload *upload,
+                            Candid_DrawKey *keys, uint32_t count) {
+  if (!merge->indirect || !backend->cmd_draw_mesh_indirect ||
+      !backend->mesh_get_draw_info)
+    return count;
+
+  uint32_t batch_count = 0;
+  uint32_t out = 0;
+  uint32_t begin = 0;
+  while (begin < count) {
+    const Candid_DrawItem *first = keys[begin].item;
+    uint32_t end = begin + 1;
+
+    if (is_single_draw(first)) {
+      Candid_MeshDrawInfo info;
+      backend->mesh_get_draw_info(first->mesh, &info);
+      const void *geometry = info.geometry;
+
+      for (; end < count; ++end) {
+        const Candid_DrawItem *item = keys[end].item;
+        if (!is_single_draw(item) || item->material != first->material ||
+            (keys[end].key >> 56) != (keys[begin].key >> 56))
+          break;
+        if (item->mesh != keys[end - 1].item->mesh) {
+          backend->mesh_get_draw_info(item->mesh, &info);
+          if (info.geometry != geometry)
+            break;
+        }
+      }
+    }
+
+    const Candid_DrawItem *batch = NULL;
+    if (end - begin >= BATCH_MIN_DRAWS)
+      batch = emit_batch(merge, &batch_count, backend, device, upload,
+                         keys + begin, end - begin);
+
+    if (batch) {
+      keys[out++] = (Candid_DrawKey){keys[begin].key, batch};
+    } else {
+      memmove(keys + out, keys + begin,
+              (end - begin) * sizeof(Candid_DrawKey));
+      out += end - begin;
+    }
+    begin = end;
+  }
+
+  return out;
+}
+
+/*******************************************************************************
+ * Recording
+ ******************************************************************************/
+
+typedef struct Candid_RecordJob {
+  const Candid_BackendInterface *backend;
+  const Candid_DrawKey *keys;
+  uint32_t count;
+  uint32_t chunk_count;
+  Candid_CommandBuffer **secondaries;
+} Candid_RecordJob;
+
+static void record_chunks(void *user_data, uint32_t begin, uint32_t end) {
+  const Candid_RecordJob *job = user_data;
+
+  for (uint32_t chunk = begin; chunk < end; ++chunk) {
+    uint32_t first = (uint32_t)((uint64_t)job->count * chunk /
+                                job->chunk_count);
+    uint32_t last = (uint32_t)((uint64_t)job->count * (chunk + 1) /
+                               job->chunk_count);
+    Candid_CommandBuffer *secondary = job->secondaries[chunk];
+
+    /* Secondaries start with the primary's pipeline */
+    record_range(job->backend, secondary, job->keys, first, last);
+    job->backend->cmd_end_secondary(secondary);
+  }
+}
+
+/**
+ * Record sorted draws on worker threads, one secondary per chunk
+ * @return false if secondaries could not be created (nothing was recorded)
+ */
+static bool record_parallel(const Candid_BackendInterface *backend,
+                            Candid_CommandBuffer *cmd, Candid_JobSystem *jobs,
+                            const Candid_DrawKey *keys, uint32_t count) {
+  uint32_t threads = candid_jobs_get_worker_count(jobs) + 1;
+  if (!backend->cmd_begin_secondary || threads < 2 ||
+      count < PARALLEL_MIN_DRAWS)
+    return false;
+
+  uint32_t chunk_count = count / PARALLEL_DRAWS_PER_CHUNK;
+  if (chunk_count > threads)
+    chunk_count = threads;
+  if (chunk_count > CANDID_MAX_SECONDARY_COMMAND_BUFFERS)
+    chunk_count = CANDID_MAX_SECONDARY_COMMAND_BUFFERS;
+
+  /* Begin every secondary up front so a failure leaves nothing recorded */
+  Candid_CommandBuffer *secondaries[CANDID_MAX_SECONDARY_COMMAND_BUFFERS];
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    if (backend->cmd_begin_secondary(cmd, i, &secondaries[i]) !=
+        CANDID_SUCCESS) {
+      for (uint32_t j = 0; j < i; ++j)
+        backend->cmd_end_secondary(secondaries[j]);
+      backend->cmd_execute_secondary(cmd, secondaries, i);
+      return false;
+    }
+  }
+
+  Candid_RecordJob job = {
+      .backend = backend,
+      .keys = keys,
+      .count = count,
+      .chunk_count = chunk_count,
+      .secondaries = secondaries,
+  };
+  candid_jobs_parallel_for(jobs, chunk_count, 1, record_chunks, &job);
+
+  backend->cmd_execute_secondary(cmd, secondaries, chunk_count);
+  return true;
+}
+
+void candid_draw_merge_execute(Candid_DrawMerge *merge,
+                               const Candid_BackendInterface *backend,
+                               Candid_Device *device,
+                               Candid_CommandBuffer *cmd,
+                               Candid_JobSystem *jobs, uint32_t upload_slot,
+                               const Candid_DrawListRef *refs,
+                               uint32_t ref_count) {
+  if (!merge || !backend || !cmd || !refs ||
+      upload_slot >= CANDID_MAX_UPLOAD_SLOTS)
+    return;
+
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < ref_count; ++i)
+    total += refs[i].list->frames[refs[i].slot].count;
+  if (total == 0)
+    return;
+
+  if (total > merge->capacity) {
+    uint32_t capacity = merge->capacity ? merge->capacity : 1024;
+    while (capacity < total)
+      capacity *= 2;
+    Candid_DrawKey *keys = malloc(capacity * sizeof(Candid_DrawKey));
+    Candid_DrawKey *scratch = malloc(capacity * sizeof(Candid_DrawKey));
+    Candid_DrawItem *batches =
+        malloc(capacity / BATCH_MIN_DRAWS * sizeof(Candid_DrawItem));
+    if (!keys || !scratch || !batches) {
+      free(keys);
+      free(scratch);
+      free(batches);
+      return;
+    }
+    free(merge->keys);
+    free(merge->scratch);
+    free(merge->batches);
+    merge->keys = keys;
+    merge->scratch = scratch;
+    merge->batches = batches;
+    merge->capacity = capacity;
+  }
+
+  /* Gather in submission order; the stable sort keeps it for equal keys */
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < ref_count; ++i) {
+    const Candid_DrawListFrame *frame = &refs[i].list->frames[refs[i].slot];
+    memcpy(merge->keys + offset, frame->keys,
+           frame->count * sizeof(Candid_DrawKey));
+    offset += frame->count;
+  }
+
+  Candid_DrawKey *sorted = sort_keys(merge->keys, merge->scratch, total);
+
+  /* The GPU is done with this slot's previous frame */
+  Candid_FrameUpload *upload = &merge->uploads[upload_slot];
+  candid_upload_reset(backend, device, upload);
+  uint32_t count =
+      batch_draws(merge, backend, device, upload, sorted, total);
+
+  if (!record_parallel(backend, cmd, jobs, sorted, count))
+    record_range(backend, cmd, sorted, 0, count);
+}
+
+void candid_draw_merge_destroy(Candid_DrawMerge *merge,
+                               const Candid_BackendInterface *backend,
+                               Candid_Device *device) {
+  if (!merge)
+    return;
+  free(merge->keys);
+  free(merge->scratch);
+  free(merge->batches);
+  if (backend) {
+    for (uint32_t i = 0; i < CANDID_MAX_UPLOAD_SLOTS; ++i)
+      candid_upload_destroy(backend, device, &merge->uploads[i]);
+  }
+  memset(merge, 0, sizeof(*merge));
+}
@@ -0,0 +1,93 @@
+/**
+ * @file draw_merge.h
+ * @brief Internal draw list lifecycle and end-of-frame merge
+ *
+ * Not part of the public API. A draw list keeps one frame of storage per
+ * upload slot: the slot being recorded, and slots handed to the renderer
+ * whose draws may still be executing (on the render thread) or read by the
+ * GPU (instance uploads).
+ */
+
+#pragma once
+
+#include "jobs.h"
+#include "upload.h"
+
+#include <candid/draw_list.h>
+
+typedef struct Candid_DrawItem {
+  Candid_Mesh *mesh;
+  Candid_Material *material;
+  Candid_Buffer *instances; /**< NULL for a single draw */
+  size_t instance_offset;
+  uint32_t instance_count;
+  Candid_InstanceFormat format;
+  bool has_transform;
+  const Candid_InstanceQuantization *quantization;
+  Candid_Buffer *indirect; /**< Non-NULL for a multi-draw */
+  size_t indirect_offset;
+  uint32_t draw_count; /**< Maximum draw count of a multi-draw */
+  Candid_Buffer *draw_count_buffer;
+  size_t draw_count_offset;
+  Candid_Mat4 transform;
+} Candid_DrawItem;
+
+typedef struct Candid_DrawKey {
+  uint64_t key;
+  const Candid_DrawItem *item;
+} Candid_DrawKey;
+
+/** One frame of a list, as submitted to the renderer */
+typedef struct Candid_DrawListRef {
+  Candid_DrawList *list;
+  uint32_t slot;
+} Candid_DrawListRef;
+
+/**
+ * Scratch memory reused by every merge. Runs of single draws sharing
+ * material and geometry are rewritten into multi-draws whose instance and
+ * indirect records live in the merge's own per-slot uploads.
+ */
+typedef struct Candid_DrawMerge {
+  Candid_DrawKey *keys;
+  Candid_DrawKey *scratch;
+  Candid_DrawItem *batches;
+  uint32_t capacity;
+  bool indirect; /**< Runs may become multi-draws (supports_indirect_draw) */
+  Candid_FrameUpload uploads[CANDID_MAX_UPLOAD_SLOTS];
+} Candid_DrawMerge;
+
+/**
+ * Create a draw list
+ * @param slot_count Frame slots to rotate through (<= CANDID_MAX_UPLOAD_SLOTS)
+ */
+Candid_Result candid_draw_list_create(const Candid_BackendInterface *backend,
+                                      Candid_Device *device,
+                                      uint32_t slot_count,
+                                      Candid_DrawList **out);
+
+void candid_draw_list_destroy(Candid_DrawList *list);
+
+/**
+ * Hand the recorded frame over for merging and move recording to the next
+ * slot. Fails if the list is empty or was already taken since its last begin.
+ */
+bool candid_draw_list_take(Candid_DrawList *list, Candid_DrawListRef *out);
+
+/**
+ * Merge, sort and record the referenced frames into `cmd`, which must be
+ * inside a render pass. Uses secondary command buffers on the job system's
+ * workers when the backend supports them and the merge is large enough.
+ * @param upload_slot Frame slot whose merge upload is reset and reused
+ */
+void candid_draw_merge_execute(Candid_DrawMerge *merge,
+                               const Candid_BackendInterface *backend,
+                               Candid_Device *device,
+                               Candid_CommandBuffer *cmd,
+                               Candid_JobSystem *jobs, uint32_t upload_slot,
+                               const Candid_DrawListRef *refs,
+                               uint32_t ref_count);
+
+void candid_draw_merge_destroy(Candid_DrawMerge *merge,
+                               const Candid_BackendInterface *backend,
+                               Candid_Device *device);
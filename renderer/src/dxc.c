@@ -0,0 +1,476 @@
+/**
+ * @file dxc.c
+ * @brief In-process DXC compiler through its COM interfaces
+ *
+ * Only the interface methods used here are declared, in vtable order. Off
+ * Windows, DXC's IUnknown has a virtual destructor, which takes two vtable
+ * entries (Itanium ABI) after Release.
+ */
+
+#include "dxc.h"
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#ifdef _WIN32
+#define DXC_CALL __stdcall
+#define DXC_LIBRARY_NAME "dxcompiler.dll"
+#elif defined(__APPLE__)
+#define DXC_CALL
+#define DXC_LIBRARY_NAME "libdxcompiler.dylib"
+#else
+#define DXC_CALL
+#define DXC_LIBRARY_NAME "libdxcompiler.so"
+#endif
+
+#define DXC_S_OK 0
+#define DXC_E_FAIL ((int32_t)0x80004005)
+#define DXC_E_NOINTERFACE ((int32_t)0x80004002)
+#define DXC_CP_UTF8 65001u
+#define DXC_OUT_OBJECT 1
+
+/*******************************************************************************
+ * COM Declarations
+ ******************************************************************************/
+
+typedef int32_t DxcHResult;
+
+typedef struct DxcGuid {
+  uint32_t data1;
+  uint16_t data2;
+  uint16_t data3;
+  uint8_t data4[8];
+} DxcGuid;
+
+static const DxcGuid CLSID_DxcCompiler = {
+    0x73e22d93, 0xe6ce, 0x47f3,
+    {0xb5, 0xbf, 0xf0, 0x66, 0x4f, 0x39, 0xc1, 0xb0}};
+static const DxcGuid CLSID_DxcUtils = {
+    0x6245d6af, 0x66e0, 0x48fd,
+    {0x80, 0xb4, 0x4d, 0x27, 0x17, 0x96, 0x74, 0x8c}};
+static const DxcGuid IID_IUnknown = {
+    0x00000000, 0x0000, 0x0000,
+    {0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46}};
+static const DxcGuid IID_IDxcCompiler3 = {
+    0x228b4687, 0x5a6a, 0x4730,
+    {0x90, 0x0c, 0x97, 0x02, 0xb2, 0x20, 0x3f, 0x54}};
+static const DxcGuid IID_IDxcUtils = {
+    0x4605c4cb, 0x2019, 0x492a,
+    {0xad, 0xa4, 0x65, 0xf2, 0x0b, 0xb7, 0xd6, 0x7f}};
+static const DxcGuid IID_IDxcResult = {
+    0x58346cda, 0xdde7, 0x4497,
+    {0x94, 0x61, 0x6f, 0x87, 0xaf, 0x5e, 0x06, 0x59}};
+static const DxcGuid IID_IDxcBlob = {
+    0x8ba5fb08, 0x5195, 0x40e2,
+    {0xac, 0x58, 0x0d, 0x98, 0x9c, 0x3a, 0x01, 0x02}};
+static const DxcGuid IID_IDxcIncludeHandler = {
+    0x7f61fc7d, 0x950d, 0x467f,
+    {0xb3, 0xe3, 0x3c, 0x02, 0xfb, 0x49, 0x18, 0x7c}};
+static const DxcGuid IID_IDxcVersionInfo = {
+    0xb04f5b50, 0x2059, 0x4f12,
+    {0xa8, 0xff, 0xa1, 0xe0, 0xcd, 0xe1, 0xcc, 0x7e}};
+
+#ifdef _WIN32
+#define DXC_UNKNOWN_METHODS(T)                                                 \
+  DxcHResult(DXC_CALL *QueryInterface)(T * self, const DxcGuid *iid,           \
+                                       void **out);                            \
+  uint32_t(DXC_CALL *AddRef)(T * self);                                        \
+  uint32_t(DXC_CALL *Release)(T * self);
+#else
+#define DXC_UNKNOWN_METHODS(T)                                                 \
+  DxcHResult(DXC_CALL *QueryInterface)(T * self, const DxcGuid *iid,           \
+                                       void **out);                            \
+  uint32_t(DXC_CALL *AddRef)(T * self);                                        \
+  uint32_t(DXC_CALL *Release)(T * self);                                       \
+  void (*Destructor)(T * self);                                                \
+  void (*DeletingDestructor)(T * self);
+#endif
+
+typedef struct DxcUnknown DxcUnknown;
+typedef struct DxcBlob DxcBlob;
+typedef struct DxcResult DxcResult;
+typedef struct DxcUtils DxcUtils;
+typedef struct DxcCompiler3 DxcCompiler3;
+typedef struct DxcIncludeHandler DxcIncludeHandler;
+typedef struct DxcVersionInfo DxcVersionInfo;
+
+typedef struct DxcBuffer {
+  const void *ptr;
+  size_t size;
+  uint32_t encoding;
+} DxcBuffer;
+
+struct DxcUnknown {
+  const struct {
+    DXC_UNKNOWN_METHODS(DxcUnknown)
+  } *vtbl;
+};
+
+/* Also IDxcBlobEncoding and IDxcBlobUtf8, which only add methods */
+struct DxcBlob {
+  const struct {
+    DXC_UNKNOWN_METHODS(DxcBlob)
+    void *(DXC_CALL *GetBufferPointer)(DxcBlob *self);
+    size_t(DXC_CALL *GetBufferSize)(DxcBlob *self);
+  } *vtbl;
+};
+
+struct DxcResult {
+  const struct {
+    DXC_UNKNOWN_METHODS(DxcResult)
+    /* IDxcOperationResult */
+    DxcHResult(DXC_CALL *GetStatus)(DxcResult *self, DxcHResult *status);
+    DxcHResult(DXC_CALL *GetResult)(DxcResult *self, DxcBlob **out);
+    DxcHResult(DXC_CALL *GetErrorBuffer)(DxcResult *self, DxcBlob **out);
+    /* IDxcResult */
+    int(DXC_CALL *HasOutput)(DxcResult *self, uint32_t kind);
+    DxcHResult(DXC_CALL *GetOutput)(DxcResult *self, uint32_t kind,
+                                    const DxcGuid *iid, void **out,
+                                    DxcBlob **out_name);
+  } *vtbl;
+};
+
+struct DxcUtils {
+  const struct {
+    DXC_UNKNOWN_METHODS(DxcUtils)
+    void *CreateBlobFromBlob;
+    void *CreateBlobFromPinned;
+    void *MoveToBlob;
+    /** Copies the data */
+    DxcHResult(DXC_CALL *CreateBlob)(DxcUtils *self, const void *data,
+                                     uint32_t size, uint32_t code_page,
+                                     DxcBlob **out);
+  } *vtbl;
+};
+
+struct DxcCompiler3 {
+  const struct {
+    DXC_UNKNOWN_METHODS(DxcCompiler3)
+    DxcHResult(DXC_CALL *Compile)(DxcCompiler3 *self, const DxcBuffer *source,
+                                  const wchar_t **args, uint32_t arg_count,
+                                  DxcIncludeHandler *include_handler,
+                                  const DxcGuid *iid, void **out);
+  } *vtbl;
+};
+
+struct DxcVersionInfo {
+  const struct {
+    DXC_UNKNOWN_METHODS(DxcVersionInfo)
+    DxcHResult(DXC_CALL *GetVersion)(DxcVersionInfo *self, uint32_t *major,
+                                     uint32_t *minor);
+  } *vtbl;
+};
+
+typedef struct DxcIncludeHandlerVtbl {
+  DXC_UNKNOWN_METHODS(DxcIncludeHandler)
+  DxcHResult(DXC_CALL *LoadSource)(DxcIncludeHandler *self,
+                                   const wchar_t *filename, DxcBlob **out);
+} DxcIncludeHandlerVtbl;
+
+/* Implemented here; lives on the stack for one compilation */
+struct DxcIncludeHandler {
+  const DxcIncludeHandlerVtbl *vtbl;
+  DxcUtils *utils;
+  const char *const *include_paths;
+  uint32_t include_path_count;
+};
+
+typedef DxcHResult(DXC_CALL *DxcCreateInstanceFn)(const DxcGuid *clsid,
+                                                  const DxcGuid *iid,
+                                                  void **out);
+
+#define DXC_RELEASE(object)                                                    \
+  do {                                                                         \
+    if (object)                                                                \
+      (object)->vtbl->Release(object);                                         \
+  } while (0)
+
+/*******************************************************************************
+ * Library
+ ******************************************************************************/
+
+static SDL_SpinLock library_lock;
+static bool library_queried;
+static DxcCreateInstanceFn create_instance;
+static char library_version[64];
+
+static void query_version(void) {
+  DxcCompiler3 *compiler = NULL;
+  DxcVersionInfo *info = NULL;
+  uint32_t major = 0, minor = 0;
+  if (create_instance(&CLSID_DxcCompiler, &IID_IDxcCompiler3,
+                      (void **)&compiler) == DXC_S_OK &&
+      compiler->vtbl->QueryInterface(compiler, &IID_IDxcVersionInfo,
+                                     (void **)&info) == DXC_S_OK)
+    info->vtbl->GetVersion(info, &major, &minor);
+  DXC_RELEASE(info);
+  DXC_RELEASE(compiler);
+  snprintf(library_version, sizeof(library_version), "dxcompiler %u.%u",
+           major, minor);
+}
+
+bool candid_dxc_load(void) {
+  SDL_LockSpinlock(&library_lock);
+  if (!library_queried) {
+    library_queried = true;
+    /* The library CMake found, else the system's */
+    SDL_SharedObject *library = NULL;
+#ifdef CANDID_DXC_LIBRARY
+    library = SDL_LoadObject(CANDID_DXC_LIBRARY);
+#endif
+    if (!library)
+      library = SDL_LoadObject(DXC_LIBRARY_NAME);
+    if (library) {
+      create_instance = (DxcCreateInstanceFn)SDL_LoadFunction(
+          library, "DxcCreateInstance");
+      if (create_instance)
+        query_version();
+      else
+        SDL_UnloadObject(library);
+    }
+  }
+  bool loaded = create_instance != NULL;
+  SDL_UnlockSpinlock(&library_lock);
+  return loaded;
+}
+
+const char *candid_dxc_version(void) {
+  return candid_dxc_load() ? library_version : NULL;
+}
+
+/*******************************************************************************
+ * Per-Thread Compilers
+ ******************************************************************************/
+
+typedef struct DxcThreadCompiler {
+  DxcCompiler3 *compiler;
+  DxcUtils *utils;
+} DxcThreadCompiler;
+
+static SDL_TLSID thread_compiler;
+
+static void SDLCALL destroy_thread_compiler(void *value) {
+  DxcThreadCompiler *context = value;
+  DXC_RELEASE(context->compiler);
+  DXC_RELEASE(context->utils);
+  free(context);
+}
+
+static DxcThreadCompiler *get_thread_compiler(void) {
+  DxcThreadCompiler *context = SDL_GetTLS(&thread_compiler);
+  if (context)
+    return context;
+
+  context = calloc(1, sizeof(DxcThreadCompiler));
+  if (!context)
+    return NULL;
+  if (create_instance(&CLSID_DxcCompiler, &IID_IDxcCompiler3,
+                      (void **)&context->compiler) != DXC_S_OK ||
+      create_instance(&CLSID_DxcUtils, &IID_IDxcUtils,
+                      (void **)&context->utils) != DXC_S_OK ||
+      !SDL_SetTLS(&thread_compiler, context, destroy_thread_compiler)) {
+    destroy_thread_compiler(context);
+    return NULL;
+  }
+  return context;
+}
+
+/*******************************************************************************
+ * Include Handler
+ ******************************************************************************/
+
+static bool is_file(const char *path) {
+  SDL_PathInfo info;
+  return SDL_GetPathInfo(path, &info) && info.type == SDL_PATHTYPE_FILE;
+}
+
+/** Load a file into a blob DXC owns */
+static DxcBlob *load_blob(DxcUtils *utils, const char *path) {
+  size_t size = 0;
+  void *data = SDL_LoadFile(path, &size);
+  if (!data)
+    return NULL;
+  DxcBlob *blob = NULL;
+  if (size > UINT32_MAX ||
+      utils->vtbl->CreateBlob(utils, data, (uint32_t)size, DXC_CP_UTF8,
+                              &blob) != DXC_S_OK)
+    blob = NULL;
+  SDL_free(data);
+  return blob;
+}
+
+static DxcHResult DXC_CALL include_query_interface(DxcIncludeHandler *self,
+                                                   const DxcGuid *iid,
+                                                   void **out) {
+  if (memcmp(iid, &IID_IDxcIncludeHandler, sizeof(DxcGuid)) == 0 ||
+      memcmp(iid, &IID_IUnknown, sizeof(DxcGuid)) == 0) {
+    *out = self;
+    return DXC_S_OK;
+  }
+  *out = NULL;
+  return DXC_E_NOINTERFACE;
+}
+
+/* Owned by the compilation, so references are not counted */
+static uint32_t DXC_CALL include_add_ref(DxcIncludeHandler *self) {
+  (void)self;
+  return 1;
+}
+
+static uint32_t DXC_CALL include_release(DxcIncludeHandler *self) {
+  (void)self;
+  return 1;
+}
+
+#ifndef _WIN32
+static void include_destructor(DxcIncludeHandler *self) { (void)self; }
+#endif
+
+/* DXC asks for each candidate path in turn: the name as written, relative
+ * to the working directory, then joined with each -I directory. Names that
+ * are not found as given are also looked up in the include paths. */
+static DxcHResult DXC_CALL include_load_source(DxcIncludeHandler *self,
+                                               const wchar_t *filename,
+                                               DxcBlob **out) {
+  *out = NULL;
+  char *name = SDL_iconv_string("UTF-8", "WCHAR_T", (const char *)filename,
+                                (SDL_wcslen(filename) + 1) * sizeof(wchar_t));
+  if (!name)
+    return DXC_E_FAIL;
+
+  if (is_file(name)) {
+    *out = load_blob(self->utils, name);
+  } else {
+    const char *relative = name;
+    while (relative[0] == '.' && (relative[1] == '/' || relative[1] == '\\'))
+      relative += 2;
+    char path[1024];
+    for (uint32_t i = 0; i < self->include_path_count && !*out; ++i) {
+      snprintf(path, sizeof(path), "%s/%s", self->include_paths[i], relative);
+      if (is_file(path))
+        *out = load_blob(self->utils, path);
+    }
+  }
+
+  SDL_free(name);
+  return *out ? DXC_S_OK : DXC_E_FAIL;
+}
+
+static const DxcIncludeHandlerVtbl include_handler_vtbl = {
+    .QueryInterface = include_query_interface,
+    .AddRef = include_add_ref,
+    .Release = include_release,
+#ifndef _WIN32
+    .Destructor = include_destructor,
+    .DeletingDestructor = include_destructor,
+#endif
+    .LoadSource = include_load_source,
+};
+
+/*******************************************************************************
+ * Compilation
+ ******************************************************************************/
+
+static void free_wide_args(wchar_t **args, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i)
+    SDL_free(args[i]);
+  free(args);
+}
+
+/** Arguments as DXC takes them, NULL on failure */
+static wchar_t **wide_args(const char *const *args, uint32_t count) {
+  wchar_t **wide = calloc(count ? count : 1, sizeof(wchar_t *));
+  if (!wide)
+    return NULL;
+  for (uint32_t i = 0; i < count; ++i) {
+    wide[i] = (wchar_t *)SDL_iconv_string("WCHAR_T", "UTF-8", args[i],
+                                          strlen(args[i]) + 1);
+    if (!wide[i]) {
+      free_wide_args(wide, i);
+      return NULL;
+    }
+  }
+  return wide;
+}
+
+/* Diagnostics of a failed compile, UTF-8 and not always null-terminated */
+static void log_errors(DxcResult *result) {
+  DxcBlob *errors = NULL;
+  if (result->vtbl->GetErrorBuffer(result, &errors) != DXC_S_OK || !errors) {
+    SDL_Log("DXC: compilation failed");
+    return;
+  }
+  size_t size = errors->vtbl->GetBufferSize(errors);
+  const char *text = errors->vtbl->GetBufferPointer(errors);
+  while (size && (text[size - 1] == '\0' || text[size - 1] == '\n'))
+    --size;
+  SDL_Log("DXC: compilation failed:\n%.*s", (int)size, size ? text : "");
+  DXC_RELEASE(errors);
+}
+
+Candid_Result candid_dxc_compile(const char *source, size_t source_size,
+                                 const char *const *args, uint32_t arg_count,
+                                 const char *const *include_paths,
+                                 uint32_t include_path_count,
+                                 Candid_ShaderBytecode *out) {
+  if (!source || !out || (arg_count && !args))
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  memset(out, 0, sizeof(*out));
+  if (!candid_dxc_load())
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  DxcThreadCompiler *context = get_thread_compiler();
+  if (!context)
+    return CANDID_ERROR_RESOURCE_CREATION;
+  wchar_t **wide = wide_args(args, arg_count);
+  if (!wide)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  DxcIncludeHandler include_handler = {
+      .vtbl = &include_handler_vtbl,
+      .utils = context->utils,
+      .include_paths = include_paths,
+      .include_path_count = include_path_count,
+  };
+  DxcBuffer buffer = {source, source_size, DXC_CP_UTF8};
+  DxcResult *result = NULL;
+  DxcBlob *object = NULL;
+  DxcHResult status = DXC_E_FAIL;
+
+  DxcHResult hr = context->compiler->vtbl->Compile(
+      context->compiler, &buffer, (const wchar_t **)wide, arg_count,
+      &include_handler, &IID_IDxcResult, (void **)&result);
+  if (hr == DXC_S_OK)
+    hr = result->vtbl->GetStatus(result, &status);
+  if (hr == DXC_S_OK && status == DXC_S_OK)
+    result->vtbl->GetOutput(result, DXC_OUT_OBJECT, &IID_IDxcBlob,
+                            (void **)&object, NULL);
+  else if (hr == DXC_S_OK)
+    log_errors(result);
+  else
+    SDL_Log("DXC: compile call failed (0x%08x)", (unsigned)hr);
+
+  Candid_Result outcome = CANDID_ERROR_SHADER_COMPILATION;
+  if (object) {
+    size_t size = object->vtbl->GetBufferSize(object);
+    /* Null-terminated like SDL_LoadFile output */
+    char *data = SDL_malloc(size + 1);
+    if (data) {
+      memcpy(data, object->vtbl->GetBufferPointer(object), size);
+      data[size] = '\0';
+      out->data = data;
+      out->size = size;
+      outcome = CANDID_SUCCESS;
+    } else {
+      outcome = CANDID_ERROR_OUT_OF_MEMORY;
+    }
+  }
+
+  DXC_RELEASE(object);
+  DXC_RELEASE(result);
+  free_wide_args(wide, arg_count);
+  return outcome;
+}
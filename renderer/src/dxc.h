@@ -0,0 +1,46 @@
+/**
+ * @file dxc.h
+ * @brief Internal in-process DXC compiler
+ *
+ * Not part of the public API. The DXC shared library (dxcompiler) is loaded
+ * on first use and driven through its COM interfaces, declared here in C.
+ * Every thread compiling gets its own compiler instance, created on its
+ * first compilation and released when it exits, so compilations on
+ * different threads never contend.
+ *
+ * The library is never unloaded: thread-owned instances may outlive any
+ * single user of it.
+ */
+
+#pragma once
+
+#include <candid/shader.h>
+
+/**
+ * Load the DXC library, once per process
+ * @return false when it cannot be found (runtime compilation then falls
+ *         back to running the dxc executable)
+ */
+bool candid_dxc_load(void);
+
+/**
+ * Version of the loaded library ("dxcompiler <major>.<minor>"), part of
+ * shader cache keys
+ */
+const char *candid_dxc_version(void);
+
+/**
+ * Compile on the calling thread's compiler
+ * @param args Command-line arguments, as for the dxc executable, without
+ *        the input and output files
+ * @param include_paths Searched for #include files that are not found
+ *        relative to the working directory
+ * @param out Receives SDL_malloc'd output, null-terminated
+ * @return CANDID_SUCCESS, or CANDID_ERROR_SHADER_COMPILATION with the
+ *         diagnostics logged
+ */
+Candid_Result candid_dxc_compile(const char *source, size_t source_size,
+                                 const char *const *args, uint32_t arg_count,
+                                 const char *const *include_paths,
+                                 uint32_t include_path_count,
+                                 Candid_ShaderBytecode *out);
@@ -0,0 +1,51 @@
+/**
+ * @file frame_pacer.c
+ * @brief Internal frame rate limiter
+ */
+
+#include "frame_pacer.h"
+
+#include <SDL3/SDL.h>
+
+/* Bounds of the spin margin: below the minimum, a timer tick late would miss
+ * the deadline; above the maximum, the OS is too erratic to pace with */
+#define FRAME_PACER_MIN_SLACK_NS 250000u
+#define FRAME_PACER_MAX_SLACK_NS 4000000u
+
+void candid_frame_pacer_init(Candid_FramePacer *pacer, float frame_rate) {
+  *pacer = (Candid_FramePacer){
+      .interval_ns =
+          frame_rate > 0.0f ? (uint64_t)(1e9 / (double)frame_rate) : 0,
+      .slack_ns = 1000000u,
+  };
+}
+
+void candid_frame_pacer_wait(Candid_FramePacer *pacer) {
+  if (pacer->interval_ns == 0)
+    return;
+
+  uint64_t deadline = pacer->deadline_ns;
+  uint64_t now = SDL_GetTicksNS();
+  while (deadline > now && deadline - now > pacer->slack_ns) {
+    uint64_t request = deadline - now - pacer->slack_ns;
+    SDL_DelayNS(request);
+    uint64_t woke = SDL_GetTicksNS();
+    uint64_t oversleep = woke - now > request ? woke - now - request : 0;
+    if (oversleep > pacer->slack_ns)
+      pacer->slack_ns = SDL_min(oversleep, FRAME_PACER_MAX_SLACK_NS);
+    now = woke;
+  }
+  while (now < deadline) {
+    SDL_CPUPauseInstruction();
+    now = SDL_GetTicksNS();
+  }
+
+  /* Let the margin shrink back after a one-off oversleep */
+  pacer->slack_ns -= pacer->slack_ns / 32;
+  if (pacer->slack_ns < FRAME_PACER_MIN_SLACK_NS)
+    pacer->slack_ns = FRAME_PACER_MIN_SLACK_NS;
+
+  pacer->deadline_ns = deadline + pacer->interval_ns;
+  if (pacer->deadline_ns <= now)
+    pacer->deadline_ns = now + pacer->interval_ns;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file frame_pacer.h
+ * @brief Internal frame rate limiter
+ *
+ * Not part of the public API. Frames start at a fixed cadence. The wait
+ * sleeps while the OS timer can be trusted to wake up in time and spins on
+ * the clock for the rest, so frames start within microseconds of their
+ * deadline without burning a core for the whole interval. The spin margin
+ * follows the worst recent oversleep of the OS.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct Candid_FramePacer {
+  uint64_t interval_ns; /**< 0 = unlimited */
+  uint64_t deadline_ns; /**< When the next frame may start */
+  uint64_t slack_ns;    /**< Spun instead of slept before a deadline */
+} Candid_FramePacer;
+
+/** @param frame_rate Frames per second, 0 = unlimited */
+void candid_frame_pacer_init(Candid_FramePacer *pacer, float frame_rate);
+
+/**
+ * Block until the next frame may start. A frame more than an interval late
+ * starts at once and restarts the cadence instead of rushing to catch up.
+ */
+void candid_frame_pacer_wait(Candid_FramePacer *pacer);
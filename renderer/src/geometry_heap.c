@@ -0,0 +1,868 @@
+/**
+ * @file geometry_heap.c
+ * @brief Internal shared vertex and index storage for meshes
+ */
+
+#include "geometry_heap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define GEOMETRY_DEFAULT_BLOCK_SIZE ((size_t)64 << 20)
+/* A range slides into a smaller hole below it in copies of at most the hole
+ * size; holes needing more copies are left to other moves */
+#define GEOMETRY_MAX_SLIDE_COPIES 16
+/* Pulled blocks count vertex storage in words; every mesh's range starts
+ * with its layout record */
+#define PULL_WORD_SIZE 4
+#define PULL_HEADER_WORDS                                                      \
+  ((uint32_t)(sizeof(Candid_VertexPullHeader) / PULL_WORD_SIZE))
+
+/*******************************************************************************
+ * Range Allocator
+ ******************************************************************************/
+
+static bool range_init(Candid_RangeAllocator *allocator, uint32_t capacity) {
+  allocator->free_ranges = malloc(4 * sizeof(Candid_Range));
+  if (!allocator->free_ranges)
+    return false;
+  allocator->free_ranges[0] = (Candid_Range){0, capacity};
+  allocator->free_count = 1;
+  allocator->free_capacity = 4;
+  allocator->capacity = capacity;
+  allocator->used = 0;
+  return true;
+}
+
+/* First fit ending at or below `limit` */
+static bool range_alloc(Candid_RangeAllocator *allocator, uint32_t size,
+                        uint32_t limit, uint32_t *out_offset) {
+  for (uint32_t i = 0; i < allocator->free_count; ++i) {
+    Candid_Range *range = &allocator->free_ranges[i];
+    if (range->offset >= limit || limit - range->offset < size)
+      return false;
+    if (range->size < size)
+      continue;
+    *out_offset = range->offset;
+    range->offset += size;
+    range->size -= size;
+    if (range->size == 0) {
+      memmove(range, range + 1,
+              (allocator->free_count - i - 1) * sizeof(Candid_Range));
+      allocator->free_count--;
+    }
+    allocator->used += size;
+    return true;
+  }
+  return false;
+}
+
+/* Index of the first free range at or past `offset` */
+static uint32_t range_search(const Candid_RangeAllocator *allocator,
+                             uint32_t offset) {
+  uint32_t lo = 0;
+  uint32_t hi = allocator->free_count;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (allocator->free_ranges[mid].offset < offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/**
+ * Claim the free range ending where `range` begins, so `range` can slide
+ * down into it
+ * @param out_offset New start of `range`
+ */
+static bool range_slide(Candid_RangeAllocator *allocator, Candid_Range range,
+                        uint32_t *out_offset) {
+  uint32_t i = range_search(allocator, range.offset);
+  if (i == 0)
+    return false;
+  Candid_Range *hole = &allocator->free_ranges[i - 1];
+  if (hole->offset + hole->size != range.offset ||
+      (size_t)hole->size * GEOMETRY_MAX_SLIDE_COPIES < range.size)
+    return false;
+
+  *out_offset = hole->offset;
+  allocator->used += hole->size;
+  memmove(hole, hole + 1, (allocator->free_count - i) * sizeof(Candid_Range));
+  allocator->free_count--;
+  return true;
+}
+
+static void range_free(Candid_RangeAllocator *allocator, Candid_Range range) {
+  if (range.size == 0)
+    return;
+
+  /* First free range past the released one */
+  uint32_t lo = range_search(allocator, range.offset);
+
+  allocator->used -= range.size;
+  Candid_Range *ranges = allocator->free_ranges;
+  bool merge_prev =
+      lo > 0 && ranges[lo - 1].offset + ranges[lo - 1].size == range.offset;
+  bool merge_next = lo < allocator->free_count &&
+                    range.offset + range.size == ranges[lo].offset;
+
+  if (merge_prev && merge_next) {
+    ranges[lo - 1].size += range.size + ranges[lo].size;
+    memmove(&ranges[lo], &ranges[lo + 1],
+            (allocator->free_count - lo - 1) * sizeof(Candid_Range));
+    allocator->free_count--;
+    return;
+  }
+  if (merge_prev) {
+    ranges[lo - 1].size += range.size;
+    return;
+  }
+  if (merge_next) {
+    ranges[lo].offset = range.offset;
+    ranges[lo].size += range.size;
+    return;
+  }
+
+  if (allocator->free_count == allocator->free_capacity) {
+    uint32_t capacity = allocator->free_capacity * 2;
+    ranges = realloc(ranges, capacity * sizeof(Candid_Range));
+    if (!ranges) {
+      /* The range stays lost rather than corrupting the free list */
+      allocator->used += range.size;
+      return;
+    }
+    allocator->free_ranges = ranges;
+    allocator->free_capacity = capacity;
+  }
+  memmove(&ranges[lo + 1], &ranges[lo],
+          (allocator->free_count - lo) * sizeof(Candid_Range));
+  ranges[lo] = range;
+  allocator->free_count++;
+}
+
+/*******************************************************************************
+ * Blocks
+ ******************************************************************************/
+
+static size_t index_size(Candid_IndexFormat format) {
+  return format == CANDID_INDEX_FORMAT_UINT16 ? sizeof(uint16_t)
+                                              : sizeof(uint32_t);
+}
+
+/* 16-bit index ranges are kept to whole 4-byte words so every mesh's index
+ * buffer offset stays 4-byte aligned */
+static uint32_t index_granularity(Candid_IndexFormat format) {
+  return format == CANDID_INDEX_FORMAT_UINT16 ? 2 : 1;
+}
+
+static uint32_t round_up(uint32_t value, uint32_t granularity) {
+  return (value + granularity - 1) / granularity * granularity;
+}
+
+static bool layouts_equal(const Candid_VertexLayout *a,
+                          const Candid_VertexLayout *b) {
+  if (a->attribute_count != b->attribute_count ||
+      a->buffer_count != b->buffer_count)
+    return false;
+  for (uint32_t i = 0; i < a->attribute_count; ++i) {
+    const Candid_VertexAttribute *x = &a->attributes[i];
+    const Candid_VertexAttribute *y = &b->attributes[i];
+    if (x->semantic != y->semantic || x->format != y->format ||
+        x->offset != y->offset || x->buffer_index != y->buffer_index)
+      return false;
+  }
+  for (uint32_t i = 0; i < a->buffer_count; ++i) {
+    if (a->strides[i] != b->strides[i])
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Describe a layout for vertex-pulling shaders, which read whole words
+ * @return false if the layout cannot be pulled
+ */
+static bool pull_header_init(const Candid_MeshData *data,
+                             Candid_VertexPullHeader *out) {
+  if (data->vertex_stride % PULL_WORD_SIZE != 0 ||
+      data->vertex_stride > UINT16_MAX || data->layout.buffer_count > 1)
+    return false;
+
+  out->stride = (uint32_t)data->vertex_stride;
+  for (uint32_t i = 0; i < CANDID_SEMANTIC_CUSTOM; ++i) {
+    out->attributes[i] = CANDID_VERTEX_PULL_ABSENT;
+  }
+  out->reserved = 0;
+
+  for (uint32_t i = 0; i < data->layout.attribute_count; ++i) {
+    const Candid_VertexAttribute *attribute = &data->layout.attributes[i];
+    if (attribute->buffer_index != 0 ||
+        attribute->offset % PULL_WORD_SIZE != 0 ||
+        attribute->offset >= data->vertex_stride)
+      return false;
+    if (attribute->semantic < CANDID_SEMANTIC_CUSTOM) {
+      out->attributes[attribute->semantic] =
+          attribute->offset | (uint32_t)attribute->format << 16;
+    }
+  }
+  return true;
+}
+
+/* First vertex of a mesh in its block, past the layout record if pulled */
+static int32_t first_vertex(const Candid_GeometryAllocation *allocation) {
+  uint32_t header = allocation->block->pulled ? PULL_HEADER_WORDS : 0;
+  return (int32_t)(allocation->vertices.offset + header);
+}
+
+static void block_destroy(const Candid_BackendInterface *backend,
+                          Candid_Device *device, Candid_GeometryBlock *block) {
+  if (block->vertex_buffer)
+    backend->buffer_destroy(device, block->vertex_buffer);
+  if (block->index_buffer)
+    backend->buffer_destroy(device, block->index_buffer);
+  for (uint32_t i = 0; i < block->allocation_count; ++i) {
+    free(block->allocations[i]);
+  }
+  free(block->vertices.free_ranges);
+  free(block->indices.free_ranges);
+  free(block->allocations);
+  free(block);
+}
+
+/**
+ * @param vertex_count Vertex elements the first mesh needs (words if pulled)
+ */
+static Candid_Result block_create(Candid_GeometryHeap *heap,
+                                  const Candid_BackendInterface *backend,
+                                  Candid_Device *device,
+                                  const Candid_MeshData *data, bool pulled,
+                                  uint32_t vertex_count,
+                                  Candid_GeometryBlock **out) {
+  if (heap->block_count == heap->block_capacity) {
+    uint32_t capacity = heap->block_capacity ? heap->block_capacity * 2 : 4;
+    Candid_GeometryBlock **blocks =
+        realloc(heap->blocks, capacity * sizeof(Candid_GeometryBlock *));
+    if (!blocks)
+      return CANDID_ERROR_OUT_OF_MEMORY;
+    heap->blocks = blocks;
+    heap->block_capacity = capacity;
+  }
+
+  Candid_GeometryBlock *block = calloc(1, sizeof(Candid_GeometryBlock));
+  if (!block)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  block->layout = data->layout;
+  block->vertex_stride =
+      pulled ? PULL_WORD_SIZE : (uint32_t)data->vertex_stride;
+  block->pulled = pulled;
+  block->index_format = data->index_format;
+
+  /* Sized for many meshes, or exactly for one larger than that. Vertex
+   * offsets are signed 32-bit in indexed draws. */
+  size_t block_size =
+      heap->block_size ? heap->block_size : GEOMETRY_DEFAULT_BLOCK_SIZE;
+  uint32_t granularity = index_granularity(data->index_format);
+  size_t vertex_capacity = block_size / block->vertex_stride;
+  if (vertex_capacity < vertex_count)
+    vertex_capacity = vertex_count;
+  if (vertex_capacity > INT32_MAX)
+    vertex_capacity = INT32_MAX;
+  size_t index_capacity = block_size / 2 / index_size(data->index_format);
+  if (index_capacity < data->index_count)
+    index_capacity = data->index_count;
+  if (index_capacity > UINT32_MAX - 1)
+    index_capacity = UINT32_MAX - 1;
+  index_capacity = round_up((uint32_t)index_capacity, granularity);
+
+  Candid_BufferDesc vertex_desc = {
+      .size = vertex_capacity * block->vertex_stride,
+      .usage = CANDID_BUFFER_USAGE_VERTEX | CANDID_BUFFER_USAGE_TRANSFER_SRC |
+               CANDID_BUFFER_USAGE_TRANSFER_DST,
+      .memory = CANDID_BUFFER_MEMORY_CPU_TO_GPU,
+      .label = "Candid Shared Vertices",
+  };
+  if (pulled) {
+    vertex_desc.usage = CANDID_BUFFER_USAGE_STORAGE |
+                        CANDID_BUFFER_USAGE_TRANSFER_SRC |
+                        CANDID_BUFFER_USAGE_TRANSFER_DST;
+    vertex_desc.label = "Candid Pulled Vertices";
+  }
+  Candid_BufferDesc index_desc = {
+      .size = index_capacity * index_size(data->index_format),
+      .usage = CANDID_BUFFER_USAGE_INDEX | CANDID_BUFFER_USAGE_TRANSFER_SRC |
+               CANDID_BUFFER_USAGE_TRANSFER_DST,
+      .memory = CANDID_BUFFER_MEMORY_CPU_TO_GPU,
+      .label = "Candid Shared Indices",
+  };
+
+  Candid_Result result =
+      backend->buffer_create(device, &vertex_desc, &block->vertex_buffer);
+  if (result == CANDID_SUCCESS)
+    result = backend->buffer_create(device, &index_desc, &block->index_buffer);
+  if (result == CANDID_SUCCESS &&
+      (!range_init(&block->vertices, (uint32_t)vertex_capacity) ||
+       !range_init(&block->indices, (uint32_t)index_capacity)))
+    result = CANDID_ERROR_OUT_OF_MEMORY;
+  if (result != CANDID_SUCCESS) {
+    block_destroy(backend, device, block);
+    return result;
+  }
+
+  heap->blocks[heap->block_count++] = block;
+  *out = block;
+  return CANDID_SUCCESS;
+}
+
+/* Reserve both ranges in one block or neither */
+static bool block_alloc(Candid_GeometryBlock *block, uint32_t vertex_count,
+                        uint32_t index_count,
+                        Candid_GeometryAllocation *out) {
+  if (block->allocation_count == block->allocation_capacity) {
+    uint32_t capacity =
+        block->allocation_capacity ? block->allocation_capacity * 2 : 64;
+    Candid_GeometryAllocation **allocations = realloc(
+        block->allocations, capacity * sizeof(Candid_GeometryAllocation *));
+    if (!allocations)
+      return false;
+    block->allocations = allocations;
+    block->allocation_capacity = capacity;
+  }
+
+  index_count = round_up(index_count, index_granularity(block->index_format));
+  uint32_t first_vertex;
+  uint32_t first_index;
+  if (!range_alloc(&block->vertices, vertex_count, UINT32_MAX, &first_vertex))
+    return false;
+  if (!range_alloc(&block->indices, index_count, UINT32_MAX, &first_index)) {
+    range_free(&block->vertices, (Candid_Range){first_vertex, vertex_count});
+    return false;
+  }
+
+  out->block = block;
+  out->vertices = (Candid_Range){first_vertex, vertex_count};
+  out->indices = (Candid_Range){first_index, index_count};
+  return true;
+}
+
+static void block_remove(Candid_GeometryBlock *block,
+                         Candid_GeometryAllocation *allocation) {
+  Candid_GeometryAllocation *last =
+      block->allocations[--block->allocation_count];
+  block->allocations[allocation->index] = last;
+  last->index = allocation->index;
+}
+
+/*******************************************************************************
+ * Mesh Table
+ ******************************************************************************/
+
+static uint32_t table_slot(const Candid_GeometryHeap *heap,
+                           const Candid_Mesh *mesh) {
+  uint64_t hash = (uint64_t)(uintptr_t)mesh * 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(hash >> 32) & (heap->table_capacity - 1);
+}
+
+static uint32_t table_find(const Candid_GeometryHeap *heap,
+                           const Candid_Mesh *mesh) {
+  if (heap->table_count == 0)
+    return UINT32_MAX;
+  uint32_t mask = heap->table_capacity - 1;
+  for (uint32_t i = table_slot(heap, mesh); heap->table[i];
+       i = (i + 1) & mask) {
+    if (heap->table[i]->mesh == mesh)
+      return i;
+  }
+  return UINT32_MAX;
+}
+
+static void table_place(Candid_GeometryHeap *heap,
+                        Candid_GeometryAllocation *allocation) {
+  uint32_t mask = heap->table_capacity - 1;
+  uint32_t i = table_slot(heap, allocation->mesh);
+  while (heap->table[i])
+    i = (i + 1) & mask;
+  heap->table[i] = allocation;
+}
+
+/* Kept at most three quarters full */
+static bool table_reserve(Candid_GeometryHeap *heap) {
+  if ((heap->table_count + 1) * 4 <= heap->table_capacity * 3)
+    return true;
+
+  uint32_t old_capacity = heap->table_capacity;
+  Candid_GeometryAllocation **old_table = heap->table;
+  uint32_t capacity = old_capacity ? old_capacity * 2 : 64;
+  Candid_GeometryAllocation **table =
+      calloc(capacity, sizeof(Candid_GeometryAllocation *));
+  if (!table)
+    return false;
+
+  heap->table = table;
+  heap->table_capacity = capacity;
+  for (uint32_t i = 0; i < old_capacity; ++i) {
+    if (old_table[i])
+      table_place(heap, old_table[i]);
+  }
+  free(old_table);
+  return true;
+}
+
+/* Backward-shift deletion keeps probe sequences unbroken */
+static void table_remove(Candid_GeometryHeap *heap, uint32_t slot) {
+  uint32_t mask = heap->table_capacity - 1;
+  uint32_t hole = slot;
+  for (uint32_t i = (slot + 1) & mask; heap->table[i]; i = (i + 1) & mask) {
+    uint32_t home = table_slot(heap, heap->table[i]->mesh);
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      heap->table[hole] = heap->table[i];
+      hole = i;
+    }
+  }
+  heap->table[hole] = NULL;
+  heap->table_count--;
+}
+
+/*******************************************************************************
+ * Retirement
+ ******************************************************************************/
+
+static void retire(Candid_GeometryHeap *heap, uint32_t slot,
+                   Candid_GeometryBlock *block, Candid_Range vertices,
+                   Candid_Range indices) {
+  if (heap->retired_count[slot] == heap->retired_capacity[slot]) {
+    uint32_t capacity = heap->retired_capacity[slot]
+                            ? heap->retired_capacity[slot] * 2
+                            : 16;
+    Candid_GeometryRetired *retired = realloc(
+        heap->retired[slot], capacity * sizeof(Candid_GeometryRetired));
+    if (!retired)
+      return; /* Ranges stay lost rather than reused too early */
+    heap->retired[slot] = retired;
+    heap->retired_capacity[slot] = capacity;
+  }
+  heap->retired[slot][heap->retired_count[slot]++] = (Candid_GeometryRetired){
+      .block = block,
+      .vertices = vertices,
+      .indices = indices,
+  };
+}
+
+/*******************************************************************************
+ * Heap
+ ******************************************************************************/
+
+Candid_Result
+candid_geometry_heap_create_mesh(Candid_GeometryHeap *heap,
+                                 const Candid_BackendInterface *backend,
+                                 Candid_Device *device,
+                                 const Candid_MeshDesc *desc,
+                                 Candid_Mesh **out) {
+  if (!heap || !backend->mesh_create_placed || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  const Candid_MeshData *data = &desc->data;
+  if (!data->vertices || data->vertex_count == 0 ||
+      data->vertex_stride == 0 || !data->indices || data->index_count == 0 ||
+      data->vertex_count > INT32_MAX || data->index_count > UINT32_MAX - 1)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  uint32_t vertex_count = (uint32_t)data->vertex_count;
+  uint32_t index_count = (uint32_t)data->index_count;
+
+  /* Pulled vertex ranges are the layout record plus the vertex words */
+  bool pulled = desc->storage == CANDID_MESH_STORAGE_PULLED;
+  Candid_VertexPullHeader header;
+  if (pulled) {
+    uint64_t words = PULL_HEADER_WORDS + (uint64_t)data->vertex_count *
+                                             data->vertex_stride /
+                                             PULL_WORD_SIZE;
+    if (!pull_header_init(data, &header) || words > INT32_MAX)
+      return CANDID_ERROR_INVALID_ARGUMENT;
+    vertex_count = (uint32_t)words;
+  }
+
+  Candid_GeometryAllocation *allocation =
+      calloc(1, sizeof(Candid_GeometryAllocation));
+  if (!allocation || !table_reserve(heap)) {
+    free(allocation);
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  }
+
+  Candid_GeometryBlock *block = NULL;
+  for (uint32_t i = 0; i < heap->block_count && !block; ++i) {
+    Candid_GeometryBlock *candidate = heap->blocks[i];
+    if (candidate->pulled == pulled &&
+        candidate->index_format == data->index_format &&
+        (pulled || (candidate->vertex_stride == data->vertex_stride &&
+                    layouts_equal(&candidate->layout, &data->layout))) &&
+        block_alloc(candidate, vertex_count, index_count, allocation))
+      block = candidate;
+  }
+  if (!block) {
+    Candid_Result result = block_create(heap, backend, device, data, pulled,
+                                        vertex_count, &block);
+    if (result == CANDID_SUCCESS &&
+        !block_alloc(block, vertex_count, index_count, allocation))
+      result = CANDID_ERROR_OUT_OF_MEMORY;
+    if (result != CANDID_SUCCESS) {
+      free(allocation);
+      return result;
+    }
+  }
+
+  /* Freed ranges are only reused once no frame in flight can read them */
+  allocation->block = block;
+  size_t vertices_offset = (size_t)first_vertex(allocation) *
+                           block->vertex_stride;
+  size_t indices_size = index_count * index_size(data->index_format);
+  Candid_Result result = CANDID_SUCCESS;
+  if (pulled) {
+    result = backend->buffer_update(device, block->vertex_buffer,
+                                    vertices_offset - sizeof(header),
+                                    &header, sizeof(header));
+  }
+  if (result == CANDID_SUCCESS) {
+    result = backend->buffer_update(device, block->vertex_buffer,
+                                    vertices_offset, data->vertices,
+                                    data->vertex_count * data->vertex_stride);
+  }
+  if (result == CANDID_SUCCESS) {
+    result = backend->buffer_update(
+        device, block->index_buffer,
+        allocation->indices.offset * index_size(data->index_format),
+        data->indices, indices_size);
+  }
+
+  Candid_MeshPlacement placement = {
+      .vertex_buffer = block->vertex_buffer,
+      .index_buffer = block->index_buffer,
+      .vertex_offset = first_vertex(allocation),
+      .first_index = allocation->indices.offset,
+  };
+  if (result == CANDID_SUCCESS) {
+    result = backend->mesh_create_placed(device, desc, &placement,
+                                         &allocation->mesh);
+  }
+  if (result != CANDID_SUCCESS) {
+    range_free(&block->vertices, allocation->vertices);
+    range_free(&block->indices, allocation->indices);
+    free(allocation);
+    return result;
+  }
+
+  allocation->index = block->allocation_count;
+  allocation->index_count = index_count;
+  block->allocations[block->allocation_count++] = allocation;
+  table_place(heap, allocation);
+  heap->table_count++;
+  *out = allocation->mesh;
+  return CANDID_SUCCESS;
+}
+
+bool candid_geometry_heap_release(Candid_GeometryHeap *heap,
+                                  Candid_Mesh *mesh, uint32_t slot) {
+  if (!heap || !mesh || slot >= CANDID_MAX_UPLOAD_SLOTS)
+    return false;
+  uint32_t entry = table_find(heap, mesh);
+  if (entry == UINT32_MAX)
+    return false;
+
+  Candid_GeometryAllocation *allocation = heap->table[entry];
+  table_remove(heap, entry);
+  block_remove(allocation->block, allocation);
+  retire(heap, slot, allocation->block, allocation->vertices,
+         allocation->indices);
+  free(allocation);
+  return true;
+}
+
+bool candid_geometry_heap_get_draw_info(const Candid_GeometryHeap *heap,
+                                        Candid_Mesh *mesh,
+                                        Candid_MeshDrawInfo *out) {
+  if (!heap || !mesh || !out)
+    return false;
+  uint32_t entry = table_find(heap, mesh);
+  if (entry == UINT32_MAX)
+    return false;
+
+  const Candid_GeometryAllocation *allocation = heap->table[entry];
+  out->geometry = allocation->block->vertex_buffer;
+  out->index_count = allocation->index_count;
+  out->first_index = allocation->indices.offset;
+  out->vertex_offset = first_vertex(allocation);
+  return true;
+}
+
+void candid_geometry_heap_reset(Candid_GeometryHeap *heap, uint32_t slot) {
+  if (!heap || slot >= CANDID_MAX_UPLOAD_SLOTS)
+    return;
+  for (uint32_t i = 0; i < heap->retired_count[slot]; ++i) {
+    Candid_GeometryRetired *retired = &heap->retired[slot][i];
+    range_free(&retired->block->vertices, retired->vertices);
+    range_free(&retired->block->indices, retired->indices);
+  }
+  heap->retired_count[slot] = 0;
+  heap->move_count = 0;
+  heap->mesh_move_count = 0;
+  heap->bytes_moved = 0;
+}
+
+void candid_geometry_heap_destroy(Candid_GeometryHeap *heap,
+                                  const Candid_BackendInterface *backend,
+                                  Candid_Device *device) {
+  if (!heap)
+    return;
+  for (uint32_t i = 0; i < heap->block_count; ++i) {
+    block_destroy(backend, device, heap->blocks[i]);
+  }
+  for (uint32_t i = 0; i < CANDID_MAX_UPLOAD_SLOTS; ++i) {
+    free(heap->retired[i]);
+  }
+  free(heap->blocks);
+  free(heap->table);
+  free(heap->candidates);
+  free(heap->moves);
+  free(heap->mesh_moves);
+  free(heap->moved);
+  size_t block_size = heap->block_size;
+  memset(heap, 0, sizeof(*heap));
+  heap->block_size = block_size;
+}
+
+/*******************************************************************************
+ * Defragmentation
+ ******************************************************************************/
+
+/* Whether free space is anywhere but one run at the end */
+static bool range_fragmented(const Candid_RangeAllocator *allocator) {
+  if (allocator->free_count == 0)
+    return false;
+  if (allocator->free_count > 1)
+    return true;
+  const Candid_Range *range = &allocator->free_ranges[0];
+  return range->offset + range->size != allocator->capacity;
+}
+
+static int compare_vertices_descending(const void *a, const void *b) {
+  const Candid_GeometryAllocation *x = *(Candid_GeometryAllocation *const *)a;
+  const Candid_GeometryAllocation *y = *(Candid_GeometryAllocation *const *)b;
+  return (x->vertices.offset < y->vertices.offset) -
+         (x->vertices.offset > y->vertices.offset);
+}
+
+static int compare_indices_descending(const void *a, const void *b) {
+  const Candid_GeometryAllocation *x = *(Candid_GeometryAllocation *const *)a;
+  const Candid_GeometryAllocation *y = *(Candid_GeometryAllocation *const *)b;
+  return (x->indices.offset < y->indices.offset) -
+         (x->indices.offset > y->indices.offset);
+}
+
+static bool reserve_move(Candid_GeometryHeap *heap) {
+  if (heap->move_count < heap->move_capacity)
+    return true;
+  uint32_t capacity = heap->move_capacity ? heap->move_capacity * 2 : 32;
+  Candid_GeometryMove *moves =
+      realloc(heap->moves, capacity * sizeof(Candid_GeometryMove));
+  if (moves)
+    heap->moves = moves;
+  Candid_MeshMove *mesh_moves =
+      realloc(heap->mesh_moves, capacity * sizeof(Candid_MeshMove));
+  if (mesh_moves)
+    heap->mesh_moves = mesh_moves;
+  Candid_GeometryAllocation **moved =
+      realloc(heap->moved, capacity * sizeof(Candid_GeometryAllocation *));
+  if (moved)
+    heap->moved = moved;
+  if (!moves || !mesh_moves || !moved)
+    return false;
+  heap->move_capacity = capacity;
+  return true;
+}
+
+/* Record a move to the allocation's current placement; see reserve_move */
+static Candid_GeometryMove *push_move(Candid_GeometryHeap *heap,
+                                      Candid_GeometryAllocation *a) {
+  if (!a->moved) {
+    a->moved = true;
+    heap->moved[heap->mesh_move_count++] = a;
+  }
+  Candid_GeometryMove *move = &heap->moves[heap->move_count++];
+  memset(move, 0, sizeof(*move));
+  move->mesh = a->mesh;
+  move->placement = (Candid_MeshPlacement){
+      .vertex_buffer = a->block->vertex_buffer,
+      .index_buffer = a->block->index_buffer,
+      .vertex_offset = first_vertex(a),
+      .first_index = a->indices.offset,
+  };
+  return move;
+}
+
+/**
+ * Move the highest allocations of one range type into lower holes, highest
+ * first, until the budget is spent. Ranges that fit no lower hole slide down
+ * over the hole right below them instead.
+ */
+static void compact_ranges(Candid_GeometryHeap *heap,
+                           Candid_GeometryBlock *block, bool indices,
+                           size_t budget, uint32_t slot) {
+  Candid_RangeAllocator *allocator =
+      indices ? &block->indices : &block->vertices;
+  if (!range_fragmented(allocator))
+    return;
+
+  size_t element_size = indices ? index_size(block->index_format)
+                                : block->vertex_stride;
+  Candid_GeometryAllocation **candidates = heap->candidates;
+  memcpy(candidates, block->allocations,
+         block->allocation_count * sizeof(Candid_GeometryAllocation *));
+  qsort(candidates, block->allocation_count,
+        sizeof(Candid_GeometryAllocation *),
+        indices ? compare_indices_descending : compare_vertices_descending);
+
+  for (uint32_t i = 0; i < block->allocation_count; ++i) {
+    if (heap->bytes_moved >= budget || allocator->free_count == 0)
+      return;
+    Candid_GeometryAllocation *a = candidates[i];
+    Candid_Range *range = indices ? &a->indices : &a->vertices;
+    size_t size = range->size * element_size;
+    if (size > budget - heap->bytes_moved)
+      continue;
+
+    /* Everything below the lowest hole is already packed */
+    if (range->offset < allocator->free_ranges[0].offset)
+      return;
+
+    if (!reserve_move(heap))
+      return;
+    uint32_t offset;
+    if (!range_alloc(allocator, range->size, range->offset, &offset) &&
+        !range_slide(allocator, *range, &offset))
+      continue;
+    Candid_Range old = *range;
+    range->offset = offset;
+    Candid_GeometryMove *move = push_move(heap, a);
+
+    /* Only the part of the old range left uncovered is released */
+    Candid_Range released = old;
+    if (offset + old.size > old.offset)
+      released = (Candid_Range){offset + old.size, old.offset - offset};
+    if (indices) {
+      move->index_source = old.offset * element_size;
+      move->index_destination = offset * element_size;
+      move->index_size = size;
+      retire(heap, slot, block, (Candid_Range){0, 0}, released);
+    } else {
+      move->vertex_source = old.offset * element_size;
+      move->vertex_destination = offset * element_size;
+      move->vertex_size = size;
+      retire(heap, slot, block, released, (Candid_Range){0, 0});
+    }
+    heap->bytes_moved += size;
+  }
+}
+
+uint32_t
+candid_geometry_heap_defragment(Candid_GeometryHeap *heap, size_t budget,
+                                uint32_t slot,
+                                const Candid_GeometryMove **out_moves) {
+  if (!heap || !out_moves || slot >= CANDID_MAX_UPLOAD_SLOTS)
+    return 0;
+  heap->move_count = 0;
+  heap->bytes_moved = 0;
+  heap->mesh_move_count = 0;
+  *out_moves = heap->moves;
+  if (budget == 0 || heap->block_count == 0)
+    return 0;
+
+  /* Resume where the last frame's budget ran out */
+  for (uint32_t n = 0; n < heap->block_count; ++n) {
+    uint32_t b = (heap->defrag_block + n) % heap->block_count;
+    Candid_GeometryBlock *block = heap->blocks[b];
+    if (block->allocation_count > heap->candidate_capacity) {
+      Candid_GeometryAllocation **candidates =
+          realloc(heap->candidates, block->allocation_count *
+                                        sizeof(Candid_GeometryAllocation *));
+      if (!candidates)
+        break;
+      heap->candidates = candidates;
+      heap->candidate_capacity = block->allocation_count;
+    }
+
+    compact_ranges(heap, block, false, budget, slot);
+    compact_ranges(heap, block, true, budget, slot);
+    if (heap->bytes_moved >= budget) {
+      heap->defrag_block = b;
+      break;
+    }
+  }
+
+  for (uint32_t i = 0; i < heap->mesh_move_count; ++i) {
+    Candid_GeometryAllocation *a = heap->moved[i];
+    a->moved = false;
+    heap->mesh_moves[i] = (Candid_MeshMove){
+        .mesh = a->mesh,
+        .draw_info =
+            {
+                .geometry = a->block->vertex_buffer,
+                .index_count = a->index_count,
+                .first_index = a->indices.offset,
+                .vertex_offset = first_vertex(a),
+            },
+    };
+  }
+
+  *out_moves = heap->moves;
+  return heap->move_count;
+}
+
+uint32_t candid_geometry_heap_get_moves(const Candid_GeometryHeap *heap,
+                                        const Candid_MeshMove **out) {
+  if (!heap || !out)
+    return 0;
+  *out = heap->mesh_moves;
+  return heap->mesh_move_count;
+}
+
+void candid_geometry_heap_get_stats(const Candid_GeometryHeap *heap,
+                                    Candid_GeometryStats *out) {
+  if (!out)
+    return;
+  memset(out, 0, sizeof(*out));
+  if (!heap)
+    return;
+
+  size_t free_bytes = 0;
+  size_t contiguous = 0;
+  for (uint32_t b = 0; b < heap->block_count; ++b) {
+    const Candid_GeometryBlock *block = heap->blocks[b];
+    const Candid_RangeAllocator *allocators[2] = {&block->vertices,
+                                                  &block->indices};
+    size_t element_sizes[2] = {block->vertex_stride,
+                               index_size(block->index_format)};
+    for (uint32_t i = 0; i < 2; ++i) {
+      const Candid_RangeAllocator *allocator = allocators[i];
+      size_t largest = 0;
+      for (uint32_t r = 0; r < allocator->free_count; ++r) {
+        size_t size = allocator->free_ranges[r].size * element_sizes[i];
+        free_bytes += size;
+        if (size > largest)
+          largest = size;
+      }
+      out->capacity += allocator->capacity * element_sizes[i];
+      out->used += allocator->used * element_sizes[i];
+      out->free_ranges += allocator->free_count;
+      if (largest > out->largest_free)
+        out->largest_free = largest;
+      contiguous += largest;
+    }
+  }
+
+  out->block_count = heap->block_count;
+  out->mesh_count = heap->table_count;
+  out->fragmentation =
+      free_bytes ? 1.0f - (float)contiguous / (float)free_bytes : 0.0f;
+  out->bytes_moved = heap->bytes_moved;
+  out->meshes_moved = heap->mesh_move_count;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file geometry_heap.h
+ * @brief Internal shared vertex and index storage for meshes
+ *
+ * Not part of the public API. Meshes created with CANDID_MESH_STORAGE_SHARED
+ * live in large vertex and index buffers shared by every mesh with the same
+ * vertex layout and index format, so consecutive draws need no rebinding and
+ * can be merged into multi-draws. Each block sub-allocates its vertex buffer
+ * in vertices and its index buffer in indices, first fit.
+ *
+ * Pulled meshes (CANDID_MESH_STORAGE_PULLED) share blocks by index format
+ * alone. Their vertex buffer is a storage buffer allocated in 4-byte words,
+ * each mesh's range starting with a Candid_VertexPullHeader that tells the
+ * shader how to decode the vertices after it.
+ *
+ * Released ranges may still be read by frames in flight, so they are retired
+ * to the owner's current frame slot and only reused when that slot comes
+ * around again (as with Candid_FrameUpload).
+ *
+ * Streaming meshes in and out fragments the free space, so the heap can be
+ * compacted incrementally: each frame a budgeted number of bytes is moved
+ * into lower holes with GPU copies. The executing thread records the copies
+ * and then patches the moved meshes (mesh_set_placement), so every later
+ * draw reads the new ranges; the old ones are retired like released ones.
+ */
+
+#pragma once
+
+#include "upload.h"
+
+#include <candid/backend.h>
+#include <candid/renderer.h>
+
+/** Contiguous run of elements (vertices or indices) */
+typedef struct Candid_Range {
+  uint32_t offset;
+  uint32_t size;
+} Candid_Range;
+
+typedef struct Candid_RangeAllocator {
+  Candid_Range *free_ranges; /**< Sorted by offset, never adjacent */
+  uint32_t free_count;
+  uint32_t free_capacity;
+  uint32_t capacity;
+  uint32_t used;
+} Candid_RangeAllocator;
+
+typedef struct Candid_GeometryBlock Candid_GeometryBlock;
+
+/** Live ranges of one mesh */
+typedef struct Candid_GeometryAllocation {
+  Candid_Mesh *mesh;
+  Candid_GeometryBlock *block;
+  uint32_t index;       /**< In block->allocations */
+  uint32_t index_count; /**< indices.size before rounding */
+  Candid_Range vertices;
+  Candid_Range indices;
+  bool moved; /**< Listed in mesh_moves by the running defragmentation */
+} Candid_GeometryAllocation;
+
+struct Candid_GeometryBlock {
+  Candid_VertexLayout layout;
+  uint32_t vertex_stride; /**< 4 for pulled blocks, which count words */
+  bool pulled;            /**< Any layout, see Candid_VertexPullHeader */
+  Candid_IndexFormat index_format;
+  Candid_Buffer *vertex_buffer;
+  Candid_Buffer *index_buffer;
+  Candid_RangeAllocator vertices;
+  Candid_RangeAllocator indices;
+  Candid_GeometryAllocation **allocations;
+  uint32_t allocation_count;
+  uint32_t allocation_capacity;
+};
+
+/** Ranges released while their slot's frame may still be in flight */
+typedef struct Candid_GeometryRetired {
+  Candid_GeometryBlock *block;
+  Candid_Range vertices;
+  Candid_Range indices;
+} Candid_GeometryRetired;
+
+/**
+ * One mesh relocation: copy the moved ranges within the block's buffers,
+ * then patch the mesh with `placement`
+ */
+typedef struct Candid_GeometryMove {
+  Candid_Mesh *mesh;
+  Candid_MeshPlacement placement;
+  size_t vertex_source; /**< Byte offsets; sizes are 0 for unmoved ranges */
+  size_t vertex_destination;
+  size_t vertex_size;
+  size_t index_source;
+  size_t index_destination;
+  size_t index_size;
+} Candid_GeometryMove;
+
+typedef struct Candid_GeometryHeap {
+  Candid_GeometryBlock **blocks;
+  uint32_t block_count;
+  uint32_t block_capacity;
+  size_t block_size; /**< Vertex buffer bytes per block (0 = 64 MiB) */
+  Candid_GeometryRetired *retired[CANDID_MAX_UPLOAD_SLOTS];
+  uint32_t retired_count[CANDID_MAX_UPLOAD_SLOTS];
+  uint32_t retired_capacity[CANDID_MAX_UPLOAD_SLOTS];
+
+  /* Mesh -> allocation, open addressing with linear probing */
+  Candid_GeometryAllocation **table;
+  uint32_t table_count;
+  uint32_t table_capacity; /**< Power of two */
+
+  /* Defragmentation */
+  uint32_t defrag_block; /**< Block to resume compacting from */
+  Candid_GeometryAllocation **candidates;
+  uint32_t candidate_capacity;
+  Candid_GeometryMove *moves;
+  uint32_t move_count;
+  uint32_t move_capacity; /**< Also of mesh_moves and moved */
+  size_t bytes_moved;
+  /* Each moved mesh once, with its final placement */
+  Candid_MeshMove *mesh_moves;
+  Candid_GeometryAllocation **moved;
+  uint32_t mesh_move_count;
+} Candid_GeometryHeap;
+
+/**
+ * Copy a mesh's data into a block matching its layout (created on demand)
+ * and create a backend mesh placed over that block's buffers
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result
+candid_geometry_heap_create_mesh(Candid_GeometryHeap *heap,
+                                 const Candid_BackendInterface *backend,
+                                 Candid_Device *device,
+                                 const Candid_MeshDesc *desc,
+                                 Candid_Mesh **out);
+
+/**
+ * Retire a mesh's ranges to frame slot `slot`. The backend mesh itself is
+ * destroyed by the caller.
+ * @return false if the mesh does not live in the heap
+ */
+bool candid_geometry_heap_release(Candid_GeometryHeap *heap,
+                                  Candid_Mesh *mesh, uint32_t slot);
+
+/**
+ * Current placement of a mesh, as of the commands recorded so far
+ * @return false if the mesh does not live in the heap
+ */
+bool candid_geometry_heap_get_draw_info(const Candid_GeometryHeap *heap,
+                                        Candid_Mesh *mesh,
+                                        Candid_MeshDrawInfo *out);
+
+/**
+ * Plan up to `budget` bytes of moves into lower free ranges, retiring the
+ * old ranges to frame slot `slot`. Meshes larger than the budget stay put.
+ * The moves must be executed before any draw recorded after this call.
+ * @param out_moves Moves, valid until the next call
+ * @return Number of moves
+ */
+uint32_t
+candid_geometry_heap_defragment(Candid_GeometryHeap *heap, size_t budget,
+                                uint32_t slot,
+                                const Candid_GeometryMove **out_moves);
+
+/**
+ * Meshes moved by the last defragmentation since the last reset, each once
+ * with its final placement
+ * @return Number of moved meshes
+ */
+uint32_t candid_geometry_heap_get_moves(const Candid_GeometryHeap *heap,
+                                        const Candid_MeshMove **out);
+
+/**
+ * Fill storage and fragmentation metrics
+ */
+void candid_geometry_heap_get_stats(const Candid_GeometryHeap *heap,
+                                    Candid_GeometryStats *out);
+
+/**
+ * Start a new frame in `slot`: make the ranges retired to it reusable and
+ * forget the last frame's moves
+ */
+void candid_geometry_heap_reset(Candid_GeometryHeap *heap, uint32_t slot);
+
+/**
+ * Release every block. Meshes placed in the heap must be destroyed first.
+ */
+void candid_geometry_heap_destroy(Candid_GeometryHeap *heap,
+                                  const Candid_BackendInterface *backend,
+                                  Candid_Device *device);
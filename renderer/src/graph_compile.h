@@ -0,0 +1,110 @@
+/**
+ * @file graph_compile.h
+ * @brief Internal render graph lifecycle, compilation and execution
+ *
+ * Not part of the public API. The renderer compiles a declared graph on the
+ * caller's thread, then copies what one execution needs (the steps with
+ * their callbacks, the barriers and the resolved resources) into a
+ * self-contained frame, so the render thread can execute it while the next
+ * frame's graph is declared.
+ */
+
+#pragma once
+
+#include <candid/render_graph.h>
+
+/**
+ * One executed pass, or barriers alone when `execute` is NULL
+ */
+typedef struct Candid_GraphStep {
+  Candid_RenderGraphExecuteFn execute;
+  void *user_data;
+  const char *name; /**< The pass's, for diagnostics */
+  uint32_t first_barrier;
+  uint32_t barrier_count; /**< Recorded before the step */
+  bool frame_pass;        /**< Runs inside the frame's render pass */
+  bool render_pass;       /**< Runs inside a render pass over `targets` */
+  Candid_RenderPassDesc targets;
+} Candid_GraphStep;
+
+/** A resolved resource, by handle - 1 */
+typedef struct Candid_GraphBinding {
+  Candid_Texture *texture;
+  Candid_Buffer *buffer;
+} Candid_GraphBinding;
+
+/**
+ * One execution, followed in memory by its steps, barriers and bindings
+ */
+typedef struct Candid_GraphFrame {
+  uint32_t step_count;
+  uint32_t barrier_count;
+  uint32_t binding_count;
+  uint32_t padding;
+} Candid_GraphFrame;
+
+Candid_Result candid_render_graph_create(const Candid_BackendInterface *backend,
+                                         Candid_Device *device,
+                                         Candid_RenderGraph **out);
+
+/**
+ * Destroy a graph and its transient textures at once; nothing may still be
+ * executing it
+ */
+void candid_render_graph_destroy(Candid_RenderGraph *graph);
+
+/**
+ * Receives the transient textures and heap of a replaced plan, to destroy
+ * once the frames using them are done. Textures come before their heap.
+ */
+typedef void (*Candid_GraphRetireFn)(void *context, Candid_Texture *texture,
+                                     Candid_Heap *heap);
+
+/**
+ * Compile the declared graph, or keep the last plan if it was declared
+ * alike
+ * @return The first declaration error since candid_render_graph_begin,
+ *         CANDID_ERROR_INVALID_ARGUMENT when passes inside the frame's
+ *         render pass would need transitions between them or a pass writes
+ *         several color or depth targets, or a transient texture creation
+ *         failure
+ */
+Candid_Result candid_render_graph_compile(Candid_RenderGraph *graph,
+                                          Candid_GraphRetireFn retire,
+                                          void *context);
+
+/**
+ * Whether the compiled graph draws into the frame's render pass
+ */
+bool candid_render_graph_uses_frame_pass(const Candid_RenderGraph *graph);
+
+/**
+ * Bytes of the frame of the compiled graph
+ */
+size_t candid_render_graph_frame_size(const Candid_RenderGraph *graph);
+
+/**
+ * Write the frame of the compiled graph
+ * @param out candid_render_graph_frame_size bytes, pointer-aligned
+ */
+void candid_render_graph_write_frame(const Candid_RenderGraph *graph,
+                                     Candid_GraphFrame *out);
+
+/**
+ * The frame of the compiled graph, in storage the graph reuses
+ * @return NULL if out of memory
+ */
+const Candid_GraphFrame *
+candid_render_graph_get_frame(Candid_RenderGraph *graph);
+
+/**
+ * Record a frame into `cmd`. The first frame-pass step calls
+ * `begin_frame_pass`, after the barriers; when it returns false, the
+ * frame-pass steps are skipped.
+ */
+void candid_graph_frame_execute(const Candid_GraphFrame *frame,
+                                const Candid_BackendInterface *backend,
+                                Candid_Device *device,
+                                Candid_CommandBuffer *cmd,
+                                bool (*begin_frame_pass)(void *context),
+                                void *context);
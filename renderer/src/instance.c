@@ -0,0 +1,107 @@
+/**
+ * @file instance.c
+ * @brief Instance data packing helpers
+ */
+
+#include <assert.h>
+#include <candid/instance.h>
+#include <math.h>
+
+static_assert(sizeof(Candid_InstanceAffine) == 48, "affine instance size");
+static_assert(sizeof(Candid_InstanceQuatTRS) == 32, "quat instance size");
+static_assert(sizeof(Candid_InstanceQuantized) == 16,
+              "quantized instance size");
+
+/*******************************************************************************
+ * Quantization Helpers
+ ******************************************************************************/
+
+static uint16_t quantize_unorm16(float value) {
+  if (!(value > 0.0f))
+    return 0;
+  if (value >= 1.0f)
+    return UINT16_MAX;
+  return (uint16_t)lrintf(value * 65535.0f);
+}
+
+static int16_t quantize_snorm16(float value) {
+  if (value <= -1.0f)
+    return -INT16_MAX;
+  if (value >= 1.0f)
+    return INT16_MAX;
+  return (int16_t)lrintf(value * 32767.0f);
+}
+
+/*******************************************************************************
+ * Packing
+ ******************************************************************************/
+
+size_t candid_instance_format_size(Candid_InstanceFormat format) {
+  switch (format) {
+  case CANDID_INSTANCE_FORMAT_MAT4:
+    return sizeof(Candid_Mat4);
+  case CANDID_INSTANCE_FORMAT_AFFINE:
+    return sizeof(Candid_InstanceAffine);
+  case CANDID_INSTANCE_FORMAT_QUAT_TRS:
+    return sizeof(Candid_InstanceQuatTRS);
+  case CANDID_INSTANCE_FORMAT_QUANTIZED:
+    return sizeof(Candid_InstanceQuantized);
+  default:
+    return 0;
+  }
+}
+
+void candid_instance_pack_affine(const Candid_Mat4 *model,
+                                 Candid_InstanceAffine *out) {
+  if (!model || !out)
+    return;
+
+  /* Column-major source: element (row r, column c) is m[c * 4 + r] */
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      out->rows[r][c] = model->m[c * 4 + r];
+    }
+  }
+}
+
+void candid_instance_pack_quat_trs(Candid_Vec3 position, Candid_Quat rotation,
+                                   float scale, Candid_InstanceQuatTRS *out) {
+  if (!out)
+    return;
+  out->rotation = rotation;
+  out->position = position;
+  out->scale = scale;
+}
+
+void candid_instance_pack_quantized(
+    Candid_Vec3 position, Candid_Quat rotation, float scale,
+    const Candid_InstanceQuantization *quantization,
+    Candid_InstanceQuantized *out) {
+  if (!quantization || !out)
+    return;
+
+  const Candid_Vec3 *o = &quantization->origin;
+  const Candid_Vec3 *e = &quantization->extent;
+  out->position[0] =
+      quantize_unorm16(e->x > 0.0f ? (position.x - o->x) / e->x : 0.0f);
+  out->position[1] =
+      quantize_unorm16(e->y > 0.0f ? (position.y - o->y) / e->y : 0.0f);
+  out->position[2] =
+      quantize_unorm16(e->z > 0.0f ? (position.z - o->z) / e->z : 0.0f);
+  out->scale = quantize_unorm16(
+      quantization->max_scale > 0.0f ? scale / quantization->max_scale : 0.0f);
+
+  /* q and -q are the same rotation; keep w positive so the sign bit of the
+   * scalar part never has to survive rounding near zero. */
+  float len = sqrtf(rotation.x * rotation.x + rotation.y * rotation.y +
+                    rotation.z * rotation.z + rotation.w * rotation.w);
+  float inv = len > 0.0f ? 1.0f / len : 0.0f;
+  if (rotation.w < 0.0f)
+    inv = -inv;
+
+  out->rotation[0] = quantize_snorm16(rotation.x * inv);
+  out->rotation[1] = quantize_snorm16(rotation.y * inv);
+  out->rotation[2] = quantize_snorm16(rotation.z * inv);
+  out->rotation[3] =
+      len > 0.0f ? quantize_snorm16(rotation.w * inv) : INT16_MAX;
+}
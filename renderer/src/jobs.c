@@ -0,0 +1,196 @@
+/**
+ * @file jobs.c
+ * @brief Internal worker pool built on SDL threads
+ */
+
+#include "jobs.h"
+
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+
+/*******************************************************************************
+ * Internal Structures
+ ******************************************************************************/
+
+struct Candid_JobSystem {
+  SDL_Thread *threads[CANDID_JOBS_MAX_WORKERS];
+  uint32_t worker_count;
+
+  SDL_Mutex *mutex;
+  SDL_Condition *wake;
+  SDL_Condition *done;
+  SDL_Mutex *dispatch_mutex; /**< Serializes parallel_for callers */
+
+  /* Current batch (written under mutex before the generation bump) */
+  Candid_JobRangeFn fn;
+  void *user_data;
+  uint32_t count;
+  uint32_t grain;
+  SDL_AtomicInt next_range;
+  SDL_AtomicInt remaining_ranges;
+  uint32_t busy_workers;
+  uint64_t generation;
+  bool quit;
+};
+
+/*******************************************************************************
+ * Workers
+ ******************************************************************************/
+
+static void run_ranges(Candid_JobSystem *jobs) {
+  const uint32_t range_count = (jobs->count + jobs->grain - 1) / jobs->grain;
+
+  for (;;) {
+    uint32_t range = (uint32_t)SDL_AddAtomicInt(&jobs->next_range, 1);
+    if (range >= range_count)
+      break;
+
+    uint32_t begin = range * jobs->grain;
+    uint32_t end = begin + jobs->grain;
+    if (end > jobs->count)
+      end = jobs->count;
+
+    jobs->fn(jobs->user_data, begin, end);
+    SDL_AddAtomicInt(&jobs->remaining_ranges, -1);
+  }
+}
+
+static int worker_main(void *data) {
+  Candid_JobSystem *jobs = data;
+  uint64_t seen_generation = 0;
+
+  for (;;) {
+    SDL_LockMutex(jobs->mutex);
+    while (!jobs->quit && jobs->generation == seen_generation)
+      SDL_WaitCondition(jobs->wake, jobs->mutex);
+    if (jobs->quit) {
+      SDL_UnlockMutex(jobs->mutex);
+      break;
+    }
+    seen_generation = jobs->generation;
+    jobs->busy_workers++;
+    SDL_UnlockMutex(jobs->mutex);
+
+    run_ranges(jobs);
+
+    SDL_LockMutex(jobs->mutex);
+    jobs->busy_workers--;
+    if (jobs->busy_workers == 0)
+      SDL_BroadcastCondition(jobs->done);
+    SDL_UnlockMutex(jobs->mutex);
+  }
+
+  return 0;
+}
+
+/*******************************************************************************
+ * Lifecycle
+ ******************************************************************************/
+
+Candid_Result candid_jobs_create(uint32_t worker_count,
+                                 Candid_JobSystem **out) {
+  if (!out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  if (worker_count == 0) {
+    int cores = SDL_GetNumLogicalCPUCores();
+    worker_count = cores > 1 ? (uint32_t)(cores - 1) : 0;
+  }
+  if (worker_count > CANDID_JOBS_MAX_WORKERS)
+    worker_count = CANDID_JOBS_MAX_WORKERS;
+
+  Candid_JobSystem *jobs = calloc(1, sizeof(Candid_JobSystem));
+  if (!jobs)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  jobs->mutex = SDL_CreateMutex();
+  jobs->dispatch_mutex = SDL_CreateMutex();
+  jobs->wake = SDL_CreateCondition();
+  jobs->done = SDL_CreateCondition();
+  if (!jobs->mutex || !jobs->dispatch_mutex || !jobs->wake || !jobs->done) {
+    candid_jobs_destroy(jobs);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    jobs->threads[i] = SDL_CreateThread(worker_main, "candid_worker", jobs);
+    if (!jobs->threads[i])
+      break;
+    jobs->worker_count++;
+  }
+
+  *out = jobs;
+  return CANDID_SUCCESS;
+}
+
+void candid_jobs_destroy(Candid_JobSystem *jobs) {
+  if (!jobs)
+    return;
+
+  if (jobs->mutex) {
+    SDL_LockMutex(jobs->mutex);
+    jobs->quit = true;
+    SDL_BroadcastCondition(jobs->wake);
+    SDL_UnlockMutex(jobs->mutex);
+  }
+
+  for (uint32_t i = 0; i < jobs->worker_count; ++i) {
+    SDL_WaitThread(jobs->threads[i], NULL);
+  }
+
+  SDL_DestroyCondition(jobs->done);
+  SDL_DestroyCondition(jobs->wake);
+  SDL_DestroyMutex(jobs->dispatch_mutex);
+  SDL_DestroyMutex(jobs->mutex);
+  free(jobs);
+}
+
+uint32_t candid_jobs_get_worker_count(const Candid_JobSystem *jobs) {
+  return jobs ? jobs->worker_count : 0;
+}
+
+/*******************************************************************************
+ * Dispatch
+ ******************************************************************************/
+
+void candid_jobs_parallel_for(Candid_JobSystem *jobs, uint32_t count,
+                              uint32_t grain, Candid_JobRangeFn fn,
+                              void *user_data) {
+  if (!fn || count == 0)
+    return;
+  if (grain == 0)
+    grain = 1;
+
+  if (!jobs || jobs->worker_count == 0 || count <= grain) {
+    fn(user_data, 0, count);
+    return;
+  }
+
+  SDL_LockMutex(jobs->dispatch_mutex);
+
+  SDL_LockMutex(jobs->mutex);
+  /* A worker that woke up late for the previous batch may still be scanning
+   * its (exhausted) ranges; let it leave before reusing the batch slots. */
+  while (jobs->busy_workers > 0)
+    SDL_WaitCondition(jobs->done, jobs->mutex);
+  jobs->fn = fn;
+  jobs->user_data = user_data;
+  jobs->count = count;
+  jobs->grain = grain;
+  SDL_SetAtomicInt(&jobs->next_range, 0);
+  SDL_SetAtomicInt(&jobs->remaining_ranges, (int)((count + grain - 1) / grain));
+  jobs->generation++;
+  SDL_BroadcastCondition(jobs->wake);
+  SDL_UnlockMutex(jobs->mutex);
+
+  run_ranges(jobs);
+
+  SDL_LockMutex(jobs->mutex);
+  while (SDL_GetAtomicInt(&jobs->remaining_ranges) > 0 ||
+         jobs->busy_workers > 0) {
+    SDL_WaitCondition(jobs->done, jobs->mutex);
+  }
+  SDL_UnlockMutex(jobs->mutex);
+
+  SDL_UnlockMutex(jobs->dispatch_mutex);
+}
@@ -0,0 +1,50 @@
+/**
+ * @file jobs.h
+ * @brief Internal worker pool for data-parallel renderer work
+ *
+ * Not part of the public API. The pool runs one parallel_for batch at a time;
+ * the calling thread participates in the batch and returns once every range
+ * has been processed.
+ */
+
+#pragma once
+
+#include <candid/types.h>
+
+#define CANDID_JOBS_MAX_WORKERS 64
+
+typedef struct Candid_JobSystem Candid_JobSystem;
+
+/**
+ * Range callback: processes items [begin, end)
+ */
+typedef void (*Candid_JobRangeFn)(void *user_data, uint32_t begin,
+                                  uint32_t end);
+
+/**
+ * Create a worker pool
+ * @param worker_count Number of worker threads (0 = one per extra core)
+ * @param out Output job system
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result candid_jobs_create(uint32_t worker_count,
+                                 Candid_JobSystem **out);
+
+/**
+ * Stop and join all workers
+ */
+void candid_jobs_destroy(Candid_JobSystem *jobs);
+
+/**
+ * Number of worker threads (not counting the calling thread)
+ */
+uint32_t candid_jobs_get_worker_count(const Candid_JobSystem *jobs);
+
+/**
+ * Split [0, count) into ranges of at most `grain` items and run them on the
+ * pool. Blocks until all ranges are done. Runs inline when `jobs` is NULL or
+ * the work fits in a single range.
+ */
+void candid_jobs_parallel_for(Candid_JobSystem *jobs, uint32_t count,
+                              uint32_t grain, Candid_JobRangeFn fn,
+                              void *user_data);
@@ -0,0 +1,644 @@
+/**
+ * @file pipeline_list.c
+ * @brief Recorded pipeline states, saved across runs and pre-warmed
+ */
+
+#include "pipeline_list.h"
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIPELINE_LIST_MAGIC 0x4C504443u /* "CDPL" */
+#define PIPELINE_LIST_VERSION 1u
+#define PIPELINE_LIST_MAX_KEYS 65536u
+#define PIPELINE_MAX_WORKERS 4
+
+static_assert(sizeof(Candid_PipelineKey) % 8 == 0,
+              "keys are stored back to back without padding");
+
+/*******************************************************************************
+ * Internal Structures
+ ******************************************************************************/
+
+typedef struct Candid_PipelineListHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t key_size;
+  uint32_t count;
+} Candid_PipelineListHeader;
+
+typedef struct Candid_PipelineJob {
+  Candid_PipelineCompileFn compile;
+  void *context;
+  Candid_PipelineKey key;
+} Candid_PipelineJob;
+
+struct Candid_PipelineList {
+  char *path;
+
+  /* Keys in insertion order, indexed by an open-addressed table of
+   * (index + 1), 0 marking empty buckets */
+  SDL_SpinLock lock;
+  Candid_PipelineKey *keys;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t *buckets;
+  uint32_t bucket_count; /**< Power of two, at least twice `capacity` */
+  bool dirty;
+
+  /* Queued compilations, run in order */
+  SDL_Mutex *mutex;
+  SDL_Condition *wake;
+  SDL_Condition *idle; /**< Signaled after each compilation */
+  Candid_PipelineJob *queue;
+  uint32_t queue_head;
+  uint32_t queue_count;
+  uint32_t queue_capacity;
+  bool quit;
+  void *active[PIPELINE_MAX_WORKERS]; /**< Context each worker compiles */
+  uint32_t worker_slots;              /**< Indices in `active` handed out */
+  SDL_AtomicInt pending;
+
+  SDL_Thread *threads[PIPELINE_MAX_WORKERS];
+  uint32_t worker_count;
+};
+
+typedef struct Candid_PipelineVariant {
+  uint64_t hash;
+  Candid_PipelineKey key;
+  void *pipeline;
+} Candid_PipelineVariant;
+
+struct Candid_PipelineVariants {
+  SDL_SpinLock lock;
+  Candid_PipelineVariant *entries;
+  uint32_t count;
+  uint32_t capacity;
+};
+
+/*******************************************************************************
+ * Hashing
+ ******************************************************************************/
+
+/* The two lanes of shader cache keys: FNV-1a, and a multiply-xorshift */
+static void hash_bytes(uint64_t hash[2], const void *data, size_t size) {
+  const uint8_t *bytes = data;
+  uint64_t a = hash[0];
+  uint64_t b = hash[1];
+  for (size_t i = 0; i < size; ++i) {
+    a = (a ^ bytes[i]) * 0x100000001b3ull;
+    b = (b + bytes[i]) * 0x9e3779b97f4a7c15ull;
+    b ^= b >> 29;
+  }
+  hash[0] = a;
+  hash[1] = b;
+}
+
+static uint64_t hash_key(const Candid_PipelineKey *key) {
+  uint64_t hash[2] = {0, 0};
+  hash_bytes(hash, key, sizeof(*key));
+  return hash[0] ^ hash[1];
+}
+
+void candid_pipeline_program_hash(uint64_t hash[2], const void *code,
+                                  size_t code_size, const char *entry_point) {
+  /* Length-prefixed, so consecutive stages cannot alias */
+  uint64_t size = code_size;
+  hash_bytes(hash, &size, sizeof(size));
+  hash_bytes(hash, code, code_size);
+  size = entry_point ? strlen(entry_point) : 0;
+  hash_bytes(hash, &size, sizeof(size));
+  if (entry_point)
+    hash_bytes(hash, entry_point, size);
+}
+
+/*******************************************************************************
+ * Keys
+ ******************************************************************************/
+
+static const struct {
+  Candid_VertexSemantic semantic;
+  Candid_VertexFormat format;
+  uint32_t offset;
+} standard_attributes[] = {
+    {CANDID_SEMANTIC_POSITION, CANDID_VERTEX_FORMAT_FLOAT3,
+     offsetof(Candid_Vertex, position)},
+    {CANDID_SEMANTIC_NORMAL, CANDID_VERTEX_FORMAT_FLOAT3,
+     offsetof(Candid_Vertex, normal)},
+    {CANDID_SEMANTIC_TANGENT, CANDID_VERTEX_FORMAT_FLOAT4,
+     offsetof(Candid_Vertex, tangent)},
+    {CANDID_SEMANTIC_TEXCOORD0, CANDID_VERTEX_FORMAT_FLOAT2,
+     offsetof(Candid_Vertex, texcoord0)},
+    {CANDID_SEMANTIC_TEXCOORD1, CANDID_VERTEX_FORMAT_FLOAT2,
+     offsetof(Candid_Vertex, texcoord1)},
+    {CANDID_SEMANTIC_COLOR0, CANDID_VERTEX_FORMAT_FLOAT4,
+     offsetof(Candid_Vertex, color)},
+};
+
+void candid_pipeline_key_set_layout(Candid_PipelineKey *key,
+                                    const Candid_VertexLayout *layout) {
+  memset(key->strides, 0, sizeof(key->strides));
+  memset(key->attributes, 0, sizeof(key->attributes));
+
+  if (layout) {
+    uint32_t buffers = layout->buffer_count;
+    if (buffers > CANDID_MAX_VERTEX_BUFFERS)
+      buffers = CANDID_MAX_VERTEX_BUFFERS;
+    uint32_t attributes = layout->attribute_count;
+    if (attributes > CANDID_MAX_VERTEX_ATTRIBUTES)
+      attributes = CANDID_MAX_VERTEX_ATTRIBUTES;
+    key->buffer_count = (uint8_t)buffers;
+    for (uint32_t i = 0; i < buffers; ++i)
+      key->strides[i] = layout->strides[i];
+    key->attribute_count = (uint8_t)attributes;
+    for (uint32_t i = 0; i < attributes; ++i) {
+      key->attributes[i].offset = layout->attributes[i].offset;
+      key->attributes[i].semantic = (uint8_t)layout->attributes[i].semantic;
+      key->attributes[i].format = (uint8_t)layout->attributes[i].format;
+      key->attributes[i].buffer_index =
+          (uint8_t)layout->attributes[i].buffer_index;
+    }
+  } else {
+    uint32_t attributes =
+        sizeof(standard_attributes) / sizeof(standard_attributes[0]);
+    key->buffer_count = 1;
+    key->strides[0] = sizeof(Candid_Vertex);
+    key->attribute_count = (uint8_t)attributes;
+    for (uint32_t i = 0; i < attributes; ++i) {
+      key->attributes[i].offset = standard_attributes[i].offset;
+      key->attributes[i].semantic = (uint8_t)standard_attributes[i].semantic;
+      key->attributes[i].format = (uint8_t)standard_attributes[i].format;
+    }
+  }
+}
+
+void candid_pipeline_key_init(Candid_PipelineKey *key,
+                              const uint64_t program[2],
+                              const Candid_VertexLayout *layout,
+                              const Candid_RasterizerState *raster,
+                              const Candid_DepthStencilState *depth_stencil,
+                              const Candid_BlendState *blend,
+                              uint32_t color_format, uint32_t depth_format) {
+  memset(key, 0, sizeof(*key));
+  key->program[0] = program[0];
+  key->program[1] = program[1];
+
+  candid_pipeline_key_set_layout(key, layout);
+
+  key->color_format = color_format;
+  key->depth_format = depth_format;
+
+  if (raster) {
+    key->cull_mode = (uint8_t)raster->cull_mode;
+    key->front_face = (uint8_t)raster->front_face;
+    key->wireframe = raster->wireframe;
+    key->depth_bias = raster->depth_bias;
+    key->depth_bias_slope_scale = raster->depth_bias_slope_scale;
+    key->depth_clip_enabled = raster->depth_clip_enabled;
+    key->scissor_enabled = raster->scissor_enabled;
+  } else {
+    key->cull_mode = CANDID_CULL_BACK;
+    key->front_face = CANDID_FRONT_FACE_CCW;
+    key->depth_clip_enabled = true;
+  }
+
+  if (depth_stencil) {
+    key->depth_test_enabled = depth_stencil->depth_test_enabled;
+    key->depth_write_enabled = depth_stencil->depth_write_enabled;
+    key->depth_compare = (uint8_t)depth_stencil->depth_compare;
+    key->stencil_enabled = depth_stencil->stencil_enabled;
+  } else {
+    key->depth_test_enabled = true;
+    key->depth_write_enabled = true;
+    key->depth_compare = CANDID_COMPARE_LESS;
+  }
+
+  if (blend) {
+    key->blend_enabled = blend->enabled;
+    key->src_color = (uint8_t)blend->src_color;
+    key->dst_color = (uint8_t)blend->dst_color;
+    key->color_op = (uint8_t)blend->color_op;
+    key->src_alpha = (uint8_t)blend->src_alpha;
+    key->dst_alpha = (uint8_t)blend->dst_alpha;
+    key->alpha_op = (uint8_t)blend->alpha_op;
+    key->write_mask = blend->write_mask;
+  } else {
+    key->src_color = CANDID_BLEND_ONE;
+    key->src_alpha = CANDID_BLEND_ONE;
+    key->write_mask = 0xF;
+  }
+}
+
+void candid_pipeline_key_get_layout(const Candid_PipelineKey *key,
+                                    Candid_VertexLayout *out) {
+  memset(out, 0, sizeof(*out));
+  out->buffer_count = key->buffer_count;
+  for (uint32_t i = 0; i < key->buffer_count; ++i)
+    out->strides[i] = key->strides[i];
+  out->attribute_count = key->attribute_count;
+  for (uint32_t i = 0; i < key->attribute_count; ++i) {
+    out->attributes[i].offset = key->attributes[i].offset;
+    out->attributes[i].semantic = key->attributes[i].semantic;
+    out->attributes[i].format = key->attributes[i].format;
+    out->attributes[i].buffer_index = key->attributes[i].buffer_index;
+  }
+}
+
+/*******************************************************************************
+ * Key Set
+ ******************************************************************************/
+
+/* Bucket of `key`: its own if present, else the empty one to fill */
+static uint32_t find_bucket(const Candid_PipelineList *list,
+                            const Candid_PipelineKey *key, uint64_t hash) {
+  uint32_t mask = list->bucket_count - 1;
+  uint32_t bucket = (uint32_t)hash & mask;
+  while (list->buckets[bucket] != 0 &&
+         memcmp(&list->keys[list->buckets[bucket] - 1], key, sizeof(*key)))
+    bucket = (bucket + 1) & mask;
+  return bucket;
+}
+
+static bool grow_keys(Candid_PipelineList *list) {
+  uint32_t capacity = list->capacity ? list->capacity * 2 : 256;
+  Candid_PipelineKey *keys =
+      realloc(list->keys, capacity * sizeof(Candid_PipelineKey));
+  if (!keys)
+    return false;
+  list->keys = keys;
+
+  uint32_t bucket_count = capacity * 2;
+  uint32_t *buckets = calloc(bucket_count, sizeof(uint32_t));
+  if (!buckets)
+    return false;
+  free(list->buckets);
+  list->buckets = buckets;
+  list->bucket_count = bucket_count;
+  list->capacity = capacity;
+  for (uint32_t i = 0; i < list->count; ++i) {
+    const Candid_PipelineKey *key = &list->keys[i];
+    list->buckets[find_bucket(list, key, hash_key(key))] = i + 1;
+  }
+  return true;
+}
+
+/** Call with the lock held */
+static bool insert_key(Candid_PipelineList *list,
+                       const Candid_PipelineKey *key) {
+  if (list->count >= PIPELINE_LIST_MAX_KEYS)
+    return false;
+  if (list->count == list->capacity && !grow_keys(list))
+    return false;
+  uint32_t bucket = find_bucket(list, key, hash_key(key));
+  if (list->buckets[bucket] != 0)
+    return false;
+  list->keys[list->count] = *key;
+  list->buckets[bucket] = ++list->count;
+  return true;
+}
+
+void candid_pipeline_list_record(Candid_PipelineList *list,
+                                 const Candid_PipelineKey *key) {
+  if (!list || !key)
+    return;
+  SDL_LockSpinlock(&list->lock);
+  if (insert_key(list, key))
+    list->dirty = true;
+  SDL_UnlockSpinlock(&list->lock);
+}
+
+/*******************************************************************************
+ * File
+ ******************************************************************************/
+
+static void load_file(Candid_PipelineList *list) {
+  size_t size = 0;
+  uint8_t *data = SDL_LoadFile(list->path, &size);
+  if (!data)
+    return;
+
+  Candid_PipelineListHeader header;
+  if (size >= sizeof(header)) {
+    memcpy(&header, data, sizeof(header));
+    if (header.magic == PIPELINE_LIST_MAGIC &&
+        header.version == PIPELINE_LIST_VERSION &&
+        header.key_size == sizeof(Candid_PipelineKey) &&
+        header.count <= (size - sizeof(header)) / sizeof(Candid_PipelineKey)) {
+      for (uint32_t i = 0; i < header.count; ++i) {
+        Candid_PipelineKey key;
+        memcpy(&key, data + sizeof(header) + i * sizeof(key), sizeof(key));
+        insert_key(list, &key);
+      }
+    }
+  }
+  SDL_free(data);
+}
+
+Candid_Result candid_pipeline_list_save(Candid_PipelineList *list) {
+  if (!list)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  SDL_LockSpinlock(&list->lock);
+  Candid_PipelineListHeader header = {
+      .magic = PIPELINE_LIST_MAGIC,
+      .version = PIPELINE_LIST_VERSION,
+      .key_size = sizeof(Candid_PipelineKey),
+      .count = list->count,
+  };
+  size_t length = sizeof(header) + list->count * sizeof(Candid_PipelineKey);
+  uint8_t *file = malloc(length);
+  if (file) {
+    memcpy(file, &header, sizeof(header));
+    memcpy(file + sizeof(header), list->keys,
+           list->count * sizeof(Candid_PipelineKey));
+    list->dirty = false;
+  }
+  SDL_UnlockSpinlock(&list->lock);
+  if (!file)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  /* Never leave a truncated list behind for the next run */
+  char temp[1100];
+  snprintf(temp, sizeof(temp), "%s.tmp", list->path);
+  bool saved = SDL_SaveFile(temp, file, length);
+  free(file);
+  if (saved && !SDL_RenamePath(temp, list->path))
+    saved = false;
+  if (!saved) {
+    SDL_RemovePath(temp);
+    SDL_LockSpinlock(&list->lock);
+    list->dirty = true;
+    SDL_UnlockSpinlock(&list->lock);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+  return CANDID_SUCCESS;
+}
+
+/*******************************************************************************
+ * Workers
+ ******************************************************************************/
+
+static int worker_main(void *data) {
+  Candid_PipelineList *list = data;
+
+  SDL_LockMutex(list->mutex);
+  uint32_t index = list->worker_slots++;
+  for (;;) {
+    while (!list->quit && list->queue_count == 0)
+      SDL_WaitCondition(list->wake, list->mutex);
+    if (list->quit)
+      break;
+    Candid_PipelineJob job = list->queue[list->queue_head];
+    list->queue_head = (list->queue_head + 1) % list->queue_capacity;
+    list->queue_count--;
+    list->active[index] = job.context;
+    SDL_UnlockMutex(list->mutex);
+
+    job.compile(job.context, &job.key);
+    SDL_AddAtomicInt(&list->pending, -1);
+
+    SDL_LockMutex(list->mutex);
+    list->active[index] = NULL;
+    SDL_BroadcastCondition(list->idle);
+  }
+  SDL_UnlockMutex(list->mutex);
+
+  return 0;
+}
+
+/** Call with the mutex held */
+static bool push_job(Candid_PipelineList *list, const Candid_PipelineJob *job) {
+  if (list->queue_count == list->queue_capacity) {
+    uint32_t capacity = list->queue_capacity ? list->queue_capacity * 2 : 64;
+    Candid_PipelineJob *queue = malloc(capacity * sizeof(Candid_PipelineJob));
+    if (!queue)
+      return false;
+    for (uint32_t i = 0; i < list->queue_count; ++i)
+      queue[i] = list->queue[(list->queue_head + i) % list->queue_capacity];
+    free(list->queue);
+    list->queue = queue;
+    list->queue_head = 0;
+    list->queue_capacity = capacity;
+  }
+  uint32_t tail = (list->queue_head + list->queue_count) % list->queue_capacity;
+  list->queue[tail] = *job;
+  list->queue_count++;
+  return true;
+}
+
+/** Call with the mutex held */
+static void start_workers(Candid_PipelineList *list) {
+  if (list->worker_count > 0)
+    return;
+  int cores = SDL_GetNumLogicalCPUCores();
+  uint32_t worker_count = cores > 1 ? (uint32_t)cores / 2 : 1;
+  if (worker_count > PIPELINE_MAX_WORKERS)
+    worker_count = PIPELINE_MAX_WORKERS;
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    list->threads[i] = SDL_CreateThread(worker_main, "candid_pipelines", list);
+    if (!list->threads[i])
+      break;
+    list->worker_count++;
+  }
+}
+
+uint32_t candid_pipeline_list_prewarm(Candid_PipelineList *list,
+                                      const uint64_t program[2],
+                                      Candid_PipelineCompileFn compile,
+                                      void *context) {
+  if (!list || !program || !compile)
+    return 0;
+
+  uint32_t queued = 0;
+  SDL_LockMutex(list->mutex);
+  start_workers(list);
+  if (list->worker_count > 0) {
+    Candid_PipelineJob job = {.compile = compile, .context = context};
+    SDL_LockSpinlock(&list->lock);
+    for (uint32_t i = 0; i < list->count; ++i) {
+      if (list->keys[i].program[0] != program[0] ||
+          list->keys[i].program[1] != program[1])
+        continue;
+      job.key = list->keys[i];
+      if (!push_job(list, &job))
+        break;
+      queued++;
+    }
+    SDL_UnlockSpinlock(&list->lock);
+  }
+  if (queued > 0) {
+    SDL_AddAtomicInt(&list->pending, (int)queued);
+    SDL_BroadcastCondition(list->wake);
+  }
+  SDL_UnlockMutex(list->mutex);
+  return queued;
+}
+
+void candid_pipeline_list_cancel(Candid_PipelineList *list, void *context) {
+  if (!list)
+    return;
+
+  SDL_LockMutex(list->mutex);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < list->queue_count; ++i) {
+    uint32_t from = (list->queue_head + i) % list->queue_capacity;
+    if (list->queue[from].context == context)
+      continue;
+    uint32_t to = (list->queue_head + kept) % list->queue_capacity;
+    list->queue[to] = list->queue[from];
+    kept++;
+  }
+  SDL_AddAtomicInt(&list->pending, -(int)(list->queue_count - kept));
+  list->queue_count = kept;
+
+  for (;;) {
+    bool busy = false;
+    for (uint32_t i = 0; i < list->worker_count; ++i)
+      busy |= list->active[i] == context;
+    if (!busy)
+      break;
+    SDL_WaitCondition(list->idle, list->mutex);
+  }
+  SDL_UnlockMutex(list->mutex);
+}
+
+uint32_t candid_pipeline_list_get_pending(const Candid_PipelineList *list) {
+  if (!list)
+    return 0;
+  int pending = SDL_GetAtomicInt(&((Candid_PipelineList *)list)->pending);
+  return pending > 0 ? (uint32_t)pending : 0;
+}
+
+/*******************************************************************************
+ * Lifecycle
+ ******************************************************************************/
+
+Candid_Result candid_pipeline_list_create(const char *path,
+                                          Candid_PipelineList **out) {
+  if (!path || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_PipelineList *list = calloc(1, sizeof(Candid_PipelineList));
+  if (!list)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  list->path = strdup(path);
+  list->mutex = SDL_CreateMutex();
+  list->wake = SDL_CreateCondition();
+  list->idle = SDL_CreateCondition();
+  if (!list->path || !list->mutex || !list->wake || !list->idle) {
+    candid_pipeline_list_destroy(list);
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  }
+
+  load_file(list);
+  *out = list;
+  return CANDID_SUCCESS;
+}
+
+void candid_pipeline_list_destroy(Candid_PipelineList *list) {
+  if (!list)
+    return;
+
+  if (list->mutex) {
+    SDL_LockMutex(list->mutex);
+    list->quit = true;
+    SDL_BroadcastCondition(list->wake);
+    SDL_UnlockMutex(list->mutex);
+  }
+  for (uint32_t i = 0; i < list->worker_count; ++i)
+    SDL_WaitThread(list->threads[i], NULL);
+
+  if (list->dirty)
+    candid_pipeline_list_save(list);
+
+  SDL_DestroyCondition(list->idle);
+  SDL_DestroyCondition(list->wake);
+  SDL_DestroyMutex(list->mutex);
+  free(list->queue);
+  free(list->buckets);
+  free(list->keys);
+  free(list->path);
+  free(list);
+}
+
+/*******************************************************************************
+ * Variants
+ ******************************************************************************/
+
+Candid_Result candid_pipeline_variants_create(Candid_PipelineVariants **out) {
+  if (!out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  *out = calloc(1, sizeof(Candid_PipelineVariants));
+  return *out ? CANDID_SUCCESS : CANDID_ERROR_OUT_OF_MEMORY;
+}
+
+void candid_pipeline_variants_destroy(Candid_PipelineVariants *variants,
+                                      void (*release)(void *context,
+                                                      void *pipeline),
+                                      void *context) {
+  if (!variants)
+    return;
+  for (uint32_t i = 0; i < variants->count; ++i) {
+    if (release)
+      release(context, variants->entries[i].pipeline);
+  }
+  free(variants->entries);
+  free(variants);
+}
+
+/** Call with the lock held */
+static void *find_variant(const Candid_PipelineVariants *variants,
+                          const Candid_PipelineKey *key, uint64_t hash) {
+  for (uint32_t i = 0; i < variants->count; ++i) {
+    const Candid_PipelineVariant *entry = &variants->entries[i];
+    if (entry->hash == hash && memcmp(&entry->key, key, sizeof(*key)) == 0)
+      return entry->pipeline;
+  }
+  return NULL;
+}
+
+void *candid_pipeline_variants_find(Candid_PipelineVariants *variants,
+                                    const Candid_PipelineKey *key) {
+  if (!variants || !key)
+    return NULL;
+  uint64_t hash = hash_key(key);
+  SDL_LockSpinlock(&variants->lock);
+  void *pipeline = find_variant(variants, key, hash);
+  SDL_UnlockSpinlock(&variants->lock);
+  return pipeline;
+}
+
+void *candid_pipeline_variants_add(Candid_PipelineVariants *variants,
+                                   const Candid_PipelineKey *key,
+                                   void *pipeline) {
+  if (!variants || !key || !pipeline)
+    return NULL;
+  uint64_t hash = hash_key(key);
+  SDL_LockSpinlock(&variants->lock);
+  void *existing = find_variant(variants, key, hash);
+  if (!existing) {
+    if (variants->count == variants->capacity) {
+      uint32_t capacity = variants->capacity ? variants->capacity * 2 : 4;
+      Candid_PipelineVariant *entries = realloc(
+          variants->entries, capacity * sizeof(Candid_PipelineVariant));
+      if (!entries) {
+        SDL_UnlockSpinlock(&variants->lock);
+        return NULL;
+      }
+      variants->entries = entries;
+      variants->capacity = capacity;
+    }
+    variants->entries[variants->count++] = (Candid_PipelineVariant){
+        .hash = hash,
+        .key = *key,
+        .pipeline = pipeline,
+    };
+    existing = pipeline;
+  }
+  SDL_UnlockSpinlock(&variants->lock);
+  return existing;
+}
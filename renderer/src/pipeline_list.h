@@ -0,0 +1,203 @@
+/**
+ * @file pipeline_list.h
+ * @brief Internal list of pipeline states to pre-warm
+ *
+ * Not part of the public API. Backends that create pipelines on demand
+ * record every distinct state their draws use, vertex layout included, in
+ * the list, which is written to a compact binary file when the renderer is
+ * destroyed. On the next run the file is loaded at startup, and as each
+ * program is created the states recorded for it are queued to the list's
+ * worker threads, so a loading screen creating its programs gets their
+ * pipelines compiled in the background instead of at their first draw.
+ *
+ * Programs are identified across runs by a hash of their stages' code and
+ * entry points; everything else in a key is plain data, so the file holds
+ * no pointers. It is a header followed by the keys; files of another
+ * version, key size or byte order are ignored and rewritten.
+ */
+
+#pragma once
+
+#include <candid/backend.h>
+
+/**
+ * One pipeline's state. Zero-filled by candid_pipeline_key_init, so keys
+ * are compared and hashed as bytes.
+ */
+typedef struct Candid_PipelineKey {
+  uint64_t program[2]; /**< candid_pipeline_program_hash */
+
+  /* Vertex layout */
+  uint32_t strides[CANDID_MAX_VERTEX_BUFFERS];
+  struct {
+    uint32_t offset;
+    uint8_t semantic; /**< Candid_VertexSemantic */
+    uint8_t format;   /**< Candid_VertexFormat */
+    uint8_t buffer_index;
+    uint8_t reserved;
+  } attributes[CANDID_MAX_VERTEX_ATTRIBUTES];
+
+  /* Render target formats, as the backend's own values */
+  uint32_t color_format;
+  uint32_t depth_format;
+
+  float depth_bias;
+  float depth_bias_slope_scale;
+
+  uint8_t attribute_count;
+  uint8_t buffer_count;
+
+  /* Rasterizer, depth-stencil and blend state, as Candid_* enums */
+  uint8_t cull_mode;
+  uint8_t front_face;
+  uint8_t wireframe;
+  uint8_t depth_clip_enabled;
+  uint8_t scissor_enabled;
+  uint8_t depth_test_enabled;
+  uint8_t depth_write_enabled;
+  uint8_t depth_compare;
+  uint8_t stencil_enabled;
+  uint8_t blend_enabled;
+  uint8_t src_color;
+  uint8_t dst_color;
+  uint8_t color_op;
+  uint8_t src_alpha;
+  uint8_t dst_alpha;
+  uint8_t alpha_op;
+  uint8_t write_mask;
+  uint8_t reserved[5];
+} Candid_PipelineKey;
+
+typedef struct Candid_PipelineVariants Candid_PipelineVariants;
+
+/**
+ * Compiles the pipeline of `key` for the program passed as `context` to
+ * candid_pipeline_list_prewarm. Runs on a worker thread.
+ */
+typedef void (*Candid_PipelineCompileFn)(void *context,
+                                         const Candid_PipelineKey *key);
+
+/*******************************************************************************
+ * Keys
+ ******************************************************************************/
+
+/**
+ * Fold one stage into a program hash; start from {0, 0} and add the stages
+ * in a fixed order
+ */
+void candid_pipeline_program_hash(uint64_t hash[2], const void *code,
+                                  size_t code_size, const char *entry_point);
+
+/**
+ * Build a key. NULL states take cmd_bind_pipeline's defaults (back-face
+ * culling, counter-clockwise front faces, depth test and write with LESS,
+ * no blending); a NULL layout is the standard Candid_Vertex layout.
+ */
+void candid_pipeline_key_init(Candid_PipelineKey *key,
+                              const uint64_t program[2],
+                              const Candid_VertexLayout *layout,
+                              const Candid_RasterizerState *raster,
+                              const Candid_DepthStencilState *depth_stencil,
+                              const Candid_BlendState *blend,
+                              uint32_t color_format, uint32_t depth_format);
+
+/**
+ * Replace the vertex layout of a key; NULL is the standard Candid_Vertex
+ * layout
+ */
+void candid_pipeline_key_set_layout(Candid_PipelineKey *key,
+                                    const Candid_VertexLayout *layout);
+
+/**
+ * The vertex layout stored in a key
+ */
+void candid_pipeline_key_get_layout(const Candid_PipelineKey *key,
+                                    Candid_VertexLayout *out);
+
+/*******************************************************************************
+ * List
+ ******************************************************************************/
+
+/**
+ * Create a list, loading the keys saved at `path` by a previous run
+ * @param path File the list is loaded from and saved to
+ * @return CANDID_SUCCESS (a missing or unreadable file gives an empty list)
+ */
+Candid_Result candid_pipeline_list_create(const char *path,
+                                          Candid_PipelineList **out);
+
+/**
+ * Join the workers, dropping queued compilations, and save the list if it
+ * changed. Programs passed to candid_pipeline_list_prewarm must have been
+ * cancelled, or outlive this call.
+ */
+void candid_pipeline_list_destroy(Candid_PipelineList *list);
+
+/**
+ * Write the list to its file now (written to a temporary file and renamed
+ * into place)
+ */
+Candid_Result candid_pipeline_list_save(Candid_PipelineList *list);
+
+/**
+ * Add a key if it is new. Safe to call from any thread; NULL lists ignore
+ * it.
+ */
+void candid_pipeline_list_record(Candid_PipelineList *list,
+                                 const Candid_PipelineKey *key);
+
+/**
+ * Queue every key recorded for a program to the workers, starting them on
+ * first use
+ * @param context Passed to `compile`; also what candid_pipeline_list_cancel
+ *        matches
+ * @return Number of keys queued
+ */
+uint32_t candid_pipeline_list_prewarm(Candid_PipelineList *list,
+                                      const uint64_t program[2],
+                                      Candid_PipelineCompileFn compile,
+                                      void *context);
+
+/**
+ * Drop the queued compilations of `context` and wait for those in progress,
+ * before the program it stands for is destroyed
+ */
+void candid_pipeline_list_cancel(Candid_PipelineList *list, void *context);
+
+/**
+ * Compilations queued or in progress
+ */
+uint32_t candid_pipeline_list_get_pending(const Candid_PipelineList *list);
+
+/*******************************************************************************
+ * Variants
+ ******************************************************************************/
+
+/**
+ * Create the pipeline table of one program, mapping keys to the backend's
+ * pipeline objects. Lookups and insertions are safe from any thread.
+ */
+Candid_Result candid_pipeline_variants_create(Candid_PipelineVariants **out);
+
+/**
+ * Destroy a table, passing each pipeline to `release`
+ */
+void candid_pipeline_variants_destroy(Candid_PipelineVariants *variants,
+                                      void (*release)(void *context,
+                                                      void *pipeline),
+                                      void *context);
+
+/**
+ * The pipeline of a key, or NULL if none was added yet
+ */
+void *candid_pipeline_variants_find(Candid_PipelineVariants *variants,
+                                    const Candid_PipelineKey *key);
+
+/**
+ * Add a pipeline. When another thread added the key meanwhile, its pipeline
+ * is kept and returned, and the caller destroys its own.
+ * @return The pipeline of `key` (NULL if out of memory)
+ */
+void *candid_pipeline_variants_add(Candid_PipelineVariants *variants,
+                                   const Candid_PipelineKey *key,
+                                   void *pipeline);
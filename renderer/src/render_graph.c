@@ -0,0 +1,1072 @@
+/**
+ * @file render_graph.c
+ * @brief Render graph declaration, compilation and execution
+ */
+
+#include "graph_compile.h"
+
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRAPH_FRAME_ALIGNMENT 16u
+#define GRAPH_BARRIERS_ALONE UINT32_MAX /**< Step pass without a pass */
+
+/*******************************************************************************
+ * Internal Structures
+ ******************************************************************************/
+
+typedef enum Candid_GraphResourceKind {
+  GRAPH_RESOURCE_TEXTURE,
+  GRAPH_RESOURCE_BUFFER,
+  GRAPH_RESOURCE_BACKBUFFER,
+} Candid_GraphResourceKind;
+
+typedef struct Candid_GraphResource {
+  Candid_GraphResourceKind kind;
+  bool imported;
+  Candid_ResourceState state; /**< Of imported ones, around the graph */
+  Candid_TextureDesc desc;    /**< Of transient textures */
+  Candid_Texture *texture;    /**< Imported */
+  Candid_Buffer *buffer;
+} Candid_GraphResource;
+
+typedef struct Candid_GraphPass {
+  const char *name;
+  uint32_t flags;
+  Candid_RenderGraphExecuteFn execute;
+  void *user_data;
+  uint32_t first_access; /**< Into `sorted`, set by compilation */
+  uint32_t access_count;
+} Candid_GraphPass;
+
+/* Reads and writes of one resource by one pass are merged */
+typedef struct Candid_GraphAccess {
+  uint32_t pass;
+  uint32_t resource; /**< Index, handle - 1 */
+  Candid_ResourceState state;
+  bool read;
+  bool write;
+} Candid_GraphAccess;
+
+typedef struct Candid_GraphBarrier {
+  uint32_t resource;
+  Candid_ResourceState before;
+  Candid_ResourceState after;
+  uint32_t aliased_states; /**< See Candid_ResourceBarrier */
+} Candid_GraphBarrier;
+
+typedef struct Candid_GraphPlanStep {
+  uint32_t pass; /**< GRAPH_BARRIERS_ALONE for the final transitions */
+  uint32_t first_barrier;
+  uint32_t barrier_count;
+  bool frame_pass;
+  /* Attachments outside the frame pass, resource index + 1 (0 if none) */
+  uint32_t color_target;
+  uint32_t depth_target;
+  bool load_color; /**< Also read by the pass: kept rather than cleared */
+  bool load_depth;
+} Candid_GraphPlanStep;
+
+/* What compiling a declaration produced, kept while later frames declare
+ * the same graph */
+typedef struct Candid_GraphPlan {
+  bool valid;
+  uint64_t hash;
+  Candid_GraphPlanStep steps[CANDID_RENDER_GRAPH_MAX_PASSES + 1];
+  uint32_t step_count;
+  Candid_GraphBarrier *barriers;
+  uint32_t barrier_count;
+  uint32_t barrier_capacity;
+  /* Transient textures by resource index, placed in `heap` when the
+   * backend has heaps */
+  Candid_Texture *textures[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  Candid_Heap *heap;
+} Candid_GraphPlan;
+
+struct Candid_RenderGraph {
+  const Candid_BackendInterface *backend;
+  Candid_Device *device;
+  Candid_Result error; /**< First declaration error since begin */
+
+  /* Declaration */
+  Candid_GraphResource resources[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  uint32_t resource_count;
+  Candid_RenderGraphResource backbuffer; /**< 0 until requested */
+  Candid_GraphPass passes[CANDID_RENDER_GRAPH_MAX_PASSES];
+  uint32_t pass_count;
+  Candid_GraphAccess *accesses; /**< In declaration order */
+  Candid_GraphAccess *sorted;   /**< Grouped by pass */
+  uint32_t access_count;
+  uint32_t access_capacity;
+
+  Candid_GraphPlan plan;
+  Candid_RenderGraphStats stats;
+
+  /* Frame for execution on the caller's thread */
+  Candid_GraphFrame *frame;
+  size_t frame_capacity;
+};
+
+/* Per-resource working state of one compilation */
+typedef struct Candid_GraphCompileState {
+  bool needed[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  bool live[CANDID_RENDER_GRAPH_MAX_PASSES];
+  bool frame_pass[CANDID_RENDER_GRAPH_MAX_PASSES];
+  bool frame_read[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  Candid_ResourceState state[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  bool touched[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  bool wrote[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  /* Lifetimes, in steps; every frame-pass step shares one */
+  uint32_t first_use[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  uint32_t last_use[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  /* Index of the barrier discarding each transient at its first use */
+  uint32_t discard_barrier[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  size_t size[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  size_t alignment[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  size_t offset[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  uint32_t transients[CANDID_RENDER_GRAPH_MAX_RESOURCES];
+  uint32_t transient_count;
+} Candid_GraphCompileState;
+
+static size_t align_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+static void set_error(Candid_RenderGraph *graph, Candid_Result result) {
+  if (graph->error == CANDID_SUCCESS)
+    graph->error = result;
+}
+
+/*******************************************************************************
+ * Lifecycle
+ ******************************************************************************/
+
+Candid_Result candid_render_graph_create(const Candid_BackendInterface *backend,
+                                         Candid_Device *device,
+                                         Candid_RenderGraph **out) {
+  if (!backend || !device || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_RenderGraph *graph = calloc(1, sizeof(Candid_RenderGraph));
+  if (!graph)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  graph->backend = backend;
+  graph->device = device;
+
+  *out = graph;
+  return CANDID_SUCCESS;
+}
+
+static void destroy_now(void *context, Candid_Texture *texture,
+                        Candid_Heap *heap) {
+  Candid_RenderGraph *graph = context;
+  if (texture)
+    graph->backend->texture_destroy(graph->device, texture);
+  if (heap)
+    graph->backend->heap_destroy(graph->device, heap);
+}
+
+/* Hand the transient textures of the plan to `retire` and forget them */
+static void retire_plan(Candid_RenderGraph *graph, Candid_GraphRetireFn retire,
+                        void *context) {
+  Candid_GraphPlan *plan = &graph->plan;
+  for (uint32_t i = 0; i < CANDID_RENDER_GRAPH_MAX_RESOURCES; ++i) {
+    if (plan->textures[i])
+      retire(context, plan->textures[i], NULL);
+    plan->textures[i] = NULL;
+  }
+  if (plan->heap)
+    retire(context, NULL, plan->heap);
+  plan->heap = NULL;
+  plan->valid = false;
+}
+
+void candid_render_graph_destroy(Candid_RenderGraph *graph) {
+  if (!graph)
+    return;
+  retire_plan(graph, destroy_now, graph);
+  free(graph->plan.barriers);
+  free(graph->accesses);
+  free(graph->sorted);
+  free(graph->frame);
+  free(graph);
+}
+
+/*******************************************************************************
+ * Declaration
+ ******************************************************************************/
+
+void candid_render_graph_begin(Candid_RenderGraph *graph) {
+  if (!graph)
+    return;
+  graph->error = CANDID_SUCCESS;
+  graph->resource_count = 0;
+  graph->backbuffer = 0;
+  graph->pass_count = 0;
+  graph->access_count = 0;
+}
+
+static Candid_RenderGraphResource add_resource(Candid_RenderGraph *graph,
+                                               Candid_GraphResource resource) {
+  if (graph->resource_count == CANDID_RENDER_GRAPH_MAX_RESOURCES) {
+    set_error(graph, CANDID_ERROR_OUT_OF_MEMORY);
+    return 0;
+  }
+  graph->resources[graph->resource_count++] = resource;
+  return graph->resource_count;
+}
+
+Candid_RenderGraphResource
+candid_render_graph_create_texture(Candid_RenderGraph *graph,
+                                   const Candid_TextureDesc *desc) {
+  if (!graph)
+    return 0;
+  if (!desc || desc->width == 0 || desc->height == 0) {
+    set_error(graph, CANDID_ERROR_INVALID_ARGUMENT);
+    return 0;
+  }
+  return add_resource(graph, (Candid_GraphResource){
+                                 .kind = GRAPH_RESOURCE_TEXTURE,
+                                 .state = CANDID_RESOURCE_STATE_UNDEFINED,
+                                 .desc = *desc,
+                             });
+}
+
+Candid_RenderGraphResource
+candid_render_graph_import_texture(Candid_RenderGraph *graph,
+                                   Candid_Texture *texture,
+                                   Candid_ResourceState state) {
+  if (!graph)
+    return 0;
+  if (!texture || state >= CANDID_RESOURCE_STATE_COUNT) {
+    set_error(graph, CANDID_ERROR_INVALID_ARGUMENT);
+    return 0;
+  }
+  return add_resource(graph, (Candid_GraphResource){
+                                 .kind = GRAPH_RESOURCE_TEXTURE,
+                                 .imported = true,
+                                 .state = state,
+                                 .texture = texture,
+                             });
+}
+
+Candid_RenderGraphResource
+candid_render_graph_import_buffer(Candid_RenderGraph *graph,
+                                  Candid_Buffer *buffer,
+                                  Candid_ResourceState state) {
+  if (!graph)
+    return 0;
+  if (!buffer || state >= CANDID_RESOURCE_STATE_COUNT) {
+    set_error(graph, CANDID_ERROR_INVALID_ARGUMENT);
+    return 0;
+  }
+  return add_resource(graph, (Candid_GraphResource){
+                                 .kind = GRAPH_RESOURCE_BUFFER,
+                                 .imported = true,
+                                 .state = state,
+                                 .buffer = buffer,
+                             });
+}
+
+Candid_RenderGraphResource
+candid_render_graph_get_backbuffer(Candid_RenderGraph *graph) {
+  if (!graph)
+    return 0;
+  if (!graph->backbuffer)
+    graph->backbuffer =
+        add_resource(graph, (Candid_GraphResource){
+                                .kind = GRAPH_RESOURCE_BACKBUFFER,
+                                .imported = true,
+                                .state = CANDID_RESOURCE_STATE_COLOR_TARGET,
+                            });
+  return graph->backbuffer;
+}
+
+uint32_t candid_render_graph_add_pass(Candid_RenderGraph *graph,
+                                      const char *name, uint32_t flags,
+                                      Candid_RenderGraphExecuteFn execute,
+                                      void *user_data) {
+  if (!graph)
+    return 0;
+  if (graph->pass_count == CANDID_RENDER_GRAPH_MAX_PASSES) {
+    set_error(graph, CANDID_ERROR_OUT_OF_MEMORY);
+    return CANDID_RENDER_GRAPH_MAX_PASSES;
+  }
+  graph->passes[graph->pass_count] = (Candid_GraphPass){
+      .name = name,
+      .flags = flags,
+      .execute = execute,
+      .user_data = user_data,
+  };
+  return graph->pass_count++;
+}
+
+static void add_access(Candid_RenderGraph *graph, uint32_t pass,
+                       Candid_RenderGraphResource resource,
+                       Candid_ResourceState state, bool write) {
+  if (pass >= graph->pass_count || resource == 0 ||
+      resource > graph->resource_count ||
+      state >= CANDID_RESOURCE_STATE_COUNT) {
+    set_error(graph, CANDID_ERROR_INVALID_ARGUMENT);
+    return;
+  }
+  /* The swapchain image is only drawn into */
+  const Candid_GraphResource *r = &graph->resources[resource - 1];
+  if (r->kind == GRAPH_RESOURCE_BACKBUFFER &&
+      (!write || state != CANDID_RESOURCE_STATE_COLOR_TARGET)) {
+    set_error(graph, CANDID_ERROR_INVALID_ARGUMENT);
+    return;
+  }
+
+  /* A pass uses a resource in a single state */
+  for (uint32_t i = graph->access_count; i-- > 0;) {
+    Candid_GraphAccess *access = &graph->accesses[i];
+    if (access->pass != pass || access->resource != resource - 1)
+      continue;
+    if (access->state != state)
+      set_error(graph, CANDID_ERROR_INVALID_ARGUMENT);
+    access->read |= !write;
+    access->write |= write;
+    return;
+  }
+
+  if (graph->access_count == graph->access_capacity) {
+    uint32_t capacity =
+        graph->access_capacity ? graph->access_capacity * 2 : 64;
+    Candid_GraphAccess *accesses =
+        realloc(graph->accesses, capacity * sizeof(Candid_GraphAccess));
+    if (!accesses) {
+      set_error(graph, CANDID_ERROR_OUT_OF_MEMORY);
+      return;
+    }
+    graph->accesses = accesses;
+    Candid_GraphAccess *sorted =
+        realloc(graph->sorted, capacity * sizeof(Candid_GraphAccess));
+    if (!sorted) {
+      set_error(graph, CANDID_ERROR_OUT_OF_MEMORY);
+      return;
+    }
+    graph->sorted = sorted;
+    graph->access_capacity = capacity;
+  }
+  graph->accesses[graph->access_count++] = (Candid_GraphAccess){
+      .pass = pass,
+      .resource = resource - 1,
+      .state = state,
+      .read = !write,
+      .write = write,
+  };
+}
+
+void candid_render_graph_read(Candid_RenderGraph *graph, uint32_t pass,
+                              Candid_RenderGraphResource resource,
+                              Candid_ResourceState state) {
+  if (graph)
+    add_access(graph, pass, resource, state, false);
+}
+
+void candid_render_graph_write(Candid_RenderGraph *graph, uint32_t pass,
+                               Candid_RenderGraphResource resource,
+                               Candid_ResourceState state) {
+  if (graph)
+    add_access(graph, pass, resource, state, true);
+}
+
+/*******************************************************************************
+ * Compilation
+ ******************************************************************************/
+
+/* Group the accesses by pass, keeping their order within each */
+static void sort_accesses(Candid_RenderGraph *graph) {
+  for (uint32_t p = 0; p < graph->pass_count; ++p)
+    graph->passes[p].access_count = 0;
+  for (uint32_t i = 0; i < graph->access_count; ++i)
+    graph->passes[graph->accesses[i].pass].access_count++;
+
+  uint32_t first = 0;
+  for (uint32_t p = 0; p < graph->pass_count; ++p) {
+    graph->passes[p].first_access = first;
+    first += graph->passes[p].access_count;
+    graph->passes[p].access_count = 0;
+  }
+  for (uint32_t i = 0; i < graph->access_count; ++i) {
+    Candid_GraphPass *pass = &graph->passes[graph->accesses[i].pass];
+    graph->sorted[pass->first_access + pass->access_count++] =
+        graph->accesses[i];
+  }
+}
+
+static uint64_t hash_u32(uint64_t hash, uint32_t value) {
+  for (uint32_t i = 0; i < 4; ++i) {
+    hash ^= (value >> (i * 8)) & 0xFFu;
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+/* Everything compilation depends on: not the callbacks, nor which imported
+ * objects are used, as they are resolved at every execution */
+static uint64_t hash_declaration(const Candid_RenderGraph *graph) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  hash = hash_u32(hash, graph->resource_count);
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    const Candid_GraphResource *resource = &graph->resources[r];
+    hash = hash_u32(hash, (uint32_t)resource->kind);
+    hash = hash_u32(hash, resource->imported);
+    hash = hash_u32(hash, (uint32_t)resource->state);
+    if (resource->kind == GRAPH_RESOURCE_TEXTURE && !resource->imported) {
+      const Candid_TextureDesc *desc = &resource->desc;
+      hash = hash_u32(hash, desc->width);
+      hash = hash_u32(hash, desc->height);
+      hash = hash_u32(hash, desc->depth);
+      hash = hash_u32(hash, desc->mip_levels);
+      hash = hash_u32(hash, desc->array_layers);
+      hash = hash_u32(hash, (uint32_t)desc->format);
+      hash = hash_u32(hash, desc->usage);
+    }
+  }
+
+  hash = hash_u32(hash, graph->pass_count);
+  for (uint32_t p = 0; p < graph->pass_count; ++p) {
+    const Candid_GraphPass *pass = &graph->passes[p];
+    hash = hash_u32(hash, pass->flags);
+    hash = hash_u32(hash, pass->access_count);
+    for (uint32_t i = 0; i < pass->access_count; ++i) {
+      const Candid_GraphAccess *access = &graph->sorted[pass->first_access + i];
+      hash = hash_u32(hash, access->resource);
+      hash = hash_u32(hash, (uint32_t)access->state);
+      hash = hash_u32(hash, (uint32_t)access->read | access->write << 1);
+    }
+  }
+  return hash;
+}
+
+/**
+ * Walk the passes backwards from the results used outside the graph: a pass
+ * is live when it writes a resource a later live pass still needs
+ */
+static void find_live_passes(const Candid_RenderGraph *graph,
+                             Candid_GraphCompileState *state) {
+  for (uint32_t r = 0; r < graph->resource_count; ++r)
+    state->needed[r] = graph->resources[r].imported;
+
+  for (uint32_t p = graph->pass_count; p-- > 0;) {
+    const Candid_GraphPass *pass = &graph->passes[p];
+    const Candid_GraphAccess *accesses = &graph->sorted[pass->first_access];
+    bool live = pass->flags & CANDID_RENDER_GRAPH_PASS_NEVER_CULL;
+    bool frame_pass = false;
+    for (uint32_t i = 0; i < pass->access_count; ++i) {
+      live |= accesses[i].write && state->needed[accesses[i].resource];
+      frame_pass |= graph->resources[accesses[i].resource].kind ==
+                    GRAPH_RESOURCE_BACKBUFFER;
+    }
+    state->live[p] = live;
+    state->frame_pass[p] = frame_pass;
+    if (!live)
+      continue;
+
+    /* Overwriting ends the need for earlier contents, except on the
+     * backbuffer, which every pass drawing into it adds to */
+    for (uint32_t i = 0; i < pass->access_count; ++i) {
+      const Candid_GraphAccess *access = &accesses[i];
+      if (access->write && !access->read &&
+          graph->resources[access->resource].kind != GRAPH_RESOURCE_BACKBUFFER)
+        state->needed[access->resource] = false;
+    }
+    for (uint32_t i = 0; i < pass->access_count; ++i) {
+      if (accesses[i].read)
+        state->needed[accesses[i].resource] = true;
+    }
+  }
+}
+
+/**
+ * Check that the frame-pass passes can run together at the end: they write
+ * nothing but the backbuffer, read imported resources as imported, and no
+ * later pass moved ahead of them writes what they read
+ */
+static bool check_frame_passes(const Candid_RenderGraph *graph,
+                               Candid_GraphCompileState *state) {
+  for (uint32_t p = 0; p < graph->pass_count; ++p) {
+    if (!state->live[p])
+      continue;
+    const Candid_GraphPass *pass = &graph->passes[p];
+    const Candid_GraphAccess *accesses = &graph->sorted[pass->first_access];
+    for (uint32_t i = 0; i < pass->access_count; ++i) {
+      const Candid_GraphAccess *access = &accesses[i];
+      const Candid_GraphResource *resource =
+          &graph->resources[access->resource];
+      if (resource->kind == GRAPH_RESOURCE_BACKBUFFER)
+        continue;
+      if (!state->frame_pass[p]) {
+        if (access->write && state->frame_read[access->resource])
+          return false;
+        continue;
+      }
+      if (access->write ||
+          (resource->imported && access->state != resource->state))
+        return false;
+      state->frame_read[access->resource] = true;
+    }
+  }
+  return true;
+}
+
+static void order_steps(const Candid_RenderGraph *graph,
+                        const Candid_GraphCompileState *state,
+                        Candid_GraphPlan *plan) {
+  plan->step_count = 0;
+  for (int frame = 0; frame < 2; ++frame) {
+    for (uint32_t p = 0; p < graph->pass_count; ++p) {
+      if (state->live[p] && state->frame_pass[p] == (bool)frame)
+        plan->steps[plan->step_count++] = (Candid_GraphPlanStep){
+            .pass = p,
+            .frame_pass = frame,
+        };
+    }
+  }
+}
+
+static bool push_barrier(Candid_GraphPlan *plan, uint32_t resource,
+                         Candid_ResourceState before,
+                         Candid_ResourceState after) {
+  if (plan->barrier_count == plan->barrier_capacity) {
+    uint32_t capacity =
+        plan->barrier_capacity ? plan->barrier_capacity * 2 : 64;
+    Candid_GraphBarrier *barriers =
+        realloc(plan->barriers, capacity * sizeof(Candid_GraphBarrier));
+    if (!barriers)
+      return false;
+    plan->barriers = barriers;
+    plan->barrier_capacity = capacity;
+  }
+  plan->barriers[plan->barrier_count++] =
+      (Candid_GraphBarrier){resource, before, after, 0};
+  return true;
+}
+
+/**
+ * Move a resource into the state of its next use. A transition is needed
+ * when the state changes, after a write, and before a write following
+ * other uses; the first use of a transient texture discards its contents.
+ */
+static bool transition(const Candid_RenderGraph *graph,
+                       Candid_GraphCompileState *state,
+                       Candid_GraphPlan *plan, uint32_t resource,
+                       Candid_ResourceState after, bool write) {
+  bool discard = !graph->resources[resource].imported &&
+                 !state->touched[resource];
+  Candid_ResourceState before =
+      discard ? CANDID_RESOURCE_STATE_UNDEFINED : state->state[resource];
+  bool needed = discard || before != after || state->wrote[resource] ||
+                (write && state->touched[resource]);
+  if (discard)
+    state->discard_barrier[resource] = plan->barrier_count;
+  state->state[resource] = after;
+  state->wrote[resource] = write;
+  state->touched[resource] = true;
+  return !needed || push_barrier(plan, resource, before, after);
+}
+
+/**
+ * Barriers before each step outside the frame pass, then one batch ahead
+ * of the frame pass: transitions to the states it reads in, and imported
+ * resources returned to their states
+ */
+static Candid_Result build_barriers(const Candid_RenderGraph *graph,
+                                    Candid_GraphCompileState *state,
+                                    Candid_GraphPlan *plan) {
+  plan->barrier_count = 0;
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    state->state[r] = graph->resources[r].state;
+    state->touched[r] = false;
+    state->wrote[r] = false;
+    state->first_use[r] = UINT32_MAX;
+    state->last_use[r] = 0;
+  }
+
+  uint32_t step = 0;
+  for (; step < plan->step_count && !plan->steps[step].frame_pass; ++step) {
+    const Candid_GraphPass *pass = &graph->passes[plan->steps[step].pass];
+    plan->steps[step].first_barrier = plan->barrier_count;
+    for (uint32_t i = 0; i < pass->access_count; ++i) {
+      const Candid_GraphAccess *access = &graph->sorted[pass->first_access + i];
+      uint32_t r = access->resource;
+      if (!transition(graph, state, plan, r, access->state, access->write))
+        return CANDID_ERROR_OUT_OF_MEMORY;
+      if (state->first_use[r] == UINT32_MAX)
+        state->first_use[r] = step;
+      state->last_use[r] = step;
+    }
+    plan->steps[step].barrier_count =
+        plan->barrier_count - plan->steps[step].first_barrier;
+  }
+
+  /* Everything the frame pass reads is transitioned before it begins, so
+   * each resource is read there in one state */
+  uint32_t frame_step = step;
+  uint32_t first_barrier = plan->barrier_count;
+  bool read[CANDID_RENDER_GRAPH_MAX_RESOURCES] = {0};
+  for (; step < plan->step_count; ++step) {
+    const Candid_GraphPass *pass = &graph->passes[plan->steps[step].pass];
+    for (uint32_t i = 0; i < pass->access_count; ++i) {
+      const Candid_GraphAccess *access = &graph->sorted[pass->first_access + i];
+      uint32_t r = access->resource;
+      if (graph->resources[r].kind == GRAPH_RESOURCE_BACKBUFFER)
+        continue;
+      if (read[r]) {
+        if (state->state[r] != access->state)
+          return CANDID_ERROR_INVALID_ARGUMENT;
+        continue;
+      }
+      read[r] = true;
+      if (!transition(graph, state, plan, r, access->state, false))
+        return CANDID_ERROR_OUT_OF_MEMORY;
+      if (state->first_use[r] == UINT32_MAX)
+        state->first_use[r] = frame_step;
+      state->last_use[r] = frame_step;
+    }
+  }
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    const Candid_GraphResource *resource = &graph->resources[r];
+    if (resource->imported && state->touched[r] &&
+        state->state[r] != resource->state &&
+        !push_barrier(plan, r, state->state[r], resource->state))
+      return CANDID_ERROR_OUT_OF_MEMORY;
+  }
+
+  uint32_t count = plan->barrier_count - first_barrier;
+  if (frame_step == plan->step_count && count > 0)
+    plan->steps[plan->step_count++] = (Candid_GraphPlanStep){
+        .pass = GRAPH_BARRIERS_ALONE,
+    };
+  if (frame_step < plan->step_count) {
+    plan->steps[frame_step].first_barrier = first_barrier;
+    plan->steps[frame_step].barrier_count = count;
+  }
+  return CANDID_SUCCESS;
+}
+
+/**
+ * Attachments of the passes outside the frame pass: the textures they write
+ * as COLOR_TARGET and DEPTH_TARGET, at most one of each
+ */
+static bool find_targets(const Candid_RenderGraph *graph,
+                         Candid_GraphPlan *plan) {
+  for (uint32_t s = 0; s < plan->step_count; ++s) {
+    Candid_GraphPlanStep *step = &plan->steps[s];
+    step->color_target = 0;
+    step->depth_target = 0;
+    if (step->frame_pass || step->pass == GRAPH_BARRIERS_ALONE)
+      continue;
+    const Candid_GraphPass *pass = &graph->passes[step->pass];
+    for (uint32_t i = 0; i < pass->access_count; ++i) {
+      const Candid_GraphAccess *access = &graph->sorted[pass->first_access + i];
+      if (!access->write ||
+          graph->resources[access->resource].kind != GRAPH_RESOURCE_TEXTURE)
+        continue;
+      if (access->state == CANDID_RESOURCE_STATE_COLOR_TARGET) {
+        if (step->color_target)
+          return false;
+        step->color_target = access->resource + 1;
+        step->load_color = access->read;
+      } else if (access->state == CANDID_RESOURCE_STATE_DEPTH_TARGET) {
+        if (step->depth_target)
+          return false;
+        step->depth_target = access->resource + 1;
+        step->load_depth = access->read;
+      }
+    }
+  }
+  return true;
+}
+
+static bool lifetimes_overlap(const Candid_GraphCompileState *state,
+                              uint32_t a, uint32_t b) {
+  return state->first_use[a] <= state->last_use[b] &&
+         state->first_use[b] <= state->last_use[a];
+}
+
+/**
+ * Place the transient textures in one heap, largest first, each at the
+ * lowest offset free of every placed texture alive at the same time
+ * @return Heap size
+ */
+static size_t place_transients(Candid_GraphCompileState *state) {
+  uint32_t *order = state->transients;
+  for (uint32_t i = 1; i < state->transient_count; ++i) {
+    uint32_t r = order[i];
+    uint32_t j = i;
+    for (; j > 0 && state->size[order[j - 1]] < state->size[r]; --j)
+      order[j] = order[j - 1];
+    order[j] = r;
+  }
+
+  size_t heap_size = 0;
+  for (uint32_t i = 0; i < state->transient_count; ++i) {
+    uint32_t r = order[i];
+    size_t offset = 0;
+    bool moved = true;
+    while (moved) {
+      moved = false;
+      for (uint32_t j = 0; j < i; ++j) {
+        uint32_t other = order[j];
+        if (!lifetimes_overlap(state, r, other) ||
+            offset >= state->offset[other] + state->size[other] ||
+            state->offset[other] >= offset + state->size[r])
+          continue;
+        offset = align_up(state->offset[other] + state->size[other],
+                          state->alignment[r]);
+        moved = true;
+      }
+    }
+    state->offset[r] = offset;
+    if (offset + state->size[r] > heap_size)
+      heap_size = offset + state->size[r];
+  }
+  return heap_size;
+}
+
+static bool ranges_overlap(const Candid_GraphCompileState *state, uint32_t a,
+                           uint32_t b) {
+  return state->offset[a] < state->offset[b] + state->size[b] &&
+         state->offset[b] < state->offset[a] + state->size[a];
+}
+
+/**
+ * Make each transient's discard barrier wait for the last uses of the
+ * memory it takes over: the textures placed there before it, and, from the
+ * previous frame, itself and those placed there after it. The final state
+ * of each transient is its last use.
+ */
+static void find_aliased_states(Candid_GraphCompileState *state,
+                                Candid_GraphPlan *plan) {
+  for (uint32_t i = 0; i < state->transient_count; ++i) {
+    uint32_t r = state->transients[i];
+    uint32_t states = 1u << state->state[r];
+    for (uint32_t j = 0; plan->heap && j < state->transient_count; ++j) {
+      uint32_t other = state->transients[j];
+      if (other != r && !lifetimes_overlap(state, r, other) &&
+          ranges_overlap(state, r, other))
+        states |= 1u << state->state[other];
+    }
+    plan->barriers[state->discard_barrier[r]].aliased_states = states;
+  }
+}
+
+/**
+ * Create the transient textures the live passes use, aliased in a heap
+ * when the backend has heaps. A texture the heap cannot hold gets its own
+ * memory instead.
+ */
+static Candid_Result create_transients(Candid_RenderGraph *graph,
+                                       Candid_GraphCompileState *state) {
+  const Candid_BackendInterface *backend = graph->backend;
+  Candid_GraphPlan *plan = &graph->plan;
+  bool heaps = backend->heap_create && backend->heap_destroy &&
+               backend->texture_get_placement &&
+               backend->texture_create_placed;
+
+  state->transient_count = 0;
+  size_t transient_size = 0;
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    const Candid_GraphResource *resource = &graph->resources[r];
+    if (resource->kind != GRAPH_RESOURCE_TEXTURE || resource->imported ||
+        !state->touched[r])
+      continue;
+    state->transients[state->transient_count++] = r;
+    state->size[r] = 0;
+    state->alignment[r] = 1;
+    if (heaps)
+      backend->texture_get_placement(graph->device, &resource->desc,
+                                     &state->size[r], &state->alignment[r]);
+    if (state->alignment[r] == 0)
+      state->alignment[r] = 1;
+    transient_size += align_up(state->size[r], state->alignment[r]);
+  }
+
+  size_t heap_size = heaps ? place_transients(state) : 0;
+  if (heap_size > 0 &&
+      backend->heap_create(graph->device, heap_size, &plan->heap) !=
+          CANDID_SUCCESS)
+    plan->heap = NULL;
+  find_aliased_states(state, plan);
+
+  for (uint32_t i = 0; i < state->transient_count; ++i) {
+    uint32_t r = state->transients[i];
+    const Candid_TextureDesc *desc = &graph->resources[r].desc;
+    Candid_Result result = CANDID_ERROR_RESOURCE_CREATION;
+    if (plan->heap)
+      result = backend->texture_create_placed(
+          graph->device, desc, plan->heap, state->offset[r],
+          &plan->textures[r]);
+    if (result != CANDID_SUCCESS)
+      result =
+          backend->texture_create(graph->device, desc, &plan->textures[r]);
+    if (result != CANDID_SUCCESS) {
+      plan->textures[r] = NULL;
+      return result;
+    }
+  }
+
+  graph->stats.transient_textures = state->transient_count;
+  graph->stats.transient_size = transient_size;
+  graph->stats.heap_size = plan->heap ? heap_size : 0;
+  return CANDID_SUCCESS;
+}
+
+Candid_Result candid_render_graph_compile(Candid_RenderGraph *graph,
+                                          Candid_GraphRetireFn retire,
+                                          void *context) {
+  if (!graph || !retire)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (graph->error != CANDID_SUCCESS)
+    return graph->error;
+
+  sort_accesses(graph);
+  uint64_t hash = hash_declaration(graph);
+  Candid_GraphPlan *plan = &graph->plan;
+  if (plan->valid && plan->hash == hash)
+    return CANDID_SUCCESS;
+
+  /* Declared differently: the old transients go with the old plan */
+  retire_plan(graph, retire, context);
+
+  Candid_GraphCompileState *state = calloc(1, sizeof(*state));
+  if (!state)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  Candid_Result result = CANDID_ERROR_INVALID_ARGUMENT;
+  find_live_passes(graph, state);
+  if (check_frame_passes(graph, state)) {
+    order_steps(graph, state, plan);
+    result = build_barriers(graph, state, plan);
+  }
+  if (result == CANDID_SUCCESS && !find_targets(graph, plan))
+    result = CANDID_ERROR_INVALID_ARGUMENT;
+  if (result == CANDID_SUCCESS)
+    result = create_transients(graph, state);
+  free(state);
+  if (result != CANDID_SUCCESS) {
+    /* Never used, so nothing needs them to outlive this */
+    retire_plan(graph, destroy_now, graph);
+    return result;
+  }
+
+  uint32_t live = 0;
+  for (uint32_t s = 0; s < plan->step_count; ++s)
+    live += plan->steps[s].pass != GRAPH_BARRIERS_ALONE;
+  graph->stats.pass_count = graph->pass_count;
+  graph->stats.culled_passes = graph->pass_count - live;
+  graph->stats.barrier_count = plan->barrier_count;
+  graph->stats.compile_count++;
+
+  plan->hash = hash;
+  plan->valid = true;
+  return CANDID_SUCCESS;
+}
+
+bool candid_render_graph_uses_frame_pass(const Candid_RenderGraph *graph) {
+  const Candid_GraphPlan *plan = &graph->plan;
+  return plan->valid && plan->step_count > 0 &&
+         plan->steps[plan->step_count - 1].frame_pass;
+}
+
+void candid_render_graph_get_stats(const Candid_RenderGraph *graph,
+                                   Candid_RenderGraphStats *out) {
+  if (!graph || !out)
+    return;
+  *out = graph->stats;
+}
+
+/*******************************************************************************
+ * Frames
+ ******************************************************************************/
+
+/* Steps, barriers and bindings follow the header, each array aligned */
+static size_t frame_steps_offset(void) {
+  return align_up(sizeof(Candid_GraphFrame), GRAPH_FRAME_ALIGNMENT);
+}
+
+static size_t frame_barriers_offset(uint32_t step_count) {
+  return align_up(frame_steps_offset() + step_count * sizeof(Candid_GraphStep),
+                  GRAPH_FRAME_ALIGNMENT);
+}
+
+static size_t frame_bindings_offset(uint32_t step_count,
+                                    uint32_t barrier_count) {
+  return align_up(frame_barriers_offset(step_count) +
+                      barrier_count * sizeof(Candid_ResourceBarrier),
+                  GRAPH_FRAME_ALIGNMENT);
+}
+
+static const Candid_GraphBinding *
+frame_bindings(const Candid_GraphFrame *frame) {
+  return (const Candid_GraphBinding *)((const char *)frame +
+                                       frame_bindings_offset(
+                                           frame->step_count,
+                                           frame->barrier_count));
+}
+
+size_t candid_render_graph_frame_size(const Candid_RenderGraph *graph) {
+  if (!graph || !graph->plan.valid)
+    return 0;
+  return frame_bindings_offset(graph->plan.step_count,
+                               graph->plan.barrier_count) +
+         graph->resource_count * sizeof(Candid_GraphBinding);
+}
+
+void candid_render_graph_write_frame(const Candid_RenderGraph *graph,
+                                     Candid_GraphFrame *out) {
+  const Candid_GraphPlan *plan = &graph->plan;
+  *out = (Candid_GraphFrame){
+      .step_count = plan->step_count,
+      .barrier_count = plan->barrier_count,
+      .binding_count = graph->resource_count,
+  };
+
+  Candid_GraphBinding *bindings =
+      (Candid_GraphBinding *)((char *)out +
+                              frame_bindings_offset(plan->step_count,
+                                                    plan->barrier_count));
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    const Candid_GraphResource *resource = &graph->resources[r];
+    bindings[r] = (Candid_GraphBinding){
+        .texture = resource->imported ? resource->texture : plan->textures[r],
+        .buffer = resource->buffer,
+    };
+  }
+
+  Candid_ResourceBarrier *barriers =
+      (Candid_ResourceBarrier *)((char *)out +
+                                 frame_barriers_offset(plan->step_count));
+  for (uint32_t i = 0; i < plan->barrier_count; ++i) {
+    const Candid_GraphBarrier *barrier = &plan->barriers[i];
+    barriers[i] = (Candid_ResourceBarrier){
+        .texture = bindings[barrier->resource].texture,
+        .buffer = bindings[barrier->resource].buffer,
+        .before = barrier->before,
+        .after = barrier->after,
+        .aliased_states = barrier->aliased_states,
+    };
+  }
+
+  Candid_GraphStep *steps =
+      (Candid_GraphStep *)((char *)out + frame_steps_offset());
+  for (uint32_t s = 0; s < plan->step_count; ++s) {
+    const Candid_GraphPlanStep *step = &plan->steps[s];
+    const Candid_GraphPass *pass =
+        step->pass == GRAPH_BARRIERS_ALONE ? NULL : &graph->passes[step->pass];
+    steps[s] = (Candid_GraphStep){
+        .execute = pass ? pass->execute : NULL,
+        .user_data = pass ? pass->user_data : NULL,
+        .name = pass ? pass->name : NULL,
+        .first_barrier = step->first_barrier,
+        .barrier_count = step->barrier_count,
+        .frame_pass = step->frame_pass,
+        .render_pass = step->color_target || step->depth_target,
+    };
+    if (!steps[s].render_pass)
+      continue;
+    /* Written without being read: cleared to transparent black and far */
+    Candid_RenderPassDesc *targets = &steps[s].targets;
+    if (step->color_target)
+      targets->color = bindings[step->color_target - 1].texture;
+    if (step->depth_target)
+      targets->depth = bindings[step->depth_target - 1].texture;
+    targets->color_load =
+        step->load_color ? CANDID_LOAD_ACTION_LOAD : CANDID_LOAD_ACTION_CLEAR;
+    targets->depth_load =
+        step->load_depth ? CANDID_LOAD_ACTION_LOAD : CANDID_LOAD_ACTION_CLEAR;
+    targets->clear_depth = 1.0f;
+  }
+}
+
+const Candid_GraphFrame *
+candid_render_graph_get_frame(Candid_RenderGraph *graph) {
+  size_t size = candid_render_graph_frame_size(graph);
+  if (size == 0)
+    return NULL;
+  if (size > graph->frame_capacity) {
+    Candid_GraphFrame *frame = realloc(graph->frame, size);
+    if (!frame)
+      return NULL;
+    graph->frame = frame;
+    graph->frame_capacity = size;
+  }
+  candid_render_graph_write_frame(graph, graph->frame);
+  return graph->frame;
+}
+
+void candid_graph_frame_execute(const Candid_GraphFrame *frame,
+                                const Candid_BackendInterface *backend,
+                                Candid_Device *device,
+                                Candid_CommandBuffer *cmd,
+                                bool (*begin_frame_pass)(void *context),
+                                void *context) {
+  const Candid_GraphStep *steps =
+      (const Candid_GraphStep *)((const char *)frame + frame_steps_offset());
+  const Candid_ResourceBarrier *barriers =
+      (const Candid_ResourceBarrier *)((const char *)frame +
+                                       frame_barriers_offset(
+                                           frame->step_count));
+  Candid_RenderGraphContext pass_context = {
+      .backend = backend,
+      .device = device,
+      .cmd = cmd,
+      .resources = frame,
+  };
+
+  bool in_frame_pass = false;
+  for (uint32_t s = 0; s < frame->step_count; ++s) {
+    const Candid_GraphStep *step = &steps[s];
+    if (!in_frame_pass && step->barrier_count > 0 && backend->cmd_barrier)
+      backend->cmd_barrier(cmd, &barriers[step->first_barrier],
+                           step->barrier_count);
+    if (step->frame_pass && !in_frame_pass) {
+      if (!begin_frame_pass(context))
+        return;
+      in_frame_pass = true;
+    }
+
+    /* Without offscreen passes, the callback records around its targets */
+    bool targets = step->render_pass && backend->cmd_begin_render_pass_targets;
+    if (targets) {
+      Candid_Result result =
+          backend->cmd_begin_render_pass_targets(cmd, &step->targets);
+      if (result != CANDID_SUCCESS) {
+        SDL_Log("Render graph: skipping pass '%s', its targets could not "
+                "be bound (error %d)",
+                step->name ? step->name : "", (int)result);
+        continue;
+      }
+    }
+    if (step->execute)
+      step->execute(&pass_context, step->user_data);
+    if (targets)
+      backend->cmd_end_render_pass(cmd);
+  }
+}
+
+Candid_Texture *
+candid_render_graph_get_texture(const Candid_RenderGraphContext *context,
+                                Candid_RenderGraphResource resource) {
+  if (!context || !context->resources)
+    return NULL;
+  const Candid_GraphFrame *frame = context->resources;
+  if (resource == 0 || resource > frame->binding_count)
+    return NULL;
+  return frame_bindings(frame)[resource - 1].texture;
+}
+
+Candid_Buffer *
+candid_render_graph_get_buffer(const Candid_RenderGraphContext *context,
+                               Candid_RenderGraphResource resource) {
+  if (!context || !context->resources)
+    return NULL;
+  const Candid_GraphFrame *frame = context->resources;
+  if (resource == 0 || resource > frame->binding_count)
+    return NULL;
+  return frame_bindings(frame)[resource - 1].buffer;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file render_target_pool.c
+ * @brief Internal pool recycling render targets across frames
+ */
+
+#include "render_target_pool.h"
+
+#include <stdlib.h>
+
+static bool desc_matches(const Candid_TextureDesc *a,
+                         const Candid_TextureDesc *b) {
+  return a->width == b->width && a->height == b->height &&
+         a->depth == b->depth && a->mip_levels == b->mip_levels &&
+         a->array_layers == b->array_layers && a->format == b->format &&
+         a->usage == b->usage;
+}
+
+Candid_Texture *candid_render_target_acquire(Candid_RenderTargetPool *pool,
+                                             const Candid_TextureDesc *desc,
+                                             uint64_t frame) {
+  for (uint32_t i = 0; i < pool->count; ++i) {
+    Candid_RenderTarget *target = &pool->targets[i];
+    if (!target->in_use && target->released_frame < frame &&
+        desc_matches(&target->desc, desc)) {
+      target->in_use = true;
+      return target->texture;
+    }
+  }
+  return NULL;
+}
+
+Candid_Result candid_render_target_add(Candid_RenderTargetPool *pool,
+                                       const Candid_TextureDesc *desc,
+                                       Candid_Texture *texture) {
+  if (pool->count == pool->capacity) {
+    uint32_t capacity = pool->capacity ? pool->capacity * 2 : 8;
+    Candid_RenderTarget *targets =
+        realloc(pool->targets, capacity * sizeof(Candid_RenderTarget));
+    if (!targets)
+      return CANDID_ERROR_OUT_OF_MEMORY;
+    pool->targets = targets;
+    pool->capacity = capacity;
+  }
+
+  Candid_RenderTarget *target = &pool->targets[pool->count++];
+  *target = (Candid_RenderTarget){
+      .texture = texture,
+      .desc = *desc,
+      .in_use = true,
+  };
+  target->desc.label = NULL;
+  return CANDID_SUCCESS;
+}
+
+bool candid_render_target_release(Candid_RenderTargetPool *pool,
+                                  Candid_Texture *texture, uint64_t frame) {
+  for (uint32_t i = 0; i < pool->count; ++i) {
+    Candid_RenderTarget *target = &pool->targets[i];
+    if (target->texture == texture && target->in_use) {
+      target->in_use = false;
+      target->released_frame = frame;
+      return true;
+    }
+  }
+  return false;
+}
+
+void candid_render_target_evict(Candid_RenderTargetPool *pool, uint64_t frame,
+                                Candid_RenderTargetDestroyFn destroy,
+                                void *context) {
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < pool->count; ++i) {
+    Candid_RenderTarget *target = &pool->targets[i];
+    if (!target->in_use &&
+        frame - target->released_frame >= CANDID_RENDER_TARGET_IDLE_FRAMES) {
+      destroy(context, target->texture);
+      continue;
+    }
+    pool->targets[kept++] = *target;
+  }
+  pool->count = kept;
+}
+
+void candid_render_target_pool_destroy(Candid_RenderTargetPool *pool,
+                                       Candid_RenderTargetDestroyFn destroy,
+                                       void *context) {
+  for (uint32_t i = 0; i < pool->count; ++i)
+    destroy(context, pool->targets[i].texture);
+  free(pool->targets);
+  *pool = (Candid_RenderTargetPool){0};
+}
@@ -0,0 +1,73 @@
+/**
+ * @file render_target_pool.h
+ * @brief Internal pool recycling render targets across frames
+ *
+ * Not part of the public API. Post-processing chains and shadow maps ask
+ * for the same few targets every frame; instead of creating and destroying
+ * them, released textures stay in the pool and are handed back to the next
+ * request with the same size, format and usage. A texture is only reused
+ * from the frame after its release, so commands recorded with it before the
+ * release keep their meaning, and it is destroyed once it has been idle for
+ * CANDID_RENDER_TARGET_IDLE_FRAMES frames, e.g. after a resize.
+ */
+
+#pragma once
+
+#include <candid/backend.h>
+
+/** Frames a released target is kept for before it is destroyed */
+#define CANDID_RENDER_TARGET_IDLE_FRAMES 16
+
+typedef struct Candid_RenderTarget {
+  Candid_Texture *texture;
+  Candid_TextureDesc desc; /**< label is not kept */
+  uint64_t released_frame;
+  bool in_use;
+} Candid_RenderTarget;
+
+typedef struct Candid_RenderTargetPool {
+  Candid_RenderTarget *targets;
+  uint32_t count;
+  uint32_t capacity;
+} Candid_RenderTargetPool;
+
+/** Releases an evicted texture (deferred as the owner sees fit) */
+typedef void (*Candid_RenderTargetDestroyFn)(void *context,
+                                             Candid_Texture *texture);
+
+/**
+ * Hand out an idle target matching `desc`, released before `frame`
+ * @return The texture, now in use, or NULL when none matches
+ */
+Candid_Texture *candid_render_target_acquire(Candid_RenderTargetPool *pool,
+                                             const Candid_TextureDesc *desc,
+                                             uint64_t frame);
+
+/**
+ * Track a texture created for `desc` after a miss, in use
+ * @return CANDID_ERROR_OUT_OF_MEMORY when the pool cannot grow
+ */
+Candid_Result candid_render_target_add(Candid_RenderTargetPool *pool,
+                                       const Candid_TextureDesc *desc,
+                                       Candid_Texture *texture);
+
+/**
+ * Return a target to the pool
+ * @return false when the texture did not come from the pool
+ */
+bool candid_render_target_release(Candid_RenderTargetPool *pool,
+                                  Candid_Texture *texture, uint64_t frame);
+
+/**
+ * Destroy the targets idle for CANDID_RENDER_TARGET_IDLE_FRAMES frames
+ */
+void candid_render_target_evict(Candid_RenderTargetPool *pool, uint64_t frame,
+                                Candid_RenderTargetDestroyFn destroy,
+                                void *context);
+
+/**
+ * Destroy every target, in use or not, and free the pool
+ */
+void candid_render_target_pool_destroy(Candid_RenderTargetPool *pool,
+                                       Candid_RenderTargetDestroyFn destroy,
+                                       void *context);
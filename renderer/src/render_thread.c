@@ -0,0 +1,298 @@
+/**
+ * @file render_thread.c
+ * @brief Render thread and lock-free SPSC command ring
+ *
+ * The ring stores 16-byte aligned records addressed by free-running 32-bit
+ * positions. The producer owns `write`, the consumer owns `consumed`; each
+ * side only reads the other's published position, so no locks are taken on
+ * the command path. Semaphores are used solely to park a side that has
+ * nothing to do, guarded by "waiting" flags so the common case never makes a
+ * system call.
+ */
+
+#include "render_thread.h"
+
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+
+#define RING_ALIGNMENT 16u
+#define RING_MIN_SIZE (64u * 1024u)
+#define RING_MAX_SIZE (1u << 30)
+
+enum {
+  RECORD_PAD,   /**< Skips to the end of the ring */
+  RECORD_FENCE, /**< Marks `value` as reached */
+  RECORD_QUIT,  /**< Stops the thread */
+};
+
+typedef struct Candid_RenderRecord {
+  uint32_t type;
+  uint32_t size; /**< Total record size, header included */
+  uint64_t value;
+} Candid_RenderRecord;
+
+/*******************************************************************************
+ * Internal Structures
+ ******************************************************************************/
+
+struct Candid_RenderThread {
+  SDL_Thread *thread;
+  Candid_RenderCommandFn fn;
+  void *user_data;
+
+  uint8_t *ring;
+  uint32_t capacity;
+  uint32_t mask;
+
+  /* Producer state */
+  uint32_t write;
+  uint32_t pending; /**< Size of the reserved, unpublished record */
+  uint64_t next_fence;
+
+  /* Shared positions */
+  SDL_AtomicU32 published;
+  SDL_AtomicU32 consumed;
+
+  /* Parking */
+  SDL_AtomicInt producer_waiting;
+  SDL_AtomicInt consumer_waiting;
+  SDL_Semaphore *work;
+  SDL_Semaphore *space;
+
+  /* Fence completion */
+  SDL_Mutex *fence_mutex;
+  SDL_Condition *fence_reached;
+  uint64_t completed_fence;
+};
+
+/*******************************************************************************
+ * Consumer
+ ******************************************************************************/
+
+static void complete_fence(Candid_RenderThread *rt, uint64_t value) {
+  SDL_LockMutex(rt->fence_mutex);
+  rt->completed_fence = value;
+  SDL_BroadcastCondition(rt->fence_reached);
+  SDL_UnlockMutex(rt->fence_mutex);
+}
+
+static int render_thread_main(void *data) {
+  Candid_RenderThread *rt = data;
+  uint32_t read = 0;
+  bool quit = false;
+
+  while (!quit) {
+    uint32_t end = SDL_GetAtomicU32(&rt->published);
+    if (read == end) {
+      SDL_SetAtomicInt(&rt->consumer_waiting, 1);
+      if (SDL_GetAtomicU32(&rt->published) == read)
+        SDL_WaitSemaphore(rt->work);
+      SDL_SetAtomicInt(&rt->consumer_waiting, 0);
+      continue;
+    }
+
+    while (read != end) {
+      const Candid_RenderRecord *record =
+          (const Candid_RenderRecord *)(rt->ring + (read & rt->mask));
+
+      switch (record->type) {
+      case RECORD_PAD:
+        break;
+      case RECORD_FENCE:
+        complete_fence(rt, record->value);
+        break;
+      case RECORD_QUIT:
+        quit = true;
+        break;
+      default:
+        rt->fn(rt->user_data, record->type, record + 1);
+        break;
+      }
+
+      read += record->size;
+      SDL_SetAtomicU32(&rt->consumed, read);
+      if (SDL_GetAtomicInt(&rt->producer_waiting))
+        SDL_SignalSemaphore(rt->space);
+    }
+  }
+
+  return 0;
+}
+
+/*******************************************************************************
+ * Producer
+ ******************************************************************************/
+
+static void wake_consumer(Candid_RenderThread *rt) {
+  if (SDL_GetAtomicInt(&rt->consumer_waiting))
+    SDL_SignalSemaphore(rt->work);
+}
+
+static void wait_for_space(Candid_RenderThread *rt, uint32_t needed) {
+  while (rt->write + needed - SDL_GetAtomicU32(&rt->consumed) > rt->capacity) {
+    SDL_SetAtomicInt(&rt->producer_waiting, 1);
+    /* The consumer may be parked until the next fence; everything up to
+     * `write` is published, so let it drain now. */
+    SDL_SignalSemaphore(rt->work);
+    if (rt->write + needed - SDL_GetAtomicU32(&rt->consumed) > rt->capacity)
+      SDL_WaitSemaphore(rt->space);
+    SDL_SetAtomicInt(&rt->producer_waiting, 0);
+  }
+}
+
+static Candid_RenderRecord *push_record(Candid_RenderThread *rt,
+                                        uint32_t type, uint32_t payload_size,
+                                        uint64_t value) {
+  if (payload_size > rt->capacity / 2)
+    return NULL;
+
+  uint32_t size = (uint32_t)sizeof(Candid_RenderRecord) + payload_size;
+  size = (size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+  if (size > rt->capacity / 2)
+    return NULL;
+
+  /* Records never straddle the end of the ring */
+  uint32_t offset = rt->write & rt->mask;
+  uint32_t contiguous = rt->capacity - offset;
+  wait_for_space(rt, size <= contiguous ? size : contiguous + size);
+
+  if (size > contiguous) {
+    Candid_RenderRecord *pad = (Candid_RenderRecord *)(rt->ring + offset);
+    pad->type = RECORD_PAD;
+    pad->size = contiguous;
+    pad->value = 0;
+    rt->write += contiguous;
+    offset = 0;
+  }
+
+  Candid_RenderRecord *record = (Candid_RenderRecord *)(rt->ring + offset);
+  record->type = type;
+  record->size = size;
+  record->value = value;
+  rt->pending = size;
+  return record;
+}
+
+void *candid_render_thread_push(Candid_RenderThread *thread, uint32_t type,
+                                uint32_t payload_size) {
+  if (!thread || type < CANDID_RENDER_THREAD_FIRST_COMMAND)
+    return NULL;
+
+  Candid_RenderRecord *record = push_record(thread, type, payload_size, 0);
+  return record ? record + 1 : NULL;
+}
+
+void candid_render_thread_publish(Candid_RenderThread *thread) {
+  if (!thread || thread->pending == 0)
+    return;
+
+  thread->write += thread->pending;
+  thread->pending = 0;
+  SDL_SetAtomicU32(&thread->published, thread->write);
+}
+
+/*******************************************************************************
+ * Fences
+ ******************************************************************************/
+
+uint64_t candid_render_thread_insert_fence(Candid_RenderThread *thread) {
+  if (!thread)
+    return 0;
+
+  uint64_t value = ++thread->next_fence;
+  push_record(thread, RECORD_FENCE, 0, value);
+  candid_render_thread_publish(thread);
+  wake_consumer(thread);
+  return value;
+}
+
+void candid_render_thread_wait_fence(Candid_RenderThread *thread,
+                                     uint64_t fence) {
+  if (!thread)
+    return;
+
+  SDL_LockMutex(thread->fence_mutex);
+  while (thread->completed_fence < fence)
+    SDL_WaitCondition(thread->fence_reached, thread->fence_mutex);
+  SDL_UnlockMutex(thread->fence_mutex);
+}
+
+bool candid_render_thread_fence_reached(Candid_RenderThread *thread,
+                                        uint64_t fence) {
+  if (!thread)
+    return true;
+
+  SDL_LockMutex(thread->fence_mutex);
+  bool reached = thread->completed_fence >= fence;
+  SDL_UnlockMutex(thread->fence_mutex);
+  return reached;
+}
+
+/*******************************************************************************
+ * Lifecycle
+ ******************************************************************************/
+
+static void release(Candid_RenderThread *rt) {
+  SDL_DestroyCondition(rt->fence_reached);
+  SDL_DestroyMutex(rt->fence_mutex);
+  SDL_DestroySemaphore(rt->space);
+  SDL_DestroySemaphore(rt->work);
+  free(rt->ring);
+  free(rt);
+}
+
+Candid_Result candid_render_thread_create(uint32_t ring_size,
+                                          Candid_RenderCommandFn fn,
+                                          void *user_data,
+                                          Candid_RenderThread **out) {
+  if (!fn || !out || ring_size > RING_MAX_SIZE)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  uint32_t capacity = RING_MIN_SIZE;
+  while (capacity < ring_size)
+    capacity *= 2;
+
+  Candid_RenderThread *rt = calloc(1, sizeof(Candid_RenderThread));
+  if (!rt)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  rt->fn = fn;
+  rt->user_data = user_data;
+  rt->capacity = capacity;
+  rt->mask = capacity - 1;
+  rt->ring = malloc(capacity);
+  if (!rt->ring) {
+    free(rt);
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  }
+
+  rt->work = SDL_CreateSemaphore(0);
+  rt->space = SDL_CreateSemaphore(0);
+  rt->fence_mutex = SDL_CreateMutex();
+  rt->fence_reached = SDL_CreateCondition();
+  if (!rt->work || !rt->space || !rt->fence_mutex || !rt->fence_reached) {
+    release(rt);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  rt->thread = SDL_CreateThread(render_thread_main, "candid_render", rt);
+  if (!rt->thread) {
+    release(rt);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = rt;
+  return CANDID_SUCCESS;
+}
+
+void candid_render_thread_destroy(Candid_RenderThread *thread) {
+  if (!thread)
+    return;
+
+  push_record(thread, RECORD_QUIT, 0, 0);
+  candid_render_thread_publish(thread);
+  SDL_SignalSemaphore(thread->work);
+  SDL_WaitThread(thread->thread, NULL);
+
+  release(thread);
+}
@@ -0,0 +1,79 @@
+/**
+ * @file render_thread.h
+ * @brief Internal render thread fed by a single-producer command ring
+ *
+ * Not part of the public API. One producer thread (the thread calling the
+ * renderer API) appends variable-sized commands to a lock-free ring; a
+ * dedicated thread consumes them in order and hands each one to a callback.
+ * Fences are ordinary commands: the producer can wait until the consumer has
+ * executed everything recorded before a fence.
+ */
+
+#pragma once
+
+#include <candid/types.h>
+
+/**
+ * First command type available to users of the ring (lower values are
+ * reserved for padding, fences and shutdown)
+ */
+#define CANDID_RENDER_THREAD_FIRST_COMMAND 16u
+
+typedef struct Candid_RenderThread Candid_RenderThread;
+
+/**
+ * Command callback, invoked on the render thread
+ * @param type Command type passed to candid_render_thread_push
+ * @param payload Command payload (valid for the duration of the call)
+ */
+typedef void (*Candid_RenderCommandFn)(void *user_data, uint32_t type,
+                                       const void *payload);
+
+/**
+ * Start a render thread
+ * @param ring_size Ring capacity in bytes (rounded up to a power of two)
+ * @param fn Command callback
+ * @param user_data Passed to fn
+ * @param out Output render thread
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result candid_render_thread_create(uint32_t ring_size,
+                                          Candid_RenderCommandFn fn,
+                                          void *user_data,
+                                          Candid_RenderThread **out);
+
+/**
+ * Execute every queued command, then stop and join the thread
+ */
+void candid_render_thread_destroy(Candid_RenderThread *thread);
+
+/**
+ * Reserve space for a command. Blocks while the ring is full. The returned
+ * payload must be filled in before candid_render_thread_publish.
+ * @return Payload storage, or NULL if the command can never fit the ring
+ */
+void *candid_render_thread_push(Candid_RenderThread *thread, uint32_t type,
+                                uint32_t payload_size);
+
+/**
+ * Make the command returned by the last push visible to the render thread
+ */
+void candid_render_thread_publish(Candid_RenderThread *thread);
+
+/**
+ * Queue a fence after every published command and wake the render thread
+ * @return Fence value, increasing by one per call
+ */
+uint64_t candid_render_thread_insert_fence(Candid_RenderThread *thread);
+
+/**
+ * Block until the render thread has executed the given fence
+ */
+void candid_render_thread_wait_fence(Candid_RenderThread *thread,
+                                     uint64_t fence);
+
+/**
+ * Whether the render thread has executed the given fence
+ */
+bool candid_render_thread_fence_reached(Candid_RenderThread *thread,
+                                        uint64_t fence);
@@ -3,6 +3,20 @@
  * @brief High-level renderer API implementation
  */
 
+#include "bindless.h"
+#include "builtin_shaders.h"
+#include "draw_merge.h"
+#include "frame_pacer.h"
+#include "geometry_heap.h"
+#include "graph_compile.h"
+#include "jobs.h"
+#include "pipeline_list.h"
+#include "render_target_pool.h"
+#include "render_thread.h"
+#include "shader_permutation.h"
+#include "upload.h"
+
+#include <SDL3/SDL.h>
 #include <candid/renderer.h>
 #include <math.h>
 #include <stdlib.h>
@@ -12,6 +26,22 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+#define CANDID_MAX_FRAMES_IN_FLIGHT 3
+#define DEFAULT_COMMAND_RING_SIZE (8u << 20)
+
+/* Column-major a * b */
+static Candid_Mat4 mat4_multiply(const Candid_Mat4 *a, const Candid_Mat4 *b) {
+  Candid_Mat4 out;
+  for (int c = 0; c < 4; ++c) {
+    for (int r = 0; r < 4; ++r) {
+      out.m[c * 4 + r] =
+          a->m[r] * b->m[c * 4] + a->m[4 + r] * b->m[c * 4 + 1] +
+          a->m[8 + r] * b->m[c * 4 + 2] + a->m[12 + r] * b->m[c * 4 + 3];
+    }
+  }
+  return out;
+}
+
 /*******************************************************************************
  * Renderer Structure
  ******************************************************************************/
@@ -26,10 +56,666 @@ struct Candid_Renderer {
   float time;
   float delta_time;
   uint64_t frame_count;
+  uint64_t start_ns;       /**< SDL_GetTicksNS at creation */
+  uint64_t frame_start_ns; /**< When the current frame was let through */
   uint32_t width;
   uint32_t height;
+  bool indirect_draw; /**< The device reports supports_indirect_draw */
+
+  /* Frame pacing */
+  Candid_FramePacer pacer;
+  bool just_in_time;
+  bool frame_waited; /**< wait_frame ran since the last begin_frame */
+
+  /* Frame recording (caller's thread) */
+  bool recording;    /**< Between begin_frame and end_frame */
+  bool pass_started; /**< A draw or render state was recorded this frame */
+  Candid_Mat4 previous_view_projection; /**< For occlusion culling */
+
+  /* Depth pyramid, rebuilt at the end of every frame when enabled */
+  bool depth_pyramid;
+  bool pyramid_ready; /**< A frame has been built into `pyramid` */
+  Candid_Texture *pyramid;
+  Candid_Buffer *pyramid_scratch;
+  size_t pyramid_scratch_size;
+  uint32_t pyramid_width;
+  uint32_t pyramid_height;
+  uint32_t frames_in_flight;
+  uint32_t upload_slot;
+  uint32_t upload_slot_count;
+  Candid_FrameUpload uploads[CANDID_MAX_UPLOAD_SLOTS];
+  Candid_RenderTargetPool render_targets;
+  /* Last async compute submission; used where the command buffer lives */
+  Candid_SyncPoint async_compute;
+  Candid_GeometryHeap geometry; /**< Shared and pulled meshes */
+  size_t geometry_defrag_budget;
+  Candid_Bindless bindless; /**< Texture and material tables, if enabled */
+
+  /* Command execution (render thread when threaded, caller otherwise) */
+  Candid_CommandBuffer *cmd;
+  bool in_render_pass;
+  bool pass_pending; /**< Frame pass not begun yet (compute may still run) */
+  Candid_Color pass_clear_color;
+
+  /* Threaded submission */
+  Candid_RenderThread *render_thread;
+  Candid_Fence last_frame_fence;
+  Candid_Fence immediate_fence; /**< Fence counter without a render thread */
+  SDL_AtomicInt thread_result;  /**< First failure since the last end_frame */
+
+  /* Draw lists, double-buffered by frame parity: the render thread may still
+   * be executing last frame's submissions while this frame's accumulate. */
+  SDL_Mutex *draw_list_mutex;
+  Candid_JobSystem *jobs; /**< Created with the first draw list */
+  Candid_DrawListRef *submitted[2];
+  uint32_t submitted_count[2];
+  uint32_t submitted_capacity[2];
+  Candid_DrawMerge merge;
+
+  Candid_BuiltinShaders builtins;
+  Candid_PipelineList *pipelines; /**< NULL without pipeline_list_path */
 };
 
+/*******************************************************************************
+ * Render Thread Commands
+ ******************************************************************************/
+
+enum {
+  RENDER_CMD_BEGIN_FRAME = CANDID_RENDER_THREAD_FIRST_COMMAND,
+  RENDER_CMD_END_FRAME,
+  RENDER_CMD_RESIZE,
+  RENDER_CMD_SET_VIEWPORT,
+  RENDER_CMD_SET_SCISSOR,
+  RENDER_CMD_DRAW_MESH,
+  RENDER_CMD_DRAW_INSTANCED,
+  RENDER_CMD_DRAW_INDIRECT,
+  RENDER_CMD_CULL,
+  RENDER_CMD_EXECUTE_RENDER_GRAPH,
+  RENDER_CMD_ASYNC_COMPUTE,
+  RENDER_CMD_WAIT_ASYNC_COMPUTE,
+  RENDER_CMD_MOVE_GEOMETRY,
+  RENDER_CMD_EXECUTE_DRAW_LISTS,
+  RENDER_CMD_SET_TEXTURE_SLOT,
+  RENDER_CMD_UPLOAD_MATERIALS,
+  RENDER_CMD_DESTROY,
+};
+
+typedef enum Candid_ResourceKind {
+  RESOURCE_BUFFER,
+  RESOURCE_TEXTURE,
+  RESOURCE_SAMPLER,
+  RESOURCE_SHADER_MODULE,
+  RESOURCE_SHADER_PROGRAM,
+  RESOURCE_MESH,
+  RESOURCE_MATERIAL,
+  RESOURCE_HEAP,
+} Candid_ResourceKind;
+
+typedef struct Candid_RenderCmdBeginFrame {
+  Candid_Color clear_color;
+} Candid_RenderCmdBeginFrame;
+
+typedef struct Candid_RenderCmdEndFrame {
+  Candid_ShaderProgram *pyramid_kernel; /**< NULL to skip the depth pyramid */
+  Candid_Texture *pyramid;
+  Candid_Buffer *pyramid_scratch;
+  size_t pyramid_scratch_size;
+  uint32_t pyramid_width;
+  uint32_t pyramid_height;
+} Candid_RenderCmdEndFrame;
+
+typedef struct Candid_RenderCmdResize {
+  uint32_t width;
+  uint32_t height;
+} Candid_RenderCmdResize;
+
+typedef struct Candid_RenderCmdViewport {
+  float x, y, width, height;
+} Candid_RenderCmdViewport;
+
+typedef struct Candid_RenderCmdScissor {
+  int32_t x, y;
+  uint32_t width, height;
+} Candid_RenderCmdScissor;
+
+typedef struct Candid_RenderCmdDrawMesh {
+  Candid_Mesh *mesh;
+  Candid_Material *material;
+  bool has_transform;
+  Candid_Mat4 transform; /**< Copied: the caller may reuse its matrix */
+} Candid_RenderCmdDrawMesh;
+
+typedef struct Candid_RenderCmdDrawInstanced {
+  Candid_Mesh *mesh;
+  Candid_Material *material;
+  Candid_Buffer *buffer;
+  size_t offset;
+  uint32_t instance_count;
+  Candid_InstanceFormat format;
+  bool quantized;
+  Candid_InstanceQuantization quantization;
+} Candid_RenderCmdDrawInstanced;
+
+typedef struct Candid_RenderCmdDrawIndirect {
+  Candid_Mesh *mesh;
+  Candid_Material *material;
+  Candid_IndirectDraw draw; /**< quantization points into this command */
+  Candid_InstanceQuantization quantization;
+} Candid_RenderCmdDrawIndirect;
+
+/* Uniform layout of CullParams in shaders/culling.hlsl */
+typedef struct Candid_CullParams {
+  Candid_Vec4 planes[6];
+  Candid_Mat4 occlusion_view_projection;
+  uint32_t object_count;
+  uint32_t instance_format;
+  uint32_t occlusion;
+  uint32_t padding;
+} Candid_CullParams;
+
+/* Bindings of shaders/culling.hlsl */
+enum {
+  CULL_SLOT_PARAMS = 0,
+  CULL_SLOT_OBJECTS = 1,
+  CULL_SLOT_ARGS = 2,
+  CULL_SLOT_INSTANCE_PARAMS = 3,
+  CULL_SLOT_COUNT = 4,
+  CULL_SLOT_DEPTH_PYRAMID = 5,
+  CULL_SLOT_INSTANCES = 8,
+  CULL_GROUP_SIZE = 64,
+};
+
+/* Bindings and tiling of shaders/hiz.hlsl */
+enum {
+  HIZ_SLOT_DEPTH = 0,
+  HIZ_SLOT_PYRAMID = 1,
+  HIZ_SLOT_SCRATCH = 2,
+  HIZ_MAX_LEVELS = 16,
+  HIZ_TILE = 32,
+  HIZ_GROUP_LEVELS = 6,
+};
+
+typedef struct Candid_RenderCmdCull {
+  Candid_ShaderProgram *kernel;
+  Candid_CullDesc desc; /**< quantization is not dereferenced */
+  Candid_Buffer *params;
+  size_t params_offset;
+  Candid_Buffer *instance_params;
+  size_t instance_params_offset;
+} Candid_RenderCmdCull;
+
+typedef struct Candid_RenderCmdAsyncCompute {
+  Candid_ComputeRecordFn record;
+  void *user_data;
+  uint32_t flags; /**< Candid_AsyncComputeFlags */
+} Candid_RenderCmdAsyncCompute;
+
+typedef struct Candid_RenderCmdMoveGeometry {
+  uint32_t count;
+  Candid_GeometryMove moves[];
+} Candid_RenderCmdMoveGeometry;
+
+typedef struct Candid_RenderCmdDrawLists {
+  const Candid_DrawListRef *refs;
+  uint32_t count;
+  uint32_t upload_slot;
+} Candid_RenderCmdDrawLists;
+
+typedef struct Candid_RenderCmdTextureSlot {
+  Candid_Texture *texture; /**< NULL clears the slot */
+  uint32_t index;
+} Candid_RenderCmdTextureSlot;
+
+typedef struct Candid_RenderCmdUploadMaterials {
+  Candid_Buffer *staging;
+  uint32_t count;
+  Candid_BindlessCopy copies[];
+} Candid_RenderCmdUploadMaterials;
+
+typedef struct Candid_RenderCmdDestroy {
+  Candid_ResourceKind kind;
+  void *resource;
+} Candid_RenderCmdDestroy;
+
+/*******************************************************************************
+ * Command Execution
+ ******************************************************************************/
+
+/* These run wherever the command buffer lives: on the render thread in
+ * threaded mode, inline on the caller's thread otherwise. */
+
+static void record_failure(Candid_Renderer *renderer, Candid_Result result) {
+  if (result != CANDID_SUCCESS)
+    SDL_CompareAndSwapAtomicInt(&renderer->thread_result, CANDID_SUCCESS,
+                                (int)result);
+}
+
+static Candid_Result exec_begin_frame(Candid_Renderer *renderer,
+                                      const Candid_Color *clear_color) {
+  Candid_Result result =
+      renderer->backend->cmd_begin(renderer->device, &renderer->cmd);
+  if (result != CANDID_SUCCESS) {
+    renderer->cmd = NULL;
+    return result;
+  }
+
+  /* The pass begins with the first draw so compute work (culling) can be
+   * recorded ahead of it */
+  renderer->pass_pending = true;
+  renderer->pass_clear_color = *clear_color;
+  return CANDID_SUCCESS;
+}
+
+/**
+ * Begin the frame's render pass if it has not begun yet
+ * @return Whether a render pass is active
+ */
+static bool begin_pass(Candid_Renderer *renderer) {
+  if (!renderer->pass_pending)
+    return renderer->in_render_pass;
+  renderer->pass_pending = false;
+
+  /* A failed pass (e.g. no drawable while minimized) still leaves the command
+   * buffer open so end_frame can retire it; draws are skipped meanwhile. */
+  Candid_Result result = renderer->backend->cmd_begin_render_pass(
+      renderer->cmd, &renderer->pass_clear_color, 1.0f, 0);
+  renderer->in_render_pass = (result == CANDID_SUCCESS);
+  if (renderer->in_render_pass) {
+    renderer->backend->cmd_bind_pipeline(renderer->cmd, NULL, NULL, NULL,
+                                         NULL);
+    if (renderer->bindless.textures)
+      renderer->backend->cmd_bind_bindless(renderer->cmd,
+                                           renderer->bindless.textures,
+                                           renderer->bindless.materials);
+  }
+  record_failure(renderer, result);
+  return renderer->in_render_pass;
+}
+
+static void exec_cull(Candid_Renderer *renderer,
+                      const Candid_RenderCmdCull *c) {
+  const Candid_BackendInterface *backend = renderer->backend;
+  Candid_CommandBuffer *cmd = renderer->cmd;
+  const Candid_CullDesc *desc = &c->desc;
+  if (!cmd || !renderer->pass_pending)
+    return;
+
+  /* Records past the count stay zeroed for backends that issue all of them */
+  backend->cmd_clear_buffer(cmd, desc->count, desc->count_offset,
+                            sizeof(uint32_t));
+  backend->cmd_clear_buffer(cmd, desc->args, desc->args_offset,
+                            desc->object_count *
+                                sizeof(Candid_DrawIndexedIndirectCommand));
+
+  backend->cmd_bind_compute_program(cmd, c->kernel);
+  backend->cmd_bind_uniform_buffer(cmd, CULL_SLOT_PARAMS, c->params,
+                                   c->params_offset,
+                                   sizeof(Candid_CullParams));
+  backend->cmd_bind_uniform_buffer(cmd, CULL_SLOT_INSTANCE_PARAMS,
+                                   c->instance_params,
+                                   c->instance_params_offset,
+                                   sizeof(Candid_InstanceQuantization));
+  backend->cmd_bind_storage_buffer(
+      cmd, CULL_SLOT_OBJECTS, desc->objects, desc->objects_offset,
+      desc->object_count * sizeof(Candid_CullObject));
+  backend->cmd_bind_storage_buffer(
+      cmd, CULL_SLOT_INSTANCES, desc->instances, desc->instance_offset,
+      desc->object_count * candid_instance_format_size(desc->format));
+  backend->cmd_bind_storage_buffer(
+      cmd, CULL_SLOT_ARGS, desc->args, desc->args_offset,
+      desc->object_count * sizeof(Candid_DrawIndexedIndirectCommand));
+  backend->cmd_bind_storage_buffer(cmd, CULL_SLOT_COUNT, desc->count,
+                                   desc->count_offset, sizeof(uint32_t));
+  if (desc->depth_pyramid)
+    backend->cmd_bind_texture(cmd, CULL_SLOT_DEPTH_PYRAMID,
+                              desc->depth_pyramid, NULL);
+
+  backend->cmd_dispatch(
+      cmd, (desc->object_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+static bool begin_graph_pass(void *context) { return begin_pass(context); }
+
+/* Passes outside the frame's render pass need it not to have begun */
+static void exec_render_graph(Candid_Renderer *renderer,
+                              const Candid_GraphFrame *frame) {
+  if (!renderer->cmd || !renderer->pass_pending)
+    return;
+  candid_graph_frame_execute(frame, renderer->backend, renderer->device,
+                             renderer->cmd, begin_graph_pass, renderer);
+}
+
+static void exec_async_compute(Candid_Renderer *renderer,
+                               const Candid_RenderCmdAsyncCompute *c) {
+  const Candid_BackendInterface *backend = renderer->backend;
+  Candid_ComputeContext context = {.backend = backend,
+                                   .device = renderer->device};
+  Candid_Result result = CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+  if (backend->cmd_begin_compute)
+    result = backend->cmd_begin_compute(renderer->device, &context.cmd);
+
+  /* Without a compute queue, the frame runs the work ahead of its pass */
+  if (result == CANDID_ERROR_BACKEND_NOT_SUPPORTED) {
+    context.cmd = renderer->cmd;
+    if (context.cmd && renderer->pass_pending)
+      c->record(&context, c->user_data);
+    return;
+  }
+  if (result != CANDID_SUCCESS) {
+    record_failure(renderer, result);
+    return;
+  }
+
+  if (c->flags & CANDID_ASYNC_COMPUTE_AFTER_GRAPHICS) {
+    Candid_SyncPoint graphics =
+        backend->queue_get_sync_point(renderer->device, CANDID_QUEUE_GRAPHICS);
+    backend->cmd_wait(context.cmd, &graphics);
+  }
+  c->record(&context, c->user_data);
+  result = backend->cmd_end(renderer->device, context.cmd);
+  if (result == CANDID_SUCCESS)
+    result = backend->cmd_submit_compute(renderer->device, context.cmd,
+                                         &renderer->async_compute);
+  record_failure(renderer, result);
+}
+
+static void exec_wait_async_compute(Candid_Renderer *renderer) {
+  if (renderer->cmd && renderer->pass_pending && renderer->backend->cmd_wait)
+    renderer->backend->cmd_wait(renderer->cmd, &renderer->async_compute);
+}
+
+/* Reduce this frame's depth buffer into the pyramid, in a single dispatch */
+static void exec_depth_pyramid(Candid_Renderer *renderer,
+                               const Candid_RenderCmdEndFrame *c) {
+  const Candid_BackendInterface *backend = renderer->backend;
+  Candid_CommandBuffer *cmd = renderer->cmd;
+  Candid_Texture *depth =
+      backend->swapchain_get_depth_texture(renderer->device);
+  if (!depth)
+    return;
+
+  backend->cmd_clear_buffer(cmd, c->pyramid_scratch, 0, sizeof(uint32_t));
+  backend->cmd_bind_compute_program(cmd, c->pyramid_kernel);
+  backend->cmd_bind_texture(cmd, HIZ_SLOT_DEPTH, depth, NULL);
+  backend->cmd_bind_storage_texture(cmd, HIZ_SLOT_PYRAMID, c->pyramid);
+  backend->cmd_bind_storage_buffer(cmd, HIZ_SLOT_SCRATCH, c->pyramid_scratch,
+                                   0, c->pyramid_scratch_size);
+  backend->cmd_dispatch(cmd, (c->pyramid_width + HIZ_TILE - 1) / HIZ_TILE,
+                        (c->pyramid_height + HIZ_TILE - 1) / HIZ_TILE, 1);
+}
+
+static Candid_Result exec_end_frame(Candid_Renderer *renderer,
+                                    const Candid_RenderCmdEndFrame *c) {
+  Candid_Result result = CANDID_SUCCESS;
+  if (renderer->cmd) {
+    /* An empty frame still clears */
+    if (begin_pass(renderer)) {
+      renderer->backend->cmd_end_render_pass(renderer->cmd);
+      renderer->in_render_pass = false;
+      if (c->pyramid_kernel)
+        exec_depth_pyramid(renderer, c);
+    }
+    renderer->backend->cmd_end(renderer->device, renderer->cmd);
+    result = renderer->backend->cmd_submit(renderer->device, renderer->cmd);
+    renderer->cmd = NULL;
+    renderer->in_render_pass = false;
+  }
+
+  Candid_Result present =
+      renderer->backend->swapchain_present(renderer->device);
+  return result != CANDID_SUCCESS ? result : present;
+}
+
+/* Ranges sliding down over themselves are copied in non-overlapping pieces,
+ * lowest first */
+static void copy_range(const Candid_BackendInterface *backend,
+                       Candid_CommandBuffer *cmd, Candid_Buffer *buffer,
+                       size_t source, size_t destination, size_t size) {
+  size_t piece = size;
+  if (destination < source && source - destination < size)
+    piece = source - destination;
+  for (size_t done = 0; done < size; done += piece) {
+    size_t length = size - done < piece ? size - done : piece;
+    backend->cmd_copy_buffer(cmd, buffer, source + done, buffer,
+                             destination + done, length);
+  }
+}
+
+/**
+ * Copy compacted shared geometry, then point the moved meshes at it. Runs
+ * before the frame's pass so every draw after it reads the new ranges.
+ */
+static void exec_move_geometry(Candid_Renderer *renderer,
+                               const Candid_GeometryMove *moves,
+                               uint32_t count) {
+  const Candid_BackendInterface *backend = renderer->backend;
+  Candid_CommandBuffer *cmd = renderer->cmd;
+  /* Without the frame's command buffer the device is lost anyway */
+  if (!cmd || !renderer->pass_pending)
+    return;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const Candid_GeometryMove *move = &moves[i];
+    if (move->vertex_size)
+      copy_range(backend, cmd, move->placement.vertex_buffer,
+                 move->vertex_source, move->vertex_destination,
+                 move->vertex_size);
+    if (move->index_size)
+      copy_range(backend, cmd, move->placement.index_buffer,
+                 move->index_source, move->index_destination,
+                 move->index_size);
+    backend->mesh_set_placement(move->mesh, &move->placement);
+  }
+}
+
+/* Runs before the frame's pass, like geometry moves */
+static void exec_upload_materials(Candid_Renderer *renderer,
+                                  Candid_Buffer *staging,
+                                  const Candid_BindlessCopy *copies,
+                                  uint32_t count) {
+  if (!renderer->cmd || !renderer->pass_pending)
+    return;
+  for (uint32_t i = 0; i < count; ++i) {
+    renderer->backend->cmd_copy_buffer(renderer->cmd, staging,
+                                       copies[i].source,
+                                       renderer->bindless.materials,
+                                       copies[i].destination, copies[i].size);
+  }
+}
+
+static void exec_draw_lists(Candid_Renderer *renderer,
+                            const Candid_DrawListRef *refs, uint32_t count,
+                            uint32_t upload_slot) {
+  if (!begin_pass(renderer))
+    return;
+  candid_draw_merge_execute(&renderer->merge, renderer->backend,
+                            renderer->device, renderer->cmd, renderer->jobs,
+                            upload_slot, refs, count);
+}
+
+static void exec_destroy(Candid_Renderer *renderer, Candid_ResourceKind kind,
+                         void *resource) {
+  const Candid_BackendInterface *backend = renderer->backend;
+  switch (kind) {
+  case RESOURCE_BUFFER:
+    backend->buffer_destroy(renderer->device, resource);
+    break;
+  case RESOURCE_TEXTURE:
+    backend->texture_destroy(renderer->device, resource);
+    break;
+  case RESOURCE_SAMPLER:
+    backend->sampler_destroy(renderer->device, resource);
+    break;
+  case RESOURCE_SHADER_MODULE:
+    backend->shader_module_destroy(renderer->device, resource);
+    break;
+  case RESOURCE_SHADER_PROGRAM:
+    backend->shader_program_destroy(renderer->device, resource);
+    break;
+  case RESOURCE_MESH:
+    backend->mesh_destroy(renderer->device, resource);
+    break;
+  case RESOURCE_MATERIAL:
+    backend->material_destroy(renderer->device, resource);
+    break;
+  case RESOURCE_HEAP:
+    backend->heap_destroy(renderer->device, resource);
+    break;
+  }
+}
+
+static void execute_command(void *user_data, uint32_t type,
+                            const void *payload) {
+  Candid_Renderer *renderer = user_data;
+  const Candid_BackendInterface *backend = renderer->backend;
+
+  switch (type) {
+  case RENDER_CMD_BEGIN_FRAME: {
+    const Candid_RenderCmdBeginFrame *c = payload;
+    record_failure(renderer, exec_begin_frame(renderer, &c->clear_color));
+    break;
+  }
+  case RENDER_CMD_END_FRAME:
+    record_failure(renderer, exec_end_frame(renderer, payload));
+    break;
+  case RENDER_CMD_RESIZE: {
+    const Candid_RenderCmdResize *c = payload;
+    record_failure(renderer, backend->swapchain_resize(renderer->device,
+                                                       c->width, c->height));
+    break;
+  }
+  case RENDER_CMD_SET_VIEWPORT: {
+    const Candid_RenderCmdViewport *c = payload;
+    if (begin_pass(renderer))
+      backend->cmd_set_viewport(renderer->cmd, c->x, c->y, c->width,
+                                c->height, 0.0f, 1.0f);
+    break;
+  }
+  case RENDER_CMD_SET_SCISSOR: {
+    const Candid_RenderCmdScissor *c = payload;
+    if (begin_pass(renderer))
+      backend->cmd_set_scissor(renderer->cmd, c->x, c->y, c->width,
+                               c->height);
+    break;
+  }
+  case RENDER_CMD_DRAW_MESH: {
+    const Candid_RenderCmdDrawMesh *c = payload;
+    if (begin_pass(renderer))
+      backend->cmd_draw_mesh(renderer->cmd, c->mesh, c->material,
+                             c->has_transform ? &c->transform : NULL);
+    break;
+  }
+  case RENDER_CMD_DRAW_INSTANCED: {
+    const Candid_RenderCmdDrawInstanced *c = payload;
+    if (begin_pass(renderer))
+      backend->cmd_draw_mesh_instanced(
+          renderer->cmd, c->mesh, c->material, c->format, c->buffer,
+          c->offset, c->instance_count,
+          c->quantized ? &c->quantization : NULL);
+    break;
+  }
+  case RENDER_CMD_DRAW_INDIRECT: {
+    const Candid_RenderCmdDrawIndirect *c = payload;
+    if (begin_pass(renderer)) {
+      Candid_IndirectDraw draw = c->draw;
+      if (draw.quantization)
+        draw.quantization = &c->quantization;
+      backend->cmd_draw_mesh_indirect(renderer->cmd, c->mesh, c->material,
+                                      &draw);
+    }
+    break;
+  }
+  case RENDER_CMD_CULL:
+    exec_cull(renderer, payload);
+    break;
+  case RENDER_CMD_EXECUTE_RENDER_GRAPH:
+    exec_render_graph(renderer, payload);
+    break;
+  case RENDER_CMD_ASYNC_COMPUTE:
+    exec_async_compute(renderer, payload);
+    break;
+  case RENDER_CMD_WAIT_ASYNC_COMPUTE:
+    exec_wait_async_compute(renderer);
+    break;
+  case RENDER_CMD_MOVE_GEOMETRY: {
+    const Candid_RenderCmdMoveGeometry *c = payload;
+    exec_move_geometry(renderer, c->moves, c->count);
+    break;
+  }
+  case RENDER_CMD_EXECUTE_DRAW_LISTS: {
+    const Candid_RenderCmdDrawLists *c = payload;
+    exec_draw_lists(renderer, c->refs, c->count, c->upload_slot);
+    break;
+  }
+  case RENDER_CMD_SET_TEXTURE_SLOT: {
+    const Candid_RenderCmdTextureSlot *c = payload;
+    backend->texture_table_set(renderer->device, renderer->bindless.textures,
+                               c->index, c->texture);
+    break;
+  }
+  case RENDER_CMD_UPLOAD_MATERIALS: {
+    const Candid_RenderCmdUploadMaterials *c = payload;
+    exec_upload_materials(renderer, c->staging, c->copies, c->count);
+    break;
+  }
+  case RENDER_CMD_DESTROY: {
+    const Candid_RenderCmdDestroy *c = payload;
+    exec_destroy(renderer, c->kind, c->resource);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/**
+ * Reserve a command on the render thread ring (NULL when not threaded)
+ */
+static void *push_command(Candid_Renderer *renderer, uint32_t type,
+                          size_t size) {
+  if (!renderer->render_thread)
+    return NULL;
+  return candid_render_thread_push(renderer->render_thread, type,
+                                   (uint32_t)size);
+}
+
+static void destroy_resource(Candid_Renderer *renderer,
+                             Candid_ResourceKind kind, void *resource) {
+  if (!resource)
+    return;
+
+  /* Queued so the render thread never sees a resource freed under it */
+  Candid_RenderCmdDestroy *c =
+      push_command(renderer, RENDER_CMD_DESTROY, sizeof(*c));
+  if (c) {
+    c->kind = kind;
+    c->resource = resource;
+    candid_render_thread_publish(renderer->render_thread);
+    return;
+  }
+  if (renderer->render_thread)
+    candid_renderer_flush(renderer);
+  exec_destroy(renderer, kind, resource);
+}
+
+/* Table entries are written where the command buffer lives, ordered with
+ * the draws around them */
+static void set_texture_slot(Candid_Renderer *renderer, uint32_t index,
+                             Candid_Texture *texture) {
+  Candid_RenderCmdTextureSlot *c =
+      push_command(renderer, RENDER_CMD_SET_TEXTURE_SLOT, sizeof(*c));
+  if (c) {
+    c->texture = texture;
+    c->index = index;
+    candid_render_thread_publish(renderer->render_thread);
+    return;
+  }
+  if (renderer->render_thread)
+    candid_renderer_flush(renderer);
+  renderer->backend->texture_table_set(
+      renderer->device, renderer->bindless.textures, index, texture);
+}
+
 /*******************************************************************************
  * Renderer Lifecycle
  ******************************************************************************/
@@ -57,6 +743,24 @@ Candid_Result candid_renderer_create(const Candid_RendererConfig *config,
 
   renderer->backend_type = backend;
 
+  /* Loaded before the device, whose programs pre-warm from it */
+  if (config->pipeline_list_path) {
+    Candid_Result list_result = candid_pipeline_list_create(
+        config->pipeline_list_path, &renderer->pipelines);
+    if (list_result != CANDID_SUCCESS) {
+      free(renderer);
+      return list_result;
+    }
+  }
+
+  /* Upload slots rotate with the device's frames: a slot comes around again
+   * once the GPU is done with it */
+  renderer->frames_in_flight = config->max_frames_in_flight;
+  if (renderer->frames_in_flight == 0)
+    renderer->frames_in_flight = 2;
+  if (renderer->frames_in_flight > CANDID_MAX_FRAMES_IN_FLIGHT)
+    renderer->frames_in_flight = CANDID_MAX_FRAMES_IN_FLIGHT;
+
   /* Create device */
   Candid_DeviceDesc device_desc = {
       .preferred_backend = backend,
@@ -64,20 +768,41 @@ Candid_Result candid_renderer_create(const Candid_RendererConfig *config,
       .native_surface = config->native_surface,
       .width = config->width,
       .height = config->height,
-      .vsync = config->vsync,
+      .present_mode = config->present_mode,
+      .swapchain_image_count = config->swapchain_image_count,
       .debug_mode = config->debug_mode,
+      .max_frames_in_flight = renderer->frames_in_flight,
       .app_name = config->app_name,
+      .sampled_depth = config->depth_pyramid,
+      .pipeline_list = renderer->pipelines,
   };
 
   Candid_Result result =
       renderer->backend->device_create(&device_desc, &renderer->device);
   if (result != CANDID_SUCCESS) {
+    candid_pipeline_list_destroy(renderer->pipelines);
     free(renderer);
     return result;
   }
 
   renderer->width = config->width;
   renderer->height = config->height;
+  renderer->depth_pyramid = config->depth_pyramid;
+  Candid_DeviceLimits limits = {0};
+  renderer->indirect_draw =
+      renderer->backend->device_get_limits(renderer->device, &limits) ==
+          CANDID_SUCCESS &&
+      limits.supports_indirect_draw;
+  renderer->merge.indirect = renderer->indirect_draw;
+  candid_frame_pacer_init(&renderer->pacer, config->frame_rate_limit);
+  renderer->just_in_time = config->just_in_time;
+  renderer->start_ns = SDL_GetTicksNS();
+  renderer->frame_start_ns = renderer->start_ns;
+  /* The render thread runs one frame behind, holding one more slot busy */
+  renderer->upload_slot_count =
+      renderer->frames_in_flight + (config->threaded ? 1 : 0);
+  renderer->geometry.block_size = config->geometry_block_size;
+  renderer->geometry_defrag_budget = config->geometry_defrag_budget;
   renderer->clear_color = (Candid_Color){0.2f, 0.2f, 0.2f, 1.0f};
 
   /* Initialize matrices to identity */
@@ -93,17 +818,101 @@ Candid_Result candid_renderer_create(const Candid_RendererConfig *config,
   renderer->projection_matrix.m[10] = 1.0f;
   renderer->projection_matrix.m[15] = 1.0f;
 
+  /* Devices whose tables cannot be created keep binding per draw; only
+   * running out of memory fails the renderer */
+  if (config->bindless) {
+    result = candid_bindless_init(&renderer->bindless, renderer->backend,
+                                  renderer->device, config->bindless_textures,
+                                  config->bindless_materials);
+    if (result != CANDID_SUCCESS &&
+        result != CANDID_ERROR_BACKEND_NOT_SUPPORTED &&
+        result != CANDID_ERROR_OUT_OF_MEMORY) {
+      SDL_Log("Bindless tables unavailable (error %d), binding per draw",
+              result);
+      result = CANDID_SUCCESS;
+    }
+    if (result != CANDID_SUCCESS &&
+        result != CANDID_ERROR_BACKEND_NOT_SUPPORTED) {
+      renderer->backend->device_destroy(renderer->device);
+      candid_pipeline_list_destroy(renderer->pipelines);
+      free(renderer);
+      return result;
+    }
+  }
+
+  renderer->draw_list_mutex = SDL_CreateMutex();
+  if (!renderer->draw_list_mutex) {
+    candid_bindless_destroy(&renderer->bindless, renderer->backend,
+                            renderer->device);
+    renderer->backend->device_destroy(renderer->device);
+    candid_pipeline_list_destroy(renderer->pipelines);
+    free(renderer);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  if (config->threaded) {
+    uint32_t ring_size = config->command_ring_size
+                             ? config->command_ring_size
+                             : DEFAULT_COMMAND_RING_SIZE;
+    result = candid_render_thread_create(ring_size, execute_command, renderer,
+                                         &renderer->render_thread);
+    if (result != CANDID_SUCCESS) {
+      SDL_DestroyMutex(renderer->draw_list_mutex);
+      candid_bindless_destroy(&renderer->bindless, renderer->backend,
+                              renderer->device);
+      renderer->backend->device_destroy(renderer->device);
+      candid_pipeline_list_destroy(renderer->pipelines);
+      free(renderer);
+      return result;
+    }
+  }
+
   *out = renderer;
   return CANDID_SUCCESS;
 }
 
+/* The render thread is gone by then: textures are destroyed directly */
+static void destroy_render_target(void *context, Candid_Texture *texture) {
+  Candid_Renderer *renderer = context;
+  renderer->backend->texture_destroy(renderer->device, texture);
+}
+
 void candid_renderer_destroy(Candid_Renderer *renderer) {
   if (!renderer)
     return;
 
+  /* Drains every queued command, including deferred destruction */
+  candid_render_thread_destroy(renderer->render_thread);
+
+  candid_jobs_destroy(renderer->jobs);
+  if (renderer->pyramid)
+    renderer->backend->texture_destroy(renderer->device, renderer->pyramid);
+  if (renderer->pyramid_scratch)
+    renderer->backend->buffer_destroy(renderer->device,
+                                      renderer->pyramid_scratch);
+  candid_draw_merge_destroy(&renderer->merge, renderer->backend,
+                            renderer->device);
+  free(renderer->submitted[0]);
+  free(renderer->submitted[1]);
+  SDL_DestroyMutex(renderer->draw_list_mutex);
+
   if (renderer->backend && renderer->device) {
+    candid_render_target_pool_destroy(&renderer->render_targets,
+                                      destroy_render_target, renderer);
+    candid_geometry_heap_destroy(&renderer->geometry, renderer->backend,
+                                 renderer->device);
+    candid_bindless_destroy(&renderer->bindless, renderer->backend,
+                            renderer->device);
+    candid_builtin_shaders_destroy(&renderer->builtins, renderer->backend,
+                                   renderer->device);
+    for (uint32_t i = 0; i < CANDID_MAX_UPLOAD_SLOTS; ++i) {
+      candid_upload_destroy(renderer->backend, renderer->device,
+                            &renderer->uploads[i]);
+    }
     renderer->backend->device_destroy(renderer->device);
   }
+  /* After the device, so that no program is left to cancel its pipelines */
+  candid_pipeline_list_destroy(renderer->pipelines);
 
   free(renderer);
 }
@@ -116,6 +925,14 @@ Candid_Result candid_renderer_resize(Candid_Renderer *renderer, uint32_t width,
   renderer->width = width;
   renderer->height = height;
 
+  Candid_RenderCmdResize *c =
+      push_command(renderer, RENDER_CMD_RESIZE, sizeof(*c));
+  if (c) {
+    c->width = width;
+    c->height = height;
+    candid_render_thread_publish(renderer->render_thread);
+    return CANDID_SUCCESS;
+  }
   return renderer->backend->swapchain_resize(renderer->device, width, height);
 }
 
@@ -148,7 +965,31 @@ void candid_renderer_destroy_buffer(Candid_Renderer *renderer,
                                     Candid_Buffer *buffer) {
   if (!renderer)
     return;
-  renderer->backend->buffer_destroy(renderer->device, buffer);
+  destroy_resource(renderer, RESOURCE_BUFFER, buffer);
+}
+
+Candid_Result candid_renderer_update_buffer(Candid_Renderer *renderer,
+                                            Candid_Buffer *buffer,
+                                            size_t offset, const void *data,
+                                            size_t size) {
+  if (!renderer)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  return renderer->backend->buffer_update(renderer->device, buffer, offset,
+                                          data, size);
+}
+
+void *candid_renderer_map_buffer(Candid_Renderer *renderer,
+                                 Candid_Buffer *buffer) {
+  if (!renderer)
+    return NULL;
+  return renderer->backend->buffer_map(renderer->device, buffer);
+}
+
+void candid_renderer_unmap_buffer(Candid_Renderer *renderer,
+                                  Candid_Buffer *buffer) {
+  if (!renderer)
+    return;
+  renderer->backend->buffer_unmap(renderer->device, buffer);
 }
 
 Candid_Result candid_renderer_create_texture(Candid_Renderer *renderer,
@@ -156,14 +997,70 @@ Candid_Result candid_renderer_create_texture(Candid_Renderer *renderer,
                                              Candid_Texture **out) {
   if (!renderer)
     return CANDID_ERROR_INVALID_ARGUMENT;
-  return renderer->backend->texture_create(renderer->device, desc, out);
+  Candid_Result result =
+      renderer->backend->texture_create(renderer->device, desc, out);
+  if (result != CANDID_SUCCESS || !renderer->bindless.textures ||
+      !(desc->usage & CANDID_TEXTURE_USAGE_SAMPLED))
+    return result;
+
+  /* A full table leaves the texture usable through per-draw bindings */
+  uint32_t index = candid_bindless_add_texture(&renderer->bindless, *out);
+  if (index != CANDID_BINDLESS_INVALID_INDEX)
+    set_texture_slot(renderer, index, *out);
+  return CANDID_SUCCESS;
 }
 
 void candid_renderer_destroy_texture(Candid_Renderer *renderer,
                                      Candid_Texture *texture) {
   if (!renderer)
     return;
-  renderer->backend->texture_destroy(renderer->device, texture);
+  /* The slot is only reused once this frame slot comes around again */
+  uint32_t index = candid_bindless_remove_texture(
+      &renderer->bindless, texture, renderer->upload_slot);
+  if (index != CANDID_BINDLESS_INVALID_INDEX)
+    set_texture_slot(renderer, index, NULL);
+  destroy_resource(renderer, RESOURCE_TEXTURE, texture);
+}
+
+Candid_Result candid_renderer_acquire_render_target(
+    Candid_Renderer *renderer, const Candid_TextureDesc *desc,
+    Candid_Texture **out) {
+  if (!renderer || !desc || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  *out = candid_render_target_acquire(&renderer->render_targets, desc,
+                                      renderer->frame_count);
+  if (*out)
+    return CANDID_SUCCESS;
+
+  Candid_Result result = candid_renderer_create_texture(renderer, desc, out);
+  if (result != CANDID_SUCCESS)
+    return result;
+  result = candid_render_target_add(&renderer->render_targets, desc, *out);
+  if (result != CANDID_SUCCESS) {
+    candid_renderer_destroy_texture(renderer, *out);
+    *out = NULL;
+  }
+  return result;
+}
+
+void candid_renderer_release_render_target(Candid_Renderer *renderer,
+                                           Candid_Texture *texture) {
+  if (!renderer || !texture)
+    return;
+  candid_render_target_release(&renderer->render_targets, texture,
+                               renderer->frame_count);
+}
+
+/* Evicted targets may still be used by frames in flight */
+static void evict_render_target(void *context, Candid_Texture *texture) {
+  candid_renderer_destroy_texture(context, texture);
+}
+
+uint32_t candid_renderer_get_texture_index(Candid_Renderer *renderer,
+                                           Candid_Texture *texture) {
+  if (!renderer)
+    return CANDID_BINDLESS_INVALID_INDEX;
+  return candid_bindless_find_texture(&renderer->bindless, texture);
 }
 
 Candid_Result candid_renderer_create_sampler(Candid_Renderer *renderer,
@@ -178,7 +1075,7 @@ void candid_renderer_destroy_sampler(Candid_Renderer *renderer,
                                      Candid_Sampler *sampler) {
   if (!renderer)
     return;
-  renderer->backend->sampler_destroy(renderer->device, sampler);
+  destroy_resource(renderer, RESOURCE_SAMPLER, sampler);
 }
 
 Candid_Result
@@ -194,7 +1091,7 @@ void candid_renderer_destroy_shader_module(Candid_Renderer *renderer,
                                            Candid_ShaderModule *module) {
   if (!renderer)
     return;
-  renderer->backend->shader_module_destroy(renderer->device, module);
+  destroy_resource(renderer, RESOURCE_SHADER_MODULE, module);
 }
 
 Candid_Result
@@ -210,17 +1107,53 @@ void candid_renderer_destroy_shader_program(Candid_Renderer *renderer,
                                             Candid_ShaderProgram *program) {
   if (!renderer)
     return;
-  renderer->backend->shader_program_destroy(renderer->device, program);
+  destroy_resource(renderer, RESOURCE_SHADER_PROGRAM, program);
+}
+
+Candid_Result candid_renderer_create_shader_permutations(
+    Candid_Renderer *renderer, const Candid_ShaderPermutationDesc *desc,
+    Candid_ShaderPermutations **out) {
+  if (!renderer)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  Candid_ShaderSourceType target = CANDID_SHADER_SOURCE_SPIRV;
+  if (renderer->backend_type == CANDID_BACKEND_METAL)
+    target = CANDID_SHADER_SOURCE_MSL;
+  return candid_shader_permutations_create(
+      renderer->backend, renderer->device, target, desc, out);
+}
+
+static void release_variant(void *user_data, Candid_ShaderProgram *program,
+                            Candid_ShaderModule *vertex,
+                            Candid_ShaderModule *fragment) {
+  Candid_Renderer *renderer = user_data;
+  destroy_resource(renderer, RESOURCE_SHADER_PROGRAM, program);
+  destroy_resource(renderer, RESOURCE_SHADER_MODULE, fragment);
+  destroy_resource(renderer, RESOURCE_SHADER_MODULE, vertex);
+}
+
+void candid_renderer_destroy_shader_permutations(
+    Candid_Renderer *renderer, Candid_ShaderPermutations *permutations) {
+  if (!renderer)
+    return;
+  candid_shader_permutations_destroy(permutations, release_variant, renderer);
 }
 
 Candid_Result candid_renderer_get_builtin_shader(Candid_Renderer *renderer,
                                                  Candid_BuiltinShader shader,
                                                  Candid_ShaderProgram **out) {
-  (void)renderer;
-  (void)shader;
-  (void)out;
-  /* TODO: Implement built-in shader library */
-  return CANDID_ERROR_RESOURCE_CREATION;
+  if (!renderer)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  Candid_ShaderSourceType target = CANDID_SHADER_SOURCE_SPIRV;
+  if (renderer->backend_type == CANDID_BACKEND_METAL)
+    target = CANDID_SHADER_SOURCE_MSL;
+  return candid_builtin_shaders_get(&renderer->builtins, renderer->backend,
+                                    renderer->device, target, shader, out);
+}
+
+uint32_t candid_renderer_get_pending_pipelines(Candid_Renderer *renderer) {
+  if (!renderer)
+    return 0;
+  return candid_pipeline_list_get_pending(renderer->pipelines);
 }
 
 Candid_Result candid_renderer_create_mesh(Candid_Renderer *renderer,
@@ -228,14 +1161,49 @@ Candid_Result candid_renderer_create_mesh(Candid_Renderer *renderer,
                                           Candid_Mesh **out) {
   if (!renderer)
     return CANDID_ERROR_INVALID_ARGUMENT;
-  return renderer->backend->mesh_create(renderer->device, desc, out);
+  if (!desc || desc->storage == CANDID_MESH_STORAGE_DEDICATED)
+    return renderer->backend->mesh_create(renderer->device, desc, out);
+  /* Shared and pulled meshes are drawn as placed: a dedicated fallback
+   * would break pulling shaders and multi-draw batching */
+  if (!renderer->backend->mesh_create_placed)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+  return candid_geometry_heap_create_mesh(
+      &renderer->geometry, renderer->backend, renderer->device, desc, out);
 }
 
 void candid_renderer_destroy_mesh(Candid_Renderer *renderer,
                                   Candid_Mesh *mesh) {
   if (!renderer)
     return;
-  renderer->backend->mesh_destroy(renderer->device, mesh);
+  /* Shared ranges stay reserved until this frame slot comes around again */
+  candid_geometry_heap_release(&renderer->geometry, mesh,
+                               renderer->upload_slot);
+  destroy_resource(renderer, RESOURCE_MESH, mesh);
+}
+
+void candid_renderer_get_mesh_draw_info(Candid_Renderer *renderer,
+                                        Candid_Mesh *mesh,
+                                        Candid_MeshDrawInfo *out) {
+  if (!renderer || !mesh || !out)
+    return;
+  /* Shared meshes are patched on the render thread; the heap has the
+   * caller's view */
+  if (!candid_geometry_heap_get_draw_info(&renderer->geometry, mesh, out))
+    renderer->backend->mesh_get_draw_info(mesh, out);
+}
+
+uint32_t candid_renderer_get_geometry_moves(Candid_Renderer *renderer,
+                                            const Candid_MeshMove **out) {
+  if (!renderer || !out)
+    return 0;
+  return candid_geometry_heap_get_moves(&renderer->geometry, out);
+}
+
+void candid_renderer_get_geometry_stats(Candid_Renderer *renderer,
+                                        Candid_GeometryStats *out) {
+  if (!renderer || !out)
+    return;
+  candid_geometry_heap_get_stats(&renderer->geometry, out);
 }
 
 Candid_Result candid_renderer_create_material(Candid_Renderer *renderer,
@@ -243,24 +1211,292 @@ Candid_Result candid_renderer_create_material(Candid_Renderer *renderer,
                                               Candid_Material **out) {
   if (!renderer)
     return CANDID_ERROR_INVALID_ARGUMENT;
-  return renderer->backend->material_create(renderer->device, desc, out);
+  Candid_Result result =
+      renderer->backend->material_create(renderer->device, desc, out);
+  if (result != CANDID_SUCCESS || !renderer->bindless.textures)
+    return result;
+
+  /* Materials past the table's end draw with the default record */
+  uint32_t index = candid_bindless_add_material(&renderer->bindless, *out,
+                                                desc);
+  if (index != CANDID_BINDLESS_INVALID_INDEX)
+    renderer->backend->material_set_table_index(*out, index);
+  return CANDID_SUCCESS;
+}
+
+Candid_Result candid_renderer_create_material_instance(
+    Candid_Renderer *renderer, Candid_Material *base,
+    const Candid_MaterialOverrides *overrides, Candid_Material **out) {
+  if (!renderer || !base || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!renderer->backend->material_create_instance)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+  Candid_Result result =
+      renderer->backend->material_create_instance(renderer->device, base, out);
+  if (result != CANDID_SUCCESS || !renderer->bindless.textures ||
+      !overrides || overrides->mask == 0)
+    return result;
+
+  /* Instances without a record of their own draw with their base's */
+  uint32_t index = candid_bindless_add_instance(&renderer->bindless, *out,
+                                                base, overrides);
+  if (index != CANDID_BINDLESS_INVALID_INDEX)
+    renderer->backend->material_set_table_index(*out, index);
+  return CANDID_SUCCESS;
+}
+
+Candid_Result candid_renderer_update_material(Candid_Renderer *renderer,
+                                              Candid_Material *material,
+                                              const Candid_MaterialDesc *desc) {
+  if (!renderer || !material)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!renderer->bindless.materials)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+  return candid_bindless_update_material(&renderer->bindless, material, desc);
 }
 
 void candid_renderer_destroy_material(Candid_Renderer *renderer,
                                       Candid_Material *material) {
   if (!renderer)
     return;
-  renderer->backend->material_destroy(renderer->device, material);
+  candid_bindless_remove_material(&renderer->bindless, material,
+                                  renderer->upload_slot);
+  destroy_resource(renderer, RESOURCE_MATERIAL, material);
+}
+
+uint32_t candid_renderer_get_material_index(Candid_Renderer *renderer,
+                                            Candid_Material *material) {
+  if (!renderer)
+    return CANDID_BINDLESS_INVALID_INDEX;
+  uint32_t index = candid_bindless_find_material(&renderer->bindless, material);
+  if (index == CANDID_BINDLESS_INVALID_INDEX && material &&
+      renderer->backend->material_get_base)
+    index = candid_bindless_find_material(
+        &renderer->bindless, renderer->backend->material_get_base(material));
+  return index;
+}
+
+/*******************************************************************************
+ * Depth Pyramid
+ ******************************************************************************/
+
+static uint32_t floor_power_of_two(uint32_t value) {
+  uint32_t result = 1;
+  while (result <= value / 2)
+    result *= 2;
+  return result;
+}
+
+/* Level 5 is published by every workgroup; later levels are reduced from
+ * scratch by the last one (see shaders/hiz.hlsl) */
+static size_t depth_pyramid_scratch_size(uint32_t width, uint32_t height,
+                                         uint32_t levels) {
+  size_t words = 1;
+  for (uint32_t level = HIZ_GROUP_LEVELS - 1; level < levels; ++level) {
+    uint32_t w = width >> level ? width >> level : 1;
+    uint32_t h = height >> level ? height >> level : 1;
+    words += (size_t)w * h;
+  }
+  return words * sizeof(uint32_t);
+}
+
+/**
+ * Match the pyramid to the window size. Replaced resources are retired
+ * through the command stream; the new pyramid is empty until a frame ends.
+ */
+static void update_depth_pyramid(Candid_Renderer *renderer) {
+  if (renderer->width == 0 || renderer->height == 0)
+    return;
+
+  uint32_t width = floor_power_of_two(renderer->width);
+  uint32_t height = floor_power_of_two(renderer->height);
+  if (renderer->pyramid && width == renderer->pyramid_width &&
+      height == renderer->pyramid_height)
+    return;
+
+  destroy_resource(renderer, RESOURCE_TEXTURE, renderer->pyramid);
+  destroy_resource(renderer, RESOURCE_BUFFER, renderer->pyramid_scratch);
+  renderer->pyramid = NULL;
+  renderer->pyramid_scratch = NULL;
+  renderer->pyramid_ready = false;
+
+  uint32_t levels = 1;
+  while (levels < HIZ_MAX_LEVELS && (width | height) >> levels)
+    levels++;
+
+  Candid_TextureDesc texture_desc = {
+      .width = width,
+      .height = height,
+      .depth = 1,
+      .mip_levels = levels,
+      .array_layers = 1,
+      .format = CANDID_TEXTURE_FORMAT_R32_FLOAT,
+      .usage = CANDID_TEXTURE_USAGE_SAMPLED | CANDID_TEXTURE_USAGE_STORAGE,
+      .label = "Depth pyramid",
+  };
+  size_t scratch_size = depth_pyramid_scratch_size(width, height, levels);
+  Candid_BufferDesc scratch_desc = {
+      .size = scratch_size,
+      .usage = CANDID_BUFFER_USAGE_STORAGE,
+      .memory = CANDID_BUFFER_MEMORY_GPU_ONLY,
+      .label = "Depth pyramid scratch",
+  };
+
+  const Candid_BackendInterface *backend = renderer->backend;
+  if (backend->texture_create(renderer->device, &texture_desc,
+                              &renderer->pyramid) != CANDID_SUCCESS) {
+    renderer->pyramid = NULL;
+    return;
+  }
+  if (backend->buffer_create(renderer->device, &scratch_desc,
+                             &renderer->pyramid_scratch) != CANDID_SUCCESS) {
+    backend->texture_destroy(renderer->device, renderer->pyramid);
+    renderer->pyramid = NULL;
+    renderer->pyramid_scratch = NULL;
+    return;
+  }
+  renderer->pyramid_scratch_size = scratch_size;
+  renderer->pyramid_width = width;
+  renderer->pyramid_height = height;
+}
+
+Candid_Texture *candid_renderer_get_depth_pyramid(Candid_Renderer *renderer) {
+  if (!renderer || !renderer->pyramid_ready)
+    return NULL;
+  return renderer->pyramid;
+}
+
+/*******************************************************************************
+ * Geometry Compaction
+ ******************************************************************************/
+
+/* Old ranges are retired to this frame's slot, like destroyed meshes */
+static void move_geometry(Candid_Renderer *renderer) {
+  if (!renderer->geometry_defrag_budget ||
+      !renderer->backend->cmd_copy_buffer ||
+      !renderer->backend->mesh_set_placement)
+    return;
+
+  const Candid_GeometryMove *moves = NULL;
+  uint32_t count = candid_geometry_heap_defragment(
+      &renderer->geometry, renderer->geometry_defrag_budget,
+      renderer->upload_slot, &moves);
+  if (count == 0)
+    return;
+
+  Candid_RenderCmdMoveGeometry *c = push_command(
+      renderer, RENDER_CMD_MOVE_GEOMETRY,
+      sizeof(*c) + count * sizeof(Candid_GeometryMove));
+  if (c) {
+    c->count = count;
+    memcpy(c->moves, moves, count * sizeof(Candid_GeometryMove));
+    candid_render_thread_publish(renderer->render_thread);
+    return;
+  }
+  /* Too many moves for the ring: run them once the render thread idles */
+  if (renderer->render_thread)
+    candid_renderer_flush(renderer);
+  exec_move_geometry(renderer, moves, count);
+}
+
+/* Records changed since the last upload are copied into the material table
+ * ahead of the frame's pass */
+static void upload_materials(Candid_Renderer *renderer) {
+  Candid_Buffer *staging = NULL;
+  const Candid_BindlessCopy *copies = NULL;
+  uint32_t count = candid_bindless_stage_materials(
+      &renderer->bindless, renderer->backend, renderer->device,
+      &renderer->uploads[renderer->upload_slot], &staging, &copies);
+  if (count == 0)
+    return;
+
+  Candid_RenderCmdUploadMaterials *c = push_command(
+      renderer, RENDER_CMD_UPLOAD_MATERIALS,
+      sizeof(*c) + count * sizeof(Candid_BindlessCopy));
+  if (c) {
+    c->staging = staging;
+    c->count = count;
+    memcpy(c->copies, copies, count * sizeof(Candid_BindlessCopy));
+    candid_render_thread_publish(renderer->render_thread);
+    return;
+  }
+  if (renderer->render_thread)
+    candid_renderer_flush(renderer);
+  exec_upload_materials(renderer, staging, copies, count);
+}
+
+/**
+ * Note that the frame's pass begins with the next command. Material changes
+ * made after this show from the next frame.
+ */
+static void start_pass(Candid_Renderer *renderer) {
+  if (!renderer->pass_started)
+    upload_materials(renderer);
+  renderer->pass_started = true;
 }
 
 /*******************************************************************************
  * Frame Rendering
  ******************************************************************************/
 
+Candid_Result candid_renderer_wait_frame(Candid_Renderer *renderer) {
+  if (!renderer || renderer->recording)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (renderer->frame_waited)
+    return CANDID_SUCCESS;
+  renderer->frame_waited = true;
+
+  Candid_Result result = CANDID_SUCCESS;
+  if (renderer->just_in_time && renderer->backend->frame_wait) {
+    /* The render thread must be done with the device before it is waited
+     * on from here */
+    candid_renderer_flush(renderer);
+    result = renderer->backend->frame_wait(renderer->device);
+  }
+  candid_frame_pacer_wait(&renderer->pacer);
+
+  uint64_t now = SDL_GetTicksNS();
+  renderer->delta_time = (float)(now - renderer->frame_start_ns) * 1e-9f;
+  renderer->time = (float)(now - renderer->start_ns) * 1e-9f;
+  renderer->frame_start_ns = now;
+  return result;
+}
+
 Candid_Result candid_renderer_begin_frame(Candid_Renderer *renderer) {
-  if (!renderer)
+  if (!renderer || renderer->recording)
     return CANDID_ERROR_INVALID_ARGUMENT;
-  /* Frame tracking would happen here */
+
+  Candid_Result waited = candid_renderer_wait_frame(renderer);
+  renderer->frame_waited = false;
+  if (waited != CANDID_SUCCESS)
+    return waited;
+
+  renderer->recording = true;
+  renderer->pass_started = false;
+  if (renderer->depth_pyramid)
+    update_depth_pyramid(renderer);
+  renderer->upload_slot =
+      (uint32_t)(renderer->frame_count % renderer->upload_slot_count);
+  candid_upload_reset(renderer->backend, renderer->device,
+                      &renderer->uploads[renderer->upload_slot]);
+  candid_geometry_heap_reset(&renderer->geometry, renderer->upload_slot);
+  candid_bindless_reset(&renderer->bindless, renderer->upload_slot);
+
+  Candid_RenderCmdBeginFrame *c =
+      push_command(renderer, RENDER_CMD_BEGIN_FRAME, sizeof(*c));
+  if (c) {
+    c->clear_color = renderer->clear_color;
+    candid_render_thread_publish(renderer->render_thread);
+  } else {
+    /* Not recording: the next begin_frame retries the same slot */
+    Candid_Result result = exec_begin_frame(renderer, &renderer->clear_color);
+    if (result != CANDID_SUCCESS) {
+      renderer->recording = false;
+      return result;
+    }
+  }
+
+  move_geometry(renderer);
   return CANDID_SUCCESS;
 }
 
@@ -268,8 +1504,116 @@ Candid_Result candid_renderer_end_frame(Candid_Renderer *renderer) {
   if (!renderer)
     return CANDID_ERROR_INVALID_ARGUMENT;
 
-  renderer->frame_count++;
-  return renderer->backend->swapchain_present(renderer->device);
+  /* Close the frame's draw lists: workers submitting from now on fill the
+   * other parity, for the next frame */
+  SDL_LockMutex(renderer->draw_list_mutex);
+  uint64_t frame = renderer->frame_count;
+  uint32_t parity = (uint32_t)(frame & 1);
+  const Candid_DrawListRef *refs = renderer->submitted[parity];
+  uint32_t ref_count = renderer->submitted_count[parity];
+  renderer->submitted_count[parity] = 0;
+  renderer->frame_count = frame + 1;
+  SDL_UnlockMutex(renderer->draw_list_mutex);
+
+  uint32_t upload_slot = renderer->upload_slot;
+  start_pass(renderer);
+
+  Candid_RenderCmdEndFrame end = {0};
+  Candid_ShaderProgram *pyramid_kernel =
+      renderer->pyramid ? renderer->backend->get_compute_kernel(
+                              renderer->device,
+                              CANDID_COMPUTE_KERNEL_DOWNSAMPLE_DEPTH)
+                        : NULL;
+  if (pyramid_kernel) {
+    end = (Candid_RenderCmdEndFrame){
+        .pyramid_kernel = pyramid_kernel,
+        .pyramid = renderer->pyramid,
+        .pyramid_scratch = renderer->pyramid_scratch,
+        .pyramid_scratch_size = renderer->pyramid_scratch_size,
+        .pyramid_width = renderer->pyramid_width,
+        .pyramid_height = renderer->pyramid_height,
+    };
+    renderer->pyramid_ready = true;
+  }
+
+  renderer->recording = false;
+  candid_render_target_evict(&renderer->render_targets, frame,
+                             evict_render_target, renderer);
+  renderer->previous_view_projection =
+      mat4_multiply(&renderer->projection_matrix, &renderer->view_matrix);
+
+  if (!renderer->render_thread) {
+    if (ref_count > 0)
+      exec_draw_lists(renderer, refs, ref_count, upload_slot);
+    Candid_Result result = exec_end_frame(renderer, &end);
+    Candid_Result pass = (Candid_Result)SDL_SetAtomicInt(
+        &renderer->thread_result, CANDID_SUCCESS);
+    return result != CANDID_SUCCESS ? result : pass;
+  }
+
+  if (ref_count > 0) {
+    Candid_RenderCmdDrawLists *c =
+        push_command(renderer, RENDER_CMD_EXECUTE_DRAW_LISTS, sizeof(*c));
+    if (c) {
+      c->refs = refs;
+      c->count = ref_count;
+      c->upload_slot = upload_slot;
+      candid_render_thread_publish(renderer->render_thread);
+    } else {
+      candid_renderer_flush(renderer);
+      exec_draw_lists(renderer, refs, ref_count, upload_slot);
+    }
+  }
+
+  Candid_RenderCmdEndFrame *c =
+      push_command(renderer, RENDER_CMD_END_FRAME, sizeof(*c));
+  if (c) {
+    *c = end;
+    candid_render_thread_publish(renderer->render_thread);
+  } else {
+    candid_renderer_flush(renderer);
+    record_failure(renderer, exec_end_frame(renderer, &end));
+  }
+
+  /* Keep at most one frame queued: the render thread works on this frame
+   * while the caller builds the next one. */
+  Candid_Fence previous = renderer->last_frame_fence;
+  renderer->last_frame_fence =
+      candid_render_thread_insert_fence(renderer->render_thread);
+  candid_render_thread_wait_fence(renderer->render_thread, previous);
+
+  /* Failures surface one frame late, from the frame that just completed */
+  return (Candid_Result)SDL_SetAtomicInt(&renderer->thread_result,
+                                         CANDID_SUCCESS);
+}
+
+Candid_Fence candid_renderer_insert_fence(Candid_Renderer *renderer) {
+  if (!renderer)
+    return 0;
+  if (!renderer->render_thread)
+    return ++renderer->immediate_fence;
+  return candid_render_thread_insert_fence(renderer->render_thread);
+}
+
+void candid_renderer_wait_fence(Candid_Renderer *renderer, Candid_Fence fence) {
+  if (!renderer)
+    return;
+  candid_render_thread_wait_fence(renderer->render_thread, fence);
+}
+
+bool candid_renderer_is_fence_complete(Candid_Renderer *renderer,
+                                       Candid_Fence fence) {
+  if (!renderer)
+    return true;
+  return candid_render_thread_fence_reached(renderer->render_thread, fence);
+}
+
+void candid_renderer_flush(Candid_Renderer *renderer) {
+  if (!renderer || !renderer->render_thread)
+    return;
+  candid_render_thread_wait_fence(
+      renderer->render_thread,
+      candid_render_thread_insert_fence(renderer->render_thread));
 }
 
 void candid_renderer_set_clear_color(Candid_Renderer *renderer,
@@ -281,22 +1625,35 @@ void candid_renderer_set_clear_color(Candid_Renderer *renderer,
 
 void candid_renderer_set_viewport(Candid_Renderer *renderer, float x, float y,
                                   float width, float height) {
-  (void)renderer;
-  (void)x;
-  (void)y;
-  (void)width;
-  (void)height;
-  /* Stored for use in render pass */
+  if (!renderer || !renderer->recording)
+    return;
+
+  start_pass(renderer);
+  Candid_RenderCmdViewport *c =
+      push_command(renderer, RENDER_CMD_SET_VIEWPORT, sizeof(*c));
+  if (c) {
+    *c = (Candid_RenderCmdViewport){x, y, width, height};
+    candid_render_thread_publish(renderer->render_thread);
+  } else if (begin_pass(renderer)) {
+    renderer->backend->cmd_set_viewport(renderer->cmd, x, y, width, height,
+                                        0.0f, 1.0f);
+  }
 }
 
 void candid_renderer_set_scissor(Candid_Renderer *renderer, int32_t x,
                                  int32_t y, uint32_t width, uint32_t height) {
-  (void)renderer;
-  (void)x;
-  (void)y;
-  (void)width;
-  (void)height;
-  /* Stored for use in render pass */
+  if (!renderer || !renderer->recording)
+    return;
+
+  start_pass(renderer);
+  Candid_RenderCmdScissor *c =
+      push_command(renderer, RENDER_CMD_SET_SCISSOR, sizeof(*c));
+  if (c) {
+    *c = (Candid_RenderCmdScissor){x, y, width, height};
+    candid_render_thread_publish(renderer->render_thread);
+  } else if (begin_pass(renderer)) {
+    renderer->backend->cmd_set_scissor(renderer->cmd, x, y, width, height);
+  }
 }
 
 /*******************************************************************************
@@ -306,11 +1663,22 @@ void candid_renderer_set_scissor(Candid_Renderer *renderer, int32_t x,
 void candid_renderer_draw_mesh(Candid_Renderer *renderer, Candid_Mesh *mesh,
                                Candid_Material *material,
                                const Candid_Mat4 *transform) {
-  (void)renderer;
-  (void)mesh;
-  (void)material;
-  (void)transform;
-  /* TODO: Queue draw command */
+  if (!renderer || !renderer->recording || !mesh)
+    return;
+
+  start_pass(renderer);
+  Candid_RenderCmdDrawMesh *c =
+      push_command(renderer, RENDER_CMD_DRAW_MESH, sizeof(*c));
+  if (c) {
+    c->mesh = mesh;
+    c->material = material;
+    c->has_transform = transform != NULL;
+    if (transform)
+      c->transform = *transform;
+    candid_render_thread_publish(renderer->render_thread);
+  } else if (begin_pass(renderer)) {
+    renderer->backend->cmd_draw_mesh(renderer->cmd, mesh, material, transform);
+  }
 }
 
 void candid_renderer_draw_submesh(Candid_Renderer *renderer, Candid_Mesh *mesh,
@@ -325,17 +1693,322 @@ void candid_renderer_draw_submesh(Candid_Renderer *renderer, Candid_Mesh *mesh,
   /* TODO: Queue draw command */
 }
 
+static void draw_instanced(Candid_Renderer *renderer, Candid_Mesh *mesh,
+                           Candid_Material *material,
+                           Candid_InstanceFormat format, Candid_Buffer *buffer,
+                           size_t offset, uint32_t instance_count,
+                           const Candid_InstanceQuantization *quantization) {
+  start_pass(renderer);
+  Candid_RenderCmdDrawInstanced *c =
+      push_command(renderer, RENDER_CMD_DRAW_INSTANCED, sizeof(*c));
+  if (c) {
+    c->mesh = mesh;
+    c->material = material;
+    c->buffer = buffer;
+    c->offset = offset;
+    c->instance_count = instance_count;
+    c->format = format;
+    c->quantized = quantization != NULL;
+    if (quantization)
+      c->quantization = *quantization;
+    candid_render_thread_publish(renderer->render_thread);
+  } else if (begin_pass(renderer)) {
+    renderer->backend->cmd_draw_mesh_instanced(renderer->cmd, mesh, material,
+                                               format, buffer, offset,
+                                               instance_count, quantization);
+  }
+}
+
 void candid_renderer_draw_mesh_instanced(Candid_Renderer *renderer,
                                          Candid_Mesh *mesh,
                                          Candid_Material *material,
                                          const Candid_Mat4 *transforms,
                                          uint32_t instance_count) {
-  (void)renderer;
-  (void)mesh;
-  (void)material;
-  (void)transforms;
-  (void)instance_count;
-  /* TODO: Queue instanced draw command */
+  candid_renderer_draw_mesh_instanced_compact(
+      renderer, mesh, material, CANDID_INSTANCE_FORMAT_MAT4, transforms,
+      instance_count, NULL);
+}
+
+void candid_renderer_draw_mesh_instanced_compact(
+    Candid_Renderer *renderer, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, const void *instances,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization) {
+  if (!renderer || !renderer->recording || !mesh || !instances ||
+      instance_count == 0)
+    return;
+
+  size_t stride = candid_instance_format_size(format);
+  if (stride == 0 ||
+      (format == CANDID_INSTANCE_FORMAT_QUANTIZED && !quantization))
+    return;
+
+  Candid_Buffer *buffer = NULL;
+  size_t offset = 0;
+  void *data = NULL;
+  size_t size = stride * instance_count;
+  if (candid_upload_alloc(renderer->backend, renderer->device,
+                          &renderer->uploads[renderer->upload_slot], size,
+                          &buffer, &offset, &data) != CANDID_SUCCESS)
+    return;
+  memcpy(data, instances, size);
+
+  draw_instanced(renderer, mesh, material, format, buffer, offset,
+                 instance_count, quantization);
+}
+
+void candid_renderer_draw_mesh_instanced_buffer(
+    Candid_Renderer *renderer, Candid_Mesh *mesh, Candid_Material *material,
+    Candid_InstanceFormat format, Candid_Buffer *buffer, size_t offset,
+    uint32_t instance_count, const Candid_InstanceQuantization *quantization) {
+  if (!renderer || !renderer->recording || !mesh || !buffer ||
+      instance_count == 0)
+    return;
+  if (format >= CANDID_INSTANCE_FORMAT_COUNT ||
+      (format == CANDID_INSTANCE_FORMAT_QUANTIZED && !quantization))
+    return;
+
+  draw_instanced(renderer, mesh, material, format, buffer, offset,
+                 instance_count, quantization);
+}
+
+void candid_renderer_draw_mesh_indirect(Candid_Renderer *renderer,
+                                        Candid_Mesh *mesh,
+                                        Candid_Material *material,
+                                        const Candid_IndirectDraw *draw) {
+  if (!renderer || !renderer->recording || !renderer->indirect_draw ||
+      !mesh || !draw || !draw->args || !draw->instances ||
+      draw->max_draw_count == 0)
+    return;
+  if (draw->format >= CANDID_INSTANCE_FORMAT_COUNT ||
+      (draw->format == CANDID_INSTANCE_FORMAT_QUANTIZED &&
+       !draw->quantization))
+    return;
+
+  start_pass(renderer);
+  Candid_RenderCmdDrawIndirect *c =
+      push_command(renderer, RENDER_CMD_DRAW_INDIRECT, sizeof(*c));
+  if (c) {
+    c->mesh = mesh;
+    c->material = material;
+    c->draw = *draw;
+    if (draw->quantization)
+      c->quantization = *draw->quantization;
+    candid_render_thread_publish(renderer->render_thread);
+  } else if (begin_pass(renderer)) {
+    renderer->backend->cmd_draw_mesh_indirect(renderer->cmd, mesh, material,
+                                              draw);
+  }
+}
+
+/*******************************************************************************
+ * GPU Culling
+ ******************************************************************************/
+
+Candid_Result candid_renderer_cull(Candid_Renderer *renderer,
+                                   const Candid_CullDesc *desc) {
+  if (!renderer || !desc || !renderer->recording || renderer->pass_started)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (!desc->objects || !desc->instances || !desc->args || !desc->count ||
+      desc->object_count == 0 || desc->object_count > CANDID_CULL_MAX_OBJECTS)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (desc->format >= CANDID_INSTANCE_FORMAT_COUNT ||
+      (desc->format == CANDID_INSTANCE_FORMAT_QUANTIZED &&
+       !desc->quantization))
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_ShaderProgram *kernel = renderer->backend->get_compute_kernel(
+      renderer->device, CANDID_COMPUTE_KERNEL_CULL_INSTANCES);
+  if (!kernel)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  Candid_FrameUpload *upload = &renderer->uploads[renderer->upload_slot];
+  Candid_RenderCmdCull cull = {.kernel = kernel, .desc = *desc};
+  Candid_CullParams *params = NULL;
+  Candid_InstanceQuantization *quantization = NULL;
+  Candid_Result result = candid_upload_alloc(
+      renderer->backend, renderer->device, upload, sizeof(*params),
+      &cull.params, &cull.params_offset, (void **)&params);
+  if (result == CANDID_SUCCESS)
+    result = candid_upload_alloc(renderer->backend, renderer->device, upload,
+                                 sizeof(*quantization), &cull.instance_params,
+                                 &cull.instance_params_offset,
+                                 (void **)&quantization);
+  if (result != CANDID_SUCCESS)
+    return result;
+
+  Candid_Mat4 view_projection =
+      mat4_multiply(&renderer->projection_matrix, &renderer->view_matrix);
+  candid_frustum_planes(&view_projection, params->planes);
+  params->occlusion_view_projection = renderer->previous_view_projection;
+  params->object_count = desc->object_count;
+  params->instance_format = (uint32_t)desc->format;
+  /* The first frame has no pyramid matching previous_view_projection */
+  params->occlusion = desc->depth_pyramid && renderer->frame_count > 0;
+  params->padding = 0;
+  *quantization = desc->quantization ? *desc->quantization
+                                     : (Candid_InstanceQuantization){0};
+
+  Candid_RenderCmdCull *c = push_command(renderer, RENDER_CMD_CULL, sizeof(*c));
+  if (c) {
+    *c = cull;
+    candid_render_thread_publish(renderer->render_thread);
+  } else {
+    exec_cull(renderer, &cull);
+  }
+  return CANDID_SUCCESS;
+}
+
+/*******************************************************************************
+ * Draw Lists
+ ******************************************************************************/
+
+Candid_Result candid_renderer_create_draw_list(Candid_Renderer *renderer,
+                                               Candid_DrawList **out) {
+  if (!renderer || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  SDL_LockMutex(renderer->draw_list_mutex);
+  if (!renderer->jobs) {
+    /* Without workers, merged lists are simply recorded serially */
+    if (candid_jobs_create(0, &renderer->jobs) != CANDID_SUCCESS)
+      renderer->jobs = NULL;
+  }
+  SDL_UnlockMutex(renderer->draw_list_mutex);
+
+  return candid_draw_list_create(renderer->backend, renderer->device,
+                                 renderer->upload_slot_count, out);
+}
+
+void candid_renderer_destroy_draw_list(Candid_Renderer *renderer,
+                                       Candid_DrawList *list) {
+  if (!renderer || !list)
+    return;
+  candid_renderer_flush(renderer);
+  candid_draw_list_destroy(list);
+}
+
+void candid_renderer_submit_draw_list(Candid_Renderer *renderer,
+                                      Candid_DrawList *list) {
+  if (!renderer || !list)
+    return;
+
+  SDL_LockMutex(renderer->draw_list_mutex);
+
+  uint32_t parity = (uint32_t)(renderer->frame_count & 1);
+  uint32_t count = renderer->submitted_count[parity];
+  if (count == renderer->submitted_capacity[parity]) {
+    uint32_t capacity = count ? count * 2 : 16;
+    Candid_DrawListRef *refs = realloc(renderer->submitted[parity],
+                                       capacity * sizeof(Candid_DrawListRef));
+    if (!refs) {
+      SDL_UnlockMutex(renderer->draw_list_mutex);
+      return;
+    }
+    renderer->submitted[parity] = refs;
+    renderer->submitted_capacity[parity] = capacity;
+  }
+
+  if (candid_draw_list_take(list, &renderer->submitted[parity][count]))
+    renderer->submitted_count[parity] = count + 1;
+
+  SDL_UnlockMutex(renderer->draw_list_mutex);
+}
+
+/*******************************************************************************
+ * Render Graphs
+ ******************************************************************************/
+
+Candid_Result candid_renderer_create_render_graph(Candid_Renderer *renderer,
+                                                  Candid_RenderGraph **out) {
+  if (!renderer || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  return candid_render_graph_create(renderer->backend, renderer->device, out);
+}
+
+void candid_renderer_destroy_render_graph(Candid_Renderer *renderer,
+                                          Candid_RenderGraph *graph) {
+  if (!renderer || !graph)
+    return;
+  candid_renderer_flush(renderer);
+  candid_render_graph_destroy(graph);
+}
+
+/* Transient textures of a replaced plan go through the deferred destruction
+ * queue, behind the frames executing them */
+static void retire_transient(void *context, Candid_Texture *texture,
+                             Candid_Heap *heap) {
+  Candid_Renderer *renderer = context;
+  if (texture)
+    destroy_resource(renderer, RESOURCE_TEXTURE, texture);
+  if (heap)
+    destroy_resource(renderer, RESOURCE_HEAP, heap);
+}
+
+Candid_Result candid_renderer_execute_render_graph(Candid_Renderer *renderer,
+                                                   Candid_RenderGraph *graph) {
+  if (!renderer || !graph || !renderer->recording || renderer->pass_started)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_Result result =
+      candid_render_graph_compile(graph, retire_transient, renderer);
+  if (result != CANDID_SUCCESS)
+    return result;
+
+  /* Drawing into the backbuffer begins the frame's pass */
+  if (candid_render_graph_uses_frame_pass(graph))
+    start_pass(renderer);
+
+  size_t size = candid_render_graph_frame_size(graph);
+  Candid_GraphFrame *c =
+      push_command(renderer, RENDER_CMD_EXECUTE_RENDER_GRAPH, size);
+  if (c) {
+    candid_render_graph_write_frame(graph, c);
+    candid_render_thread_publish(renderer->render_thread);
+    return CANDID_SUCCESS;
+  }
+
+  const Candid_GraphFrame *frame = candid_render_graph_get_frame(graph);
+  if (!frame)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  /* Too large for the ring: run it once the render thread idles */
+  if (renderer->render_thread)
+    candid_renderer_flush(renderer);
+  exec_render_graph(renderer, frame);
+  return CANDID_SUCCESS;
+}
+
+/*******************************************************************************
+ * Async Compute
+ ******************************************************************************/
+
+Candid_Result candid_renderer_submit_async_compute(
+    Candid_Renderer *renderer, Candid_ComputeRecordFn record, void *user_data,
+    uint32_t flags) {
+  if (!renderer || !record || !renderer->recording || renderer->pass_started)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_RenderCmdAsyncCompute work = {
+      .record = record, .user_data = user_data, .flags = flags};
+  Candid_RenderCmdAsyncCompute *c =
+      push_command(renderer, RENDER_CMD_ASYNC_COMPUTE, sizeof(*c));
+  if (c) {
+    *c = work;
+    candid_render_thread_publish(renderer->render_thread);
+  } else {
+    exec_async_compute(renderer, &work);
+  }
+  return CANDID_SUCCESS;
+}
+
+Candid_Result candid_renderer_wait_async_compute(Candid_Renderer *renderer) {
+  if (!renderer || !renderer->recording || renderer->pass_started)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  if (push_command(renderer, RENDER_CMD_WAIT_ASYNC_COMPUTE, 0))
+    candid_render_thread_publish(renderer->render_thread);
+  else
+    exec_wait_async_compute(renderer);
+  return CANDID_SUCCESS;
 }
 
 /*******************************************************************************
@@ -0,0 +1,424 @@
+/**
+ * @file shader.c
+ * @brief Runtime HLSL compilation and shader file loading
+ *
+ * HLSL is compiled in-process by the DXC library (see dxc.h), on a
+ * compiler of the calling thread's own, so compilations on several threads
+ * run in parallel. Without the library, the dxc executable is run instead.
+ * SPIR-V is cross-compiled to MSL by running SPIRV-Cross. Tools are found
+ * at the paths CMake detected, or on PATH, and read and write uniquely
+ * named temporary files. Results are kept in the shader cache (see
+ * shader_cache.h).
+ */
+
+#include "dxc.h"
+#include "jobs.h"
+#include "shader_cache.h"
+#include "shader_layout.h"
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef CANDID_DXC_EXECUTABLE
+#define CANDID_DXC_EXECUTABLE "dxc"
+#endif
+
+#ifndef CANDID_SPIRV_CROSS_EXECUTABLE
+#define CANDID_SPIRV_CROSS_EXECUTABLE "spirv-cross"
+#endif
+
+#define SHADER_STRINGIFY_(x) #x
+#define SHADER_STRINGIFY(x) SHADER_STRINGIFY_(x)
+
+/** Fixed arguments plus two per define and include path */
+#define SHADER_MAX_FIXED_ARGS 24
+
+/*******************************************************************************
+ * Temporary Files
+ ******************************************************************************/
+
+#ifdef CANDID_SHADER_COMPILATION
+
+static SDL_AtomicInt temp_counter;
+
+/** Unique across threads (thread id, counter) and processes (time) */
+static void temp_path(char *out, size_t size, const char *extension) {
+  snprintf(out, size, "%s/candid_%llx_%llx_%d%s",
+           candid_shader_temp_directory(),
+           (unsigned long long)SDL_GetTicksNS(),
+           (unsigned long long)SDL_GetCurrentThreadID(),
+           SDL_AddAtomicInt(&temp_counter, 1), extension);
+}
+
+/**
+ * Run a tool to completion
+ * @param output Receives the start of its output, null-terminated (NULL to
+ *        discard it)
+ * @return true when it exited with status 0
+ */
+static bool run_tool(const char *const *args, char *output,
+                     size_t output_size) {
+  if (output && output_size > 0)
+    output[0] = '\0';
+  SDL_Process *process = SDL_CreateProcess(args, true);
+  if (!process)
+    return false;
+
+  int exit_code = -1;
+  size_t size = 0;
+  char *data = SDL_ReadProcess(process, &size, &exit_code);
+  if (output && output_size > 0) {
+    if (size >= output_size)
+      size = output_size - 1;
+    if (data)
+      memcpy(output, data, size);
+    output[data ? size : 0] = '\0';
+  }
+  SDL_free(data);
+  SDL_DestroyProcess(process);
+  return exit_code == 0;
+}
+
+/**
+ * Versions of the DXC library (or executable) and of SPIRV-Cross, which are
+ * part of every cache key
+ * @return NULL when DXC can neither be loaded nor run
+ */
+static const char *compiler_version(void) {
+  static SDL_SpinLock lock;
+  static bool queried;
+  static bool found;
+  static char version[512];
+
+  SDL_LockSpinlock(&lock);
+  bool done = queried;
+  SDL_UnlockSpinlock(&lock);
+  if (done)
+    return found ? version : NULL;
+
+  /* Queried outside the lock; threads racing here get the same answer */
+  char output[512];
+  const char *dxc[] = {CANDID_DXC_EXECUTABLE, "--version", NULL};
+  const char *cross[] = {CANDID_SPIRV_CROSS_EXECUTABLE, "--revision", NULL};
+  bool ok = true;
+  if (candid_dxc_load())
+    snprintf(output, sizeof(output) / 2, "%s\n", candid_dxc_version());
+  else
+    ok = run_tool(dxc, output, sizeof(output) / 2);
+  size_t length = strlen(output);
+  if (!run_tool(cross, output + length, sizeof(output) - length))
+    output[length] = '\0';
+
+  SDL_LockSpinlock(&lock);
+  if (!queried) {
+    memcpy(version, output, sizeof(version));
+    found = ok;
+    queried = true;
+  }
+  SDL_UnlockSpinlock(&lock);
+  return found ? version : NULL;
+}
+
+static const char *default_profile(Candid_ShaderStage stage) {
+  switch (stage) {
+  case CANDID_SHADER_STAGE_VERTEX:
+    return "vs_6_0";
+  case CANDID_SHADER_STAGE_FRAGMENT:
+    return "ps_6_0";
+  case CANDID_SHADER_STAGE_COMPUTE:
+    return "cs_6_0";
+  case CANDID_SHADER_STAGE_GEOMETRY:
+    return "gs_6_0";
+  case CANDID_SHADER_STAGE_TESSELLATION:
+    return "hs_6_0";
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ * DXC
+ ******************************************************************************/
+
+/**
+ * Arguments for DXC, without the input and output files
+ * @param args Room for SHADER_MAX_FIXED_ARGS plus two per define and
+ *        include path
+ * @param level Holds the optimization argument
+ * @return The argument count, 0 without a profile for the stage
+ */
+static uint32_t dxc_arguments(const Candid_ShaderCompileOptions *options,
+                              bool spirv, const char **args, char level[4]) {
+  const char *profile = options->target_profile
+                            ? options->target_profile
+                            : default_profile(options->stage);
+  if (!profile)
+    return 0;
+
+  snprintf(level, 4, "-Od");
+  if (options->optimize) {
+    uint32_t o = options->optimization_level > 3 ? 3
+                                                 : options->optimization_level;
+    snprintf(level, 4, "-O%u", o);
+  }
+
+  uint32_t n = 0;
+  args[n++] = "-T";
+  args[n++] = profile;
+  args[n++] = "-E";
+  args[n++] = options->entry_point ? options->entry_point : "main";
+  args[n++] = level;
+  if (options->enable_debug)
+    args[n++] = "-Zi";
+  if (spirv) {
+    /* Register ranges apart, as shader_layout.h expects */
+    args[n++] = "-spirv";
+    args[n++] = "-fvk-t-shift";
+    args[n++] = SHADER_STRINGIFY(CANDID_SHADER_BINDING_SHIFT_T);
+    args[n++] = "0";
+    args[n++] = "-fvk-s-shift";
+    args[n++] = SHADER_STRINGIFY(CANDID_SHADER_BINDING_SHIFT_S);
+    args[n++] = "0";
+    args[n++] = "-fvk-u-shift";
+    args[n++] = SHADER_STRINGIFY(CANDID_SHADER_BINDING_SHIFT_U);
+    args[n++] = "0";
+  }
+  for (uint32_t i = 0; i < options->define_count; ++i) {
+    args[n++] = "-D";
+    args[n++] = options->defines[i];
+  }
+  for (uint32_t i = 0; i < options->include_path_count; ++i) {
+    args[n++] = "-I";
+    args[n++] = options->include_paths[i];
+  }
+  return n;
+}
+
+/* Run the dxc executable on temporary files */
+static Candid_Result run_dxc(const char *source, size_t source_size,
+                             const char **args, uint32_t arg_count,
+                             bool spirv, Candid_ShaderBytecode *out) {
+  char input[512], output[512];
+  temp_path(input, sizeof(input), ".hlsl");
+  temp_path(output, sizeof(output), spirv ? ".spv" : ".dxil");
+  if (!SDL_SaveFile(input, source, source_size))
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  /* args has room for these around the options */
+  memmove(args + 1, args, arg_count * sizeof(const char *));
+  uint32_t n = arg_count + 1;
+  args[0] = CANDID_DXC_EXECUTABLE;
+  args[n++] = "-Fo";
+  args[n++] = output;
+  args[n++] = input;
+  args[n] = NULL;
+
+  Candid_Result result = CANDID_ERROR_SHADER_COMPILATION;
+  if (run_tool(args, NULL, 0)) {
+    size_t size = 0;
+    void *data = SDL_LoadFile(output, &size);
+    if (data) {
+      out->data = data;
+      out->size = size;
+      result = CANDID_SUCCESS;
+    }
+  }
+  SDL_RemovePath(input);
+  SDL_RemovePath(output);
+  return result;
+}
+
+/* HLSL to SPIR-V or DXIL, in-process when the DXC library is available */
+static Candid_Result compile_dxc(const char *source, size_t source_size,
+                                 const Candid_ShaderCompileOptions *options,
+                                 bool spirv, Candid_ShaderBytecode *out) {
+  uint32_t capacity = SHADER_MAX_FIXED_ARGS +
+                      2 * (options->define_count + options->include_path_count);
+  const char **args = calloc(capacity, sizeof(const char *));
+  if (!args)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  char level[4];
+  uint32_t n = dxc_arguments(options, spirv, args, level);
+  Candid_Result result;
+  if (n == 0)
+    result = CANDID_ERROR_INVALID_ARGUMENT;
+  else if (candid_dxc_load())
+    result = candid_dxc_compile(source, source_size, args, n,
+                                options->include_paths,
+                                options->include_path_count, out);
+  else
+    result = run_dxc(source, source_size, args, n, spirv, out);
+  free(args);
+  return result;
+}
+
+/* SPIR-V to MSL, through temporary files */
+static Candid_Result translate_msl(const Candid_ShaderBytecode *spirv,
+                                   Candid_ShaderBytecode *out) {
+  char input[512], output[512];
+  temp_path(input, sizeof(input), ".spv");
+  temp_path(output, sizeof(output), ".metal");
+  if (!SDL_SaveFile(input, spirv->data, spirv->size))
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  const char *args[] = {CANDID_SPIRV_CROSS_EXECUTABLE,
+                        input,
+                        "--msl",
+                        "--output",
+                        output,
+                        NULL};
+  Candid_Result result = CANDID_ERROR_SHADER_COMPILATION;
+  if (run_tool(args, NULL, 0)) {
+    /* SDL_LoadFile null-terminates, so MSL output is usable as a string */
+    size_t size = 0;
+    void *data = SDL_LoadFile(output, &size);
+    if (data) {
+      out->data = data;
+      out->size = size;
+      result = CANDID_SUCCESS;
+    }
+  }
+  SDL_RemovePath(input);
+  SDL_RemovePath(output);
+  return result;
+}
+
+#endif /* CANDID_SHADER_COMPILATION */
+
+/*******************************************************************************
+ * Public API
+ ******************************************************************************/
+
+Candid_Result
+candid_shader_compile_hlsl(const char *source, size_t source_size,
+                           const Candid_ShaderCompileOptions *options,
+                           Candid_ShaderBytecode *out_bytecode) {
+  if (!source || !options || !out_bytecode)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  memset(out_bytecode, 0, sizeof(*out_bytecode));
+
+#ifdef CANDID_SHADER_COMPILATION
+  Candid_ShaderSourceType target = options->target;
+  if (target == CANDID_SHADER_SOURCE_HLSL)
+    target = CANDID_SHADER_SOURCE_SPIRV;
+  if (target != CANDID_SHADER_SOURCE_SPIRV &&
+      target != CANDID_SHADER_SOURCE_MSL &&
+      target != CANDID_SHADER_SOURCE_DXIL)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  if (source_size == 0)
+    source_size = strlen(source);
+
+  Candid_ShaderCacheKey key;
+  const char *version = compiler_version();
+  bool cached = version && candid_shader_cache_key(source, source_size,
+                                                   options, target, version,
+                                                   &key);
+  if (cached && candid_shader_cache_load(&key, out_bytecode))
+    return CANDID_SUCCESS;
+
+  Candid_ShaderBytecode compiled = {0};
+  Candid_Result result =
+      compile_dxc(source, source_size, options,
+                  target != CANDID_SHADER_SOURCE_DXIL, &compiled);
+  if (result == CANDID_SUCCESS && target == CANDID_SHADER_SOURCE_MSL) {
+    result = translate_msl(&compiled, out_bytecode);
+    SDL_free((void *)compiled.data);
+  } else if (result == CANDID_SUCCESS) {
+    *out_bytecode = compiled;
+  }
+  if (result == CANDID_SUCCESS)
+    out_bytecode->type = target;
+
+  if (result == CANDID_SUCCESS && cached)
+    candid_shader_cache_store(&key, out_bytecode);
+  return result;
+#else
+  (void)source_size;
+  return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+#endif
+}
+
+static void compile_jobs(void *user_data, uint32_t begin, uint32_t end) {
+  Candid_ShaderCompileJob *jobs = user_data;
+  for (uint32_t i = begin; i < end; ++i) {
+    jobs[i].result = candid_shader_compile_hlsl(
+        jobs[i].source, jobs[i].source_size, jobs[i].options,
+        &jobs[i].bytecode);
+  }
+}
+
+Candid_Result candid_shader_compile_hlsl_batch(Candid_ShaderCompileJob *jobs,
+                                               uint32_t job_count,
+                                               uint32_t thread_count) {
+  if (!jobs && job_count > 0)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  /* The calling thread compiles too; workers only live for the batch, and
+   * release their compilers when they exit */
+  Candid_JobSystem *pool = NULL;
+  if (thread_count != 1 && job_count > 1 &&
+      candid_jobs_create(thread_count ? thread_count - 1 : 0, &pool) !=
+          CANDID_SUCCESS)
+    pool = NULL;
+  candid_jobs_parallel_for(pool, job_count, 1, compile_jobs, jobs);
+  candid_jobs_destroy(pool);
+
+  for (uint32_t i = 0; i < job_count; ++i) {
+    if (jobs[i].result != CANDID_SUCCESS)
+      return jobs[i].result;
+  }
+  return CANDID_SUCCESS;
+}
+
+void candid_shader_free_bytecode(Candid_ShaderBytecode *bytecode) {
+  if (!bytecode)
+    return;
+  if (!candid_shader_cache_release(bytecode->data))
+    SDL_free((void *)bytecode->data);
+  memset(bytecode, 0, sizeof(*bytecode));
+}
+
+static bool has_extension(const char *path, const char *extension) {
+  size_t length = strlen(path);
+  size_t extension_length = strlen(extension);
+  return length >= extension_length &&
+         SDL_strcasecmp(path + length - extension_length, extension) == 0;
+}
+
+Candid_Result candid_shader_load_file(const char *path,
+                                      Candid_ShaderBytecode *out_bytecode) {
+  if (!path || !out_bytecode)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  memset(out_bytecode, 0, sizeof(*out_bytecode));
+
+  static const struct {
+    const char *extension;
+    Candid_ShaderSourceType type;
+  } types[] = {
+      {".spv", CANDID_SHADER_SOURCE_SPIRV},
+      {".metallib", CANDID_SHADER_SOURCE_METALLIB},
+      {".metal", CANDID_SHADER_SOURCE_MSL},
+      {".dxil", CANDID_SHADER_SOURCE_DXIL},
+      {".hlsl", CANDID_SHADER_SOURCE_HLSL},
+      {".glsl", CANDID_SHADER_SOURCE_GLSL},
+  };
+
+  size_t i = 0;
+  while (i < sizeof(types) / sizeof(types[0]) &&
+         !has_extension(path, types[i].extension))
+    ++i;
+  if (i == sizeof(types) / sizeof(types[0]))
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  size_t size = 0;
+  void *data = SDL_LoadFile(path, &size);
+  if (!data)
+    return CANDID_ERROR_RESOURCE_CREATION;
+
+  out_bytecode->data = data;
+  out_bytecode->size = size;
+  out_bytecode->type = types[i].type;
+  return CANDID_SUCCESS;
+}
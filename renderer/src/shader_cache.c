@@ -0,0 +1,620 @@
+/**
+ * @file shader_cache.c
+ * @brief Content-addressed cache of compiled shaders
+ */
+
+#include "shader_cache.h"
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <sys/utime.h>
+#include <windows.h>
+#define utime _utime
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+/** 'CSC1' */
+#define CACHE_MAGIC 0x31435343u
+
+/** Bumped whenever the key or entry layout changes */
+#define CACHE_FORMAT "candid-shader-cache-2"
+
+/** Distinct included files hashed per key, and include nesting */
+#define CACHE_MAX_INCLUDES 128
+#define CACHE_MAX_INCLUDE_DEPTH 16
+
+/** Eviction trims the cache to this fraction of its cap (in 1/4ths) */
+#define CACHE_EVICT_TARGET 3
+
+/** Temporary files older than this were left by a crashed writer */
+#define CACHE_STALE_TEMP_NS (3600ll * 1000000000ll)
+
+/*******************************************************************************
+ * Internal Structures
+ ******************************************************************************/
+
+/** Entry file: header, then `size` bytes of bytecode and a terminating 0 */
+typedef struct Candid_ShaderCacheHeader {
+  uint32_t magic;
+  uint32_t type; /**< Candid_ShaderSourceType */
+  uint64_t size;
+  uint64_t key[2]; /**< Guards against truncated or misnamed files */
+} Candid_ShaderCacheHeader;
+
+typedef struct Candid_ShaderCacheMapping {
+  const void *data; /**< Bytecode, past the header */
+  void *base;
+  size_t length;
+} Candid_ShaderCacheMapping;
+
+typedef struct Candid_ShaderCacheFile {
+  char *path;
+  uint64_t size;
+  SDL_Time modify_time;
+} Candid_ShaderCacheFile;
+
+typedef struct Candid_ShaderCacheScan {
+  Candid_ShaderCacheFile *files;
+  uint32_t count;
+  uint32_t capacity;
+  uint64_t total;
+  SDL_Time now;
+} Candid_ShaderCacheScan;
+
+typedef struct Candid_Hasher {
+  uint64_t a;
+  uint64_t b;
+} Candid_Hasher;
+
+static struct {
+  SDL_SpinLock lock;
+  bool configured;
+  bool disabled;
+  char directory[512];
+  uint64_t max_size;
+  uint64_t size; /**< Estimate of the directory's size */
+  bool size_known;
+
+  Candid_ShaderCacheMapping *mappings;
+  uint32_t mapping_count;
+  uint32_t mapping_capacity;
+} cache;
+
+static SDL_AtomicInt temp_counter;
+
+/*******************************************************************************
+ * Hashing
+ ******************************************************************************/
+
+/* Two independent 64-bit lanes: FNV-1a, and a multiply-xorshift */
+static void hash_bytes(Candid_Hasher *h, const void *data, size_t size) {
+  const uint8_t *bytes = data;
+  uint64_t a = h->a;
+  uint64_t b = h->b;
+  for (size_t i = 0; i < size; ++i) {
+    a = (a ^ bytes[i]) * 0x100000001b3ull;
+    b = (b + bytes[i]) * 0x9e3779b97f4a7c15ull;
+    b ^= b >> 29;
+  }
+  h->a = a;
+  h->b = b;
+}
+
+static void hash_u64(Candid_Hasher *h, uint64_t value) {
+  hash_bytes(h, &value, sizeof(value));
+}
+
+/* Length-prefixed, so consecutive strings cannot alias */
+static void hash_string(Candid_Hasher *h, const char *string) {
+  if (!string) {
+    hash_u64(h, UINT64_MAX);
+    return;
+  }
+  size_t length = strlen(string);
+  hash_u64(h, length);
+  hash_bytes(h, string, length);
+}
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+typedef struct Candid_IncludeScan {
+  Candid_Hasher *hasher;
+  const Candid_ShaderCompileOptions *options;
+  uint64_t visited[CACHE_MAX_INCLUDES]; /**< Hashes of resolved paths */
+  uint32_t visited_count;
+} Candid_IncludeScan;
+
+static void hash_includes(Candid_IncludeScan *scan, const char *text,
+                          size_t size, const char *directory,
+                          uint32_t depth);
+
+static bool visit(Candid_IncludeScan *scan, const char *path) {
+  Candid_Hasher h = {0};
+  hash_string(&h, path);
+  for (uint32_t i = 0; i < scan->visited_count; ++i) {
+    if (scan->visited[i] == h.a)
+      return false;
+  }
+  if (scan->visited_count == CACHE_MAX_INCLUDES)
+    return false;
+  scan->visited[scan->visited_count++] = h.a;
+  return true;
+}
+
+/** Resolve like DXC: the including file's directory, then -I paths */
+static void *load_include(Candid_IncludeScan *scan, const char *name,
+                          const char *directory, char *path,
+                          size_t path_size, size_t *out_size) {
+  uint32_t count = scan->options->include_path_count;
+  for (uint32_t i = directory ? 0 : 1; i <= count; ++i) {
+    const char *base = i == 0 ? directory : scan->options->include_paths[i - 1];
+    snprintf(path, path_size, "%s/%s", base, name);
+    void *data = SDL_LoadFile(path, out_size);
+    if (data)
+      return data;
+  }
+  return NULL;
+}
+
+static void hash_include(Candid_IncludeScan *scan, const char *name,
+                         const char *directory, uint32_t depth) {
+  hash_string(scan->hasher, name);
+
+  char path[1024];
+  size_t size = 0;
+  char *data =
+      load_include(scan, name, directory, path, sizeof(path), &size);
+  if (!data) {
+    /* DXC will fail on it too; the error is not worth caching around */
+    hash_u64(scan->hasher, UINT64_MAX);
+    return;
+  }
+
+  /* A file included twice (guards, #pragma once) adds nothing new */
+  if (visit(scan, path)) {
+    hash_u64(scan->hasher, size);
+    hash_bytes(scan->hasher, data, size);
+
+    char *slash = strrchr(path, '/');
+    char *backslash = strrchr(path, '\\');
+    if (backslash > slash)
+      slash = backslash;
+    if (slash)
+      *slash = '\0';
+    if (depth < CACHE_MAX_INCLUDE_DEPTH)
+      hash_includes(scan, data, size, slash ? path : ".", depth + 1);
+  }
+  SDL_free(data);
+}
+
+/* Every #include line counts, even under a false #if: hashing a file the
+ * compiler skips only costs a spurious miss when that file changes. */
+static void hash_includes(Candid_IncludeScan *scan, const char *text,
+                          size_t size, const char *directory,
+                          uint32_t depth) {
+  const char *end = text + size;
+  const char *line = text;
+  while (line < end) {
+    const char *eol = memchr(line, '\n', (size_t)(end - line));
+    if (!eol)
+      eol = end;
+
+    const char *p = line;
+    while (p < eol && (*p == ' ' || *p == '\t'))
+      ++p;
+    if (p < eol && *p == '#') {
+      ++p;
+      while (p < eol && (*p == ' ' || *p == '\t'))
+        ++p;
+      if (eol - p > 7 && strncmp(p, "include", 7) == 0) {
+        p += 7;
+        while (p < eol && (*p == ' ' || *p == '\t'))
+          ++p;
+        char close = '\0';
+        if (p < eol)
+          close = *p == '"' ? '"' : *p == '<' ? '>' : '\0';
+        const char *name = p + 1;
+        const char *name_end =
+            close ? memchr(name, close, (size_t)(eol - name)) : NULL;
+        char buffer[256];
+        if (name_end && (size_t)(name_end - name) < sizeof(buffer)) {
+          memcpy(buffer, name, (size_t)(name_end - name));
+          buffer[name_end - name] = '\0';
+          hash_include(scan, buffer, directory, depth);
+        }
+      }
+    }
+    line = eol + 1;
+  }
+}
+
+/*******************************************************************************
+ * Platform
+ ******************************************************************************/
+
+static bool map_file(const char *path, void **out_base, size_t *out_length) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  HANDLE mapping = NULL;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!mapping)
+    return false;
+  void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!base)
+    return false;
+  *out_length = (size_t)size.QuadPart;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  void *base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return false;
+  *out_length = (size_t)st.st_size;
+#endif
+  *out_base = base;
+  return true;
+}
+
+static void unmap_file(void *base, size_t length) {
+#ifdef _WIN32
+  (void)length;
+  UnmapViewOfFile(base);
+#else
+  munmap(base, length);
+#endif
+}
+
+/*******************************************************************************
+ * Configuration
+ ******************************************************************************/
+
+const char *candid_shader_temp_directory(void) {
+  static const char *const variables[] = {"TMPDIR", "TEMP", "TMP"};
+  SDL_Environment *env = SDL_GetEnvironment();
+  for (size_t i = 0; env && i < sizeof(variables) / sizeof(variables[0]);
+       ++i) {
+    const char *dir = SDL_GetEnvironmentVariable(env, variables[i]);
+    if (dir && dir[0])
+      return dir;
+  }
+  return "/tmp";
+}
+
+/* Called with the lock held */
+static Candid_Result configure(const Candid_ShaderCacheDesc *desc) {
+  cache.configured = true;
+  cache.disabled = desc && desc->disabled;
+  cache.max_size = desc && desc->max_size ? desc->max_size
+                                          : CANDID_SHADER_CACHE_DEFAULT_SIZE;
+  cache.size_known = false;
+  if (cache.disabled)
+    return CANDID_SUCCESS;
+
+  const char *directory = desc ? desc->directory : NULL;
+  if (!directory) {
+    SDL_Environment *env = SDL_GetEnvironment();
+    directory =
+        env ? SDL_GetEnvironmentVariable(env, "CANDID_SHADER_CACHE_DIR") : NULL;
+  }
+  if (directory && directory[0]) {
+    snprintf(cache.directory, sizeof(cache.directory), "%s", directory);
+  } else {
+    snprintf(cache.directory, sizeof(cache.directory),
+             "%s/candid_shader_cache", candid_shader_temp_directory());
+  }
+
+  if (!SDL_CreateDirectory(cache.directory)) {
+    cache.disabled = true;
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+  return CANDID_SUCCESS;
+}
+
+Candid_Result
+candid_shader_cache_configure(const Candid_ShaderCacheDesc *desc) {
+  SDL_LockSpinlock(&cache.lock);
+  Candid_Result result = configure(desc);
+  SDL_UnlockSpinlock(&cache.lock);
+  return result;
+}
+
+static bool cache_enabled(void) {
+  SDL_LockSpinlock(&cache.lock);
+  if (!cache.configured)
+    configure(NULL);
+  bool enabled = !cache.disabled;
+  SDL_UnlockSpinlock(&cache.lock);
+  return enabled;
+}
+
+static void entry_path(const Candid_ShaderCacheKey *key, char *out,
+                       size_t size) {
+  snprintf(out, size, "%s/%016llx%016llx.csc", cache.directory,
+           (unsigned long long)key->hash[0],
+           (unsigned long long)key->hash[1]);
+}
+
+/*******************************************************************************
+ * Keys
+ ******************************************************************************/
+
+bool candid_shader_cache_key(const char *source, size_t source_size,
+                             const Candid_ShaderCompileOptions *options,
+                             Candid_ShaderSourceType target,
+                             const char *compiler_version,
+                             Candid_ShaderCacheKey *out) {
+  if (!cache_enabled())
+    return false;
+
+  Candid_Hasher h = {0xcbf29ce484222325ull, 0x243f6a8885a308d3ull};
+  hash_string(&h, CACHE_FORMAT);
+  hash_string(&h, compiler_version);
+  hash_u64(&h, (uint64_t)target);
+  hash_u64(&h, (uint64_t)options->stage);
+  hash_string(&h, options->entry_point);
+  hash_string(&h, options->target_profile);
+  hash_u64(&h, options->enable_debug);
+  hash_u64(&h, options->optimize ? 1 + options->optimization_level : 0);
+  hash_u64(&h, options->define_count);
+  for (uint32_t i = 0; i < options->define_count; ++i)
+    hash_string(&h, options->defines[i]);
+
+  /* Include paths themselves are left out, so checkouts in different
+   * places share entries; what they resolve to is hashed instead */
+  hash_u64(&h, source_size);
+  hash_bytes(&h, source, source_size);
+  Candid_IncludeScan scan = {.hasher = &h, .options = options};
+  hash_includes(&scan, source, source_size, NULL, 0);
+
+  out->hash[0] = h.a;
+  out->hash[1] = h.b;
+  return true;
+}
+
+/*******************************************************************************
+ * Lookup
+ ******************************************************************************/
+
+static bool add_mapping(const void *data, void *base, size_t length) {
+  SDL_LockSpinlock(&cache.lock);
+  bool ok = true;
+  if (cache.mapping_count == cache.mapping_capacity) {
+    uint32_t capacity =
+        cache.mapping_capacity ? cache.mapping_capacity * 2 : 16;
+    Candid_ShaderCacheMapping *mappings = realloc(
+        cache.mappings, capacity * sizeof(Candid_ShaderCacheMapping));
+    if (mappings) {
+      cache.mappings = mappings;
+      cache.mapping_capacity = capacity;
+    } else {
+      ok = false;
+    }
+  }
+  if (ok) {
+    cache.mappings[cache.mapping_count++] =
+        (Candid_ShaderCacheMapping){data, base, length};
+  }
+  SDL_UnlockSpinlock(&cache.lock);
+  return ok;
+}
+
+bool candid_shader_cache_load(const Candid_ShaderCacheKey *key,
+                              Candid_ShaderBytecode *out) {
+  char path[1024];
+  entry_path(key, path, sizeof(path));
+
+  void *base;
+  size_t length;
+  if (!map_file(path, &base, &length))
+    return false;
+
+  const Candid_ShaderCacheHeader *header = base;
+  if (length < sizeof(*header) + 1 || header->magic != CACHE_MAGIC ||
+      header->key[0] != key->hash[0] || header->key[1] != key->hash[1] ||
+      header->size != length - sizeof(*header) - 1) {
+    /* Left by an older format or another tool; compiled over on store */
+    unmap_file(base, length);
+    return false;
+  }
+
+  const uint8_t *data = (const uint8_t *)base + sizeof(*header);
+  if (!add_mapping(data, base, length)) {
+    unmap_file(base, length);
+    return false;
+  }
+
+  /* Recency for eviction */
+  utime(path, NULL);
+
+  out->data = data;
+  out->size = (size_t)header->size;
+  out->type = (Candid_ShaderSourceType)header->type;
+  return true;
+}
+
+bool candid_shader_cache_release(const void *data) {
+  if (!data)
+    return false;
+
+  SDL_LockSpinlock(&cache.lock);
+  for (uint32_t i = 0; i < cache.mapping_count; ++i) {
+    if (cache.mappings[i].data != data)
+      continue;
+    Candid_ShaderCacheMapping mapping = cache.mappings[i];
+    cache.mappings[i] = cache.mappings[--cache.mapping_count];
+    SDL_UnlockSpinlock(&cache.lock);
+    unmap_file(mapping.base, mapping.length);
+    return true;
+  }
+  SDL_UnlockSpinlock(&cache.lock);
+  return false;
+}
+
+/*******************************************************************************
+ * Eviction
+ ******************************************************************************/
+
+static bool has_suffix(const char *name, const char *suffix) {
+  size_t length = strlen(name);
+  size_t suffix_length = strlen(suffix);
+  return length >= suffix_length &&
+         strcmp(name + length - suffix_length, suffix) == 0;
+}
+
+static SDL_EnumerationResult scan_entry(void *user_data, const char *dirname,
+                                        const char *fname) {
+  Candid_ShaderCacheScan *scan = user_data;
+  bool entry = has_suffix(fname, ".csc");
+  if (!entry && !has_suffix(fname, ".tmp"))
+    return SDL_ENUM_CONTINUE;
+
+  char path[1024];
+  snprintf(path, sizeof(path), "%s%s", dirname, fname);
+  SDL_PathInfo info;
+  if (!SDL_GetPathInfo(path, &info) || info.type != SDL_PATHTYPE_FILE)
+    return SDL_ENUM_CONTINUE;
+
+  if (!entry) {
+    if (scan->now - info.modify_time > CACHE_STALE_TEMP_NS)
+      SDL_RemovePath(path);
+    return SDL_ENUM_CONTINUE;
+  }
+
+  scan->total += info.size;
+  if (scan->count == scan->capacity) {
+    uint32_t capacity = scan->capacity ? scan->capacity * 2 : 256;
+    Candid_ShaderCacheFile *files =
+        realloc(scan->files, capacity * sizeof(Candid_ShaderCacheFile));
+    if (!files)
+      return SDL_ENUM_CONTINUE;
+    scan->files = files;
+    scan->capacity = capacity;
+  }
+  char *copy = strdup(path);
+  if (copy) {
+    scan->files[scan->count++] =
+        (Candid_ShaderCacheFile){copy, info.size, info.modify_time};
+  }
+  return SDL_ENUM_CONTINUE;
+}
+
+static int compare_files(const void *a, const void *b) {
+  const Candid_ShaderCacheFile *fa = a;
+  const Candid_ShaderCacheFile *fb = b;
+  return (fa->modify_time > fb->modify_time) -
+         (fa->modify_time < fb->modify_time);
+}
+
+/**
+ * Measure the directory, and if `max_size` is over, remove the least
+ * recently used entries down to the eviction target
+ * @return The directory's size afterwards
+ */
+static uint64_t evict(const char *directory, uint64_t max_size) {
+  Candid_ShaderCacheScan scan = {0};
+  SDL_GetCurrentTime(&scan.now);
+  SDL_EnumerateDirectory(directory, scan_entry, &scan);
+
+  if (scan.total > max_size) {
+    uint64_t target = max_size / 4 * CACHE_EVICT_TARGET;
+    qsort(scan.files, scan.count, sizeof(Candid_ShaderCacheFile),
+          compare_files);
+    /* Entries still mapped elsewhere stay readable (POSIX) or fail to be
+     * removed (Windows); either is fine */
+    for (uint32_t i = 0; i < scan.count && scan.total > target; ++i) {
+      if (SDL_RemovePath(scan.files[i].path))
+        scan.total -= scan.files[i].size;
+    }
+  }
+
+  for (uint32_t i = 0; i < scan.count; ++i)
+    free(scan.files[i].path);
+  free(scan.files);
+  return scan.total;
+}
+
+/*******************************************************************************
+ * Store
+ ******************************************************************************/
+
+void candid_shader_cache_store(const Candid_ShaderCacheKey *key,
+                               const Candid_ShaderBytecode *bytecode) {
+  if (!bytecode->data || !cache_enabled())
+    return;
+
+  size_t length = sizeof(Candid_ShaderCacheHeader) + bytecode->size + 1;
+  uint8_t *file = malloc(length);
+  if (!file)
+    return;
+  Candid_ShaderCacheHeader header = {
+      .magic = CACHE_MAGIC,
+      .type = (uint32_t)bytecode->type,
+      .size = bytecode->size,
+      .key = {key->hash[0], key->hash[1]},
+  };
+  memcpy(file, &header, sizeof(header));
+  memcpy(file + sizeof(header), bytecode->data, bytecode->size);
+  file[length - 1] = 0;
+
+  char path[1024], temp[1100];
+  entry_path(key, path, sizeof(path));
+  snprintf(temp, sizeof(temp), "%s.%llx_%llx_%d.tmp", path,
+           (unsigned long long)SDL_GetTicksNS(),
+           (unsigned long long)SDL_GetCurrentThreadID(),
+           SDL_AddAtomicInt(&temp_counter, 1));
+
+  /* Readers only ever open complete entries: the rename is atomic, and a
+   * concurrent writer of the same key renames identical contents */
+  bool stored = SDL_SaveFile(temp, file, length);
+  free(file);
+  if (stored && !SDL_RenamePath(temp, path))
+    stored = false;
+  if (!stored) {
+    SDL_RemovePath(temp);
+    return;
+  }
+
+  SDL_LockSpinlock(&cache.lock);
+  bool measure = !cache.size_known;
+  cache.size += length;
+  bool over = measure || cache.size > cache.max_size;
+  uint64_t max_size = cache.max_size;
+  char directory[sizeof(cache.directory)];
+  memcpy(directory, cache.directory, sizeof(directory));
+  SDL_UnlockSpinlock(&cache.lock);
+
+  /* The first store measures the directory, which other processes may
+   * also be filling; after that the estimate is only rechecked once over */
+  if (over) {
+    uint64_t size = evict(directory, max_size);
+    SDL_LockSpinlock(&cache.lock);
+    cache.size = size;
+    cache.size_known = true;
+    SDL_UnlockSpinlock(&cache.lock);
+  }
+}
@@ -0,0 +1,63 @@
+/**
+ * @file shader_cache.h
+ * @brief Internal content-addressed cache of compiled shaders
+ *
+ * Not part of the public API. Each entry is one file named after its key,
+ * a 128-bit hash of everything the compiler output depends on: the source,
+ * the contents of every file it includes (resolved like DXC would), the
+ * compile options and the compiler version. Since a key never maps to
+ * different contents, entries need no invalidation.
+ *
+ * Hits are memory-mapped rather than read. Entries are written to a
+ * temporary file and renamed into place, so processes sharing the
+ * directory only ever see complete entries. Reading an entry bumps its
+ * modification time, and once the directory outgrows its cap the least
+ * recently used entries are removed.
+ */
+
+#pragma once
+
+#include <candid/shader.h>
+
+#define CANDID_SHADER_CACHE_DEFAULT_SIZE (256ull << 20)
+
+typedef struct Candid_ShaderCacheKey {
+  uint64_t hash[2];
+} Candid_ShaderCacheKey;
+
+/**
+ * Compute the key of a compilation
+ * @param compiler_version Output of the tools, part of the key
+ * @return false when the cache is disabled
+ */
+bool candid_shader_cache_key(const char *source, size_t source_size,
+                             const Candid_ShaderCompileOptions *options,
+                             Candid_ShaderSourceType target,
+                             const char *compiler_version,
+                             Candid_ShaderCacheKey *out);
+
+/**
+ * Map a cached entry
+ * @return true on a hit; `out` is then released with
+ *         candid_shader_cache_release
+ */
+bool candid_shader_cache_load(const Candid_ShaderCacheKey *key,
+                              Candid_ShaderBytecode *out);
+
+/**
+ * Add an entry, evicting old ones if the cache is over its cap. Failures
+ * are ignored: the entry is just compiled again next time.
+ */
+void candid_shader_cache_store(const Candid_ShaderCacheKey *key,
+                               const Candid_ShaderBytecode *bytecode);
+
+/**
+ * The system's temporary directory ($TMPDIR, %TEMP%, ..., else /tmp)
+ */
+const char *candid_shader_temp_directory(void);
+
+/**
+ * Unmap bytecode returned by candid_shader_cache_load
+ * @return false when `data` is not a cache mapping
+ */
+bool candid_shader_cache_release(const void *data);
@@ -0,0 +1,89 @@
+/**
+ * @file shader_layout.h
+ * @brief Internal binding layouts of shader programs
+ *
+ * Not part of the public API. A program's layout merges the reflection of
+ * its stages (candid_shader_reflect) into one sorted list of bindings per
+ * descriptor set, from which backends create their set and pipeline
+ * layouts, plus a table resolving the slot of each cmd_bind_* call to a
+ * binding by index.
+ *
+ * Slots follow HLSL registers. HLSL keeps one register range per class
+ * (b, t, s, u) while SPIR-V has a single binding range per set, so SPIR-V
+ * is compiled with the ranges of space 0 shifted apart by
+ * CANDID_SHADER_BINDING_SHIFT; the slot of a binding is then its index in
+ * its range. Resources with an explicit [[vk::binding]] are not shifted,
+ * and their slot is the binding itself (as with the compute kernels).
+ */
+
+#pragma once
+
+#include <candid/shader.h>
+
+/** Distance between register ranges in SPIR-V bindings */
+#define CANDID_SHADER_BINDING_SHIFT 32
+/** First binding of the t, s and u ranges (b starts at 0), as literals for
+ * DXC's -fvk-{t,s,u}-shift arguments */
+#define CANDID_SHADER_BINDING_SHIFT_T 32
+#define CANDID_SHADER_BINDING_SHIFT_S 64
+#define CANDID_SHADER_BINDING_SHIFT_U 96
+#define CANDID_SHADER_MAX_SETS 4
+#define CANDID_SHADER_NO_SLOT 0xFF
+
+/**
+ * Binding classes, one per cmd_bind_* call
+ */
+typedef enum Candid_BindingClass {
+  CANDID_BINDING_UNIFORM_BUFFER,
+  CANDID_BINDING_TEXTURE, /**< Also combined texture-samplers */
+  CANDID_BINDING_SAMPLER,
+  CANDID_BINDING_STORAGE_BUFFER,
+  CANDID_BINDING_STORAGE_TEXTURE,
+  CANDID_BINDING_CLASS_COUNT
+} Candid_BindingClass;
+
+typedef struct Candid_ShaderBinding {
+  uint32_t set;
+  uint32_t binding;
+  Candid_UniformType type; /**< Never a plain-data uniform type */
+  uint32_t array_count;    /**< 0 for unbounded arrays */
+  Candid_ShaderStage stages;
+} Candid_ShaderBinding;
+
+typedef struct Candid_ShaderLayout {
+  /** Sorted by set, then binding */
+  Candid_ShaderBinding bindings[CANDID_MAX_UNIFORMS];
+  uint32_t binding_count;
+  /** Range of bindings in each set */
+  uint32_t set_first[CANDID_SHADER_MAX_SETS];
+  uint32_t set_binding_count[CANDID_SHADER_MAX_SETS];
+  uint32_t set_count; /**< Highest set used + 1 */
+
+  uint32_t push_constant_size; /**< From offset 0, covering every stage */
+  Candid_ShaderStage push_constant_stages;
+
+  /** Index in bindings of each set 0 slot, or CANDID_SHADER_NO_SLOT */
+  uint8_t slots[CANDID_BINDING_CLASS_COUNT][CANDID_SHADER_BINDING_SHIFT];
+} Candid_ShaderLayout;
+
+/**
+ * Merge the reflection of a program's stages. Stages may share a binding if
+ * they agree on its type; its stage mask is then the union.
+ * @return CANDID_SUCCESS, or CANDID_ERROR_INVALID_ARGUMENT on conflicting
+ *         bindings or sets past CANDID_SHADER_MAX_SETS
+ */
+Candid_Result
+candid_shader_layout_build(const Candid_ShaderReflection *const *stages,
+                           uint32_t stage_count, Candid_ShaderLayout *out);
+
+/**
+ * Binding of a slot in set 0, or NULL if the program does not use it
+ */
+static inline const Candid_ShaderBinding *
+candid_shader_layout_slot(const Candid_ShaderLayout *layout,
+                          Candid_BindingClass binding_class, uint32_t slot) {
+  if (slot >= CANDID_SHADER_BINDING_SHIFT)
+    return NULL;
+  uint8_t index = layout->slots[binding_class][slot];
+  return index == CANDID_SHADER_NO_SLOT ? NULL : &layout->bindings[index];
+}
@@ -0,0 +1,442 @@
+/**
+ * @file shader_permutation.c
+ * @brief Shader permutation sets with background compilation
+ */
+
+#include "shader_permutation.h"
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERMUTATION_MAX_WORKERS 4
+
+/*******************************************************************************
+ * Internal Structures
+ ******************************************************************************/
+
+typedef enum Candid_VariantState {
+  VARIANT_NONE,
+  VARIANT_QUEUED, /**< Queued or compiling */
+  VARIANT_READY,
+  VARIANT_FAILED,
+} Candid_VariantState;
+
+typedef struct Candid_ShaderVariant {
+  SDL_AtomicInt state; /**< Candid_VariantState; fields below once READY */
+  Candid_ShaderProgram *program;
+  Candid_ShaderModule *vertex;
+  Candid_ShaderModule *fragment;
+} Candid_ShaderVariant;
+
+struct Candid_ShaderPermutations {
+  const Candid_BackendInterface *backend;
+  Candid_Device *device;
+  Candid_ShaderSourceType target;
+
+  /* Copy of the description */
+  char *source;
+  size_t source_size;
+  char *vertex_entry;
+  char *fragment_entry;
+  char *vertex_profile;
+  char *fragment_profile;
+  char **include_paths;
+  uint32_t include_path_count;
+  char *label;
+
+  /** "NAME=0" and "NAME=1" of each feature */
+  char *feature_off[CANDID_MAX_SHADER_FEATURES];
+  char *feature_on[CANDID_MAX_SHADER_FEATURES];
+  uint32_t feature_count;
+
+  Candid_ShaderVariant *variants; /**< 1 << feature_count */
+  uint32_t fallback;
+  SDL_AtomicInt pending;
+
+  /* Ring of queued masks; a variant is queued at most once, so it never
+   * holds more than one entry per variant */
+  SDL_Mutex *mutex;
+  SDL_Condition *wake;
+  uint32_t *queue;
+  uint32_t queue_head;
+  uint32_t queue_count;
+  bool quit;
+
+  SDL_Thread *threads[PERMUTATION_MAX_WORKERS];
+  uint32_t worker_count;
+};
+
+static const char *const standard_feature_defines[] = {
+    "CANDID_ALPHA_MASK",   "CANDID_NORMAL_MAP", "CANDID_SKINNING",
+    "CANDID_VERTEX_COLOR", "CANDID_EMISSIVE",
+};
+
+static_assert(sizeof(standard_feature_defines) /
+                      sizeof(standard_feature_defines[0]) ==
+                  CANDID_SHADER_FEATURE_COUNT,
+              "one define per Candid_ShaderFeature");
+
+/*******************************************************************************
+ * Compilation
+ ******************************************************************************/
+
+static Candid_Result compile_stage(Candid_ShaderPermutations *p,
+                                   Candid_ShaderStage stage,
+                                   const char **defines, uint32_t define_count,
+                                   Candid_ShaderModule **out) {
+  bool vertex = stage == CANDID_SHADER_STAGE_VERTEX;
+  Candid_ShaderCompileOptions options = {
+      .stage = stage,
+      .entry_point = vertex ? p->vertex_entry : p->fragment_entry,
+      .target_profile = vertex ? p->vertex_profile : p->fragment_profile,
+      .optimize = true,
+      .optimization_level = 3,
+      .defines = defines,
+      .define_count = define_count,
+      .include_paths = (const char **)p->include_paths,
+      .include_path_count = p->include_path_count,
+      .target = p->target,
+  };
+
+  Candid_ShaderBytecode bytecode;
+  Candid_Result result = candid_shader_compile_hlsl(p->source, p->source_size,
+                                                    &options, &bytecode);
+  if (result != CANDID_SUCCESS)
+    return result;
+
+  Candid_ShaderModuleDesc desc = {
+      .stage = stage,
+      .source_type = bytecode.type,
+      .entry_point = options.entry_point,
+      .label = p->label,
+  };
+  if (bytecode.type == CANDID_SHADER_SOURCE_MSL) {
+    desc.source = bytecode.data;
+    desc.source_size = bytecode.size;
+  } else {
+    desc.bytecode = bytecode.data;
+    desc.bytecode_size = bytecode.size;
+  }
+
+  result = p->backend->shader_module_create(p->device, &desc, out);
+  candid_shader_free_bytecode(&bytecode);
+  return result;
+}
+
+static Candid_Result compile_variant(Candid_ShaderPermutations *p,
+                                     uint32_t mask) {
+  const char *defines[CANDID_MAX_SHADER_FEATURES + 1];
+  uint32_t define_count = 0;
+  defines[define_count++] = "CANDID_PERMUTATION=1";
+  for (uint32_t i = 0; i < p->feature_count; ++i)
+    defines[define_count++] =
+        (mask >> i) & 1 ? p->feature_on[i] : p->feature_off[i];
+
+  Candid_ShaderVariant *variant = &p->variants[mask];
+  Candid_Result result = compile_stage(p, CANDID_SHADER_STAGE_VERTEX, defines,
+                                       define_count, &variant->vertex);
+  if (result == CANDID_SUCCESS)
+    result = compile_stage(p, CANDID_SHADER_STAGE_FRAGMENT, defines,
+                           define_count, &variant->fragment);
+  if (result == CANDID_SUCCESS) {
+    Candid_ShaderProgramDesc desc = {
+        .vertex = variant->vertex,
+        .fragment = variant->fragment,
+        .label = p->label,
+    };
+    result = p->backend->shader_program_create(p->device, &desc,
+                                               &variant->program);
+  }
+
+  if (result != CANDID_SUCCESS) {
+    /* Nothing has drawn with a failed variant, so release it right away */
+    if (variant->fragment)
+      p->backend->shader_module_destroy(p->device, variant->fragment);
+    if (variant->vertex)
+      p->backend->shader_module_destroy(p->device, variant->vertex);
+    variant->vertex = NULL;
+    variant->fragment = NULL;
+    variant->program = NULL;
+  }
+  return result;
+}
+
+/*******************************************************************************
+ * Workers
+ ******************************************************************************/
+
+static int worker_main(void *data) {
+  Candid_ShaderPermutations *p = data;
+
+  for (;;) {
+    SDL_LockMutex(p->mutex);
+    while (!p->quit && p->queue_count == 0)
+      SDL_WaitCondition(p->wake, p->mutex);
+    if (p->quit) {
+      SDL_UnlockMutex(p->mutex);
+      break;
+    }
+    uint32_t mask = p->queue[p->queue_head];
+    p->queue_head = (p->queue_head + 1) & ((1u << p->feature_count) - 1);
+    p->queue_count--;
+    SDL_UnlockMutex(p->mutex);
+
+    Candid_Result result = compile_variant(p, mask);
+    /* The atomic store publishes the variant's fields to readers */
+    SDL_SetAtomicInt(&p->variants[mask].state,
+                     result == CANDID_SUCCESS ? VARIANT_READY
+                                              : VARIANT_FAILED);
+    SDL_AddAtomicInt(&p->pending, -1);
+  }
+
+  return 0;
+}
+
+static void enqueue(Candid_ShaderPermutations *p, uint32_t mask) {
+  if (!SDL_CompareAndSwapAtomicInt(&p->variants[mask].state, VARIANT_NONE,
+                                   VARIANT_QUEUED))
+    return;
+
+  SDL_AddAtomicInt(&p->pending, 1);
+  SDL_LockMutex(p->mutex);
+  uint32_t tail =
+      (p->queue_head + p->queue_count) & ((1u << p->feature_count) - 1);
+  p->queue[tail] = mask;
+  p->queue_count++;
+  SDL_SignalCondition(p->wake);
+  SDL_UnlockMutex(p->mutex);
+}
+
+/*******************************************************************************
+ * Lifecycle
+ ******************************************************************************/
+
+static bool copy_string(const char *source, char **out) {
+  *out = NULL;
+  if (!source)
+    return true;
+  *out = strdup(source);
+  return *out != NULL;
+}
+
+static char *format_define(const char *name, int value) {
+  size_t size = strlen(name) + 3;
+  char *define = malloc(size);
+  if (define)
+    snprintf(define, size, "%s=%d", name, value);
+  return define;
+}
+
+static Candid_Result copy_desc(Candid_ShaderPermutations *p,
+                               const Candid_ShaderPermutationDesc *desc) {
+  const char *const *names =
+      desc->feature_defines ? desc->feature_defines : standard_feature_defines;
+
+  p->source_size =
+      desc->source_size ? desc->source_size : strlen(desc->source);
+  p->source = malloc(p->source_size);
+  if (!p->source)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  memcpy(p->source, desc->source, p->source_size);
+
+  bool ok = copy_string(desc->vertex_entry, &p->vertex_entry) &&
+            copy_string(desc->fragment_entry, &p->fragment_entry) &&
+            copy_string(desc->vertex_profile ? desc->vertex_profile
+                                             : "vs_6_0",
+                        &p->vertex_profile) &&
+            copy_string(desc->fragment_profile ? desc->fragment_profile
+                                               : "ps_6_0",
+                        &p->fragment_profile) &&
+            copy_string(desc->label, &p->label);
+
+  if (ok && desc->include_path_count > 0) {
+    p->include_paths = calloc(desc->include_path_count, sizeof(char *));
+    ok = p->include_paths != NULL;
+    for (uint32_t i = 0; ok && i < desc->include_path_count; ++i) {
+      ok = copy_string(desc->include_paths[i], &p->include_paths[i]);
+      p->include_path_count = i + 1;
+    }
+  }
+
+  for (uint32_t i = 0; ok && i < p->feature_count; ++i) {
+    p->feature_off[i] = format_define(names[i], 0);
+    p->feature_on[i] = format_define(names[i], 1);
+    ok = p->feature_off[i] && p->feature_on[i];
+  }
+
+  return ok ? CANDID_SUCCESS : CANDID_ERROR_OUT_OF_MEMORY;
+}
+
+Candid_Result candid_shader_permutations_create(
+    const Candid_BackendInterface *backend, Candid_Device *device,
+    Candid_ShaderSourceType target, const Candid_ShaderPermutationDesc *desc,
+    Candid_ShaderPermutations **out) {
+  if (!backend || !desc || !out || !desc->source || !desc->vertex_entry ||
+      !desc->fragment_entry)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  uint32_t feature_count =
+      desc->feature_count ? desc->feature_count : CANDID_SHADER_FEATURE_COUNT;
+  if (feature_count > CANDID_MAX_SHADER_FEATURES ||
+      (!desc->feature_defines &&
+       feature_count > CANDID_SHADER_FEATURE_COUNT))
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_ShaderPermutations *p = calloc(1, sizeof(Candid_ShaderPermutations));
+  if (!p)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  p->backend = backend;
+  p->device = device;
+  p->target = target;
+  p->feature_count = feature_count;
+  p->fallback = desc->fallback_features & ((1u << feature_count) - 1);
+
+  Candid_Result result = copy_desc(p, desc);
+  if (result != CANDID_SUCCESS) {
+    candid_shader_permutations_destroy(p, NULL, NULL);
+    return result;
+  }
+
+  uint32_t variant_count = 1u << feature_count;
+  p->variants = calloc(variant_count, sizeof(Candid_ShaderVariant));
+  p->queue = calloc(variant_count, sizeof(uint32_t));
+  p->mutex = SDL_CreateMutex();
+  p->wake = SDL_CreateCondition();
+  if (!p->variants || !p->queue || !p->mutex || !p->wake) {
+    candid_shader_permutations_destroy(p, NULL, NULL);
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  }
+
+  /* Compiled on the caller's thread: get() always has something to return */
+  result = compile_variant(p, p->fallback);
+  if (result != CANDID_SUCCESS) {
+    candid_shader_permutations_destroy(p, NULL, NULL);
+    return CANDID_ERROR_SHADER_COMPILATION;
+  }
+  SDL_SetAtomicInt(&p->variants[p->fallback].state, VARIANT_READY);
+
+  uint32_t worker_count = desc->worker_count;
+  if (worker_count == 0) {
+    int cores = SDL_GetNumLogicalCPUCores();
+    worker_count = cores > 1 ? (uint32_t)cores / 2 : 1;
+  }
+  if (worker_count > PERMUTATION_MAX_WORKERS)
+    worker_count = PERMUTATION_MAX_WORKERS;
+
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    p->threads[i] = SDL_CreateThread(worker_main, "candid_shaders", p);
+    if (!p->threads[i])
+      break;
+    p->worker_count++;
+  }
+  if (p->worker_count == 0) {
+    candid_shader_permutations_destroy(p, NULL, NULL);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  *out = p;
+  return CANDID_SUCCESS;
+}
+
+void candid_shader_permutations_destroy(
+    Candid_ShaderPermutations *permutations, Candid_ShaderReleaseFn release,
+    void *user_data) {
+  Candid_ShaderPermutations *p = permutations;
+  if (!p)
+    return;
+
+  if (p->mutex) {
+    SDL_LockMutex(p->mutex);
+    p->quit = true;
+    SDL_BroadcastCondition(p->wake);
+    SDL_UnlockMutex(p->mutex);
+  }
+  for (uint32_t i = 0; i < p->worker_count; ++i)
+    SDL_WaitThread(p->threads[i], NULL);
+
+  if (p->variants) {
+    for (uint32_t i = 0; i < 1u << p->feature_count; ++i) {
+      Candid_ShaderVariant *variant = &p->variants[i];
+      if (SDL_GetAtomicInt(&variant->state) != VARIANT_READY)
+        continue;
+      if (release) {
+        release(user_data, variant->program, variant->vertex,
+                variant->fragment);
+      } else {
+        p->backend->shader_program_destroy(p->device, variant->program);
+        p->backend->shader_module_destroy(p->device, variant->fragment);
+        p->backend->shader_module_destroy(p->device, variant->vertex);
+      }
+    }
+  }
+
+  SDL_DestroyCondition(p->wake);
+  SDL_DestroyMutex(p->mutex);
+  free(p->queue);
+  free(p->variants);
+  for (uint32_t i = 0; i < CANDID_MAX_SHADER_FEATURES; ++i) {
+    free(p->feature_off[i]);
+    free(p->feature_on[i]);
+  }
+  for (uint32_t i = 0; i < p->include_path_count; ++i)
+    free(p->include_paths[i]);
+  free(p->include_paths);
+  free(p->label);
+  free(p->fragment_profile);
+  free(p->vertex_profile);
+  free(p->fragment_entry);
+  free(p->vertex_entry);
+  free(p->source);
+  free(p);
+}
+
+/*******************************************************************************
+ * Lookup
+ ******************************************************************************/
+
+Candid_ShaderProgram *
+candid_shader_permutations_get(Candid_ShaderPermutations *permutations,
+                               uint32_t features) {
+  Candid_ShaderPermutations *p = permutations;
+  if (!p)
+    return NULL;
+
+  uint32_t mask = features & ((1u << p->feature_count) - 1);
+  Candid_ShaderVariant *variant = &p->variants[mask];
+  int state = SDL_GetAtomicInt(&variant->state);
+  if (state == VARIANT_READY)
+    return variant->program;
+  if (state == VARIANT_NONE)
+    enqueue(p, mask);
+  return p->variants[p->fallback].program;
+}
+
+void candid_shader_permutations_request(
+    Candid_ShaderPermutations *permutations, uint32_t features) {
+  if (!permutations)
+    return;
+  enqueue(permutations,
+          features & ((1u << permutations->feature_count) - 1));
+}
+
+bool candid_shader_permutations_is_ready(
+    const Candid_ShaderPermutations *permutations, uint32_t features) {
+  if (!permutations)
+    return false;
+  uint32_t mask = features & ((1u << permutations->feature_count) - 1);
+  Candid_ShaderVariant *variant = &permutations->variants[mask];
+  return SDL_GetAtomicInt(&variant->state) == VARIANT_READY;
+}
+
+uint32_t candid_shader_permutations_get_pending(
+    const Candid_ShaderPermutations *permutations) {
+  if (!permutations)
+    return 0;
+  int pending = SDL_GetAtomicInt(
+      &((Candid_ShaderPermutations *)permutations)->pending);
+  return pending > 0 ? (uint32_t)pending : 0;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file shader_permutation.h
+ * @brief Internal shader permutation set lifecycle
+ *
+ * Not part of the public API. Variants are created with the backend's
+ * shader_module_create and shader_program_create, which are called from the
+ * set's worker threads and so must be thread-safe.
+ */
+
+#pragma once
+
+#include <candid/backend.h>
+#include <candid/shader_permutation.h>
+
+/** Receives each compiled variant when a set is destroyed */
+typedef void (*Candid_ShaderReleaseFn)(void *user_data,
+                                       Candid_ShaderProgram *program,
+                                       Candid_ShaderModule *vertex,
+                                       Candid_ShaderModule *fragment);
+
+/**
+ * Create a permutation set and compile its fallback variant
+ * @param target Bytecode the backend consumes (SPIRV or MSL)
+ * @return CANDID_SUCCESS, or CANDID_ERROR_SHADER_COMPILATION when the
+ *         fallback does not compile
+ */
+Candid_Result candid_shader_permutations_create(
+    const Candid_BackendInterface *backend, Candid_Device *device,
+    Candid_ShaderSourceType target, const Candid_ShaderPermutationDesc *desc,
+    Candid_ShaderPermutations **out);
+
+/**
+ * Stop the workers (waiting for compilations in progress) and hand every
+ * compiled variant to `release`, then free the set
+ */
+void candid_shader_permutations_destroy(
+    Candid_ShaderPermutations *permutations, Candid_ShaderReleaseFn release,
+    void *user_data);
@@ -0,0 +1,678 @@
+/**
+ * @file shader_reflect.c
+ * @brief SPIR-V reflection and program binding layouts
+ *
+ * SPIR-V is reflected by walking its instructions once: names, decorations
+ * and types all precede the global variables, so each variable is
+ * classified as soon as it is declared. Only what Candid_ShaderReflection
+ * reports is tracked, which keeps this far smaller than a general-purpose
+ * reflection library.
+ */
+
+#include "shader_layout.h"
+
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPIRV_MAGIC 0x07230203u
+#define SPIRV_HEADER_WORDS 5
+
+/* Opcodes */
+#define SPIRV_OP_NAME 5
+#define SPIRV_OP_ENTRY_POINT 15
+#define SPIRV_OP_EXECUTION_MODE 16
+#define SPIRV_OP_TYPE_BOOL 20
+#define SPIRV_OP_TYPE_INT 21
+#define SPIRV_OP_TYPE_FLOAT 22
+#define SPIRV_OP_TYPE_VECTOR 23
+#define SPIRV_OP_TYPE_MATRIX 24
+#define SPIRV_OP_TYPE_IMAGE 25
+#define SPIRV_OP_TYPE_SAMPLER 26
+#define SPIRV_OP_TYPE_SAMPLED_IMAGE 27
+#define SPIRV_OP_TYPE_ARRAY 28
+#define SPIRV_OP_TYPE_RUNTIME_ARRAY 29
+#define SPIRV_OP_TYPE_STRUCT 30
+#define SPIRV_OP_TYPE_POINTER 32
+#define SPIRV_OP_CONSTANT 43
+#define SPIRV_OP_VARIABLE 59
+#define SPIRV_OP_DECORATE 71
+#define SPIRV_OP_MEMBER_DECORATE 72
+
+/* Decorations */
+#define SPIRV_DECORATION_BLOCK 2
+#define SPIRV_DECORATION_BUFFER_BLOCK 3
+#define SPIRV_DECORATION_ARRAY_STRIDE 6
+#define SPIRV_DECORATION_MATRIX_STRIDE 7
+#define SPIRV_DECORATION_BUILT_IN 11
+#define SPIRV_DECORATION_LOCATION 30
+#define SPIRV_DECORATION_BINDING 33
+#define SPIRV_DECORATION_DESCRIPTOR_SET 34
+#define SPIRV_DECORATION_OFFSET 35
+
+/* Storage classes */
+#define SPIRV_STORAGE_UNIFORM_CONSTANT 0
+#define SPIRV_STORAGE_INPUT 1
+#define SPIRV_STORAGE_UNIFORM 2
+#define SPIRV_STORAGE_OUTPUT 3
+#define SPIRV_STORAGE_PUSH_CONSTANT 9
+#define SPIRV_STORAGE_STORAGE_BUFFER 12
+
+#define SPIRV_BUILT_IN_FRAG_DEPTH 22
+#define SPIRV_EXECUTION_MODE_LOCAL_SIZE 17
+#define SPIRV_DIM_BUFFER 5
+#define SPIRV_DIM_SUBPASS_DATA 6
+
+#define SPIRV_UNSET UINT32_MAX
+
+/*******************************************************************************
+ * Module
+ ******************************************************************************/
+
+typedef struct SpirvId {
+  uint32_t word; /**< Start of the defining instruction, 0 if none */
+  const char *name;
+  uint32_t set;
+  uint32_t binding;
+  uint32_t location;
+  uint32_t built_in;
+  uint32_t array_stride;
+  bool block;
+  bool buffer_block;
+} SpirvId;
+
+typedef struct SpirvModule {
+  const uint32_t *words;
+  uint32_t word_count;
+  uint32_t bound;
+  SpirvId *ids;
+} SpirvModule;
+
+static uint16_t op_of(uint32_t word) { return (uint16_t)(word & 0xFFFF); }
+static uint16_t length_of(uint32_t word) { return (uint16_t)(word >> 16); }
+
+/** Instruction defining a type or constant id, NULL if unknown */
+static const uint32_t *definition(const SpirvModule *m, uint32_t id) {
+  if (id >= m->bound || m->ids[id].word == 0)
+    return NULL;
+  return &m->words[m->ids[id].word];
+}
+
+/** A literal string operand, or NULL if not terminated in the instruction */
+static const char *literal_string(const uint32_t *operand, uint32_t words) {
+  const char *text = (const char *)operand;
+  return memchr(text, '\0', words * sizeof(uint32_t)) ? text : NULL;
+}
+
+static uint32_t constant_value(const SpirvModule *m, uint32_t id) {
+  const uint32_t *op = definition(m, id);
+  if (!op || op_of(op[0]) != SPIRV_OP_CONSTANT || length_of(op[0]) < 4)
+    return 0;
+  return op[3];
+}
+
+/*******************************************************************************
+ * Type Sizes
+ ******************************************************************************/
+
+static uint32_t type_size(const SpirvModule *m, uint32_t id,
+                          uint32_t matrix_stride);
+
+/* Members end at their Offset plus their size; the last one ends the
+ * struct (std140/std430 tail padding is not counted) */
+static uint32_t struct_size(const SpirvModule *m, const uint32_t *op) {
+  uint32_t member_count = length_of(op[0]) - 2u;
+  uint32_t size = 0;
+  for (uint32_t member = 0; member < member_count; ++member) {
+    uint32_t offset = 0, matrix_stride = 0;
+    for (uint32_t w = SPIRV_HEADER_WORDS; w < m->word_count;
+         w += length_of(m->words[w])) {
+      const uint32_t *d = &m->words[w];
+      if (op_of(d[0]) != SPIRV_OP_MEMBER_DECORATE || length_of(d[0]) < 5 ||
+          d[1] != op[1] || d[2] != member)
+        continue;
+      if (d[3] == SPIRV_DECORATION_OFFSET)
+        offset = d[4];
+      else if (d[3] == SPIRV_DECORATION_MATRIX_STRIDE)
+        matrix_stride = d[4];
+    }
+    uint32_t end = offset + type_size(m, op[2 + member], matrix_stride);
+    if (end > size)
+      size = end;
+  }
+  return size;
+}
+
+static uint32_t type_size(const SpirvModule *m, uint32_t id,
+                          uint32_t matrix_stride) {
+  const uint32_t *op = definition(m, id);
+  if (!op)
+    return 0;
+
+  switch (op_of(op[0])) {
+  case SPIRV_OP_TYPE_BOOL:
+    return 4;
+  case SPIRV_OP_TYPE_INT:
+  case SPIRV_OP_TYPE_FLOAT:
+    return op[2] / 8;
+  case SPIRV_OP_TYPE_VECTOR:
+    return type_size(m, op[2], 0) * op[3];
+  case SPIRV_OP_TYPE_MATRIX:
+    return (matrix_stride ? matrix_stride : type_size(m, op[2], 0)) * op[3];
+  case SPIRV_OP_TYPE_ARRAY: {
+    uint32_t stride = m->ids[id].array_stride;
+    if (!stride)
+      stride = type_size(m, op[2], matrix_stride);
+    return stride * constant_value(m, op[3]);
+  }
+  case SPIRV_OP_TYPE_STRUCT:
+    return struct_size(m, op);
+  default:
+    return 0; /* Runtime arrays add nothing */
+  }
+}
+
+/*******************************************************************************
+ * Interface Variables
+ ******************************************************************************/
+
+static Candid_VertexFormat vertex_format(const SpirvModule *m, uint32_t id) {
+  const uint32_t *op = definition(m, id);
+  uint32_t count = 1;
+  if (op && op_of(op[0]) == SPIRV_OP_TYPE_VECTOR) {
+    count = op[3] < 1 ? 1 : op[3] > 4 ? 4 : op[3];
+    op = definition(m, op[2]);
+  }
+  if (op && op_of(op[0]) == SPIRV_OP_TYPE_INT) {
+    Candid_VertexFormat base =
+        op[3] ? CANDID_VERTEX_FORMAT_INT : CANDID_VERTEX_FORMAT_UINT;
+    return (Candid_VertexFormat)(base + count - 1);
+  }
+  return (Candid_VertexFormat)(CANDID_VERTEX_FORMAT_FLOAT + count - 1);
+}
+
+/* DXC names stage inputs after their semantic, as "in.var.TEXCOORD0" */
+static Candid_VertexSemantic vertex_semantic(const char *name) {
+  static const struct {
+    const char *semantic;
+    Candid_VertexSemantic value;
+  } semantics[] = {
+      {"POSITION", CANDID_SEMANTIC_POSITION},
+      {"POSITION0", CANDID_SEMANTIC_POSITION},
+      {"NORMAL", CANDID_SEMANTIC_NORMAL},
+      {"NORMAL0", CANDID_SEMANTIC_NORMAL},
+      {"TANGENT", CANDID_SEMANTIC_TANGENT},
+      {"TANGENT0", CANDID_SEMANTIC_TANGENT},
+      {"BINORMAL", CANDID_SEMANTIC_BITANGENT},
+      {"BITANGENT", CANDID_SEMANTIC_BITANGENT},
+      {"TEXCOORD", CANDID_SEMANTIC_TEXCOORD0},
+      {"TEXCOORD0", CANDID_SEMANTIC_TEXCOORD0},
+      {"TEXCOORD1", CANDID_SEMANTIC_TEXCOORD1},
+      {"COLOR", CANDID_SEMANTIC_COLOR0},
+      {"COLOR0", CANDID_SEMANTIC_COLOR0},
+      {"COLOR1", CANDID_SEMANTIC_COLOR1},
+      {"BLENDINDICES", CANDID_SEMANTIC_JOINTS},
+      {"BLENDINDICES0", CANDID_SEMANTIC_JOINTS},
+      {"BLENDWEIGHT", CANDID_SEMANTIC_WEIGHTS},
+      {"BLENDWEIGHT0", CANDID_SEMANTIC_WEIGHTS},
+  };
+  if (!name)
+    return CANDID_SEMANTIC_CUSTOM;
+  if (strncmp(name, "in.var.", 7) == 0)
+    name += 7;
+  for (size_t i = 0; i < sizeof(semantics) / sizeof(semantics[0]); ++i) {
+    if (SDL_strcasecmp(name, semantics[i].semantic) == 0)
+      return semantics[i].value;
+  }
+  return CANDID_SEMANTIC_CUSTOM;
+}
+
+static Candid_TextureFormat target_format(const SpirvModule *m, uint32_t id) {
+  const uint32_t *op = definition(m, id);
+  uint32_t count = 1;
+  if (op && op_of(op[0]) == SPIRV_OP_TYPE_VECTOR)
+    count = op[3];
+  return count == 1 ? CANDID_TEXTURE_FORMAT_R32_FLOAT
+                    : CANDID_TEXTURE_FORMAT_RGBA32_FLOAT;
+}
+
+static Candid_Result add_input(const SpirvModule *m, uint32_t variable,
+                               uint32_t type, Candid_ShaderReflection *out) {
+  const SpirvId *id = &m->ids[variable];
+  if (id->built_in != SPIRV_UNSET || id->location == SPIRV_UNSET)
+    return CANDID_SUCCESS;
+  if (out->vertex_input_count == CANDID_MAX_VERTEX_INPUTS)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  uint32_t i = out->vertex_input_count++;
+  out->vertex_inputs[i].name = id->name;
+  out->vertex_inputs[i].semantic = vertex_semantic(id->name);
+  out->vertex_inputs[i].format = vertex_format(m, type);
+  out->vertex_inputs[i].location = id->location;
+  return CANDID_SUCCESS;
+}
+
+static Candid_Result add_output(const SpirvModule *m, uint32_t variable,
+                                uint32_t type, Candid_ShaderReflection *out) {
+  const SpirvId *id = &m->ids[variable];
+  if (id->built_in == SPIRV_BUILT_IN_FRAG_DEPTH) {
+    out->has_depth_output = true;
+    return CANDID_SUCCESS;
+  }
+  if (id->built_in != SPIRV_UNSET || id->location == SPIRV_UNSET)
+    return CANDID_SUCCESS;
+  if (out->render_target_count == CANDID_MAX_RENDER_TARGETS)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  uint32_t i = out->render_target_count++;
+  out->render_targets[i].format = target_format(m, type);
+  out->render_targets[i].location = id->location;
+  return CANDID_SUCCESS;
+}
+
+/* Uniform type of a resource, unwrapping arrays into array_count
+ * @return false for resources with no Candid binding (texel buffers,
+ *         subpass inputs) */
+static bool resource_type(const SpirvModule *m, uint32_t storage,
+                          uint32_t type, Candid_UniformType *out_type,
+                          uint32_t *out_count, uint32_t *out_element) {
+  const uint32_t *op = definition(m, type);
+  *out_count = 1;
+  if (op && op_of(op[0]) == SPIRV_OP_TYPE_ARRAY) {
+    *out_count = constant_value(m, op[3]);
+    type = op[2];
+  } else if (op && op_of(op[0]) == SPIRV_OP_TYPE_RUNTIME_ARRAY) {
+    *out_count = 0;
+    type = op[2];
+  }
+  *out_element = type;
+  op = definition(m, type);
+  if (!op)
+    return false;
+
+  switch (op_of(op[0])) {
+  case SPIRV_OP_TYPE_STRUCT:
+    /* Before SPIR-V 1.3, storage buffers are Uniform BufferBlocks */
+    if (storage == SPIRV_STORAGE_STORAGE_BUFFER || m->ids[type].buffer_block)
+      *out_type = CANDID_UNIFORM_STORAGE_BUFFER;
+    else
+      *out_type = CANDID_UNIFORM_BUFFER;
+    return true;
+  case SPIRV_OP_TYPE_IMAGE:
+    if (op[3] == SPIRV_DIM_BUFFER || op[3] == SPIRV_DIM_SUBPASS_DATA)
+      return false;
+    *out_type = op[7] == 2 ? CANDID_UNIFORM_STORAGE_TEXTURE
+                           : CANDID_UNIFORM_TEXTURE;
+    return true;
+  case SPIRV_OP_TYPE_SAMPLER:
+    *out_type = CANDID_UNIFORM_SAMPLER;
+    return true;
+  case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+    *out_type = CANDID_UNIFORM_TEXTURE_SAMPLER;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static Candid_Result add_resource(const SpirvModule *m, uint32_t variable,
+                                  uint32_t storage, uint32_t type,
+                                  Candid_ShaderReflection *out) {
+  const SpirvId *id = &m->ids[variable];
+  Candid_UniformType uniform_type;
+  uint32_t count, element;
+  if (id->binding == SPIRV_UNSET ||
+      !resource_type(m, storage, type, &uniform_type, &count, &element))
+    return CANDID_SUCCESS;
+  if (out->uniform_count == CANDID_MAX_UNIFORMS)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  bool buffer = uniform_type == CANDID_UNIFORM_BUFFER ||
+                uniform_type == CANDID_UNIFORM_STORAGE_BUFFER;
+  /* DXC names cbuffer variables after the cbuffer; fall back on the type */
+  const char *name = id->name && id->name[0] ? id->name : m->ids[element].name;
+  out->uniforms[out->uniform_count++] = (Candid_UniformDesc){
+      .name = name,
+      .type = uniform_type,
+      .binding = id->binding,
+      .set = id->set == SPIRV_UNSET ? 0 : id->set,
+      .stages = out->stage,
+      .size = buffer ? type_size(m, element, 0) : 0,
+      .array_count = count,
+  };
+  return CANDID_SUCCESS;
+}
+
+/* Push constants are a block whose first member may not be at offset 0 */
+static void add_push_constants(const SpirvModule *m, uint32_t type,
+                               Candid_ShaderReflection *out) {
+  const uint32_t *op = definition(m, type);
+  if (!op || op_of(op[0]) != SPIRV_OP_TYPE_STRUCT)
+    return;
+  uint32_t first = UINT32_MAX;
+  for (uint32_t w = SPIRV_HEADER_WORDS; w < m->word_count;
+       w += length_of(m->words[w])) {
+    const uint32_t *d = &m->words[w];
+    if (op_of(d[0]) == SPIRV_OP_MEMBER_DECORATE && length_of(d[0]) >= 5 &&
+        d[1] == type && d[3] == SPIRV_DECORATION_OFFSET && d[4] < first)
+      first = d[4];
+  }
+  if (first == UINT32_MAX)
+    first = 0;
+  out->push_constant_offset = first;
+  out->push_constant_size = struct_size(m, op) - first;
+}
+
+static Candid_Result add_variable(const SpirvModule *m, const uint32_t *op,
+                                  Candid_ShaderReflection *out) {
+  const uint32_t *pointer = definition(m, op[1]);
+  if (!pointer || op_of(pointer[0]) != SPIRV_OP_TYPE_POINTER ||
+      op[2] >= m->bound)
+    return CANDID_SUCCESS;
+  uint32_t storage = op[3];
+  uint32_t type = pointer[3];
+
+  switch (storage) {
+  case SPIRV_STORAGE_INPUT:
+    return out->stage == CANDID_SHADER_STAGE_VERTEX
+               ? add_input(m, op[2], type, out)
+               : CANDID_SUCCESS;
+  case SPIRV_STORAGE_OUTPUT:
+    return out->stage == CANDID_SHADER_STAGE_FRAGMENT
+               ? add_output(m, op[2], type, out)
+               : CANDID_SUCCESS;
+  case SPIRV_STORAGE_PUSH_CONSTANT:
+    add_push_constants(m, type, out);
+    return CANDID_SUCCESS;
+  case SPIRV_STORAGE_UNIFORM_CONSTANT:
+  case SPIRV_STORAGE_UNIFORM:
+  case SPIRV_STORAGE_STORAGE_BUFFER:
+    return add_resource(m, op[2], storage, type, out);
+  default:
+    return CANDID_SUCCESS; /* Private and workgroup memory */
+  }
+}
+
+/*******************************************************************************
+ * Instructions
+ ******************************************************************************/
+
+static Candid_ShaderStage execution_model_stage(uint32_t model) {
+  switch (model) {
+  case 0:
+    return CANDID_SHADER_STAGE_VERTEX;
+  case 1:
+  case 2:
+    return CANDID_SHADER_STAGE_TESSELLATION;
+  case 3:
+    return CANDID_SHADER_STAGE_GEOMETRY;
+  case 4:
+    return CANDID_SHADER_STAGE_FRAGMENT;
+  default:
+    return CANDID_SHADER_STAGE_COMPUTE;
+  }
+}
+
+static void decorate(SpirvId *id, const uint32_t *op, uint16_t length) {
+  uint32_t value = length >= 4 ? op[3] : 0;
+  switch (op[2]) {
+  case SPIRV_DECORATION_BLOCK:
+    id->block = true;
+    break;
+  case SPIRV_DECORATION_BUFFER_BLOCK:
+    id->buffer_block = true;
+    break;
+  case SPIRV_DECORATION_ARRAY_STRIDE:
+    id->array_stride = value;
+    break;
+  case SPIRV_DECORATION_BUILT_IN:
+    id->built_in = value;
+    break;
+  case SPIRV_DECORATION_LOCATION:
+    id->location = value;
+    break;
+  case SPIRV_DECORATION_BINDING:
+    id->binding = value;
+    break;
+  case SPIRV_DECORATION_DESCRIPTOR_SET:
+    id->set = value;
+    break;
+  }
+}
+
+/* Minimum word count of the instructions read, so that operands are never
+ * read past the end of an instruction */
+static uint16_t min_length(uint16_t op) {
+  switch (op) {
+  case SPIRV_OP_TYPE_IMAGE:
+    return 9;
+  case SPIRV_OP_ENTRY_POINT:
+  case SPIRV_OP_TYPE_INT:
+  case SPIRV_OP_TYPE_VECTOR:
+  case SPIRV_OP_TYPE_MATRIX:
+  case SPIRV_OP_TYPE_ARRAY:
+  case SPIRV_OP_TYPE_POINTER:
+  case SPIRV_OP_VARIABLE:
+    return 4;
+  case SPIRV_OP_NAME:
+  case SPIRV_OP_EXECUTION_MODE:
+  case SPIRV_OP_DECORATE:
+  case SPIRV_OP_TYPE_FLOAT:
+  case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+    return 3;
+  case SPIRV_OP_TYPE_BOOL:
+  case SPIRV_OP_TYPE_SAMPLER:
+  case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+  case SPIRV_OP_TYPE_STRUCT:
+    return 2;
+  default:
+    return 1;
+  }
+}
+
+static Candid_Result parse(SpirvModule *m, Candid_ShaderReflection *out) {
+  bool has_entry_point = false;
+  for (uint32_t w = SPIRV_HEADER_WORDS; w < m->word_count;) {
+    const uint32_t *op = &m->words[w];
+    uint16_t length = length_of(op[0]);
+    uint16_t code = op_of(op[0]);
+    if (length < min_length(code) || length > m->word_count - w)
+      return CANDID_ERROR_INVALID_ARGUMENT;
+
+    switch (code) {
+    case SPIRV_OP_NAME:
+      if (op[1] < m->bound)
+        m->ids[op[1]].name = literal_string(&op[2], length - 2u);
+      break;
+    case SPIRV_OP_ENTRY_POINT:
+      /* Reflect the first entry point; DXC emits only one */
+      if (!has_entry_point)
+        out->stage = execution_model_stage(op[1]);
+      has_entry_point = true;
+      break;
+    case SPIRV_OP_EXECUTION_MODE:
+      if (op[2] == SPIRV_EXECUTION_MODE_LOCAL_SIZE && length >= 6) {
+        out->workgroup_size[0] = op[3];
+        out->workgroup_size[1] = op[4];
+        out->workgroup_size[2] = op[5];
+      }
+      break;
+    case SPIRV_OP_DECORATE:
+      if (op[1] < m->bound)
+        decorate(&m->ids[op[1]], op, length);
+      break;
+    case SPIRV_OP_TYPE_BOOL:
+    case SPIRV_OP_TYPE_INT:
+    case SPIRV_OP_TYPE_FLOAT:
+    case SPIRV_OP_TYPE_VECTOR:
+    case SPIRV_OP_TYPE_MATRIX:
+    case SPIRV_OP_TYPE_IMAGE:
+    case SPIRV_OP_TYPE_SAMPLER:
+    case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+    case SPIRV_OP_TYPE_ARRAY:
+    case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+    case SPIRV_OP_TYPE_STRUCT:
+    case SPIRV_OP_TYPE_POINTER:
+      if (op[1] < m->bound)
+        m->ids[op[1]].word = w;
+      break;
+    case SPIRV_OP_CONSTANT:
+      if (length >= 4 && op[2] < m->bound)
+        m->ids[op[2]].word = w;
+      break;
+    case SPIRV_OP_VARIABLE: {
+      Candid_Result result = add_variable(m, op, out);
+      if (result != CANDID_SUCCESS)
+        return result;
+      break;
+    }
+    }
+    w += length;
+  }
+  return has_entry_point ? CANDID_SUCCESS : CANDID_ERROR_INVALID_ARGUMENT;
+}
+
+/*******************************************************************************
+ * Public API
+ ******************************************************************************/
+
+Candid_Result candid_shader_reflect(const Candid_ShaderBytecode *bytecode,
+                                    Candid_ShaderReflection *out_reflection) {
+  if (!bytecode || !bytecode->data || !out_reflection)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  memset(out_reflection, 0, sizeof(*out_reflection));
+  if (bytecode->type != CANDID_SHADER_SOURCE_SPIRV)
+    return CANDID_ERROR_BACKEND_NOT_SUPPORTED;
+
+  SpirvModule m = {
+      .words = bytecode->data,
+      .word_count = (uint32_t)(bytecode->size / sizeof(uint32_t)),
+  };
+  if (m.word_count < SPIRV_HEADER_WORDS || m.words[0] != SPIRV_MAGIC)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  m.bound = m.words[3];
+  /* Ids are below the bound, and each needs an instruction */
+  if (m.bound > m.word_count)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  m.ids = calloc(m.bound, sizeof(SpirvId));
+  if (!m.ids)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  for (uint32_t i = 0; i < m.bound; ++i) {
+    m.ids[i].set = SPIRV_UNSET;
+    m.ids[i].binding = SPIRV_UNSET;
+    m.ids[i].location = SPIRV_UNSET;
+    m.ids[i].built_in = SPIRV_UNSET;
+  }
+
+  Candid_Result result = parse(&m, out_reflection);
+  free(m.ids);
+  if (result != CANDID_SUCCESS)
+    memset(out_reflection, 0, sizeof(*out_reflection));
+  return result;
+}
+
+/*******************************************************************************
+ * Program Layouts
+ ******************************************************************************/
+
+static Candid_BindingClass binding_class(Candid_UniformType type) {
+  switch (type) {
+  case CANDID_UNIFORM_SAMPLER:
+    return CANDID_BINDING_SAMPLER;
+  case CANDID_UNIFORM_TEXTURE:
+  case CANDID_UNIFORM_TEXTURE_SAMPLER:
+    return CANDID_BINDING_TEXTURE;
+  case CANDID_UNIFORM_STORAGE_BUFFER:
+    return CANDID_BINDING_STORAGE_BUFFER;
+  case CANDID_UNIFORM_STORAGE_TEXTURE:
+    return CANDID_BINDING_STORAGE_TEXTURE;
+  default:
+    return CANDID_BINDING_UNIFORM_BUFFER;
+  }
+}
+
+static Candid_Result add_binding(Candid_ShaderLayout *layout,
+                                 const Candid_UniformDesc *uniform) {
+  if (uniform->set >= CANDID_SHADER_MAX_SETS)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  /* Insertion keeps the list sorted; programs have few bindings */
+  uint32_t i = 0;
+  while (i < layout->binding_count &&
+         (layout->bindings[i].set < uniform->set ||
+          (layout->bindings[i].set == uniform->set &&
+           layout->bindings[i].binding < uniform->binding)))
+    ++i;
+
+  Candid_ShaderBinding *binding = &layout->bindings[i];
+  if (i < layout->binding_count && binding->set == uniform->set &&
+      binding->binding == uniform->binding) {
+    if (binding->type != uniform->type)
+      return CANDID_ERROR_INVALID_ARGUMENT;
+    binding->stages |= uniform->stages;
+    if (binding->array_count && (uniform->array_count == 0 ||
+                                 uniform->array_count > binding->array_count))
+      binding->array_count = uniform->array_count;
+    return CANDID_SUCCESS;
+  }
+
+  if (layout->binding_count == CANDID_MAX_UNIFORMS)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  memmove(binding + 1, binding,
+          (layout->binding_count - i) * sizeof(Candid_ShaderBinding));
+  layout->binding_count++;
+  *binding = (Candid_ShaderBinding){
+      .set = uniform->set,
+      .binding = uniform->binding,
+      .type = uniform->type,
+      .array_count = uniform->array_count,
+      .stages = uniform->stages,
+  };
+  return CANDID_SUCCESS;
+}
+
+Candid_Result
+candid_shader_layout_build(const Candid_ShaderReflection *const *stages,
+                           uint32_t stage_count, Candid_ShaderLayout *out) {
+  if (!stages || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+  memset(out, 0, sizeof(*out));
+  memset(out->slots, CANDID_SHADER_NO_SLOT, sizeof(out->slots));
+
+  for (uint32_t s = 0; s < stage_count; ++s) {
+    const Candid_ShaderReflection *stage = stages[s];
+    if (!stage)
+      continue;
+    for (uint32_t i = 0; i < stage->uniform_count; ++i) {
+      Candid_Result result = add_binding(out, &stage->uniforms[i]);
+      if (result != CANDID_SUCCESS)
+        return result;
+    }
+    /* One range from offset 0 keeps the layout compatible across stages */
+    uint32_t end = stage->push_constant_offset + stage->push_constant_size;
+    if (stage->push_constant_size) {
+      if (end > out->push_constant_size)
+        out->push_constant_size = end;
+      out->push_constant_stages |= stage->stage;
+    }
+  }
+
+  for (uint32_t i = 0; i < out->binding_count; ++i) {
+    const Candid_ShaderBinding *binding = &out->bindings[i];
+    if (out->set_binding_count[binding->set]++ == 0)
+      out->set_first[binding->set] = i;
+    if (binding->set + 1 > out->set_count)
+      out->set_count = binding->set + 1;
+    if (binding->set != 0)
+      continue;
+
+    /* Shifted ranges put each class back at slot 0; explicit bindings
+     * below the shift are their own slot */
+    uint32_t slot = binding->binding % CANDID_SHADER_BINDING_SHIFT;
+    Candid_BindingClass cls = binding_class(binding->type);
+    if (out->slots[cls][slot] == CANDID_SHADER_NO_SLOT)
+      out->slots[cls][slot] = (uint8_t)i;
+  }
+  return CANDID_SUCCESS;
+}
@@ -0,0 +1,797 @@
+/**
+ * @file transform.c
+ * @brief Transform hierarchy store with depth-sorted SoA storage
+ */
+
+#include <candid/transform.h>
+
+#include "jobs.h"
+
+#include <SDL3/SDL.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRANSFORM_NONE UINT32_MAX
+#define TRANSFORM_DEFAULT_CAPACITY 1024
+#define TRANSFORM_GRAIN 2048 /**< Nodes per job range */
+/* Destroyed slots are compacted away once they outnumber live ones */
+#define TRANSFORM_MIN_COMPACT 64
+
+/*******************************************************************************
+ * Internal Structures
+ ******************************************************************************/
+
+/* Per-slot arrays. Slots are sorted by depth; slot order changes on rebuild,
+ * handles do not. */
+typedef struct Candid_TransformSoA {
+  Candid_Vec3 *position;
+  Candid_Quat *rotation;
+  Candid_Vec3 *scale;
+  uint32_t *parent; /**< Parent slot or TRANSFORM_NONE */
+  uint32_t *depth;
+  uint8_t *dirty;
+  Candid_Mat4 *world;
+  Candid_TransformHandle *handle; /**< TRANSFORM_NONE for destroyed slots */
+} Candid_TransformSoA;
+
+/* Per handle index; child lists survive rebuilds, which only move slots */
+typedef struct Candid_TransformLinks {
+  uint32_t *slot_of; /**< Slot, or TRANSFORM_NONE once destroyed */
+  uint8_t *generation;
+  uint32_t *first_child; /**< Handle indices, TRANSFORM_NONE terminated */
+  uint32_t *next_sibling;
+  uint32_t *prev_sibling;
+} Candid_TransformLinks;
+
+struct Candid_TransformStore {
+  Candid_TransformSoA soa;
+  uint32_t capacity;
+  uint32_t count;      /**< Used slots, including destroyed ones */
+  uint32_t live_count; /**< Live nodes */
+
+  /* Handle table */
+  Candid_TransformLinks links;
+  uint32_t handle_capacity;
+  uint32_t handle_range; /**< Handle indices in use so far */
+  uint32_t *free_handles; /**< Free handle indices */
+  uint32_t free_count;
+
+  /* Level boundaries: level i spans [level_start[i], level_start[i + 1]) */
+  uint32_t *level_start;
+  uint32_t level_count;
+  uint32_t level_capacity;
+
+  bool order_dirty; /**< Slots must be re-sorted before the next update */
+
+  Candid_Mat4 *output;
+  uint32_t output_capacity;
+
+  Candid_JobSystem *jobs;
+};
+
+typedef struct Candid_TransformLevelJob {
+  Candid_TransformStore *store;
+  uint32_t level_begin;
+  SDL_AtomicInt changed;
+} Candid_TransformLevelJob;
+
+/*******************************************************************************
+ * Math Helpers
+ ******************************************************************************/
+
+static void compose_local(const Candid_Vec3 *t, const Candid_Quat *q,
+                          const Candid_Vec3 *s, float *m) {
+  const float xx = q->x * q->x, yy = q->y * q->y, zz = q->z * q->z;
+  const float xy = q->x * q->y, xz = q->x * q->z, yz = q->y * q->z;
+  const float wx = q->w * q->x, wy = q->w * q->y, wz = q->w * q->z;
+
+  m[0] = (1.0f - 2.0f * (yy + zz)) * s->x;
+  m[1] = 2.0f * (xy + wz) * s->x;
+  m[2] = 2.0f * (xz - wy) * s->x;
+  m[3] = 0.0f;
+
+  m[4] = 2.0f * (xy - wz) * s->y;
+  m[5] = (1.0f - 2.0f * (xx + zz)) * s->y;
+  m[6] = 2.0f * (yz + wx) * s->y;
+  m[7] = 0.0f;
+
+  m[8] = 2.0f * (xz + wy) * s->z;
+  m[9] = 2.0f * (yz - wx) * s->z;
+  m[10] = (1.0f - 2.0f * (xx + yy)) * s->z;
+  m[11] = 0.0f;
+
+  m[12] = t->x;
+  m[13] = t->y;
+  m[14] = t->z;
+  m[15] = 1.0f;
+}
+
+/* out = a * b for affine column-major matrices (last row 0, 0, 0, 1) */
+static void mul_affine(const float *a, const float *b, float *out) {
+  for (int c = 0; c < 4; ++c) {
+    const float *bc = b + c * 4;
+    out[c * 4 + 0] = a[0] * bc[0] + a[4] * bc[1] + a[8] * bc[2];
+    out[c * 4 + 1] = a[1] * bc[0] + a[5] * bc[1] + a[9] * bc[2];
+    out[c * 4 + 2] = a[2] * bc[0] + a[6] * bc[1] + a[10] * bc[2];
+    out[c * 4 + 3] = 0.0f;
+  }
+  out[12] += a[12];
+  out[13] += a[13];
+  out[14] += a[14];
+  out[15] = 1.0f;
+}
+
+Candid_Transform candid_transform_identity(void) {
+  return (Candid_Transform){
+      .position = {0.0f, 0.0f, 0.0f},
+      .rotation = {0.0f, 0.0f, 0.0f, 1.0f},
+      .scale = {1.0f, 1.0f, 1.0f},
+  };
+}
+
+Candid_Quat candid_quat_from_axis_angle(Candid_Vec3 axis, float angle) {
+  float s = sinf(angle * 0.5f);
+  return (Candid_Quat){axis.x * s, axis.y * s, axis.z * s, cosf(angle * 0.5f)};
+}
+
+Candid_Quat candid_quat_multiply(Candid_Quat a, Candid_Quat b) {
+  return (Candid_Quat){
+      a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+      a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+      a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+      a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+  };
+}
+
+void candid_transform_to_mat4(const Candid_Transform *transform,
+                              Candid_Mat4 *out) {
+  if (!transform || !out)
+    return;
+  compose_local(&transform->position, &transform->rotation, &transform->scale,
+                out->m);
+}
+
+/*******************************************************************************
+ * Storage
+ ******************************************************************************/
+
+static void soa_free(Candid_TransformSoA *soa) {
+  free(soa->position);
+  free(soa->rotation);
+  free(soa->scale);
+  free(soa->parent);
+  free(soa->depth);
+  free(soa->dirty);
+  free(soa->world);
+  free(soa->handle);
+  memset(soa, 0, sizeof(*soa));
+}
+
+static bool soa_alloc(Candid_TransformSoA *soa, uint32_t capacity) {
+  soa->position = malloc(capacity * sizeof(Candid_Vec3));
+  soa->rotation = malloc(capacity * sizeof(Candid_Quat));
+  soa->scale = malloc(capacity * sizeof(Candid_Vec3));
+  soa->parent = malloc(capacity * sizeof(uint32_t));
+  soa->depth = malloc(capacity * sizeof(uint32_t));
+  soa->dirty = malloc(capacity * sizeof(uint8_t));
+  soa->world = malloc(capacity * sizeof(Candid_Mat4));
+  soa->handle = malloc(capacity * sizeof(Candid_TransformHandle));
+
+  if (!soa->position || !soa->rotation || !soa->scale || !soa->parent ||
+      !soa->depth || !soa->dirty || !soa->world || !soa->handle) {
+    soa_free(soa);
+    return false;
+  }
+  return true;
+}
+
+static void soa_move(Candid_TransformSoA *dst, uint32_t d,
+                     const Candid_TransformSoA *src, uint32_t s) {
+  dst->position[d] = src->position[s];
+  dst->rotation[d] = src->rotation[s];
+  dst->scale[d] = src->scale[s];
+  dst->parent[d] = src->parent[s];
+  dst->depth[d] = src->depth[s];
+  dst->dirty[d] = src->dirty[s];
+  dst->world[d] = src->world[s];
+  dst->handle[d] = src->handle[s];
+}
+
+static bool grow_slots(Candid_TransformStore *store) {
+  uint32_t capacity = store->capacity * 2;
+  Candid_TransformSoA soa;
+  if (!soa_alloc(&soa, capacity))
+    return false;
+
+  for (uint32_t i = 0; i < store->count; ++i) {
+    soa_move(&soa, i, &store->soa, i);
+  }
+
+  soa_free(&store->soa);
+  store->soa = soa;
+  store->capacity = capacity;
+  return true;
+}
+
+static bool reserve_levels(Candid_TransformStore *store, uint32_t levels) {
+  if (levels + 1 <= store->level_capacity)
+    return true;
+
+  uint32_t capacity = store->level_capacity ? store->level_capacity : 16;
+  while (capacity < levels + 1)
+    capacity *= 2;
+
+  uint32_t *level_start =
+      realloc(store->level_start, capacity * sizeof(uint32_t));
+  if (!level_start)
+    return false;
+
+  store->level_start = level_start;
+  store->level_capacity = capacity;
+  return true;
+}
+
+static uint32_t handle_index(Candid_TransformHandle handle) {
+  return handle & CANDID_TRANSFORM_INDEX_MASK;
+}
+
+static Candid_TransformHandle make_handle(const Candid_TransformStore *store,
+                                          uint32_t index) {
+  return (uint32_t)store->links.generation[index]
+             << CANDID_TRANSFORM_INDEX_BITS |
+         index;
+}
+
+static void links_free(Candid_TransformLinks *links) {
+  free(links->slot_of);
+  free(links->generation);
+  free(links->first_child);
+  free(links->next_sibling);
+  free(links->prev_sibling);
+  memset(links, 0, sizeof(*links));
+}
+
+/* Existing entries are kept; new ones are left uninitialized */
+static bool links_realloc(Candid_TransformLinks *links, uint32_t capacity) {
+  uint32_t *slot_of = realloc(links->slot_of, capacity * sizeof(uint32_t));
+  if (slot_of)
+    links->slot_of = slot_of;
+  uint8_t *generation = realloc(links->generation, capacity);
+  if (generation)
+    links->generation = generation;
+  uint32_t *first_child =
+      realloc(links->first_child, capacity * sizeof(uint32_t));
+  if (first_child)
+    links->first_child = first_child;
+  uint32_t *next_sibling =
+      realloc(links->next_sibling, capacity * sizeof(uint32_t));
+  if (next_sibling)
+    links->next_sibling = next_sibling;
+  uint32_t *prev_sibling =
+      realloc(links->prev_sibling, capacity * sizeof(uint32_t));
+  if (prev_sibling)
+    links->prev_sibling = prev_sibling;
+  return slot_of && generation && first_child && next_sibling &&
+         prev_sibling;
+}
+
+/* @return A handle index, or TRANSFORM_NONE when out of memory or indices */
+static uint32_t alloc_handle(Candid_TransformStore *store) {
+  if (store->free_count > 0)
+    return store->free_handles[--store->free_count];
+
+  if (store->handle_range == CANDID_TRANSFORM_INDEX_MASK)
+    return TRANSFORM_NONE;
+  if (store->handle_range == store->handle_capacity) {
+    uint32_t capacity = store->handle_capacity * 2;
+    if (capacity > CANDID_TRANSFORM_INDEX_MASK)
+      capacity = CANDID_TRANSFORM_INDEX_MASK;
+    if (!links_realloc(&store->links, capacity))
+      return TRANSFORM_NONE;
+
+    uint32_t *free_handles =
+        realloc(store->free_handles, capacity * sizeof(uint32_t));
+    if (!free_handles)
+      return TRANSFORM_NONE;
+    store->free_handles = free_handles;
+    store->handle_capacity = capacity;
+  }
+
+  store->links.generation[store->handle_range] = 0;
+  return store->handle_range++;
+}
+
+/* Slot of a live node; stale handles of destroyed nodes give TRANSFORM_NONE */
+static uint32_t slot_of(const Candid_TransformStore *store,
+                        Candid_TransformHandle handle) {
+  uint32_t index = handle_index(handle);
+  if (!store || index >= store->handle_range ||
+      handle != make_handle(store, index))
+    return TRANSFORM_NONE;
+  return store->links.slot_of[index];
+}
+
+static void link_child(Candid_TransformLinks *links, uint32_t parent,
+                       uint32_t child) {
+  links->prev_sibling[child] = TRANSFORM_NONE;
+  links->next_sibling[child] = links->first_child[parent];
+  if (links->first_child[parent] != TRANSFORM_NONE)
+    links->prev_sibling[links->first_child[parent]] = child;
+  links->first_child[parent] = child;
+}
+
+static void unlink_child(Candid_TransformLinks *links, uint32_t parent,
+                         uint32_t child) {
+  uint32_t prev = links->prev_sibling[child];
+  uint32_t next = links->next_sibling[child];
+  if (prev != TRANSFORM_NONE)
+    links->next_sibling[prev] = next;
+  else
+    links->first_child[parent] = next;
+  if (next != TRANSFORM_NONE)
+    links->prev_sibling[next] = prev;
+  links->prev_sibling[child] = TRANSFORM_NONE;
+  links->next_sibling[child] = TRANSFORM_NONE;
+}
+
+/*******************************************************************************
+ * Rebuild (re-sort by depth, drop destroyed slots)
+ ******************************************************************************/
+
+static bool rebuild(Candid_TransformStore *store) {
+  const uint32_t count = store->count;
+  Candid_TransformSoA *src = &store->soa;
+
+  uint32_t *depth = malloc((count + 1) * sizeof(uint32_t));
+  uint32_t *new_slot = malloc((count + 1) * sizeof(uint32_t));
+  uint32_t *stack = malloc((count + 1) * sizeof(uint32_t));
+  Candid_TransformSoA dst;
+  if (!depth || !new_slot || !stack || !soa_alloc(&dst, store->capacity)) {
+    free(depth);
+    free(new_slot);
+    free(stack);
+    return false;
+  }
+
+  /* Recompute depths: walk up until a node of known depth is found */
+  uint32_t max_depth = 0;
+  for (uint32_t i = 0; i < count; ++i)
+    depth[i] = TRANSFORM_NONE;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    if (src->handle[i] == TRANSFORM_NONE || depth[i] != TRANSFORM_NONE)
+      continue;
+
+    uint32_t top = 0;
+    uint32_t node = i;
+    while (node != TRANSFORM_NONE && depth[node] == TRANSFORM_NONE) {
+      stack[top++] = node;
+      node = src->parent[node];
+    }
+
+    uint32_t d = (node == TRANSFORM_NONE) ? 0 : depth[node] + 1;
+    while (top > 0) {
+      depth[stack[--top]] = d++;
+    }
+    if (d - 1 > max_depth)
+      max_depth = d - 1;
+  }
+
+  if (!reserve_levels(store, max_depth + 1)) {
+    soa_free(&dst);
+    free(depth);
+    free(new_slot);
+    free(stack);
+    return false;
+  }
+
+  /* Counting sort by depth (stable, so siblings keep their relative order) */
+  uint32_t *level_start = store->level_start;
+  memset(level_start, 0, (max_depth + 2) * sizeof(uint32_t));
+  for (uint32_t i = 0; i < count; ++i) {
+    if (src->handle[i] != TRANSFORM_NONE)
+      level_start[depth[i] + 1]++;
+  }
+  for (uint32_t l = 0; l <= max_depth; ++l)
+    level_start[l + 1] += level_start[l];
+
+  uint32_t *cursor = stack; /* reuse as per-level write cursor */
+  memcpy(cursor, level_start, (max_depth + 1) * sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < count; ++i) {
+    if (src->handle[i] == TRANSFORM_NONE)
+      continue;
+    uint32_t s = cursor[depth[i]]++;
+    new_slot[i] = s;
+    soa_move(&dst, s, src, i);
+    dst.depth[s] = depth[i];
+  }
+
+  const uint32_t live = level_start[max_depth + 1];
+  for (uint32_t s = 0; s < live; ++s) {
+    uint32_t p = dst.parent[s];
+    dst.parent[s] = (p == TRANSFORM_NONE) ? TRANSFORM_NONE : new_slot[p];
+    store->links.slot_of[handle_index(dst.handle[s])] = s;
+  }
+
+  soa_free(&store->soa);
+  store->soa = dst;
+  store->count = live;
+  store->level_count = live > 0 ? max_depth + 1 : 0;
+  store->order_dirty = false;
+
+  free(depth);
+  free(new_slot);
+  free(stack);
+  return true;
+}
+
+/*******************************************************************************
+ * Store Lifecycle
+ ******************************************************************************/
+
+Candid_Result
+candid_transform_store_create(const Candid_TransformStoreDesc *desc,
+                              Candid_TransformStore **out) {
+  if (!out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  Candid_TransformStore *store = calloc(1, sizeof(Candid_TransformStore));
+  if (!store)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  uint32_t capacity = (desc && desc->initial_capacity > 0)
+                          ? desc->initial_capacity
+                          : TRANSFORM_DEFAULT_CAPACITY;
+
+  store->capacity = capacity;
+  if (capacity > CANDID_TRANSFORM_INDEX_MASK)
+    capacity = CANDID_TRANSFORM_INDEX_MASK;
+  store->handle_capacity = capacity;
+  store->free_handles = malloc(capacity * sizeof(uint32_t));
+
+  if (!links_realloc(&store->links, capacity) || !store->free_handles ||
+      !soa_alloc(&store->soa, capacity) || !reserve_levels(store, 1)) {
+    candid_transform_store_destroy(store);
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  }
+  store->level_start[0] = 0;
+
+  if (!desc || !desc->single_threaded) {
+    Candid_Result result =
+        candid_jobs_create(desc ? desc->worker_count : 0, &store->jobs);
+    if (result != CANDID_SUCCESS) {
+      candid_transform_store_destroy(store);
+      return result;
+    }
+  }
+
+  *out = store;
+  return CANDID_SUCCESS;
+}
+
+void candid_transform_store_destroy(Candid_TransformStore *store) {
+  if (!store)
+    return;
+
+  candid_jobs_destroy(store->jobs);
+  soa_free(&store->soa);
+  links_free(&store->links);
+  free(store->free_handles);
+  free(store->level_start);
+  free(store);
+}
+
+uint32_t candid_transform_store_get_count(const Candid_TransformStore *store) {
+  return store ? store->live_count : 0;
+}
+
+uint32_t
+candid_transform_store_get_handle_range(const Candid_TransformStore *store) {
+  return store ? store->handle_range : 0;
+}
+
+/*******************************************************************************
+ * Nodes
+ ******************************************************************************/
+
+Candid_Result candid_transform_create(Candid_TransformStore *store,
+                                      Candid_TransformHandle parent,
+                                      const Candid_Transform *local,
+                                      Candid_TransformHandle *out) {
+  if (!store || !out)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  uint32_t parent_slot = TRANSFORM_NONE;
+  if (parent != CANDID_TRANSFORM_INVALID) {
+    parent_slot = slot_of(store, parent);
+    if (parent_slot == TRANSFORM_NONE)
+      return CANDID_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (store->count == store->capacity && !grow_slots(store))
+    return CANDID_ERROR_OUT_OF_MEMORY;
+
+  uint32_t index = alloc_handle(store);
+  if (index == TRANSFORM_NONE)
+    return CANDID_ERROR_OUT_OF_MEMORY;
+  Candid_TransformHandle handle = make_handle(store, index);
+
+  Candid_Transform t = local ? *local : candid_transform_identity();
+  uint32_t depth =
+      (parent_slot == TRANSFORM_NONE) ? 0 : store->soa.depth[parent_slot] + 1;
+
+  uint32_t slot = store->count++;
+  store->soa.position[slot] = t.position;
+  store->soa.rotation[slot] = t.rotation;
+  store->soa.scale[slot] = t.scale;
+  store->soa.parent[slot] = parent_slot;
+  store->soa.depth[slot] = depth;
+  store->soa.dirty[slot] = 1;
+  store->soa.handle[slot] = handle;
+  store->links.slot_of[index] = slot;
+  store->links.first_child[index] = TRANSFORM_NONE;
+  store->links.prev_sibling[index] = TRANSFORM_NONE;
+  store->links.next_sibling[index] = TRANSFORM_NONE;
+  if (parent_slot != TRANSFORM_NONE)
+    link_child(&store->links, handle_index(parent), index);
+  store->live_count++;
+
+  /* Appending keeps the depth order as long as the node is not shallower
+   * than the deepest level; otherwise defer to a rebuild. */
+  if (!store->order_dirty) {
+    if (depth + 1 >= store->level_count && reserve_levels(store, depth + 1)) {
+      if (depth == store->level_count) {
+        store->level_count++;
+      }
+      store->level_start[store->level_count] = store->count;
+    } else {
+      store->order_dirty = true;
+    }
+  }
+
+  *out = handle;
+  return CANDID_SUCCESS;
+}
+
+void candid_transform_destroy(Candid_TransformStore *store,
+                              Candid_TransformHandle handle) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE)
+    return;
+
+  /* Children move up to the grandparent. Its level is above theirs, so the
+   * slot order stays valid without a rebuild; only the children are
+   * visited. */
+  Candid_TransformLinks *links = &store->links;
+  const uint32_t index = handle_index(handle);
+  const uint32_t grand_parent = store->soa.parent[slot];
+  const uint32_t grand_index =
+      grand_parent == TRANSFORM_NONE
+          ? TRANSFORM_NONE
+          : handle_index(store->soa.handle[grand_parent]);
+  if (grand_index != TRANSFORM_NONE)
+    unlink_child(links, grand_index, index);
+
+  uint32_t child = links->first_child[index];
+  while (child != TRANSFORM_NONE) {
+    uint32_t next = links->next_sibling[child];
+    uint32_t child_slot = links->slot_of[child];
+    store->soa.parent[child_slot] = grand_parent;
+    store->soa.dirty[child_slot] = 1;
+    if (grand_index != TRANSFORM_NONE) {
+      link_child(links, grand_index, child);
+    } else {
+      links->prev_sibling[child] = TRANSFORM_NONE;
+      links->next_sibling[child] = TRANSFORM_NONE;
+    }
+    child = next;
+  }
+
+  store->soa.handle[slot] = TRANSFORM_NONE;
+  store->soa.parent[slot] = TRANSFORM_NONE;
+  links->slot_of[index] = TRANSFORM_NONE;
+  links->first_child[index] = TRANSFORM_NONE;
+  /* Stale copies of the handle stop resolving once the index is reused */
+  links->generation[index]++;
+  store->free_handles[store->free_count++] = index;
+  store->live_count--;
+
+  /* Destroyed slots stay in place until they are worth compacting */
+  uint32_t dead = store->count - store->live_count;
+  if (dead > TRANSFORM_MIN_COMPACT && dead > store->live_count)
+    store->order_dirty = true;
+}
+
+Candid_Result candid_transform_set_parent(Candid_TransformStore *store,
+                                          Candid_TransformHandle handle,
+                                          Candid_TransformHandle parent) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE)
+    return CANDID_ERROR_INVALID_ARGUMENT;
+
+  uint32_t parent_slot = TRANSFORM_NONE;
+  if (parent != CANDID_TRANSFORM_INVALID) {
+    parent_slot = slot_of(store, parent);
+    if (parent_slot == TRANSFORM_NONE)
+      return CANDID_ERROR_INVALID_ARGUMENT;
+
+    for (uint32_t p = parent_slot; p != TRANSFORM_NONE;
+         p = store->soa.parent[p]) {
+      if (p == slot)
+        return CANDID_ERROR_INVALID_ARGUMENT;
+    }
+  }
+
+  uint32_t old_parent = store->soa.parent[slot];
+  if (old_parent == parent_slot)
+    return CANDID_SUCCESS;
+
+  uint32_t index = handle_index(handle);
+  if (old_parent != TRANSFORM_NONE)
+    unlink_child(&store->links, handle_index(store->soa.handle[old_parent]),
+                 index);
+  if (parent_slot != TRANSFORM_NONE)
+    link_child(&store->links, handle_index(parent), index);
+  store->soa.parent[slot] = parent_slot;
+  store->soa.dirty[slot] = 1;
+  store->order_dirty = true;
+  return CANDID_SUCCESS;
+}
+
+Candid_TransformHandle
+candid_transform_get_parent(const Candid_TransformStore *store,
+                            Candid_TransformHandle handle) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE)
+    return CANDID_TRANSFORM_INVALID;
+
+  uint32_t parent_slot = store->soa.parent[slot];
+  if (parent_slot == TRANSFORM_NONE)
+    return CANDID_TRANSFORM_INVALID;
+  return store->soa.handle[parent_slot];
+}
+
+void candid_transform_set_local(Candid_TransformStore *store,
+                                Candid_TransformHandle handle,
+                                const Candid_Transform *local) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE || !local)
+    return;
+  store->soa.position[slot] = local->position;
+  store->soa.rotation[slot] = local->rotation;
+  store->soa.scale[slot] = local->scale;
+  store->soa.dirty[slot] = 1;
+}
+
+Candid_Transform candid_transform_get_local(const Candid_TransformStore *store,
+                                            Candid_TransformHandle handle) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE)
+    return candid_transform_identity();
+  return (Candid_Transform){
+      .position = store->soa.position[slot],
+      .rotation = store->soa.rotation[slot],
+      .scale = store->soa.scale[slot],
+  };
+}
+
+void candid_transform_set_position(Candid_TransformStore *store,
+                                   Candid_TransformHandle handle,
+                                   Candid_Vec3 position) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE)
+    return;
+  store->soa.position[slot] = position;
+  store->soa.dirty[slot] = 1;
+}
+
+void candid_transform_set_rotation(Candid_TransformStore *store,
+                                   Candid_TransformHandle handle,
+                                   Candid_Quat rotation) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE)
+    return;
+  store->soa.rotation[slot] = rotation;
+  store->soa.dirty[slot] = 1;
+}
+
+void candid_transform_set_scale(Candid_TransformStore *store,
+                                Candid_TransformHandle handle,
+                                Candid_Vec3 scale) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE)
+    return;
+  store->soa.scale[slot] = scale;
+  store->soa.dirty[slot] = 1;
+}
+
+const Candid_Mat4 *
+candid_transform_get_world(const Candid_TransformStore *store,
+                           Candid_TransformHandle handle) {
+  uint32_t slot = slot_of(store, handle);
+  if (slot == TRANSFORM_NONE)
+    return NULL;
+  return &store->soa.world[slot];
+}
+
+/*******************************************************************************
+ * Update
+ ******************************************************************************/
+
+void candid_transform_store_bind_output(Candid_TransformStore *store,
+                                        Candid_Mat4 *output,
+                                        uint32_t capacity) {
+  if (!store)
+    return;
+
+  store->output = output;
+  store->output_capacity = output ? capacity : 0;
+
+  /* The new destination holds nothing yet: write every node once */
+  if (output && store->count > 0)
+    memset(store->soa.dirty, 1, store->count);
+}
+
+static void update_range(void *user_data, uint32_t begin, uint32_t end) {
+  Candid_TransformLevelJob *job = user_data;
+  Candid_TransformStore *store = job->store;
+  Candid_TransformSoA *soa = &store->soa;
+  Candid_Mat4 *output = store->output;
+  const uint32_t output_capacity = store->output_capacity;
+
+  int changed = 0;
+  for (uint32_t i = job->level_begin + begin; i < job->level_begin + end;
+       ++i) {
+    const uint32_t handle = soa->handle[i];
+    const uint32_t p = soa->parent[i];
+    if (handle == TRANSFORM_NONE)
+      continue;
+    if (!soa->dirty[i] && (p == TRANSFORM_NONE || !soa->dirty[p]))
+      continue;
+
+    if (p == TRANSFORM_NONE) {
+      compose_local(&soa->position[i], &soa->rotation[i], &soa->scale[i],
+                    soa->world[i].m);
+    } else {
+      float local[16];
+      compose_local(&soa->position[i], &soa->rotation[i], &soa->scale[i],
+                    local);
+      mul_affine(soa->world[p].m, local, soa->world[i].m);
+    }
+
+    /* Children one level down see this flag and recompute as well */
+    soa->dirty[i] = 1;
+    if (output && handle_index(handle) < output_capacity)
+      output[handle_index(handle)] = soa->world[i];
+    changed++;
+  }
+
+  if (changed > 0)
+    SDL_AddAtomicInt(&job->changed, changed);
+}
+
+uint32_t candid_transform_store_update(Candid_TransformStore *store) {
+  if (!store)
+    return 0;
+
+  if (store->order_dirty && !rebuild(store))
+    return 0;
+
+  Candid_TransformLevelJob job = {.store = store};
+  SDL_SetAtomicInt(&job.changed, 0);
+
+  /* Levels must run in order; nodes inside a level are independent */
+  for (uint32_t l = 0; l < store->level_count; ++l) {
+    job.level_begin = store->level_start[l];
+    uint32_t level_size = store->level_start[l + 1] - store->level_start[l];
+    candid_jobs_parallel_for(store->jobs, level_size, TRANSFORM_GRAIN,
+                             update_range, &job);
+  }
+
+  if (store->count > 0)
+    memset(store->soa.dirty, 0, store->count);
+
+  return (uint32_t)SDL_GetAtomicInt(&job.changed);
+}
@@ -0,0 +1,104 @@
+/**
+ * @file upload.c
+ * @brief Internal per-frame allocator for transient GPU data
+ */
+
+#include "upload.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define UPLOAD_ALIGNMENT 256
+#define UPLOAD_MIN_CAPACITY (256u * 1024u)
+
+static Candid_Result upload_grow(const Candid_BackendInterface *backend,
+                                 Candid_Device *device,
+                                 Candid_FrameUpload *upload, size_t size) {
+  size_t capacity = upload->capacity ? upload->capacity * 2
+                                     : (size_t)UPLOAD_MIN_CAPACITY;
+  while (capacity < size)
+    capacity *= 2;
+
+  Candid_BufferDesc desc = {
+      .size = capacity,
+      .usage = CANDID_BUFFER_USAGE_VERTEX | CANDID_BUFFER_USAGE_STORAGE |
+               CANDID_BUFFER_USAGE_INDIRECT,
+      .memory = CANDID_BUFFER_MEMORY_CPU_TO_GPU,
+      .label = "Candid Frame Upload",
+  };
+
+  Candid_Buffer *buffer = NULL;
+  Candid_Result result = backend->buffer_create(device, &desc, &buffer);
+  if (result != CANDID_SUCCESS)
+    return result;
+
+  void *mapped = backend->buffer_map(device, buffer);
+  if (!mapped) {
+    backend->buffer_destroy(device, buffer);
+    return CANDID_ERROR_RESOURCE_CREATION;
+  }
+
+  if (upload->buffer) {
+    if (upload->retired_count == upload->retired_capacity) {
+      uint32_t retired_capacity =
+          upload->retired_capacity ? upload->retired_capacity * 2 : 4;
+      Candid_Buffer **retired = realloc(
+          upload->retired, retired_capacity * sizeof(Candid_Buffer *));
+      if (!retired) {
+        backend->buffer_destroy(device, buffer);
+        return CANDID_ERROR_OUT_OF_MEMORY;
+      }
+      upload->retired = retired;
+      upload->retired_capacity = retired_capacity;
+    }
+    backend->buffer_unmap(device, upload->buffer);
+    upload->retired[upload->retired_count++] = upload->buffer;
+  }
+
+  upload->buffer = buffer;
+  upload->mapped = mapped;
+  upload->capacity = capacity;
+  upload->offset = 0;
+  return CANDID_SUCCESS;
+}
+
+Candid_Result candid_upload_alloc(const Candid_BackendInterface *backend,
+                                  Candid_Device *device,
+                                  Candid_FrameUpload *upload, size_t size,
+                                  Candid_Buffer **out_buffer,
+                                  size_t *out_offset, void **out_data) {
+  size_t offset = (upload->offset + UPLOAD_ALIGNMENT - 1) &
+                  ~(size_t)(UPLOAD_ALIGNMENT - 1);
+  if (!upload->buffer || offset + size > upload->capacity) {
+    Candid_Result result = upload_grow(backend, device, upload, size);
+    if (result != CANDID_SUCCESS)
+      return result;
+    offset = 0;
+  }
+
+  upload->offset = offset + size;
+  *out_buffer = upload->buffer;
+  *out_offset = offset;
+  *out_data = upload->mapped + offset;
+  return CANDID_SUCCESS;
+}
+
+void candid_upload_reset(const Candid_BackendInterface *backend,
+                         Candid_Device *device, Candid_FrameUpload *upload) {
+  for (uint32_t i = 0; i < upload->retired_count; ++i) {
+    backend->buffer_destroy(device, upload->retired[i]);
+  }
+  upload->retired_count = 0;
+  upload->offset = 0;
+}
+
+void candid_upload_destroy(const Candid_BackendInterface *backend,
+                           Candid_Device *device, Candid_FrameUpload *upload) {
+  candid_upload_reset(backend, device, upload);
+  if (upload->buffer) {
+    backend->buffer_unmap(device, upload->buffer);
+    backend->buffer_destroy(device, upload->buffer);
+  }
+  free(upload->retired);
+  memset(upload, 0, sizeof(*upload));
+}
@@ -0,0 +1,52 @@
+/**
+ * @file upload.h
+ * @brief Internal per-frame allocator for transient GPU data
+ *
+ * Not part of the public API. A Candid_FrameUpload is a linear allocator over
+ * a persistently mapped CPU_TO_GPU buffer. Owners keep one per frame slot and
+ * reset it when the slot comes around again, i.e. once the GPU can no longer
+ * be reading it. Buffers outgrown mid-frame may still be referenced by
+ * recorded commands, so they are retired and only destroyed on that reset.
+ */
+
+#pragma once
+
+#include <candid/backend.h>
+
+/** Frame slots an owner may rotate through (frames in flight + 1) */
+#define CANDID_MAX_UPLOAD_SLOTS 4
+
+typedef struct Candid_FrameUpload {
+  Candid_Buffer *buffer;
+  uint8_t *mapped;
+  size_t capacity;
+  size_t offset;
+  Candid_Buffer **retired;
+  uint32_t retired_count;
+  uint32_t retired_capacity;
+} Candid_FrameUpload;
+
+/**
+ * Reserve `size` bytes (256-byte aligned) of mapped GPU-visible memory
+ * @param out_buffer Buffer holding the allocation
+ * @param out_offset Byte offset of the allocation in out_buffer
+ * @param out_data CPU pointer to write the data through
+ * @return CANDID_SUCCESS on success
+ */
+Candid_Result candid_upload_alloc(const Candid_BackendInterface *backend,
+                                  Candid_Device *device,
+                                  Candid_FrameUpload *upload, size_t size,
+                                  Candid_Buffer **out_buffer,
+                                  size_t *out_offset, void **out_data);
+
+/**
+ * Start a new frame: destroy retired buffers and rewind the allocator
+ */
+void candid_upload_reset(const Candid_BackendInterface *backend,
+                         Candid_Device *device, Candid_FrameUpload *upload);
+
+/**
+ * Release every buffer owned by the allocator
+ */
+void candid_upload_destroy(const Candid_BackendInterface *backend,
+                           Candid_Device *device, Candid_FrameUpload *upload);
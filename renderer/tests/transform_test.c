@@ -0,0 +1,247 @@
+/**
+ * @file transform_test.c
+ * @brief Transform hierarchy: parent-before-child ordering, reparenting,
+ * destruction and dirty propagation
+ */
+
+#include <candid/transform.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static Candid_Transform at(float x, float y, float z) {
+  Candid_Transform t = candid_transform_identity();
+  t.position = (Candid_Vec3){x, y, z};
+  return t;
+}
+
+static Candid_TransformHandle node(Candid_TransformStore *store,
+                                   Candid_TransformHandle parent, float x,
+                                   float y, float z) {
+  Candid_Transform t = at(x, y, z);
+  Candid_TransformHandle handle = CANDID_TRANSFORM_INVALID;
+  CHECK(candid_transform_create(store, parent, &t, &handle) ==
+        CANDID_SUCCESS);
+  return handle;
+}
+
+/* World translation of a node */
+static bool world_at(const Candid_TransformStore *store,
+                     Candid_TransformHandle handle, float x, float y,
+                     float z) {
+  const Candid_Mat4 *world = candid_transform_get_world(store, handle);
+  return world && fabsf(world->m[12] - x) < 1e-4f &&
+         fabsf(world->m[13] - y) < 1e-4f && fabsf(world->m[14] - z) < 1e-4f;
+}
+
+static Candid_TransformStore *create_store(bool single_threaded) {
+  Candid_TransformStoreDesc desc = {
+      .initial_capacity = 4,
+      .single_threaded = single_threaded,
+  };
+  Candid_TransformStore *store = NULL;
+  CHECK(candid_transform_store_create(&desc, &store) == CANDID_SUCCESS);
+  return store;
+}
+
+/* Parents get their world matrix before their children, whatever the order
+ * the nodes were created or attached in */
+static void test_parent_before_child(void) {
+  Candid_TransformStore *store = create_store(true);
+  Candid_TransformHandle child = node(store, CANDID_TRANSFORM_INVALID, 1, 0,
+                                      0);
+  Candid_TransformHandle grandchild = node(store, child, 0, 1, 0);
+  Candid_TransformHandle parent = node(store, CANDID_TRANSFORM_INVALID, 10,
+                                       0, 0);
+  Candid_TransformHandle root = node(store, CANDID_TRANSFORM_INVALID, 100, 0,
+                                     0);
+  /* Both end up deeper than the nodes created after them */
+  CHECK(candid_transform_set_parent(store, child, parent) == CANDID_SUCCESS);
+  CHECK(candid_transform_set_parent(store, parent, root) == CANDID_SUCCESS);
+
+  CHECK(candid_transform_store_update(store) == 4);
+  CHECK(world_at(store, root, 100, 0, 0));
+  CHECK(world_at(store, parent, 110, 0, 0));
+  CHECK(world_at(store, child, 111, 0, 0));
+  CHECK(world_at(store, grandchild, 111, 1, 0));
+  candid_transform_store_destroy(store);
+}
+
+static void test_reparent(void) {
+  Candid_TransformStore *store = create_store(true);
+  Candid_TransformHandle a = node(store, CANDID_TRANSFORM_INVALID, 1, 0, 0);
+  Candid_TransformHandle b = node(store, CANDID_TRANSFORM_INVALID, 0, 2, 0);
+  Candid_TransformHandle child = node(store, a, 0, 0, 3);
+  Candid_TransformHandle leaf = node(store, child, 1, 1, 1);
+  candid_transform_store_update(store);
+  CHECK(world_at(store, leaf, 2, 1, 4));
+
+  CHECK(candid_transform_set_parent(store, child, b) == CANDID_SUCCESS);
+  CHECK(candid_transform_get_parent(store, child) == b);
+  CHECK(candid_transform_store_update(store) == 2);
+  CHECK(world_at(store, child, 0, 2, 3));
+  CHECK(world_at(store, leaf, 1, 3, 4));
+
+  /* A node cannot go under itself or its descendants */
+  CHECK(candid_transform_set_parent(store, child, leaf) ==
+        CANDID_ERROR_INVALID_ARGUMENT);
+  CHECK(candid_transform_set_parent(store, child, child) ==
+        CANDID_ERROR_INVALID_ARGUMENT);
+  CHECK(candid_transform_get_parent(store, child) == b);
+
+  CHECK(candid_transform_set_parent(store, child, CANDID_TRANSFORM_INVALID) ==
+        CANDID_SUCCESS);
+  CHECK(candid_transform_get_parent(store, child) ==
+        CANDID_TRANSFORM_INVALID);
+  candid_transform_store_update(store);
+  CHECK(world_at(store, child, 0, 0, 3));
+  CHECK(world_at(store, leaf, 1, 1, 4));
+  candid_transform_store_destroy(store);
+}
+
+/* Destroyed nodes hand their children to their parent; stale handles are
+ * ignored */
+static void test_destroy(void) {
+  Candid_TransformStore *store = create_store(true);
+  Candid_TransformHandle root = node(store, CANDID_TRANSFORM_INVALID, 1, 0, 0);
+  Candid_TransformHandle middle = node(store, root, 2, 0, 0);
+  Candid_TransformHandle leaf = node(store, middle, 4, 0, 0);
+  candid_transform_store_update(store);
+  CHECK(world_at(store, leaf, 7, 0, 0));
+
+  candid_transform_destroy(store, middle);
+  CHECK(candid_transform_store_get_count(store) == 2);
+  CHECK(candid_transform_get_parent(store, leaf) == root);
+  CHECK(candid_transform_get_world(store, middle) == NULL);
+  CHECK(candid_transform_store_update(store) == 1);
+  CHECK(world_at(store, leaf, 5, 0, 0));
+
+  /* The freed index is reused under a new generation */
+  Candid_TransformHandle reused = node(store, CANDID_TRANSFORM_INVALID, 0, 0,
+                                       0);
+  CHECK(CANDID_TRANSFORM_INDEX(reused) == CANDID_TRANSFORM_INDEX(middle));
+  CHECK(reused != middle);
+  candid_transform_set_position(store, middle, (Candid_Vec3){9, 9, 9});
+  CHECK(candid_transform_get_local(store, reused).position.x == 0);
+  candid_transform_store_destroy(store);
+}
+
+/* A change reaches every descendant and nothing else */
+static void test_dirty_propagation(void) {
+  Candid_TransformStore *store = create_store(true);
+  Candid_TransformHandle root = node(store, CANDID_TRANSFORM_INVALID, 0, 0, 0);
+  Candid_TransformHandle left = node(store, root, -1, 0, 0);
+  Candid_TransformHandle right = node(store, root, 1, 0, 0);
+  Candid_TransformHandle left_leaf = node(store, left, 0, -1, 0);
+  Candid_TransformHandle right_leaf = node(store, right, 0, -1, 0);
+  CHECK(candid_transform_store_update(store) == 5);
+  CHECK(candid_transform_store_update(store) == 0);
+
+  candid_transform_set_position(store, left, (Candid_Vec3){-2, 0, 0});
+  CHECK(candid_transform_store_update(store) == 2);
+  CHECK(world_at(store, left_leaf, -2, -1, 0));
+  CHECK(world_at(store, right_leaf, 1, -1, 0));
+
+  candid_transform_set_position(store, root, (Candid_Vec3){0, 5, 0});
+  CHECK(candid_transform_store_update(store) == 5);
+  CHECK(world_at(store, left_leaf, -2, 4, 0));
+  CHECK(world_at(store, right_leaf, 1, 4, 0));
+
+  /* Rotation and scale propagate too: a quarter turn about z maps the
+   * child's +x offset to +y, doubled */
+  Candid_Transform spin = candid_transform_identity();
+  spin.rotation =
+      candid_quat_from_axis_angle((Candid_Vec3){0, 0, 1}, 1.57079633f);
+  spin.scale = (Candid_Vec3){2, 2, 2};
+  candid_transform_set_local(store, root, &spin);
+  candid_transform_store_update(store);
+  CHECK(world_at(store, right, 0, 2, 0));
+  CHECK(world_at(store, right_leaf, 2, 2, 0));
+
+  /* A bound output receives every node once, then only changes */
+  Candid_Mat4 output[8] = {0};
+  candid_transform_store_bind_output(store, output, 8);
+  CHECK(candid_transform_store_update(store) == 5);
+  CHECK(output[CANDID_TRANSFORM_INDEX(right_leaf)].m[12] ==
+        candid_transform_get_world(store, right_leaf)->m[12]);
+  candid_transform_set_scale(store, right_leaf, (Candid_Vec3){3, 3, 3});
+  CHECK(candid_transform_store_update(store) == 1);
+  CHECK(output[CANDID_TRANSFORM_INDEX(right_leaf)].m[0] ==
+        candid_transform_get_world(store, right_leaf)->m[0]);
+  candid_transform_store_destroy(store);
+}
+
+/* Worker threads compute the same matrices as the calling thread alone,
+ * on a tree wide enough to split levels across jobs */
+static void test_threaded_matches_single(void) {
+  enum { NODE_COUNT = 20000 };
+  Candid_TransformStore *single = create_store(true);
+  Candid_TransformStore *threaded = create_store(false);
+  Candid_TransformHandle *handles =
+      malloc(NODE_COUNT * sizeof(Candid_TransformHandle));
+  CHECK(handles != NULL);
+  if (!single || !threaded || !handles) {
+    free(handles);
+    candid_transform_store_destroy(single);
+    candid_transform_store_destroy(threaded);
+    return;
+  }
+
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < NODE_COUNT; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    Candid_TransformHandle parent =
+        i < 16 ? CANDID_TRANSFORM_INVALID : handles[(seed >> 8) % i];
+    float offset = (float)(seed % 7) - 3.0f;
+    Candid_TransformHandle a = node(single, parent, offset, 1, 0);
+    Candid_TransformHandle b = node(threaded, parent, offset, 1, 0);
+    CHECK(a == b);
+    handles[i] = a;
+  }
+  for (uint32_t i = 0; i < NODE_COUNT; i += 97) {
+    Candid_Quat q = candid_quat_from_axis_angle((Candid_Vec3){0, 1, 0},
+                                                (float)i * 0.001f);
+    candid_transform_set_rotation(single, handles[i], q);
+    candid_transform_set_rotation(threaded, handles[i], q);
+  }
+
+  CHECK(candid_transform_store_update(single) == NODE_COUNT);
+  CHECK(candid_transform_store_update(threaded) == NODE_COUNT);
+  uint32_t mismatches = 0;
+  for (uint32_t i = 0; i < NODE_COUNT; ++i) {
+    const Candid_Mat4 *a = candid_transform_get_world(single, handles[i]);
+    const Candid_Mat4 *b = candid_transform_get_world(threaded, handles[i]);
+    for (int e = 0; e < 16; ++e)
+      mismatches += a->m[e] != b->m[e];
+  }
+  CHECK(mismatches == 0);
+
+  free(handles);
+  candid_transform_store_destroy(single);
+  candid_transform_store_destroy(threaded);
+}
+
+int main(void) {
+  test_parent_before_child();
+  test_reparent();
+  test_destroy();
+  test_dirty_propagation();
+  test_threaded_matches_single();
+  if (failures > 0) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}